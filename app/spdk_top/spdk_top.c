@@ -0,0 +1,661 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/event.h"
+#include "spdk/json.h"
+#include "spdk/jsonrpc.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#define DEFAULT_POLLER_ROWS	20
+
+/* Pollers of one thread with the same name and period. */
+struct rpc_poller_info {
+	char		*name;
+	uint64_t	period_ticks;
+	uint32_t	count;
+	uint64_t	run_count;
+	uint64_t	busy_count;
+	uint64_t	run_tsc;
+};
+
+struct rpc_thread_pollers {
+	char			*name;
+	struct rpc_poller_info	*pollers;
+	size_t			poller_count;
+};
+
+struct rpc_thread_stats {
+	char		*name;
+	uint64_t	busy;
+	uint64_t	idle;
+	uint64_t	unknown;
+	uint64_t	active_pollers_count;
+	uint64_t	timed_pollers_count;
+	uint64_t	poller_runs;
+	uint64_t	poller_run_tsc;
+	uint64_t	poller_avg_latency_tsc;
+};
+
+struct rpc_threads_stats {
+	uint64_t		tick_rate;
+	struct rpc_thread_stats	*threads;
+	size_t			thread_count;
+};
+
+struct rpc_threads_pollers {
+	uint64_t			tick_rate;
+	struct rpc_thread_pollers	*threads;
+	size_t				thread_count;
+};
+
+/* Statistics of all pollers with the same name on one thread. */
+struct poller_row {
+	const char	*thread_name;
+	const char	*name;
+	uint32_t	instances;
+	uint64_t	period_ticks;
+	uint64_t	run_count;
+	uint64_t	busy_count;
+	uint64_t	run_tsc;
+
+	/* Filled in when comparing against the previous sample. */
+	uint64_t	run_tsc_delta;
+	uint64_t	run_count_delta;
+	uint64_t	busy_count_delta;
+	uint64_t	thread_tsc_delta;
+};
+
+struct top_sample {
+	struct rpc_threads_stats	stats;
+
+	/* Pollers of each thread in stats, requested one thread at a time. */
+	struct rpc_thread_pollers	*pollers;
+	size_t				pollers_count;
+
+	struct poller_row		*rows;
+	size_t				row_count;
+};
+
+static const char *g_rpc_addr = SPDK_DEFAULT_RPC_ADDR;
+static int g_poller_rows = DEFAULT_POLLER_ROWS;
+static char *exe_name;
+
+static const struct spdk_json_object_decoder rpc_poller_info_decoders[] = {
+	{"name", offsetof(struct rpc_poller_info, name), spdk_json_decode_string},
+	{"period_ticks", offsetof(struct rpc_poller_info, period_ticks), spdk_json_decode_uint64, true},
+	{"count", offsetof(struct rpc_poller_info, count), spdk_json_decode_uint32},
+	{"run_count", offsetof(struct rpc_poller_info, run_count), spdk_json_decode_uint64},
+	{"busy_count", offsetof(struct rpc_poller_info, busy_count), spdk_json_decode_uint64},
+	{"run_tsc", offsetof(struct rpc_poller_info, run_tsc), spdk_json_decode_uint64},
+};
+
+/*
+ * Decode a JSON array into a newly allocated C array sized from the number of elements
+ *  in the response.
+ */
+static int
+rpc_decode_alloc_array(const struct spdk_json_val *val, spdk_json_decode_fn decode_func,
+		       void **out, size_t *out_size, size_t stride)
+{
+	struct spdk_json_val *it;
+	size_t count = 0;
+
+	if (val->type != SPDK_JSON_VAL_ARRAY_BEGIN) {
+		return -EINVAL;
+	}
+
+	for (it = spdk_json_array_first((struct spdk_json_val *)val); it != NULL; it = spdk_json_next(it)) {
+		count++;
+	}
+
+	*out = calloc(spdk_max(count, 1), stride);
+	if (*out == NULL) {
+		return -ENOMEM;
+	}
+
+	if (spdk_json_decode_array(val, decode_func, *out, count, out_size, stride)) {
+		/* Let the caller free whatever the failed element had already decoded. */
+		*out_size = count;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int
+rpc_decode_poller_info(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_poller_info_decoders,
+				       SPDK_COUNTOF(rpc_poller_info_decoders), out);
+}
+
+static int
+rpc_decode_pollers_array(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_thread_pollers *thread = SPDK_CONTAINEROF(out, struct rpc_thread_pollers, pollers);
+
+	return rpc_decode_alloc_array(val, rpc_decode_poller_info, (void **)&thread->pollers,
+				      &thread->poller_count, sizeof(struct rpc_poller_info));
+}
+
+static const struct spdk_json_object_decoder rpc_thread_pollers_decoders[] = {
+	{"name", offsetof(struct rpc_thread_pollers, name), spdk_json_decode_string},
+	{"pollers", offsetof(struct rpc_thread_pollers, pollers), rpc_decode_pollers_array},
+};
+
+static int
+rpc_decode_thread_pollers(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_thread_pollers_decoders,
+				       SPDK_COUNTOF(rpc_thread_pollers_decoders), out);
+}
+
+static int
+rpc_decode_threads_pollers_array(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_threads_pollers *pollers = SPDK_CONTAINEROF(out, struct rpc_threads_pollers, threads);
+
+	return rpc_decode_alloc_array(val, rpc_decode_thread_pollers, (void **)&pollers->threads,
+				      &pollers->thread_count, sizeof(struct rpc_thread_pollers));
+}
+
+static const struct spdk_json_object_decoder rpc_threads_pollers_decoders[] = {
+	{"tick_rate", offsetof(struct rpc_threads_pollers, tick_rate), spdk_json_decode_uint64},
+	{"threads", offsetof(struct rpc_threads_pollers, threads), rpc_decode_threads_pollers_array},
+};
+
+static const struct spdk_json_object_decoder rpc_thread_stats_decoders[] = {
+	{"name", offsetof(struct rpc_thread_stats, name), spdk_json_decode_string},
+	{"busy", offsetof(struct rpc_thread_stats, busy), spdk_json_decode_uint64},
+	{"idle", offsetof(struct rpc_thread_stats, idle), spdk_json_decode_uint64},
+	{"unknown", offsetof(struct rpc_thread_stats, unknown), spdk_json_decode_uint64},
+	{"active_pollers_count", offsetof(struct rpc_thread_stats, active_pollers_count), spdk_json_decode_uint64},
+	{"timed_pollers_count", offsetof(struct rpc_thread_stats, timed_pollers_count), spdk_json_decode_uint64},
+	{"poller_runs", offsetof(struct rpc_thread_stats, poller_runs), spdk_json_decode_uint64},
+	{"poller_run_tsc", offsetof(struct rpc_thread_stats, poller_run_tsc), spdk_json_decode_uint64},
+	{"poller_avg_latency_tsc", offsetof(struct rpc_thread_stats, poller_avg_latency_tsc), spdk_json_decode_uint64},
+};
+
+static int
+rpc_decode_thread_stats(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_thread_stats_decoders,
+				       SPDK_COUNTOF(rpc_thread_stats_decoders), out);
+}
+
+static int
+rpc_decode_threads_stats_array(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_threads_stats *stats = SPDK_CONTAINEROF(out, struct rpc_threads_stats, threads);
+
+	return rpc_decode_alloc_array(val, rpc_decode_thread_stats, (void **)&stats->threads,
+				      &stats->thread_count, sizeof(struct rpc_thread_stats));
+}
+
+static const struct spdk_json_object_decoder rpc_threads_stats_decoders[] = {
+	{"tick_rate", offsetof(struct rpc_threads_stats, tick_rate), spdk_json_decode_uint64},
+	{"threads", offsetof(struct rpc_threads_stats, threads), rpc_decode_threads_stats_array},
+};
+
+static void
+free_thread_pollers(struct rpc_thread_pollers *thread)
+{
+	size_t i;
+
+	for (i = 0; i < thread->poller_count; i++) {
+		free(thread->pollers[i].name);
+	}
+	free(thread->pollers);
+	free(thread->name);
+	memset(thread, 0, sizeof(*thread));
+}
+
+static void
+free_sample(struct top_sample *sample)
+{
+	size_t i;
+
+	for (i = 0; i < sample->stats.thread_count; i++) {
+		free(sample->stats.threads[i].name);
+	}
+	free(sample->stats.threads);
+
+	for (i = 0; i < sample->pollers_count; i++) {
+		free_thread_pollers(&sample->pollers[i]);
+	}
+	free(sample->pollers);
+	free(sample->rows);
+
+	memset(sample, 0, sizeof(*sample));
+}
+
+static int
+rpc_call(struct spdk_jsonrpc_client *client, const char *method, const char *thread_name,
+	 const struct spdk_json_object_decoder *decoders, size_t num_decoders, void *out)
+{
+	struct spdk_jsonrpc_client_request *request;
+	struct spdk_jsonrpc_client_response *resp;
+	struct spdk_json_write_ctx *w;
+	int rc;
+
+	request = spdk_jsonrpc_client_create_request();
+	if (request == NULL) {
+		return -ENOMEM;
+	}
+
+	w = spdk_jsonrpc_begin_request(request, 1, method);
+	if (thread_name != NULL) {
+		spdk_json_write_name(w, "params");
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", thread_name);
+		spdk_json_write_object_end(w);
+	}
+	spdk_jsonrpc_end_request(request, w);
+
+	rc = spdk_jsonrpc_client_send_request(client, request);
+	if (rc != 0) {
+		spdk_jsonrpc_client_free_request(request);
+		return rc;
+	}
+
+	do {
+		rc = spdk_jsonrpc_client_poll(client, 1);
+	} while (rc == 0 || rc == -ENOTCONN);
+
+	if (rc < 0) {
+		return rc;
+	}
+
+	resp = spdk_jsonrpc_client_get_response(client);
+	if (resp == NULL) {
+		return -EIO;
+	}
+
+	rc = 0;
+	if (resp->error != NULL || resp->result == NULL) {
+		rc = -EINVAL;
+	} else if (spdk_json_decode_object(resp->result, decoders, num_decoders, out)) {
+		rc = -EINVAL;
+	}
+
+	spdk_jsonrpc_client_free_response(resp);
+
+	return rc;
+}
+
+static int
+build_rows(struct top_sample *sample)
+{
+	struct rpc_thread_pollers *thread;
+	struct rpc_poller_info *poller;
+	struct poller_row *row;
+	size_t i, j, k, first, max_rows = 0;
+
+	for (i = 0; i < sample->pollers_count; i++) {
+		max_rows += sample->pollers[i].poller_count;
+	}
+
+	sample->rows = calloc(spdk_max(max_rows, 1), sizeof(*sample->rows));
+	if (sample->rows == NULL) {
+		return -ENOMEM;
+	}
+
+	sample->row_count = 0;
+	for (i = 0; i < sample->pollers_count; i++) {
+		thread = &sample->pollers[i];
+		first = sample->row_count;
+
+		for (j = 0; j < thread->poller_count; j++) {
+			poller = &thread->pollers[j];
+
+			for (k = first; k < sample->row_count; k++) {
+				if (strcmp(sample->rows[k].name, poller->name) == 0) {
+					break;
+				}
+			}
+
+			if (k == sample->row_count) {
+				row = &sample->rows[sample->row_count++];
+				row->thread_name = thread->name;
+				row->name = poller->name;
+				row->period_ticks = poller->period_ticks;
+			}
+
+			row = &sample->rows[k];
+			row->instances += poller->count;
+			row->run_count += poller->run_count;
+			row->busy_count += poller->busy_count;
+			row->run_tsc += poller->run_tsc;
+		}
+	}
+
+	return 0;
+}
+
+static struct rpc_thread_stats *
+find_thread_stats(struct top_sample *sample, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sample->stats.thread_count; i++) {
+		if (strcmp(sample->stats.threads[i].name, name) == 0) {
+			return &sample->stats.threads[i];
+		}
+	}
+
+	return NULL;
+}
+
+static struct poller_row *
+find_row(struct top_sample *sample, const char *thread_name, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sample->row_count; i++) {
+		if (strcmp(sample->rows[i].thread_name, thread_name) == 0 &&
+		    strcmp(sample->rows[i].name, name) == 0) {
+			return &sample->rows[i];
+		}
+	}
+
+	return NULL;
+}
+
+static uint64_t
+thread_tsc(const struct rpc_thread_stats *stats)
+{
+	return stats->busy + stats->idle + stats->unknown;
+}
+
+static int
+row_compare(const void *a, const void *b)
+{
+	const struct poller_row *first = a, *second = b;
+
+	if (first->run_tsc_delta > second->run_tsc_delta) {
+		return -1;
+	} else if (first->run_tsc_delta < second->run_tsc_delta) {
+		return 1;
+	}
+
+	return 0;
+}
+
+static double
+percent(uint64_t part, uint64_t total)
+{
+	return total ? 100.0 * part / total : 0.0;
+}
+
+static void
+print_sample(struct top_sample *cur, struct top_sample *prev, int delay)
+{
+	struct rpc_thread_stats *stats, *prev_stats;
+	struct poller_row *row, *prev_row;
+	uint64_t busy, total, runs, tsc;
+	size_t i;
+	int rows;
+
+	printf("\e[1;1H\e[2J");
+	printf("%-24s %7s %8s %8s %14s %15s\n", "Thread", "Busy%", "Active", "Timed",
+	       "Poller runs/s", "Avg poller tsc");
+	printf("================================================================================\n");
+	for (i = 0; i < cur->stats.thread_count; i++) {
+		stats = &cur->stats.threads[i];
+		prev_stats = find_thread_stats(prev, stats->name);
+
+		busy = stats->busy - (prev_stats ? prev_stats->busy : 0);
+		total = thread_tsc(stats) - (prev_stats ? thread_tsc(prev_stats) : 0);
+		runs = stats->poller_runs - (prev_stats ? prev_stats->poller_runs : 0);
+		tsc = stats->poller_run_tsc - (prev_stats ? prev_stats->poller_run_tsc : 0);
+
+		printf("%-24s %7.2f %8" PRIu64 " %8" PRIu64 " %14" PRIu64 " %15" PRIu64 "\n",
+		       stats->name, percent(busy, total), stats->active_pollers_count,
+		       stats->timed_pollers_count, runs / delay, runs ? tsc / runs : 0);
+	}
+
+	for (i = 0; i < cur->row_count; i++) {
+		row = &cur->rows[i];
+		prev_row = find_row(prev, row->thread_name, row->name);
+		stats = find_thread_stats(cur, row->thread_name);
+		prev_stats = find_thread_stats(prev, row->thread_name);
+
+		row->run_tsc_delta = row->run_tsc - (prev_row ? prev_row->run_tsc : 0);
+		row->run_count_delta = row->run_count - (prev_row ? prev_row->run_count : 0);
+		row->busy_count_delta = row->busy_count - (prev_row ? prev_row->busy_count : 0);
+		row->thread_tsc_delta = stats ? thread_tsc(stats) - (prev_stats ? thread_tsc(prev_stats) : 0) : 0;
+	}
+
+	qsort(cur->rows, cur->row_count, sizeof(cur->rows[0]), row_compare);
+
+	printf("\n%-32s %-16s %5s %12s %12s %7s %7s\n", "Poller", "Thread", "Count", "Period(us)",
+	       "Runs/s", "Busy%", "CPU%");
+	printf("================================================================================"
+	       "=============\n");
+	for (i = 0, rows = 0; i < cur->row_count && rows < g_poller_rows; i++, rows++) {
+		row = &cur->rows[i];
+
+		printf("%-32.32s %-16.16s %5u %12" PRIu64 " %12" PRIu64 " %7.2f %7.2f\n",
+		       row->name, row->thread_name, row->instances,
+		       cur->stats.tick_rate ? (uint64_t)(row->period_ticks * SPDK_SEC_TO_USEC / cur->stats.tick_rate) : 0,
+		       row->run_count_delta / delay,
+		       percent(row->busy_count_delta, row->run_count_delta),
+		       percent(row->run_tsc_delta, row->thread_tsc_delta));
+	}
+
+	fflush(stdout);
+}
+
+static int
+get_sample(struct spdk_jsonrpc_client *client, struct top_sample *sample)
+{
+	struct rpc_threads_pollers pollers;
+	const char *name;
+	size_t i;
+	int rc;
+
+	rc = rpc_call(client, "thread_get_stats", NULL, rpc_threads_stats_decoders,
+		      SPDK_COUNTOF(rpc_threads_stats_decoders), &sample->stats);
+	if (rc != 0) {
+		fprintf(stderr, "thread_get_stats failed: %s\n", spdk_strerror(-rc));
+		return rc;
+	}
+
+	sample->pollers = calloc(spdk_max(sample->stats.thread_count, 1), sizeof(*sample->pollers));
+	if (sample->pollers == NULL) {
+		return -ENOMEM;
+	}
+
+	/*
+	 * Request the pollers of one thread at a time, so that the size of each response
+	 *  does not depend on the number of threads.
+	 */
+	for (i = 0; i < sample->stats.thread_count; i++) {
+		name = sample->stats.threads[i].name;
+
+		memset(&pollers, 0, sizeof(pollers));
+		rc = rpc_call(client, "thread_get_pollers", name, rpc_threads_pollers_decoders,
+			      SPDK_COUNTOF(rpc_threads_pollers_decoders), &pollers);
+		if (rc == 0 && pollers.thread_count > 0) {
+			/* The thread may have exited since thread_get_stats. */
+			sample->pollers[sample->pollers_count++] = pollers.threads[0];
+			pollers.threads[0] = (struct rpc_thread_pollers) {};
+		}
+
+		while (pollers.thread_count > 0) {
+			free_thread_pollers(&pollers.threads[--pollers.thread_count]);
+		}
+		free(pollers.threads);
+
+		if (rc != 0) {
+			fprintf(stderr, "thread_get_pollers for thread %s failed: %s\n", name, spdk_strerror(-rc));
+			return rc;
+		}
+	}
+
+	return build_rows(sample);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage:\n");
+	fprintf(stderr, "   %s <options>\n", exe_name);
+	fprintf(stderr, "        -r <path>   RPC server address (default: %s)\n", SPDK_DEFAULT_RPC_ADDR);
+	fprintf(stderr, "        -n <rows>   number of pollers to show (default: %d)\n",
+		DEFAULT_POLLER_ROWS);
+}
+
+int main(int argc, char **argv)
+{
+	struct spdk_jsonrpc_client	*client;
+	struct top_sample		*cur, *prev, *tmp;
+	struct termios			oldt, newt;
+	struct timeval			timeout;
+	fd_set				fds;
+	int				delay, old_delay, op, rc, quit;
+	char				ch;
+
+	exe_name = argv[0];
+	while ((op = getopt(argc, argv, "n:r:")) != -1) {
+		switch (op) {
+		case 'n':
+			g_poller_rows = spdk_strtol(optarg, 10);
+			if (g_poller_rows < 0) {
+				usage();
+				exit(1);
+			}
+			break;
+		case 'r':
+			g_rpc_addr = optarg;
+			break;
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
+	client = spdk_jsonrpc_client_connect(g_rpc_addr, g_rpc_addr[0] == '/' ? AF_UNIX : AF_INET);
+	if (client == NULL) {
+		fprintf(stderr, "Unable to connect to %s: %s\n", g_rpc_addr, spdk_strerror(errno));
+		exit(1);
+	}
+
+	cur = calloc(1, sizeof(*cur));
+	prev = calloc(1, sizeof(*prev));
+	if (cur == NULL || prev == NULL) {
+		fprintf(stderr, "Unable to allocate memory\n");
+		free(cur);
+		free(prev);
+		spdk_jsonrpc_client_close(client);
+		exit(1);
+	}
+
+	if (get_sample(client, prev) != 0) {
+		goto cleanup_client;
+	}
+
+	delay = 1;
+	quit = 0;
+
+	tcgetattr(0, &oldt);
+	newt = oldt;
+	newt.c_lflag &= ~(ICANON);
+	tcsetattr(0, TCSANOW, &newt);
+
+	while (1) {
+		FD_ZERO(&fds);
+		FD_SET(0, &fds);
+		timeout.tv_sec = delay;
+		timeout.tv_usec = 0;
+		rc = select(2, &fds, NULL, NULL, &timeout);
+
+		if (rc > 0) {
+			if (read(0, &ch, 1) != 1) {
+				fprintf(stderr, "Read error on stdin\n");
+				goto cleanup;
+			}
+
+			printf("\b");
+			switch (ch) {
+			case 'd':
+				printf("Enter num seconds to delay (1-10): ");
+				old_delay = delay;
+				rc = scanf("%d", &delay);
+				if (rc != 1) {
+					fprintf(stderr, "Illegal delay value\n");
+					delay = old_delay;
+				} else if (delay < 1 || delay > 10) {
+					delay = 1;
+				}
+				break;
+			case 'q':
+				quit = 1;
+				break;
+			default:
+				fprintf(stderr, "'%c' not recognized\n", ch);
+				break;
+			}
+
+			if (quit == 1) {
+				break;
+			}
+		}
+
+		if (get_sample(client, cur) != 0) {
+			break;
+		}
+
+		print_sample(cur, prev, delay);
+
+		free_sample(prev);
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+
+cleanup:
+	tcsetattr(0, TCSANOW, &oldt);
+
+cleanup_client:
+	free_sample(cur);
+	free_sample(prev);
+	free(cur);
+	free(prev);
+	spdk_jsonrpc_client_close(client);
+
+	return 0;
+}
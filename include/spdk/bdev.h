@@ -54,6 +54,11 @@ extern "C" {
 #define SPDK_BDEV_SMALL_BUF_MAX_SIZE 8192
 #define SPDK_BDEV_LARGE_BUF_MAX_SIZE (64 * 1024)
 
+/* Number of data buffer size classes, see spdk_bdev_get_buf_class_size(). */
+#define SPDK_BDEV_BUF_NUM_CLASSES 7
+/* Size of the largest data buffer class. */
+#define SPDK_BDEV_BUF_MAX_SIZE (1024 * 1024)
+
 /* Increase the buffer size to store interleaved metadata.  Increment is the
  *  amount necessary to store metadata per data block.  16 byte metadata per
  *  512 byte data block is the current maximum ratio of metadata per block.
@@ -151,13 +156,41 @@ struct spdk_bdev_io_stat {
 	uint64_t write_latency_ticks;
 	uint64_t unmap_latency_ticks;
 	uint64_t ticks_rate;
+	/** Data buffers taken from a NUMA node other than the submitting thread's. */
+	uint64_t num_remote_thread_bufs;
+	/** Data buffers taken from a NUMA node other than the bdev's. */
+	uint64_t num_remote_bdev_bufs;
+	/** I/O that had to wait for a data buffer. */
+	uint64_t num_buf_waits;
+	/** Total ticks I/O spent waiting for a data buffer. */
+	uint64_t buf_wait_ticks;
 };
 
 struct spdk_bdev_opts {
 	uint32_t bdev_io_pool_size;
 	uint32_t bdev_io_cache_size;
+
+	/**
+	 * Number of data buffers in each size class, split evenly between NUMA nodes.
+	 * A class with no buffers is disabled and its requests are served by the next
+	 * larger class.  At least one class must be enabled.
+	 */
+	uint32_t buf_class_count[SPDK_BDEV_BUF_NUM_CLASSES];
+
+	/** Maximum number of data buffers of each size class cached per thread. */
+	uint32_t buf_cache_size;
 };
 
+/**
+ * Get the size of the data buffers in a given size class.
+ *
+ * Classes are ordered by size, from 4 KiB up to SPDK_BDEV_BUF_MAX_SIZE.
+ *
+ * \param buf_class Size class, lower than SPDK_BDEV_BUF_NUM_CLASSES.
+ * \return Size in bytes of the data buffers of the class, or 0 if buf_class is invalid.
+ */
+uint32_t spdk_bdev_get_buf_class_size(uint32_t buf_class);
+
 void spdk_bdev_get_opts(struct spdk_bdev_opts *opts);
 
 int spdk_bdev_set_opts(struct spdk_bdev_opts *opts);
@@ -390,6 +423,18 @@ size_t spdk_bdev_get_buf_align(const struct spdk_bdev *bdev);
  */
 uint32_t spdk_bdev_get_optimal_io_boundary(const struct spdk_bdev *bdev);
 
+/**
+ * Get the NUMA node a bdev is attached to.
+ *
+ * Applications can use this to run the threads submitting I/O to the bdev,
+ * and thus the data buffers allocated for that I/O, on the same node.
+ *
+ * \param bdev Block device to query.
+ * \return NUMA node (socket) ID of the bdev, or SPDK_ENV_SOCKET_ID_ANY (-1) if the
+ *         bdev is not local to any particular node.
+ */
+int spdk_bdev_get_numa_id(const struct spdk_bdev *bdev);
+
 /**
  * Query whether block device has an enabled write cache.
  *
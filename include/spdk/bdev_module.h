@@ -325,6 +325,18 @@ struct spdk_bdev {
 	 */
 	uint32_t dif_check_flags;
 
+	/**
+	 * NUMA node the backing device is attached to.
+	 *
+	 * Set enabled to true and fill in id if the device is local to a
+	 * particular node, e.g. the socket of its PCI device.  The bdev layer
+	 * reports SPDK_ENV_SOCKET_ID_ANY for bdevs that leave it disabled.
+	 */
+	struct {
+		bool enabled;
+		uint32_t id;
+	} numa;
+
 	/**
 	 * Pointer to the bdev module that registered this bdev.
 	 */
@@ -536,6 +548,15 @@ struct spdk_bdev_io {
 		/** requested size of the buffer associated with this I/O */
 		uint64_t buf_len;
 
+		/** NUMA node of the pool buf was taken from */
+		uint32_t buf_numa_id;
+
+		/** Size class of buf */
+		uint32_t buf_class;
+
+		/** Time the I/O was queued waiting for a buffer */
+		uint64_t buf_wait_tsc;
+
 		/** if the request is double buffered, store original request iovs here */
 		struct iovec  bounce_iov;
 		struct iovec *orig_iovs;
@@ -716,7 +737,7 @@ const struct spdk_bdev_aliases_list *spdk_bdev_get_aliases(const struct spdk_bde
  * or the bdev_io has an SGL assigned already.
  * \param len size of the buffer to allocate. In case the bdev_io
  * doesn't have an SGL assigned this field must be no bigger than
- * \c SPDK_BDEV_LARGE_BUF_MAX_SIZE.
+ * the largest enabled buffer size class, \c SPDK_BDEV_BUF_MAX_SIZE by default.
  */
 void spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len);
 
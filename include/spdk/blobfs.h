@@ -62,6 +62,17 @@ struct spdk_file_stat {
 	uint64_t	size;
 };
 
+/**
+ * One range of a spdk_file_read_multi() call.
+ */
+struct spdk_file_read_req {
+	void		*payload;
+	uint64_t	offset;
+	uint64_t	length;
+	/* Number of bytes read on success, negated errno on failure. Set by the read. */
+	int64_t		rc;
+};
+
 /**
  * Filesystem operation completion callback with handle.
  *
@@ -185,6 +196,30 @@ struct spdk_io_channel *spdk_fs_alloc_io_channel(struct spdk_filesystem *fs);
  */
 struct spdk_io_channel *spdk_fs_alloc_io_channel_sync(struct spdk_filesystem *fs);
 
+/**
+ * Allocate an I/O channel for synchronous operations that the calling thread
+ * polls itself.
+ *
+ * The calling thread must have an SPDK thread set with spdk_set_thread(). While
+ * a synchronous call on the channel waits for completion, the caller polls that
+ * thread instead of sleeping. Reads that miss the cache are then submitted on
+ * the caller's own blobstore channel rather than being forwarded to the thread
+ * passed to spdk_fs_init() or spdk_fs_load(), so reads issued by different
+ * threads run in parallel. Reads of a file which is open for writing, or which
+ * has data not flushed to disk yet, are still forwarded, as are writes and
+ * metadata operations.
+ *
+ * The channel may only be used, and must be freed with spdk_fs_free_io_channel(),
+ * on the thread that allocated it. Nothing else polls that thread, so it must
+ * not be used for other SPDK work which expects to be polled in the meantime.
+ * Each thread allocates its own channel.
+ *
+ * \param fs Blobstore filesystem to allocate I/O channel.
+ *
+ * \return a pointer to the I/O channel on success or NULL otherwise.
+ */
+struct spdk_io_channel *spdk_fs_alloc_io_channel_sync_polled(struct spdk_filesystem *fs);
+
 /**
  * Free I/O channel.
  *
@@ -353,6 +388,38 @@ int spdk_file_write(struct spdk_file *file, struct spdk_io_channel *channel,
 int64_t spdk_file_read(struct spdk_file *file, struct spdk_io_channel *channel,
 		       void *payload, uint64_t offset, uint64_t length);
 
+/**
+ * Read several ranges of the given file.
+ *
+ * All ranges are submitted before waiting for any of them to complete, so reads
+ * that miss the cache are in flight concurrently.
+ *
+ * \param file File to read.
+ * \param channel The I/O channel used to allocate file request.
+ * \param reqs Array of ranges to read. On return, the rc field of each entry holds
+ * the number of bytes read for that range or a negated errno.
+ * \param num_reqs Number of entries in reqs.
+ *
+ * \return 0 on success, the first negated errno of any range on failure.
+ */
+int spdk_file_read_multi(struct spdk_file *file, struct spdk_io_channel *channel,
+			 struct spdk_file_read_req *reqs, uint32_t num_reqs);
+
+/**
+ * Start reading the given range of a file into the cache without waiting for
+ * it to complete.
+ *
+ * At most the largest readahead window (16 cache buffers), and at most a quarter
+ * of the cache, is read from the beginning of the range.
+ *
+ * \param file File to prefetch.
+ * \param offset The beginning position of the range.
+ * \param length The size in bytes of the range.
+ *
+ * \return 0 on success, negated errno on failure.
+ */
+int spdk_file_prefetch(struct spdk_file *file, uint64_t offset, uint64_t length);
+
 /**
  * Set cache size for the blobstore filesystem.
  *
@@ -367,17 +434,60 @@ void spdk_fs_set_cache_size(uint64_t size_in_mb);
  */
 uint64_t spdk_fs_get_cache_size(void);
 
-#define SPDK_FILE_PRIORITY_LOW	0 /* default */
-#define SPDK_FILE_PRIORITY_HIGH	1
+#define SPDK_FILE_PRIORITY_LOW		0 /* default */
+#define SPDK_FILE_PRIORITY_HIGH		1
+#define SPDK_FILE_PRIORITY_PINNED	2
 
 /**
  * Set priority for the file.
  *
+ * The cache evicts the least recently used buffers of low priority files first,
+ * then those of high priority files. Buffers of pinned files are only evicted
+ * when no other buffer can be. Buffers of low priority files are also dropped
+ * as soon as they have been read completely.
+ *
  * \param file File to set priority.
- * \param priority Priority level (SPDK_FILE_PRIORITY_LOW or SPDK_FILE_PRIORITY_HIGH).
+ * \param priority Priority level (SPDK_FILE_PRIORITY_LOW, SPDK_FILE_PRIORITY_HIGH
+ * or SPDK_FILE_PRIORITY_PINNED).
  */
 void spdk_file_set_priority(struct spdk_file *file, uint32_t priority);
 
+struct spdk_file_cache_stat {
+	/* Number of cache buffers currently holding data of the file */
+	uint64_t	cached_buffers;
+	/* Number of reads served from the cache */
+	uint64_t	hits;
+	/* Number of reads that had to go to the blobstore */
+	uint64_t	misses;
+};
+
+/**
+ * Get the cache statistics of the given file.
+ *
+ * \param file File to query.
+ * \param stat Filled in with the statistics of the file.
+ */
+void spdk_file_get_cache_stat(struct spdk_file *file, struct spdk_file_cache_stat *stat);
+
+struct spdk_fs_cache_stat {
+	/* Size of a cache buffer in bytes */
+	uint64_t	buffer_size;
+	uint64_t	total_buffers;
+	uint64_t	free_buffers;
+	/* Cached buffers per priority class, indexed by SPDK_FILE_PRIORITY_* */
+	uint64_t	class_buffers[SPDK_FILE_PRIORITY_PINNED + 1];
+	uint64_t	evictions;
+	uint64_t	hits;
+	uint64_t	misses;
+};
+
+/**
+ * Get the statistics of the cache shared by all filesystems.
+ *
+ * \param stat Filled in with the statistics of the cache.
+ */
+void spdk_fs_get_cache_stat(struct spdk_fs_cache_stat *stat);
+
 /**
  * Synchronize the data from the cache to the disk.
  *
@@ -41,6 +41,7 @@
 #include "spdk/thread.h"
 
 struct spdk_ftl_dev;
+struct spdk_bdev_desc;
 
 /* Limit thresholds */
 enum {
@@ -59,6 +60,17 @@ struct spdk_ftl_limit {
 	size_t					limit;
 };
 
+/* Write streams - data from different streams is placed in separate bands */
+enum spdk_ftl_stream {
+	/* User data expected to be overwritten soon (default) */
+	SPDK_FTL_STREAM_USER_HOT,
+	/* User data expected to stay valid for a long time */
+	SPDK_FTL_STREAM_USER_COLD,
+	/* Data moved by defrag */
+	SPDK_FTL_STREAM_GC,
+	SPDK_FTL_STREAM_MAX
+};
+
 struct spdk_ftl_conf {
 	/* Number of reserved addresses not exposed to the user */
 	size_t					lba_rsvd;
@@ -78,6 +90,15 @@ struct spdk_ftl_conf {
 	/* IO pool size per user thread */
 	size_t					user_io_pool_size;
 
+	/* Amount of memory (in bytes) used for the L2P table. If the table is */
+	/* larger, it's paged in and out of the device on demand. Zero keeps the */
+	/* whole table in memory. Only supported on emulated devices. */
+	size_t					l2p_cache_size;
+
+	/* Keep a separate write pointer (and open band) for each of the write */
+	/* streams. When disabled, all writes share the same band. */
+	bool					stream_placement;
+
 	struct {
 		/* Lowest percentage of invalid lbks for a band to be defragged */
 		size_t				invalid_thld;
@@ -103,6 +124,9 @@ struct spdk_ftl_dev_init_opts {
 	struct spdk_nvme_ctrlr			*ctrlr;
 	/* Controller's transport ID */
 	struct spdk_nvme_transport_id		trid;
+	/* Regular bdev to emulate an Open-Channel device on (used instead of ctrlr). */
+	/* The parallel unit range's end determines the number of emulated punits. */
+	struct spdk_bdev_desc			*base_bdev_desc;
 
 	/* Thread responsible for core tasks execution */
 	struct spdk_thread			*core_thread;
@@ -132,6 +156,18 @@ struct spdk_ftl_attrs {
 	size_t					lbk_size;
 };
 
+struct spdk_ftl_stream_stats {
+	/* Number of user blocks written */
+	uint64_t				write_user;
+	/* Total number of blocks written, including relocating the stream's data */
+	uint64_t				write_total;
+};
+
+struct spdk_ftl_stats {
+	/* Per-stream write counters */
+	struct spdk_ftl_stream_stats		stream[SPDK_FTL_STREAM_MAX];
+};
+
 struct ftl_module_init_opts {
 	/* Thread on which to poll for ANM events */
 	struct spdk_thread			*anm_thread;
@@ -167,6 +203,11 @@ int spdk_ftl_module_fini(spdk_ftl_fn cb, void *cb_arg);
 /**
  * Initialize the FTL on given NVMe device and parallel unit range.
  *
+ * Instead of an Open-Channel NVMe device, the FTL can also be placed on top of
+ * any bdev (e.g. malloc or regular NVMe) by providing its descriptor in
+ * opts->base_bdev_desc. In that case the Open-Channel geometry, chunk states
+ * and write pointer rules are emulated in software.
+ *
  * Covers the following:
  * - initialize and register NVMe ctrlr,
  * - retrieve geometry and check if the device has proper configuration,
@@ -209,6 +250,14 @@ void spdk_ftl_conf_init_defaults(struct spdk_ftl_conf *conf);
  */
 void  spdk_ftl_dev_get_attrs(const struct spdk_ftl_dev *dev, struct spdk_ftl_attrs *attr);
 
+/**
+ * Retrieve device's write statistics.
+ *
+ * \param dev device
+ * \param stats Output (statistics) of the device
+ */
+void spdk_ftl_dev_get_stats(const struct spdk_ftl_dev *dev, struct spdk_ftl_stats *stats);
+
 /**
  * Submits a read to the specified device.
  *
@@ -245,6 +294,26 @@ int spdk_ftl_write(struct spdk_ftl_dev *dev, struct spdk_io_channel *ch, uint64_
 		   size_t lba_cnt,
 		   struct iovec *iov, size_t iov_cnt, spdk_ftl_fn cb_fn, void *cb_arg);
 
+/**
+ * Submits a write to the specified device, hinting at the expected lifetime of
+ * the data. The hint is ignored if the device doesn't have stream placement enabled.
+ *
+ * \param dev Device
+ * \param ch I/O channel
+ * \param lba Starting LBA to write the data
+ * \param lba_cnt Number of sectors to write
+ * \param iov Single IO vector or pointer to IO vector table
+ * \param iov_cnt Number of IO vectors
+ * \param stream Write stream (SPDK_FTL_STREAM_USER_HOT or SPDK_FTL_STREAM_USER_COLD)
+ * \param cb_fn Callback function to invoke when the I/O is completed
+ * \param cb_arg Argument to pass to the callback function
+ *
+ * \return 0 if successfully submitted, negative errno otherwise.
+ */
+int spdk_ftl_write_stream(struct spdk_ftl_dev *dev, struct spdk_io_channel *ch, uint64_t lba,
+			  size_t lba_cnt, struct iovec *iov, size_t iov_cnt,
+			  enum spdk_ftl_stream stream, spdk_ftl_fn cb_fn, void *cb_arg);
+
 /**
  * Submits a flush request to the specified device.
  *
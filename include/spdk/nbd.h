@@ -77,6 +77,25 @@ typedef void (*spdk_nbd_start_cb)(void *cb_arg, struct spdk_nbd_disk *nbd,
 void spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 		    spdk_nbd_start_cb cb_fn, void *cb_arg);
 
+/**
+ * Start a network block device backed by the bdev and served over multiple
+ * sockets.
+ *
+ * The kernel spreads requests over all connections, which are then processed
+ * in parallel. If the kernel does not support multiple connections per device
+ * the device is served over the connections it accepted. If SPDK is built
+ * against kernel headers without NBD_FLAG_CAN_MULTI_CONN, more than one
+ * connection fails with -ENOTSUP.
+ *
+ * \param bdev_name Name of bdev exposed as a network block device.
+ * \param nbd_path Path to the registered network block device.
+ * \param num_connections Number of sockets to serve the device over.
+ * \param cb_fn Callback to be always called.
+ * \param cb_arg Passed to cb_fn.
+ */
+void spdk_nbd_start_ext(const char *bdev_name, const char *nbd_path, uint32_t num_connections,
+			spdk_nbd_start_cb cb_fn, void *cb_arg);
+
 /**
  * Stop the running network block device safely.
  *
@@ -676,6 +676,9 @@ enum spdk_nvme_media_error_status_code {
  */
 enum spdk_nvme_path_status_code {
 	SPDK_NVME_SC_INTERNAL_PATH_ERROR		= 0x00,
+	SPDK_NVME_SC_ASYMMETRIC_ACCESS_PERSISTENT_LOSS	= 0x01,
+	SPDK_NVME_SC_ASYMMETRIC_ACCESS_INACCESSIBLE	= 0x02,
+	SPDK_NVME_SC_ASYMMETRIC_ACCESS_TRANSITION	= 0x03,
 
 	SPDK_NVME_SC_CONTROLLER_PATH_ERROR		= 0x60,
 
@@ -964,7 +967,8 @@ struct __attribute__((packed)) spdk_nvme_ctrlr_data {
 		uint8_t multi_port	: 1;
 		uint8_t multi_host	: 1;
 		uint8_t sr_iov		: 1;
-		uint8_t reserved	: 5;
+		uint8_t ana_reporting	: 1;
+		uint8_t reserved	: 4;
 	} cmic;
 
 	/** maximum data transfer size */
@@ -992,7 +996,12 @@ struct __attribute__((packed)) spdk_nvme_ctrlr_data {
 		/** Supports sending Firmware Activation Notices. */
 		uint32_t	fw_activation_notices : 1;
 
-		uint32_t	reserved2 : 22;
+		uint32_t	reserved2 : 1;
+
+		/** Supports Asymmetric Namespace Access Change Notices. */
+		uint32_t	ana_change_notices : 1;
+
+		uint32_t	reserved3 : 20;
 	} oaes;
 
 	/** controller attributes */
@@ -1192,7 +1201,47 @@ struct __attribute__((packed)) spdk_nvme_ctrlr_data {
 		} bits;
 	} sanicap;
 
-	uint8_t			reserved3[180];
+	uint8_t			reserved332[10];
+
+	/** ANA transition time (in seconds) */
+	uint8_t			anatt;
+
+	/** Asymmetric namespace access capabilities */
+	union {
+		uint8_t		raw;
+		struct {
+			/** Reports ANA optimized state */
+			uint8_t	ana_optimized_state : 1;
+
+			/** Reports ANA non-optimized state */
+			uint8_t	ana_non_optimized_state : 1;
+
+			/** Reports ANA inaccessible state */
+			uint8_t	ana_inaccessible_state : 1;
+
+			/** Reports ANA persistent loss state */
+			uint8_t	ana_persistent_loss_state : 1;
+
+			/** Reports ANA change state */
+			uint8_t	ana_change_state : 1;
+
+			uint8_t	reserved : 1;
+
+			/** ANAGRPID field in the Identify Namespace does not change */
+			uint8_t	no_change_anagrpid : 1;
+
+			/** Non-zero ANAGRPID field in the Identify Namespace is supported */
+			uint8_t	non_zero_anagrpid : 1;
+		} bits;
+	} anacap;
+
+	/** ANA group identifier maximum */
+	uint32_t		anagrpmax;
+
+	/** Number of ANA group identifiers */
+	uint32_t		nanagrpid;
+
+	uint8_t			reserved352[160];
 
 	/* bytes 512-703: nvm command set attributes */
 
@@ -1273,7 +1322,10 @@ struct __attribute__((packed)) spdk_nvme_ctrlr_data {
 		uint32_t	reserved2 : 10;
 	} sgls;
 
-	uint8_t			reserved4[228];
+	/** maximum number of allowed namespaces */
+	uint32_t		mnan;
+
+	uint8_t			reserved4[224];
 
 	uint8_t			subnqn[256];
 
@@ -1554,7 +1606,12 @@ struct spdk_nvme_ns_data {
 	/** NVM capacity */
 	uint64_t		nvmcap[2];
 
-	uint8_t			reserved64[40];
+	uint8_t			reserved64[28];
+
+	/** ANA group identifier */
+	uint32_t		anagrpid;
+
+	uint8_t			reserved96[8];
 
 	/** namespace globally unique identifier */
 	uint8_t			nguid[16];
@@ -1798,7 +1855,12 @@ enum spdk_nvme_log_page {
 	/** Controller initiated telemetry log (optional) */
 	SPDK_NVME_LOG_TELEMETRY_CTRLR_INITIATED	= 0x08,
 
-	/* 0x09-0x6F - reserved */
+	/* 0x09-0x0B - reserved */
+
+	/** Asymmetric namespace access log (optional) - \ref spdk_nvme_ana_page */
+	SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS	= 0x0C,
+
+	/* 0x0D-0x6F - reserved */
 
 	/** Discovery(refer to the NVMe over Fabrics specification) */
 	SPDK_NVME_LOG_DISCOVERY		= 0x70,
@@ -2010,8 +2072,10 @@ enum spdk_nvme_async_event_info_notice {
 	SPDK_NVME_ASYNC_EVENT_FW_ACTIVATION_START	= 0x1,
 	/* Telemetry Log Changed */
 	SPDK_NVME_ASYNC_EVENT_TELEMETRY_LOG_CHANGED	= 0x2,
+	/* Asymmetric Namespace Access Change */
+	SPDK_NVME_ASYNC_EVENT_ANA_CHANGE		= 0x3,
 
-	/* 0x3 - 0xFF Reserved */
+	/* 0x4 - 0xFF Reserved */
 };
 
 /**
@@ -2220,7 +2284,8 @@ union spdk_nvme_feat_async_event_configuration {
 		uint32_t ns_attr_notice		: 1;
 		uint32_t fw_activation_notice	: 1;
 		uint32_t telemetry_log_notice	: 1;
-		uint32_t reserved		: 21;
+		uint32_t ana_change_notice	: 1;
+		uint32_t reserved		: 20;
 	} bits;
 };
 SPDK_STATIC_ASSERT(sizeof(union spdk_nvme_feat_async_event_configuration) == 4, "Incorrect size");
@@ -2347,6 +2412,60 @@ struct spdk_nvme_firmware_page {
 };
 SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_firmware_page) == 512, "Incorrect size");
 
+/**
+ * Asymmetric Namespace Access states
+ */
+enum spdk_nvme_ana_state {
+	SPDK_NVME_ANA_OPTIMIZED_STATE		= 0x1,
+	SPDK_NVME_ANA_NON_OPTIMIZED_STATE	= 0x2,
+	SPDK_NVME_ANA_INACCESSIBLE_STATE	= 0x3,
+	SPDK_NVME_ANA_PERSISTENT_LOSS_STATE	= 0x4,
+	SPDK_NVME_ANA_CHANGE_STATE		= 0xF,
+};
+
+/**
+ * ANA group descriptor (part of \ref spdk_nvme_ana_page)
+ */
+struct spdk_nvme_ana_group_descriptor {
+	/** ANA group identifier */
+	uint32_t		ana_group_id;
+
+	/** Number of NSID values in this descriptor */
+	uint32_t		num_of_nsid;
+
+	/** Change count */
+	uint64_t		change_count;
+
+	/** ANA state (\ref spdk_nvme_ana_state) */
+	uint8_t			ana_state : 4;
+	uint8_t			reserved0 : 4;
+
+	uint8_t			reserved1[15];
+
+	/** Namespace identifiers that are members of this ANA group */
+	uint32_t		nsid[];
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_ana_group_descriptor) == 32, "Incorrect size");
+
+/**
+ * Asymmetric namespace access page header (\ref SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS)
+ *
+ * The header is followed by num_ana_group_desc ANA group descriptors.
+ */
+struct spdk_nvme_ana_page {
+	/** Change count */
+	uint64_t		change_count;
+
+	/** Number of ANA group descriptors */
+	uint16_t		num_ana_group_desc;
+
+	uint8_t			reserved[6];
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_ana_page) == 16, "Incorrect size");
+
+/* Return ANA group descriptors only (no NSID lists) - log specific field of Get Log Page */
+#define SPDK_NVME_ANA_LOG_RGO	(1u << 0)
+
 /**
  * Namespace attachment Type Encoding
  */
@@ -72,6 +72,7 @@ struct spdk_nvmf_transport_opts {
 	uint32_t max_aq_depth;
 	uint32_t num_shared_buffers;
 	uint32_t buf_cache_size;
+	uint32_t max_reqs;
 };
 
 /**
@@ -512,6 +513,83 @@ struct spdk_nvmf_listener *spdk_nvmf_subsystem_get_next_listener(
 const struct spdk_nvme_transport_id *spdk_nvmf_listener_get_trid(
 	struct spdk_nvmf_listener *listener);
 
+/**
+ * Enable or disable Asymmetric Namespace Access (ANA) reporting for a subsystem.
+ *
+ * Each namespace of the subsystem forms its own ANA group, whose ANA group
+ * identifier is equal to the namespace ID.
+ *
+ * May only be performed on subsystems in the INACTIVE state.
+ *
+ * \param subsystem Subsystem to modify.
+ * \param ana_reporting true to report ANA state to hosts, false otherwise.
+ *
+ * \return 0 on success, or negated errno value on failure.
+ */
+int spdk_nvmf_subsystem_set_ana_reporting(struct spdk_nvmf_subsystem *subsystem,
+		bool ana_reporting);
+
+/**
+ * Check whether a subsystem reports Asymmetric Namespace Access state.
+ *
+ * \param subsystem Subsystem to query.
+ *
+ * \return true if ANA reporting is enabled, false otherwise.
+ */
+bool spdk_nvmf_subsystem_get_ana_reporting(const struct spdk_nvmf_subsystem *subsystem);
+
+/**
+ * Set the ANA state of one or all ANA groups as seen through a listen address.
+ *
+ * Controllers that connected through this listen address are notified of the
+ * change with an Asymmetric Namespace Access Change asynchronous event.
+ *
+ * May only be performed on subsystems in the PAUSED or INACTIVE states.
+ *
+ * \param subsystem Subsystem to modify.
+ * \param trid The listen address.
+ * \param ana_state New ANA state.
+ * \param anagrpid ANA group identifier (namespace ID) to change, or 0 to change all groups.
+ *
+ * \return 0 on success, or negated errno value on failure.
+ */
+int spdk_nvmf_subsystem_set_ana_state(struct spdk_nvmf_subsystem *subsystem,
+				      const struct spdk_nvme_transport_id *trid,
+				      enum spdk_nvme_ana_state ana_state,
+				      uint32_t anagrpid);
+
+/**
+ * Get the ANA state of an ANA group as seen through a listen address.
+ *
+ * \param listener This listener.
+ * \param anagrpid ANA group identifier (namespace ID).
+ *
+ * \return the ANA state of the group.
+ */
+enum spdk_nvme_ana_state spdk_nvmf_listener_get_ana_state(struct spdk_nvmf_listener *listener,
+		uint32_t anagrpid);
+
+/**
+ * Get the string representation of an ANA state.
+ *
+ * \param ana_state ANA state.
+ *
+ * \return the string representation (e.g. "optimized"), or NULL if the ANA state
+ * is not valid.
+ */
+const char *spdk_nvmf_ana_state_str(enum spdk_nvme_ana_state ana_state);
+
+/**
+ * Parse the string representation of an ANA state.
+ *
+ * \param ana_state Output ANA state (allocated by caller).
+ * \param str Input string representation of the ANA state (e.g. "optimized").
+ *
+ * \return 0 if parsing was successful and ana_state is filled out, or negated
+ * errno values on failure.
+ */
+int spdk_nvmf_ana_state_parse(enum spdk_nvme_ana_state *ana_state, const char *str);
+
 /** NVMe-oF target namespace creation options */
 struct spdk_nvmf_ns_opts {
 	/**
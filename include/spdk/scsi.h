@@ -100,6 +100,15 @@ struct spdk_scsi_task {
 	uint8_t				response; /* task mgmt response */
 
 	struct spdk_scsi_lun		*lun;
+
+	/**
+	 * Descriptor of the LUN the task is submitted through. The I/O channel
+	 *  allocated for it by spdk_scsi_lun_allocate_io_channel() is used for the
+	 *  task. If NULL, the channel from spdk_scsi_dev_allocate_io_channels() is
+	 *  used.
+	 */
+	struct spdk_scsi_desc		*desc;
+
 	struct spdk_scsi_port		*target_port;
 	struct spdk_scsi_port		*initiator_port;
 
@@ -299,6 +308,9 @@ struct spdk_scsi_port *spdk_scsi_dev_find_port_by_id(struct spdk_scsi_dev *dev,
 /**
  * Allocate I/O channels for all LUNs of the given SCSI device.
  *
+ * The channels are used by tasks without a descriptor, which must all be
+ * submitted on the calling thread.
+ *
  * \param dev SCSI device.
  *
  * \return 0 on success, -1 on failure.
@@ -505,6 +517,9 @@ void spdk_scsi_lun_close(struct spdk_scsi_desc *desc);
 /**
  * Allocate I/O channel for the LUN
  *
+ * The channel is used by the tasks which have the descriptor set, and which
+ * must be submitted on the calling thread.
+ *
  * \param desc Descriptor of the logical unit.
  *
  * \return 0 on success, -1 on failure.
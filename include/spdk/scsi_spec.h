@@ -90,6 +90,7 @@ enum spdk_scsi_asc {
 	SPDK_SCSI_ASC_PERIPHERAL_DEVICE_WRITE_FAULT = 0x03,
 	SPDK_SCSI_ASC_LOGICAL_UNIT_NOT_READY = 0x04,
 	SPDK_SCSI_ASC_WARNING = 0x0b,
+	SPDK_SCSI_ASC_COPY_TARGET_DEVICE_ERROR = 0x0d,
 	SPDK_SCSI_ASC_LOGICAL_BLOCK_GUARD_CHECK_FAILED = 0x10,
 	SPDK_SCSI_ASC_LOGICAL_BLOCK_APP_TAG_CHECK_FAILED = 0x10,
 	SPDK_SCSI_ASC_LOGICAL_BLOCK_REF_TAG_CHECK_FAILED = 0x10,
@@ -100,6 +101,7 @@ enum spdk_scsi_asc {
 	SPDK_SCSI_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE = 0x21,
 	SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB = 0x24,
 	SPDK_SCSI_ASC_LOGICAL_UNIT_NOT_SUPPORTED = 0x25,
+	SPDK_SCSI_ASC_INVALID_FIELD_IN_PARAMETER_LIST = 0x26,
 	SPDK_SCSI_ASC_WRITE_PROTECTED = 0x27,
 	SPDK_SCSI_ASC_FORMAT_COMMAND_FAILED = 0x31,
 	SPDK_SCSI_ASC_SAVING_PARAMETERS_NOT_SUPPORTED = 0x39,
@@ -114,6 +116,10 @@ enum spdk_scsi_ascq {
 	SPDK_SCSI_ASCQ_LOGICAL_BLOCK_APP_TAG_CHECK_FAILED = 0x02,
 	SPDK_SCSI_ASCQ_NO_ACCESS_RIGHTS = 0x02,
 	SPDK_SCSI_ASCQ_LOGICAL_BLOCK_REF_TAG_CHECK_FAILED = 0x03,
+	SPDK_SCSI_ASCQ_THIRD_PARTY_DEVICE_FAILURE = 0x01,
+	SPDK_SCSI_ASCQ_COPY_TARGET_DEVICE_NOT_REACHABLE = 0x02,
+	SPDK_SCSI_ASCQ_UNSUPPORTED_TARGET_DESCRIPTOR_TYPE_CODE = 0x07,
+	SPDK_SCSI_ASCQ_UNSUPPORTED_SEGMENT_DESCRIPTOR_TYPE_CODE = 0x09,
 	SPDK_SCSI_ASCQ_POWER_LOSS_EXPECTED = 0x08,
 	SPDK_SCSI_ASCQ_INVALID_LU_IDENTIFIER = 0x09,
 };
@@ -164,6 +170,10 @@ enum spdk_spc_opcode {
 	SPDK_SPC_MI_REPORT_TARGET_PORT_GROUPS = 0x0a,
 	SPDK_SPC_MI_REPORT_TIMESTAMP = 0x0f,
 
+	SPDK_SPC_EC_EXTENDED_COPY_LID1 = 0x00,
+	SPDK_SPC_RCR_COPY_STATUS_LID1 = 0x00,
+	SPDK_SPC_RCR_OPERATING_PARAMETERS = 0x03,
+
 	/* SPC2 related (Obsolete) */
 	SPDK_SPC2_RELEASE_6 = 0x17,
 	SPDK_SPC2_RELEASE_10 = 0x57,
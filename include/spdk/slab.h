@@ -0,0 +1,217 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** \file
+ * Slab allocator for fixed-size objects
+ *
+ * Objects are carved out of chunks of huge page memory that are allocated on
+ * demand, one set of chunks per NUMA socket, up to a fixed maximum number of
+ * objects. Each thread that allocates objects keeps a small cache of free
+ * objects so that the common case of allocating and freeing on the same
+ * thread does not touch any shared state. Objects freed on a thread of a
+ * different socket are returned directly to their home socket.
+ */
+
+#ifndef SPDK_SLAB_H
+#define SPDK_SLAB_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPDK_SLAB_NAME_MAX	32
+
+struct spdk_slab;
+struct spdk_slab_cache;
+
+/**
+ * Slab usage statistics.
+ */
+struct spdk_slab_stats {
+	/** Number of chunks allocated from huge page memory. */
+	uint64_t chunk_count;
+
+	/** Total size of the allocated chunks in bytes. */
+	uint64_t chunk_bytes;
+
+	/** Number of objects carved out of the allocated chunks. */
+	uint64_t total_count;
+
+	/** Number of those objects that are currently free. */
+	uint64_t free_count;
+
+	/** Number of successful allocations. */
+	uint64_t get_count;
+
+	/** Number of allocations that failed because the slab was exhausted. */
+	uint64_t get_fail_count;
+
+	/** Number of objects freed. */
+	uint64_t put_count;
+
+	/** Number of objects freed on a different socket than the one they belong to. */
+	uint64_t remote_put_count;
+};
+
+/**
+ * Create a slab.
+ *
+ * No memory is allocated for the objects until they are requested.
+ *
+ * \param name Name of the slab, used in error messages.
+ * \param ele_size Size of each object in bytes. Objects are aligned to a cache line, and
+ * to 4 KiB if ele_size is a multiple of 4 KiB.
+ * \param max_count Maximum number of objects that can be allocated from the slab.
+ *
+ * \return a pointer to the created slab on success, or NULL on failure.
+ */
+struct spdk_slab *spdk_slab_create(const char *name, size_t ele_size, uint32_t max_count);
+
+/**
+ * Free a slab and all memory backing its objects.
+ *
+ * All caches of the slab must have been freed before.
+ *
+ * \param slab Slab to free.
+ */
+void spdk_slab_free(struct spdk_slab *slab);
+
+/**
+ * Get the name of a slab.
+ *
+ * \param slab Slab to query.
+ *
+ * \return the name of the slab.
+ */
+const char *spdk_slab_get_name(const struct spdk_slab *slab);
+
+/**
+ * Get the usage statistics of a slab.
+ *
+ * The per-thread counters are read without synchronization, so the returned
+ * values are approximate while the slab is in use.
+ *
+ * \param slab Slab to query.
+ * \param stats Filled with the statistics of the slab.
+ */
+void spdk_slab_get_stats(struct spdk_slab *slab, struct spdk_slab_stats *stats);
+
+/**
+ * Create a per-thread cache of free objects.
+ *
+ * A cache must only be used by one thread at a time. Objects allocated through
+ * the cache are backed by memory of the given socket.
+ *
+ * \param slab Slab to create the cache for.
+ * \param size Maximum number of free objects held by the cache.
+ * \param socket_id Socket ID to allocate memory on, or SPDK_ENV_SOCKET_ID_ANY
+ * for any socket.
+ *
+ * \return a pointer to the created cache on success, or NULL on failure.
+ */
+struct spdk_slab_cache *spdk_slab_cache_create(struct spdk_slab *slab, uint32_t size,
+		int socket_id);
+
+/**
+ * Free a per-thread cache, returning all of its free objects to the slab.
+ *
+ * \param cache Cache to free.
+ */
+void spdk_slab_cache_free(struct spdk_slab_cache *cache);
+
+/**
+ * Get the number of free objects currently held by a per-thread cache.
+ *
+ * \param cache Cache to query.
+ *
+ * \return the number of objects that can be allocated without touching shared state.
+ */
+uint32_t spdk_slab_cache_count(const struct spdk_slab_cache *cache);
+
+/**
+ * Refill an empty per-thread cache.
+ *
+ * Objects are taken the same way as when spdk_slab_get() finds the cache empty,
+ * so objects of other sockets are used once the slab is at its maximum size.
+ * This lets a thread find out whether objects freed on other threads can be
+ * allocated again without allocating one.
+ *
+ * \param cache Cache to refill.
+ *
+ * \return the number of objects held by the cache afterwards.
+ */
+uint32_t spdk_slab_cache_refill(struct spdk_slab_cache *cache);
+
+/**
+ * Fill a per-thread cache up to its size.
+ *
+ * This reserves objects for the thread owning the cache, so that it can still
+ * allocate when other threads hold the rest of the slab.
+ *
+ * \param cache Cache to fill.
+ *
+ * \return the number of objects held by the cache afterwards, which is less than
+ * its size if the slab ran out of objects.
+ */
+uint32_t spdk_slab_cache_fill(struct spdk_slab_cache *cache);
+
+/**
+ * Allocate an object.
+ *
+ * \param slab Slab to allocate from.
+ * \param cache Cache of the calling thread, or NULL to allocate from memory of
+ * any socket without caching.
+ *
+ * \return a pointer to the object, or NULL if the slab is exhausted.
+ */
+void *spdk_slab_get(struct spdk_slab *slab, struct spdk_slab_cache *cache);
+
+/**
+ * Free an object.
+ *
+ * The object may be freed on any thread, not just the one that allocated it.
+ *
+ * \param slab Slab the object was allocated from.
+ * \param cache Cache of the calling thread, or NULL to return the object
+ * directly to the slab.
+ * \param ele Object to free.
+ */
+void spdk_slab_put(struct spdk_slab *slab, struct spdk_slab_cache *cache, void *ele);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
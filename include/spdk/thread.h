@@ -316,6 +316,14 @@ struct spdk_thread_stats {
 	uint64_t busy_tsc;
 	uint64_t idle_tsc;
 	uint64_t unknown_tsc;
+
+	/* Number of pollers currently registered, without and with a period. */
+	uint64_t active_pollers;
+	uint64_t timed_pollers;
+
+	/* Total number of poller executions and the ticks spent running them. */
+	uint64_t poller_runs;
+	uint64_t poller_tsc;
 };
 
 /**
@@ -327,6 +335,43 @@ struct spdk_thread_stats {
  */
 int spdk_thread_get_stats(struct spdk_thread_stats *stats);
 
+struct spdk_poller_stats {
+	/* Name the poller was registered with. */
+	const char *name;
+
+	/* Period of a timed poller, 0 for an active poller. */
+	uint64_t period_ticks;
+
+	/* Number of times the poller was run. */
+	uint64_t run_count;
+
+	/* Number of runs in which the poller reported that it did work. */
+	uint64_t busy_count;
+
+	/* Ticks spent running the poller. */
+	uint64_t run_tsc;
+};
+
+/**
+ * Callback function used to report poller statistics.
+ *
+ * \param ctx Context passed to spdk_thread_get_poller_stats().
+ * \param stats Statistics of a single poller. Only valid for the duration of the call.
+ */
+typedef void (*spdk_poller_stats_fn)(void *ctx, const struct spdk_poller_stats *stats);
+
+/**
+ * Get statistics about the pollers registered on the current thread.
+ *
+ * `fn` is called once for each registered poller, active pollers first.
+ *
+ * \param fn Function called with the statistics of each poller.
+ * \param ctx Context passed to fn.
+ *
+ * \return 0 on success, -EINVAL if there is no current thread.
+ */
+int spdk_thread_get_poller_stats(spdk_poller_stats_fn fn, void *ctx);
+
 /**
  * Send a message to the given thread.
  *
@@ -339,6 +384,31 @@ int spdk_thread_get_stats(struct spdk_thread_stats *stats);
  */
 void spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx);
 
+/**
+ * Maximum number of messages that can be sent with a single call to
+ * spdk_thread_send_msg_batch().
+ */
+#define SPDK_THREAD_MSG_BATCH_MAX	32
+
+/**
+ * Send a batch of messages to the given thread.
+ *
+ * `fn` will be called once on the given thread for each element of `ctx`, in
+ * array order. All messages are placed on the thread's message ring with a
+ * single enqueue, so either all of them are sent or none are.
+ *
+ * \param thread The target thread.
+ * \param fn This function will be called on the given thread.
+ * \param ctx Array of contexts, one per message.
+ * \param count Number of elements in ctx. Must be between 1 and
+ * SPDK_THREAD_MSG_BATCH_MAX.
+ *
+ * \return 0 on success, -EINVAL if count is out of range, or -ENOMEM if the
+ * messages could not be allocated or queued.
+ */
+int spdk_thread_send_msg_batch(const struct spdk_thread *thread, spdk_msg_fn fn,
+			       void **ctx, uint32_t count);
+
 /**
  * Send a message to each thread, serially.
  *
@@ -369,6 +439,37 @@ struct spdk_poller *spdk_poller_register(spdk_poller_fn fn,
 		void *arg,
 		uint64_t period_microseconds);
 
+/**
+ * Maximum length of a poller name, not including the terminating null byte.
+ */
+#define SPDK_MAX_POLLER_NAME_LEN	255
+
+/**
+ * Register a named poller on the current thread.
+ *
+ * The name is reported in poller statistics. Pollers registered with
+ * spdk_poller_register() are named after the address of `fn`.
+ *
+ * \param fn This function will be called every `period_microseconds`.
+ * \param arg Argument passed to fn.
+ * \param period_microseconds How often to call `fn`. If 0, call `fn` as often
+ *  as possible.
+ * \param name Name of the poller. Truncated to SPDK_MAX_POLLER_NAME_LEN characters.
+ *
+ * \return a pointer to the poller registered on the current thread on success
+ * or NULL on failure.
+ */
+struct spdk_poller *spdk_poller_register_named(spdk_poller_fn fn,
+		void *arg,
+		uint64_t period_microseconds,
+		const char *name);
+
+/**
+ * Register a poller on the current thread, named after the poller function.
+ */
+#define SPDK_POLLER_REGISTER(fn, arg, period_microseconds)	\
+	spdk_poller_register_named(fn, arg, period_microseconds, #fn)
+
 /**
  * Unregister a poller on the current thread.
  *
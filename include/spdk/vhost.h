@@ -201,6 +201,34 @@ int spdk_vhost_set_coalescing(struct spdk_vhost_dev *vdev, uint32_t delay_base_u
 void spdk_vhost_get_coalescing(struct spdk_vhost_dev *vdev, uint32_t *delay_base_us,
 			       uint32_t *iops_threshold);
 
+/**
+ * Enable adaptive event coalescing. Each virtqueue then picks its own event
+ * delay based on its completion rate, so that an event covers a batch of
+ * completions, but never delays an event longer than the given target latency.
+ * Virtqueues with too few completions to coalesce within that time, and
+ * virtqueues with no more requests in flight, get their events immediately.
+ *
+ * If enabled, this takes precedence over the settings of spdk_vhost_set_coalescing().
+ *
+ * \param vdev vhost device.
+ * \param target_latency_us Maximum event delay in microseconds. If 0, adaptive
+ * coalescing is disabled.
+ *
+ * \return 0 on success, negative errno on error.
+ */
+int spdk_vhost_set_adaptive_coalescing(struct spdk_vhost_dev *vdev, uint32_t target_latency_us);
+
+/**
+ * Get the adaptive coalescing target latency.
+ *
+ * \see spdk_vhost_set_adaptive_coalescing
+ *
+ * \param vdev vhost device.
+ *
+ * \return target latency in microseconds, 0 if adaptive coalescing is disabled.
+ */
+uint32_t spdk_vhost_get_adaptive_coalescing(struct spdk_vhost_dev *vdev);
+
 /**
  * Construct an empty vhost SCSI device.  This will create a
  * Unix domain socket together with a vhost-user slave server waiting
@@ -302,11 +330,15 @@ int spdk_vhost_scsi_dev_remove_tgt(struct spdk_vhost_dev *vdev, unsigned scsi_tg
  * \param dev_name bdev name to associate with this vhost device
  * \param readonly if set, all writes to the device will fail with
  * \c VIRTIO_BLK_S_IOERR error code.
+ * \param distribute_queues if set, the virtqueues of each connection are
+ * split between all cores in the cpumask and each core polls its share of
+ * them through its own bdev I/O channel. Otherwise all virtqueues of a
+ * connection are polled by a single core.
  *
  * \return 0 on success, negative errno on error.
  */
 int spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_name,
-			     bool readonly);
+			     bool readonly, bool distribute_queues);
 
 /**
  * Remove a vhost device. The device must not have any open connections on it's socket.
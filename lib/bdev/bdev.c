@@ -44,6 +44,7 @@
 #include "spdk/queue.h"
 #include "spdk/nvme_spec.h"
 #include "spdk/scsi_spec.h"
+#include "spdk/slab.h"
 #include "spdk/util.h"
 #include "spdk/trace.h"
 
@@ -59,8 +60,8 @@ int __itt_init_ittlib(const char *, __itt_group_id);
 
 #define SPDK_BDEV_IO_POOL_SIZE			(64 * 1024)
 #define SPDK_BDEV_IO_CACHE_SIZE			256
-#define BUF_SMALL_POOL_SIZE			8192
-#define BUF_LARGE_POOL_SIZE			1024
+#define BUF_CACHE_SIZE				32
+#define BUF_MAX_NUMA_NODES			8
 #define NOMEM_THRESHOLD_COUNT			8
 #define ZERO_BUFFER_SIZE			0x100000
 
@@ -91,10 +92,25 @@ static const char *qos_rpc_type[] = {"rw_ios_per_sec",
 TAILQ_HEAD(spdk_bdev_list, spdk_bdev);
 
 struct spdk_bdev_mgr {
-	struct spdk_mempool *bdev_io_pool;
+	struct spdk_slab *bdev_io_slab;
 
-	struct spdk_mempool *buf_small_pool;
-	struct spdk_mempool *buf_large_pool;
+	/*
+	 * Data buffer pools, indexed by size class and NUMA node.  Only nodes with at
+	 *  least one core get pools, and each class count is split evenly between them.
+	 */
+	struct spdk_mempool *buf_pool[SPDK_BDEV_BUF_NUM_CLASSES][BUF_MAX_NUMA_NODES];
+
+	/* Number of buffers in each node's pool of a class, 0 if the class is disabled */
+	uint32_t buf_pool_size[SPDK_BDEV_BUF_NUM_CLASSES];
+
+	/* Number of buffers of a class each thread may keep cached */
+	uint32_t buf_cache_size[SPDK_BDEV_BUF_NUM_CLASSES];
+
+	/* Nodes that have buffer pools */
+	bool buf_numa_node[BUF_MAX_NUMA_NODES];
+
+	/* Node whose pools are used by threads not running on a node with pools */
+	uint32_t buf_default_numa_id;
 
 	void *zero_buffer;
 
@@ -120,6 +136,12 @@ static struct spdk_bdev_mgr g_bdev_mgr = {
 static struct spdk_bdev_opts	g_bdev_opts = {
 	.bdev_io_pool_size = SPDK_BDEV_IO_POOL_SIZE,
 	.bdev_io_cache_size = SPDK_BDEV_IO_CACHE_SIZE,
+	.buf_class_count = { 4096, 2048, 1024, 512, 512, 128, 16 },
+	.buf_cache_size = BUF_CACHE_SIZE,
+};
+
+static const uint32_t g_bdev_buf_class_size[SPDK_BDEV_BUF_NUM_CLASSES] = {
+	4 * 1024, 8 * 1024, 16 * 1024, 32 * 1024, 64 * 1024, 128 * 1024, SPDK_BDEV_BUF_MAX_SIZE
 };
 
 static spdk_bdev_init_cb	g_init_cb_fn = NULL;
@@ -176,20 +198,33 @@ struct spdk_bdev_qos {
 	struct spdk_poller *poller;
 };
 
+/* Overlaid on free data buffers kept in a management channel's cache */
+struct spdk_bdev_buf_cache_entry {
+	STAILQ_ENTRY(spdk_bdev_buf_cache_entry) link;
+};
+
 struct spdk_bdev_mgmt_channel {
-	bdev_io_stailq_t need_buf_small;
-	bdev_io_stailq_t need_buf_large;
+	/* I/O waiting for a buffer, queued on the smallest class that fits them */
+	bdev_io_stailq_t need_buf[SPDK_BDEV_BUF_NUM_CLASSES];
+
+	/* NUMA node of the buffer pools tried first by this thread */
+	uint32_t numa_id;
+
+	/*
+	 * Free data buffers of this thread's node, so that getting and putting
+	 *  a buffer doesn't have to go through the shared pools on every I/O.
+	 */
+	STAILQ_HEAD(, spdk_bdev_buf_cache_entry) buf_cache[SPDK_BDEV_BUF_NUM_CLASSES];
+	uint32_t buf_cache_count[SPDK_BDEV_BUF_NUM_CLASSES];
 
 	/*
 	 * Each thread keeps a cache of bdev_io - this allows
 	 *  bdev threads which are *not* DPDK threads to still
 	 *  benefit from a per-thread bdev_io cache.  Without
-	 *  this, non-DPDK threads fetching from the mempool
+	 *  this, threads fetching from the shared slab
 	 *  incur a cmpxchg on get and put.
 	 */
-	bdev_io_stailq_t per_thread_cache;
-	uint32_t	per_thread_cache_count;
-	uint32_t	bdev_io_cache_size;
+	struct spdk_slab_cache *bdev_io_cache;
 
 	TAILQ_HEAD(, spdk_bdev_shared_resource)	shared_resources;
 	TAILQ_HEAD(, spdk_bdev_io_wait_entry)	io_wait_queue;
@@ -304,10 +339,20 @@ spdk_bdev_get_opts(struct spdk_bdev_opts *opts)
 	*opts = g_bdev_opts;
 }
 
+uint32_t
+spdk_bdev_get_buf_class_size(uint32_t buf_class)
+{
+	if (buf_class >= SPDK_BDEV_BUF_NUM_CLASSES) {
+		return 0;
+	}
+
+	return g_bdev_buf_class_size[buf_class];
+}
+
 int
 spdk_bdev_set_opts(struct spdk_bdev_opts *opts)
 {
-	uint32_t min_pool_size;
+	uint32_t min_pool_size, i;
 
 	/*
 	 * Add 1 to the thread count to account for the extra mgmt_ch that gets created during subsystem
@@ -323,6 +368,17 @@ spdk_bdev_set_opts(struct spdk_bdev_opts *opts)
 		return -1;
 	}
 
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		if (opts->buf_class_count[i] != 0) {
+			break;
+		}
+	}
+
+	if (i == SPDK_BDEV_BUF_NUM_CLASSES) {
+		SPDK_ERRLOG("At least one buffer size class must have buffers\n");
+		return -1;
+	}
+
 	g_bdev_opts = *opts;
 	return 0;
 }
@@ -504,54 +560,159 @@ _bdev_io_set_bounce_buf(struct spdk_bdev_io *bdev_io, void *buf, size_t len)
 	}
 }
 
+static void
+_bdev_io_set_pool_buf(struct spdk_bdev_io *bdev_io, void *buf, uint32_t buf_class,
+		      uint32_t buf_numa_id)
+{
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	struct spdk_bdev *bdev = bdev_io->bdev;
+	uint64_t alignment;
+	void *aligned_buf;
+
+	alignment = spdk_bdev_get_buf_align(bdev);
+	aligned_buf = (void *)(((uintptr_t)buf + (alignment - 1)) & ~(alignment - 1));
+
+	if (_is_buf_allocated(bdev_io->u.bdev.iovs)) {
+		_bdev_io_set_bounce_buf(bdev_io, aligned_buf, bdev_io->internal.buf_len);
+	} else {
+		spdk_bdev_io_set_buf(bdev_io, aligned_buf, bdev_io->internal.buf_len);
+	}
+
+	bdev_io->internal.buf = buf;
+	bdev_io->internal.buf_class = buf_class;
+	bdev_io->internal.buf_numa_id = buf_numa_id;
+
+	if (buf_numa_id != ch->shared_resource->mgmt_ch->numa_id) {
+		ch->stat.num_remote_thread_bufs++;
+	}
+	if (bdev->numa.enabled && buf_numa_id != bdev->numa.id) {
+		ch->stat.num_remote_bdev_bufs++;
+	}
+
+	bdev_io->internal.get_buf_cb(ch->channel, bdev_io, true);
+}
+
+/*
+ * Returns the smallest enabled size class able to hold len bytes, or
+ *  SPDK_BDEV_BUF_NUM_CLASSES if there is none.
+ */
+static uint32_t
+_bdev_buf_class(uint64_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		if (g_bdev_mgr.buf_pool_size[i] != 0 &&
+		    len <= SPDK_BDEV_BUF_SIZE_WITH_MD(g_bdev_buf_class_size[i]) + SPDK_BDEV_POOL_ALIGNMENT) {
+			return i;
+		}
+	}
+
+	return SPDK_BDEV_BUF_NUM_CLASSES;
+}
+
+static uint32_t
+_bdev_buf_max_size(void)
+{
+	uint32_t i;
+
+	for (i = SPDK_BDEV_BUF_NUM_CLASSES; i > 0; i--) {
+		if (g_bdev_mgr.buf_pool_size[i - 1] != 0) {
+			return g_bdev_buf_class_size[i - 1];
+		}
+	}
+
+	return 0;
+}
+
+static void *
+_bdev_buf_get(struct spdk_bdev_mgmt_channel *ch, uint32_t buf_class, uint32_t *buf_numa_id)
+{
+	struct spdk_bdev_buf_cache_entry *entry;
+	struct spdk_mempool **pools = g_bdev_mgr.buf_pool[buf_class];
+	void *buf;
+	uint32_t i;
+
+	entry = STAILQ_FIRST(&ch->buf_cache[buf_class]);
+	if (entry) {
+		STAILQ_REMOVE_HEAD(&ch->buf_cache[buf_class], link);
+		ch->buf_cache_count[buf_class]--;
+		*buf_numa_id = ch->numa_id;
+		return entry;
+	}
+
+	/* Prefer the node local to the calling thread and only go remote once it runs dry */
+	buf = spdk_mempool_get(pools[ch->numa_id]);
+	if (buf) {
+		*buf_numa_id = ch->numa_id;
+		return buf;
+	}
+
+	for (i = 0; i < BUF_MAX_NUMA_NODES; i++) {
+		if (i == ch->numa_id || pools[i] == NULL) {
+			continue;
+		}
+
+		buf = spdk_mempool_get(pools[i]);
+		if (buf) {
+			*buf_numa_id = i;
+			return buf;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+_bdev_buf_put(struct spdk_bdev_mgmt_channel *ch, void *buf, uint32_t buf_class,
+	      uint32_t buf_numa_id)
+{
+	struct spdk_bdev_buf_cache_entry *entry = buf;
+
+	/* Only local buffers are cached, remote ones go straight back to their node */
+	if (buf_numa_id == ch->numa_id &&
+	    ch->buf_cache_count[buf_class] < g_bdev_mgr.buf_cache_size[buf_class]) {
+		STAILQ_INSERT_HEAD(&ch->buf_cache[buf_class], entry, link);
+		ch->buf_cache_count[buf_class]++;
+	} else {
+		spdk_mempool_put(g_bdev_mgr.buf_pool[buf_class][buf_numa_id], buf);
+	}
+}
+
 static void
 spdk_bdev_io_put_buf(struct spdk_bdev_io *bdev_io)
 {
-	struct spdk_mempool *pool;
 	struct spdk_bdev_io *tmp;
-	void *buf, *aligned_buf;
-	bdev_io_stailq_t *stailq;
+	void *buf;
 	struct spdk_bdev_mgmt_channel *ch;
-	uint64_t buf_len;
-	uint64_t alignment;
-	bool buf_allocated;
+	uint32_t buf_class, buf_numa_id, i;
 
 	buf = bdev_io->internal.buf;
-	buf_len = bdev_io->internal.buf_len;
-	alignment = spdk_bdev_get_buf_align(bdev_io->bdev);
+	buf_class = bdev_io->internal.buf_class;
+	buf_numa_id = bdev_io->internal.buf_numa_id;
 	ch = bdev_io->internal.ch->shared_resource->mgmt_ch;
 
 	bdev_io->internal.buf = NULL;
 
-	if (buf_len + alignment <= SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
-	    SPDK_BDEV_POOL_ALIGNMENT) {
-		pool = g_bdev_mgr.buf_small_pool;
-		stailq = &ch->need_buf_small;
-	} else {
-		pool = g_bdev_mgr.buf_large_pool;
-		stailq = &ch->need_buf_large;
-	}
-
-	if (STAILQ_EMPTY(stailq)) {
-		spdk_mempool_put(pool, buf);
-	} else {
-		tmp = STAILQ_FIRST(stailq);
+	/*
+	 * Hand the buffer over to an I/O waiting on this class, or on any smaller
+	 *  one, as the buffer is large enough for all of them.
+	 */
+	for (i = buf_class + 1; i > 0; i--) {
+		if (!STAILQ_EMPTY(&ch->need_buf[i - 1])) {
+			tmp = STAILQ_FIRST(&ch->need_buf[i - 1]);
+			STAILQ_REMOVE_HEAD(&ch->need_buf[i - 1], internal.buf_link);
 
-		alignment = spdk_bdev_get_buf_align(tmp->bdev);
-		buf_allocated = _is_buf_allocated(tmp->u.bdev.iovs);
+			tmp->internal.ch->stat.num_buf_waits++;
+			tmp->internal.ch->stat.buf_wait_ticks += spdk_get_ticks() -
+								 tmp->internal.buf_wait_tsc;
 
-		aligned_buf = (void *)(((uintptr_t)buf +
-					(alignment - 1)) & ~(alignment - 1));
-		if (buf_allocated) {
-			_bdev_io_set_bounce_buf(tmp, aligned_buf, tmp->internal.buf_len);
-		} else {
-			spdk_bdev_io_set_buf(tmp, aligned_buf, tmp->internal.buf_len);
+			_bdev_io_set_pool_buf(tmp, buf, buf_class, buf_numa_id);
+			return;
 		}
-
-		STAILQ_REMOVE_HEAD(stailq, internal.buf_link);
-		tmp->internal.buf = buf;
-		tmp->internal.get_buf_cb(tmp->internal.ch->channel, tmp, true);
 	}
+
+	_bdev_buf_put(ch, buf, buf_class, buf_numa_id);
 }
 
 static void
@@ -576,11 +737,10 @@ _bdev_io_unset_bounce_buf(struct spdk_bdev_io *bdev_io)
 void
 spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
 {
-	struct spdk_mempool *pool;
-	bdev_io_stailq_t *stailq;
-	void *buf, *aligned_buf;
+	void *buf;
 	struct spdk_bdev_mgmt_channel *mgmt_ch;
 	uint64_t alignment;
+	uint32_t buf_class, buf_numa_id, i;
 	bool buf_allocated;
 
 	assert(cb != NULL);
@@ -596,8 +756,8 @@ spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, u
 		return;
 	}
 
-	if (len + alignment > SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_LARGE_BUF_MAX_SIZE) +
-	    SPDK_BDEV_POOL_ALIGNMENT) {
+	buf_class = _bdev_buf_class(len + alignment);
+	if (buf_class == SPDK_BDEV_BUF_NUM_CLASSES) {
 		SPDK_ERRLOG("Length + alignment %" PRIu64 " is larger than allowed\n",
 			    len + alignment);
 		cb(bdev_io->internal.ch->channel, bdev_io, false);
@@ -609,30 +769,21 @@ spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, u
 	bdev_io->internal.buf_len = len;
 	bdev_io->internal.get_buf_cb = cb;
 
-	if (len + alignment <= SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
-	    SPDK_BDEV_POOL_ALIGNMENT) {
-		pool = g_bdev_mgr.buf_small_pool;
-		stailq = &mgmt_ch->need_buf_small;
-	} else {
-		pool = g_bdev_mgr.buf_large_pool;
-		stailq = &mgmt_ch->need_buf_large;
-	}
-
-	buf = spdk_mempool_get(pool);
-
-	if (!buf) {
-		STAILQ_INSERT_TAIL(stailq, bdev_io, internal.buf_link);
-	} else {
-		aligned_buf = (void *)(((uintptr_t)buf + (alignment - 1)) & ~(alignment - 1));
+	/* Rather than waiting, fall back to a larger class when the best fitting one is empty */
+	for (i = buf_class; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		if (g_bdev_mgr.buf_pool_size[i] == 0) {
+			continue;
+		}
 
-		if (buf_allocated) {
-			_bdev_io_set_bounce_buf(bdev_io, aligned_buf, len);
-		} else {
-			spdk_bdev_io_set_buf(bdev_io, aligned_buf, len);
+		buf = _bdev_buf_get(mgmt_ch, i, &buf_numa_id);
+		if (buf) {
+			_bdev_io_set_pool_buf(bdev_io, buf, i, buf_numa_id);
+			return;
 		}
-		bdev_io->internal.buf = buf;
-		bdev_io->internal.get_buf_cb(bdev_io->internal.ch->channel, bdev_io, true);
 	}
+
+	bdev_io->internal.buf_wait_tsc = spdk_get_ticks();
+	STAILQ_INSERT_TAIL(&mgmt_ch->need_buf[buf_class], bdev_io, internal.buf_link);
 }
 
 static int
@@ -695,6 +846,7 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 {
 	struct spdk_bdev_module *bdev_module;
 	struct spdk_bdev *bdev;
+	uint32_t i;
 
 	assert(w != NULL);
 
@@ -705,6 +857,12 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_object_begin(w, "params");
 	spdk_json_write_named_uint32(w, "bdev_io_pool_size", g_bdev_opts.bdev_io_pool_size);
 	spdk_json_write_named_uint32(w, "bdev_io_cache_size", g_bdev_opts.bdev_io_cache_size);
+	spdk_json_write_named_array_begin(w, "buf_class_counts");
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		spdk_json_write_uint32(w, g_bdev_opts.buf_class_count[i]);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_named_uint32(w, "buf_cache_size", g_bdev_opts.buf_cache_size);
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 
@@ -729,22 +887,37 @@ static int
 spdk_bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 {
 	struct spdk_bdev_mgmt_channel *ch = ctx_buf;
-	struct spdk_bdev_io *bdev_io;
 	uint32_t i;
 
-	STAILQ_INIT(&ch->need_buf_small);
-	STAILQ_INIT(&ch->need_buf_large);
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		STAILQ_INIT(&ch->need_buf[i]);
+		STAILQ_INIT(&ch->buf_cache[i]);
+		ch->buf_cache_count[i] = 0;
+	}
 
-	STAILQ_INIT(&ch->per_thread_cache);
-	ch->bdev_io_cache_size = g_bdev_opts.bdev_io_cache_size;
+	/* Data buffers come from the pools of this thread's node whenever possible. */
+	ch->numa_id = spdk_env_get_socket_id(spdk_env_get_current_core());
+	if (ch->numa_id >= BUF_MAX_NUMA_NODES || !g_bdev_mgr.buf_numa_node[ch->numa_id]) {
+		ch->numa_id = g_bdev_mgr.buf_default_numa_id;
+	}
 
-	/* Pre-populate bdev_io cache to ensure this thread cannot be starved. */
-	ch->per_thread_cache_count = 0;
-	for (i = 0; i < ch->bdev_io_cache_size; i++) {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
-		assert(bdev_io != NULL);
-		ch->per_thread_cache_count++;
-		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
+	/* bdev_ios are allocated from memory local to the socket of this thread. */
+	ch->bdev_io_cache = spdk_slab_cache_create(g_bdev_mgr.bdev_io_slab,
+			    g_bdev_opts.bdev_io_cache_size,
+			    spdk_env_get_socket_id(spdk_env_get_current_core()));
+	if (!ch->bdev_io_cache) {
+		SPDK_ERRLOG("could not allocate bdev_io cache\n");
+		return -1;
+	}
+
+	/*
+	 * Pre-populate bdev_io cache to ensure this thread cannot be starved.
+	 *  spdk_bdev_set_opts() makes sure the pool is large enough.
+	 */
+	if (spdk_slab_cache_fill(ch->bdev_io_cache) < g_bdev_opts.bdev_io_cache_size) {
+		SPDK_ERRLOG("could not populate bdev_io cache\n");
+		spdk_slab_cache_free(ch->bdev_io_cache);
+		return -1;
 	}
 
 	TAILQ_INIT(&ch->shared_resources);
@@ -757,24 +930,26 @@ static void
 spdk_bdev_mgmt_channel_destroy(void *io_device, void *ctx_buf)
 {
 	struct spdk_bdev_mgmt_channel *ch = ctx_buf;
-	struct spdk_bdev_io *bdev_io;
+	struct spdk_bdev_buf_cache_entry *entry;
+	uint32_t i;
+
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		if (!STAILQ_EMPTY(&ch->need_buf[i])) {
+			SPDK_ERRLOG("Pending I/O list wasn't empty on mgmt channel free\n");
+		}
 
-	if (!STAILQ_EMPTY(&ch->need_buf_small) || !STAILQ_EMPTY(&ch->need_buf_large)) {
-		SPDK_ERRLOG("Pending I/O list wasn't empty on mgmt channel free\n");
+		while ((entry = STAILQ_FIRST(&ch->buf_cache[i])) != NULL) {
+			STAILQ_REMOVE_HEAD(&ch->buf_cache[i], link);
+			spdk_mempool_put(g_bdev_mgr.buf_pool[i][ch->numa_id], entry);
+		}
+		ch->buf_cache_count[i] = 0;
 	}
 
 	if (!TAILQ_EMPTY(&ch->shared_resources)) {
 		SPDK_ERRLOG("Module channel list wasn't empty on mgmt channel free\n");
 	}
 
-	while (!STAILQ_EMPTY(&ch->per_thread_cache)) {
-		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
-		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
-		ch->per_thread_cache_count--;
-		spdk_mempool_put(g_bdev_mgr.bdev_io_pool, (void *)bdev_io);
-	}
-
-	assert(ch->per_thread_cache_count == 0);
+	spdk_slab_cache_free(ch->bdev_io_cache);
 }
 
 static void
@@ -883,13 +1058,114 @@ spdk_bdev_init_failed(void *cb_arg)
 	spdk_bdev_init_complete(-1);
 }
 
+static int
+spdk_bdev_buf_pools_create(void)
+{
+	struct spdk_mempool *pool;
+	uint32_t core, numa_id, buf_class, num_nodes = 0;
+	char mempool_name[32];
+
+	memset(g_bdev_mgr.buf_numa_node, 0, sizeof(g_bdev_mgr.buf_numa_node));
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		numa_id = spdk_env_get_socket_id(core);
+		if (numa_id >= BUF_MAX_NUMA_NODES) {
+			continue;
+		}
+
+		if (!g_bdev_mgr.buf_numa_node[numa_id]) {
+			g_bdev_mgr.buf_numa_node[numa_id] = true;
+			num_nodes++;
+		}
+	}
+
+	if (num_nodes == 0) {
+		g_bdev_mgr.buf_numa_node[0] = true;
+		num_nodes = 1;
+	}
+
+	numa_id = 0;
+	while (!g_bdev_mgr.buf_numa_node[numa_id]) {
+		numa_id++;
+	}
+	g_bdev_mgr.buf_default_numa_id = numa_id;
+
+	for (buf_class = 0; buf_class < SPDK_BDEV_BUF_NUM_CLASSES; buf_class++) {
+		if (g_bdev_opts.buf_class_count[buf_class] == 0) {
+			g_bdev_mgr.buf_pool_size[buf_class] = 0;
+			g_bdev_mgr.buf_cache_size[buf_class] = 0;
+			continue;
+		}
+
+		g_bdev_mgr.buf_pool_size[buf_class] =
+			spdk_max(g_bdev_opts.buf_class_count[buf_class] / num_nodes, 1);
+
+		/**
+		 * Ensure no more than half of the buffers of a node end up in thread
+		 *   caches, by using spdk_thread_get_count() to determine how many
+		 *   caches we need to account for.
+		 */
+		g_bdev_mgr.buf_cache_size[buf_class] = spdk_min(g_bdev_opts.buf_cache_size,
+						       g_bdev_mgr.buf_pool_size[buf_class] /
+						       (2 * spdk_thread_get_count()));
+
+		for (numa_id = 0; numa_id < BUF_MAX_NUMA_NODES; numa_id++) {
+			if (!g_bdev_mgr.buf_numa_node[numa_id]) {
+				continue;
+			}
+
+			snprintf(mempool_name, sizeof(mempool_name), "buf_%" PRIu32 "k_pool_%d_%" PRIu32,
+				 g_bdev_buf_class_size[buf_class] / 1024, getpid(), numa_id);
+
+			/* Threads cache buffers themselves, see spdk_bdev_mgmt_channel. */
+			pool = spdk_mempool_create(mempool_name, g_bdev_mgr.buf_pool_size[buf_class],
+						   SPDK_BDEV_BUF_SIZE_WITH_MD(g_bdev_buf_class_size[buf_class]) +
+						   SPDK_BDEV_POOL_ALIGNMENT, 0, numa_id);
+			if (!pool) {
+				SPDK_ERRLOG("create %" PRIu32 "k buffer pool on node %" PRIu32 " failed\n",
+					    g_bdev_buf_class_size[buf_class] / 1024, numa_id);
+				return -ENOMEM;
+			}
+			g_bdev_mgr.buf_pool[buf_class][numa_id] = pool;
+		}
+	}
+
+	return 0;
+}
+
+static void
+spdk_bdev_buf_pools_free(void)
+{
+	struct spdk_mempool *pool;
+	uint32_t numa_id, buf_class;
+
+	for (buf_class = 0; buf_class < SPDK_BDEV_BUF_NUM_CLASSES; buf_class++) {
+		for (numa_id = 0; numa_id < BUF_MAX_NUMA_NODES; numa_id++) {
+			pool = g_bdev_mgr.buf_pool[buf_class][numa_id];
+			if (pool == NULL) {
+				continue;
+			}
+
+			if (spdk_mempool_count(pool) != g_bdev_mgr.buf_pool_size[buf_class]) {
+				SPDK_ERRLOG("%" PRIu32 "k buffer pool count on node %" PRIu32
+					    " is %zu but should be %u\n",
+					    g_bdev_buf_class_size[buf_class] / 1024, numa_id,
+					    spdk_mempool_count(pool), g_bdev_mgr.buf_pool_size[buf_class]);
+				assert(false);
+			}
+
+			spdk_mempool_free(pool);
+			g_bdev_mgr.buf_pool[buf_class][numa_id] = NULL;
+		}
+	}
+}
+
 void
 spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
 {
 	struct spdk_conf_section *sp;
 	struct spdk_bdev_opts bdev_opts;
 	int32_t bdev_io_pool_size, bdev_io_cache_size;
-	int cache_size;
 	int rc = 0;
 	char mempool_name[32];
 
@@ -922,50 +1198,22 @@ spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
 
 	snprintf(mempool_name, sizeof(mempool_name), "bdev_io_%d", getpid());
 
-	g_bdev_mgr.bdev_io_pool = spdk_mempool_create(mempool_name,
-				  g_bdev_opts.bdev_io_pool_size,
+	/*
+	 * bdev_io_pool_size is the upper bound of bdev_ios - memory for them is only
+	 *  allocated as they are needed, on the socket of the thread using them.
+	 */
+	g_bdev_mgr.bdev_io_slab = spdk_slab_create(mempool_name,
 				  sizeof(struct spdk_bdev_io) +
 				  spdk_bdev_module_get_max_ctx_size(),
-				  0,
-				  SPDK_ENV_SOCKET_ID_ANY);
+				  g_bdev_opts.bdev_io_pool_size);
 
-	if (g_bdev_mgr.bdev_io_pool == NULL) {
+	if (g_bdev_mgr.bdev_io_slab == NULL) {
 		SPDK_ERRLOG("could not allocate spdk_bdev_io pool\n");
 		spdk_bdev_init_complete(-1);
 		return;
 	}
 
-	/**
-	 * Ensure no more than half of the total buffers end up local caches, by
-	 *   using spdk_thread_get_count() to determine how many local caches we need
-	 *   to account for.
-	 */
-	cache_size = BUF_SMALL_POOL_SIZE / (2 * spdk_thread_get_count());
-	snprintf(mempool_name, sizeof(mempool_name), "buf_small_pool_%d", getpid());
-
-	g_bdev_mgr.buf_small_pool = spdk_mempool_create(mempool_name,
-				    BUF_SMALL_POOL_SIZE,
-				    SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_SMALL_BUF_MAX_SIZE) +
-				    SPDK_BDEV_POOL_ALIGNMENT,
-				    cache_size,
-				    SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_bdev_mgr.buf_small_pool) {
-		SPDK_ERRLOG("create rbuf small pool failed\n");
-		spdk_bdev_init_complete(-1);
-		return;
-	}
-
-	cache_size = BUF_LARGE_POOL_SIZE / (2 * spdk_thread_get_count());
-	snprintf(mempool_name, sizeof(mempool_name), "buf_large_pool_%d", getpid());
-
-	g_bdev_mgr.buf_large_pool = spdk_mempool_create(mempool_name,
-				    BUF_LARGE_POOL_SIZE,
-				    SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_BDEV_LARGE_BUF_MAX_SIZE) +
-				    SPDK_BDEV_POOL_ALIGNMENT,
-				    cache_size,
-				    SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_bdev_mgr.buf_large_pool) {
-		SPDK_ERRLOG("create rbuf large pool failed\n");
+	if (spdk_bdev_buf_pools_create()) {
 		spdk_bdev_init_complete(-1);
 		return;
 	}
@@ -1002,30 +1250,16 @@ static void
 spdk_bdev_mgr_unregister_cb(void *io_device)
 {
 	spdk_bdev_fini_cb cb_fn = g_fini_cb_fn;
+	struct spdk_slab_stats stats;
 
-	if (spdk_mempool_count(g_bdev_mgr.bdev_io_pool) != g_bdev_opts.bdev_io_pool_size) {
-		SPDK_ERRLOG("bdev IO pool count is %zu but should be %u\n",
-			    spdk_mempool_count(g_bdev_mgr.bdev_io_pool),
-			    g_bdev_opts.bdev_io_pool_size);
+	spdk_slab_get_stats(g_bdev_mgr.bdev_io_slab, &stats);
+	if (stats.free_count != stats.total_count) {
+		SPDK_ERRLOG("bdev IO slab has %" PRIu64 " of %" PRIu64 " bdev_ios in use but should have none\n",
+			    stats.total_count - stats.free_count, stats.total_count);
 	}
 
-	if (spdk_mempool_count(g_bdev_mgr.buf_small_pool) != BUF_SMALL_POOL_SIZE) {
-		SPDK_ERRLOG("Small buffer pool count is %zu but should be %u\n",
-			    spdk_mempool_count(g_bdev_mgr.buf_small_pool),
-			    BUF_SMALL_POOL_SIZE);
-		assert(false);
-	}
-
-	if (spdk_mempool_count(g_bdev_mgr.buf_large_pool) != BUF_LARGE_POOL_SIZE) {
-		SPDK_ERRLOG("Large buffer pool count is %zu but should be %u\n",
-			    spdk_mempool_count(g_bdev_mgr.buf_large_pool),
-			    BUF_LARGE_POOL_SIZE);
-		assert(false);
-	}
-
-	spdk_mempool_free(g_bdev_mgr.bdev_io_pool);
-	spdk_mempool_free(g_bdev_mgr.buf_small_pool);
-	spdk_mempool_free(g_bdev_mgr.buf_large_pool);
+	spdk_bdev_buf_pools_free();
+	spdk_slab_free(g_bdev_mgr.bdev_io_slab);
 	spdk_dma_free(g_bdev_mgr.zero_buffer);
 
 	cb_fn(g_fini_cb_arg);
@@ -1174,18 +1408,15 @@ spdk_bdev_get_io(struct spdk_bdev_channel *channel)
 	struct spdk_bdev_mgmt_channel *ch = channel->shared_resource->mgmt_ch;
 	struct spdk_bdev_io *bdev_io;
 
-	if (ch->per_thread_cache_count > 0) {
-		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
-		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
-		ch->per_thread_cache_count--;
-	} else if (spdk_unlikely(!TAILQ_EMPTY(&ch->io_wait_queue))) {
+	if (spdk_unlikely(spdk_slab_cache_count(ch->bdev_io_cache) == 0 &&
+			  !TAILQ_EMPTY(&ch->io_wait_queue))) {
 		/*
-		 * Don't try to look for bdev_ios in the global pool if there are
+		 * Don't try to look for bdev_ios in the global slab if there are
 		 * waiters on bdev_ios - we don't want this caller to jump the line.
 		 */
 		bdev_io = NULL;
 	} else {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		bdev_io = spdk_slab_get(g_bdev_mgr.bdev_io_slab, ch->bdev_io_cache);
 	}
 
 	return bdev_io;
@@ -1203,20 +1434,22 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 		spdk_bdev_io_put_buf(bdev_io);
 	}
 
-	if (ch->per_thread_cache_count < ch->bdev_io_cache_size) {
-		ch->per_thread_cache_count++;
-		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
-		while (ch->per_thread_cache_count > 0 && !TAILQ_EMPTY(&ch->io_wait_queue)) {
-			struct spdk_bdev_io_wait_entry *entry;
+	spdk_slab_put(g_bdev_mgr.bdev_io_slab, ch->bdev_io_cache, bdev_io);
+	if (spdk_unlikely(spdk_slab_cache_count(ch->bdev_io_cache) == 0)) {
+		/*
+		 * A bdev_io of another socket went back to its home socket instead of
+		 *  into this thread's cache. Take it back, so the cache doesn't drain
+		 *  while nothing is in flight, and the waiters can use it.
+		 */
+		spdk_slab_cache_refill(ch->bdev_io_cache);
+	}
 
-			entry = TAILQ_FIRST(&ch->io_wait_queue);
-			TAILQ_REMOVE(&ch->io_wait_queue, entry, link);
-			entry->cb_fn(entry->cb_arg);
-		}
-	} else {
-		/* We should never have a full cache with entries on the io wait queue. */
-		assert(TAILQ_EMPTY(&ch->io_wait_queue));
-		spdk_mempool_put(g_bdev_mgr.bdev_io_pool, (void *)bdev_io);
+	while (spdk_slab_cache_count(ch->bdev_io_cache) > 0 && !TAILQ_EMPTY(&ch->io_wait_queue)) {
+		struct spdk_bdev_io_wait_entry *entry;
+
+		entry = TAILQ_FIRST(&ch->io_wait_queue);
+		TAILQ_REMOVE(&ch->io_wait_queue, entry, link);
+		entry->cb_fn(entry->cb_arg);
 	}
 }
 
@@ -1929,7 +2162,7 @@ _spdk_bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 			qos->timeslice_size =
 				SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 			qos->last_timeslice = spdk_get_ticks();
-			qos->poller = spdk_poller_register(spdk_bdev_channel_poll_qos,
+			qos->poller = SPDK_POLLER_REGISTER(spdk_bdev_channel_poll_qos,
 							   qos,
 							   SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
 		}
@@ -2160,6 +2393,10 @@ _spdk_bdev_io_stat_add(struct spdk_bdev_io_stat *total, struct spdk_bdev_io_stat
 	total->read_latency_ticks += add->read_latency_ticks;
 	total->write_latency_ticks += add->write_latency_ticks;
 	total->unmap_latency_ticks += add->unmap_latency_ticks;
+	total->num_remote_thread_bufs += add->num_remote_thread_bufs;
+	total->num_remote_bdev_bufs += add->num_remote_bdev_bufs;
+	total->num_buf_waits += add->num_buf_waits;
+	total->buf_wait_ticks += add->buf_wait_ticks;
 }
 
 static void
@@ -2168,6 +2405,7 @@ spdk_bdev_channel_destroy(void *io_device, void *ctx_buf)
 	struct spdk_bdev_channel	*ch = ctx_buf;
 	struct spdk_bdev_mgmt_channel	*mgmt_ch;
 	struct spdk_bdev_shared_resource *shared_resource = ch->shared_resource;
+	uint32_t			i;
 
 	SPDK_DEBUGLOG(SPDK_LOG_BDEV, "Destroying channel %p for bdev %s on thread %p\n", ch, ch->bdev->name,
 		      spdk_get_thread());
@@ -2181,8 +2419,9 @@ spdk_bdev_channel_destroy(void *io_device, void *ctx_buf)
 
 	_spdk_bdev_abort_queued_io(&ch->queued_resets, ch);
 	_spdk_bdev_abort_queued_io(&shared_resource->nomem_io, ch);
-	_spdk_bdev_abort_buf_io(&mgmt_ch->need_buf_small, ch);
-	_spdk_bdev_abort_buf_io(&mgmt_ch->need_buf_large, ch);
+	for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+		_spdk_bdev_abort_buf_io(&mgmt_ch->need_buf[i], ch);
+	}
 
 	if (ch->histogram) {
 		spdk_histogram_data_free(ch->histogram);
@@ -2332,6 +2571,16 @@ spdk_bdev_get_optimal_io_boundary(const struct spdk_bdev *bdev)
 	return bdev->optimal_io_boundary;
 }
 
+int
+spdk_bdev_get_numa_id(const struct spdk_bdev *bdev)
+{
+	if (!bdev->numa.enabled) {
+		return SPDK_ENV_SOCKET_ID_ANY;
+	}
+
+	return bdev->numa.id;
+}
+
 bool
 spdk_bdev_has_write_cache(const struct spdk_bdev *bdev)
 {
@@ -2474,7 +2723,7 @@ spdk_bdev_set_qd_sampling_period(struct spdk_bdev *bdev, uint64_t period)
 	}
 
 	if (period != 0) {
-		bdev->internal.qd_poller = spdk_poller_register(spdk_bdev_calculate_measured_queue_depth, bdev,
+		bdev->internal.qd_poller = SPDK_POLLER_REGISTER(spdk_bdev_calculate_measured_queue_depth, bdev,
 					   period);
 	}
 }
@@ -2923,6 +3172,7 @@ _spdk_bdev_reset_freeze_channel(struct spdk_io_channel_iter *i)
 	struct spdk_bdev_mgmt_channel	*mgmt_channel;
 	struct spdk_bdev_shared_resource *shared_resource;
 	bdev_io_tailq_t			tmp_queued;
+	uint32_t			buf_class;
 
 	TAILQ_INIT(&tmp_queued);
 
@@ -2946,8 +3196,9 @@ _spdk_bdev_reset_freeze_channel(struct spdk_io_channel_iter *i)
 	}
 
 	_spdk_bdev_abort_queued_io(&shared_resource->nomem_io, channel);
-	_spdk_bdev_abort_buf_io(&mgmt_channel->need_buf_small, channel);
-	_spdk_bdev_abort_buf_io(&mgmt_channel->need_buf_large, channel);
+	for (buf_class = 0; buf_class < SPDK_BDEV_BUF_NUM_CLASSES; buf_class++) {
+		_spdk_bdev_abort_buf_io(&mgmt_channel->need_buf[buf_class], channel);
+	}
 	_spdk_bdev_abort_queued_io(&tmp_queued, channel);
 
 	spdk_for_each_channel_continue(i, 0);
@@ -3198,7 +3449,7 @@ spdk_bdev_queue_io_wait(struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 		return -EINVAL;
 	}
 
-	if (mgmt_ch->per_thread_cache_count > 0) {
+	if (spdk_slab_cache_count(mgmt_ch->bdev_io_cache) > 0) {
 		SPDK_ERRLOG("Cannot queue io_wait if spdk_bdev_io available in per-thread cache\n");
 		return -EINVAL;
 	}
@@ -3640,10 +3891,10 @@ spdk_bdev_init(struct spdk_bdev *bdev)
 	if (spdk_bdev_get_buf_align(bdev) > 1) {
 		if (bdev->split_on_optimal_io_boundary) {
 			bdev->optimal_io_boundary = spdk_min(bdev->optimal_io_boundary,
-							     SPDK_BDEV_LARGE_BUF_MAX_SIZE / bdev->blocklen);
+							     _bdev_buf_max_size() / bdev->blocklen);
 		} else {
 			bdev->split_on_optimal_io_boundary = true;
-			bdev->optimal_io_boundary = SPDK_BDEV_LARGE_BUF_MAX_SIZE / bdev->blocklen;
+			bdev->optimal_io_boundary = _bdev_buf_max_size() / bdev->blocklen;
 		}
 	}
 
@@ -53,6 +53,16 @@ struct ftl_bdev {
 
 	struct nvme_bdev_ctrlr		*ctrlr;
 
+	/* Base bdev's descriptor (when emulating Open-Channel device) */
+	struct spdk_bdev_desc		*base_desc;
+
+	/* Size of the memory used for the L2P (0 if it's not limited) */
+	size_t				l2p_cache_size;
+
+	/* Writes of at least this many bytes are placed in the cold stream */
+	/* (0 if stream placement is disabled) */
+	size_t				cold_write_size;
+
 	struct spdk_ftl_dev		*dev;
 
 	ftl_bdev_init_fn		init_cb;
@@ -152,6 +162,10 @@ out:
 static void
 bdev_ftl_remove_ctrlr(struct nvme_bdev_ctrlr *ctrlr)
 {
+	if (!ctrlr) {
+		return;
+	}
+
 	pthread_mutex_lock(&g_bdev_nvme_mutex);
 
 	if (--ctrlr->ref == 0) {
@@ -168,6 +182,17 @@ out:
 	pthread_mutex_unlock(&g_bdev_nvme_mutex);
 }
 
+static void
+bdev_ftl_close_base_bdev(struct spdk_bdev_desc *desc)
+{
+	if (!desc) {
+		return;
+	}
+
+	spdk_bdev_module_release_bdev(spdk_bdev_desc_get_bdev(desc));
+	spdk_bdev_close(desc);
+}
+
 static void
 bdev_ftl_free_cb(void *ctx, int status)
 {
@@ -182,6 +207,7 @@ bdev_ftl_free_cb(void *ctx, int status)
 	spdk_io_device_unregister(ftl_bdev, NULL);
 
 	bdev_ftl_remove_ctrlr(ftl_bdev->ctrlr);
+	bdev_ftl_close_base_bdev(ftl_bdev->base_desc);
 
 	spdk_bdev_destruct_done(&ftl_bdev->bdev, status);
 	free(ftl_bdev->bdev.name);
@@ -271,6 +297,19 @@ bdev_ftl_readv(struct ftl_bdev *ftl_bdev, struct spdk_io_channel *ch,
 			     bio->u.bdev.iovs, bio->u.bdev.iovcnt, bdev_ftl_cb, io);
 }
 
+static enum spdk_ftl_stream
+bdev_ftl_write_stream(const struct ftl_bdev *ftl_bdev, const struct spdk_bdev_io *bio)
+{
+	/* The bdev layer doesn't carry any lifetime hints, so assume large writes */
+	/* are bulk data that's rarely overwritten */
+	if (ftl_bdev->cold_write_size &&
+	    bio->u.bdev.num_blocks * ftl_bdev->bdev.blocklen >= ftl_bdev->cold_write_size) {
+		return SPDK_FTL_STREAM_USER_COLD;
+	}
+
+	return SPDK_FTL_STREAM_USER_HOT;
+}
+
 static int
 bdev_ftl_writev(struct ftl_bdev *ftl_bdev, struct spdk_io_channel *ch,
 		struct ftl_bdev_io *io)
@@ -287,12 +326,14 @@ bdev_ftl_writev(struct ftl_bdev *ftl_bdev, struct spdk_io_channel *ch,
 		return rc;
 	}
 
-	return spdk_ftl_write(ftl_bdev->dev,
-			      ioch->ioch,
-			      bio->u.bdev.offset_blocks,
-			      bio->u.bdev.num_blocks,
-			      bio->u.bdev.iovs,
-			      bio->u.bdev.iovcnt, bdev_ftl_cb, io);
+	return spdk_ftl_write_stream(ftl_bdev->dev,
+				     ioch->ioch,
+				     bio->u.bdev.offset_blocks,
+				     bio->u.bdev.num_blocks,
+				     bio->u.bdev.iovs,
+				     bio->u.bdev.iovcnt,
+				     bdev_ftl_write_stream(ftl_bdev, bio),
+				     bdev_ftl_cb, io);
 }
 
 static void
@@ -403,27 +444,79 @@ bdev_ftl_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w
 	spdk_json_write_named_object_begin(w, "params");
 	spdk_json_write_named_string(w, "name", ftl_bdev->bdev.name);
 
-	trtype_str = spdk_nvme_transport_id_trtype_str(ftl_bdev->ctrlr->trid.trtype);
-	if (trtype_str) {
-		spdk_json_write_named_string(w, "trtype", trtype_str);
+	if (ftl_bdev->base_desc) {
+		spdk_json_write_named_string(w, "base_bdev",
+					     spdk_bdev_get_name(spdk_bdev_desc_get_bdev(ftl_bdev->base_desc)));
+		if (ftl_bdev->l2p_cache_size) {
+			spdk_json_write_named_uint64(w, "l2p_cache_size", ftl_bdev->l2p_cache_size);
+		}
+	} else {
+		trtype_str = spdk_nvme_transport_id_trtype_str(ftl_bdev->ctrlr->trid.trtype);
+		if (trtype_str) {
+			spdk_json_write_named_string(w, "trtype", trtype_str);
+		}
+		spdk_json_write_named_string(w, "traddr", ftl_bdev->ctrlr->trid.traddr);
 	}
-	spdk_json_write_named_string(w, "traddr", ftl_bdev->ctrlr->trid.traddr);
 
 	spdk_json_write_named_string_fmt(w, "punits", "%d-%d", attrs.range.begin, attrs.range.end);
 
 	spdk_uuid_fmt_lower(uuid, sizeof(uuid), &attrs.uuid);
 	spdk_json_write_named_string(w, "uuid", uuid);
 
+	if (ftl_bdev->cold_write_size) {
+		spdk_json_write_named_uint64(w, "cold_write_size", ftl_bdev->cold_write_size);
+	}
+
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
 }
 
+static int
+bdev_ftl_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct ftl_bdev *ftl_bdev = ctx;
+	struct spdk_ftl_stats stats;
+	const struct spdk_ftl_stream_stats *stream;
+	const char *streams[] = {
+		[SPDK_FTL_STREAM_USER_HOT]	= "user_hot",
+		[SPDK_FTL_STREAM_USER_COLD]	= "user_cold",
+		[SPDK_FTL_STREAM_GC]		= "gc",
+	};
+	int i;
+
+	spdk_ftl_dev_get_stats(ftl_bdev->dev, &stats);
+
+	spdk_json_write_named_object_begin(w, "ftl");
+	spdk_json_write_named_array_begin(w, "streams");
+
+	for (i = 0; i < SPDK_FTL_STREAM_MAX; ++i) {
+		stream = &stats.stream[i];
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", streams[i]);
+		spdk_json_write_named_uint64(w, "user_writes", stream->write_user);
+		spdk_json_write_named_uint64(w, "total_writes", stream->write_total);
+		if (stream->write_user) {
+			spdk_json_write_named_string_fmt(w, "waf", "%.4lf",
+							 (double)stream->write_total /
+							 (double)stream->write_user);
+		}
+		spdk_json_write_object_end(w);
+	}
+
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
 static const struct spdk_bdev_fn_table ftl_fn_table = {
 	.destruct		= bdev_ftl_destruct,
 	.submit_request		= bdev_ftl_submit_request,
 	.io_type_supported	= bdev_ftl_io_type_supported,
 	.get_io_channel		= bdev_ftl_get_io_channel,
+	.dump_info_json		= bdev_ftl_dump_info_json,
 	.write_config_json	= bdev_ftl_write_config_json,
 };
 
@@ -583,7 +676,7 @@ bdev_ftl_io_channel_create_cb(void *io_device, void *ctx)
 		return -ENOMEM;
 	}
 
-	ch->poller = spdk_poller_register(bdev_ftl_poll, ch, 0);
+	ch->poller = SPDK_POLLER_REGISTER(bdev_ftl_poll, ch, 0);
 	if (!ch->poller) {
 		spdk_ring_free(ch->ring);
 		return -ENOMEM;
@@ -664,6 +757,7 @@ error_unregister:
 	spdk_io_device_unregister(ftl_bdev, NULL);
 error_dev:
 	bdev_ftl_remove_ctrlr(ftl_bdev->ctrlr);
+	bdev_ftl_close_base_bdev(ftl_bdev->base_desc);
 
 	free(ftl_bdev->bdev.name);
 	free(ftl_bdev);
@@ -673,18 +767,23 @@ error_dev:
 
 static int
 bdev_ftl_create(struct spdk_nvme_ctrlr *ctrlr, const struct spdk_nvme_transport_id *trid,
-		const char *name, struct spdk_ftl_punit_range *range, unsigned int mode,
+		struct spdk_bdev_desc *base_desc, size_t l2p_cache_size,
+		size_t cold_write_size, const char *name,
+		struct spdk_ftl_punit_range *range, unsigned int mode,
 		const struct spdk_uuid *uuid, ftl_bdev_init_fn cb, void *cb_arg)
 {
 	struct ftl_bdev *ftl_bdev = NULL;
-	struct nvme_bdev_ctrlr *ftl_ctrlr;
+	struct nvme_bdev_ctrlr *ftl_ctrlr = NULL;
 	struct spdk_ftl_dev_init_opts opts = {};
+	struct spdk_ftl_conf conf;
 	int rc;
 
-	ftl_ctrlr = bdev_ftl_add_ctrlr(ctrlr, trid);
-	if (!ftl_ctrlr) {
-		spdk_nvme_detach(ctrlr);
-		return -ENOMEM;
+	if (ctrlr) {
+		ftl_ctrlr = bdev_ftl_add_ctrlr(ctrlr, trid);
+		if (!ftl_ctrlr) {
+			spdk_nvme_detach(ctrlr);
+			return -ENOMEM;
+		}
 	}
 
 	ftl_bdev = calloc(1, sizeof(*ftl_bdev));
@@ -701,12 +800,22 @@ bdev_ftl_create(struct spdk_nvme_ctrlr *ctrlr, const struct spdk_nvme_transport_
 	}
 
 	ftl_bdev->ctrlr = ftl_ctrlr;
+	ftl_bdev->base_desc = base_desc;
+	ftl_bdev->l2p_cache_size = l2p_cache_size;
+	ftl_bdev->cold_write_size = cold_write_size;
 	ftl_bdev->init_cb = cb;
 	ftl_bdev->init_arg = cb_arg;
 
-	opts.conf = NULL;
+	spdk_ftl_conf_init_defaults(&conf);
+	conf.l2p_cache_size = l2p_cache_size;
+	conf.stream_placement = cold_write_size != 0;
+
+	opts.conf = &conf;
 	opts.ctrlr = ctrlr;
-	opts.trid = *trid;
+	if (trid) {
+		opts.trid = *trid;
+	}
+	opts.base_bdev_desc = base_desc;
 	opts.range = *range;
 	opts.mode = mode;
 	opts.uuid = *uuid;
@@ -726,6 +835,7 @@ error_name:
 	free(ftl_bdev->bdev.name);
 error_ctrlr:
 	bdev_ftl_remove_ctrlr(ftl_ctrlr);
+	bdev_ftl_close_base_bdev(base_desc);
 	free(ftl_bdev);
 	return rc;
 }
@@ -833,6 +943,56 @@ error:
 	return rc;
 }
 
+static void
+bdev_ftl_base_bdev_remove_cb(void *ctx)
+{
+	struct spdk_bdev *base_bdev = ctx;
+	struct ftl_bdev *ftl_bdev;
+
+	pthread_mutex_lock(&g_ftl_bdev_lock);
+
+	LIST_FOREACH(ftl_bdev, &g_ftl_bdevs, list_entry) {
+		if (ftl_bdev->base_desc &&
+		    spdk_bdev_desc_get_bdev(ftl_bdev->base_desc) == base_bdev) {
+			pthread_mutex_unlock(&g_ftl_bdev_lock);
+			spdk_bdev_unregister(&ftl_bdev->bdev, NULL, NULL);
+			return;
+		}
+	}
+
+	pthread_mutex_unlock(&g_ftl_bdev_lock);
+}
+
+static int
+bdev_ftl_init_emu_bdev(struct ftl_bdev_init_opts *opts, ftl_bdev_init_fn cb, void *cb_arg)
+{
+	struct spdk_bdev_desc *desc;
+	struct spdk_bdev *bdev;
+	int rc;
+
+	bdev = spdk_bdev_get_by_name(opts->base_bdev);
+	if (!bdev) {
+		SPDK_ERRLOG("Bdev %s doesn't exist\n", opts->base_bdev);
+		return -ENODEV;
+	}
+
+	rc = spdk_bdev_open(bdev, true, bdev_ftl_base_bdev_remove_cb, bdev, &desc);
+	if (rc) {
+		SPDK_ERRLOG("Unable to open bdev %s\n", opts->base_bdev);
+		return rc;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(bdev, desc, &g_ftl_if);
+	if (rc) {
+		SPDK_ERRLOG("Unable to claim bdev %s\n", opts->base_bdev);
+		spdk_bdev_close(desc);
+		return rc;
+	}
+
+	return bdev_ftl_create(NULL, NULL, desc, opts->l2p_cache_size, opts->cold_write_size,
+			       opts->name, &opts->range, opts->mode, &opts->uuid, cb, cb_arg);
+}
+
 int
 bdev_ftl_init_bdev(struct ftl_bdev_init_opts *opts, ftl_bdev_init_fn cb, void *cb_arg)
 {
@@ -842,14 +1002,19 @@ bdev_ftl_init_bdev(struct ftl_bdev_init_opts *opts, ftl_bdev_init_fn cb, void *c
 	assert(opts != NULL);
 	assert(cb != NULL);
 
+	if (opts->base_bdev) {
+		return bdev_ftl_init_emu_bdev(opts, cb, cb_arg);
+	}
+
 	pthread_mutex_lock(&g_bdev_nvme_mutex);
 
 	/* Check already attached controllers first */
 	TAILQ_FOREACH(ftl_ctrlr, &g_nvme_bdev_ctrlrs, tailq) {
 		if (!spdk_nvme_transport_id_compare(&ftl_ctrlr->trid, &opts->trid)) {
 			pthread_mutex_unlock(&g_bdev_nvme_mutex);
-			return bdev_ftl_create(ftl_ctrlr->ctrlr, &ftl_ctrlr->trid, opts->name,
-					       &opts->range, opts->mode, &opts->uuid, cb, cb_arg);
+			return bdev_ftl_create(ftl_ctrlr->ctrlr, &ftl_ctrlr->trid, NULL, 0,
+					       opts->cold_write_size, opts->name, &opts->range,
+					       opts->mode, &opts->uuid, cb, cb_arg);
 		}
 	}
 
@@ -865,8 +1030,8 @@ bdev_ftl_init_bdev(struct ftl_bdev_init_opts *opts, ftl_bdev_init_fn cb, void *c
 		return -EPERM;
 	}
 
-	return bdev_ftl_create(ctrlr, &opts->trid, opts->name, &opts->range,
-			       opts->mode, &opts->uuid, cb, cb_arg);
+	return bdev_ftl_create(ctrlr, &opts->trid, NULL, 0, opts->cold_write_size, opts->name,
+			       &opts->range, opts->mode, &opts->uuid, cb, cb_arg);
 }
 
 void
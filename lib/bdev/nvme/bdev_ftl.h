@@ -54,6 +54,12 @@ struct ftl_bdev_info {
 struct ftl_bdev_init_opts {
 	/* NVMe controller's transport ID */
 	struct spdk_nvme_transport_id		trid;
+	/* Base bdev's name, used instead of trid to emulate Open-Channel device */
+	const char				*base_bdev;
+	/* Memory limit for the L2P table (emulated devices only, 0 means no limit) */
+	size_t					l2p_cache_size;
+	/* Writes of at least this many bytes go to the cold stream (0 disables streams) */
+	size_t					cold_write_size;
 	/* Parallel unit range */
 	struct spdk_ftl_punit_range		range;
 	/* Bdev's name */
@@ -43,8 +43,11 @@ struct rpc_construct_ftl {
 	char *name;
 	char *trtype;
 	char *traddr;
+	char *base_bdev;
 	char *punits;
 	char *uuid;
+	uint64_t l2p_cache_size;
+	uint64_t cold_write_size;
 };
 
 static void
@@ -53,16 +56,26 @@ free_rpc_construct_ftl(struct rpc_construct_ftl *req)
 	free(req->name);
 	free(req->trtype);
 	free(req->traddr);
+	free(req->base_bdev);
 	free(req->punits);
 	free(req->uuid);
 }
 
 static const struct spdk_json_object_decoder rpc_construct_ftl_decoders[] = {
 	{"name", offsetof(struct rpc_construct_ftl, name), spdk_json_decode_string},
-	{"trtype", offsetof(struct rpc_construct_ftl, trtype), spdk_json_decode_string},
-	{"traddr", offsetof(struct rpc_construct_ftl, traddr), spdk_json_decode_string},
+	{"trtype", offsetof(struct rpc_construct_ftl, trtype), spdk_json_decode_string, true},
+	{"traddr", offsetof(struct rpc_construct_ftl, traddr), spdk_json_decode_string, true},
+	{"base_bdev", offsetof(struct rpc_construct_ftl, base_bdev), spdk_json_decode_string, true},
 	{"punits", offsetof(struct rpc_construct_ftl, punits), spdk_json_decode_string},
 	{"uuid", offsetof(struct rpc_construct_ftl, uuid), spdk_json_decode_string, true},
+	{
+		"l2p_cache_size", offsetof(struct rpc_construct_ftl, l2p_cache_size),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"cold_write_size", offsetof(struct rpc_construct_ftl, cold_write_size),
+		spdk_json_decode_uint64, true
+	},
 };
 
 #define FTL_RANGE_MAX_LENGTH 32
@@ -113,25 +126,44 @@ spdk_rpc_construct_ftl_bdev(struct spdk_jsonrpc_request *request,
 
 	opts.name = req.name;
 	opts.mode = SPDK_FTL_MODE_CREATE;
+	opts.cold_write_size = req.cold_write_size;
 
-	/* Parse trtype */
-	rc = spdk_nvme_transport_id_parse_trtype(&opts.trid.trtype, req.trtype);
-	if (rc) {
-		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
-						     "Failed to parse trtype: %s, rc: %s",
-						     req.trtype, spdk_strerror(-rc));
+	if (!req.base_bdev == !req.traddr) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Either traddr or base_bdev has to be provided");
 		goto invalid;
 	}
 
-	if (opts.trid.trtype != SPDK_NVME_TRANSPORT_PCIE) {
-		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
-						     "Invalid trtype: %s. Only PCIe is supported",
-						     req.trtype);
+	if (req.l2p_cache_size && !req.base_bdev) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "l2p_cache_size is only supported with base_bdev");
 		goto invalid;
 	}
 
-	/* Parse traddr */
-	snprintf(opts.trid.traddr, sizeof(opts.trid.traddr), "%s", req.traddr);
+	if (req.base_bdev) {
+		opts.base_bdev = req.base_bdev;
+		opts.l2p_cache_size = req.l2p_cache_size;
+	} else {
+		/* Parse trtype */
+		rc = spdk_nvme_transport_id_parse_trtype(&opts.trid.trtype,
+				req.trtype ? req.trtype : "pcie");
+		if (rc) {
+			spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							     "Failed to parse trtype: %s, rc: %s",
+							     req.trtype, spdk_strerror(-rc));
+			goto invalid;
+		}
+
+		if (opts.trid.trtype != SPDK_NVME_TRANSPORT_PCIE) {
+			spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							     "Invalid trtype: %s. Only PCIe is supported",
+							     req.trtype);
+			goto invalid;
+		}
+
+		/* Parse traddr */
+		snprintf(opts.trid.traddr, sizeof(opts.trid.traddr), "%s", req.traddr);
+	}
 	snprintf(range, sizeof(range), "%s", req.punits);
 
 	if (bdev_ftl_parse_punits(&opts.range, req.punits)) {
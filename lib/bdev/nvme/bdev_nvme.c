@@ -530,7 +530,7 @@ bdev_nvme_create_cb(void *io_device, void *ctx_buf)
 		return -1;
 	}
 
-	ch->poller = spdk_poller_register(bdev_nvme_poll, ch, 0);
+	ch->poller = SPDK_POLLER_REGISTER(bdev_nvme_poll, ch, 0);
 	return 0;
 }
 
@@ -682,6 +682,7 @@ nvme_ctrlr_create_bdev(struct nvme_bdev_ctrlr *nvme_bdev_ctrlr, uint32_t nsid)
 	const struct spdk_uuid	*uuid;
 	const struct spdk_nvme_ctrlr_data *cdata;
 	const struct spdk_nvme_ns_data *nsdata;
+	struct spdk_pci_device	*pci_dev;
 	int			rc;
 
 	cdata = spdk_nvme_ctrlr_get_data(ctrlr);
@@ -716,6 +717,12 @@ nvme_ctrlr_create_bdev(struct nvme_bdev_ctrlr *nvme_bdev_ctrlr, uint32_t nsid)
 	bdev->disk.blockcnt = spdk_nvme_ns_get_num_sectors(ns);
 	bdev->disk.optimal_io_boundary = spdk_nvme_ns_get_optimal_io_boundary(ns);
 
+	pci_dev = spdk_nvme_ctrlr_get_pci_device(ctrlr);
+	if (pci_dev != NULL && spdk_pci_device_get_socket_id(pci_dev) >= 0) {
+		bdev->disk.numa.enabled = true;
+		bdev->disk.numa.id = spdk_pci_device_get_socket_id(pci_dev);
+	}
+
 	uuid = spdk_nvme_ns_get_uuid(ns);
 	if (uuid != NULL) {
 		bdev->disk.uuid = *uuid;
@@ -960,7 +967,7 @@ create_ctrlr(struct spdk_nvme_ctrlr *ctrlr,
 
 	nvme_ctrlr_create_bdevs(nvme_bdev_ctrlr);
 
-	nvme_bdev_ctrlr->adminq_timer_poller = spdk_poller_register(bdev_nvme_poll_adminq, ctrlr,
+	nvme_bdev_ctrlr->adminq_timer_poller = SPDK_POLLER_REGISTER(bdev_nvme_poll_adminq, ctrlr,
 					       g_opts.nvme_adminq_poll_period_us);
 
 	TAILQ_INSERT_TAIL(&g_nvme_bdev_ctrlrs, nvme_bdev_ctrlr, tailq);
@@ -1088,7 +1095,7 @@ set_nvme_hotplug_period_cb(void *_ctx)
 
 	spdk_poller_unregister(&g_hotplug_poller);
 	if (ctx->enabled) {
-		g_hotplug_poller = spdk_poller_register(bdev_nvme_hotplug, NULL, ctx->period_us);
+		g_hotplug_poller = SPDK_POLLER_REGISTER(bdev_nvme_hotplug, NULL, ctx->period_us);
 	}
 
 	g_nvme_hotplug_poll_period_us = ctx->period_us;
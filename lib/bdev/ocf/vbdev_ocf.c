@@ -573,7 +573,7 @@ io_device_create_cb(void *io_device, void *ctx_buf)
 	qctx->vbdev      = vbdev;
 	qctx->cache_ch   = spdk_bdev_get_io_channel(vbdev->cache.desc);
 	qctx->core_ch    = spdk_bdev_get_io_channel(vbdev->core.desc);
-	qctx->poller     = spdk_poller_register(queue_poll, qctx, 0);
+	qctx->poller     = SPDK_POLLER_REGISTER(queue_poll, qctx, 0);
 
 	return rc;
 }
@@ -329,6 +329,7 @@ spdk_bdev_part_construct(struct spdk_bdev_part *part, struct spdk_bdev_part_base
 
 	part->internal.bdev.write_cache = base->bdev->write_cache;
 	part->internal.bdev.required_alignment = base->bdev->required_alignment;
+	part->internal.bdev.numa = base->bdev->numa;
 	part->internal.bdev.ctxt = part;
 	part->internal.bdev.module = base->module;
 	part->internal.bdev.fn_table = base->fn_table;
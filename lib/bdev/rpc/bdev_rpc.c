@@ -83,6 +83,15 @@ spdk_rpc_get_bdevs_iostat_cb(struct spdk_bdev *bdev,
 
 		spdk_json_write_named_uint64(w, "unmap_latency_ticks", stat->unmap_latency_ticks);
 
+		spdk_json_write_named_uint64(w, "num_remote_thread_bufs",
+					     stat->num_remote_thread_bufs);
+
+		spdk_json_write_named_uint64(w, "num_remote_bdev_bufs", stat->num_remote_bdev_bufs);
+
+		spdk_json_write_named_uint64(w, "num_buf_waits", stat->num_buf_waits);
+
+		spdk_json_write_named_uint64(w, "buf_wait_ticks", stat->buf_wait_ticks);
+
 		if (spdk_bdev_get_qd_sampling_period(bdev)) {
 			spdk_json_write_named_uint64(w, "queue_depth_polling_period",
 						     spdk_bdev_get_qd_sampling_period(bdev));
@@ -245,6 +254,10 @@ spdk_rpc_dump_bdev_info(struct spdk_json_write_ctx *w,
 		spdk_json_write_named_string(w, "uuid", uuid_str);
 	}
 
+	if (spdk_bdev_get_numa_id(bdev) != SPDK_ENV_SOCKET_ID_ANY) {
+		spdk_json_write_named_int32(w, "numa_id", spdk_bdev_get_numa_id(bdev));
+	}
+
 	if (spdk_bdev_get_md_size(bdev) != 0) {
 		spdk_json_write_named_uint32(w, "md_size", spdk_bdev_get_md_size(bdev));
 		spdk_json_write_named_bool(w, "md_interleave", spdk_bdev_is_md_interleaved(bdev));
@@ -144,10 +144,12 @@ void bdev_virtio_scsi_dev_list(struct spdk_json_write_ctx *write_ctx);
  * \param num_queues max number of request virtqueues to use. `vdev` will be
  * started successfully even if the host device supports less queues than requested.
  * \param queue_size depth of each queue
+ * \param poll_group reap completions of all virtio-blk queues used by a thread
+ * with a single per-thread poller instead of one poller per queue
  * \return virtio-blk bdev or NULL
  */
 struct spdk_bdev *bdev_virtio_user_blk_dev_create(const char *name, const char *path,
-		unsigned num_queues, unsigned queue_size);
+		unsigned num_queues, unsigned queue_size, bool poll_group);
 
 /**
  * Attach virtio-pci device. This creates a Virtio BLK device with the same
@@ -56,6 +56,9 @@ struct virtio_blk_dev {
 	struct spdk_bdev		bdev;
 	bool				readonly;
 	bool				unmap;
+
+	/** Reap completions through the per-thread poll group instead of a poller per channel. */
+	bool				poll_group;
 };
 
 struct virtio_blk_io_ctx {
@@ -73,10 +76,31 @@ struct bdev_virtio_blk_io_channel {
 	/** Virtqueue exclusively assigned to this channel. */
 	struct virtqueue		*vq;
 
-	/** Virtio response poller. */
+	/** Virtio response poller. NULL if the channel is polled by its thread's poll group. */
 	struct spdk_poller		*poller;
+
+	/** Poll group channel of this thread, if the device uses poll groups. */
+	struct spdk_io_channel		*group_ch;
+
+	TAILQ_ENTRY(bdev_virtio_blk_io_channel) link;
 };
 
+/*
+ * Per-thread group polling the virtqueues of all virtio-blk channels on that
+ * thread with a single poller. The used rings of all queues are reaped first
+ * and the whole batch is completed afterwards.
+ */
+struct bdev_virtio_blk_poll_group {
+	TAILQ_HEAD(, bdev_virtio_blk_io_channel)	channels;
+	struct spdk_poller				*poller;
+};
+
+/* Maximum number of completions reaped by one poll group iteration */
+#define VIRTIO_BLK_POLL_GROUP_BATCH	128
+
+/* io_device for the poll groups */
+static int g_virtio_blk_poll_groups;
+
 /* Features desired/implemented by this driver. */
 #define VIRTIO_BLK_DEV_SUPPORTED_FEATURES		\
 	(1ULL << VIRTIO_BLK_F_BLK_SIZE		|	\
@@ -88,11 +112,13 @@ struct bdev_virtio_blk_io_channel {
 	 1ULL << VHOST_USER_F_PROTOCOL_FEATURES)
 
 static int bdev_virtio_initialize(void);
+static void bdev_virtio_finish(void);
 static int bdev_virtio_blk_get_ctx_size(void);
 
 static struct spdk_bdev_module virtio_blk_if = {
 	.name = "virtio_blk",
 	.module_init = bdev_virtio_initialize,
+	.module_fini = bdev_virtio_finish,
 	.get_ctx_size = bdev_virtio_blk_get_ctx_size,
 };
 
@@ -330,6 +356,10 @@ bdev_virtio_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx
 	/* Write transport specific parameters. */
 	bvdev->vdev.backend_ops->write_json_config(&bvdev->vdev, w);
 
+	if (bvdev->poll_group) {
+		spdk_json_write_named_bool(w, "poll_group", true);
+	}
+
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -369,18 +399,70 @@ bdev_virtio_poll(void *arg)
 	return cnt;
 }
 
+static int
+bdev_virtio_poll_group_poll(void *arg)
+{
+	struct bdev_virtio_blk_poll_group *group = arg;
+	struct bdev_virtio_blk_io_channel *ch;
+	void *io[VIRTIO_BLK_POLL_GROUP_BATCH];
+	uint32_t io_len[VIRTIO_BLK_POLL_GROUP_BATCH];
+	uint16_t i, cnt = 0;
+
+	TAILQ_FOREACH(ch, &group->channels, link) {
+		if (cnt == SPDK_COUNTOF(io)) {
+			break;
+		}
+
+		cnt += virtio_recv_pkts(ch->vq, &io[cnt], &io_len[cnt], SPDK_COUNTOF(io) - cnt);
+	}
+
+	/* Start with the next queue on the next iteration so a busy queue can't starve the others. */
+	ch = TAILQ_FIRST(&group->channels);
+	if (ch != NULL && TAILQ_NEXT(ch, link) != NULL) {
+		TAILQ_REMOVE(&group->channels, ch, link);
+		TAILQ_INSERT_TAIL(&group->channels, ch, link);
+	}
+
+	for (i = 0; i < cnt; ++i) {
+		bdev_virtio_io_cpl(io[i]);
+	}
+
+	return cnt;
+}
+
+static int
+bdev_virtio_poll_group_create_cb(void *io_device, void *ctx_buf)
+{
+	struct bdev_virtio_blk_poll_group *group = ctx_buf;
+
+	TAILQ_INIT(&group->channels);
+	group->poller = SPDK_POLLER_REGISTER(bdev_virtio_poll_group_poll, group, 0);
+	return 0;
+}
+
+static void
+bdev_virtio_poll_group_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct bdev_virtio_blk_poll_group *group = ctx_buf;
+
+	assert(TAILQ_EMPTY(&group->channels));
+	spdk_poller_unregister(&group->poller);
+}
+
 static int
 bdev_virtio_blk_ch_create_cb(void *io_device, void *ctx_buf)
 {
 	struct virtio_blk_dev *bvdev = io_device;
 	struct virtio_dev *vdev = &bvdev->vdev;
 	struct bdev_virtio_blk_io_channel *ch = ctx_buf;
+	struct bdev_virtio_blk_poll_group *group;
 	struct virtqueue *vq;
 	int32_t queue_idx;
 
 	queue_idx = virtio_dev_find_and_acquire_queue(vdev, 0);
 	if (queue_idx < 0) {
-		SPDK_ERRLOG("Couldn't get an unused queue for the io_channel.\n");
+		SPDK_ERRLOG("%s: couldn't get an unused queue for the io_channel, "
+			    "all %"PRIu16" queues are in use.\n", vdev->name, vdev->max_queues);
 		return -1;
 	}
 
@@ -389,7 +471,20 @@ bdev_virtio_blk_ch_create_cb(void *io_device, void *ctx_buf)
 	ch->vdev = vdev;
 	ch->vq = vq;
 
-	ch->poller = spdk_poller_register(bdev_virtio_poll, ch, 0);
+	if (bvdev->poll_group) {
+		ch->group_ch = spdk_get_io_channel(&g_virtio_blk_poll_groups);
+		if (ch->group_ch == NULL) {
+			SPDK_ERRLOG("%s: couldn't get the poll group channel.\n", vdev->name);
+			virtio_dev_release_queue(vdev, queue_idx);
+			return -1;
+		}
+
+		group = spdk_io_channel_get_ctx(ch->group_ch);
+		TAILQ_INSERT_TAIL(&group->channels, ch, link);
+		return 0;
+	}
+
+	ch->poller = SPDK_POLLER_REGISTER(bdev_virtio_poll, ch, 0);
 	return 0;
 }
 
@@ -400,8 +495,16 @@ bdev_virtio_blk_ch_destroy_cb(void *io_device, void *ctx_buf)
 	struct virtio_dev *vdev = &bvdev->vdev;
 	struct bdev_virtio_blk_io_channel *ch = ctx_buf;
 	struct virtqueue *vq = ch->vq;
+	struct bdev_virtio_blk_poll_group *group;
+
+	if (ch->group_ch != NULL) {
+		group = spdk_io_channel_get_ctx(ch->group_ch);
+		TAILQ_REMOVE(&group->channels, ch, link);
+		spdk_put_io_channel(ch->group_ch);
+	} else {
+		spdk_poller_unregister(&ch->poller);
+	}
 
-	spdk_poller_unregister(&ch->poller);
 	virtio_dev_release_queue(vdev, vq->vq_queue_index);
 }
 
@@ -584,7 +687,7 @@ virtio_pci_blk_dev_create(const char *name, struct virtio_pci_ctx *pci_ctx)
 
 static struct virtio_blk_dev *
 virtio_user_blk_dev_create(const char *name, const char *path,
-			   uint16_t num_queues, uint32_t queue_size)
+			   uint16_t num_queues, uint32_t queue_size, bool poll_group)
 {
 	struct virtio_blk_dev *bvdev;
 	int rc;
@@ -595,6 +698,8 @@ virtio_user_blk_dev_create(const char *name, const char *path,
 		return NULL;
 	}
 
+	bvdev->poll_group = poll_group;
+
 	rc = virtio_user_dev_init(&bvdev->vdev, name, path, queue_size);
 	if (rc != 0) {
 		SPDK_ERRLOG("Failed to create virito device %s: %s\n", name, path);
@@ -673,9 +778,14 @@ bdev_virtio_initialize(void)
 	char *path, *type, *name;
 	unsigned vdev_num;
 	int num_queues;
-	bool enable_pci;
+	bool enable_pci, poll_group;
 	int rc = 0;
 
+	spdk_io_device_register(&g_virtio_blk_poll_groups, bdev_virtio_poll_group_create_cb,
+				bdev_virtio_poll_group_destroy_cb,
+				sizeof(struct bdev_virtio_blk_poll_group),
+				"virtio_blk_poll_groups");
+
 	for (sp = spdk_conf_first_section(NULL); sp != NULL; sp = spdk_conf_next_section(sp)) {
 		if (!spdk_conf_section_match_prefix(sp, "VirtioUser")) {
 			continue;
@@ -703,13 +813,15 @@ bdev_virtio_initialize(void)
 			num_queues = 1;
 		}
 
+		poll_group = spdk_conf_section_get_boolval(sp, "PollGroup", false);
+
 		name = spdk_conf_section_get_val(sp, "Name");
 		if (name == NULL) {
 			default_name = spdk_sprintf_alloc("VirtioBlk%u", vdev_num);
 			name = default_name;
 		}
 
-		bvdev = virtio_user_blk_dev_create(name, path, num_queues, 512);
+		bvdev = virtio_user_blk_dev_create(name, path, num_queues, 512, poll_group);
 		free(default_name);
 		default_name = NULL;
 
@@ -732,13 +844,19 @@ bdev_virtio_initialize(void)
 	return rc;
 }
 
+static void
+bdev_virtio_finish(void)
+{
+	spdk_io_device_unregister(&g_virtio_blk_poll_groups, NULL);
+}
+
 struct spdk_bdev *
 bdev_virtio_user_blk_dev_create(const char *name, const char *path,
-				unsigned num_queues, unsigned queue_size)
+				unsigned num_queues, unsigned queue_size, bool poll_group)
 {
 	struct virtio_blk_dev *bvdev;
 
-	bvdev = virtio_user_blk_dev_create(name, path, num_queues, queue_size);
+	bvdev = virtio_user_blk_dev_create(name, path, num_queues, queue_size, poll_group);
 	if (bvdev == NULL) {
 		return NULL;
 	}
@@ -135,6 +135,7 @@ struct rpc_construct_virtio_dev {
 	char *dev_type;
 	uint32_t vq_count;
 	uint32_t vq_size;
+	bool poll_group;
 	struct spdk_jsonrpc_request *request;
 };
 
@@ -145,6 +146,7 @@ static const struct spdk_json_object_decoder rpc_construct_virtio_dev[] = {
 	{"dev_type", offsetof(struct rpc_construct_virtio_dev, dev_type), spdk_json_decode_string },
 	{"vq_count", offsetof(struct rpc_construct_virtio_dev, vq_count), spdk_json_decode_uint32, true },
 	{"vq_size", offsetof(struct rpc_construct_virtio_dev, vq_size), spdk_json_decode_uint32, true },
+	{"poll_group", offsetof(struct rpc_construct_virtio_dev, poll_group), spdk_json_decode_bool, true },
 };
 
 static void
@@ -237,12 +239,20 @@ spdk_rpc_create_virtio_dev(struct spdk_jsonrpc_request *request,
 		goto invalid;
 	}
 
+	if (req->poll_group && (pci || strcmp(req->dev_type, "blk") != 0)) {
+		SPDK_ERRLOG("Poll groups are supported only for virtio-user blk devices\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "poll_group is allowed only for user transport type blk devices.");
+		goto invalid;
+	}
+
 	req->request = request;
 	if (strcmp(req->dev_type, "blk") == 0) {
 		if (pci) {
 			bdev = bdev_virtio_pci_blk_dev_create(req->name, &pci_addr);
 		} else {
-			bdev = bdev_virtio_user_blk_dev_create(req->name, req->traddr, req->vq_count, req->vq_size);
+			bdev = bdev_virtio_user_blk_dev_create(req->name, req->traddr, req->vq_count, req->vq_size,
+							       req->poll_group);
 		}
 
 		/* Virtio blk doesn't use callback so call it manually to send result. */
@@ -60,14 +60,12 @@ static int g_fs_count = 0;
 static pthread_mutex_t g_cache_init_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_spinlock_t g_caches_lock;
 
-void
-spdk_cache_buffer_free(struct cache_buffer *cache_buffer)
-{
-	spdk_mempool_put(g_cache_pool, cache_buffer->buf);
-	free(cache_buffer);
-}
-
 #define CACHE_READAHEAD_THRESHOLD	(128 * 1024)
+/* Bounds of the per-file readahead window, in cache buffers */
+#define CACHE_READAHEAD_MIN_BUFFERS	2
+#define CACHE_READAHEAD_MAX_BUFFERS	16
+/* Initial number of buckets of the file name hash, must be a power of 2 */
+#define FILE_HASH_MIN_BUCKETS		64
 
 struct spdk_file {
 	struct spdk_filesystem	*fs;
@@ -80,8 +78,14 @@ struct spdk_file {
 	uint64_t		append_pos;
 	uint64_t		seq_byte_count;
 	uint64_t		next_seq_offset;
+	uint32_t		readahead_buffers;
 	uint32_t		priority;
+	uint64_t		cache_buffers;
+	uint64_t		cache_hits;
+	uint64_t		cache_misses;
 	TAILQ_ENTRY(spdk_file)	tailq;
+	uint32_t		name_hash;
+	TAILQ_ENTRY(spdk_file)	hash_tailq;
 	spdk_blob_id		blobid;
 	uint32_t		ref_count;
 	pthread_spinlock_t	lock;
@@ -92,14 +96,68 @@ struct spdk_file {
 	TAILQ_ENTRY(spdk_file)	cache_tailq;
 };
 
+/*
+ * Cached buffers of all files, one least recently used list per priority
+ *  class. Protected by g_caches_lock.
+ */
+#define CACHE_NUM_CLASSES	(SPDK_FILE_PRIORITY_PINNED + 1)
+static struct {
+	TAILQ_HEAD(, cache_buffer)	buffers;
+	uint64_t			count;
+} g_cache_lru[CACHE_NUM_CLASSES];
+static uint64_t g_cache_evictions;
+static uint64_t g_cache_hits;
+static uint64_t g_cache_misses;
+
+static void
+cache_buffer_lru_insert(struct spdk_file *file, struct cache_buffer *cache_buffer)
+{
+	cache_buffer->lru_class = file->priority;
+	TAILQ_INSERT_TAIL(&g_cache_lru[cache_buffer->lru_class].buffers, cache_buffer, lru_tailq);
+	g_cache_lru[cache_buffer->lru_class].count++;
+}
+
+static void
+cache_buffer_lru_remove(struct cache_buffer *cache_buffer)
+{
+	TAILQ_REMOVE(&g_cache_lru[cache_buffer->lru_class].buffers, cache_buffer, lru_tailq);
+	g_cache_lru[cache_buffer->lru_class].count--;
+}
+
+/* Called with g_caches_lock held. */
+void
+spdk_cache_buffer_free(struct cache_buffer *cache_buffer)
+{
+	if (cache_buffer->file != NULL) {
+		cache_buffer_lru_remove(cache_buffer);
+		cache_buffer->file->cache_buffers--;
+	}
+	spdk_mempool_put(g_cache_pool, cache_buffer->buf);
+	free(cache_buffer);
+}
+
 struct spdk_deleted_file {
 	spdk_blob_id	id;
 	TAILQ_ENTRY(spdk_deleted_file)	tailq;
 };
 
+TAILQ_HEAD(file_hash_bucket, spdk_file);
+
 struct spdk_filesystem {
 	struct spdk_blob_store	*bs;
 	TAILQ_HEAD(, spdk_file)	files;
+
+	/*
+	 * Index of files by name. It is only modified on the metadata thread,
+	 *  with files_lock held, so that other threads can look files up under
+	 *  the lock without going through the metadata thread.
+	 */
+	struct {
+		struct file_hash_bucket	*buckets;
+		uint32_t		num_buckets;
+		uint32_t		count;
+	} file_hash;
+	pthread_spinlock_t	files_lock;
 	struct spdk_bs_opts	bs_opts;
 	struct spdk_bs_dev	*bdev;
 	fs_send_request_fn	send_request;
@@ -127,7 +185,6 @@ struct spdk_fs_cb_args {
 		spdk_fs_op_complete			fs_op;
 		spdk_file_op_with_handle_complete	file_op_with_handle;
 		spdk_file_op_complete			file_op;
-		spdk_file_stat_op_complete		stat_op;
 	} fn;
 	void *arg;
 	sem_t *sem;
@@ -186,9 +243,6 @@ struct spdk_fs_cb_args {
 		struct {
 			const char	*name;
 		} delete;
-		struct {
-			const char	*name;
-		} stat;
 	} op;
 };
 
@@ -203,6 +257,8 @@ spdk_fs_opts_init(struct spdk_blobfs_opts *opts)
 static void
 __initialize_cache(void)
 {
+	uint32_t i;
+
 	assert(g_cache_pool == NULL);
 
 	g_cache_pool = spdk_mempool_create("spdk_fs_cache",
@@ -216,6 +272,10 @@ __initialize_cache(void)
 		assert(false);
 	}
 	TAILQ_INIT(&g_caches);
+	for (i = 0; i < CACHE_NUM_CLASSES; i++) {
+		TAILQ_INIT(&g_cache_lru[i].buffers);
+		g_cache_lru[i].count = 0;
+	}
 	pthread_spin_init(&g_caches_lock, 0);
 }
 
@@ -252,8 +312,28 @@ struct spdk_fs_channel {
 	fs_send_request_fn		send_request;
 	bool				sync;
 	pthread_spinlock_t		lock;
+
+	/*
+	 * Thread of a polled synchronous channel. The caller polls it while it
+	 *  waits for a request instead of sleeping, so I/O can be submitted to
+	 *  the channel's own blobstore channel without the SPDK request thread.
+	 */
+	struct spdk_thread		*thread;
 };
 
+static void
+fs_channel_wait(struct spdk_fs_channel *channel)
+{
+	if (channel->thread == NULL) {
+		sem_wait(&channel->sem);
+		return;
+	}
+
+	while (sem_trywait(&channel->sem) != 0) {
+		spdk_thread_poll(channel->thread, 0, 0);
+	}
+}
+
 static struct spdk_fs_request *
 alloc_fs_request(struct spdk_fs_channel *channel)
 {
@@ -389,6 +469,14 @@ common_fs_bs_init(struct spdk_filesystem *fs, struct spdk_blob_store *bs)
 	pthread_mutex_unlock(&g_cache_init_lock);
 }
 
+static void
+fs_free(struct spdk_filesystem *fs)
+{
+	pthread_spin_destroy(&fs->files_lock);
+	free(fs->file_hash.buckets);
+	free(fs);
+}
+
 static void
 init_cb(void *ctx, struct spdk_blob_store *bs, int bserrno)
 {
@@ -399,7 +487,7 @@ init_cb(void *ctx, struct spdk_blob_store *bs, int bserrno)
 	if (bserrno == 0) {
 		common_fs_bs_init(fs, bs);
 	} else {
-		free(fs);
+		fs_free(fs);
 		fs = NULL;
 	}
 
@@ -428,12 +516,25 @@ static struct spdk_filesystem *
 fs_alloc(struct spdk_bs_dev *dev, fs_send_request_fn send_request_fn)
 {
 	struct spdk_filesystem *fs;
+	uint32_t i;
 
 	fs = calloc(1, sizeof(*fs));
 	if (fs == NULL) {
 		return NULL;
 	}
 
+	fs->file_hash.buckets = calloc(FILE_HASH_MIN_BUCKETS, sizeof(*fs->file_hash.buckets));
+	if (fs->file_hash.buckets == NULL) {
+		free(fs);
+		return NULL;
+	}
+
+	fs->file_hash.num_buckets = FILE_HASH_MIN_BUCKETS;
+	for (i = 0; i < fs->file_hash.num_buckets; i++) {
+		TAILQ_INIT(&fs->file_hash.buckets[i]);
+	}
+	pthread_spin_init(&fs->files_lock, 0);
+
 	fs->bdev = dev;
 	fs->send_request = send_request_fn;
 	TAILQ_INIT(&fs->files);
@@ -491,7 +592,7 @@ spdk_fs_init(struct spdk_bs_dev *dev, struct spdk_blobfs_opts *opt,
 		spdk_put_io_channel(fs->sync_target.sync_io_channel);
 		spdk_io_device_unregister(&fs->sync_target, NULL);
 		spdk_io_device_unregister(&fs->io_target, NULL);
-		free(fs);
+		fs_free(fs);
 		cb_fn(cb_arg, NULL, -ENOMEM);
 		return;
 	}
@@ -531,9 +632,110 @@ file_alloc(struct spdk_filesystem *fs)
 	pthread_spin_init(&file->lock, 0);
 	TAILQ_INSERT_TAIL(&fs->files, file, tailq);
 	file->priority = SPDK_FILE_PRIORITY_LOW;
+	file->readahead_buffers = CACHE_READAHEAD_MIN_BUFFERS;
 	return file;
 }
 
+static uint32_t
+file_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	/* FNV-1a */
+	while (*name != '\0') {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void
+file_hash_resize(struct spdk_filesystem *fs, uint32_t num_buckets)
+{
+	struct file_hash_bucket *buckets;
+	struct spdk_file *file;
+	uint32_t i;
+
+	buckets = calloc(num_buckets, sizeof(*buckets));
+	if (buckets == NULL) {
+		/* Keep using the current buckets, lookups just get longer chains. */
+		return;
+	}
+
+	for (i = 0; i < num_buckets; i++) {
+		TAILQ_INIT(&buckets[i]);
+	}
+
+	for (i = 0; i < fs->file_hash.num_buckets; i++) {
+		while ((file = TAILQ_FIRST(&fs->file_hash.buckets[i])) != NULL) {
+			TAILQ_REMOVE(&fs->file_hash.buckets[i], file, hash_tailq);
+			TAILQ_INSERT_TAIL(&buckets[file->name_hash & (num_buckets - 1)], file, hash_tailq);
+		}
+	}
+
+	free(fs->file_hash.buckets);
+	fs->file_hash.buckets = buckets;
+	fs->file_hash.num_buckets = num_buckets;
+}
+
+/* Add the file to the name index. fs->files_lock must be held. */
+static void
+file_hash_insert(struct spdk_filesystem *fs, struct spdk_file *file)
+{
+	if (fs->file_hash.count >= fs->file_hash.num_buckets * 2) {
+		file_hash_resize(fs, fs->file_hash.num_buckets * 2);
+	}
+
+	file->name_hash = file_name_hash(file->name);
+	TAILQ_INSERT_TAIL(&fs->file_hash.buckets[file->name_hash & (fs->file_hash.num_buckets - 1)],
+			  file, hash_tailq);
+	fs->file_hash.count++;
+}
+
+/* Remove the file from the name index. fs->files_lock must be held. */
+static void
+file_hash_remove(struct spdk_filesystem *fs, struct spdk_file *file)
+{
+	TAILQ_REMOVE(&fs->file_hash.buckets[file->name_hash & (fs->file_hash.num_buckets - 1)],
+		     file, hash_tailq);
+	fs->file_hash.count--;
+}
+
+static void
+file_set_name(struct spdk_file *file, char *name)
+{
+	struct spdk_filesystem *fs = file->fs;
+
+	pthread_spin_lock(&fs->files_lock);
+	if (file->name != NULL) {
+		file_hash_remove(fs, file);
+		free(file->name);
+	}
+	file->name = name;
+	file_hash_insert(fs, file);
+	pthread_spin_unlock(&fs->files_lock);
+}
+
+static void
+file_free(struct spdk_file *file)
+{
+	struct spdk_filesystem *fs = file->fs;
+
+	TAILQ_REMOVE(&fs->files, file, tailq);
+
+	if (file->name != NULL) {
+		pthread_spin_lock(&fs->files_lock);
+		file_hash_remove(fs, file);
+		pthread_spin_unlock(&fs->files_lock);
+		free(file->name);
+	}
+
+	cache_free_buffers(file);
+	free(file->tree);
+	free(file);
+}
+
 static void fs_load_done(void *ctx, int bserrno);
 
 static int
@@ -617,14 +819,21 @@ iter_cb(void *ctx, struct spdk_blob *blob, int rc)
 	if (rc < 0) {
 		struct spdk_file *f;
 
+		char *f_name;
+
 		f = file_alloc(fs);
-		if (f == NULL) {
+		f_name = strdup(name);
+		if (f == NULL || f_name == NULL) {
+			if (f != NULL) {
+				file_free(f);
+			}
+			free(f_name);
 			args->fn.fs_op_with_handle(args->arg, fs, -ENOMEM);
 			free_fs_request(req);
 			return;
 		}
 
-		f->name = strdup(name);
+		file_set_name(f, f_name);
 		f->blobid = spdk_blob_get_id(blob);
 		f->length = *length;
 		f->length_flushed = *length;
@@ -657,7 +866,7 @@ load_cb(void *ctx, struct spdk_blob_store *bs, int bserrno)
 	if (bserrno != 0) {
 		args->fn.fs_op_with_handle(args->arg, NULL, bserrno);
 		free_fs_request(req);
-		free(fs);
+		fs_free(fs);
 		return;
 	}
 
@@ -671,7 +880,7 @@ load_cb(void *ctx, struct spdk_blob_store *bs, int bserrno)
 		SPDK_LOGDUMP(SPDK_LOG_BLOB, "bstype", &bstype, sizeof(bstype));
 		args->fn.fs_op_with_handle(args->arg, NULL, bserrno);
 		free_fs_request(req);
-		free(fs);
+		fs_free(fs);
 		return;
 	}
 
@@ -686,7 +895,7 @@ spdk_fs_io_device_unregister(struct spdk_filesystem *fs)
 	spdk_io_device_unregister(&fs->md_target, NULL);
 	spdk_io_device_unregister(&fs->sync_target, NULL);
 	spdk_io_device_unregister(&fs->io_target, NULL);
-	free(fs);
+	fs_free(fs);
 }
 
 static void
@@ -742,11 +951,7 @@ unload_cb(void *ctx, int bserrno)
 	struct spdk_file *file, *tmp;
 
 	TAILQ_FOREACH_SAFE(file, &fs->files, tailq, tmp) {
-		TAILQ_REMOVE(&fs->files, file, tailq);
-		cache_free_buffers(file);
-		free(file->name);
-		free(file->tree);
-		free(file);
+		file_free(file);
 	}
 
 	pthread_mutex_lock(&g_cache_init_lock);
@@ -787,13 +992,18 @@ spdk_fs_unload(struct spdk_filesystem *fs, spdk_fs_op_complete cb_fn, void *cb_a
 	spdk_bs_unload(fs->bs, unload_cb, req);
 }
 
+/*
+ * Look the file up by name. On the metadata thread this needs no locking,
+ *  other threads must hold fs->files_lock.
+ */
 static struct spdk_file *
 fs_find_file(struct spdk_filesystem *fs, const char *name)
 {
 	struct spdk_file *file;
+	uint32_t hash = file_name_hash(name);
 
-	TAILQ_FOREACH(file, &fs->files, tailq) {
-		if (!strncmp(name, file->name, SPDK_FILE_NAME_MAX)) {
+	TAILQ_FOREACH(file, &fs->file_hash.buckets[hash & (fs->file_hash.num_buckets - 1)], hash_tailq) {
+		if (file->name_hash == hash && !strncmp(name, file->name, SPDK_FILE_NAME_MAX)) {
 			return file;
 		}
 	}
@@ -824,52 +1034,29 @@ spdk_fs_file_stat_async(struct spdk_filesystem *fs, const char *name,
 	cb_fn(cb_arg, NULL, -ENOENT);
 }
 
-static void
-__copy_stat(void *arg, struct spdk_file_stat *stat, int fserrno)
-{
-	struct spdk_fs_request *req = arg;
-	struct spdk_fs_cb_args *args = &req->args;
-
-	args->rc = fserrno;
-	if (fserrno == 0) {
-		memcpy(args->arg, stat, sizeof(*stat));
-	}
-	sem_post(args->sem);
-}
-
-static void
-__file_stat(void *arg)
-{
-	struct spdk_fs_request *req = arg;
-	struct spdk_fs_cb_args *args = &req->args;
-
-	spdk_fs_file_stat_async(args->fs, args->op.stat.name,
-				args->fn.stat_op, req);
-}
-
 int
 spdk_fs_file_stat(struct spdk_filesystem *fs, struct spdk_io_channel *_channel,
 		  const char *name, struct spdk_file_stat *stat)
 {
-	struct spdk_fs_channel *channel = spdk_io_channel_get_ctx(_channel);
-	struct spdk_fs_request *req;
-	int rc;
+	struct spdk_file *f;
+	int rc = -ENOENT;
 
-	req = alloc_fs_request(channel);
-	if (req == NULL) {
-		return -ENOMEM;
+	if (strnlen(name, SPDK_FILE_NAME_MAX + 1) == SPDK_FILE_NAME_MAX + 1) {
+		return -ENAMETOOLONG;
 	}
 
-	req->args.fs = fs;
-	req->args.op.stat.name = name;
-	req->args.fn.stat_op = __copy_stat;
-	req->args.arg = stat;
-	req->args.sem = &channel->sem;
-	channel->send_request(__file_stat, req);
-	sem_wait(&channel->sem);
-
-	rc = req->args.rc;
-	free_fs_request(req);
+	/*
+	 * Stat only reads in-memory state, so look the file up from the calling
+	 *  thread instead of queueing behind other metadata operations.
+	 */
+	pthread_spin_lock(&fs->files_lock);
+	f = fs_find_file(fs, name);
+	if (f != NULL) {
+		stat->blobid = f->blobid;
+		stat->size = f->append_pos >= f->length ? f->append_pos : f->length;
+		rc = 0;
+	}
+	pthread_spin_unlock(&fs->files_lock);
 
 	return rc;
 }
@@ -945,6 +1132,7 @@ spdk_fs_create_file_async(struct spdk_filesystem *fs, const char *name,
 			  spdk_file_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_file *file;
+	char *file_name;
 	struct spdk_fs_request *req;
 	struct spdk_fs_cb_args *args;
 
@@ -965,8 +1153,14 @@ spdk_fs_create_file_async(struct spdk_filesystem *fs, const char *name,
 		return;
 	}
 
+	file_name = strdup(name);
 	req = alloc_fs_request(fs->md_target.md_fs_channel);
-	if (req == NULL) {
+	if (file_name == NULL || req == NULL) {
+		if (req != NULL) {
+			free_fs_request(req);
+		}
+		free(file_name);
+		file_free(file);
 		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
@@ -976,7 +1170,7 @@ spdk_fs_create_file_async(struct spdk_filesystem *fs, const char *name,
 	args->fn.file_op = cb_fn;
 	args->arg = cb_arg;
 
-	file->name = strdup(name);
+	file_set_name(file, file_name);
 	spdk_bs_create_blob(fs->bs, fs_create_blob_create_cb, args);
 }
 
@@ -1021,7 +1215,7 @@ spdk_fs_create_file(struct spdk_filesystem *fs, struct spdk_io_channel *_channel
 	args->op.create.name = name;
 	args->sem = &channel->sem;
 	fs->send_request(__fs_create_file, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 	rc = args->rc;
 	free_fs_request(req);
 
@@ -1064,7 +1258,9 @@ fs_open_blob_create_cb(void *ctx, int bserrno)
 		args->file = file;
 	}
 
+	pthread_spin_lock(&file->lock);
 	file->ref_count++;
+	pthread_spin_unlock(&file->lock);
 	TAILQ_INSERT_TAIL(&file->open_requests, req, args.op.open.tailq);
 	if (file->ref_count == 1) {
 		assert(file->blob == NULL);
@@ -1153,10 +1349,37 @@ spdk_fs_open_file(struct spdk_filesystem *fs, struct spdk_io_channel *_channel,
 	struct spdk_fs_channel *channel = spdk_io_channel_get_ctx(_channel);
 	struct spdk_fs_request *req;
 	struct spdk_fs_cb_args *args;
+	struct spdk_file *f;
+	bool opened = false;
 	int rc;
 
 	SPDK_DEBUGLOG(SPDK_LOG_BLOBFS, "file=%s\n", name);
 
+	if (strnlen(name, SPDK_FILE_NAME_MAX + 1) == SPDK_FILE_NAME_MAX + 1) {
+		return -ENAMETOOLONG;
+	}
+
+	/*
+	 * A file that is already open only needs another reference, which can be
+	 *  taken from the calling thread without a round trip to the metadata thread.
+	 */
+	pthread_spin_lock(&fs->files_lock);
+	f = fs_find_file(fs, name);
+	if (f != NULL) {
+		pthread_spin_lock(&f->lock);
+		opened = !f->is_deleted && f->ref_count > 0 && f->blob != NULL;
+		if (opened) {
+			f->ref_count++;
+		}
+		pthread_spin_unlock(&f->lock);
+	}
+	pthread_spin_unlock(&fs->files_lock);
+
+	if (opened) {
+		*file = f;
+		return 0;
+	}
+
 	req = alloc_fs_request(channel);
 	if (req == NULL) {
 		return -ENOMEM;
@@ -1168,7 +1391,7 @@ spdk_fs_open_file(struct spdk_filesystem *fs, struct spdk_io_channel *_channel,
 	args->op.open.flags = flags;
 	args->sem = &channel->sem;
 	fs->send_request(__fs_open_file, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 	rc = args->rc;
 	if (rc == 0) {
 		*file = args->file;
@@ -1206,6 +1429,7 @@ __spdk_fs_md_rename_file(struct spdk_fs_request *req)
 {
 	struct spdk_fs_cb_args *args = &req->args;
 	struct spdk_file *f;
+	char *new_name;
 
 	f = fs_find_file(args->fs, args->op.rename.old_name);
 	if (f == NULL) {
@@ -1214,8 +1438,14 @@ __spdk_fs_md_rename_file(struct spdk_fs_request *req)
 		return;
 	}
 
-	free(f->name);
-	f->name = strdup(args->op.rename.new_name);
+	new_name = strdup(args->op.rename.new_name);
+	if (new_name == NULL) {
+		args->fn.fs_op(args->arg, -ENOMEM);
+		free_fs_request(req);
+		return;
+	}
+
+	file_set_name(f, new_name);
 	args->file = f;
 	spdk_bs_open_blob(args->fs->bs, f->blobid, fs_rename_blob_open_cb, req);
 }
@@ -1307,7 +1537,7 @@ spdk_fs_rename_file(struct spdk_filesystem *fs, struct spdk_io_channel *_channel
 	args->op.rename.new_name = new_name;
 	args->sem = &channel->sem;
 	fs->send_request(__fs_rename_file, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 	rc = args->rc;
 	free_fs_request(req);
 	return rc;
@@ -1363,15 +1593,8 @@ spdk_fs_delete_file_async(struct spdk_filesystem *fs, const char *name,
 		return;
 	}
 
-	TAILQ_REMOVE(&fs->files, f, tailq);
-
-	cache_free_buffers(f);
-
 	blobid = f->blobid;
-
-	free(f->name);
-	free(f->tree);
-	free(f);
+	file_free(f);
 
 	spdk_bs_delete_blob(fs->bs, blobid, blob_delete_cb, req);
 }
@@ -1413,7 +1636,7 @@ spdk_fs_delete_file(struct spdk_filesystem *fs, struct spdk_io_channel *_channel
 	args->op.delete.name = name;
 	args->sem = &channel->sem;
 	fs->send_request(__fs_delete_file, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 	rc = args->rc;
 	free_fs_request(req);
 
@@ -1565,7 +1788,7 @@ spdk_file_truncate(struct spdk_file *file, struct spdk_io_channel *_channel,
 	args->sem = &channel->sem;
 
 	channel->send_request(__truncate, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 	rc = args->rc;
 	free_fs_request(req);
 
@@ -1736,10 +1959,43 @@ spdk_fs_alloc_io_channel_sync(struct spdk_filesystem *fs)
 	return io_channel;
 }
 
+struct spdk_io_channel *
+spdk_fs_alloc_io_channel_sync_polled(struct spdk_filesystem *fs)
+{
+	struct spdk_io_channel *io_channel;
+	struct spdk_fs_channel *fs_channel;
+
+	io_channel = spdk_fs_alloc_io_channel_sync(fs);
+	if (io_channel == NULL) {
+		return NULL;
+	}
+
+	fs_channel = spdk_io_channel_get_ctx(io_channel);
+	if (fs_channel->bs_channel == NULL) {
+		fs_channel->bs_channel = spdk_bs_alloc_io_channel(fs->bs);
+		if (fs_channel->bs_channel == NULL) {
+			spdk_put_io_channel(io_channel);
+			return NULL;
+		}
+	}
+	fs_channel->thread = spdk_get_thread();
+
+	return io_channel;
+}
+
 void
 spdk_fs_free_io_channel(struct spdk_io_channel *channel)
 {
+	struct spdk_fs_channel *fs_channel = spdk_io_channel_get_ctx(channel);
+	struct spdk_thread *thread = fs_channel->thread;
+
 	spdk_put_io_channel(channel);
+
+	/* Nobody else polls the thread of a polled channel, so run the release here. */
+	if (thread != NULL) {
+		while (spdk_thread_poll(thread, 0, 0) > 0) {
+		}
+	}
 }
 
 void
@@ -1756,65 +2012,65 @@ spdk_fs_get_cache_size(void)
 
 static void __file_flush(void *_args);
 
-static void *
-alloc_cache_memory_buffer(struct spdk_file *context)
+/*
+ * Evict the least recently used clean buffer, taking low priority files
+ *  first and pinned files only when nothing else can be evicted. Buffers of
+ *  the context file are skipped since its lock is held by the caller.
+ */
+static bool
+cache_evict_buffer(struct spdk_file *context)
 {
+	struct cache_buffer *buf, *tmp;
 	struct spdk_file *file;
-	void *buf;
-
-	buf = spdk_mempool_get(g_cache_pool);
-	if (buf != NULL) {
-		return buf;
-	}
+	uint32_t class;
 
 	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (!file->open_for_writing &&
-		    file->priority == SPDK_FILE_PRIORITY_LOW &&
-		    file != context) {
-			break;
+	for (class = 0; class < CACHE_NUM_CLASSES; class++) {
+		TAILQ_FOREACH_SAFE(buf, &g_cache_lru[class].buffers, lru_tailq, tmp) {
+			file = buf->file;
+			if (file == context || buf->in_progress ||
+			    buf->bytes_filled != buf->bytes_flushed) {
+				continue;
+			}
+			if (file->priority != class) {
+				/* The file changed priority since the buffer was last used */
+				cache_buffer_lru_remove(buf);
+				cache_buffer_lru_insert(file, buf);
+				continue;
+			}
+			/* Lock order is file then cache, so only try the file lock here */
+			if (pthread_spin_trylock(&file->lock) != 0) {
+				continue;
+			}
+			if (file->last == buf) {
+				file->last = NULL;
+			}
+			spdk_tree_remove_buffer(file->tree, buf);
+			if (file->tree->present_mask == 0) {
+				TAILQ_REMOVE(&g_caches, file, cache_tailq);
+			}
+			g_cache_evictions++;
+			pthread_spin_unlock(&file->lock);
+			pthread_spin_unlock(&g_caches_lock);
+			return true;
 		}
 	}
 	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
-		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
-		}
-	}
 
-	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (!file->open_for_writing && file != context) {
-			break;
-		}
-	}
-	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
-		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
-		}
-	}
+	return false;
+}
 
-	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (file != context) {
-			break;
-		}
-	}
-	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
+static void *
+alloc_cache_memory_buffer(struct spdk_file *context)
+{
+	void *buf;
+
+	buf = spdk_mempool_get(g_cache_pool);
+	while (buf == NULL && cache_evict_buffer(context)) {
 		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
-		}
 	}
 
-	return NULL;
+	return buf;
 }
 
 static struct cache_buffer *
@@ -1849,12 +2105,15 @@ cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 
 	buf->buf_size = CACHE_BUFFER_SIZE;
 	buf->offset = offset;
+	buf->file = file;
 
 	pthread_spin_lock(&g_caches_lock);
 	if (file->tree->present_mask == 0) {
 		TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
 	}
 	file->tree = spdk_tree_insert_buffer(file->tree, buf);
+	cache_buffer_lru_insert(file, buf);
+	file->cache_buffers++;
 	pthread_spin_unlock(&g_caches_lock);
 
 	return buf;
@@ -2095,24 +2354,53 @@ __rw_from_file(void *_args)
 	}
 }
 
+/*
+ * Whether all data of the file is on disk and nobody writes to it. Reads
+ *  may only bypass the SPDK request thread then, since writes, flushes and
+ *  extends of the file are ordered on that thread.
+ */
+static bool
+__file_is_flushed(struct spdk_file *file)
+{
+	bool flushed;
+
+	pthread_spin_lock(&file->lock);
+	flushed = !file->open_for_writing && file->append_pos <= file->length_flushed;
+	pthread_spin_unlock(&file->lock);
+
+	return flushed;
+}
+
 static int
-__send_rw_from_file(struct spdk_file *file, sem_t *sem, void *payload,
+__send_rw_from_file(struct spdk_file *file, struct spdk_fs_channel *channel, void *payload,
 		    uint64_t offset, uint64_t length, bool is_read)
 {
 	struct spdk_fs_cb_args *args;
 
 	args = calloc(1, sizeof(*args));
 	if (args == NULL) {
-		sem_post(sem);
+		sem_post(&channel->sem);
 		return -ENOMEM;
 	}
 
 	args->file = file;
-	args->sem = sem;
+	args->sem = &channel->sem;
 	args->op.rw.user_buf = payload;
 	args->op.rw.offset = offset;
 	args->op.rw.length = length;
 	args->op.rw.is_read = is_read;
+
+	if (is_read && channel->thread != NULL && __file_is_flushed(file)) {
+		/*
+		 * The caller polls its own thread while waiting, so read through
+		 *  its own blobstore channel. Reads from different threads then
+		 *  run in parallel instead of queueing on the SPDK request thread.
+		 */
+		spdk_file_read_async(file, spdk_io_channel_from_ctx(channel), payload, offset, length,
+				     __rw_from_file_done, args);
+		return 0;
+	}
+
 	file->fs->send_request(__rw_from_file, args);
 	return 0;
 }
@@ -2150,9 +2438,9 @@ spdk_file_write(struct spdk_file *file, struct spdk_io_channel *_channel,
 
 			file->append_pos += length;
 			pthread_spin_unlock(&file->lock);
-			rc = __send_rw_from_file(file, &channel->sem, payload,
+			rc = __send_rw_from_file(file, channel, payload,
 						 offset, length, false);
-			sem_wait(&channel->sem);
+			fs_channel_wait(channel);
 			return rc;
 		}
 	}
@@ -2169,7 +2457,7 @@ spdk_file_write(struct spdk_file *file, struct spdk_io_channel *_channel,
 		BLOBFS_TRACE(file, "start resize to %u clusters\n", extend_args.op.resize.num_clusters);
 		pthread_spin_unlock(&file->lock);
 		file->fs->send_request(__file_extend_blob, &extend_args);
-		sem_wait(&channel->sem);
+		fs_channel_wait(channel);
 		if (extend_args.rc) {
 			return extend_args.rc;
 		}
@@ -2265,11 +2553,10 @@ __next_cache_buffer_offset(uint64_t offset)
 }
 
 static void
-check_readahead(struct spdk_file *file, uint64_t offset)
+__readahead_buffer(struct spdk_file *file, uint64_t offset)
 {
 	struct spdk_fs_cb_args *args;
 
-	offset = __next_cache_buffer_offset(offset);
 	if (spdk_tree_find_buffer(file->tree, offset) != NULL || file->length <= offset) {
 		return;
 	}
@@ -2299,16 +2586,81 @@ check_readahead(struct spdk_file *file, uint64_t offset)
 	file->fs->send_request(__readahead, args);
 }
 
+static void
+check_readahead(struct spdk_file *file, uint64_t offset, uint64_t length)
+{
+	uint64_t window;
+	uint32_t i;
+
+	if (offset != file->next_seq_offset) {
+		file->seq_byte_count = 0;
+		file->readahead_buffers = CACHE_READAHEAD_MIN_BUFFERS;
+	}
+	file->seq_byte_count += length;
+	file->next_seq_offset = offset + length;
+	if (file->seq_byte_count < CACHE_READAHEAD_THRESHOLD) {
+		return;
+	}
+
+	/*
+	 * Double the window each time the stream has consumed a whole window
+	 *  past the detection threshold, so long sequential scans such as
+	 *  compaction inputs keep more reads in flight.
+	 */
+	window = (uint64_t)file->readahead_buffers * CACHE_BUFFER_SIZE;
+	if (file->readahead_buffers < CACHE_READAHEAD_MAX_BUFFERS &&
+	    file->seq_byte_count >= CACHE_READAHEAD_THRESHOLD + window) {
+		file->readahead_buffers *= 2;
+	}
+
+	offset = __next_cache_buffer_offset(offset);
+	for (i = 0; i < file->readahead_buffers; i++) {
+		__readahead_buffer(file, offset);
+		offset += CACHE_BUFFER_SIZE;
+	}
+}
+
+int
+spdk_file_prefetch(struct spdk_file *file, uint64_t offset, uint64_t length)
+{
+	uint64_t end;
+
+	if (length == 0) {
+		return 0;
+	}
+
+	/*
+	 * Fill at most the largest readahead window, and at most a quarter of
+	 *  the cache, so a large hint doesn't evict what other files are using.
+	 */
+	length = spdk_min(length, (uint64_t)CACHE_READAHEAD_MAX_BUFFERS * CACHE_BUFFER_SIZE);
+	length = spdk_min(length, g_fs_cache_size / 4);
+
+	pthread_spin_lock(&file->lock);
+	end = spdk_min(offset + length, file->length);
+	offset &= ~(CACHE_TREE_LEVEL_MASK(0));
+	while (offset < end) {
+		__readahead_buffer(file, offset);
+		offset += CACHE_BUFFER_SIZE;
+	}
+	pthread_spin_unlock(&file->lock);
+
+	return 0;
+}
+
 static int
-__file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t length, sem_t *sem)
+__file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t length,
+	    struct spdk_fs_channel *channel)
 {
 	struct cache_buffer *buf;
 	int rc;
 
 	buf = spdk_tree_find_filled_buffer(file->tree, offset);
 	if (buf == NULL) {
+		file->cache_misses++;
+		__sync_fetch_and_add(&g_cache_misses, 1);
 		pthread_spin_unlock(&file->lock);
-		rc = __send_rw_from_file(file, sem, payload, offset, length, true);
+		rc = __send_rw_from_file(file, channel, payload, offset, length, true);
 		pthread_spin_lock(&file->lock);
 		return rc;
 	}
@@ -2318,36 +2670,44 @@ __file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t len
 	}
 	BLOBFS_TRACE(file, "read %p offset=%ju length=%ju\n", payload, offset, length);
 	memcpy(payload, &buf->buf[offset - buf->offset], length);
-	if ((offset + length) % CACHE_BUFFER_SIZE == 0) {
-		pthread_spin_lock(&g_caches_lock);
+	file->cache_hits++;
+	__sync_fetch_and_add(&g_cache_hits, 1);
+
+	pthread_spin_lock(&g_caches_lock);
+	if ((offset + length) % CACHE_BUFFER_SIZE == 0 &&
+	    file->priority == SPDK_FILE_PRIORITY_LOW) {
+		/* Low priority data is assumed to be streamed, drop it once fully read */
 		spdk_tree_remove_buffer(file->tree, buf);
 		if (file->tree->present_mask == 0) {
 			TAILQ_REMOVE(&g_caches, file, cache_tailq);
 		}
-		pthread_spin_unlock(&g_caches_lock);
+	} else {
+		cache_buffer_lru_remove(buf);
+		cache_buffer_lru_insert(file, buf);
 	}
+	pthread_spin_unlock(&g_caches_lock);
 
-	sem_post(sem);
+	sem_post(&channel->sem);
 	return 0;
 }
 
-int64_t
-spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
-	       void *payload, uint64_t offset, uint64_t length)
+/*
+ * Submit the cache buffer sized pieces of one read. Must be called with
+ *  file->lock held. The number of submitted pieces is added to sub_reads;
+ *  the caller waits on the channel that many times once the lock is dropped.
+ */
+static int64_t
+__file_read_submit(struct spdk_file *file, struct spdk_fs_channel *channel, void *payload,
+		   uint64_t offset, uint64_t length, bool sequential, uint32_t *sub_reads)
 {
-	struct spdk_fs_channel *channel = spdk_io_channel_get_ctx(_channel);
 	uint64_t final_offset, final_length;
-	uint32_t sub_reads = 0;
 	int rc = 0;
 
-	pthread_spin_lock(&file->lock);
-
 	BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", offset, length);
 
 	file->open_for_writing = false;
 
 	if (length == 0 || offset >= file->append_pos) {
-		pthread_spin_unlock(&file->lock);
 		return 0;
 	}
 
@@ -2355,14 +2715,8 @@ spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
 		length = file->append_pos - offset;
 	}
 
-	if (offset != file->next_seq_offset) {
-		file->seq_byte_count = 0;
-	}
-	file->seq_byte_count += length;
-	file->next_seq_offset = offset + length;
-	if (file->seq_byte_count >= CACHE_READAHEAD_THRESHOLD) {
-		check_readahead(file, offset);
-		check_readahead(file, offset + CACHE_BUFFER_SIZE);
+	if (sequential) {
+		check_readahead(file, offset, length);
 	}
 
 	final_length = 0;
@@ -2372,7 +2726,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
 		if (length > (final_offset - offset)) {
 			length = final_offset - offset;
 		}
-		rc = __file_read(file, payload, offset, length, &channel->sem);
+		rc = __file_read(file, payload, offset, length, channel);
 		if (rc == 0) {
 			final_length += length;
 		} else {
@@ -2380,12 +2734,9 @@ spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
 		}
 		payload += length;
 		offset += length;
-		sub_reads++;
-	}
-	pthread_spin_unlock(&file->lock);
-	while (sub_reads-- > 0) {
-		sem_wait(&channel->sem);
+		(*sub_reads)++;
 	}
+
 	if (rc == 0) {
 		return final_length;
 	} else {
@@ -2393,6 +2744,53 @@ spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
 	}
 }
 
+int64_t
+spdk_file_read(struct spdk_file *file, struct spdk_io_channel *_channel,
+	       void *payload, uint64_t offset, uint64_t length)
+{
+	struct spdk_fs_channel *channel = spdk_io_channel_get_ctx(_channel);
+	uint32_t sub_reads = 0;
+	int64_t rc;
+
+	pthread_spin_lock(&file->lock);
+	rc = __file_read_submit(file, channel, payload, offset, length, true, &sub_reads);
+	pthread_spin_unlock(&file->lock);
+	while (sub_reads-- > 0) {
+		fs_channel_wait(channel);
+	}
+
+	return rc;
+}
+
+int
+spdk_file_read_multi(struct spdk_file *file, struct spdk_io_channel *_channel,
+		     struct spdk_file_read_req *reqs, uint32_t num_reqs)
+{
+	struct spdk_fs_channel *channel = spdk_io_channel_get_ctx(_channel);
+	uint32_t i, sub_reads = 0;
+	int rc = 0;
+
+	/*
+	 * Submit every range before waiting for any of them. The ranges are
+	 *  independent point reads, so they do not feed the sequential stream
+	 *  detection used for readahead.
+	 */
+	pthread_spin_lock(&file->lock);
+	for (i = 0; i < num_reqs; i++) {
+		reqs[i].rc = __file_read_submit(file, channel, reqs[i].payload, reqs[i].offset,
+						reqs[i].length, false, &sub_reads);
+		if (reqs[i].rc < 0 && rc == 0) {
+			rc = reqs[i].rc;
+		}
+	}
+	pthread_spin_unlock(&file->lock);
+	while (sub_reads-- > 0) {
+		fs_channel_wait(channel);
+	}
+
+	return rc;
+}
+
 static void
 _file_sync(struct spdk_file *file, struct spdk_fs_channel *channel,
 	   spdk_file_op_complete cb_fn, void *cb_arg)
@@ -2448,7 +2846,7 @@ spdk_file_sync(struct spdk_file *file, struct spdk_io_channel *_channel)
 
 	args.sem = &channel->sem;
 	_file_sync(file, channel, __wake_caller, &args);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 
 	return args.rc;
 }
@@ -2466,8 +2864,45 @@ void
 spdk_file_set_priority(struct spdk_file *file, uint32_t priority)
 {
 	BLOBFS_TRACE(file, "priority=%u\n", priority);
+	if (priority > SPDK_FILE_PRIORITY_PINNED) {
+		priority = SPDK_FILE_PRIORITY_PINNED;
+	}
+	/* Cached buffers move to the new class when they are next used or scanned */
 	file->priority = priority;
+}
+
+void
+spdk_file_get_cache_stat(struct spdk_file *file, struct spdk_file_cache_stat *stat)
+{
+	pthread_spin_lock(&file->lock);
+	stat->cached_buffers = file->cache_buffers;
+	stat->hits = file->cache_hits;
+	stat->misses = file->cache_misses;
+	pthread_spin_unlock(&file->lock);
+}
 
+void
+spdk_fs_get_cache_stat(struct spdk_fs_cache_stat *stat)
+{
+	uint32_t i;
+
+	memset(stat, 0, sizeof(*stat));
+	stat->buffer_size = CACHE_BUFFER_SIZE;
+
+	pthread_mutex_lock(&g_cache_init_lock);
+	if (g_cache_pool != NULL) {
+		stat->total_buffers = g_fs_cache_size / CACHE_BUFFER_SIZE;
+		stat->free_buffers = spdk_mempool_count(g_cache_pool);
+		pthread_spin_lock(&g_caches_lock);
+		for (i = 0; i < CACHE_NUM_CLASSES; i++) {
+			stat->class_buffers[i] = g_cache_lru[i].count;
+		}
+		stat->evictions = g_cache_evictions;
+		pthread_spin_unlock(&g_caches_lock);
+		stat->hits = g_cache_hits;
+		stat->misses = g_cache_misses;
+	}
+	pthread_mutex_unlock(&g_cache_init_lock);
 }
 
 /*
@@ -2577,7 +3012,7 @@ spdk_file_close(struct spdk_file *file, struct spdk_io_channel *_channel)
 	args->fn.file_op = __wake_caller;
 	args->arg = req;
 	channel->send_request(__file_close, req);
-	sem_wait(&channel->sem);
+	fs_channel_wait(channel);
 
 	return args->rc;
 }
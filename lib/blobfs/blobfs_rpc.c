@@ -0,0 +1,77 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/blobfs.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+
+static void
+spdk_rpc_get_blobfs_cache_stats(struct spdk_jsonrpc_request *request,
+				const struct spdk_json_val *params)
+{
+	struct spdk_json_write_ctx *w;
+	struct spdk_fs_cache_stat stat;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "get_blobfs_cache_stats requires no parameters");
+		return;
+	}
+
+	spdk_fs_get_cache_stat(&stat);
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "buffer_size", stat.buffer_size);
+	spdk_json_write_named_uint64(w, "total_buffers", stat.total_buffers);
+	spdk_json_write_named_uint64(w, "free_buffers", stat.free_buffers);
+	spdk_json_write_named_uint64(w, "low_priority_buffers",
+				     stat.class_buffers[SPDK_FILE_PRIORITY_LOW]);
+	spdk_json_write_named_uint64(w, "high_priority_buffers",
+				     stat.class_buffers[SPDK_FILE_PRIORITY_HIGH]);
+	spdk_json_write_named_uint64(w, "pinned_buffers",
+				     stat.class_buffers[SPDK_FILE_PRIORITY_PINNED]);
+	spdk_json_write_named_uint64(w, "evictions", stat.evictions);
+	spdk_json_write_named_uint64(w, "hits", stat.hits);
+	spdk_json_write_named_uint64(w, "misses", stat.misses);
+	spdk_json_write_object_end(w);
+
+	spdk_jsonrpc_end_result(request, w);
+}
+SPDK_RPC_REGISTER("get_blobfs_cache_stats", spdk_rpc_get_blobfs_cache_stats, SPDK_RPC_RUNTIME)
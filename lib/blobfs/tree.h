@@ -34,6 +34,10 @@
 #ifndef SPDK_TREE_H_
 #define SPDK_TREE_H_
 
+#include "spdk/queue.h"
+
+struct spdk_file;
+
 struct cache_buffer {
 	uint8_t			*buf;
 	uint64_t		offset;
@@ -41,6 +45,11 @@ struct cache_buffer {
 	uint32_t		bytes_filled;
 	uint32_t		bytes_flushed;
 	bool			in_progress;
+
+	/* File owning the buffer and its position in that priority class's LRU list */
+	struct spdk_file	*file;
+	uint32_t		lru_class;
+	TAILQ_ENTRY(cache_buffer) lru_tailq;
 };
 
 extern uint32_t g_fs_cache_buffer_shift;
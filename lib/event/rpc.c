@@ -71,7 +71,7 @@ spdk_rpc_initialize(const char *listen_addr)
 	spdk_rpc_set_state(SPDK_RPC_STARTUP);
 
 	/* Register a poller to periodically check for RPCs */
-	g_rpc_poller = spdk_poller_register(spdk_rpc_subsystem_poll, NULL, RPC_SELECT_INTERVAL);
+	g_rpc_poller = SPDK_POLLER_REGISTER(spdk_rpc_subsystem_poll, NULL, RPC_SELECT_INTERVAL);
 }
 
 void
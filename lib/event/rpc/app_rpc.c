@@ -33,9 +33,11 @@
 
 #include "spdk/stdinc.h"
 
+#include "spdk/env.h"
 #include "spdk/event.h"
 #include "spdk/rpc.h"
 #include "spdk/string.h"
+#include "spdk/thread.h"
 #include "spdk/util.h"
 
 #include "spdk_internal/log.h"
@@ -153,3 +155,240 @@ spdk_rpc_context_switch_monitor(struct spdk_jsonrpc_request *request,
 }
 
 SPDK_RPC_REGISTER("context_switch_monitor", spdk_rpc_context_switch_monitor, SPDK_RPC_RUNTIME)
+
+struct rpc_threads_ctx {
+	struct spdk_jsonrpc_request *request;
+	struct spdk_json_write_ctx *w;
+	char *name;
+};
+
+static void
+rpc_threads_done(void *arg)
+{
+	struct rpc_threads_ctx *ctx = arg;
+
+	spdk_json_write_array_end(ctx->w);
+	spdk_json_write_object_end(ctx->w);
+	spdk_jsonrpc_end_result(ctx->request, ctx->w);
+
+	free(ctx->name);
+	free(ctx);
+}
+
+static void
+rpc_thread_get_stats(void *arg)
+{
+	struct rpc_threads_ctx *ctx = arg;
+	struct spdk_thread_stats stats;
+
+	if (spdk_thread_get_stats(&stats) != 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_string(ctx->w, "name", spdk_thread_get_name(spdk_get_thread()));
+	spdk_json_write_named_uint64(ctx->w, "busy", stats.busy_tsc);
+	spdk_json_write_named_uint64(ctx->w, "idle", stats.idle_tsc);
+	spdk_json_write_named_uint64(ctx->w, "unknown", stats.unknown_tsc);
+	spdk_json_write_named_uint64(ctx->w, "active_pollers_count", stats.active_pollers);
+	spdk_json_write_named_uint64(ctx->w, "timed_pollers_count", stats.timed_pollers);
+	spdk_json_write_named_uint64(ctx->w, "poller_runs", stats.poller_runs);
+	spdk_json_write_named_uint64(ctx->w, "poller_run_tsc", stats.poller_tsc);
+	spdk_json_write_named_uint64(ctx->w, "poller_avg_latency_tsc",
+				     stats.poller_runs ? stats.poller_tsc / stats.poller_runs : 0);
+	spdk_json_write_object_end(ctx->w);
+}
+
+static void
+spdk_rpc_thread_get_stats(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_threads_ctx *ctx;
+
+	if (params) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "thread_get_stats requires no parameters");
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		return;
+	}
+	ctx->request = request;
+
+	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
+	if (ctx->w == NULL) {
+		free(ctx);
+		return;
+	}
+
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_uint64(ctx->w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(ctx->w, "threads");
+
+	spdk_for_each_thread(rpc_thread_get_stats, ctx, rpc_threads_done);
+}
+
+SPDK_RPC_REGISTER("thread_get_stats", spdk_rpc_thread_get_stats, SPDK_RPC_RUNTIME)
+
+/* Pollers of one thread with the same name and period, reported as a single entry. */
+struct rpc_poller_group {
+	char		*name;
+	uint64_t	period_ticks;
+	uint32_t	count;
+	uint64_t	run_count;
+	uint64_t	busy_count;
+	uint64_t	run_tsc;
+};
+
+struct rpc_poller_groups {
+	struct rpc_poller_group	*groups;
+	size_t			count;
+	size_t			size;
+	int			rc;
+};
+
+static void
+rpc_thread_group_poller_stats(void *ctx, const struct spdk_poller_stats *stats)
+{
+	struct rpc_poller_groups *groups = ctx;
+	struct rpc_poller_group *group, *tmp;
+	size_t i;
+
+	if (groups->rc != 0) {
+		return;
+	}
+
+	for (i = 0; i < groups->count; i++) {
+		group = &groups->groups[i];
+		if (group->period_ticks == stats->period_ticks && strcmp(group->name, stats->name) == 0) {
+			break;
+		}
+	}
+
+	if (i == groups->count) {
+		if (groups->count == groups->size) {
+			groups->size = spdk_max(groups->size * 2, 16);
+			tmp = realloc(groups->groups, groups->size * sizeof(*tmp));
+			if (tmp == NULL) {
+				groups->rc = -ENOMEM;
+				return;
+			}
+			groups->groups = tmp;
+		}
+
+		group = &groups->groups[groups->count];
+		memset(group, 0, sizeof(*group));
+		group->name = strdup(stats->name);
+		if (group->name == NULL) {
+			groups->rc = -ENOMEM;
+			return;
+		}
+		group->period_ticks = stats->period_ticks;
+		groups->count++;
+	}
+
+	group->count++;
+	group->run_count += stats->run_count;
+	group->busy_count += stats->busy_count;
+	group->run_tsc += stats->run_tsc;
+}
+
+static void
+rpc_thread_get_pollers(void *arg)
+{
+	struct rpc_threads_ctx *ctx = arg;
+	struct rpc_poller_groups groups = {};
+	struct rpc_poller_group *group;
+	const char *name = spdk_thread_get_name(spdk_get_thread());
+	size_t i;
+
+	if (ctx->name != NULL && (name == NULL || strcmp(ctx->name, name) != 0)) {
+		return;
+	}
+
+	/*
+	 * Many pollers of a thread are usually registered by the same function, so group
+	 *  them to keep the response small enough for JSON-RPC clients to decode.
+	 */
+	spdk_thread_get_poller_stats(rpc_thread_group_poller_stats, &groups);
+	if (groups.rc != 0) {
+		SPDK_ERRLOG("Failed to get poller statistics of thread %s\n", name);
+	}
+
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_string(ctx->w, "name", name);
+	spdk_json_write_named_array_begin(ctx->w, "pollers");
+	for (i = 0; i < groups.count; i++) {
+		group = &groups.groups[i];
+
+		spdk_json_write_object_begin(ctx->w);
+		spdk_json_write_named_string(ctx->w, "name", group->name);
+		if (group->period_ticks) {
+			spdk_json_write_named_uint64(ctx->w, "period_ticks", group->period_ticks);
+		}
+		spdk_json_write_named_uint32(ctx->w, "count", group->count);
+		spdk_json_write_named_uint64(ctx->w, "run_count", group->run_count);
+		spdk_json_write_named_uint64(ctx->w, "busy_count", group->busy_count);
+		spdk_json_write_named_uint64(ctx->w, "run_tsc", group->run_tsc);
+		spdk_json_write_object_end(ctx->w);
+
+		free(group->name);
+	}
+	spdk_json_write_array_end(ctx->w);
+	spdk_json_write_object_end(ctx->w);
+
+	free(groups.groups);
+}
+
+struct rpc_thread_get_pollers {
+	char *name;
+};
+
+static const struct spdk_json_object_decoder rpc_thread_get_pollers_decoders[] = {
+	{"name", offsetof(struct rpc_thread_get_pollers, name), spdk_json_decode_string, true},
+};
+
+static void
+spdk_rpc_thread_get_pollers(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_thread_get_pollers req = {};
+	struct rpc_threads_ctx *ctx;
+
+	if (params && spdk_json_decode_object(params, rpc_thread_get_pollers_decoders,
+					      SPDK_COUNTOF(rpc_thread_get_pollers_decoders), &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		free(req.name);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		free(req.name);
+		return;
+	}
+	ctx->request = request;
+	ctx->name = req.name;
+
+	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
+	if (ctx->w == NULL) {
+		free(ctx->name);
+		free(ctx);
+		return;
+	}
+
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_uint64(ctx->w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(ctx->w, "threads");
+
+	spdk_for_each_thread(rpc_thread_get_pollers, ctx, rpc_threads_done);
+}
+
+SPDK_RPC_REGISTER("thread_get_pollers", spdk_rpc_thread_get_pollers, SPDK_RPC_RUNTIME)
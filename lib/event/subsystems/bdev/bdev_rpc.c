@@ -39,14 +39,32 @@
 
 #include "spdk_internal/log.h"
 
+struct spdk_rpc_buf_class_counts {
+	uint32_t count[SPDK_BDEV_BUF_NUM_CLASSES];
+	size_t num_classes;
+};
+
 struct spdk_rpc_set_bdev_opts {
 	uint32_t bdev_io_pool_size;
 	uint32_t bdev_io_cache_size;
+	struct spdk_rpc_buf_class_counts buf_class_counts;
+	uint32_t buf_cache_size;
 };
 
+static int
+decode_buf_class_counts(const struct spdk_json_val *val, void *out)
+{
+	struct spdk_rpc_buf_class_counts *counts = out;
+
+	return spdk_json_decode_array(val, spdk_json_decode_uint32, counts->count,
+				      SPDK_BDEV_BUF_NUM_CLASSES, &counts->num_classes, sizeof(uint32_t));
+}
+
 static const struct spdk_json_object_decoder rpc_set_bdev_opts_decoders[] = {
 	{"bdev_io_pool_size", offsetof(struct spdk_rpc_set_bdev_opts, bdev_io_pool_size), spdk_json_decode_uint32, true},
 	{"bdev_io_cache_size", offsetof(struct spdk_rpc_set_bdev_opts, bdev_io_cache_size), spdk_json_decode_uint32, true},
+	{"buf_class_counts", offsetof(struct spdk_rpc_set_bdev_opts, buf_class_counts), decode_buf_class_counts, true},
+	{"buf_cache_size", offsetof(struct spdk_rpc_set_bdev_opts, buf_cache_size), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -55,10 +73,13 @@ spdk_rpc_set_bdev_opts(struct spdk_jsonrpc_request *request, const struct spdk_j
 	struct spdk_rpc_set_bdev_opts rpc_opts;
 	struct spdk_bdev_opts bdev_opts;
 	struct spdk_json_write_ctx *w;
+	size_t i;
 	int rc;
 
 	rpc_opts.bdev_io_pool_size = UINT32_MAX;
 	rpc_opts.bdev_io_cache_size = UINT32_MAX;
+	rpc_opts.buf_class_counts.num_classes = 0;
+	rpc_opts.buf_cache_size = UINT32_MAX;
 
 	if (params != NULL) {
 		if (spdk_json_decode_object(params, rpc_set_bdev_opts_decoders,
@@ -77,6 +98,29 @@ spdk_rpc_set_bdev_opts(struct spdk_jsonrpc_request *request, const struct spdk_j
 	if (rpc_opts.bdev_io_cache_size != UINT32_MAX) {
 		bdev_opts.bdev_io_cache_size = rpc_opts.bdev_io_cache_size;
 	}
+	if (rpc_opts.buf_class_counts.num_classes != 0) {
+		if (rpc_opts.buf_class_counts.num_classes != SPDK_BDEV_BUF_NUM_CLASSES) {
+			spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							     "buf_class_counts must have %d entries",
+							     SPDK_BDEV_BUF_NUM_CLASSES);
+			return;
+		}
+		for (i = 0; i < SPDK_BDEV_BUF_NUM_CLASSES; i++) {
+			if (rpc_opts.buf_class_counts.count[i] != 0) {
+				break;
+			}
+		}
+		if (i == SPDK_BDEV_BUF_NUM_CLASSES) {
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							 "At least one buffer size class must have buffers");
+			return;
+		}
+		memcpy(bdev_opts.buf_class_count, rpc_opts.buf_class_counts.count,
+		       sizeof(bdev_opts.buf_class_count));
+	}
+	if (rpc_opts.buf_cache_size != UINT32_MAX) {
+		bdev_opts.buf_cache_size = rpc_opts.buf_cache_size;
+	}
 	rc = spdk_bdev_set_opts(&bdev_opts);
 
 	if (rc != 0) {
@@ -63,6 +63,8 @@ static const struct spdk_json_object_decoder rpc_set_iscsi_opts_decoders[] = {
 	{"error_recovery_level", offsetof(struct spdk_iscsi_opts, ErrorRecoveryLevel), spdk_json_decode_uint32, true},
 	{"allow_duplicated_isid", offsetof(struct spdk_iscsi_opts, AllowDuplicateIsid), spdk_json_decode_bool, true},
 	{"min_connections_per_core", offsetof(struct spdk_iscsi_opts, min_connections_per_core), spdk_json_decode_uint32, true},
+	{"max_direct_writes_per_connection", offsetof(struct spdk_iscsi_opts, max_direct_writes_per_connection), spdk_json_decode_uint32, true},
+	{"direct_write_buffer_count", offsetof(struct spdk_iscsi_opts, direct_write_buffer_count), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -528,6 +528,10 @@ spdk_nvmf_parse_transport(struct spdk_nvmf_parse_transport_ctx *ctx)
 	if (val >= 0) {
 		opts.buf_cache_size = val;
 	}
+	val = spdk_conf_section_get_intval(ctx->sp, "MaxReqs");
+	if (val >= 0) {
+		opts.max_reqs = val;
+	}
 
 
 	transport = spdk_nvmf_transport_create(trtype, &opts);
@@ -222,12 +222,31 @@ dump_nvmf_subsystem(struct spdk_json_write_ctx *w, struct spdk_nvmf_subsystem *s
 		spdk_json_write_named_string(w, "adrfam", adrfam);
 		spdk_json_write_named_string(w, "traddr", trid->traddr);
 		spdk_json_write_named_string(w, "trsvcid", trid->trsvcid);
+
+		if (spdk_nvmf_subsystem_get_ana_reporting(subsystem)) {
+			struct spdk_nvmf_ns *ns;
+			uint32_t nsid;
+
+			spdk_json_write_named_array_begin(w, "ana_states");
+			for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
+			     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
+				nsid = spdk_nvmf_ns_get_id(ns);
+				spdk_json_write_object_begin(w);
+				spdk_json_write_named_uint32(w, "anagrpid", nsid);
+				spdk_json_write_named_string(w, "ana_state",
+							     spdk_nvmf_ana_state_str(spdk_nvmf_listener_get_ana_state(listener, nsid)));
+				spdk_json_write_object_end(w);
+			}
+			spdk_json_write_array_end(w);
+		}
 		spdk_json_write_object_end(w);
 	}
 	spdk_json_write_array_end(w);
 
 	spdk_json_write_named_bool(w, "allow_any_host",
 				   spdk_nvmf_subsystem_get_allow_any_host(subsystem));
+	spdk_json_write_named_bool(w, "ana_reporting",
+				   spdk_nvmf_subsystem_get_ana_reporting(subsystem));
 
 	spdk_json_write_named_array_begin(w, "hosts");
 
@@ -321,6 +340,7 @@ struct rpc_subsystem_create {
 	char *serial_number;
 	uint32_t max_namespaces;
 	bool allow_any_host;
+	bool ana_reporting;
 };
 
 static const struct spdk_json_object_decoder rpc_subsystem_create_decoders[] = {
@@ -328,6 +348,7 @@ static const struct spdk_json_object_decoder rpc_subsystem_create_decoders[] = {
 	{"serial_number", offsetof(struct rpc_subsystem_create, serial_number), spdk_json_decode_string, true},
 	{"max_namespaces", offsetof(struct rpc_subsystem_create, max_namespaces), spdk_json_decode_uint32, true},
 	{"allow_any_host", offsetof(struct rpc_subsystem_create, allow_any_host), spdk_json_decode_bool, true},
+	{"ana_reporting", offsetof(struct rpc_subsystem_create, ana_reporting), spdk_json_decode_bool, true},
 };
 
 static void
@@ -379,6 +400,7 @@ spdk_rpc_nvmf_subsystem_create(struct spdk_jsonrpc_request *request,
 	}
 
 	spdk_nvmf_subsystem_set_allow_any_host(subsystem, req->allow_any_host);
+	spdk_nvmf_subsystem_set_ana_reporting(subsystem, req->ana_reporting);
 
 	free(req->nqn);
 	free(req->serial_number);
@@ -773,6 +795,151 @@ nvmf_rpc_subsystem_remove_listener(struct spdk_jsonrpc_request *request,
 SPDK_RPC_REGISTER("nvmf_subsystem_remove_listener", nvmf_rpc_subsystem_remove_listener,
 		  SPDK_RPC_RUNTIME);
 
+struct nvmf_rpc_ana_state_ctx {
+	char				*nqn;
+	struct spdk_nvmf_subsystem	*subsystem;
+	struct rpc_listen_address	address;
+	enum spdk_nvme_ana_state	ana_state;
+	uint32_t			anagrpid;
+
+	struct spdk_jsonrpc_request	*request;
+	struct spdk_nvme_transport_id	trid;
+	bool				response_sent;
+};
+
+static int
+decode_rpc_ana_state(const struct spdk_json_val *val, void *out)
+{
+	enum spdk_nvme_ana_state *ana_state = out;
+	char *str = NULL;
+	int rc;
+
+	rc = spdk_json_decode_string(val, &str);
+	if (rc == 0) {
+		rc = spdk_nvmf_ana_state_parse(ana_state, str);
+		if (rc != 0) {
+			SPDK_ERRLOG("Invalid ANA state: %s\n", str);
+		}
+	}
+
+	free(str);
+	return rc;
+}
+
+static const struct spdk_json_object_decoder nvmf_rpc_ana_state_decoder[] = {
+	{"nqn", offsetof(struct nvmf_rpc_ana_state_ctx, nqn), spdk_json_decode_string},
+	{"listen_address", offsetof(struct nvmf_rpc_ana_state_ctx, address), decode_rpc_listen_address},
+	{"ana_state", offsetof(struct nvmf_rpc_ana_state_ctx, ana_state), decode_rpc_ana_state},
+	{"anagrpid", offsetof(struct nvmf_rpc_ana_state_ctx, anagrpid), spdk_json_decode_uint32, true},
+};
+
+static void
+nvmf_rpc_ana_state_ctx_free(struct nvmf_rpc_ana_state_ctx *ctx)
+{
+	free(ctx->nqn);
+	free_rpc_listen_address(&ctx->address);
+	free(ctx);
+}
+
+static void
+nvmf_rpc_ana_state_resumed(struct spdk_nvmf_subsystem *subsystem,
+			   void *cb_arg, int status)
+{
+	struct nvmf_rpc_ana_state_ctx *ctx = cb_arg;
+	struct spdk_jsonrpc_request *request;
+	struct spdk_json_write_ctx *w;
+	bool response_sent = ctx->response_sent;
+
+	request = ctx->request;
+	nvmf_rpc_ana_state_ctx_free(ctx);
+
+	if (response_sent) {
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w == NULL) {
+		return;
+	}
+
+	spdk_json_write_bool(w, true);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+nvmf_rpc_ana_state_paused(struct spdk_nvmf_subsystem *subsystem,
+			  void *cb_arg, int status)
+{
+	struct nvmf_rpc_ana_state_ctx *ctx = cb_arg;
+	int rc;
+
+	rc = spdk_nvmf_subsystem_set_ana_state(subsystem, &ctx->trid, ctx->ana_state, ctx->anagrpid);
+	if (rc != 0) {
+		SPDK_ERRLOG("Unable to set ANA state: %s\n", spdk_strerror(-rc));
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		ctx->response_sent = true;
+	}
+
+	if (spdk_nvmf_subsystem_resume(subsystem, nvmf_rpc_ana_state_resumed, ctx)) {
+		if (!ctx->response_sent) {
+			spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR, "Internal error");
+		}
+		nvmf_rpc_ana_state_ctx_free(ctx);
+		/* Can't really do anything to recover here - subsystem will remain paused. */
+	}
+}
+
+static void
+nvmf_rpc_subsystem_listener_set_ana_state(struct spdk_jsonrpc_request *request,
+		const struct spdk_json_val *params)
+{
+	struct nvmf_rpc_ana_state_ctx *ctx;
+	struct spdk_nvmf_subsystem *subsystem;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR, "Out of memory");
+		return;
+	}
+
+	ctx->request = request;
+
+	if (spdk_json_decode_object(params, nvmf_rpc_ana_state_decoder,
+				    SPDK_COUNTOF(nvmf_rpc_ana_state_decoder),
+				    ctx)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		nvmf_rpc_ana_state_ctx_free(ctx);
+		return;
+	}
+
+	subsystem = spdk_nvmf_tgt_find_subsystem(g_spdk_nvmf_tgt, ctx->nqn);
+	if (!subsystem) {
+		SPDK_ERRLOG("Unable to find subsystem with NQN %s\n", ctx->nqn);
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		nvmf_rpc_ana_state_ctx_free(ctx);
+		return;
+	}
+
+	ctx->subsystem = subsystem;
+
+	if (rpc_listen_address_to_trid(&ctx->address, &ctx->trid)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		nvmf_rpc_ana_state_ctx_free(ctx);
+		return;
+	}
+
+	if (spdk_nvmf_subsystem_pause(subsystem, nvmf_rpc_ana_state_paused, ctx)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR, "Internal error");
+		nvmf_rpc_ana_state_ctx_free(ctx);
+		return;
+	}
+}
+SPDK_RPC_REGISTER("nvmf_subsystem_listener_set_ana_state",
+		  nvmf_rpc_subsystem_listener_set_ana_state, SPDK_RPC_RUNTIME);
+
 struct spdk_nvmf_ns_params {
 	char *bdev_name;
 	uint32_t nsid;
@@ -1435,6 +1602,10 @@ static const struct spdk_json_object_decoder nvmf_rpc_create_transport_decoder[]
 		"buf_cache_size", offsetof(struct nvmf_rpc_create_transport_ctx, opts.buf_cache_size),
 		spdk_json_decode_uint32, true
 	},
+	{
+		"max_reqs", offsetof(struct nvmf_rpc_create_transport_ctx, opts.max_reqs),
+		spdk_json_decode_uint32, true
+	},
 };
 
 static void
@@ -1568,6 +1739,7 @@ dump_nvmf_transport(struct spdk_json_write_ctx *w, struct spdk_nvmf_transport *t
 	spdk_json_write_named_uint32(w, "max_aq_depth", opts->max_aq_depth);
 	spdk_json_write_named_uint32(w, "num_shared_buffers", opts->num_shared_buffers);
 	spdk_json_write_named_uint32(w, "buf_cache_size", opts->buf_cache_size);
+	spdk_json_write_named_uint32(w, "max_reqs", opts->max_reqs);
 
 	spdk_json_write_object_end(w);
 }
@@ -407,7 +407,7 @@ nvmf_tgt_advance_state(void)
 			break;
 		}
 		case NVMF_TGT_INIT_START_ACCEPTOR:
-			g_acceptor_poller = spdk_poller_register(acceptor_poll, g_spdk_nvmf_tgt,
+			g_acceptor_poller = SPDK_POLLER_REGISTER(acceptor_poll, g_spdk_nvmf_tgt,
 					    g_spdk_nvmf_tgt_conf->acceptor_poll_rate);
 			SPDK_INFOLOG(SPDK_LOG_NVMF, "Acceptor running\n");
 			g_tgt_state = NVMF_TGT_RUNNING;
@@ -37,6 +37,7 @@
 #include "spdk/stdinc.h"
 #include "spdk/bit_array.h"
 #include "spdk/queue.h"
+#include "spdk/ftl.h"
 
 #include "ftl_ppa.h"
 
@@ -137,6 +138,9 @@ struct ftl_band {
 	/* Band's index */
 	unsigned int				id;
 
+	/* Write stream the band was last written by */
+	enum spdk_ftl_stream			stream;
+
 	/* Latest merit calculation */
 	double					merit;
 
@@ -46,6 +46,7 @@
 #include "ftl_rwb.h"
 #include "ftl_debug.h"
 #include "ftl_reloc.h"
+#include "ftl_emu.h"
 
 /* Max number of iovecs */
 #define FTL_MAX_IOV 1024
@@ -69,6 +70,9 @@ struct ftl_wptr {
 	/* Metadata DMA buffer */
 	void				*md_buf;
 
+	/* Write stream the wptr is serving */
+	enum spdk_ftl_stream		stream;
+
 	/* List link */
 	LIST_ENTRY(ftl_wptr)		list_entry;
 };
@@ -91,16 +95,39 @@ struct ftl_flush {
 };
 
 typedef int (*ftl_next_ppa_fn)(struct ftl_io *, struct ftl_ppa *, size_t, void *);
+
+/* Relative defrag merit of the bands written by each of the streams. Hot bands */
+/* keep losing valid data on their own, so it pays off to wait with them, while */
+/* whatever's left in cold and relocated bands is likely to stay valid. */
+static const double g_ftl_stream_merit[SPDK_FTL_STREAM_MAX] = {
+	[SPDK_FTL_STREAM_USER_HOT]	= 1.0,
+	[SPDK_FTL_STREAM_USER_COLD]	= 2.0,
+	[SPDK_FTL_STREAM_GC]		= 2.0,
+};
 static void _ftl_read(void *);
 static void _ftl_write(void *);
 
 static int
 ftl_rwb_flags_from_io(const struct ftl_io *io)
 {
-	int valid_flags = FTL_IO_INTERNAL | FTL_IO_WEAK | FTL_IO_PAD;
+	int valid_flags = FTL_IO_INTERNAL | FTL_IO_WEAK | FTL_IO_PAD | FTL_IO_COLD;
 	return io->flags & valid_flags;
 }
 
+static enum spdk_ftl_stream
+ftl_io_stream(const struct ftl_io *io)
+{
+	if (!io->dev->conf.stream_placement) {
+		return SPDK_FTL_STREAM_USER_HOT;
+	}
+
+	if (io->flags & FTL_IO_INTERNAL) {
+		return SPDK_FTL_STREAM_GC;
+	}
+
+	return (io->flags & FTL_IO_COLD) ? SPDK_FTL_STREAM_USER_COLD : SPDK_FTL_STREAM_USER_HOT;
+}
+
 static int
 ftl_rwb_entry_weak(const struct ftl_rwb_entry *entry)
 {
@@ -295,8 +322,13 @@ ftl_submit_erase(struct ftl_io *io)
 		ftl_io_inc_req(io);
 
 		ftl_trace_submission(dev, io, ppa, 1);
-		rc = spdk_nvme_ocssd_ns_cmd_vector_reset(dev->ns, ftl_get_write_qpair(dev),
-				&ppa_packed, 1, NULL, ftl_io_cmpl_cb, io);
+		if (dev->emu) {
+			rc = ftl_emu_vector_reset(dev->emu, ftl_get_write_ioch(dev), &ppa_packed, 1,
+						  ftl_io_cmpl_cb, io);
+		} else {
+			rc = spdk_nvme_ocssd_ns_cmd_vector_reset(dev->ns, ftl_get_write_qpair(dev),
+					&ppa_packed, 1, NULL, ftl_io_cmpl_cb, io);
+		}
 		if (rc) {
 			SPDK_ERRLOG("Vector reset failed with status: %d\n", rc);
 			ftl_io_dec_req(io);
@@ -404,7 +436,7 @@ ftl_wptr_init(struct ftl_band *band)
 }
 
 static int
-ftl_add_wptr(struct spdk_ftl_dev *dev)
+ftl_add_wptr(struct spdk_ftl_dev *dev, enum spdk_ftl_stream stream)
 {
 	struct ftl_band *band;
 	struct ftl_wptr *wptr;
@@ -424,9 +456,11 @@ ftl_add_wptr(struct spdk_ftl_dev *dev)
 		return -1;
 	}
 
+	wptr->stream = stream;
+	band->stream = stream;
 	LIST_INSERT_HEAD(&dev->wptr_list, wptr, list_entry);
 
-	SPDK_DEBUGLOG(SPDK_LOG_FTL_CORE, "wptr: band %u\n", band->id);
+	SPDK_DEBUGLOG(SPDK_LOG_FTL_CORE, "wptr: band %u, stream %d\n", band->id, stream);
 	ftl_trace_write_band(dev, band);
 	return 0;
 }
@@ -546,14 +580,20 @@ clear:
 	ftl_rwb_entry_invalidate(entry);
 unlock:
 	pthread_spin_unlock(&entry->lock);
+
+	/* Release the L2P page pinned when the entry was filled */
+	if (entry->lba != FTL_LBA_INVALID) {
+		ftl_l2p_unpin(dev, entry->lba);
+		entry->lba = FTL_LBA_INVALID;
+	}
 }
 
 static struct ftl_rwb_entry *
-ftl_acquire_entry(struct spdk_ftl_dev *dev, int flags)
+ftl_acquire_entry(struct spdk_ftl_dev *dev, int flags, enum spdk_ftl_stream stream)
 {
 	struct ftl_rwb_entry *entry;
 
-	entry = ftl_rwb_acquire(dev->rwb, ftl_rwb_type_from_flags(flags));
+	entry = ftl_rwb_acquire(dev->rwb, ftl_rwb_type_from_flags(flags), stream);
 	if (!entry) {
 		return NULL;
 	}
@@ -561,17 +601,18 @@ ftl_acquire_entry(struct spdk_ftl_dev *dev, int flags)
 	ftl_evict_cache_entry(dev, entry);
 
 	entry->flags = flags;
+	entry->stream = stream;
 	return entry;
 }
 
 static void
-ftl_rwb_pad(struct spdk_ftl_dev *dev, size_t size)
+ftl_rwb_pad(struct spdk_ftl_dev *dev, enum spdk_ftl_stream stream, size_t size)
 {
 	struct ftl_rwb_entry *entry;
 	int flags = FTL_IO_PAD | FTL_IO_INTERNAL;
 
 	for (size_t i = 0; i < size; ++i) {
-		entry = ftl_acquire_entry(dev, flags);
+		entry = ftl_acquire_entry(dev, flags, stream);
 		if (!entry) {
 			break;
 		}
@@ -593,11 +634,37 @@ ftl_remove_free_bands(struct spdk_ftl_dev *dev)
 	dev->next_band = NULL;
 }
 
+static bool
+ftl_wptr_active(const struct ftl_wptr *wptr)
+{
+	enum ftl_band_state state = wptr->band->state;
+
+	return state != FTL_BAND_STATE_FULL &&
+	       state != FTL_BAND_STATE_CLOSING &&
+	       state != FTL_BAND_STATE_CLOSED;
+}
+
+static struct ftl_wptr *
+ftl_stream_wptr(struct spdk_ftl_dev *dev, enum spdk_ftl_stream stream)
+{
+	struct ftl_wptr *wptr;
+
+	LIST_FOREACH(wptr, &dev->wptr_list, list_entry) {
+		if (wptr->stream == stream && ftl_wptr_active(wptr)) {
+			return wptr;
+		}
+	}
+
+	return NULL;
+}
+
 static void
-ftl_process_shutdown(struct spdk_ftl_dev *dev)
+ftl_process_shutdown(struct ftl_wptr *wptr)
 {
-	size_t size = ftl_rwb_num_acquired(dev->rwb, FTL_RWB_TYPE_INTERNAL) +
-		      ftl_rwb_num_acquired(dev->rwb, FTL_RWB_TYPE_USER);
+	struct spdk_ftl_dev *dev = wptr->dev;
+	size_t size = ftl_rwb_num_pending(dev->rwb, wptr->stream);
+	size_t stream_size;
+	int stream;
 
 	if (size >= dev->xfer_size) {
 		return;
@@ -607,8 +674,28 @@ ftl_process_shutdown(struct spdk_ftl_dev *dev)
 	/* and pad current wptr band to the end */
 	ftl_remove_free_bands(dev);
 
+	/* Streams without a wptr of their own can't get one anymore, so their */
+	/* batches have to be written by this wptr before it pads its own */
+	/* stream. Pad their partial batches, so that they can be popped. */
+	for (stream = 0; stream < SPDK_FTL_STREAM_MAX; ++stream) {
+		if (stream == (int)wptr->stream || ftl_stream_wptr(dev, stream)) {
+			continue;
+		}
+
+		stream_size = ftl_rwb_num_pending(dev->rwb, stream);
+		if (stream_size == 0) {
+			continue;
+		}
+
+		if (stream_size < dev->xfer_size) {
+			ftl_rwb_pad(dev, stream, dev->xfer_size - stream_size);
+		}
+
+		return;
+	}
+
 	/* Pad write buffer until band is full */
-	ftl_rwb_pad(dev, dev->xfer_size - size);
+	ftl_rwb_pad(dev, wptr->stream, dev->xfer_size - size);
 }
 
 static int
@@ -699,19 +786,49 @@ ftl_read_canceled(int rc)
 	return rc == 0;
 }
 
+static int
+ftl_read_suspended(int rc)
+{
+	return rc == -EBUSY;
+}
+
+static void
+_ftl_read_resume(void *ctx)
+{
+	struct ftl_io *io = ctx;
+
+	ftl_io_dec_req(io);
+	ftl_io_read(io);
+}
+
+/* The read is resumed by the L2P cache once the page is loaded */
+static void
+ftl_read_suspend(struct ftl_io *io, size_t lbk)
+{
+	/* Keep the request from being completed by the reads already sent */
+	io->pos = lbk;
+	ftl_io_inc_req(io);
+}
+
 static int
 ftl_submit_read(struct ftl_io *io, ftl_next_ppa_fn next_ppa,
 		void *ctx)
 {
 	struct spdk_ftl_dev *dev = io->dev;
 	struct ftl_ppa ppa;
-	size_t lbk = 0;
+	size_t lbk = io->pos;
 	int rc = 0, lbk_cnt;
 
 	while (lbk < io->lbk_cnt) {
 		/* We might hit the cache here, if so, skip the read */
 		lbk_cnt = rc = next_ppa(io, &ppa, lbk, ctx);
 
+		/* The L2P entry isn't resident, resume the read once it's paged in */
+		if (ftl_read_suspended(rc)) {
+			ftl_read_suspend(io, lbk);
+			return 0;
+		}
+
 		/* We might need to retry the read from scratch (e.g. */
 		/* because write was under way and completed before */
 		/* we could read it from rwb */
@@ -729,10 +846,16 @@ ftl_submit_read(struct ftl_io *io, ftl_next_ppa_fn next_ppa,
 		assert(lbk_cnt > 0);
 
 		ftl_trace_submission(dev, io, ppa, lbk_cnt);
-		rc = spdk_nvme_ns_cmd_read(dev->ns, ftl_get_read_qpair(dev),
-					   ftl_io_iovec_addr(io),
-					   ftl_ppa_addr_pack(io->dev, ppa), lbk_cnt,
-					   ftl_io_cmpl_cb, io, 0);
+		if (dev->emu) {
+			rc = ftl_emu_read(dev->emu, ftl_get_read_ioch(dev), ftl_io_iovec_addr(io),
+					  ftl_ppa_addr_pack(io->dev, ppa), lbk_cnt,
+					  ftl_io_cmpl_cb, io);
+		} else {
+			rc = spdk_nvme_ns_cmd_read(dev->ns, ftl_get_read_qpair(dev),
+						   ftl_io_iovec_addr(io),
+						   ftl_ppa_addr_pack(io->dev, ppa), lbk_cnt,
+						   ftl_io_cmpl_cb, io, 0);
+		}
 
 		if (rc != 0 && rc != -ENOMEM) {
 			SPDK_ERRLOG("spdk_nvme_ns_cmd_read failed with status: %d\n", rc);
@@ -782,13 +905,10 @@ out:
 }
 
 static int
-ftl_lba_read_next_ppa(struct ftl_io *io, struct ftl_ppa *ppa,
-		      size_t lbk, void *ctx)
+_ftl_lba_read_next_ppa(struct ftl_io *io, struct ftl_ppa *ppa, uint64_t lba)
 {
 	struct spdk_ftl_dev *dev = io->dev;
-	*ppa = ftl_l2p_get(dev, io->lba + lbk);
-
-	(void) ctx;
+	*ppa = ftl_l2p_get(dev, lba);
 
 	SPDK_DEBUGLOG(SPDK_LOG_FTL_CORE, "Read ppa:%lx, lba:%lu\n", ppa->ppa, io->lba);
 
@@ -799,7 +919,7 @@ ftl_lba_read_next_ppa(struct ftl_io *io, struct ftl_ppa *ppa,
 	}
 
 	if (ftl_ppa_cached(*ppa)) {
-		if (!ftl_ppa_cache_read(io, io->lba + lbk, *ppa, ftl_io_iovec_addr(io))) {
+		if (!ftl_ppa_cache_read(io, lba, *ppa, ftl_io_iovec_addr(io))) {
 			ftl_trace_completion(io->dev, io, FTL_TRACE_COMPLETION_CACHE);
 			return 0;
 		}
@@ -812,6 +932,28 @@ ftl_lba_read_next_ppa(struct ftl_io *io, struct ftl_ppa *ppa,
 	return 1;
 }
 
+static int
+ftl_lba_read_next_ppa(struct ftl_io *io, struct ftl_ppa *ppa,
+		      size_t lbk, void *ctx)
+{
+	uint64_t lba = io->lba + lbk;
+	int rc;
+
+	(void) ctx;
+
+	io->l2p_waiter.cb_fn = _ftl_read_resume;
+	io->l2p_waiter.cb_arg = io;
+
+	if (ftl_l2p_pin(io->dev, lba, &io->l2p_waiter)) {
+		return -EBUSY;
+	}
+
+	rc = _ftl_lba_read_next_ppa(io, ppa, lba);
+	ftl_l2p_unpin(io->dev, lba);
+
+	return rc;
+}
+
 static void
 ftl_complete_flush(struct ftl_flush *flush)
 {
@@ -900,10 +1042,14 @@ ftl_write_cb(void *arg, int status)
 static void
 ftl_update_rwb_stats(struct spdk_ftl_dev *dev, const struct ftl_rwb_entry *entry)
 {
+	struct spdk_ftl_stream_stats *stats = &dev->stats.stream[entry->stream];
+
 	if (!ftl_rwb_entry_internal(entry)) {
 		dev->stats.write_user++;
+		stats->write_user++;
 	}
 	dev->stats.write_total++;
+	stats->write_total++;
 }
 
 static void
@@ -983,11 +1129,18 @@ ftl_submit_write(struct ftl_wptr *wptr, struct ftl_io *io)
 		assert(iov[i].iov_len / PAGE_SIZE == dev->xfer_size);
 
 		ftl_trace_submission(dev, io, wptr->ppa, iov[i].iov_len / PAGE_SIZE);
-		rc = spdk_nvme_ns_cmd_write_with_md(dev->ns, ftl_get_write_qpair(dev),
-						    iov[i].iov_base, ftl_io_get_md(io),
-						    ftl_ppa_addr_pack(dev, wptr->ppa),
-						    iov[i].iov_len / PAGE_SIZE,
-						    ftl_io_cmpl_cb, io, 0, 0, 0);
+		if (dev->emu) {
+			rc = ftl_emu_write(dev->emu, ftl_get_write_ioch(dev), iov[i].iov_base,
+					   ftl_ppa_addr_pack(dev, wptr->ppa),
+					   iov[i].iov_len / PAGE_SIZE,
+					   ftl_io_cmpl_cb, io);
+		} else {
+			rc = spdk_nvme_ns_cmd_write_with_md(dev->ns, ftl_get_write_qpair(dev),
+							    iov[i].iov_base, ftl_io_get_md(io),
+							    ftl_ppa_addr_pack(dev, wptr->ppa),
+							    iov[i].iov_len / PAGE_SIZE,
+							    ftl_io_cmpl_cb, io, 0, 0, 0);
+		}
 		if (rc) {
 			SPDK_ERRLOG("spdk_nvme_ns_cmd_write failed with status:%d, ppa:%lu\n",
 				    rc, wptr->ppa.ppa);
@@ -1012,20 +1165,67 @@ ftl_flush_pad_batch(struct spdk_ftl_dev *dev)
 {
 	struct ftl_rwb *rwb = dev->rwb;
 	size_t size;
+	int stream;
+
+	for (stream = 0; stream < SPDK_FTL_STREAM_MAX; ++stream) {
+		size = ftl_rwb_num_pending(rwb, stream);
 
-	size = ftl_rwb_num_acquired(rwb, FTL_RWB_TYPE_INTERNAL) +
-	       ftl_rwb_num_acquired(rwb, FTL_RWB_TYPE_USER);
+		/* Only add padding when there's less than xfer size */
+		/* entries in the stream's buffer. Otherwise we just */
+		/* have to wait for the entries to become ready. */
+		if (size > 0 && size < dev->xfer_size) {
+			ftl_rwb_pad(dev, stream, dev->xfer_size - size);
+		}
+	}
+}
 
-	/* There must be something in the RWB, otherwise the flush */
-	/* wouldn't be waiting for anything */
-	assert(size > 0);
+static bool
+ftl_stream_needs_wptr(struct spdk_ftl_dev *dev, enum spdk_ftl_stream stream)
+{
+	if (ftl_stream_wptr(dev, stream)) {
+		return false;
+	}
 
-	/* Only add padding when there's less than xfer size */
-	/* entries in the buffer. Otherwise we just have to wait */
-	/* for the entries to become ready. */
-	if (size < dev->xfer_size) {
-		ftl_rwb_pad(dev, dev->xfer_size - (size % dev->xfer_size));
+	/* There's always a band open for the default stream */
+	if (stream == SPDK_FTL_STREAM_USER_HOT) {
+		return true;
+	}
+
+	/* The other streams only get a band of their own when they have some */
+	/* data to write and there's no shortage of free bands. Otherwise their */
+	/* batches are written by the other streams' wptrs. */
+	if (!ftl_rwb_num_pending(dev->rwb, stream)) {
+		return false;
+	}
+
+	return dev->num_free > ftl_get_limit(dev, SPDK_FTL_LIMIT_CRIT)->thld;
+}
+
+static struct ftl_rwb_batch *
+ftl_wptr_pop_batch(struct ftl_wptr *wptr)
+{
+	struct spdk_ftl_dev *dev = wptr->dev;
+	struct ftl_rwb_batch *batch;
+	int stream;
+
+	batch = ftl_rwb_pop(dev->rwb, wptr->stream);
+	if (batch) {
+		return batch;
+	}
+
+	/* Pick up the batches of streams that don't have their own wptr */
+	for (stream = 0; stream < SPDK_FTL_STREAM_MAX; ++stream) {
+		if (stream == (int)wptr->stream || ftl_stream_wptr(dev, stream)) {
+			continue;
+		}
+
+		batch = ftl_rwb_pop(dev->rwb, stream);
+		if (batch) {
+			return batch;
+		}
 	}
+
+	return NULL;
 }
 
 static int
@@ -1043,10 +1243,10 @@ ftl_wptr_process_writes(struct ftl_wptr *wptr)
 	}
 
 	if (dev->halt) {
-		ftl_process_shutdown(dev);
+		ftl_process_shutdown(wptr);
 	}
 
-	batch = ftl_rwb_pop(dev->rwb);
+	batch = ftl_wptr_pop_batch(wptr);
 	if (!batch) {
 		/* If there are queued flush requests we need to pad the RWB to */
 		/* force out remaining entries */
@@ -1108,22 +1308,16 @@ static int
 ftl_process_writes(struct spdk_ftl_dev *dev)
 {
 	struct ftl_wptr *wptr, *twptr;
-	size_t num_active = 0;
-	enum ftl_band_state state;
+	int stream;
 
 	LIST_FOREACH_SAFE(wptr, &dev->wptr_list, list_entry, twptr) {
 		ftl_wptr_process_writes(wptr);
-		state = wptr->band->state;
-
-		if (state != FTL_BAND_STATE_FULL &&
-		    state != FTL_BAND_STATE_CLOSING &&
-		    state != FTL_BAND_STATE_CLOSED) {
-			num_active++;
-		}
 	}
 
-	if (num_active < 1) {
-		ftl_add_wptr(dev);
+	for (stream = 0; stream < SPDK_FTL_STREAM_MAX; ++stream) {
+		if (ftl_stream_needs_wptr(dev, stream)) {
+			ftl_add_wptr(dev, stream);
+		}
 	}
 
 	return 0;
@@ -1154,9 +1348,19 @@ ftl_rwb_fill(struct ftl_io *io)
 	struct spdk_ftl_dev *dev = io->dev;
 	struct ftl_rwb_entry *entry;
 	struct ftl_ppa ppa = { .cached = 1 };
+	struct ftl_l2p_waiter *waiter = NULL;
 	int flags = ftl_rwb_flags_from_io(io);
+	enum spdk_ftl_stream stream = ftl_io_stream(io);
 	uint64_t lba;
 
+	/* User writes are resumed once the L2P page is loaded, internal ones are */
+	/* retried from their own queues */
+	if (!(io->flags & FTL_IO_INTERNAL)) {
+		io->l2p_waiter.cb_fn = _ftl_write;
+		io->l2p_waiter.cb_arg = io;
+		waiter = &io->l2p_waiter;
+	}
+
 	for (; io->pos < io->lbk_cnt; ++io->pos) {
 		lba = ftl_io_current_lba(io);
 		if (lba == FTL_LBA_INVALID) {
@@ -1164,11 +1368,22 @@ ftl_rwb_fill(struct ftl_io *io)
 			continue;
 		}
 
-		entry = ftl_acquire_entry(dev, flags);
+		/* The entry keeps the L2P page pinned until it's evicted from the cache */
+		if (ftl_l2p_pin(dev, lba, waiter)) {
+			return waiter ? -EBUSY : -EAGAIN;
+		}
+
+		entry = ftl_acquire_entry(dev, flags, stream);
 		if (!entry) {
+			ftl_l2p_unpin(dev, lba);
 			return -EAGAIN;
 		}
 
+		/* Relocated data is accounted to the stream it was written by */
+		if ((flags & FTL_IO_INTERNAL) && io->band) {
+			entry->stream = io->band->stream;
+		}
+
 		entry->lba = lba;
 		ftl_rwb_entry_fill(entry, io);
 
@@ -1225,7 +1440,7 @@ ftl_band_calc_merit(struct ftl_band *band, size_t *threshold_valid)
 
 	/* Add one to avoid division by 0 */
 	vld_ratio = (double)invalid / (double)(valid + 1);
-	return vld_ratio * ftl_band_age(band);
+	return vld_ratio * ftl_band_age(band) * g_ftl_stream_merit[band->stream];
 }
 
 static bool
@@ -1294,6 +1509,12 @@ spdk_ftl_dev_get_attrs(const struct spdk_ftl_dev *dev, struct spdk_ftl_attrs *at
 	attrs->range = dev->range;
 }
 
+void
+spdk_ftl_dev_get_stats(const struct spdk_ftl_dev *dev, struct spdk_ftl_stats *stats)
+{
+	memcpy(stats->stream, dev->stats.stream, sizeof(stats->stream));
+}
+
 static void
 _ftl_io_write(void *ctx)
 {
@@ -1335,6 +1556,11 @@ _spdk_ftl_write(struct ftl_io *io)
 		return 0;
 	}
 
+	/* Waiting for the L2P page, the write is resumed by the cache */
+	if (rc == -EBUSY) {
+		return 0;
+	}
+
 	if (rc) {
 		ftl_io_free(io);
 	}
@@ -1351,9 +1577,22 @@ _ftl_write(void *ctx)
 int
 spdk_ftl_write(struct spdk_ftl_dev *dev, struct spdk_io_channel *ch, uint64_t lba, size_t lba_cnt,
 	       struct iovec *iov, size_t iov_cnt, spdk_ftl_fn cb_fn, void *cb_arg)
+{
+	return spdk_ftl_write_stream(dev, ch, lba, lba_cnt, iov, iov_cnt,
+				     SPDK_FTL_STREAM_USER_HOT, cb_fn, cb_arg);
+}
+
+int
+spdk_ftl_write_stream(struct spdk_ftl_dev *dev, struct spdk_io_channel *ch, uint64_t lba,
+		      size_t lba_cnt, struct iovec *iov, size_t iov_cnt,
+		      enum spdk_ftl_stream stream, spdk_ftl_fn cb_fn, void *cb_arg)
 {
 	struct ftl_io *io;
 
+	if (stream != SPDK_FTL_STREAM_USER_HOT && stream != SPDK_FTL_STREAM_USER_COLD) {
+		return -EINVAL;
+	}
+
 	if (iov_cnt == 0 || iov_cnt > FTL_MAX_IOV) {
 		return -EINVAL;
 	}
@@ -1376,6 +1615,10 @@ spdk_ftl_write(struct spdk_ftl_dev *dev, struct spdk_io_channel *ch, uint64_t lb
 	}
 
 	ftl_io_user_init(dev, io, lba, lba_cnt, iov, iov_cnt, cb_fn, cb_arg, FTL_IO_WRITE);
+	if (stream == SPDK_FTL_STREAM_USER_COLD) {
+		io->flags |= FTL_IO_COLD;
+	}
+
 	return _spdk_ftl_write(io);
 }
 
@@ -1511,6 +1754,18 @@ ftl_process_anm_event(struct ftl_anm_event *event)
 	ftl_anm_event_complete(event);
 }
 
+static void
+ftl_thread_stop(struct ftl_thread *thread)
+{
+	/* The base bdev's channel has to be released on the thread it was acquired on */
+	if (thread->ioch) {
+		spdk_put_io_channel(thread->ioch);
+		thread->ioch = NULL;
+	}
+
+	spdk_poller_unregister(&thread->poller);
+}
+
 int
 ftl_task_read(void *ctx)
 {
@@ -1520,11 +1775,16 @@ ftl_task_read(void *ctx)
 
 	if (dev->halt) {
 		if (ftl_shutdown_complete(dev)) {
-			spdk_poller_unregister(&thread->poller);
+			ftl_thread_stop(thread);
 			return 0;
 		}
 	}
 
+	/* Emulated devices complete their requests through the base bdev */
+	if (!qpair) {
+		return 0;
+	}
+
 	return spdk_nvme_qpair_process_completions(qpair, 1);
 }
 
@@ -1537,13 +1797,15 @@ ftl_task_core(void *ctx)
 
 	if (dev->halt) {
 		if (ftl_shutdown_complete(dev)) {
-			spdk_poller_unregister(&thread->poller);
+			ftl_thread_stop(thread);
 			return 0;
 		}
 	}
 
 	ftl_process_writes(dev);
-	spdk_nvme_qpair_process_completions(qpair, 1);
+	if (qpair) {
+		spdk_nvme_qpair_process_completions(qpair, 1);
+	}
 	ftl_process_relocs(dev);
 
 	return 0;
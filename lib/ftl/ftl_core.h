@@ -47,6 +47,7 @@
 #include "ftl_ppa.h"
 #include "ftl_io.h"
 #include "ftl_trace.h"
+#include "ftl_l2p_cache.h"
 
 struct spdk_ftl_dev;
 struct ftl_band;
@@ -57,6 +58,7 @@ struct ftl_wptr;
 struct ftl_flush;
 struct ftl_reloc;
 struct ftl_anm_event;
+struct ftl_emu;
 
 struct ftl_stats {
 	/* Number of writes scheduled directly by the user */
@@ -65,6 +67,9 @@ struct ftl_stats {
 	/* Total number of writes */
 	uint64_t				write_total;
 
+	/* Per-stream write counters */
+	struct spdk_ftl_stream_stats		stream[SPDK_FTL_STREAM_MAX];
+
 	/* Traces */
 	struct ftl_trace			trace;
 
@@ -83,6 +88,8 @@ struct ftl_thread {
 	struct spdk_ftl_dev			*dev;
 	/* I/O queue pair */
 	struct spdk_nvme_qpair			*qpair;
+	/* Base bdev's IO channel (emulated devices only) */
+	struct spdk_io_channel			*ioch;
 
 	/* Thread on which the poller is running */
 	struct spdk_thread			*thread;
@@ -136,6 +143,8 @@ struct spdk_ftl_dev {
 	struct spdk_nvme_ns			*ns;
 	/* NVMe transport ID */
 	struct spdk_nvme_transport_id		trid;
+	/* Open-Channel emulation (set when running on top of a regular bdev) */
+	struct ftl_emu				*emu;
 
 	/* LBA map memory pool */
 	struct spdk_mempool			*lba_pool;
@@ -171,6 +180,8 @@ struct spdk_ftl_dev {
 
 	/* Logical -> physical table */
 	void					*l2p;
+	/* Paged logical -> physical table (used instead of l2p when set) */
+	struct ftl_l2p_cache			*l2p_cache;
 	/* Size of the l2p table */
 	uint64_t				num_lbas;
 
@@ -250,6 +261,12 @@ ftl_get_write_qpair(const struct spdk_ftl_dev *dev)
 	return dev->core_thread.qpair;
 }
 
+static inline struct spdk_io_channel *
+ftl_get_write_ioch(const struct spdk_ftl_dev *dev)
+{
+	return dev->core_thread.ioch;
+}
+
 static inline struct spdk_thread *
 ftl_get_read_thread(const struct spdk_ftl_dev *dev)
 {
@@ -262,6 +279,12 @@ ftl_get_read_qpair(const struct spdk_ftl_dev *dev)
 	return dev->read_thread.qpair;
 }
 
+static inline struct spdk_io_channel *
+ftl_get_read_ioch(const struct spdk_ftl_dev *dev)
+{
+	return dev->read_thread.ioch;
+}
+
 static inline int
 ftl_ppa_packed(const struct spdk_ftl_dev *dev)
 {
@@ -380,7 +403,9 @@ ftl_l2p_set(struct spdk_ftl_dev *dev, uint64_t lba, struct ftl_ppa ppa)
 {
 	assert(dev->num_lbas > lba);
 
-	if (ftl_ppa_packed(dev)) {
+	if (dev->l2p_cache) {
+		ftl_l2p_cache_set(dev->l2p_cache, lba, ppa);
+	} else if (ftl_ppa_packed(dev)) {
 		_ftl_l2p_set32(dev->l2p, lba, ftl_ppa_to_packed(dev, ppa).ppa);
 	} else {
 		_ftl_l2p_set64(dev->l2p, lba, ppa.ppa);
@@ -392,13 +417,36 @@ ftl_l2p_get(struct spdk_ftl_dev *dev, uint64_t lba)
 {
 	assert(dev->num_lbas > lba);
 
-	if (ftl_ppa_packed(dev)) {
+	if (dev->l2p_cache) {
+		return ftl_l2p_cache_get(dev->l2p_cache, lba);
+	} else if (ftl_ppa_packed(dev)) {
 		return ftl_ppa_from_packed(dev, ftl_to_ppa_packed(
 						   _ftl_l2p_get32(dev->l2p, lba)));
 	} else {
 		return ftl_to_ppa(_ftl_l2p_get64(dev->l2p, lba));
 	}
 }
+
+/* Makes sure the lba's L2P entry stays in memory until it's unpinned. Returns */
+/* -EAGAIN if the entry first needs to be paged in, in which case the waiter's */
+/* (if any) callback is sent once the pin can be retried. */
+static inline int
+ftl_l2p_pin(struct spdk_ftl_dev *dev, uint64_t lba, struct ftl_l2p_waiter *waiter)
+{
+	if (!dev->l2p_cache) {
+		return 0;
+	}
+
+	return ftl_l2p_cache_pin(dev->l2p_cache, lba, waiter);
+}
+
+static inline void
+ftl_l2p_unpin(struct spdk_ftl_dev *dev, uint64_t lba)
+{
+	if (dev->l2p_cache) {
+		ftl_l2p_cache_unpin(dev->l2p_cache, lba);
+	}
+}
 static inline size_t
 ftl_dev_num_bands(const struct spdk_ftl_dev *dev)
 {
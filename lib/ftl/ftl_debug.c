@@ -32,6 +32,7 @@
  */
 
 #include "spdk_internal/log.h"
+#include "spdk/env.h"
 #include "spdk/ftl.h"
 #include "ftl_debug.h"
 
@@ -67,7 +68,15 @@ ftl_band_validate_md(struct ftl_band *band, const uint64_t *lba_map)
 		}
 
 		ppa_md = ftl_band_ppa_from_lbkoff(band, i);
-		ppa_l2p = ftl_l2p_get(dev, lba_map[i]);
+
+		/* Only the resident part of a paged L2P can be verified */
+		if (dev->l2p_cache) {
+			if (!ftl_l2p_cache_peek(dev->l2p_cache, lba_map[i], &ppa_l2p)) {
+				continue;
+			}
+		} else {
+			ppa_l2p = ftl_l2p_get(dev, lba_map[i]);
+		}
 
 		if (ppa_l2p.cached) {
 			continue;
@@ -128,12 +137,19 @@ ftl_dev_dump_stats(const struct spdk_ftl_dev *dev)
 	size_t i, total = 0;
 	char uuid[SPDK_UUID_STRING_LEN];
 	double waf;
+	struct ftl_l2p_cache_stats l2p;
 	const char *limits[] = {
 		[SPDK_FTL_LIMIT_CRIT]  = "crit",
 		[SPDK_FTL_LIMIT_HIGH]  = "high",
 		[SPDK_FTL_LIMIT_LOW]   = "low",
 		[SPDK_FTL_LIMIT_START] = "start"
 	};
+	const char *streams[] = {
+		[SPDK_FTL_STREAM_USER_HOT]	= "user_hot",
+		[SPDK_FTL_STREAM_USER_COLD]	= "user_cold",
+		[SPDK_FTL_STREAM_GC]		= "gc",
+	};
+	const struct spdk_ftl_stream_stats *stream;
 
 	if (!dev->bands) {
 		return;
@@ -153,10 +169,36 @@ ftl_dev_dump_stats(const struct spdk_ftl_dev *dev)
 	ftl_debug("total writes:        %"PRIu64"\n", dev->stats.write_total);
 	ftl_debug("user writes:         %"PRIu64"\n", dev->stats.write_user);
 	ftl_debug("WAF:                 %.4lf\n", waf);
+	ftl_debug("streams:\n");
+	for (i = 0; i < SPDK_FTL_STREAM_MAX; ++i) {
+		stream = &dev->stats.stream[i];
+		if (!stream->write_total) {
+			continue;
+		}
+
+		ftl_debug(" %9s: user: %"PRIu64", total: %"PRIu64, streams[i],
+			  stream->write_user, stream->write_total);
+		if (stream->write_user) {
+			ftl_debug(", WAF: %.4lf", (double)stream->write_total / (double)stream->write_user);
+		}
+		ftl_debug("\n");
+	}
 	ftl_debug("limits:\n");
 	for (i = 0; i < SPDK_FTL_LIMIT_MAX; ++i) {
 		ftl_debug(" %5s: %"PRIu64"\n", limits[i], dev->stats.limits[i]);
 	}
+
+	if (dev->l2p_cache) {
+		ftl_l2p_cache_get_stats(dev->l2p_cache, &l2p);
+		ftl_debug("L2P cache:\n");
+		ftl_debug(" hits:       %"PRIu64"\n", l2p.hits);
+		ftl_debug(" misses:     %"PRIu64"\n", l2p.misses);
+		ftl_debug(" page-ins:   %"PRIu64" (avg %.2lf us)\n", l2p.page_ins,
+			  l2p.page_ins ? (double)l2p.page_in_ticks * SPDK_SEC_TO_USEC /
+			  spdk_get_ticks_hz() / l2p.page_ins : 0.0);
+		ftl_debug(" evictions:  %"PRIu64"\n", l2p.evictions);
+		ftl_debug(" writebacks: %"PRIu64"\n", l2p.writebacks);
+	}
 }
 
 #endif /* defined(FTL_DUMP_STATS) */
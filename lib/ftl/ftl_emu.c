@@ -0,0 +1,563 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/bdev.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/nvme_ocssd_spec.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk_internal/log.h"
+
+#include "ftl_emu.h"
+#include "ftl_ppa.h"
+
+/* Minimal write size */
+#define FTL_EMU_WS_MIN			4
+/* Optimal write size (used by the FTL as its transfer size) */
+#define FTL_EMU_WS_OPT			16
+/* Number of chunks per parallel unit the device's capacity is split into */
+#define FTL_EMU_NUM_CHUNKS		128
+/* Chunk size boundaries (in blocks) */
+#define FTL_EMU_MIN_CHUNK_LBKS		(4 * FTL_EMU_WS_OPT)
+#define FTL_EMU_MAX_CHUNK_LBKS		16384
+/* Maximum number of parallel units (limited by the size of ftl_ppa's pu field) */
+#define FTL_EMU_MAX_PUNITS		256
+/* Number of outstanding requests per device */
+#define FTL_EMU_REQ_POOL_SIZE		(16 * 1024 - 1)
+
+enum ftl_emu_req_type {
+	FTL_EMU_REQ_READ,
+	FTL_EMU_REQ_WRITE,
+	FTL_EMU_REQ_MD_READ,
+	FTL_EMU_REQ_MD_WRITE,
+	FTL_EMU_REQ_RESET,
+};
+
+struct ftl_emu {
+	/* Base bdev's descriptor */
+	struct spdk_bdev_desc				*desc;
+	/* Base bdev */
+	struct spdk_bdev				*bdev;
+
+	/* Emulated geometry */
+	struct spdk_ocssd_geometry_data			geo;
+
+	/* Chunk information table, laid out the same way as the chunk info log page */
+	struct spdk_ocssd_chunk_information_entry	*chunks;
+	/* Number of entries in the chunk information table */
+	size_t						num_chunks;
+
+	/* Metadata region reserved at the end of the base bdev */
+	uint64_t					md_offset;
+	/* Size of the metadata region (in blocks) */
+	uint64_t					md_lbks;
+
+	/* Request pool */
+	struct spdk_mempool				*req_pool;
+};
+
+struct ftl_emu_req {
+	/* Owner */
+	struct ftl_emu					*emu;
+	/* Base bdev's IO channel */
+	struct spdk_io_channel				*ch;
+
+	enum ftl_emu_req_type				type;
+	void						*payload;
+	uint64_t					offset_blocks;
+	uint64_t					num_blocks;
+
+	/* Number of outstanding base bdev requests */
+	uint32_t					outstanding;
+	/* Completion status */
+	struct spdk_nvme_cpl				cpl;
+
+	/* Completion callback */
+	spdk_nvme_cmd_cb				cb_fn;
+	/* Completion callback's argument */
+	void						*cb_arg;
+
+	/* Used to resubmit the request once the base bdev is out of resources */
+	struct spdk_bdev_io_wait_entry			bdev_io_wait;
+};
+
+static unsigned int
+ftl_emu_addr_bits(uint64_t count)
+{
+	return count > 1 ? spdk_u32log2((uint32_t)(count - 1)) + 1 : 0;
+}
+
+struct ftl_emu *
+ftl_emu_init(struct spdk_bdev_desc *desc, unsigned int num_punits, uint64_t md_lbks,
+	     bool create)
+{
+	struct ftl_emu *emu;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+	struct spdk_ocssd_geometry_data *geo;
+	char pool_name[32];
+	uint64_t lbks_per_punit, clba;
+	size_t i;
+
+	if (spdk_bdev_get_block_size(bdev) != FTL_BLOCK_SIZE) {
+		SPDK_ERRLOG("Unsupported block size of bdev %s (%"PRIu32")\n",
+			    spdk_bdev_get_name(bdev), spdk_bdev_get_block_size(bdev));
+		return NULL;
+	}
+
+	if (num_punits == 0 || num_punits > FTL_EMU_MAX_PUNITS) {
+		SPDK_ERRLOG("Unsupported number of parallel units (%u)\n", num_punits);
+		return NULL;
+	}
+
+	if (md_lbks >= spdk_bdev_get_num_blocks(bdev)) {
+		SPDK_ERRLOG("Bdev %s is too small to hold %"PRIu64" metadata blocks\n",
+			    spdk_bdev_get_name(bdev), md_lbks);
+		return NULL;
+	}
+
+	lbks_per_punit = (spdk_bdev_get_num_blocks(bdev) - md_lbks) / num_punits;
+	clba = spdk_min(lbks_per_punit / FTL_EMU_NUM_CHUNKS, FTL_EMU_MAX_CHUNK_LBKS);
+	clba -= clba % FTL_EMU_WS_OPT;
+	if (clba < FTL_EMU_MIN_CHUNK_LBKS) {
+		SPDK_ERRLOG("Bdev %s is too small to be split into %u parallel units\n",
+			    spdk_bdev_get_name(bdev), num_punits);
+		return NULL;
+	}
+
+	emu = calloc(1, sizeof(*emu));
+	if (!emu) {
+		return NULL;
+	}
+
+	emu->desc = desc;
+	emu->bdev = bdev;
+	emu->md_lbks = md_lbks;
+	emu->md_offset = spdk_bdev_get_num_blocks(bdev) - md_lbks;
+
+	geo = &emu->geo;
+	geo->mjr = 2;
+	geo->num_grp = 1;
+	geo->num_pu = num_punits;
+	geo->clba = clba;
+	geo->num_chk = spdk_min(lbks_per_punit / clba, UINT16_MAX);
+	geo->ws_min = FTL_EMU_WS_MIN;
+	geo->ws_opt = FTL_EMU_WS_OPT;
+	geo->lbaf.grp_len = 0;
+	geo->lbaf.pu_len = ftl_emu_addr_bits(geo->num_pu);
+	geo->lbaf.chk_len = ftl_emu_addr_bits(geo->num_chk);
+	geo->lbaf.lbk_len = ftl_emu_addr_bits(geo->clba);
+
+	emu->num_chunks = (size_t)geo->num_pu * geo->num_chk;
+	emu->chunks = calloc(emu->num_chunks, sizeof(*emu->chunks));
+	if (!emu->chunks) {
+		goto error;
+	}
+
+	/* The chunk state isn't persisted, so when restoring an existing device */
+	/* all of the chunks need to be treated as written and reset before reuse */
+	for (i = 0; i < emu->num_chunks; ++i) {
+		emu->chunks[i].ct.seq_write = 1;
+		emu->chunks[i].slba = ((uint64_t)(i / geo->num_chk) << (geo->lbaf.lbk_len +
+				       geo->lbaf.chk_len)) |
+				      ((uint64_t)(i % geo->num_chk) << geo->lbaf.lbk_len);
+		emu->chunks[i].cnlb = geo->clba;
+
+		if (create) {
+			emu->chunks[i].cs.free = 1;
+			emu->chunks[i].wp = 0;
+		} else {
+			emu->chunks[i].cs.closed = 1;
+			emu->chunks[i].wp = geo->clba;
+		}
+	}
+
+	snprintf(pool_name, sizeof(pool_name), "ftl_emu_%p", emu);
+	emu->req_pool = spdk_mempool_create(pool_name, FTL_EMU_REQ_POOL_SIZE,
+					    sizeof(struct ftl_emu_req),
+					    SPDK_MEMPOOL_DEFAULT_CACHE_SIZE,
+					    SPDK_ENV_SOCKET_ID_ANY);
+	if (!emu->req_pool) {
+		goto error;
+	}
+
+	SPDK_DEBUGLOG(SPDK_LOG_FTL_EMU, "Emulating Open-Channel device on bdev %s:\n",
+		      spdk_bdev_get_name(bdev));
+	SPDK_DEBUGLOG(SPDK_LOG_FTL_EMU, "\tpunits:\t\t%"PRIu16"\n", geo->num_pu);
+	SPDK_DEBUGLOG(SPDK_LOG_FTL_EMU, "\tchunks:\t\t%"PRIu32"\n", geo->num_chk);
+	SPDK_DEBUGLOG(SPDK_LOG_FTL_EMU, "\tchunk size:\t%"PRIu32"\n", geo->clba);
+
+	return emu;
+error:
+	ftl_emu_free(emu);
+	return NULL;
+}
+
+void
+ftl_emu_free(struct ftl_emu *emu)
+{
+	if (!emu) {
+		return;
+	}
+
+	spdk_mempool_free(emu->req_pool);
+	free(emu->chunks);
+	free(emu);
+}
+
+struct spdk_bdev *
+ftl_emu_get_bdev(const struct ftl_emu *emu)
+{
+	return emu->bdev;
+}
+
+void
+ftl_emu_get_geometry(const struct ftl_emu *emu, struct spdk_ocssd_geometry_data *geo)
+{
+	*geo = emu->geo;
+}
+
+int
+ftl_emu_get_chunk_info(const struct ftl_emu *emu, uint64_t offset,
+		       struct spdk_ocssd_chunk_information_entry *info, size_t num_entries)
+{
+	if (offset + num_entries > emu->num_chunks) {
+		return -EINVAL;
+	}
+
+	memcpy(info, &emu->chunks[offset], num_entries * sizeof(*info));
+	return 0;
+}
+
+struct spdk_io_channel *
+ftl_emu_get_io_channel(struct ftl_emu *emu)
+{
+	return spdk_bdev_get_io_channel(emu->desc);
+}
+
+/* Translates the address into the chunk's index and the base bdev's offset. The */
+/* chunks are laid out so that each band (the same chunk on all parallel units) */
+/* occupies a contiguous range of blocks. */
+static int
+ftl_emu_translate(const struct ftl_emu *emu, uint64_t lba, uint64_t lba_count,
+		  size_t *chunk, uint64_t *offset_blocks)
+{
+	const struct spdk_ocssd_dev_lba_fmt *lbaf = &emu->geo.lbaf;
+	uint64_t lbk, chk, pu;
+
+	lbk = lba & ((1ULL << lbaf->lbk_len) - 1);
+	chk = (lba >> lbaf->lbk_len) & ((1ULL << lbaf->chk_len) - 1);
+	pu = (lba >> (lbaf->lbk_len + lbaf->chk_len)) & ((1ULL << lbaf->pu_len) - 1);
+
+	if ((lba >> (lbaf->lbk_len + lbaf->chk_len + lbaf->pu_len)) != 0 ||
+	    pu >= emu->geo.num_pu || chk >= emu->geo.num_chk ||
+	    lbk + lba_count > emu->geo.clba) {
+		return -EINVAL;
+	}
+
+	*chunk = pu * emu->geo.num_chk + chk;
+	*offset_blocks = (chk * emu->geo.num_pu + pu) * emu->geo.clba + lbk;
+	return 0;
+}
+
+static struct ftl_emu_req *
+ftl_emu_req_alloc(struct ftl_emu *emu, struct spdk_io_channel *ch, enum ftl_emu_req_type type,
+		  spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	struct ftl_emu_req *req;
+
+	req = spdk_mempool_get(emu->req_pool);
+	if (!req) {
+		return NULL;
+	}
+
+	memset(req, 0, sizeof(*req));
+	req->emu = emu;
+	req->ch = ch;
+	req->type = type;
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->outstanding = 1;
+
+	return req;
+}
+
+static void
+ftl_emu_req_put(struct ftl_emu_req *req)
+{
+	struct spdk_nvme_cpl cpl = req->cpl;
+	spdk_nvme_cmd_cb cb_fn = req->cb_fn;
+	void *cb_arg = req->cb_arg;
+
+	assert(req->outstanding > 0);
+	if (--req->outstanding > 0) {
+		return;
+	}
+
+	spdk_mempool_put(req->emu->req_pool, req);
+	cb_fn(cb_arg, &cpl);
+}
+
+static void
+_ftl_emu_req_put(void *ctx)
+{
+	ftl_emu_req_put(ctx);
+}
+
+static void
+ftl_emu_req_fail(struct ftl_emu_req *req, int sct, int sc)
+{
+	req->cpl.status.sct = sct;
+	req->cpl.status.sc = sc;
+
+	/* Complete the request asynchronously, the same way a device would */
+	spdk_thread_send_msg(spdk_get_thread(), _ftl_emu_req_put, req);
+}
+
+static void
+ftl_emu_bdev_io_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_emu_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success && req->type != FTL_EMU_REQ_RESET) {
+		req->cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+		req->cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+	}
+
+	ftl_emu_req_put(req);
+}
+
+static void
+ftl_emu_submit(void *ctx)
+{
+	struct ftl_emu_req *req = ctx;
+	struct ftl_emu *emu = req->emu;
+	int rc;
+
+	if (req->type == FTL_EMU_REQ_READ || req->type == FTL_EMU_REQ_MD_READ) {
+		rc = spdk_bdev_read_blocks(emu->desc, req->ch, req->payload, req->offset_blocks,
+					   req->num_blocks, ftl_emu_bdev_io_cb, req);
+	} else {
+		rc = spdk_bdev_write_blocks(emu->desc, req->ch, req->payload, req->offset_blocks,
+					    req->num_blocks, ftl_emu_bdev_io_cb, req);
+	}
+
+	if (spdk_unlikely(rc == -ENOMEM)) {
+		req->bdev_io_wait.bdev = emu->bdev;
+		req->bdev_io_wait.cb_fn = ftl_emu_submit;
+		req->bdev_io_wait.cb_arg = req;
+		rc = spdk_bdev_queue_io_wait(emu->bdev, req->ch, &req->bdev_io_wait);
+	}
+
+	if (spdk_unlikely(rc != 0)) {
+		SPDK_ERRLOG("Failed to submit request to bdev %s (%d)\n",
+			    spdk_bdev_get_name(emu->bdev), rc);
+		ftl_emu_req_fail(req, SPDK_NVME_SCT_GENERIC, SPDK_NVME_SC_INTERNAL_DEVICE_ERROR);
+	}
+}
+
+int
+ftl_emu_read(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+	     uint64_t lba, uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	struct ftl_emu_req *req;
+	uint64_t offset_blocks;
+	size_t chunk;
+
+	if (ftl_emu_translate(emu, lba, lba_count, &chunk, &offset_blocks)) {
+		return -EINVAL;
+	}
+
+	req = ftl_emu_req_alloc(emu, ch, FTL_EMU_REQ_READ, cb_fn, cb_arg);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	req->payload = payload;
+	req->offset_blocks = offset_blocks;
+	req->num_blocks = lba_count;
+
+	ftl_emu_submit(req);
+	return 0;
+}
+
+int
+ftl_emu_write(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+	      uint64_t lba, uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	struct spdk_ocssd_chunk_information_entry *info;
+	struct ftl_emu_req *req;
+	uint64_t offset_blocks;
+	size_t chunk;
+
+	if (ftl_emu_translate(emu, lba, lba_count, &chunk, &offset_blocks)) {
+		return -EINVAL;
+	}
+
+	req = ftl_emu_req_alloc(emu, ch, FTL_EMU_REQ_WRITE, cb_fn, cb_arg);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	/* Writes need to be issued sequentially, starting at the chunk's write */
+	/* pointer, in multiples of the minimal write size */
+	info = &emu->chunks[chunk];
+	if (info->cs.closed || info->cs.offline || lba_count == 0 ||
+	    lba_count % emu->geo.ws_min != 0 || offset_blocks % emu->geo.clba != info->wp) {
+		SPDK_DEBUGLOG(SPDK_LOG_FTL_EMU, "Out of order write, lba: %"PRIu64", wp: %"PRIu64
+			      "\n", lba, info->wp);
+		ftl_emu_req_fail(req, SPDK_NVME_SCT_MEDIA_ERROR, SPDK_OCSSD_SC_OUT_OF_ORDER_WRITE);
+		return 0;
+	}
+
+	info->wp += lba_count;
+	info->cs.free = 0;
+	info->cs.open = info->wp < emu->geo.clba;
+	info->cs.closed = !info->cs.open;
+
+	req->payload = payload;
+	req->offset_blocks = offset_blocks;
+	req->num_blocks = lba_count;
+
+	ftl_emu_submit(req);
+	return 0;
+}
+
+int
+ftl_emu_vector_reset(struct ftl_emu *emu, struct spdk_io_channel *ch, uint64_t *lba_list,
+		     uint32_t num_lbas, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	struct spdk_ocssd_chunk_information_entry *info;
+	struct ftl_emu_req *req;
+	uint64_t offset_blocks;
+	size_t chunk;
+	uint32_t i;
+	bool unmap;
+	int rc;
+
+	for (i = 0; i < num_lbas; ++i) {
+		if (ftl_emu_translate(emu, lba_list[i], 0, &chunk, &offset_blocks) ||
+		    offset_blocks % emu->geo.clba != 0) {
+			return -EINVAL;
+		}
+	}
+
+	req = ftl_emu_req_alloc(emu, ch, FTL_EMU_REQ_RESET, cb_fn, cb_arg);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	/* Deallocating the chunk is only a hint for the base bdev, so any failure */
+	/* to do so is ignored */
+	unmap = spdk_bdev_io_type_supported(emu->bdev, SPDK_BDEV_IO_TYPE_UNMAP);
+
+	for (i = 0; i < num_lbas; ++i) {
+		ftl_emu_translate(emu, lba_list[i], 0, &chunk, &offset_blocks);
+
+		info = &emu->chunks[chunk];
+		info->cs.open = 0;
+		info->cs.closed = 0;
+		info->cs.free = 1;
+		info->wp = 0;
+
+		if (!unmap) {
+			continue;
+		}
+
+		rc = spdk_bdev_unmap_blocks(emu->desc, ch, offset_blocks, emu->geo.clba,
+					    ftl_emu_bdev_io_cb, req);
+		if (spdk_likely(rc == 0)) {
+			req->outstanding++;
+		}
+	}
+
+	/* Drop the submission reference */
+	if (req->outstanding == 1) {
+		spdk_thread_send_msg(spdk_get_thread(), _ftl_emu_req_put, req);
+	} else {
+		ftl_emu_req_put(req);
+	}
+
+	return 0;
+}
+
+static int
+ftl_emu_md_submit(struct ftl_emu *emu, struct spdk_io_channel *ch, enum ftl_emu_req_type type,
+		  void *payload, uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn,
+		  void *cb_arg)
+{
+	struct ftl_emu_req *req;
+
+	if (lbk_count == 0 || lbk + lbk_count > emu->md_lbks) {
+		return -EINVAL;
+	}
+
+	req = ftl_emu_req_alloc(emu, ch, type, cb_fn, cb_arg);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	req->payload = payload;
+	req->offset_blocks = emu->md_offset + lbk;
+	req->num_blocks = lbk_count;
+
+	ftl_emu_submit(req);
+	return 0;
+}
+
+uint64_t
+ftl_emu_get_md_lbks(const struct ftl_emu *emu)
+{
+	return emu->md_lbks;
+}
+
+int
+ftl_emu_md_read(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+		uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return ftl_emu_md_submit(emu, ch, FTL_EMU_REQ_MD_READ, payload, lbk, lbk_count,
+				 cb_fn, cb_arg);
+}
+
+int
+ftl_emu_md_write(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+		 uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return ftl_emu_md_submit(emu, ch, FTL_EMU_REQ_MD_WRITE, payload, lbk, lbk_count,
+				 cb_fn, cb_arg);
+}
+
+SPDK_LOG_REGISTER_COMPONENT("ftl_emu", SPDK_LOG_FTL_EMU)
@@ -0,0 +1,79 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FTL_EMU_H
+#define FTL_EMU_H
+
+#include "spdk/stdinc.h"
+#include "spdk/nvme.h"
+#include "spdk/nvme_ocssd_spec.h"
+
+struct ftl_emu;
+struct spdk_bdev;
+struct spdk_bdev_desc;
+struct spdk_io_channel;
+
+/* Open-Channel emulation on top of a regular bdev. The base bdev is split into */
+/* num_punits parallel units made of equally sized chunks. The chunk state and */
+/* write pointers are kept in memory only, so when the device is not created */
+/* from scratch, all of the chunks are reported as closed and need to be reset */
+/* before they're written again. Chunk state is only modified from the thread */
+/* submitting writes and resets. The last md_lbks blocks of the base bdev are */
+/* excluded from the emulated geometry and can be accessed directly through */
+/* ftl_emu_md_read/write() (offsets are relative to the start of that region). */
+struct ftl_emu	*ftl_emu_init(struct spdk_bdev_desc *desc, unsigned int num_punits,
+			      uint64_t md_lbks, bool create);
+void		ftl_emu_free(struct ftl_emu *emu);
+struct spdk_bdev *ftl_emu_get_bdev(const struct ftl_emu *emu);
+void		ftl_emu_get_geometry(const struct ftl_emu *emu,
+				     struct spdk_ocssd_geometry_data *geo);
+int		ftl_emu_get_chunk_info(const struct ftl_emu *emu, uint64_t offset,
+				       struct spdk_ocssd_chunk_information_entry *info,
+				       size_t num_entries);
+struct spdk_io_channel *ftl_emu_get_io_channel(struct ftl_emu *emu);
+int		ftl_emu_read(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+			     uint64_t lba, uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int		ftl_emu_write(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+			      uint64_t lba, uint32_t lba_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+int		ftl_emu_vector_reset(struct ftl_emu *emu, struct spdk_io_channel *ch,
+				     uint64_t *lba_list, uint32_t num_lbas,
+				     spdk_nvme_cmd_cb cb_fn, void *cb_arg);
+uint64_t	ftl_emu_get_md_lbks(const struct ftl_emu *emu);
+int		ftl_emu_md_read(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+				uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn,
+				void *cb_arg);
+int		ftl_emu_md_write(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+				 uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn,
+				 void *cb_arg);
+
+#endif /* FTL_EMU_H */
@@ -44,6 +44,7 @@
 #include "ftl_rwb.h"
 #include "ftl_band.h"
 #include "ftl_debug.h"
+#include "ftl_emu.h"
 
 #define FTL_CORE_RING_SIZE	4096
 #define FTL_INIT_TIMEOUT	30
@@ -115,6 +116,17 @@ ftl_band_init_md(struct ftl_band *band)
 	return 0;
 }
 
+static bool
+ftl_dev_same_media(const struct spdk_ftl_dev *dev, const struct spdk_ftl_dev_init_opts *opts)
+{
+	if (dev->emu || opts->base_bdev_desc) {
+		return dev->emu && opts->base_bdev_desc &&
+		       ftl_emu_get_bdev(dev->emu) == spdk_bdev_desc_get_bdev(opts->base_bdev_desc);
+	}
+
+	return !spdk_nvme_transport_id_compare(&dev->trid, &opts->trid);
+}
+
 static int
 ftl_check_init_opts(const struct spdk_ftl_dev_init_opts *opts,
 		    const struct spdk_ocssd_geometry_data *geo)
@@ -127,10 +139,15 @@ ftl_check_init_opts(const struct spdk_ftl_dev_init_opts *opts,
 		return -1;
 	}
 
+	/* Only emulated devices have a region to page the L2P out to */
+	if (opts->conf && opts->conf->l2p_cache_size && !opts->base_bdev_desc) {
+		return -1;
+	}
+
 	pthread_mutex_lock(&g_ftl_queue_lock);
 
 	STAILQ_FOREACH(dev, &g_ftl_queue, stailq) {
-		if (spdk_nvme_transport_id_compare(&dev->trid, &opts->trid)) {
+		if (!ftl_dev_same_media(dev, opts)) {
 			continue;
 		}
 
@@ -152,8 +169,13 @@ ftl_retrieve_bbt_page(struct spdk_ftl_dev *dev, uint64_t offset,
 		      unsigned int num_entries)
 {
 	volatile struct ftl_admin_cmpl cmpl = {};
-	uint32_t nsid = spdk_nvme_ns_get_id(dev->ns);
+	uint32_t nsid;
+
+	if (dev->emu) {
+		return ftl_emu_get_chunk_info(dev->emu, offset, info, num_entries);
+	}
 
+	nsid = spdk_nvme_ns_get_id(dev->ns);
 	if (spdk_nvme_ctrlr_cmd_get_log_page(dev->ctrlr, SPDK_OCSSD_LOG_CHUNK_INFO, nsid,
 					     info, num_entries * sizeof(*info),
 					     offset * sizeof(*info),
@@ -344,7 +366,7 @@ ftl_dev_init_punits(struct spdk_ftl_dev *dev)
 }
 
 static int
-ftl_dev_retrieve_geo(struct spdk_ftl_dev *dev)
+ftl_dev_retrieve_ocssd_geo(struct spdk_ftl_dev *dev)
 {
 	volatile struct ftl_admin_cmpl cmpl = {};
 	uint32_t nsid = spdk_nvme_ns_get_id(dev->ns);
@@ -366,6 +388,18 @@ ftl_dev_retrieve_geo(struct spdk_ftl_dev *dev)
 		return -1;
 	}
 
+	return 0;
+}
+
+static int
+ftl_dev_retrieve_geo(struct spdk_ftl_dev *dev)
+{
+	if (dev->emu) {
+		ftl_emu_get_geometry(dev->emu, &dev->geo);
+	} else if (ftl_dev_retrieve_ocssd_geo(dev)) {
+		return -1;
+	}
+
 	/* TODO: add sanity checks for the geo */
 	dev->ppa_len = dev->geo.lbaf.grp_len +
 		       dev->geo.lbaf.pu_len +
@@ -387,11 +421,42 @@ ftl_dev_retrieve_geo(struct spdk_ftl_dev *dev)
 	return 0;
 }
 
+static int
+ftl_dev_emu_init(struct spdk_ftl_dev *dev, const struct spdk_ftl_dev_init_opts *opts)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(opts->base_bdev_desc);
+	uint64_t md_lbks = 0;
+
+	/* Reserve enough space to swap out the whole L2P, assuming the widest */
+	/* entries (the actual number of LBAs isn't known at this point yet) */
+	if (dev->conf.l2p_cache_size) {
+		md_lbks = spdk_divide_round_up(spdk_bdev_get_num_blocks(bdev) * sizeof(uint64_t),
+					       FTL_BLOCK_SIZE);
+	}
+
+	/* Emulated parallel units are numbered from zero, so the range's end */
+	/* determines how many of them the base bdev is split into */
+	dev->emu = ftl_emu_init(opts->base_bdev_desc, opts->range.end + 1, md_lbks,
+				opts->mode & SPDK_FTL_MODE_CREATE);
+	if (!dev->emu) {
+		return -1;
+	}
+
+	/* The base bdev doesn't provide any metadata, everything the FTL needs */
+	/* is stored in the band's head / tail metadata */
+	dev->md_size = 0;
+	return 0;
+}
+
 static int
 ftl_dev_nvme_init(struct spdk_ftl_dev *dev, const struct spdk_ftl_dev_init_opts *opts)
 {
 	uint32_t block_size;
 
+	if (opts->base_bdev_desc) {
+		return ftl_dev_emu_init(dev, opts);
+	}
+
 	dev->ctrlr = opts->ctrlr;
 
 	if (spdk_nvme_ctrlr_get_num_ns(dev->ctrlr) != 1) {
@@ -438,6 +503,9 @@ ftl_conf_validate(const struct spdk_ftl_conf *conf)
 	if (conf->rwb_size % FTL_BLOCK_SIZE != 0) {
 		return -1;
 	}
+	if (conf->l2p_cache_size && conf->l2p_cache_size < ftl_l2p_cache_min_size(conf)) {
+		return -1;
+	}
 
 	for (i = 0; i < SPDK_FTL_LIMIT_MAX; ++i) {
 		if (conf->defrag.limits[i].limit > 100) {
@@ -564,6 +632,17 @@ _ftl_dev_init_thread(void *ctx)
 		assert(0);
 	}
 
+	if (dev->emu) {
+		thread->ioch = ftl_emu_get_io_channel(dev->emu);
+		if (!thread->ioch) {
+			SPDK_ERRLOG("Unable to get base bdev's IO channel\n");
+			assert(0);
+		}
+
+		/* There are no asynchronous media notifications to process */
+		return;
+	}
+
 	if (spdk_get_thread() == ftl_get_core_thread(dev)) {
 		ftl_anm_register_device(dev, ftl_process_anm_event);
 	}
@@ -578,10 +657,13 @@ ftl_dev_init_thread(struct spdk_ftl_dev *dev, struct ftl_thread *thread,
 	thread->thread = spdk_thread;
 	thread->period_us = period_us;
 
-	thread->qpair = spdk_nvme_ctrlr_alloc_io_qpair(dev->ctrlr, NULL, 0);
-	if (!thread->qpair) {
-		SPDK_ERRLOG("Unable to initialize qpair\n");
-		return -1;
+	/* Emulated devices acquire the base bdev's channel on the thread itself */
+	if (!dev->emu) {
+		thread->qpair = spdk_nvme_ctrlr_alloc_io_qpair(dev->ctrlr, NULL, 0);
+		if (!thread->qpair) {
+			SPDK_ERRLOG("Unable to initialize qpair\n");
+			return -1;
+		}
 	}
 
 	spdk_thread_send_msg(spdk_thread, _ftl_dev_init_thread, thread);
@@ -612,8 +694,11 @@ static void
 ftl_dev_free_thread(struct spdk_ftl_dev *dev, struct ftl_thread *thread)
 {
 	assert(thread->poller == NULL);
+	assert(thread->ioch == NULL);
 
-	spdk_nvme_ctrlr_free_io_qpair(thread->qpair);
+	if (thread->qpair) {
+		spdk_nvme_ctrlr_free_io_qpair(thread->qpair);
+	}
 	thread->thread = NULL;
 	thread->qpair = NULL;
 }
@@ -629,12 +714,24 @@ ftl_dev_l2p_alloc(struct spdk_ftl_dev *dev)
 		return -1;
 	}
 
-	if (dev->l2p) {
+	if (dev->l2p || dev->l2p_cache) {
 		SPDK_DEBUGLOG(SPDK_LOG_FTL_INIT, "L2p table already allocated\n");
 		return -1;
 	}
 
 	addr_size = dev->ppa_len >= 32 ? 8 : 4;
+
+	/* Page the table only if it doesn't fit in the configured cache size */
+	if (dev->conf.l2p_cache_size && dev->num_lbas * addr_size > dev->conf.l2p_cache_size) {
+		assert(dev->emu);
+		dev->l2p_cache = ftl_l2p_cache_init(dev, dev->conf.l2p_cache_size);
+		if (!dev->l2p_cache) {
+			SPDK_DEBUGLOG(SPDK_LOG_FTL_INIT, "Failed to allocate l2p cache\n");
+			return -1;
+		}
+
+		return 0;
+	}
 	dev->l2p = malloc(dev->num_lbas * addr_size);
 	if (!dev->l2p) {
 		SPDK_DEBUGLOG(SPDK_LOG_FTL_INIT, "Failed to allocate l2p table\n");
@@ -969,11 +1066,13 @@ ftl_dev_free_sync(struct spdk_ftl_dev *dev)
 
 	ftl_rwb_free(dev->rwb);
 	ftl_reloc_free(dev->reloc);
+	ftl_emu_free(dev->emu);
 
 	free(dev->name);
 	free(dev->punits);
 	free(dev->bands);
 	free(dev->l2p);
+	ftl_l2p_cache_free(dev->l2p_cache);
 	free(dev);
 }
 
@@ -987,7 +1086,10 @@ ftl_halt_poller(void *ctx)
 	if (!dev->core_thread.poller && !dev->read_thread.poller) {
 		spdk_poller_unregister(&dev->halt_poller);
 
-		ftl_anm_unregister_device(dev);
+		if (!dev->emu) {
+			ftl_anm_unregister_device(dev);
+		}
+
 		ftl_dev_free_sync(dev);
 
 		if (halt_cb) {
@@ -1006,7 +1108,7 @@ ftl_add_halt_poller(void *ctx)
 	_ftl_halt_defrag(dev);
 
 	assert(!dev->halt_poller);
-	dev->halt_poller = spdk_poller_register(ftl_halt_poller, dev, 100);
+	dev->halt_poller = SPDK_POLLER_REGISTER(ftl_halt_poller, dev, 100);
 }
 
 int
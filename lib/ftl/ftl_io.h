@@ -40,6 +40,7 @@
 
 #include "ftl_ppa.h"
 #include "ftl_trace.h"
+#include "ftl_l2p_cache.h"
 
 struct spdk_ftl_dev;
 struct ftl_rwb_batch;
@@ -68,6 +69,8 @@ enum ftl_io_flags {
 	FTL_IO_PPA_MODE		= (1 << 6),
 	/* Indicates that IO contains noncontiguous LBAs */
 	FTL_IO_VECTOR_LBA	= (1 << 7),
+	/* The data is expected to stay valid for a long time */
+	FTL_IO_COLD		= (1 << 8),
 };
 
 enum ftl_io_type {
@@ -197,6 +200,9 @@ struct ftl_io {
 
 	/* Trace group id */
 	uint64_t				trace;
+
+	/* Resumes the IO once its L2P page is paged in */
+	struct ftl_l2p_waiter			l2p_waiter;
 };
 
 /* Metadata IO */
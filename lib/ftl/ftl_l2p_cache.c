@@ -0,0 +1,568 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/bit_array.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/queue.h"
+#include "spdk/thread.h"
+#include "spdk_internal/log.h"
+
+#include "ftl_core.h"
+#include "ftl_emu.h"
+#include "ftl_l2p_cache.h"
+
+/* Number of pages on top of the ones pinned by the write buffer's entries, */
+/* needed to keep the reads, restore and page-ins going */
+#define FTL_L2P_CACHE_EXTRA_PAGES	256
+
+enum ftl_l2p_page_state {
+	/* Page's contents are valid */
+	FTL_L2P_PAGE_READY,
+	/* Page is being read from the device */
+	FTL_L2P_PAGE_LOADING,
+	/* Page is being written back to the device (its contents stay valid) */
+	FTL_L2P_PAGE_WRITEBACK,
+};
+
+TAILQ_HEAD(ftl_l2p_waiter_list, ftl_l2p_waiter);
+
+struct ftl_l2p_page {
+	/* Owner */
+	struct ftl_l2p_cache			*cache;
+
+	/* Index of the page within the L2P table */
+	uint64_t				id;
+
+	/* Page's buffer */
+	void					*buf;
+
+	enum ftl_l2p_page_state			state;
+
+	/* Number of pins, pinned pages are not on the LRU list */
+	unsigned int				pin_cnt;
+
+	/* Indicates the page has been modified since it was last stored */
+	bool					dirty;
+
+	/* Page-in start (in ticks) */
+	uint64_t				io_start;
+
+	/* Pins waiting for the page-in to complete */
+	struct ftl_l2p_waiter_list		waiters;
+
+	/* Free / LRU list entry */
+	TAILQ_ENTRY(ftl_l2p_page)		list_entry;
+};
+
+struct ftl_l2p_cache {
+	/* Owner */
+	struct spdk_ftl_dev			*dev;
+
+	/* Number of entries per page */
+	size_t					entries_per_page;
+	/* Number of pages of the whole table */
+	uint64_t				num_pages;
+	/* Page table, points at the resident pages */
+	struct ftl_l2p_page			**page_table;
+	/* Pages that have been stored on the device at least once, the rest of */
+	/* them don't have to be read, as they don't map any LBAs */
+	struct spdk_bit_array			*stored;
+
+	/* Resident pages */
+	struct ftl_l2p_page			*pages;
+	/* Number of resident pages */
+	size_t					num_cached;
+	/* Pages' buffers */
+	void					*buf;
+
+	/* Unused pages */
+	TAILQ_HEAD(, ftl_l2p_page)		free_list;
+	/* Unpinned pages, from the least recently used */
+	TAILQ_HEAD(, ftl_l2p_page)		lru_list;
+
+	/* Pins waiting for a page to be freed or unpinned */
+	struct ftl_l2p_waiter_list		waiters;
+
+	/* Protects the page table, lists, page states and statistics */
+	pthread_spinlock_t			lock;
+
+	struct ftl_l2p_cache_stats		stats;
+};
+
+static void ftl_l2p_page_submit(void *ctx);
+
+static size_t
+ftl_l2p_addr_size(const struct spdk_ftl_dev *dev)
+{
+	return ftl_ppa_packed(dev) ? sizeof(uint32_t) : sizeof(uint64_t);
+}
+
+static void
+ftl_l2p_page_store(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page,
+		   size_t offset, struct ftl_ppa ppa)
+{
+	struct spdk_ftl_dev *dev = cache->dev;
+
+	if (ftl_ppa_packed(dev)) {
+		_ftl_l2p_set32(page->buf, offset, ftl_ppa_to_packed(dev, ppa).ppa);
+	} else {
+		_ftl_l2p_set64(page->buf, offset, ppa.ppa);
+	}
+}
+
+static struct ftl_ppa
+ftl_l2p_page_load(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page, size_t offset)
+{
+	struct spdk_ftl_dev *dev = cache->dev;
+
+	if (ftl_ppa_packed(dev)) {
+		return ftl_ppa_from_packed(dev, ftl_to_ppa_packed(_ftl_l2p_get32(page->buf, offset)));
+	} else {
+		return ftl_to_ppa(_ftl_l2p_get64(page->buf, offset));
+	}
+}
+
+size_t
+ftl_l2p_cache_min_size(const struct spdk_ftl_conf *conf)
+{
+	/* Each of the write buffer's entries keeps its page pinned until it's evicted */
+	return (conf->rwb_size / FTL_BLOCK_SIZE + FTL_L2P_CACHE_EXTRA_PAGES) * FTL_BLOCK_SIZE;
+}
+
+struct ftl_l2p_cache *
+ftl_l2p_cache_init(struct spdk_ftl_dev *dev, size_t cache_size)
+{
+	struct ftl_l2p_cache *cache;
+	struct ftl_l2p_page *page;
+	size_t i;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		return NULL;
+	}
+
+	cache->dev = dev;
+	cache->entries_per_page = FTL_BLOCK_SIZE / ftl_l2p_addr_size(dev);
+	cache->num_pages = spdk_divide_round_up(dev->num_lbas, cache->entries_per_page);
+	cache->num_cached = spdk_min(cache_size / FTL_BLOCK_SIZE, cache->num_pages);
+	TAILQ_INIT(&cache->free_list);
+	TAILQ_INIT(&cache->lru_list);
+	TAILQ_INIT(&cache->waiters);
+
+	if (pthread_spin_init(&cache->lock, PTHREAD_PROCESS_PRIVATE)) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->page_table = calloc(cache->num_pages, sizeof(*cache->page_table));
+	if (!cache->page_table) {
+		goto error;
+	}
+
+	cache->stored = spdk_bit_array_create(cache->num_pages);
+	if (!cache->stored) {
+		goto error;
+	}
+
+	cache->pages = calloc(cache->num_cached, sizeof(*cache->pages));
+	if (!cache->pages) {
+		goto error;
+	}
+
+	cache->buf = spdk_dma_zmalloc(cache->num_cached * FTL_BLOCK_SIZE, FTL_BLOCK_SIZE, NULL);
+	if (!cache->buf) {
+		goto error;
+	}
+
+	for (i = 0; i < cache->num_cached; ++i) {
+		page = &cache->pages[i];
+		page->cache = cache;
+		page->buf = (char *)cache->buf + i * FTL_BLOCK_SIZE;
+		TAILQ_INIT(&page->waiters);
+		TAILQ_INSERT_TAIL(&cache->free_list, page, list_entry);
+	}
+
+	return cache;
+error:
+	ftl_l2p_cache_free(cache);
+	return NULL;
+}
+
+void
+ftl_l2p_cache_free(struct ftl_l2p_cache *cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	assert(TAILQ_EMPTY(&cache->waiters));
+	spdk_dma_free(cache->buf);
+	free(cache->pages);
+	spdk_bit_array_free(&cache->stored);
+	free(cache->page_table);
+	pthread_spin_destroy(&cache->lock);
+	free(cache);
+}
+
+static struct ftl_l2p_page *
+ftl_l2p_cache_get_page(struct ftl_l2p_cache *cache, uint64_t lba)
+{
+	struct ftl_l2p_page *page;
+
+	assert(lba < cache->dev->num_lbas);
+	page = cache->page_table[lba / cache->entries_per_page];
+	assert(page != NULL);
+	assert(page->pin_cnt > 0);
+
+	return page;
+}
+
+static void
+ftl_l2p_waiter_queue(struct ftl_l2p_waiter_list *waiters, struct ftl_l2p_waiter *waiter)
+{
+	if (waiter) {
+		waiter->thread = spdk_get_thread();
+		TAILQ_INSERT_TAIL(waiters, waiter, tailq);
+	}
+}
+
+/* Moves the waiters onto a local list, so that they can be notified once the */
+/* lock is released */
+static void
+ftl_l2p_waiters_move(struct ftl_l2p_waiter_list *dst, struct ftl_l2p_waiter_list *src)
+{
+	struct ftl_l2p_waiter *waiter;
+
+	while ((waiter = TAILQ_FIRST(src))) {
+		TAILQ_REMOVE(src, waiter, tailq);
+		TAILQ_INSERT_TAIL(dst, waiter, tailq);
+	}
+}
+
+static void
+ftl_l2p_waiters_notify(struct ftl_l2p_waiter_list *waiters)
+{
+	struct ftl_l2p_waiter *waiter;
+
+	while ((waiter = TAILQ_FIRST(waiters))) {
+		TAILQ_REMOVE(waiters, waiter, tailq);
+		spdk_thread_send_msg(waiter->thread, waiter->cb_fn, waiter->cb_arg);
+	}
+}
+
+static void
+ftl_l2p_page_schedule(struct ftl_l2p_page *page)
+{
+	struct spdk_ftl_dev *dev = page->cache->dev;
+
+	__atomic_fetch_add(&dev->num_inflight, 1, __ATOMIC_SEQ_CST);
+
+	/* Page transfers are always issued on the core thread's channel */
+	if (spdk_get_thread() == ftl_get_core_thread(dev)) {
+		ftl_l2p_page_submit(page);
+	} else {
+		spdk_thread_send_msg(ftl_get_core_thread(dev), ftl_l2p_page_submit, page);
+	}
+}
+
+static void
+ftl_l2p_page_drop(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	assert(cache->page_table[page->id] == page);
+	assert(page->pin_cnt == 0);
+
+	cache->page_table[page->id] = NULL;
+	TAILQ_INSERT_TAIL(&cache->free_list, page, list_entry);
+}
+
+static void
+ftl_l2p_page_cmpl_cb(void *ctx, const struct spdk_nvme_cpl *cpl)
+{
+	struct ftl_l2p_page *page = ctx;
+	struct ftl_l2p_cache *cache = page->cache;
+	struct spdk_ftl_dev *dev = cache->dev;
+	struct ftl_l2p_waiter_list waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	bool success = !spdk_nvme_cpl_is_error(cpl);
+
+	pthread_spin_lock(&cache->lock);
+
+	if (page->state == FTL_L2P_PAGE_LOADING) {
+		/* Either way the pins waiting for this page need to be retried */
+		ftl_l2p_waiters_move(&waiters, &page->waiters);
+
+		if (spdk_unlikely(!success)) {
+			/* Drop the page, the next pin will try to read it again */
+			SPDK_ERRLOG("Failed to read L2P page %"PRIu64"\n", page->id);
+			ftl_l2p_page_drop(cache, page);
+			goto free;
+		}
+
+		cache->stats.page_ins++;
+		cache->stats.page_in_ticks += spdk_get_ticks() - page->io_start;
+		page->state = FTL_L2P_PAGE_READY;
+		TAILQ_INSERT_TAIL(&cache->lru_list, page, list_entry);
+		goto free;
+	}
+
+	assert(page->state == FTL_L2P_PAGE_WRITEBACK);
+	page->state = FTL_L2P_PAGE_READY;
+
+	if (spdk_likely(success)) {
+		spdk_bit_array_set(cache->stored, page->id);
+		cache->stats.writebacks++;
+	} else {
+		SPDK_ERRLOG("Failed to write back L2P page %"PRIu64"\n", page->id);
+		page->dirty = true;
+	}
+
+	/* The page might have been pinned or modified in the meantime, in which */
+	/* case it needs to stay resident */
+	if (page->pin_cnt > 0) {
+		goto out;
+	}
+
+	if (__atomic_load_n(&page->dirty, __ATOMIC_SEQ_CST)) {
+		TAILQ_INSERT_TAIL(&cache->lru_list, page, list_entry);
+	} else {
+		cache->stats.evictions++;
+		ftl_l2p_page_drop(cache, page);
+	}
+free:
+	/* The page can be reused now, so let the pins that didn't get one retry */
+	ftl_l2p_waiters_move(&waiters, &cache->waiters);
+out:
+	pthread_spin_unlock(&cache->lock);
+	ftl_l2p_waiters_notify(&waiters);
+	__atomic_fetch_sub(&dev->num_inflight, 1, __ATOMIC_SEQ_CST);
+}
+
+static void
+ftl_l2p_page_submit(void *ctx)
+{
+	struct ftl_l2p_page *page = ctx;
+	struct spdk_ftl_dev *dev = page->cache->dev;
+	struct spdk_nvme_cpl cpl = {};
+	int rc;
+
+	/* The state can't change until the transfer is completed */
+	if (page->state == FTL_L2P_PAGE_LOADING) {
+		rc = ftl_emu_md_read(dev->emu, ftl_get_write_ioch(dev), page->buf, page->id, 1,
+				     ftl_l2p_page_cmpl_cb, page);
+	} else {
+		rc = ftl_emu_md_write(dev->emu, ftl_get_write_ioch(dev), page->buf, page->id, 1,
+				      ftl_l2p_page_cmpl_cb, page);
+	}
+
+	if (spdk_unlikely(rc == -ENOMEM)) {
+		spdk_thread_send_msg(ftl_get_core_thread(dev), ftl_l2p_page_submit, page);
+		return;
+	}
+
+	if (spdk_unlikely(rc != 0)) {
+		cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+		cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+		ftl_l2p_page_cmpl_cb(page, &cpl);
+	}
+}
+
+/* Finds a page to hold a new part of the table. If the least recently used page */
+/* is dirty, it's written back first and NULL is returned (the page is freed */
+/* once the write completes). */
+static struct ftl_l2p_page *
+ftl_l2p_page_alloc(struct ftl_l2p_cache *cache, struct ftl_l2p_page **writeback)
+{
+	struct ftl_l2p_page *page;
+
+	page = TAILQ_FIRST(&cache->free_list);
+	if (page) {
+		TAILQ_REMOVE(&cache->free_list, page, list_entry);
+		return page;
+	}
+
+	page = TAILQ_FIRST(&cache->lru_list);
+	if (!page) {
+		return NULL;
+	}
+
+	TAILQ_REMOVE(&cache->lru_list, page, list_entry);
+	assert(page->state == FTL_L2P_PAGE_READY && page->pin_cnt == 0);
+
+	if (__atomic_load_n(&page->dirty, __ATOMIC_SEQ_CST)) {
+		/* The dirty flag needs to be cleared before the transfer is started, */
+		/* so that any modifications done while it's in progress are noticed */
+		__atomic_store_n(&page->dirty, false, __ATOMIC_SEQ_CST);
+		page->state = FTL_L2P_PAGE_WRITEBACK;
+		*writeback = page;
+		return NULL;
+	}
+
+	cache->stats.evictions++;
+	cache->page_table[page->id] = NULL;
+	return page;
+}
+
+int
+ftl_l2p_cache_pin(struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_l2p_waiter *waiter)
+{
+	struct ftl_l2p_page *page, *writeback = NULL, *load = NULL;
+	uint64_t id = lba / cache->entries_per_page;
+	size_t i;
+	int rc = -EAGAIN;
+
+	assert(lba < cache->dev->num_lbas);
+
+	pthread_spin_lock(&cache->lock);
+
+	page = cache->page_table[id];
+	if (page) {
+		/* Wait for the page-in to complete */
+		if (page->state == FTL_L2P_PAGE_LOADING) {
+			ftl_l2p_waiter_queue(&page->waiters, waiter);
+			goto out;
+		}
+
+		if (page->pin_cnt++ == 0 && page->state == FTL_L2P_PAGE_READY) {
+			TAILQ_REMOVE(&cache->lru_list, page, list_entry);
+		}
+
+		cache->stats.hits++;
+		rc = 0;
+		goto out;
+	}
+
+	page = ftl_l2p_page_alloc(cache, &writeback);
+	if (!page) {
+		/* Wait for the write back to complete or for a page to be unpinned */
+		ftl_l2p_waiter_queue(&cache->waiters, waiter);
+		goto out;
+	}
+
+	cache->stats.misses++;
+	cache->page_table[id] = page;
+	page->id = id;
+	page->dirty = false;
+
+	/* Pages that were never stored don't have any LBAs mapped */
+	if (!spdk_bit_array_get(cache->stored, id)) {
+		for (i = 0; i < cache->entries_per_page; ++i) {
+			ftl_l2p_page_store(cache, page, i, ftl_to_ppa(FTL_PPA_INVALID));
+		}
+
+		page->state = FTL_L2P_PAGE_READY;
+		page->pin_cnt = 1;
+		rc = 0;
+		goto out;
+	}
+
+	page->state = FTL_L2P_PAGE_LOADING;
+	page->io_start = spdk_get_ticks();
+	load = page;
+	ftl_l2p_waiter_queue(&page->waiters, waiter);
+out:
+	pthread_spin_unlock(&cache->lock);
+
+	if (writeback) {
+		ftl_l2p_page_schedule(writeback);
+	}
+
+	if (load) {
+		ftl_l2p_page_schedule(load);
+	}
+
+	return rc;
+}
+
+void
+ftl_l2p_cache_unpin(struct ftl_l2p_cache *cache, uint64_t lba)
+{
+	struct ftl_l2p_waiter_list waiters = TAILQ_HEAD_INITIALIZER(waiters);
+	struct ftl_l2p_page *page;
+
+	pthread_spin_lock(&cache->lock);
+
+	page = ftl_l2p_cache_get_page(cache, lba);
+	if (--page->pin_cnt == 0 && page->state == FTL_L2P_PAGE_READY) {
+		TAILQ_INSERT_TAIL(&cache->lru_list, page, list_entry);
+		ftl_l2p_waiters_move(&waiters, &cache->waiters);
+	}
+
+	pthread_spin_unlock(&cache->lock);
+
+	ftl_l2p_waiters_notify(&waiters);
+}
+
+struct ftl_ppa
+ftl_l2p_cache_get(struct ftl_l2p_cache *cache, uint64_t lba)
+{
+	struct ftl_l2p_page *page = ftl_l2p_cache_get_page(cache, lba);
+
+	return ftl_l2p_page_load(cache, page, lba % cache->entries_per_page);
+}
+
+void
+ftl_l2p_cache_set(struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa ppa)
+{
+	struct ftl_l2p_page *page = ftl_l2p_cache_get_page(cache, lba);
+
+	ftl_l2p_page_store(cache, page, lba % cache->entries_per_page, ppa);
+	__atomic_store_n(&page->dirty, true, __ATOMIC_SEQ_CST);
+}
+
+bool
+ftl_l2p_cache_peek(struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa *ppa)
+{
+	struct ftl_l2p_page *page;
+	bool resident = false;
+
+	pthread_spin_lock(&cache->lock);
+
+	page = cache->page_table[lba / cache->entries_per_page];
+	if (page && page->state != FTL_L2P_PAGE_LOADING) {
+		*ppa = ftl_l2p_page_load(cache, page, lba % cache->entries_per_page);
+		resident = true;
+	}
+
+	pthread_spin_unlock(&cache->lock);
+
+	return resident;
+}
+
+void
+ftl_l2p_cache_get_stats(struct ftl_l2p_cache *cache, struct ftl_l2p_cache_stats *stats)
+{
+	pthread_spin_lock(&cache->lock);
+	*stats = cache->stats;
+	pthread_spin_unlock(&cache->lock);
+}
@@ -0,0 +1,95 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FTL_L2P_CACHE_H
+#define FTL_L2P_CACHE_H
+
+#include "spdk/stdinc.h"
+#include "spdk/queue.h"
+#include "spdk/thread.h"
+
+#include "ftl_ppa.h"
+
+struct spdk_ftl_dev;
+struct spdk_ftl_conf;
+struct ftl_l2p_cache;
+
+struct ftl_l2p_cache_stats {
+	/* Number of pins served by resident pages */
+	uint64_t				hits;
+	/* Number of pins that had to page the table in */
+	uint64_t				misses;
+	/* Number of pages read from the device */
+	uint64_t				page_ins;
+	/* Total time spent paging in (in ticks) */
+	uint64_t				page_in_ticks;
+	/* Number of resident pages dropped to make room for others */
+	uint64_t				evictions;
+	/* Number of dirty pages written back to the device */
+	uint64_t				writebacks;
+};
+
+/* Pin that couldn't be completed immediately */
+struct ftl_l2p_waiter {
+	/* Callback sent to the thread that tried to pin the page, once the pin */
+	/* can be retried */
+	spdk_msg_fn				cb_fn;
+	void					*cb_arg;
+
+	/* Filled in by the cache */
+	struct spdk_thread			*thread;
+	TAILQ_ENTRY(ftl_l2p_waiter)		tailq;
+};
+
+/* Paged L2P table. Only cache_size bytes of the table are kept in memory, the */
+/* rest of it is swapped out to the metadata region of the device. An entry can */
+/* only be accessed while its page is pinned. Pinning a page that isn't resident */
+/* starts paging it in and fails with -EAGAIN. If a waiter was provided, it's */
+/* queued on the page being loaded (or on the cache, if there's no page to load */
+/* it to) and its callback is sent once the page-in completes or a page frees */
+/* up, so the pin should only be retried from there. Without a waiter the */
+/* caller needs to retry later on by itself. Pinned pages are never evicted, so */
+/* the cache has to be larger than the number of pages that can be pinned at */
+/* the same time. */
+struct ftl_l2p_cache *ftl_l2p_cache_init(struct spdk_ftl_dev *dev, size_t cache_size);
+void	ftl_l2p_cache_free(struct ftl_l2p_cache *cache);
+int	ftl_l2p_cache_pin(struct ftl_l2p_cache *cache, uint64_t lba,
+			  struct ftl_l2p_waiter *waiter);
+void	ftl_l2p_cache_unpin(struct ftl_l2p_cache *cache, uint64_t lba);
+struct ftl_ppa ftl_l2p_cache_get(struct ftl_l2p_cache *cache, uint64_t lba);
+void	ftl_l2p_cache_set(struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa ppa);
+bool	ftl_l2p_cache_peek(struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa *ppa);
+void	ftl_l2p_cache_get_stats(struct ftl_l2p_cache *cache, struct ftl_l2p_cache_stats *stats);
+size_t	ftl_l2p_cache_min_size(const struct spdk_ftl_conf *conf);
+
+#endif /* FTL_L2P_CACHE_H */
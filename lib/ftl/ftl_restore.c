@@ -33,19 +33,30 @@
 
 #include "spdk/stdinc.h"
 #include "spdk/ftl.h"
+#include "spdk/env.h"
 #include "spdk/util.h"
 #include "spdk/likely.h"
+#include "spdk_internal/log.h"
 
 #include "ftl_core.h"
 #include "ftl_band.h"
 #include "ftl_io.h"
 
+/* Maximum number of bands with tail metadata reads in progress */
+#define FTL_RESTORE_MAX_BANDS 4
+
 struct ftl_restore_band {
 	struct ftl_restore		*parent;
 
 	struct ftl_band			*band;
 
 	enum ftl_md_status		md_status;
+
+	/* Tail metadata buffer slot */
+	unsigned int			slot;
+
+	/* Link on the L2P queue */
+	STAILQ_ENTRY(ftl_restore_band)	stailq;
 };
 
 struct ftl_restore {
@@ -57,15 +68,42 @@ struct ftl_restore {
 
 	unsigned int			current;
 
+	/* Current band's offset being applied to the L2P */
+	size_t				l2p_off;
+
 	struct ftl_restore_band		*bands;
 
 	void				*md_buf;
 
 	void				*lba_map;
+
+	/* Bitmask of free tail metadata buffer slots */
+	unsigned int			free_slots;
+
+	/* Bands with their tail metadata read, waiting to be applied to the L2P */
+	STAILQ_HEAD(, ftl_restore_band)	l2p_queue;
+
+	/* Band currently being applied to the L2P */
+	struct ftl_restore_band		*l2p_band;
+
+	/* First error encountered while restoring the bands */
+	int				status;
+
+	/* Timestamps of the phases' start (in ticks) */
+	uint64_t			head_tsc;
+	uint64_t			tail_tsc;
+
+	/* Time spent on updating the L2P (in ticks) */
+	uint64_t			l2p_ticks;
+
+	/* Resumes applying the band once its L2P page is paged in */
+	struct ftl_l2p_waiter		l2p_waiter;
 };
 
 static int
 ftl_restore_tail_md(struct ftl_restore_band *rband);
+static void
+ftl_restore_band_l2p(void *ctx);
 
 static void
 ftl_restore_free(struct ftl_restore *restore)
@@ -94,6 +132,8 @@ ftl_restore_init(struct spdk_ftl_dev *dev, ftl_restore_fn cb)
 
 	restore->dev = dev;
 	restore->cb = cb;
+	restore->l2p_waiter.cb_fn = ftl_restore_band_l2p;
+	restore->l2p_waiter.cb_arg = restore;
 
 	restore->bands = calloc(ftl_dev_num_bands(dev), sizeof(*restore->bands));
 	if (!restore->bands) {
@@ -107,20 +147,24 @@ ftl_restore_init(struct spdk_ftl_dev *dev, ftl_restore_fn cb)
 		rband->md_status = FTL_MD_NO_MD;
 	}
 
-	/* Allocate buffer capable of holding either tail md or head mds of all bands */
+	/* Allocate buffer capable of holding either the tail mds of the bands being */
+	/* read at the same time or head mds of all bands */
 	md_size = spdk_max(ftl_dev_num_bands(dev) * ftl_head_md_num_lbks(dev) * FTL_BLOCK_SIZE,
-			   ftl_tail_md_num_lbks(dev) * FTL_BLOCK_SIZE);
+			   FTL_RESTORE_MAX_BANDS * ftl_tail_md_num_lbks(dev) * FTL_BLOCK_SIZE);
 
 	restore->md_buf = spdk_dma_zmalloc(md_size, FTL_BLOCK_SIZE, NULL);
 	if (!restore->md_buf) {
 		goto error;
 	}
 
-	restore->lba_map = calloc(ftl_num_band_lbks(dev), sizeof(uint64_t));
+	restore->lba_map = calloc(FTL_RESTORE_MAX_BANDS * ftl_num_band_lbks(dev), sizeof(uint64_t));
 	if (!restore->lba_map) {
 		goto error;
 	}
 
+	restore->free_slots = (1u << FTL_RESTORE_MAX_BANDS) - 1;
+	STAILQ_INIT(&restore->l2p_queue);
+
 	return restore;
 error:
 	ftl_restore_free(restore);
@@ -138,6 +182,12 @@ ftl_restore_complete(struct ftl_restore *restore, int status)
 	}
 }
 
+static uint64_t
+ftl_restore_ticks_to_ms(uint64_t ticks)
+{
+	return ticks * 1000 / spdk_get_ticks_hz();
+}
+
 static int
 ftl_band_cmp(const void *lband, const void *rband)
 {
@@ -227,6 +277,9 @@ ftl_restore_head_complete(struct ftl_restore *restore)
 
 	dev->num_lbas = dev->global_md.num_lbas;
 	status = 0;
+
+	SPDK_NOTICELOG("FTL %s: head metadata restored in %"PRIu64" ms\n", dev->name,
+		       ftl_restore_ticks_to_ms(spdk_get_ticks() - restore->head_tsc));
 out:
 	ftl_restore_complete(restore, status);
 }
@@ -259,6 +312,7 @@ ftl_restore_head_md(struct ftl_restore *restore)
 
 	cb.fn = ftl_restore_head_cb;
 	restore->num_ios = ftl_dev_num_bands(dev);
+	restore->head_tsc = spdk_get_ticks();
 
 	for (i = 0; i < ftl_dev_num_bands(dev); ++i) {
 		rband = &restore->bands[i];
@@ -307,15 +361,29 @@ ftl_restore_md(struct spdk_ftl_dev *dev, ftl_restore_fn cb)
 	return ftl_restore_head_md(restore);
 }
 
+static bool
+ftl_restore_ppa_newer(struct spdk_ftl_dev *dev, struct ftl_ppa ppa, struct ftl_band *band,
+		      size_t offset)
+{
+	struct ftl_band *ppa_band = ftl_band_from_ppa(dev, ppa);
+
+	if (ppa_band->md.seq != band->md.seq) {
+		return ppa_band->md.seq > band->md.seq;
+	}
+
+	return ftl_band_lbkoff_from_ppa(ppa_band, ppa) > offset;
+}
+
 static int
-ftl_restore_l2p(struct ftl_band *band)
+ftl_restore_l2p(struct ftl_restore *restore, struct ftl_band *band)
 {
 	struct spdk_ftl_dev *dev = band->dev;
 	struct ftl_ppa ppa;
 	uint64_t lba;
 	size_t i;
 
-	for (i = 0; i < ftl_num_band_lbks(band->dev); ++i) {
+	for (; restore->l2p_off < ftl_num_band_lbks(band->dev); ++restore->l2p_off) {
+		i = restore->l2p_off;
 		if (!spdk_bit_array_get(band->md.vld_map, i)) {
 			continue;
 		}
@@ -325,8 +393,22 @@ ftl_restore_l2p(struct ftl_band *band)
 			return -1;
 		}
 
+		/* Paged L2P might need to read the entry first, in which case the */
+		/* restore is resumed from the same offset once the page is loaded */
+		if (ftl_l2p_pin(dev, lba, &restore->l2p_waiter)) {
+			return -EAGAIN;
+		}
+
+		/* The bands aren't applied in order, so the L2P might already point */
+		/* at a newer copy of the data */
 		ppa = ftl_l2p_get(dev, lba);
 		if (!ftl_ppa_invalid(ppa)) {
+			if (ftl_restore_ppa_newer(dev, ppa, band, i)) {
+				spdk_bit_array_clear(band->md.vld_map, i);
+				ftl_l2p_unpin(dev, lba);
+				continue;
+			}
+
 			ftl_invalidate_addr(dev, ppa);
 		}
 
@@ -334,9 +416,11 @@ ftl_restore_l2p(struct ftl_band *band)
 
 		ftl_band_set_addr(band, lba, ppa);
 		ftl_l2p_set(dev, lba, ppa);
+		ftl_l2p_unpin(dev, lba);
 	}
 
 	band->md.lba_map = NULL;
+	restore->l2p_off = 0;
 	return 0;
 }
 
@@ -358,6 +442,114 @@ ftl_restore_next_band(struct ftl_restore *restore)
 	return NULL;
 }
 
+static void
+ftl_restore_device_complete(struct ftl_restore *restore)
+{
+	struct spdk_ftl_dev *dev = restore->dev;
+	int status = restore->status;
+
+	if (!status) {
+		SPDK_NOTICELOG("FTL %s: tail metadata and L2P restored in %"PRIu64" ms "
+			       "(L2P update: %"PRIu64" ms)\n", dev->name,
+			       ftl_restore_ticks_to_ms(spdk_get_ticks() - restore->tail_tsc),
+			       ftl_restore_ticks_to_ms(restore->l2p_ticks));
+	}
+
+	restore->cb(dev, status ? NULL : restore, status);
+	ftl_restore_free(restore);
+}
+
+static bool
+ftl_restore_done(const struct ftl_restore *restore)
+{
+	return restore->free_slots == (1u << FTL_RESTORE_MAX_BANDS) - 1 &&
+	       !restore->l2p_band && STAILQ_EMPTY(&restore->l2p_queue);
+}
+
+static void
+ftl_restore_fill_queue(struct ftl_restore *restore)
+{
+	struct ftl_restore_band *rband;
+
+	/* Keep reading the tail metadata of the following bands while the L2P */
+	/* is being updated */
+	while (!restore->status && restore->free_slots) {
+		rband = ftl_restore_next_band(restore);
+		if (!rband) {
+			break;
+		}
+
+		if (ftl_restore_tail_md(rband)) {
+			break;
+		}
+	}
+}
+
+static void
+ftl_restore_release_slot(struct ftl_restore_band *rband)
+{
+	struct ftl_restore *restore = rband->parent;
+
+	restore->free_slots |= 1u << rband->slot;
+}
+
+static void
+ftl_restore_band_l2p(void *ctx)
+{
+	struct ftl_restore *restore = ctx;
+	struct ftl_restore_band *rband;
+	uint64_t tsc;
+	int rc;
+
+	while (!restore->status) {
+		if (!restore->l2p_band) {
+			restore->l2p_band = STAILQ_FIRST(&restore->l2p_queue);
+			if (!restore->l2p_band) {
+				break;
+			}
+
+			STAILQ_REMOVE_HEAD(&restore->l2p_queue, stailq);
+		}
+
+		rband = restore->l2p_band;
+
+		tsc = spdk_get_ticks();
+		rc = ftl_restore_l2p(restore, rband->band);
+		restore->l2p_ticks += spdk_get_ticks() - tsc;
+
+		/* Resumed by the L2P cache */
+		if (rc == -EAGAIN) {
+			return;
+		}
+
+		if (rc) {
+			restore->status = -ENOTRECOVERABLE;
+		}
+
+		restore->l2p_band = NULL;
+		ftl_restore_release_slot(rband);
+		ftl_restore_fill_queue(restore);
+	}
+
+	/* Drop the bands that won't be applied anymore due to an error */
+	if (restore->l2p_band) {
+		STAILQ_INSERT_HEAD(&restore->l2p_queue, restore->l2p_band, stailq);
+		restore->l2p_band = NULL;
+		restore->l2p_off = 0;
+	}
+
+	while (!STAILQ_EMPTY(&restore->l2p_queue)) {
+		rband = STAILQ_FIRST(&restore->l2p_queue);
+		STAILQ_REMOVE_HEAD(&restore->l2p_queue, stailq);
+		rband->band->md.lba_map = NULL;
+		ftl_restore_release_slot(rband);
+	}
+
+	if (ftl_restore_done(restore)) {
+		ftl_restore_device_complete(restore);
+	}
+}
+
 static void
 ftl_restore_tail_md_cb(void *ctx, int status)
 {
@@ -365,39 +557,47 @@ ftl_restore_tail_md_cb(void *ctx, int status)
 	struct ftl_restore *restore = rband->parent;
 
 	if (status) {
-		ftl_restore_complete(restore, status);
-		return;
+		SPDK_ERRLOG("Failed to read tail metadata on band %u\n", rband->band->id);
+		if (!restore->status) {
+			restore->status = status;
+		}
 	}
 
-	if (ftl_restore_l2p(rband->band)) {
-		ftl_restore_complete(restore, -ENOTRECOVERABLE);
-		return;
-	}
+	STAILQ_INSERT_TAIL(&restore->l2p_queue, rband, stailq);
 
-	rband = ftl_restore_next_band(restore);
-	if (!rband) {
-		ftl_restore_complete(restore, 0);
-		return;
+	/* Only kick the L2P update if it isn't already in progress (it might be */
+	/* waiting for an L2P page) */
+	if (!restore->l2p_band) {
+		ftl_restore_band_l2p(restore);
 	}
-
-	ftl_restore_tail_md(rband);
 }
 
 static int
 ftl_restore_tail_md(struct ftl_restore_band *rband)
 {
 	struct ftl_restore *restore = rband->parent;
+	struct spdk_ftl_dev *dev = restore->dev;
 	struct ftl_band *band = rband->band;
 	struct ftl_cb cb = { .fn = ftl_restore_tail_md_cb,
 		       .ctx = rband
 	};
+	char *md_buf;
+
+	assert(restore->free_slots);
+	rband->slot = __builtin_ctz(restore->free_slots);
+	restore->free_slots &= ~(1u << rband->slot);
+
+	md_buf = (char *)restore->md_buf +
+		 rband->slot * ftl_tail_md_num_lbks(dev) * FTL_BLOCK_SIZE;
 
 	band->tail_md_ppa = ftl_band_tail_md_ppa(band);
-	band->md.lba_map = restore->lba_map;
+	band->md.lba_map = (uint64_t *)restore->lba_map + rband->slot * ftl_num_band_lbks(dev);
 
-	if (ftl_band_read_tail_md(band, &band->md, restore->md_buf, band->tail_md_ppa, &cb)) {
+	if (ftl_band_read_tail_md(band, &band->md, md_buf, band->tail_md_ppa, &cb)) {
 		SPDK_ERRLOG("Failed to send tail metadata read\n");
-		ftl_restore_complete(restore, -EIO);
+		band->md.lba_map = NULL;
+		ftl_restore_release_slot(rband);
+		restore->status = -EIO;
 		return -EIO;
 	}
 
@@ -407,12 +607,19 @@ ftl_restore_tail_md(struct ftl_restore_band *rband)
 int
 ftl_restore_device(struct ftl_restore *restore, ftl_restore_fn cb)
 {
-	struct ftl_restore_band *rband;
-
 	restore->current = 0;
 	restore->cb = cb;
+	restore->tail_tsc = spdk_get_ticks();
 
 	/* If restore_device is called, there must be at least one valid band */
-	rband = ftl_restore_next_band(restore);
-	return ftl_restore_tail_md(rband);
+	ftl_restore_fill_queue(restore);
+	if (restore->status) {
+		/* Wait for the reads that were already sent */
+		if (ftl_restore_done(restore)) {
+			ftl_restore_free(restore);
+			return -EIO;
+		}
+	}
+
+	return 0;
 }
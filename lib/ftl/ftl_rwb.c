@@ -51,6 +51,9 @@ struct ftl_rwb_batch {
 	/* Number of entries ready for submission */
 	unsigned int				num_ready;
 
+	/* Write stream the batch belongs to */
+	enum spdk_ftl_stream			stream;
+
 	/* RWB entry list */
 	LIST_HEAD(, ftl_rwb_entry)		entry_list;
 
@@ -80,17 +83,20 @@ struct ftl_rwb {
 	/* Number of acquired entries */
 	unsigned int				num_acquired[FTL_RWB_TYPE_MAX];
 
+	/* Number of acquired entries per write stream */
+	unsigned int				num_pending[SPDK_FTL_STREAM_MAX];
+
 	/* User/internal limits */
 	size_t					limits[FTL_RWB_TYPE_MAX];
 
-	/* Current batch */
-	struct ftl_rwb_batch			*current;
+	/* Current batch of each stream */
+	struct ftl_rwb_batch			*current[SPDK_FTL_STREAM_MAX];
 
 	/* Free batch queue */
 	STAILQ_HEAD(, ftl_rwb_batch)		free_queue;
 
-	/* Submission batch queue */
-	struct spdk_ring			*submit_queue;
+	/* Submission batch queue of each stream */
+	struct spdk_ring			*submit_queue[SPDK_FTL_STREAM_MAX];
 
 	/* Batch buffer */
 	struct ftl_rwb_batch			*batches;
@@ -116,6 +122,7 @@ ftl_rwb_batch_init_entry(struct ftl_rwb_batch *batch, size_t pos)
 
 	entry = &batch->entries[batch_offset];
 	entry->pos = pos;
+	entry->lba = FTL_LBA_INVALID;
 	entry->data = ((char *)batch->buffer) + FTL_BLOCK_SIZE * batch_offset;
 	entry->md = rwb->md_size ? ((char *)batch->md_buffer) + rwb->md_size * batch_offset : NULL;
 	entry->batch = batch;
@@ -196,12 +203,14 @@ ftl_rwb_init(const struct spdk_ftl_conf *conf, size_t xfer_size, size_t md_size)
 		goto error;
 	}
 
-	rwb->submit_queue = spdk_ring_create(SPDK_RING_TYPE_MP_SC,
-					     spdk_align32pow2(rwb->num_batches + 1),
-					     SPDK_ENV_SOCKET_ID_ANY);
-	if (!rwb->submit_queue) {
-		SPDK_ERRLOG("Failed to create submission queue\n");
-		goto error;
+	for (i = 0; i < SPDK_FTL_STREAM_MAX; ++i) {
+		rwb->submit_queue[i] = spdk_ring_create(SPDK_RING_TYPE_MP_SC,
+							spdk_align32pow2(rwb->num_batches + 1),
+							SPDK_ENV_SOCKET_ID_ANY);
+		if (!rwb->submit_queue[i]) {
+			SPDK_ERRLOG("Failed to create submission queue\n");
+			goto error;
+		}
 	}
 
 	/* TODO: use rte_ring with SP / MC */
@@ -252,7 +261,9 @@ ftl_rwb_free(struct ftl_rwb *rwb)
 	}
 
 	pthread_spin_destroy(&rwb->lock);
-	spdk_ring_free(rwb->submit_queue);
+	for (size_t i = 0; i < SPDK_FTL_STREAM_MAX; ++i) {
+		spdk_ring_free(rwb->submit_queue[i]);
+	}
 	free(rwb->batches);
 	free(rwb);
 }
@@ -273,6 +284,10 @@ ftl_rwb_batch_release(struct ftl_rwb_batch *batch)
 		assert(num_acquired  > 0);
 	}
 
+	num_acquired = __atomic_fetch_sub(&rwb->num_pending[batch->stream], rwb->xfer_size,
+					  __ATOMIC_SEQ_CST);
+	assert(num_acquired >= rwb->xfer_size);
+
 	pthread_spin_lock(&rwb->lock);
 	STAILQ_INSERT_TAIL(&rwb->free_queue, batch, stailq);
 	pthread_spin_unlock(&rwb->lock);
@@ -318,12 +333,24 @@ ftl_rwb_num_acquired(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type)
 	return __atomic_load_n(&rwb->num_acquired[type], __ATOMIC_SEQ_CST);
 }
 
+size_t
+ftl_rwb_num_pending(struct ftl_rwb *rwb, enum spdk_ftl_stream stream)
+{
+	return __atomic_load_n(&rwb->num_pending[stream], __ATOMIC_SEQ_CST);
+}
+
+enum spdk_ftl_stream
+ftl_rwb_batch_get_stream(const struct ftl_rwb_batch *batch)
+{
+	return batch->stream;
+}
+
 void
 ftl_rwb_batch_revert(struct ftl_rwb_batch *batch)
 {
 	struct ftl_rwb *rwb = batch->rwb;
 
-	if (spdk_ring_enqueue(rwb->submit_queue, (void **)&batch, 1) != 1) {
+	if (spdk_ring_enqueue(rwb->submit_queue[batch->stream], (void **)&batch, 1) != 1) {
 		assert(0 && "Should never happen");
 	}
 }
@@ -340,7 +367,7 @@ ftl_rwb_push(struct ftl_rwb_entry *entry)
 	/* Once all of the entries are put back, push the batch on the */
 	/* submission queue */
 	if (ftl_rwb_batch_full(batch, batch_size)) {
-		if (spdk_ring_enqueue(rwb->submit_queue, (void **)&batch, 1) != 1) {
+		if (spdk_ring_enqueue(rwb->submit_queue[batch->stream], (void **)&batch, 1) != 1) {
 			assert(0 && "Should never happen");
 		}
 	}
@@ -353,7 +380,7 @@ ftl_rwb_check_limits(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type)
 }
 
 struct ftl_rwb_entry *
-ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type)
+ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type, enum spdk_ftl_stream stream)
 {
 	struct ftl_rwb_entry *entry = NULL;
 	struct ftl_rwb_batch *current;
@@ -364,7 +391,7 @@ ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type)
 
 	pthread_spin_lock(&rwb->lock);
 
-	current = rwb->current;
+	current = rwb->current[stream];
 	if (!current) {
 		current = STAILQ_FIRST(&rwb->free_queue);
 		if (!current) {
@@ -372,18 +399,20 @@ ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type)
 		}
 
 		STAILQ_REMOVE(&rwb->free_queue, current, ftl_rwb_batch, stailq);
-		rwb->current = current;
+		current->stream = stream;
+		rwb->current[stream] = current;
 	}
 
 	entry = &current->entries[current->num_acquired++];
 
 	/* If the whole batch is filled, clear the current batch pointer */
 	if (current->num_acquired >= rwb->xfer_size) {
-		rwb->current = NULL;
+		rwb->current[stream] = NULL;
 	}
 
 	pthread_spin_unlock(&rwb->lock);
 	__atomic_fetch_add(&rwb->num_acquired[type], 1, __ATOMIC_SEQ_CST);
+	__atomic_fetch_add(&rwb->num_pending[stream], 1, __ATOMIC_SEQ_CST);
 	return entry;
 error:
 	pthread_spin_unlock(&rwb->lock);
@@ -391,11 +420,11 @@ error:
 }
 
 struct ftl_rwb_batch *
-ftl_rwb_pop(struct ftl_rwb *rwb)
+ftl_rwb_pop(struct ftl_rwb *rwb, enum spdk_ftl_stream stream)
 {
 	struct ftl_rwb_batch *batch = NULL;
 
-	if (spdk_ring_dequeue(rwb->submit_queue, (void **)&batch, 1) != 1) {
+	if (spdk_ring_dequeue(rwb->submit_queue[stream], (void **)&batch, 1) != 1) {
 		return NULL;
 	}
 
@@ -80,6 +80,10 @@ struct ftl_rwb_entry {
 	/* Flags */
 	unsigned int				flags;
 
+	/* Stream the write is accounted to (for relocated data it's the stream */
+	/* of the band the data is moved from) */
+	enum spdk_ftl_stream			stream;
+
 	/* Indicates whether the entry is part of cache and is assigned a PPA */
 	bool					valid;
 
@@ -98,14 +102,17 @@ size_t	ftl_rwb_entry_cnt(const struct ftl_rwb *rwb);
 void	ftl_rwb_set_limits(struct ftl_rwb *rwb, const size_t limit[FTL_RWB_TYPE_MAX]);
 void	ftl_rwb_get_limits(struct ftl_rwb *rwb, size_t limit[FTL_RWB_TYPE_MAX]);
 size_t	ftl_rwb_num_acquired(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type);
+size_t	ftl_rwb_num_pending(struct ftl_rwb *rwb, enum spdk_ftl_stream stream);
 size_t	ftl_rwb_num_batches(const struct ftl_rwb *rwb);
-struct ftl_rwb_entry *ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type);
-struct ftl_rwb_batch *ftl_rwb_pop(struct ftl_rwb *rwb);
+struct ftl_rwb_entry *ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type,
+				      enum spdk_ftl_stream stream);
+struct ftl_rwb_batch *ftl_rwb_pop(struct ftl_rwb *rwb, enum spdk_ftl_stream stream);
 struct ftl_rwb_batch *ftl_rwb_first_batch(struct ftl_rwb *rwb);
 struct ftl_rwb_batch *ftl_rwb_next_batch(struct ftl_rwb_batch *batch);
 int	ftl_rwb_batch_empty(struct ftl_rwb_batch *batch);
 struct ftl_rwb_entry *ftl_rwb_entry_from_offset(struct ftl_rwb *rwb, size_t offset);
 size_t	ftl_rwb_batch_get_offset(const struct ftl_rwb_batch *batch);
+enum spdk_ftl_stream ftl_rwb_batch_get_stream(const struct ftl_rwb_batch *batch);
 void	ftl_rwb_batch_revert(struct ftl_rwb_batch *batch);
 struct ftl_rwb_entry *ftl_rwb_batch_first_entry(struct ftl_rwb_batch *batch);
 void	*ftl_rwb_batch_get_data(struct ftl_rwb_batch *batch);
@@ -81,7 +81,7 @@ spdk_iscsi_portal_accept(void *arg)
 void
 spdk_iscsi_acceptor_start(struct spdk_iscsi_portal *p)
 {
-	p->acceptor_poller = spdk_poller_register(spdk_iscsi_portal_accept, p, ACCEPT_TIMEOUT_US);
+	p->acceptor_poller = SPDK_POLLER_REGISTER(spdk_iscsi_portal_accept, p, ACCEPT_TIMEOUT_US);
 }
 
 void
@@ -74,6 +74,7 @@ static pthread_mutex_t g_conns_mutex = PTHREAD_MUTEX_INITIALIZER;
 static struct spdk_poller *g_shutdown_timer = NULL;
 
 static uint32_t spdk_iscsi_conn_allocate_reactor(const struct spdk_cpuset *cpumask);
+static uint32_t spdk_iscsi_conn_allocate_sess_reactor(struct spdk_iscsi_conn *conn);
 
 static void spdk_iscsi_conn_full_feature_migrate(void *arg1, void *arg2);
 static void spdk_iscsi_conn_stop(struct spdk_iscsi_conn *conn);
@@ -106,6 +107,7 @@ free_conn(struct spdk_iscsi_conn *conn)
 {
 	free(conn->portal_host);
 	free(conn->portal_port);
+	free(conn->recv_buf);
 	conn->is_valid = 0;
 }
 
@@ -269,6 +271,7 @@ spdk_iscsi_conn_construct(struct spdk_iscsi_portal *portal,
 	conn->nop_outstanding = false;
 	conn->data_out_cnt = 0;
 	conn->data_in_cnt = 0;
+	conn->direct_write_cnt = 0;
 	pthread_mutex_unlock(&g_spdk_iscsi.mutex);
 	conn->MaxRecvDataSegmentLength = 8192; /* RFC3720(12.12) */
 
@@ -279,6 +282,12 @@ spdk_iscsi_conn_construct(struct spdk_iscsi_portal *portal,
 	conn->portal_cpumask = portal->cpumask;
 	conn->sock = sock;
 
+	conn->recv_buf = malloc(SPDK_ISCSI_CONN_RECV_BUF_SIZE);
+	if (conn->recv_buf == NULL) {
+		SPDK_ERRLOG("Could not allocate receive buffer.\n");
+		goto error_return;
+	}
+
 	conn->state = ISCSI_CONN_STATE_INVALID;
 	conn->login_phase = ISCSI_SECURITY_NEGOTIATION_PHASE;
 	conn->ttt = 0;
@@ -405,6 +414,13 @@ static int spdk_iscsi_conn_free_tasks(struct spdk_iscsi_conn *conn)
 		}
 	}
 
+	/* A partially received Data-Out PDU holds a reference to its write task. */
+	pdu = conn->pdu_in_progress;
+	if (pdu != NULL && pdu->write_task != NULL) {
+		spdk_iscsi_task_put(pdu->write_task);
+		pdu->write_task = NULL;
+	}
+
 	if (conn->pending_task_cnt) {
 		return -1;
 	}
@@ -427,6 +443,10 @@ _spdk_iscsi_conn_free(struct spdk_iscsi_conn *conn)
 	 */
 	spdk_put_pdu(conn->pdu_in_progress);
 
+	/* The connection is off the session, so nobody schedules its held PDU anymore. */
+	spdk_put_pdu(conn->held_pdu);
+	conn->held_pdu = NULL;
+
 	free_conn(conn);
 }
 
@@ -477,11 +497,13 @@ spdk_iscsi_conn_free(struct spdk_iscsi_conn *conn)
 	if (idx < 0) {
 		SPDK_ERRLOG("remove conn not found\n");
 	} else {
+		pthread_mutex_lock(&sess->mutex);
 		for (i = idx; i < sess->connections - 1; i++) {
 			sess->conns[i] = sess->conns[i + 1];
 		}
 		sess->conns[sess->connections - 1] = NULL;
 		sess->connections--;
+		pthread_mutex_unlock(&sess->mutex);
 
 		if (sess->connections == 0) {
 			/* cleanup last connection */
@@ -508,7 +530,7 @@ _spdk_iscsi_conn_check_shutdown(void *arg)
 	int rc;
 
 	rc = spdk_iscsi_conn_free_tasks(conn);
-	if (rc < 0) {
+	if (rc < 0 || conn->held_pdu_events != 0) {
 		return 1;
 	}
 
@@ -532,9 +554,9 @@ _spdk_iscsi_conn_destruct(struct spdk_iscsi_conn *conn)
 	spdk_poller_unregister(&conn->flush_poller);
 
 	rc = spdk_iscsi_conn_free_tasks(conn);
-	if (rc < 0) {
+	if (rc < 0 || conn->held_pdu_events != 0) {
 		/* The connection cannot be freed yet. Check back later. */
-		conn->shutdown_timer = spdk_poller_register(_spdk_iscsi_conn_check_shutdown, conn, 1000);
+		conn->shutdown_timer = SPDK_POLLER_REGISTER(_spdk_iscsi_conn_check_shutdown, conn, 1000);
 	} else {
 		spdk_iscsi_conn_stop(conn);
 		spdk_iscsi_conn_free(conn);
@@ -557,6 +579,26 @@ _spdk_iscsi_conn_check_pending_tasks(void *arg)
 	return 1;
 }
 
+/* Drop the held command, so that no other connection schedules it anymore. */
+static void
+spdk_iscsi_conn_drop_held_pdu(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_pdu *pdu;
+
+	if (conn->sess == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&conn->sess->mutex);
+	pdu = conn->held_pdu;
+	conn->held_pdu = NULL;
+	pthread_mutex_unlock(&conn->sess->mutex);
+
+	if (pdu != NULL) {
+		spdk_put_pdu(pdu);
+	}
+}
+
 void
 spdk_iscsi_conn_destruct(struct spdk_iscsi_conn *conn)
 {
@@ -566,13 +608,14 @@ spdk_iscsi_conn_destruct(struct spdk_iscsi_conn *conn)
 	}
 
 	conn->state = ISCSI_CONN_STATE_EXITED;
+	spdk_iscsi_conn_drop_held_pdu(conn);
 
 	if (conn->sess != NULL && conn->pending_task_cnt > 0) {
 		spdk_iscsi_conn_cleanup_backend(conn);
 	}
 
 	if (conn->dev != NULL && spdk_scsi_dev_has_pending_tasks(conn->dev)) {
-		conn->shutdown_timer = spdk_poller_register(_spdk_iscsi_conn_check_pending_tasks, conn, 1000);
+		conn->shutdown_timer = SPDK_POLLER_REGISTER(_spdk_iscsi_conn_check_pending_tasks, conn, 1000);
 	} else {
 		_spdk_iscsi_conn_destruct(conn);
 	}
@@ -788,7 +831,7 @@ void spdk_shutdown_iscsi_conns(void)
 	}
 
 	pthread_mutex_unlock(&g_conns_mutex);
-	g_shutdown_timer = spdk_poller_register(spdk_iscsi_conn_check_shutdown, NULL,
+	g_shutdown_timer = SPDK_POLLER_REGISTER(spdk_iscsi_conn_check_shutdown, NULL,
 						1000);
 }
 
@@ -863,12 +906,74 @@ spdk_iscsi_drop_conns(struct spdk_iscsi_conn *conn, const char *conn_match,
 	return 0;
 }
 
+static int
+spdk_iscsi_conn_sock_readv(struct spdk_iscsi_conn *conn, struct iovec *iov, int iovcnt)
+{
+	int ret;
+
+	ret = spdk_sock_readv(conn->sock, iov, iovcnt);
+	conn->recv_cnt++;
+
+	if (ret > 0) {
+		spdk_trace_record(TRACE_ISCSI_READ_FROM_SOCKET_DONE, conn->id, ret, 0, 0);
+		return ret;
+	}
+
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		/* For connect reset issue, do not output error log */
+		if (errno == ECONNRESET) {
+			SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "spdk_sock_readv() failed, errno %d: %s\n",
+				      errno, spdk_strerror(errno));
+		} else {
+			SPDK_ERRLOG("spdk_sock_readv() failed, errno %d: %s\n",
+				    errno, spdk_strerror(errno));
+		}
+	}
+
+	/* connection closed */
+	return SPDK_ISCSI_CONNECTION_FATAL;
+}
+
+/*
+ * Copy as many bytes as possible from the receive buffer to the iovecs.
+ */
+static int
+spdk_iscsi_conn_copy_recv_buf(struct spdk_iscsi_conn *conn, struct iovec *iov, int iovcnt)
+{
+	uint32_t len;
+	int i, copied = 0;
+
+	for (i = 0; i < iovcnt && conn->recv_buf_offset < conn->recv_buf_len; i++) {
+		len = spdk_min(iov[i].iov_len, conn->recv_buf_len - conn->recv_buf_offset);
+		memcpy(iov[i].iov_base, conn->recv_buf + conn->recv_buf_offset, len);
+		conn->recv_buf_offset += len;
+		copied += len;
+	}
+
+	if (conn->recv_buf_offset == conn->recv_buf_len) {
+		conn->recv_buf_offset = 0;
+		conn->recv_buf_len = 0;
+	}
+
+	return copied;
+}
+
 /**
  * \brief Reads data for the specified iSCSI connection from its TCP socket.
  *
  * The TCP socket is marked as non-blocking, so this function may not read
  * all data requested.
  *
+ * Bytes left over from previous reads are returned first. Otherwise, small
+ * reads fill the connection receive buffer with as much data as the socket
+ * has, so that the following reads don't need a syscall. Large reads go
+ * directly into the given buffer, and whatever follows them on the socket
+ * is read into the receive buffer in the same syscall.
+ *
  * Returns SPDK_ISCSI_CONNECTION_FATAL if the recv() operation indicates a fatal
  * error with the TCP connection (including if the TCP connection was closed
  * unexpectedly.
@@ -879,36 +984,48 @@ int
 spdk_iscsi_conn_readv_data(struct spdk_iscsi_conn *conn,
 			   struct iovec *iov, int iovcnt)
 {
-	int ret;
+	struct iovec direct_iov[2];
+	size_t len = 0;
+	int i, ret;
 
 	if (iov == NULL || iovcnt == 0) {
 		return 0;
 	}
 
-	ret = spdk_sock_readv(conn->sock, iov, iovcnt);
+	if (conn->recv_buf_offset < conn->recv_buf_len) {
+		return spdk_iscsi_conn_copy_recv_buf(conn, iov, iovcnt);
+	}
 
-	if (ret > 0) {
-		spdk_trace_record(TRACE_ISCSI_READ_FROM_SOCKET_DONE, conn->id, ret, 0, 0);
-		return ret;
+	for (i = 0; i < iovcnt; i++) {
+		len += iov[i].iov_len;
 	}
 
-	if (ret < 0) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK) {
-			return 0;
+	if (len < SPDK_ISCSI_CONN_RECV_DIRECT_THRESHOLD) {
+		direct_iov[0].iov_base = conn->recv_buf;
+		direct_iov[0].iov_len = SPDK_ISCSI_CONN_RECV_BUF_SIZE;
+		ret = spdk_iscsi_conn_sock_readv(conn, direct_iov, 1);
+		if (ret <= 0) {
+			return ret;
 		}
 
-		/* For connect reset issue, do not output error log */
-		if (errno == ECONNRESET) {
-			SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "spdk_sock_readv() failed, errno %d: %s\n",
-				      errno, spdk_strerror(errno));
-		} else {
-			SPDK_ERRLOG("spdk_sock_readv() failed, errno %d: %s\n",
-				    errno, spdk_strerror(errno));
-		}
+		conn->recv_buf_len = ret;
+		return spdk_iscsi_conn_copy_recv_buf(conn, iov, iovcnt);
 	}
 
-	/* connection closed */
-	return SPDK_ISCSI_CONNECTION_FATAL;
+	if (iovcnt > 1) {
+		return spdk_iscsi_conn_sock_readv(conn, iov, iovcnt);
+	}
+
+	direct_iov[0] = iov[0];
+	direct_iov[1].iov_base = conn->recv_buf;
+	direct_iov[1].iov_len = SPDK_ISCSI_CONN_RECV_BUF_SIZE;
+	ret = spdk_iscsi_conn_sock_readv(conn, direct_iov, 2);
+	if (ret <= (int)len) {
+		return ret;
+	}
+
+	conn->recv_buf_len = ret - len;
+	return len;
 }
 
 int
@@ -1270,7 +1387,7 @@ spdk_iscsi_conn_flush_pdus(void *_conn)
 		if (rc == 0 && conn->flush_poller != NULL) {
 			spdk_poller_unregister(&conn->flush_poller);
 		} else if (rc == 1 && conn->flush_poller == NULL) {
-			conn->flush_poller = spdk_poller_register(spdk_iscsi_conn_flush_pdus,
+			conn->flush_poller = SPDK_POLLER_REGISTER(spdk_iscsi_conn_flush_pdus,
 					     conn, 50);
 		}
 	} else {
@@ -1360,6 +1477,11 @@ spdk_iscsi_conn_handle_incoming_pdus(struct spdk_iscsi_conn *conn)
 	struct spdk_iscsi_pdu *pdu;
 	int i, rc;
 
+	/* Commands after a held one must wait for it, so stop reading. */
+	if (conn->held_pdu != NULL) {
+		return 0;
+	}
+
 	/* Read new PDUs from network */
 	for (i = 0; i < GET_PDU_LOOP_COUNT; i++) {
 		rc = spdk_iscsi_read_pdu(conn, &pdu);
@@ -1385,7 +1507,7 @@ spdk_iscsi_conn_handle_incoming_pdus(struct spdk_iscsi_conn *conn)
 		}
 
 		spdk_trace_record(TRACE_ISCSI_TASK_EXECUTED, 0, 0, (uintptr_t)pdu, 0);
-		if (conn->is_stopped) {
+		if (conn->is_stopped || conn->held_pdu != NULL) {
 			break;
 		}
 	}
@@ -1414,6 +1536,71 @@ spdk_iscsi_conn_sock_cb(void *arg, struct spdk_sock_group *group, struct spdk_so
 	}
 }
 
+static void
+_spdk_iscsi_conn_execute_held_pdu(void *arg1, void *arg2)
+{
+	struct spdk_iscsi_conn *conn = arg1;
+	struct spdk_iscsi_pdu *pdu;
+	int rc;
+
+	if (conn->state != ISCSI_CONN_STATE_RUNNING || conn->sess == NULL) {
+		goto end;
+	}
+
+	pthread_mutex_lock(&conn->sess->mutex);
+	pdu = conn->held_pdu;
+	conn->held_pdu = NULL;
+	pthread_mutex_unlock(&conn->sess->mutex);
+
+	if (pdu == NULL) {
+		goto end;
+	}
+
+	rc = spdk_iscsi_execute(conn, pdu);
+	spdk_put_pdu(pdu);
+	if (rc < 0) {
+		SPDK_ERRLOG("spdk_iscsi_execute() fatal error for held PDU\n");
+		conn->state = ISCSI_CONN_STATE_EXITING;
+		spdk_iscsi_conn_flush_pdus(conn);
+		goto end;
+	}
+
+	/* Catch up with the PDUs which arrived while the command was held. */
+	spdk_iscsi_conn_sock_cb(conn, NULL, conn->sock);
+
+end:
+	__sync_fetch_and_sub(&conn->held_pdu_events, 1);
+}
+
+/*
+ * ExpCmdSN reached the command held by the connection. Execute it on the
+ *  core of the connection. The caller took a held_pdu_events reference.
+ */
+void
+spdk_iscsi_conn_execute_held_pdu(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_event *event;
+
+	event = spdk_event_allocate(conn->lcore, _spdk_iscsi_conn_execute_held_pdu,
+				    conn, NULL);
+	spdk_event_call(event);
+}
+
+/*
+ * PDUs left in the receive buffer don't make the socket readable, so the
+ *  poll group checks for them explicitly.
+ */
+void
+spdk_iscsi_conn_handle_buffered_pdus(struct spdk_iscsi_conn *conn)
+{
+	if (spdk_likely(conn->recv_buf_offset == conn->recv_buf_len) ||
+	    conn->state != ISCSI_CONN_STATE_RUNNING || conn->is_stopped) {
+		return;
+	}
+
+	spdk_iscsi_conn_sock_cb(conn, NULL, conn->sock);
+}
+
 static void
 spdk_iscsi_conn_full_feature_migrate(void *arg1, void *arg2)
 {
@@ -1434,8 +1621,15 @@ spdk_iscsi_conn_migration(struct spdk_iscsi_conn *conn)
 	int				lcore;
 	struct spdk_event		*event;
 	struct spdk_iscsi_tgt_node *target;
+	bool				multi_conn;
+
+	multi_conn = conn->sess->session_type == SESSION_TYPE_NORMAL && conn->sess->connections > 1;
+	if (multi_conn) {
+		lcore = spdk_iscsi_conn_allocate_sess_reactor(conn);
+	} else {
+		lcore = spdk_iscsi_conn_allocate_reactor(conn->portal->cpumask);
+	}
 
-	lcore = spdk_iscsi_conn_allocate_reactor(conn->portal->cpumask);
 	if (conn->sess->session_type == SESSION_TYPE_NORMAL) {
 		target = conn->sess->target;
 		pthread_mutex_lock(&target->mutex);
@@ -1447,12 +1641,15 @@ spdk_iscsi_conn_migration(struct spdk_iscsi_conn *conn)
 			 *  any other connections to this target node.
 			 */
 			target->lcore = lcore;
-		} else {
+		} else if (!multi_conn) {
 			/**
 			 * There are other active connections for this target node.
 			 *  Ignore the lcore specified by the allocator and use the
 			 *  the target node's lcore to ensure this connection runs on
 			 *  the same lcore as other connections for this target node.
+			 *  Connections joining a session with multiple connections
+			 *  keep their own lcore, so that the session is spread
+			 *  across cores.
 			 */
 			lcore = target->lcore;
 		}
@@ -1465,11 +1662,48 @@ spdk_iscsi_conn_migration(struct spdk_iscsi_conn *conn)
 
 	__sync_fetch_and_add(&g_num_connections[lcore], 1);
 	conn->last_nopin = spdk_get_ticks();
+
+	/*
+	 * Publish the new core before the connection moves, so that other
+	 *  connections of the session joining in the meantime avoid it.
+	 */
+	pthread_mutex_lock(&g_conns_mutex);
+	conn->lcore = lcore;
+	pthread_mutex_unlock(&g_conns_mutex);
+
 	event = spdk_event_allocate(lcore, spdk_iscsi_conn_full_feature_migrate,
 				    conn, NULL);
 	spdk_event_call(event);
 }
 
+/*
+ * Add a connection to an existing session (MC/S). The session's
+ *  connection list is protected by g_conns_mutex, since connections
+ *  of the same session may run on different cores.
+ */
+int
+spdk_iscsi_conn_join_sess(struct spdk_iscsi_conn *conn, struct spdk_iscsi_sess *sess)
+{
+	int rc = 0;
+
+	pthread_mutex_lock(&g_conns_mutex);
+	if (sess->connections == 0) {
+		/* The last connection of the session is gone and the session freed. */
+		rc = -ENOENT;
+	} else if (sess->connections >= sess->MaxConnections) {
+		rc = -EMLINK;
+	} else {
+		conn->sess = sess;
+		pthread_mutex_lock(&sess->mutex);
+		sess->conns[sess->connections] = conn;
+		sess->connections++;
+		pthread_mutex_unlock(&sess->mutex);
+	}
+	pthread_mutex_unlock(&g_conns_mutex);
+
+	return rc;
+}
+
 void
 spdk_iscsi_conn_set_min_per_core(int count)
 {
@@ -1516,6 +1750,53 @@ spdk_iscsi_conn_allocate_reactor(const struct spdk_cpuset *cpumask)
 	return selected_core;
 }
 
+/*
+ * Select a core for a connection of a session with multiple connections.
+ *  The least loaded core that does not already run a full feature connection
+ *  of the same session is used, so that a session is not limited to the
+ *  throughput of a single core. If all cores of the portal are already used
+ *  by the session, fall back to the default allocation.
+ */
+static uint32_t
+spdk_iscsi_conn_allocate_sess_reactor(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_sess *sess = conn->sess;
+	struct spdk_iscsi_conn *other;
+	uint32_t i, j, selected_core, min_conns;
+	bool used;
+
+	selected_core = UINT32_MAX;
+	min_conns = UINT32_MAX;
+
+	pthread_mutex_lock(&g_conns_mutex);
+	SPDK_ENV_FOREACH_CORE(i) {
+		if (!spdk_cpuset_get_cpu(conn->portal->cpumask, i)) {
+			continue;
+		}
+
+		used = false;
+		for (j = 0; j < sess->connections; j++) {
+			other = sess->conns[j];
+			if (other != conn && other->full_feature && other->lcore == i) {
+				used = true;
+				break;
+			}
+		}
+
+		if (!used && g_num_connections[i] < min_conns) {
+			selected_core = i;
+			min_conns = g_num_connections[i];
+		}
+	}
+	pthread_mutex_unlock(&g_conns_mutex);
+
+	if (selected_core == UINT32_MAX) {
+		return spdk_iscsi_conn_allocate_reactor(conn->portal->cpumask);
+	}
+
+	return selected_core;
+}
+
 static int
 logout_timeout(void *arg)
 {
@@ -1530,7 +1811,7 @@ void
 spdk_iscsi_conn_logout(struct spdk_iscsi_conn *conn)
 {
 	conn->state = ISCSI_CONN_STATE_LOGGED_OUT;
-	conn->logout_timer = spdk_poller_register(logout_timeout, conn, ISCSI_LOGOUT_TIMEOUT * 1000000);
+	conn->logout_timer = SPDK_POLLER_REGISTER(logout_timeout, conn, ISCSI_LOGOUT_TIMEOUT * 1000000);
 }
 
 SPDK_TRACE_REGISTER_FN(iscsi_conn_trace, "iscsi_conn", TRACE_GROUP_ISCSI)
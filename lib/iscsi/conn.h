@@ -67,6 +67,19 @@
 #define TRACE_ISCSI_TASK_EXECUTED		SPDK_TPOINT_ID(TRACE_GROUP_ISCSI, 0x6)
 #define TRACE_ISCSI_PDU_COMPLETED		SPDK_TPOINT_ID(TRACE_GROUP_ISCSI, 0x7)
 
+/*
+ * Size of the per-connection receive buffer. Each read from the socket
+ * fills as much of it as is available, so that several PDUs can be parsed
+ * out of a single recv() call.
+ */
+#define SPDK_ISCSI_CONN_RECV_BUF_SIZE		(64 * 1024)
+
+/*
+ * Reads of at least this many bytes, i.e. large data segments, bypass the
+ * receive buffer and go directly into the destination buffer.
+ */
+#define SPDK_ISCSI_CONN_RECV_DIRECT_THRESHOLD	(8 * 1024)
+
 struct spdk_poller;
 
 struct spdk_iscsi_conn {
@@ -105,6 +118,31 @@ struct spdk_iscsi_conn {
 
 	struct spdk_iscsi_pdu *pdu_in_progress;
 
+	/*
+	 * Command received ahead of ExpCmdSN, held until the commands before it
+	 *  arrive on other connections of the session. No further PDUs are read
+	 *  from the connection meanwhile.
+	 */
+	struct spdk_iscsi_pdu *held_pdu;
+
+	/*
+	 * Events scheduled by other connections to execute the held command.
+	 *  The connection is not freed before they have run.
+	 */
+	uint32_t held_pdu_events;
+
+	/*
+	 * Bytes received from the socket, but not parsed yet, are
+	 *  recv_buf[recv_buf_offset..recv_buf_len).
+	 */
+	uint8_t *recv_buf;
+	uint32_t recv_buf_offset;
+	uint32_t recv_buf_len;
+
+	/* Number of reads from the socket and number of PDUs received */
+	uint64_t recv_cnt;
+	uint64_t pdu_recv_cnt;
+
 	TAILQ_HEAD(, spdk_iscsi_pdu) write_pdu_list;
 	TAILQ_HEAD(, spdk_iscsi_pdu) snack_pdu_list;
 
@@ -140,6 +178,7 @@ struct spdk_iscsi_conn {
 	uint32_t pending_task_cnt;
 	uint32_t data_out_cnt;
 	uint32_t data_in_cnt;
+	uint32_t direct_write_cnt;
 
 	int timeout;
 	uint64_t nopininterval;
@@ -177,6 +216,7 @@ int spdk_iscsi_conn_construct(struct spdk_iscsi_portal *portal, struct spdk_sock
 void spdk_iscsi_conn_destruct(struct spdk_iscsi_conn *conn);
 void spdk_iscsi_conn_handle_nop(struct spdk_iscsi_conn *conn);
 void spdk_iscsi_conn_migration(struct spdk_iscsi_conn *conn);
+int spdk_iscsi_conn_join_sess(struct spdk_iscsi_conn *conn, struct spdk_iscsi_sess *sess);
 void spdk_iscsi_conn_logout(struct spdk_iscsi_conn *conn);
 int spdk_iscsi_drop_conns(struct spdk_iscsi_conn *conn,
 			  const char *conn_match, int drop_all);
@@ -184,6 +224,8 @@ void spdk_iscsi_conn_set_min_per_core(int count);
 int spdk_iscsi_conn_get_min_per_core(void);
 
 int spdk_iscsi_conn_read_data(struct spdk_iscsi_conn *conn, int len, void *buf);
+void spdk_iscsi_conn_handle_buffered_pdus(struct spdk_iscsi_conn *conn);
+void spdk_iscsi_conn_execute_held_pdu(struct spdk_iscsi_conn *conn);
 int spdk_iscsi_conn_readv_data(struct spdk_iscsi_conn *conn,
 			       struct iovec *iov, int iovcnt);
 void spdk_iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu);
@@ -101,6 +101,9 @@ static int spdk_iscsi_send_r2t_recovery(struct spdk_iscsi_conn *conn,
 
 static int spdk_create_iscsi_sess(struct spdk_iscsi_conn *conn,
 				  struct spdk_iscsi_tgt_node *target, enum session_type session_type);
+static struct spdk_iscsi_task *spdk_get_transfer_task(struct spdk_iscsi_conn *conn,
+		uint32_t transfer_tag);
+
 static int spdk_append_iscsi_sess(struct spdk_iscsi_conn *conn,
 				  const char *initiator_port_name, uint16_t tsih, uint16_t cid);
 
@@ -385,6 +388,43 @@ spdk_iscsi_check_data_segment_length(struct spdk_iscsi_conn *conn,
 	}
 }
 
+/*
+ * If a Data-Out PDU belongs to a write with a contiguous buffer, receive its
+ *  data segment directly into that buffer at the buffer offset of the PDU.
+ *  The PDU holds a reference to the task until it is freed, so the buffer
+ *  stays valid even if the task is aborted while the data is being read.
+ */
+static void
+spdk_iscsi_pdu_set_write_buf(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu,
+			     uint32_t data_len)
+{
+	struct iscsi_bhs_data_out *reqh;
+	struct spdk_iscsi_task *task;
+	uint32_t buffer_offset;
+
+	if (pdu->bhs.opcode != ISCSI_OP_SCSI_DATAOUT ||
+	    data_len > SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH) {
+		return;
+	}
+
+	reqh = (struct iscsi_bhs_data_out *)&pdu->bhs;
+	task = spdk_get_transfer_task(conn, from_be32(&reqh->ttt));
+	if (task == NULL || task->mobj == NULL) {
+		return;
+	}
+
+	buffer_offset = from_be32(&reqh->buffer_offset);
+	if (buffer_offset > task->scsi.transfer_len ||
+	    data_len > task->scsi.transfer_len - buffer_offset) {
+		return;
+	}
+
+	task->scsi.ref++;
+	pdu->write_task = task;
+	pdu->data_buf = (uint8_t *)task->mobj->buf + buffer_offset;
+	pdu->data_buf_len = data_len;
+}
+
 static int
 spdk_iscsi_conn_read_data_segment(struct spdk_iscsi_conn *conn,
 				  struct spdk_iscsi_pdu *pdu,
@@ -503,6 +543,10 @@ spdk_iscsi_read_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu **_pdu)
 
 	/* copy the actual data into local buffer */
 	if (pdu->data_valid_bytes < data_len) {
+		if (pdu->data_buf == NULL) {
+			spdk_iscsi_pdu_set_write_buf(conn, pdu, data_len);
+		}
+
 		if (pdu->data_buf == NULL) {
 			if (data_len <= spdk_get_max_immediate_data_size()) {
 				pool = g_spdk_iscsi.pdu_immediate_data_pool;
@@ -563,6 +607,7 @@ spdk_iscsi_read_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu **_pdu)
 
 	/* All data for this PDU has now been read from the socket. */
 	conn->pdu_in_progress = NULL;
+	conn->pdu_recv_cnt++;
 
 	spdk_trace_record(TRACE_ISCSI_READ_PDU, conn->id, pdu->data_valid_bytes,
 			  (uintptr_t)pdu, pdu->bhs.opcode);
@@ -2454,7 +2499,7 @@ spdk_iscsi_op_text(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 	conn->StatSN++;
 
 	if (reqh->immediate == 0) {
-		conn->sess->MaxCmdSN++;
+		__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 	}
 
 	to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -2558,7 +2603,7 @@ spdk_iscsi_op_logout(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 		conn->StatSN++;
 
 		if (conn->sess->connections == 1) {
-			conn->sess->MaxCmdSN++;
+			__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 		}
 
 		to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -2727,7 +2772,7 @@ spdk_iscsi_send_datain(struct spdk_iscsi_conn *conn,
 	}
 
 	if (F_bit && S_bit && !spdk_iscsi_task_is_immediate(primary)) {
-		conn->sess->MaxCmdSN++;
+		__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 	}
 
 	to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -2884,18 +2929,31 @@ spdk_iscsi_compare_pdu_bhs_within_existed_r2t_tasks(struct spdk_iscsi_conn *conn
 	return false;
 }
 
+/* Submit through the LUN descriptor, which has the I/O channel of this connection. */
+static void
+spdk_iscsi_task_set_lun_desc(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task)
+{
+	if (task->scsi.lun != NULL) {
+		task->scsi.desc = conn->open_lun_descs[spdk_scsi_lun_get_id(task->scsi.lun)];
+	} else {
+		task->scsi.desc = NULL;
+	}
+}
+
 static void spdk_iscsi_queue_task(struct spdk_iscsi_conn *conn,
 				  struct spdk_iscsi_task *task)
 {
 	spdk_trace_record(TRACE_ISCSI_TASK_QUEUE, conn->id, task->scsi.length,
 			  (uintptr_t)task, (uintptr_t)task->pdu);
 	task->is_queued = true;
+	spdk_iscsi_task_set_lun_desc(conn, task);
 	spdk_scsi_dev_queue_task(conn->dev, &task->scsi);
 }
 
 static void spdk_iscsi_queue_mgmt_task(struct spdk_iscsi_conn *conn,
 				       struct spdk_iscsi_task *task)
 {
+	spdk_iscsi_task_set_lun_desc(conn, task);
 	spdk_scsi_dev_queue_mgmt_task(conn->dev, &task->scsi);
 }
 
@@ -2980,6 +3038,39 @@ static int spdk_iscsi_op_scsi_read(struct spdk_iscsi_conn *conn,
 	return spdk_iscsi_conn_handle_queued_datain_tasks(conn);
 }
 
+/*
+ * Writes which need R2T and are not larger than SPDK_ISCSI_MAX_DIRECT_WRITE_LENGTH
+ *  get a contiguous buffer. Immediate data is copied to it, and Data-Out PDUs are
+ *  received directly into it, so that the write is submitted to the LUN as one
+ *  I/O instead of one subtask per Data-Out PDU. Writes with DIF insert or strip,
+ *  or when no buffer is available, use data out buffers as before. A connection
+ *  uses at most MaxDirectWritesPerConnection buffers, so that it cannot take
+ *  all of them from the other connections.
+ */
+static void
+spdk_iscsi_task_get_write_buf(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task,
+			      struct spdk_iscsi_pdu *pdu)
+{
+	struct spdk_dif_ctx dif_ctx;
+
+	if (task->scsi.transfer_len > SPDK_ISCSI_MAX_DIRECT_WRITE_LENGTH ||
+	    conn->direct_write_cnt >= g_spdk_iscsi.max_direct_writes_per_connection ||
+	    g_spdk_iscsi.write_data_pool == NULL ||
+	    spdk_iscsi_get_dif_ctx(conn, pdu, &dif_ctx)) {
+		return;
+	}
+
+	task->mobj = spdk_mempool_get(g_spdk_iscsi.write_data_pool);
+	if (task->mobj == NULL) {
+		return;
+	}
+	conn->direct_write_cnt++;
+
+	if (pdu->data_segment_len > 0) {
+		memcpy(task->mobj->buf, pdu->data, pdu->data_segment_len);
+	}
+}
+
 static int
 spdk_iscsi_op_scsi(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 {
@@ -3078,6 +3169,8 @@ spdk_iscsi_op_scsi(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 
 		if (F_bit && pdu->data_segment_len < transfer_len) {
 			/* needs R2T */
+			spdk_iscsi_task_get_write_buf(conn, task, pdu);
+
 			rc = spdk_add_transfer_task(conn, task);
 			if (rc < 0) {
 				SPDK_ERRLOG("add_transfer_task() failed\n");
@@ -3085,8 +3178,11 @@ spdk_iscsi_op_scsi(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 				return SPDK_ISCSI_CONNECTION_FATAL;
 			}
 
-			/* Non-immediate writes */
-			if (pdu->data_segment_len == 0) {
+			/*
+			 * Non-immediate writes, or writes submitted after all data
+			 *  has been received into the write buffer.
+			 */
+			if (pdu->data_segment_len == 0 || task->mobj != NULL) {
 				return 0;
 			} else {
 				/* we are doing the first partial write task */
@@ -3190,7 +3286,7 @@ spdk_iscsi_task_mgmt_response(struct spdk_iscsi_conn *conn,
 	conn->StatSN++;
 
 	if (reqh->immediate == 0) {
-		conn->sess->MaxCmdSN++;
+		__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 	}
 
 	to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -3291,7 +3387,7 @@ void spdk_iscsi_task_response(struct spdk_iscsi_conn *conn,
 	conn->StatSN++;
 
 	if (!spdk_iscsi_task_is_immediate(primary)) {
-		conn->sess->MaxCmdSN++;
+		__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 	}
 
 	to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -3421,7 +3517,7 @@ spdk_iscsi_op_abort_task(struct spdk_iscsi_task *task, uint32_t ref_task_tag)
 {
 	task->scsi.abort_id = ref_task_tag;
 	task->scsi.function = SPDK_SCSI_TASK_FUNC_ABORT_TASK;
-	task->mgmt_poller = spdk_poller_register(_spdk_iscsi_op_abort_task, task, 10);
+	task->mgmt_poller = SPDK_POLLER_REGISTER(_spdk_iscsi_op_abort_task, task, 10);
 }
 
 static int
@@ -3445,7 +3541,7 @@ void
 spdk_iscsi_op_abort_task_set(struct spdk_iscsi_task *task, uint8_t function)
 {
 	task->scsi.function = function;
-	task->mgmt_poller = spdk_poller_register(_spdk_iscsi_op_abort_task_set, task, 10);
+	task->mgmt_poller = SPDK_POLLER_REGISTER(_spdk_iscsi_op_abort_task_set, task, 10);
 }
 
 static int
@@ -3677,7 +3773,7 @@ spdk_iscsi_op_nopout(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 	conn->StatSN++;
 
 	if (I_bit == 0) {
-		conn->sess->MaxCmdSN++;
+		__sync_fetch_and_add(&conn->sess->MaxCmdSN, 1);
 	}
 
 	to_be32(&rsph->exp_cmd_sn, conn->sess->ExpCmdSN);
@@ -4336,19 +4432,33 @@ static int spdk_iscsi_op_data(struct spdk_iscsi_conn *conn,
 		task->current_r2t_length = 0;
 	}
 
-	subtask = spdk_iscsi_task_get(conn, task, spdk_iscsi_task_cpl);
-	if (subtask == NULL) {
-		SPDK_ERRLOG("Unable to acquire subtask\n");
-		return SPDK_ISCSI_CONNECTION_FATAL;
-	}
-	subtask->scsi.offset = buffer_offset;
-	subtask->scsi.length = pdu->data_segment_len;
-	if (spdk_likely(!pdu->dif_insert_or_strip)) {
-		spdk_scsi_task_set_data(&subtask->scsi, pdu->data, pdu->data_segment_len);
+	if (task->mobj != NULL) {
+		if (pdu->write_task != task) {
+			/* The data segment was not received into the write buffer. */
+			if (buffer_offset + pdu->data_segment_len > transfer_len) {
+				SPDK_ERRLOG("offset(%u) + length(%zu) > transfer length(%u)\n",
+					    buffer_offset, pdu->data_segment_len, transfer_len);
+				return SPDK_ISCSI_CONNECTION_FATAL;
+			}
+			memcpy((uint8_t *)task->mobj->buf + buffer_offset, pdu->data,
+			       pdu->data_segment_len);
+		}
+		subtask = NULL;
 	} else {
-		spdk_scsi_task_set_data(&subtask->scsi, pdu->data, pdu->data_buf_len);
+		subtask = spdk_iscsi_task_get(conn, task, spdk_iscsi_task_cpl);
+		if (subtask == NULL) {
+			SPDK_ERRLOG("Unable to acquire subtask\n");
+			return SPDK_ISCSI_CONNECTION_FATAL;
+		}
+		subtask->scsi.offset = buffer_offset;
+		subtask->scsi.length = pdu->data_segment_len;
+		if (spdk_likely(!pdu->dif_insert_or_strip)) {
+			spdk_scsi_task_set_data(&subtask->scsi, pdu->data, pdu->data_segment_len);
+		} else {
+			spdk_scsi_task_set_data(&subtask->scsi, pdu->data, pdu->data_buf_len);
+		}
+		spdk_iscsi_task_associate_pdu(subtask, pdu);
 	}
-	spdk_iscsi_task_associate_pdu(subtask, pdu);
 
 	if (task->next_expected_r2t_offset == transfer_len) {
 		task->acked_r2tsn++;
@@ -4364,6 +4474,23 @@ static int spdk_iscsi_op_data(struct spdk_iscsi_conn *conn,
 		task->next_r2t_offset += len;
 	}
 
+	if (task->mobj != NULL) {
+		if (task->next_expected_r2t_offset != transfer_len) {
+			return 0;
+		}
+
+		/* All data has been received. Submit the whole write at once. */
+		subtask = spdk_iscsi_task_get(conn, task, spdk_iscsi_task_cpl);
+		if (subtask == NULL) {
+			SPDK_ERRLOG("Unable to acquire subtask\n");
+			return SPDK_ISCSI_CONNECTION_FATAL;
+		}
+		subtask->scsi.offset = 0;
+		subtask->scsi.length = transfer_len;
+		spdk_scsi_task_set_data(&subtask->scsi, task->mobj->buf, transfer_len);
+		spdk_iscsi_task_associate_pdu(subtask, pdu);
+	}
+
 	if (lun_dev == NULL) {
 		SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "LUN %d is removed, complete the task immediately\n",
 			      task->lun_id);
@@ -4488,6 +4615,64 @@ spdk_init_login_reject_response(struct spdk_iscsi_pdu *pdu, struct spdk_iscsi_pd
 	rsph->itt = pdu->bhs.itt;
 }
 
+/*
+ * Commands of a session are executed in CmdSN order. With multiple
+ *  connections, a command may arrive before the ones preceding it, which
+ *  are still in flight on other connections. Such a command is held by its
+ *  connection, and ExpCmdSN only advances over contiguous CmdSNs. Each
+ *  connection holds at most one command, since it stops reading meanwhile,
+ *  so the holder of the next CmdSN is found among the connections.
+ *
+ * Returns true if the command is to be executed now.
+ */
+static bool
+spdk_iscsi_sess_accept_cmdsn(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
+{
+	struct spdk_iscsi_sess *sess = conn->sess;
+	struct spdk_iscsi_conn *next = NULL;
+	uint32_t i;
+
+	/*
+	 * Commands of a single connection arrive in order, and a connection
+	 *  joining the session sends no commands before its login completes.
+	 */
+	if (sess->connections == 1) {
+		sess->ExpCmdSN++;
+		return true;
+	}
+
+	pthread_mutex_lock(&sess->mutex);
+	if (SN32_GT(pdu->cmd_sn, sess->ExpCmdSN) &&
+	    !SN32_GT(pdu->cmd_sn, sess->MaxCmdSN)) {
+		assert(conn->held_pdu == NULL);
+		pdu->ref++;
+		conn->held_pdu = pdu;
+		pthread_mutex_unlock(&sess->mutex);
+		return false;
+	}
+
+	/* Commands outside the window only get here at ERL 1 and 2. */
+	if (pdu->cmd_sn == sess->ExpCmdSN) {
+		sess->ExpCmdSN++;
+		for (i = 0; i < sess->connections; i++) {
+			if (sess->conns[i]->held_pdu != NULL &&
+			    sess->conns[i]->held_pdu->cmd_sn == sess->ExpCmdSN) {
+				next = sess->conns[i];
+				/* Keeps the connection until the event has run. */
+				__sync_fetch_and_add(&next->held_pdu_events, 1);
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&sess->mutex);
+
+	if (next != NULL) {
+		spdk_iscsi_conn_execute_held_pdu(next);
+	}
+
+	return true;
+}
+
 int
 spdk_iscsi_execute(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 {
@@ -4554,6 +4739,30 @@ spdk_iscsi_execute(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 					return SPDK_PDU_FATAL;
 				}
 			}
+		} else if (sess->connections == 1 && pdu->cmd_sn != sess->ExpCmdSN &&
+			   sess->session_type == SESSION_TYPE_NORMAL &&
+			   opcode != ISCSI_OP_SCSI_DATAOUT) {
+			/* Only commands of other connections can be missing ahead of this one. */
+			SPDK_ERRLOG("CmdSN(%u) error ExpCmdSN=%u\n", pdu->cmd_sn, sess->ExpCmdSN);
+
+			if (sess->ErrorRecoveryLevel >= 1) {
+				SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "Skip the error in ERL 1 and 2\n");
+			} else {
+				return SPDK_ISCSI_CONNECTION_FATAL;
+			}
+		}
+	} else if (sess->connections > 1) {
+		/*
+		 * With multiple connections, commands of other connections may be
+		 *  in flight, so an immediate command only needs to be in the window.
+		 */
+		if (SN32_LT(pdu->cmd_sn, sess->ExpCmdSN) ||
+		    SN32_GT(pdu->cmd_sn, sess->MaxCmdSN)) {
+			SPDK_ERRLOG("CmdSN(%u) error (ExpCmdSN=%u, MaxCmdSN=%u)\n",
+				    pdu->cmd_sn, sess->ExpCmdSN, sess->MaxCmdSN);
+			if (sess->ErrorRecoveryLevel == 0 && opcode != ISCSI_OP_NOPOUT) {
+				return SPDK_ISCSI_CONNECTION_FATAL;
+			}
 		}
 	} else if (pdu->cmd_sn != sess->ExpCmdSN) {
 		SPDK_ERRLOG("CmdSN(%u) error ExpCmdSN=%u\n", pdu->cmd_sn, sess->ExpCmdSN);
@@ -4580,8 +4789,11 @@ spdk_iscsi_execute(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 		spdk_remove_acked_pdu(conn, ExpStatSN);
 	}
 
-	if (!I_bit && opcode != ISCSI_OP_SCSI_DATAOUT) {
-		sess->ExpCmdSN++;
+	if (!I_bit && opcode != ISCSI_OP_SCSI_DATAOUT &&
+	    !spdk_iscsi_sess_accept_cmdsn(conn, pdu)) {
+		SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "CmdSN(%u) held (ExpCmdSN=%u)\n",
+			      pdu->cmd_sn, sess->ExpCmdSN);
+		return 0;
 	}
 
 	switch (opcode) {
@@ -4724,6 +4936,7 @@ void spdk_free_sess(struct spdk_iscsi_sess *sess)
 		return;
 	}
 
+	pthread_mutex_destroy(&sess->mutex);
 	sess->tag = 0;
 	sess->target = NULL;
 	sess->session_type = SESSION_TYPE_INVALID;
@@ -4748,6 +4961,12 @@ spdk_create_iscsi_sess(struct spdk_iscsi_conn *conn,
 		return -ENOMEM;
 	}
 
+	if (pthread_mutex_init(&sess->mutex, NULL) != 0) {
+		SPDK_ERRLOG("Unable to initialize session mutex\n");
+		spdk_mempool_put(g_spdk_iscsi.session_pool, (void *)sess);
+		return -ENOMEM;
+	}
+
 	/* configuration values */
 	pthread_mutex_lock(&g_spdk_iscsi.mutex);
 
@@ -4925,23 +5144,15 @@ spdk_append_iscsi_sess(struct spdk_iscsi_conn *conn,
 		return -1;
 	}
 
-	if (sess->connections >= sess->MaxConnections) {
+	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "Connections (tsih %d): %d\n", sess->tsih, sess->connections);
+
+	if (spdk_iscsi_conn_join_sess(conn, sess) != 0) {
 		/* no slot for connection */
 		SPDK_ERRLOG("too many connections for init port name=%s, tsih=%d, cid=%d\n",
 			    initiator_port_name, tsih, cid);
 		return -1;
 	}
 
-	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "Connections (tsih %d): %d\n", sess->tsih, sess->connections);
-	conn->sess = sess;
-
-	/*
-	 * TODO: need a mutex or other sync mechanism to protect the session's
-	 *  connection list.
-	 */
-	sess->conns[sess->connections] = conn;
-	sess->connections++;
-
 	return 0;
 }
 
@@ -41,6 +41,7 @@
 #include "spdk/iscsi_spec.h"
 #include "spdk/event.h"
 #include "spdk/thread.h"
+#include "spdk/slab.h"
 
 #include "iscsi/param.h"
 #include "iscsi/tgt_node.h"
@@ -89,6 +90,27 @@
  */
 #define MAX_DATA_OUT_PER_CONNECTION 16
 
+/*
+ * Writes up to this length, which need R2T, are received into a single
+ *  contiguous buffer and submitted as one I/O once all data has arrived.
+ */
+#define SPDK_ISCSI_MAX_DIRECT_WRITE_LENGTH	(256 * 1024)
+
+/*
+ * Defines default maximum number of contiguous write buffers each connection
+ *  can have in use at any given time, enough for a full default queue depth.
+ *  Further writes fall back to data out buffers. This can be changed by
+ *  configuration file.
+ */
+#define DEFAULT_MAX_DIRECT_WRITES_PER_CONNECTION	DEFAULT_MAX_QUEUE_DEPTH
+
+/*
+ * Defines default number of contiguous write buffers shared by all
+ *  connections, enough for 8 connections at the default queue depth.
+ *  This can be changed by configuration file.
+ */
+#define DEFAULT_DIRECT_WRITE_BUFFER_COUNT	(8 * DEFAULT_MAX_QUEUE_DEPTH)
+
 /*
  * Defines maximum number of data in buffers each connection can have in
  *  use at any given time. So this limit does not affect I/O smaller than
@@ -171,6 +193,7 @@ struct spdk_iscsi_pdu {
 	int ref;
 	bool data_from_mempool;  /* indicate whether the data buffer is allocated from mempool */
 	struct spdk_iscsi_task *task; /* data tied to a task buffer */
+	struct spdk_iscsi_task *write_task; /* data received into the write buffer of a task */
 	uint32_t cmd_sn;
 	uint32_t writev_offset;
 	uint32_t data_buf_len;
@@ -274,6 +297,11 @@ struct spdk_iscsi_sess {
 	bool DataSequenceInOrder;
 	uint32_t ErrorRecoveryLevel;
 
+	/*
+	 * Connections of the session may run on different cores. The mutex
+	 *  protects ExpCmdSN and the connection list against each other.
+	 */
+	pthread_mutex_t mutex;
 	uint32_t ExpCmdSN;
 	uint32_t MaxCmdSN;
 
@@ -286,6 +314,7 @@ struct spdk_iscsi_poll_group {
 	struct spdk_poller				*nop_poller;
 	STAILQ_HEAD(connections, spdk_iscsi_conn)	connections;
 	struct spdk_sock_group				*sock_group;
+	struct spdk_slab_cache				*task_cache;
 };
 
 struct spdk_iscsi_opts {
@@ -308,6 +337,8 @@ struct spdk_iscsi_opts {
 	uint32_t ErrorRecoveryLevel;
 	bool AllowDuplicateIsid;
 	uint32_t min_connections_per_core;
+	uint32_t max_direct_writes_per_connection;
+	uint32_t direct_write_buffer_count;
 };
 
 struct spdk_iscsi_globals {
@@ -337,12 +368,15 @@ struct spdk_iscsi_globals {
 	bool ImmediateData;
 	uint32_t ErrorRecoveryLevel;
 	bool AllowDuplicateIsid;
+	uint32_t max_direct_writes_per_connection;
+	uint32_t direct_write_buffer_count;
 
 	struct spdk_mempool *pdu_pool;
 	struct spdk_mempool *pdu_immediate_data_pool;
 	struct spdk_mempool *pdu_data_out_pool;
+	struct spdk_mempool *write_data_pool;
 	struct spdk_mempool *session_pool;
-	struct spdk_mempool *task_pool;
+	struct spdk_slab *task_pool;
 
 	struct spdk_iscsi_sess	**session;
 	struct spdk_iscsi_poll_group *poll_group;
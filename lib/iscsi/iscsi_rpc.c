@@ -954,6 +954,10 @@ spdk_rpc_get_iscsi_connections(struct spdk_jsonrpc_request *request,
 
 		spdk_json_write_named_string(w, "target_node_name", c->target_short_name);
 
+		spdk_json_write_named_uint64(w, "recv_count", c->recv_cnt);
+
+		spdk_json_write_named_uint64(w, "pdu_recv_count", c->pdu_recv_cnt);
+
 		spdk_json_write_object_end(w);
 	}
 	spdk_json_write_array_end(w);
@@ -141,6 +141,7 @@ spdk_mobj_ctor(struct spdk_mempool *mp, __attribute__((unused)) void *arg,
 #define PDU_POOL_SIZE(iscsi)		(iscsi->MaxConnections * NUM_PDU_PER_CONNECTION(iscsi))
 #define IMMEDIATE_DATA_POOL_SIZE(iscsi)	(iscsi->MaxConnections * 128)
 #define DATA_OUT_POOL_SIZE(iscsi)	(iscsi->MaxConnections * MAX_DATA_OUT_PER_CONNECTION)
+#define WRITE_DATA_POOL_SIZE(iscsi)	(iscsi->direct_write_buffer_count)
 
 static int spdk_iscsi_initialize_pdu_pool(void)
 {
@@ -149,6 +150,8 @@ static int spdk_iscsi_initialize_pdu_pool(void)
 			    sizeof(struct spdk_mobj) + ISCSI_DATA_BUFFER_ALIGNMENT;
 	int dout_mobj_size = SPDK_BDEV_BUF_SIZE_WITH_MD(SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH) +
 			     sizeof(struct spdk_mobj) + ISCSI_DATA_BUFFER_ALIGNMENT;
+	int write_mobj_size = SPDK_ISCSI_MAX_DIRECT_WRITE_LENGTH +
+			      sizeof(struct spdk_mobj) + ISCSI_DATA_BUFFER_ALIGNMENT;
 
 	/* create PDU pool */
 	iscsi->pdu_pool = spdk_mempool_create("PDU_Pool",
@@ -180,6 +183,21 @@ static int spdk_iscsi_initialize_pdu_pool(void)
 		return -1;
 	}
 
+	/* Without write buffers, all writes use data out buffers. */
+	if (WRITE_DATA_POOL_SIZE(iscsi) == 0) {
+		return 0;
+	}
+
+	iscsi->write_data_pool = spdk_mempool_create_ctor("Write_data_Pool",
+				 WRITE_DATA_POOL_SIZE(iscsi),
+				 write_mobj_size, 0,
+				 spdk_env_get_socket_id(spdk_env_get_current_core()),
+				 spdk_mobj_ctor, NULL);
+	if (!iscsi->write_data_pool) {
+		SPDK_ERRLOG("create write data pool failed\n");
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -196,17 +214,20 @@ static void spdk_iscsi_sess_ctor(struct spdk_mempool *pool, void *arg,
 }
 
 #define DEFAULT_TASK_POOL_SIZE 32768
+#define DEFAULT_TASK_CACHE_SIZE 128
 
 static int
 spdk_iscsi_initialize_task_pool(void)
 {
 	struct spdk_iscsi_globals *iscsi = &g_spdk_iscsi;
 
-	/* create scsi_task pool */
-	iscsi->task_pool = spdk_mempool_create("SCSI_TASK_Pool",
-					       DEFAULT_TASK_POOL_SIZE,
-					       sizeof(struct spdk_iscsi_task),
-					       128, SPDK_ENV_SOCKET_ID_ANY);
+	/*
+	 * create scsi_task pool - tasks are allocated on demand through
+	 *  the task cache of each poll group
+	 */
+	iscsi->task_pool = spdk_slab_create("SCSI_TASK_Pool",
+					    sizeof(struct spdk_iscsi_task),
+					    DEFAULT_TASK_POOL_SIZE);
 	if (!iscsi->task_pool) {
 		SPDK_ERRLOG("create task pool failed\n");
 		return -1;
@@ -260,6 +281,18 @@ spdk_iscsi_check_pool(struct spdk_mempool *pool, size_t count)
 	}
 }
 
+static void
+spdk_iscsi_check_slab(struct spdk_slab *slab)
+{
+	struct spdk_slab_stats stats;
+
+	spdk_slab_get_stats(slab, &stats);
+	if (stats.free_count != stats.total_count) {
+		SPDK_ERRLOG("%s has %" PRIu64 " of %" PRIu64 " objects in use, should be 0\n",
+			    spdk_slab_get_name(slab), stats.total_count - stats.free_count, stats.total_count);
+	}
+}
+
 static void
 spdk_iscsi_check_pools(void)
 {
@@ -269,7 +302,10 @@ spdk_iscsi_check_pools(void)
 	spdk_iscsi_check_pool(iscsi->session_pool, SESSION_POOL_SIZE(iscsi));
 	spdk_iscsi_check_pool(iscsi->pdu_immediate_data_pool, IMMEDIATE_DATA_POOL_SIZE(iscsi));
 	spdk_iscsi_check_pool(iscsi->pdu_data_out_pool, DATA_OUT_POOL_SIZE(iscsi));
-	spdk_iscsi_check_pool(iscsi->task_pool, DEFAULT_TASK_POOL_SIZE);
+	if (iscsi->write_data_pool != NULL) {
+		spdk_iscsi_check_pool(iscsi->write_data_pool, WRITE_DATA_POOL_SIZE(iscsi));
+	}
+	spdk_iscsi_check_slab(iscsi->task_pool);
 }
 
 static void
@@ -281,7 +317,8 @@ spdk_iscsi_free_pools(void)
 	spdk_mempool_free(iscsi->session_pool);
 	spdk_mempool_free(iscsi->pdu_immediate_data_pool);
 	spdk_mempool_free(iscsi->pdu_data_out_pool);
-	spdk_mempool_free(iscsi->task_pool);
+	spdk_mempool_free(iscsi->write_data_pool);
+	spdk_slab_free(iscsi->task_pool);
 }
 
 void spdk_put_pdu(struct spdk_iscsi_pdu *pdu)
@@ -302,6 +339,10 @@ void spdk_put_pdu(struct spdk_iscsi_pdu *pdu)
 			spdk_mempool_put(pdu->mobj->mp, (void *)pdu->mobj);
 		}
 
+		if (pdu->write_task) {
+			spdk_iscsi_task_put(pdu->write_task);
+		}
+
 		if (pdu->data && !pdu->data_from_mempool) {
 			free(pdu->data);
 		}
@@ -349,6 +390,10 @@ spdk_iscsi_log_globals(void)
 		      g_spdk_iscsi.AllowDuplicateIsid ? "Yes" : "No");
 	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "ErrorRecoveryLevel %d\n",
 		      g_spdk_iscsi.ErrorRecoveryLevel);
+	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "MaxDirectWritesPerConnection %d\n",
+		      g_spdk_iscsi.max_direct_writes_per_connection);
+	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "DirectWriteBufferCount %d\n",
+		      g_spdk_iscsi.direct_write_buffer_count);
 	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "Timeout %d\n", g_spdk_iscsi.timeout);
 	SPDK_DEBUGLOG(SPDK_LOG_ISCSI, "NopInInterval %d\n",
 		      g_spdk_iscsi.nopininterval);
@@ -399,6 +444,8 @@ spdk_iscsi_opts_init(struct spdk_iscsi_opts *opts)
 	opts->authfile = NULL;
 	opts->nodebase = NULL;
 	opts->min_connections_per_core = DEFAULT_CONNECTIONS_PER_LCORE;
+	opts->max_direct_writes_per_connection = DEFAULT_MAX_DIRECT_WRITES_PER_CONNECTION;
+	opts->direct_write_buffer_count = DEFAULT_DIRECT_WRITE_BUFFER_COUNT;
 }
 
 struct spdk_iscsi_opts *
@@ -472,6 +519,8 @@ spdk_iscsi_opts_copy(struct spdk_iscsi_opts *src)
 	dst->mutual_chap = src->mutual_chap;
 	dst->chap_group = src->chap_group;
 	dst->min_connections_per_core = src->min_connections_per_core;
+	dst->max_direct_writes_per_connection = src->max_direct_writes_per_connection;
+	dst->direct_write_buffer_count = src->direct_write_buffer_count;
 
 	return dst;
 }
@@ -491,6 +540,8 @@ spdk_iscsi_read_config_file_params(struct spdk_conf_section *sp,
 	int timeout;
 	int nopininterval;
 	int min_conn_per_core = 0;
+	int max_direct_writes;
+	int direct_write_buffers;
 	const char *ag_tag;
 	int ag_tag_i;
 	int i;
@@ -620,6 +671,14 @@ spdk_iscsi_read_config_file_params(struct spdk_conf_section *sp,
 	if (min_conn_per_core >= 0) {
 		opts->min_connections_per_core = min_conn_per_core;
 	}
+	max_direct_writes = spdk_conf_section_get_intval(sp, "MaxDirectWritesPerConnection");
+	if (max_direct_writes >= 0) {
+		opts->max_direct_writes_per_connection = max_direct_writes;
+	}
+	direct_write_buffers = spdk_conf_section_get_intval(sp, "DirectWriteBufferCount");
+	if (direct_write_buffers >= 0) {
+		opts->direct_write_buffer_count = direct_write_buffers;
+	}
 
 	return 0;
 }
@@ -766,6 +825,8 @@ spdk_iscsi_set_global_params(struct spdk_iscsi_opts *opts)
 	g_spdk_iscsi.ImmediateData = opts->ImmediateData;
 	g_spdk_iscsi.AllowDuplicateIsid = opts->AllowDuplicateIsid;
 	g_spdk_iscsi.ErrorRecoveryLevel = opts->ErrorRecoveryLevel;
+	g_spdk_iscsi.max_direct_writes_per_connection = opts->max_direct_writes_per_connection;
+	g_spdk_iscsi.direct_write_buffer_count = opts->direct_write_buffer_count;
 	g_spdk_iscsi.timeout = opts->timeout;
 	g_spdk_iscsi.nopininterval = opts->nopininterval;
 	g_spdk_iscsi.disable_chap = opts->disable_chap;
@@ -1167,6 +1228,7 @@ spdk_iscsi_poll_group_poll(void *ctx)
 	}
 
 	STAILQ_FOREACH_SAFE(conn, &group->connections, link, tmp) {
+		spdk_iscsi_conn_handle_buffered_pdus(conn);
 		if (conn->state == ISCSI_CONN_STATE_EXITING) {
 			spdk_iscsi_conn_destruct(conn);
 		}
@@ -1201,9 +1263,13 @@ iscsi_create_poll_group(void *ctx)
 	pg->sock_group = spdk_sock_group_create();
 	assert(pg->sock_group != NULL);
 
-	pg->poller = spdk_poller_register(spdk_iscsi_poll_group_poll, pg, 0);
+	pg->task_cache = spdk_slab_cache_create(g_spdk_iscsi.task_pool, DEFAULT_TASK_CACHE_SIZE,
+						spdk_env_get_socket_id(pg->core));
+	assert(pg->task_cache != NULL);
+
+	pg->poller = SPDK_POLLER_REGISTER(spdk_iscsi_poll_group_poll, pg, 0);
 	/* set the period to 1 sec */
-	pg->nop_poller = spdk_poller_register(spdk_iscsi_poll_group_handle_nop, pg, 1000000);
+	pg->nop_poller = SPDK_POLLER_REGISTER(spdk_iscsi_poll_group_handle_nop, pg, 1000000);
 }
 
 static void
@@ -1217,6 +1283,8 @@ iscsi_unregister_poll_group(void *ctx)
 	assert(pg->sock_group != NULL);
 
 	spdk_sock_group_close(&pg->sock_group);
+	spdk_slab_cache_free(pg->task_cache);
+	pg->task_cache = NULL;
 	spdk_poller_unregister(&pg->poller);
 	spdk_poller_unregister(&pg->nop_poller);
 }
@@ -1423,6 +1491,11 @@ spdk_iscsi_opts_info_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "min_connections_per_core",
 				     spdk_iscsi_conn_get_min_per_core());
 
+	spdk_json_write_named_uint32(w, "max_direct_writes_per_connection",
+				     g_spdk_iscsi.max_direct_writes_per_connection);
+	spdk_json_write_named_uint32(w, "direct_write_buffer_count",
+				     g_spdk_iscsi.direct_write_buffer_count);
+
 	spdk_json_write_object_end(w);
 }
 
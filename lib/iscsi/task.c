@@ -37,6 +37,23 @@
 #include "iscsi/conn.h"
 #include "iscsi/task.h"
 
+/*
+ * Tasks are cached by the poll group of the current core. Tasks may be freed
+ *  outside of any poll group, e.g. during shutdown, and are then returned
+ *  directly to the pool.
+ */
+static struct spdk_slab_cache *
+spdk_iscsi_task_cache(void)
+{
+	uint32_t core = spdk_env_get_current_core();
+
+	if (g_spdk_iscsi.poll_group == NULL || core > spdk_env_get_last_core()) {
+		return NULL;
+	}
+
+	return g_spdk_iscsi.poll_group[core].task_cache;
+}
+
 static void
 spdk_iscsi_task_free(struct spdk_scsi_task *scsi_task)
 {
@@ -48,9 +65,15 @@ spdk_iscsi_task_free(struct spdk_scsi_task *scsi_task)
 	}
 
 	spdk_iscsi_task_disassociate_pdu(task);
+	if (task->mobj) {
+		spdk_mempool_put(task->mobj->mp, (void *)task->mobj);
+		task->mobj = NULL;
+		assert(task->conn->direct_write_cnt > 0);
+		task->conn->direct_write_cnt--;
+	}
 	assert(task->conn->pending_task_cnt > 0);
 	task->conn->pending_task_cnt--;
-	spdk_mempool_put(g_spdk_iscsi.task_pool, (void *)task);
+	spdk_slab_put(g_spdk_iscsi.task_pool, spdk_iscsi_task_cache(), task);
 }
 
 struct spdk_iscsi_task *
@@ -59,7 +82,7 @@ spdk_iscsi_task_get(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *parent
 {
 	struct spdk_iscsi_task *task;
 
-	task = spdk_mempool_get(g_spdk_iscsi.task_pool);
+	task = spdk_slab_get(g_spdk_iscsi.task_pool, spdk_iscsi_task_cache());
 	if (!task) {
 		SPDK_ERRLOG("Unable to get task\n");
 		abort();
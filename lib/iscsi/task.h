@@ -99,6 +99,12 @@ struct spdk_iscsi_task {
 
 	struct spdk_poller *mgmt_poller;
 
+	/*
+	 * Contiguous buffer of a large write. Data-Out PDUs are received
+	 *  directly into it and the write is submitted once it is complete.
+	 */
+	struct spdk_mobj *mobj;
+
 	TAILQ_ENTRY(spdk_iscsi_task) link;
 
 	TAILQ_HEAD(subtask_list, spdk_iscsi_task) subtask_list;
@@ -52,6 +52,13 @@
 #define GET_IO_LOOP_COUNT		16
 #define NBD_BUSY_WAITING_MS		1000
 #define NBD_BUSY_POLLING_INTERVAL_US	20000
+#define NBD_MAX_CONNECTIONS		16
+/* Size of the buffer each connection reads request headers into */
+#define NBD_RECV_BUF_SIZE		(32 * 1024)
+/* Write payloads of at least this size are read directly into the payload buffer */
+#define NBD_RECV_DIRECT_THRESHOLD	4096
+/* Maximum number of iovecs gathered into a single writev() of replies */
+#define NBD_XMIT_IOV_COUNT		64
 
 enum nbd_io_state_t {
 	/* Receiving or ready to receive nbd request header */
@@ -66,6 +73,7 @@ enum nbd_io_state_t {
 
 struct nbd_io {
 	struct spdk_nbd_disk	*nbd;
+	struct nbd_conn		*conn;
 	enum nbd_io_state_t	state;
 
 	void			*payload;
@@ -94,20 +102,41 @@ enum nbd_disk_state_t {
 	NBD_DISK_STATE_HARDDISC,
 };
 
+/*
+ * One socketpair between the kernel and SPDK. With NBD_FLAG_CAN_MULTI_CONN
+ * the kernel spreads requests over all connections of a disk, so requests
+ * of one connection are always answered on the same connection.
+ */
+struct nbd_conn {
+	struct spdk_nbd_disk	*nbd;
+	int			kernel_sp_fd;
+	int			spdk_sp_fd;
+
+	struct nbd_io		*io_in_recv;
+	TAILQ_HEAD(, nbd_io)	received_io_list;
+	TAILQ_HEAD(, nbd_io)	executed_io_list;
+
+	/*
+	 * Data read from the socket but not consumed yet. A single read()
+	 * usually returns several request headers, which are then parsed
+	 * without further syscalls.
+	 */
+	uint8_t			*recv_buf;
+	uint32_t		recv_buf_offset;
+	uint32_t		recv_buf_len;
+};
+
 struct spdk_nbd_disk {
 	struct spdk_bdev	*bdev;
 	struct spdk_bdev_desc	*bdev_desc;
 	struct spdk_io_channel	*ch;
 	int			dev_fd;
 	char			*nbd_path;
-	int			kernel_sp_fd;
-	int			spdk_sp_fd;
 	struct spdk_poller	*nbd_poller;
 	uint32_t		buf_align;
 
-	struct nbd_io		*io_in_recv;
-	TAILQ_HEAD(, nbd_io)	received_io_list;
-	TAILQ_HEAD(, nbd_io)	executed_io_list;
+	struct nbd_conn		*conns;
+	uint32_t		num_conns;
 
 	enum nbd_disk_state_t	state;
 	/* count of nbd_io in spdk_nbd_disk */
@@ -218,6 +247,12 @@ spdk_nbd_disk_get_bdev_name(struct spdk_nbd_disk *nbd)
 	return spdk_bdev_get_name(nbd->bdev);
 }
 
+uint32_t
+spdk_nbd_disk_get_num_connections(struct spdk_nbd_disk *nbd)
+{
+	return nbd->num_conns;
+}
+
 void
 spdk_nbd_write_config_json(struct spdk_json_write_ctx *w)
 {
@@ -233,6 +268,9 @@ spdk_nbd_write_config_json(struct spdk_json_write_ctx *w)
 		spdk_json_write_named_object_begin(w, "params");
 		spdk_json_write_named_string(w, "nbd_device",  spdk_nbd_disk_get_nbd_path(nbd));
 		spdk_json_write_named_string(w, "bdev_name", spdk_nbd_disk_get_bdev_name(nbd));
+		if (nbd->num_conns > 1) {
+			spdk_json_write_named_uint32(w, "num_connections", nbd->num_conns);
+		}
 		spdk_json_write_object_end(w);
 
 		spdk_json_write_object_end(w);
@@ -253,8 +291,9 @@ nbd_disconnect(struct spdk_nbd_disk *nbd)
 }
 
 static struct nbd_io *
-spdk_get_nbd_io(struct spdk_nbd_disk *nbd)
+spdk_get_nbd_io(struct nbd_conn *conn)
 {
+	struct spdk_nbd_disk *nbd = conn->nbd;
 	struct nbd_io *io;
 
 	io = calloc(1, sizeof(*io));
@@ -263,6 +302,7 @@ spdk_get_nbd_io(struct spdk_nbd_disk *nbd)
 	}
 
 	io->nbd = nbd;
+	io->conn = conn;
 	to_be32(&io->resp.magic, NBD_REPLY_MAGIC);
 
 	nbd->io_count++;
@@ -290,9 +330,16 @@ spdk_put_nbd_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
 static int
 spdk_nbd_io_xmit_check(struct spdk_nbd_disk *nbd)
 {
-	if (nbd->io_count == 0) {
-		return 0;
-	} else if (nbd->io_count == 1 && nbd->io_in_recv != NULL) {
+	int io_in_recv = 0;
+	uint32_t i;
+
+	for (i = 0; i < nbd->num_conns; i++) {
+		if (nbd->conns[i].io_in_recv != NULL) {
+			io_in_recv++;
+		}
+	}
+
+	if (nbd->io_count == io_in_recv) {
 		return 0;
 	}
 
@@ -309,26 +356,28 @@ spdk_nbd_io_xmit_check(struct spdk_nbd_disk *nbd)
 static int
 spdk_nbd_cleanup_io(struct spdk_nbd_disk *nbd)
 {
+	struct nbd_conn *conn;
 	struct nbd_io *io, *io_tmp;
+	uint32_t i;
 
-	/* free io_in_recv */
-	if (nbd->io_in_recv != NULL) {
-		spdk_put_nbd_io(nbd, nbd->io_in_recv);
-		nbd->io_in_recv = NULL;
-	}
+	for (i = 0; i < nbd->num_conns; i++) {
+		conn = &nbd->conns[i];
 
-	/* free io in received_io_list */
-	if (!TAILQ_EMPTY(&nbd->received_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->received_io_list, tailq, io_tmp) {
-			TAILQ_REMOVE(&nbd->received_io_list, io, tailq);
+		/* free io_in_recv */
+		if (conn->io_in_recv != NULL) {
+			spdk_put_nbd_io(nbd, conn->io_in_recv);
+			conn->io_in_recv = NULL;
+		}
+
+		/* free io in received_io_list */
+		TAILQ_FOREACH_SAFE(io, &conn->received_io_list, tailq, io_tmp) {
+			TAILQ_REMOVE(&conn->received_io_list, io, tailq);
 			spdk_put_nbd_io(nbd, io);
 		}
-	}
 
-	/* free io in executed_io_list */
-	if (!TAILQ_EMPTY(&nbd->executed_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->executed_io_list, tailq, io_tmp) {
-			TAILQ_REMOVE(&nbd->executed_io_list, io, tailq);
+		/* free io in executed_io_list */
+		TAILQ_FOREACH_SAFE(io, &conn->executed_io_list, tailq, io_tmp) {
+			TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
 			spdk_put_nbd_io(nbd, io);
 		}
 	}
@@ -344,9 +393,28 @@ spdk_nbd_cleanup_io(struct spdk_nbd_disk *nbd)
 	return 0;
 }
 
+static void
+nbd_conn_close(struct nbd_conn *conn)
+{
+	if (conn->spdk_sp_fd >= 0) {
+		close(conn->spdk_sp_fd);
+		conn->spdk_sp_fd = -1;
+	}
+
+	if (conn->kernel_sp_fd >= 0) {
+		close(conn->kernel_sp_fd);
+		conn->kernel_sp_fd = -1;
+	}
+
+	free(conn->recv_buf);
+	conn->recv_buf = NULL;
+}
+
 static void
 _nbd_stop(struct spdk_nbd_disk *nbd)
 {
+	uint32_t i;
+
 	if (nbd->ch) {
 		spdk_put_io_channel(nbd->ch);
 	}
@@ -355,13 +423,10 @@ _nbd_stop(struct spdk_nbd_disk *nbd)
 		spdk_bdev_close(nbd->bdev_desc);
 	}
 
-	if (nbd->spdk_sp_fd >= 0) {
-		close(nbd->spdk_sp_fd);
-	}
-
-	if (nbd->kernel_sp_fd >= 0) {
-		close(nbd->kernel_sp_fd);
+	for (i = 0; i < nbd->num_conns; i++) {
+		nbd_conn_close(&nbd->conns[i]);
 	}
+	free(nbd->conns);
 
 	if (nbd->dev_fd >= 0) {
 		/* Clear nbd device only if it is occupied by SPDK app */
@@ -421,11 +486,11 @@ read_from_socket(int fd, void *buf, size_t length)
 }
 
 static int64_t
-write_to_socket(int fd, void *buf, size_t length)
+writev_to_socket(int fd, struct iovec *iov, int iovcnt)
 {
 	ssize_t bytes_written;
 
-	bytes_written = write(fd, buf, length);
+	bytes_written = writev(fd, iov, iovcnt);
 	if (bytes_written == 0) {
 		return -EIO;
 	} else if (bytes_written == -1) {
@@ -451,7 +516,7 @@ nbd_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	}
 
 	memcpy(&io->resp.handle, &io->req.handle, sizeof(io->resp.handle));
-	TAILQ_INSERT_TAIL(&nbd->executed_io_list, io, tailq);
+	TAILQ_INSERT_TAIL(&io->conn->executed_io_list, io, tailq);
 
 	if (bdev_io != NULL) {
 		spdk_bdev_free_io(bdev_io);
@@ -544,8 +609,9 @@ nbd_submit_bdev_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
 }
 
 static int
-spdk_nbd_io_exec(struct spdk_nbd_disk *nbd)
+spdk_nbd_io_exec(struct nbd_conn *conn)
 {
+	struct spdk_nbd_disk *nbd = conn->nbd;
 	struct nbd_io *io, *io_tmp;
 	int ret = 0;
 
@@ -557,44 +623,83 @@ spdk_nbd_io_exec(struct spdk_nbd_disk *nbd)
 		return 0;
 	}
 
-	if (!TAILQ_EMPTY(&nbd->received_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->received_io_list, tailq, io_tmp) {
-			TAILQ_REMOVE(&nbd->received_io_list, io, tailq);
-			ret = nbd_submit_bdev_io(nbd, io);
-			if (ret < 0) {
-				break;
-			}
+	TAILQ_FOREACH_SAFE(io, &conn->received_io_list, tailq, io_tmp) {
+		TAILQ_REMOVE(&conn->received_io_list, io, tailq);
+		ret = nbd_submit_bdev_io(nbd, io);
+		if (ret < 0) {
+			break;
 		}
 	}
 
 	return ret;
 }
 
-static int
-spdk_nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
+/*
+ * Read up to length bytes for the connection. Data left over from a previous
+ * read is returned first. Otherwise small reads refill the receive buffer with
+ * a single read() so that the following headers need no syscall, while large
+ * reads bypass the buffer to avoid copying write payloads twice.
+ */
+static int64_t
+nbd_conn_read(struct nbd_conn *conn, void *buf, size_t length)
 {
+	int64_t ret;
+
+	if (conn->recv_buf_offset == conn->recv_buf_len) {
+		conn->recv_buf_offset = 0;
+		conn->recv_buf_len = 0;
+
+		if (length >= NBD_RECV_DIRECT_THRESHOLD) {
+			return read_from_socket(conn->spdk_sp_fd, buf, length);
+		}
+
+		ret = read_from_socket(conn->spdk_sp_fd, conn->recv_buf, NBD_RECV_BUF_SIZE);
+		if (ret <= 0) {
+			return ret;
+		}
+		conn->recv_buf_len = ret;
+	}
+
+	length = spdk_min(length, conn->recv_buf_len - conn->recv_buf_offset);
+	memcpy(buf, conn->recv_buf + conn->recv_buf_offset, length);
+	conn->recv_buf_offset += length;
+
+	return length;
+}
+
+/**
+ * Advance the request being received on the connection.
+ *
+ * \return number of bytes consumed, 0 if no data is available or negated
+ * errno on error.
+ */
+static int64_t
+spdk_nbd_io_recv_internal(struct nbd_conn *conn)
+{
+	struct spdk_nbd_disk *nbd = conn->nbd;
 	struct nbd_io *io;
-	int ret = 0;
+	int64_t ret = 0, consumed = 0;
 
-	if (nbd->io_in_recv == NULL) {
-		nbd->io_in_recv = spdk_get_nbd_io(nbd);
-		if (!nbd->io_in_recv) {
+	if (conn->io_in_recv == NULL) {
+		conn->io_in_recv = spdk_get_nbd_io(conn);
+		if (!conn->io_in_recv) {
 			return -ENOMEM;
 		}
 	}
 
-	io = nbd->io_in_recv;
+	io = conn->io_in_recv;
 
 	if (io->state == NBD_IO_RECV_REQ) {
-		ret = read_from_socket(nbd->spdk_sp_fd, (char *)&io->req + io->offset,
-				       sizeof(io->req) - io->offset);
+		ret = nbd_conn_read(conn, (char *)&io->req + io->offset,
+				    sizeof(io->req) - io->offset);
 		if (ret < 0) {
 			spdk_put_nbd_io(nbd, io);
-			nbd->io_in_recv = NULL;
+			conn->io_in_recv = NULL;
 			return ret;
 		}
 
 		io->offset += ret;
+		consumed += ret;
 
 		/* request is fully received */
 		if (io->offset == sizeof(io->req)) {
@@ -604,7 +709,7 @@ spdk_nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 			if (from_be32(&io->req.magic) != NBD_REQUEST_MAGIC) {
 				SPDK_ERRLOG("invalid request magic\n");
 				spdk_put_nbd_io(nbd, io);
-				nbd->io_in_recv = NULL;
+				conn->io_in_recv = NULL;
 				return -EINVAL;
 			}
 
@@ -622,7 +727,7 @@ spdk_nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 				if (io->payload == NULL) {
 					SPDK_ERRLOG("could not allocate io->payload of size %d\n", io->payload_size);
 					spdk_put_nbd_io(nbd, io);
-					nbd->io_in_recv = NULL;
+					conn->io_in_recv = NULL;
 					return -ENOMEM;
 				}
 			} else {
@@ -634,148 +739,168 @@ spdk_nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 				io->state = NBD_IO_RECV_PAYLOAD;
 			} else {
 				io->state = NBD_IO_XMIT_RESP;
-				nbd->io_in_recv = NULL;
-				TAILQ_INSERT_TAIL(&nbd->received_io_list, io, tailq);
+				conn->io_in_recv = NULL;
+				TAILQ_INSERT_TAIL(&conn->received_io_list, io, tailq);
 			}
 		}
 	}
 
 	if (io->state == NBD_IO_RECV_PAYLOAD) {
-		ret = read_from_socket(nbd->spdk_sp_fd, io->payload + io->offset, io->payload_size - io->offset);
+		ret = nbd_conn_read(conn, io->payload + io->offset, io->payload_size - io->offset);
 		if (ret < 0) {
 			spdk_put_nbd_io(nbd, io);
-			nbd->io_in_recv = NULL;
+			conn->io_in_recv = NULL;
 			return ret;
 		}
 
 		io->offset += ret;
+		consumed += ret;
 
 		/* request payload is fully received */
 		if (io->offset == io->payload_size) {
 			io->offset = 0;
 			io->state = NBD_IO_XMIT_RESP;
-			nbd->io_in_recv = NULL;
-			TAILQ_INSERT_TAIL(&nbd->received_io_list, io, tailq);
+			conn->io_in_recv = NULL;
+			TAILQ_INSERT_TAIL(&conn->received_io_list, io, tailq);
 		}
 
 	}
 
-	return 0;
+	return consumed;
 }
 
 static int
-spdk_nbd_io_recv(struct spdk_nbd_disk *nbd)
+spdk_nbd_io_recv(struct nbd_conn *conn)
 {
-	int i, ret = 0;
-
-	/*
-	 * nbd server should not accept request in both soft and hard
-	 * disconnect states.
-	 */
-	if (nbd->state != NBD_DISK_STATE_RUNNING) {
-		return 0;
-	}
+	int i;
+	int64_t ret;
 
 	for (i = 0; i < GET_IO_LOOP_COUNT; i++) {
-		ret = spdk_nbd_io_recv_internal(nbd);
-		if (ret != 0) {
+		ret = spdk_nbd_io_recv_internal(conn);
+		if (ret < 0) {
 			return ret;
+		} else if (ret == 0) {
+			/* Nothing more to read, don't spin on an empty socket */
+			break;
 		}
 	}
 
 	return 0;
 }
 
-static int
-spdk_nbd_io_xmit_internal(struct spdk_nbd_disk *nbd)
+static bool
+nbd_io_has_payload_to_xmit(struct nbd_io *io)
 {
-	struct nbd_io *io;
-	int ret = 0;
-
-	io = TAILQ_FIRST(&nbd->executed_io_list);
-	if (io == NULL) {
-		return 0;
-	}
+	/* transmit payload only when NBD_CMD_READ with no resp error */
+	return from_be32(&io->req.type) == NBD_CMD_READ && io->resp.error == 0;
+}
 
-	/* Remove IO from list now assuming it will be completed.  It will be inserted
-	 *  back to the head if it cannot be completed.  This approach is specifically
-	 *  taken to work around a scan-build use-after-free mischaracterization.
-	 */
-	TAILQ_REMOVE(&nbd->executed_io_list, io, tailq);
+/**
+ * Transmit the replies of as many executed ios as fit into a single writev().
+ *
+ * \return number of bytes written, 0 if the socket is full or negated errno
+ * on error.
+ */
+static int64_t
+spdk_nbd_io_xmit_internal(struct nbd_conn *conn)
+{
+	struct spdk_nbd_disk *nbd = conn->nbd;
+	struct iovec iov[NBD_XMIT_IOV_COUNT];
+	struct nbd_io *io, *io_tmp;
+	int iovcnt = 0;
+	int64_t ret, remaining;
+	size_t len;
 
 	/* resp error and handler are already set in io_done */
+	TAILQ_FOREACH(io, &conn->executed_io_list, tailq) {
+		if (iovcnt + 2 > NBD_XMIT_IOV_COUNT) {
+			break;
+		}
 
-	if (io->state == NBD_IO_XMIT_RESP) {
-		ret = write_to_socket(nbd->spdk_sp_fd, (char *)&io->resp + io->offset,
-				      sizeof(io->resp) - io->offset);
-		if (ret <= 0) {
-			goto reinsert;
+		if (io->state == NBD_IO_XMIT_RESP) {
+			iov[iovcnt].iov_base = (char *)&io->resp + io->offset;
+			iov[iovcnt].iov_len = sizeof(io->resp) - io->offset;
+			iovcnt++;
+
+			if (nbd_io_has_payload_to_xmit(io) && io->payload_size > 0) {
+				iov[iovcnt].iov_base = io->payload;
+				iov[iovcnt].iov_len = io->payload_size;
+				iovcnt++;
+			}
+		} else {
+			iov[iovcnt].iov_base = io->payload + io->offset;
+			iov[iovcnt].iov_len = io->payload_size - io->offset;
+			iovcnt++;
 		}
+	}
 
-		io->offset += ret;
+	if (iovcnt == 0) {
+		return 0;
+	}
 
-		/* response is fully transmitted */
-		if (io->offset == sizeof(io->resp)) {
-			io->offset = 0;
+	ret = writev_to_socket(conn->spdk_sp_fd, iov, iovcnt);
+	if (ret <= 0) {
+		return ret;
+	}
 
-			/* transmit payload only when NBD_CMD_READ with no resp error */
-			if (from_be32(&io->req.type) != NBD_CMD_READ || io->resp.error != 0) {
+	/* Account the written bytes to the ios in list order */
+	remaining = ret;
+	TAILQ_FOREACH_SAFE(io, &conn->executed_io_list, tailq, io_tmp) {
+		if (io->state == NBD_IO_XMIT_RESP) {
+			len = spdk_min((size_t)remaining, sizeof(io->resp) - io->offset);
+			io->offset += len;
+			remaining -= len;
+
+			/* response is not fully transmitted */
+			if (io->offset < sizeof(io->resp)) {
+				break;
+			}
+
+			io->offset = 0;
+			if (!nbd_io_has_payload_to_xmit(io)) {
+				TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
 				spdk_put_nbd_io(nbd, io);
-				return 0;
-			} else {
-				io->state = NBD_IO_XMIT_PAYLOAD;
+				continue;
 			}
+
+			io->state = NBD_IO_XMIT_PAYLOAD;
 		}
-	}
 
-	if (io->state == NBD_IO_XMIT_PAYLOAD) {
-		ret = write_to_socket(nbd->spdk_sp_fd, io->payload + io->offset, io->payload_size - io->offset);
-		if (ret <= 0) {
-			goto reinsert;
+		len = spdk_min((size_t)remaining, io->payload_size - io->offset);
+		io->offset += len;
+		remaining -= len;
+
+		/* read payload is not fully transmitted */
+		if (io->offset < io->payload_size) {
+			break;
 		}
 
-		io->offset += ret;
+		TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
+		spdk_put_nbd_io(nbd, io);
 
-		/* read payload is fully transmitted */
-		if (io->offset == io->payload_size) {
-			spdk_put_nbd_io(nbd, io);
-			return 0;
+		if (remaining == 0) {
+			break;
 		}
 	}
 
-reinsert:
-	TAILQ_INSERT_HEAD(&nbd->executed_io_list, io, tailq);
 	return ret;
 }
 
 static int
-spdk_nbd_io_xmit(struct spdk_nbd_disk *nbd)
+spdk_nbd_io_xmit(struct nbd_conn *conn)
 {
-	int ret = 0;
-
-	/*
-	 * For soft disconnection, nbd server must handle all outstanding
-	 * request before closing connection.
-	 */
-	if (nbd->state == NBD_DISK_STATE_HARDDISC) {
-		return 0;
-	}
+	int64_t ret;
 
-	while (!TAILQ_EMPTY(&nbd->executed_io_list)) {
-		ret = spdk_nbd_io_xmit_internal(nbd);
-		if (ret != 0) {
+	while (!TAILQ_EMPTY(&conn->executed_io_list)) {
+		ret = spdk_nbd_io_xmit_internal(conn);
+		if (ret < 0) {
 			return ret;
+		} else if (ret == 0) {
+			/* Socket is full, continue on the next poll */
+			break;
 		}
 	}
 
-	/*
-	 * For soft disconnection, nbd server can close connection after all
-	 * outstanding request are transmitted.
-	 */
-	if (nbd->state == NBD_DISK_STATE_SOFTDISC && !spdk_nbd_io_xmit_check(nbd)) {
-		return -1;
-	}
-
 	return 0;
 }
 
@@ -787,22 +912,53 @@ spdk_nbd_io_xmit(struct spdk_nbd_disk *nbd)
 static int
 _spdk_nbd_poll(struct spdk_nbd_disk *nbd)
 {
+	struct nbd_conn *conn;
+	uint32_t i;
 	int rc;
 
-	/* transmit executed io first */
-	rc = spdk_nbd_io_xmit(nbd);
-	if (rc < 0) {
-		return rc;
-	}
+	/*
+	 * For soft disconnection, nbd server must handle all outstanding
+	 * request before closing connection.
+	 */
+	if (nbd->state != NBD_DISK_STATE_HARDDISC) {
+		/* transmit executed io first */
+		for (i = 0; i < nbd->num_conns; i++) {
+			rc = spdk_nbd_io_xmit(&nbd->conns[i]);
+			if (rc < 0) {
+				return rc;
+			}
+		}
 
-	rc = spdk_nbd_io_recv(nbd);
-	if (rc < 0) {
-		return rc;
+		/*
+		 * For soft disconnection, nbd server can close connection after all
+		 * outstanding request are transmitted.
+		 */
+		if (nbd->state == NBD_DISK_STATE_SOFTDISC && !spdk_nbd_io_xmit_check(nbd)) {
+			return -1;
+		}
 	}
 
-	rc = spdk_nbd_io_exec(nbd);
+	for (i = 0; i < nbd->num_conns; i++) {
+		conn = &nbd->conns[i];
 
-	return rc;
+		/*
+		 * nbd server should not accept request in both soft and hard
+		 * disconnect states.
+		 */
+		if (nbd->state == NBD_DISK_STATE_RUNNING) {
+			rc = spdk_nbd_io_recv(conn);
+			if (rc < 0) {
+				return rc;
+			}
+		}
+
+		rc = spdk_nbd_io_exec(conn);
+		if (rc < 0) {
+			return rc;
+		}
+	}
+
+	return 0;
 }
 
 static int
@@ -856,6 +1012,8 @@ spdk_nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 	int		rc;
 	pthread_t	tid;
 	int		flag;
+	int		nbd_flags = 0;
+	uint32_t	i;
 
 	/* Add nbd_disk to the end of disk list */
 	rc = spdk_nbd_disk_register(ctx->nbd);
@@ -880,14 +1038,23 @@ spdk_nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 	}
 
 #ifdef NBD_FLAG_SEND_TRIM
-	rc = ioctl(ctx->nbd->dev_fd, NBD_SET_FLAGS, NBD_FLAG_SEND_TRIM);
-	if (rc == -1) {
-		SPDK_ERRLOG("ioctl(NBD_SET_FLAGS) failed: %s\n", spdk_strerror(errno));
-		rc = -errno;
-		goto err;
+	nbd_flags |= NBD_FLAG_SEND_TRIM;
+#endif
+#ifdef NBD_FLAG_CAN_MULTI_CONN
+	if (ctx->nbd->num_conns > 1) {
+		nbd_flags |= NBD_FLAG_CAN_MULTI_CONN;
 	}
 #endif
 
+	if (nbd_flags != 0) {
+		rc = ioctl(ctx->nbd->dev_fd, NBD_SET_FLAGS, nbd_flags);
+		if (rc == -1) {
+			SPDK_ERRLOG("ioctl(NBD_SET_FLAGS) failed: %s\n", spdk_strerror(errno));
+			rc = -errno;
+			goto err;
+		}
+	}
+
 	rc = pthread_create(&tid, NULL, nbd_start_kernel, (void *)(intptr_t)ctx->nbd->dev_fd);
 	if (rc != 0) {
 		SPDK_ERRLOG("could not create thread: %s\n", spdk_strerror(rc));
@@ -902,15 +1069,17 @@ spdk_nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 		goto err;
 	}
 
-	flag = fcntl(ctx->nbd->spdk_sp_fd, F_GETFL);
-	if (fcntl(ctx->nbd->spdk_sp_fd, F_SETFL, flag | O_NONBLOCK) < 0) {
-		SPDK_ERRLOG("fcntl can't set nonblocking mode for socket, fd: %d (%s)\n",
-			    ctx->nbd->spdk_sp_fd, spdk_strerror(errno));
-		rc = -errno;
-		goto err;
+	for (i = 0; i < ctx->nbd->num_conns; i++) {
+		flag = fcntl(ctx->nbd->conns[i].spdk_sp_fd, F_GETFL);
+		if (fcntl(ctx->nbd->conns[i].spdk_sp_fd, F_SETFL, flag | O_NONBLOCK) < 0) {
+			SPDK_ERRLOG("fcntl can't set nonblocking mode for socket, fd: %d (%s)\n",
+				    ctx->nbd->conns[i].spdk_sp_fd, spdk_strerror(errno));
+			rc = -errno;
+			goto err;
+		}
 	}
 
-	ctx->nbd->nbd_poller = spdk_poller_register(spdk_nbd_poll, ctx->nbd, 0);
+	ctx->nbd->nbd_poller = SPDK_POLLER_REGISTER(spdk_nbd_poll, ctx->nbd, 0);
 
 	if (ctx->cb_fn) {
 		ctx->cb_fn(ctx->cb_arg, ctx->nbd, 0);
@@ -931,14 +1100,16 @@ static int
 spdk_nbd_enable_kernel(void *arg)
 {
 	struct spdk_nbd_start_ctx *ctx = arg;
+	struct spdk_nbd_disk *nbd = ctx->nbd;
+	uint32_t i, j;
 	int rc;
 
 	/* Declare device setup by this process */
-	rc = ioctl(ctx->nbd->dev_fd, NBD_SET_SOCK, ctx->nbd->kernel_sp_fd);
+	rc = ioctl(nbd->dev_fd, NBD_SET_SOCK, nbd->conns[0].kernel_sp_fd);
 	if (rc == -1) {
 		if (errno == EBUSY && ctx->polling_count-- > 0) {
 			if (ctx->poller == NULL) {
-				ctx->poller = spdk_poller_register(spdk_nbd_enable_kernel, ctx,
+				ctx->poller = SPDK_POLLER_REGISTER(spdk_nbd_enable_kernel, ctx,
 								   NBD_BUSY_POLLING_INTERVAL_US);
 			}
 			/* If the kernel is busy, check back later */
@@ -964,20 +1135,84 @@ spdk_nbd_enable_kernel(void *arg)
 		spdk_poller_unregister(&ctx->poller);
 	}
 
+	/*
+	 * Kernels without multi-connection support refuse additional sockets.
+	 * Serve the device over the connections accepted so far in that case.
+	 */
+	for (i = 1; i < nbd->num_conns; i++) {
+		rc = ioctl(nbd->dev_fd, NBD_SET_SOCK, nbd->conns[i].kernel_sp_fd);
+		if (rc == -1) {
+			SPDK_WARNLOG("%s accepted only %u of %u connections: %s\n", nbd->nbd_path,
+				     i, nbd->num_conns, spdk_strerror(errno));
+			for (j = i; j < nbd->num_conns; j++) {
+				nbd_conn_close(&nbd->conns[j]);
+			}
+			nbd->num_conns = i;
+			break;
+		}
+	}
+
 	spdk_nbd_start_complete(ctx);
 
 	return 1;
 }
 
+static int
+nbd_conn_init(struct spdk_nbd_disk *nbd, struct nbd_conn *conn)
+{
+	int sp[2];
+
+	conn->nbd = nbd;
+	TAILQ_INIT(&conn->received_io_list);
+	TAILQ_INIT(&conn->executed_io_list);
+
+	conn->recv_buf = malloc(NBD_RECV_BUF_SIZE);
+	if (conn->recv_buf == NULL) {
+		return -ENOMEM;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sp) != 0) {
+		SPDK_ERRLOG("socketpair failed\n");
+		return -errno;
+	}
+
+	conn->spdk_sp_fd = sp[0];
+	conn->kernel_sp_fd = sp[1];
+
+	return 0;
+}
+
 void
 spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 	       spdk_nbd_start_cb cb_fn, void *cb_arg)
+{
+	spdk_nbd_start_ext(bdev_name, nbd_path, 1, cb_fn, cb_arg);
+}
+
+void
+spdk_nbd_start_ext(const char *bdev_name, const char *nbd_path, uint32_t num_connections,
+		   spdk_nbd_start_cb cb_fn, void *cb_arg)
 {
 	struct spdk_nbd_start_ctx	*ctx = NULL;
 	struct spdk_nbd_disk		*nbd = NULL;
 	struct spdk_bdev		*bdev;
+	uint32_t			i;
 	int				rc;
-	int				sp[2];
+
+	if (num_connections == 0 || num_connections > NBD_MAX_CONNECTIONS) {
+		SPDK_ERRLOG("invalid number of connections %u, must be between 1 and %u\n",
+			    num_connections, NBD_MAX_CONNECTIONS);
+		rc = -EINVAL;
+		goto err;
+	}
+
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+	if (num_connections > 1) {
+		SPDK_ERRLOG("multiple connections per device are not supported by the kernel headers\n");
+		rc = -ENOTSUP;
+		goto err;
+	}
+#endif
 
 	bdev = spdk_bdev_get_by_name(bdev_name);
 	if (bdev == NULL) {
@@ -993,8 +1228,18 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 	}
 
 	nbd->dev_fd = -1;
-	nbd->spdk_sp_fd = -1;
-	nbd->kernel_sp_fd = -1;
+
+	nbd->conns = calloc(num_connections, sizeof(*nbd->conns));
+	if (nbd->conns == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	nbd->num_conns = num_connections;
+	for (i = 0; i < num_connections; i++) {
+		nbd->conns[i].spdk_sp_fd = -1;
+		nbd->conns[i].kernel_sp_fd = -1;
+	}
 
 	ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
@@ -1018,15 +1263,13 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 	nbd->ch = spdk_bdev_get_io_channel(nbd->bdev_desc);
 	nbd->buf_align = spdk_max(spdk_bdev_get_buf_align(bdev), 64);
 
-	rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sp);
-	if (rc != 0) {
-		SPDK_ERRLOG("socketpair failed\n");
-		rc = -errno;
-		goto err;
+	for (i = 0; i < num_connections; i++) {
+		rc = nbd_conn_init(nbd, &nbd->conns[i]);
+		if (rc != 0) {
+			goto err;
+		}
 	}
 
-	nbd->spdk_sp_fd = sp[0];
-	nbd->kernel_sp_fd = sp[1];
 	nbd->nbd_path = strdup(nbd_path);
 	if (!nbd->nbd_path) {
 		SPDK_ERRLOG("strdup allocation failure\n");
@@ -1034,9 +1277,6 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 		goto err;
 	}
 
-	TAILQ_INIT(&nbd->received_io_list);
-	TAILQ_INIT(&nbd->executed_io_list);
-
 	/* Make sure nbd_path is not used in this SPDK app */
 	if (spdk_nbd_disk_find_by_nbd_path(nbd->nbd_path)) {
 		SPDK_NOTICELOG("%s is already exported\n", nbd->nbd_path);
@@ -1051,8 +1291,8 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 		goto err;
 	}
 
-	SPDK_INFOLOG(SPDK_LOG_NBD, "Enabling kernel access to bdev %s via %s\n",
-		     spdk_bdev_get_name(bdev), nbd_path);
+	SPDK_INFOLOG(SPDK_LOG_NBD, "Enabling kernel access to bdev %s via %s over %u connection(s)\n",
+		     spdk_bdev_get_name(bdev), nbd_path, num_connections);
 
 	spdk_nbd_enable_kernel(ctx);
 	return;
@@ -47,6 +47,8 @@ const char *spdk_nbd_disk_get_nbd_path(struct spdk_nbd_disk *nbd);
 
 const char *spdk_nbd_disk_get_bdev_name(struct spdk_nbd_disk *nbd);
 
+uint32_t spdk_nbd_disk_get_num_connections(struct spdk_nbd_disk *nbd);
+
 void nbd_disconnect(struct spdk_nbd_disk *nbd);
 
 #endif /* SPDK_NBD_INTERNAL_H */
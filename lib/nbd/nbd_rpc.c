@@ -44,6 +44,7 @@
 struct rpc_start_nbd_disk {
 	char *bdev_name;
 	char *nbd_device;
+	uint32_t num_connections;
 };
 
 static void
@@ -56,6 +57,7 @@ free_rpc_start_nbd_disk(struct rpc_start_nbd_disk *req)
 static const struct spdk_json_object_decoder rpc_start_nbd_disk_decoders[] = {
 	{"bdev_name", offsetof(struct rpc_start_nbd_disk, bdev_name), spdk_json_decode_string},
 	{"nbd_device", offsetof(struct rpc_start_nbd_disk, nbd_device), spdk_json_decode_string},
+	{"num_connections", offsetof(struct rpc_start_nbd_disk, num_connections), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -85,6 +87,8 @@ spdk_rpc_start_nbd_disk(struct spdk_jsonrpc_request *request,
 	struct rpc_start_nbd_disk req = {};
 	struct spdk_nbd_disk *nbd;
 
+	req.num_connections = 1;
+
 	if (spdk_json_decode_object(params, rpc_start_nbd_disk_decoders,
 				    SPDK_COUNTOF(rpc_start_nbd_disk_decoders),
 				    &req)) {
@@ -96,14 +100,23 @@ spdk_rpc_start_nbd_disk(struct spdk_jsonrpc_request *request,
 		goto invalid;
 	}
 
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+	if (req.num_connections > 1) {
+		SPDK_ERRLOG("num_connections %u requires NBD_FLAG_CAN_MULTI_CONN\n", req.num_connections);
+		free_rpc_start_nbd_disk(&req);
+		spdk_jsonrpc_send_error_response(request, -ENOTSUP, spdk_strerror(ENOTSUP));
+		return;
+	}
+#endif
+
 	/* make sure nbd_device is not registered */
 	nbd = spdk_nbd_disk_find_by_nbd_path(req.nbd_device);
 	if (nbd) {
 		goto invalid;
 	}
 
-	spdk_nbd_start(req.bdev_name, req.nbd_device,
-		       spdk_rpc_start_nbd_done, request);
+	spdk_nbd_start_ext(req.bdev_name, req.nbd_device, req.num_connections,
+			   spdk_rpc_start_nbd_done, request);
 
 	free_rpc_start_nbd_disk(&req);
 	return;
@@ -238,6 +251,8 @@ spdk_rpc_dump_nbd_info(struct spdk_json_write_ctx *w,
 
 	spdk_json_write_named_string(w, "bdev_name", spdk_nbd_disk_get_bdev_name(nbd));
 
+	spdk_json_write_named_uint32(w, "num_connections", spdk_nbd_disk_get_num_connections(nbd));
+
 	spdk_json_write_object_end(w);
 }
 
@@ -51,6 +51,7 @@
 #define NVMF_DISC_KATO_IN_MS 120000
 #define KAS_TIME_UNIT_IN_MS 100
 #define KAS_DEFAULT_VALUE (MIN_KEEP_ALIVE_TIMEOUT_IN_MS / KAS_TIME_UNIT_IN_MS)
+#define ANA_TRANSITION_TIME_IN_SEC 10
 
 #define MODEL_NUMBER "SPDK bdev Controller"
 
@@ -174,7 +175,7 @@ spdk_nvmf_ctrlr_start_keep_alive_timer(struct spdk_nvmf_ctrlr *ctrlr)
 		ctrlr->last_keep_alive_tick = spdk_get_ticks();
 
 		SPDK_DEBUGLOG(SPDK_LOG_NVMF, "Ctrlr add keep alive poller\n");
-		ctrlr->keep_alive_poller = spdk_poller_register(spdk_nvmf_ctrlr_keep_alive_poll, ctrlr,
+		ctrlr->keep_alive_poller = SPDK_POLLER_REGISTER(spdk_nvmf_ctrlr_keep_alive_poll, ctrlr,
 					   ctrlr->feat.keep_alive_timer.bits.kato * 1000);
 	}
 }
@@ -240,6 +241,7 @@ _spdk_nvmf_subsystem_add_ctrlr(void *ctx)
 	struct spdk_nvmf_qpair *qpair = req->qpair;
 	struct spdk_nvmf_fabric_connect_rsp *rsp = &req->rsp->connect_rsp;
 	struct spdk_nvmf_ctrlr *ctrlr = qpair->ctrlr;
+	struct spdk_nvme_transport_id listen_trid;
 
 	if (spdk_nvmf_subsystem_add_ctrlr(ctrlr->subsys, ctrlr)) {
 		SPDK_ERRLOG("Unable to add controller to subsystem\n");
@@ -251,6 +253,10 @@ _spdk_nvmf_subsystem_add_ctrlr(void *ctx)
 		return;
 	}
 
+	if (spdk_nvmf_qpair_get_listen_trid(qpair, &listen_trid) == 0) {
+		ctrlr->listener = spdk_nvmf_subsystem_find_listener(ctrlr->subsys, &listen_trid);
+	}
+
 	spdk_thread_send_msg(ctrlr->thread, _spdk_nvmf_ctrlr_add_admin_qpair, req);
 }
 
@@ -288,6 +294,7 @@ spdk_nvmf_ctrlr_create(struct spdk_nvmf_subsystem *subsystem,
 			KAS_DEFAULT_VALUE * KAS_TIME_UNIT_IN_MS) *
 			KAS_DEFAULT_VALUE * KAS_TIME_UNIT_IN_MS;
 	ctrlr->feat.async_event_configuration.bits.ns_attr_notice = 1;
+	ctrlr->feat.async_event_configuration.bits.ana_change_notice = 1;
 	ctrlr->feat.volatile_write_cache.bits.wce = 1;
 
 	if (ctrlr->subsys->subtype == SPDK_NVMF_SUBTYPE_DISCOVERY) {
@@ -1156,7 +1163,7 @@ spdk_nvmf_ctrlr_set_features_keep_alive_timer(struct spdk_nvmf_request *req)
 		if (ctrlr->keep_alive_poller != NULL) {
 			spdk_poller_unregister(&ctrlr->keep_alive_poller);
 		}
-		ctrlr->keep_alive_poller = spdk_poller_register(spdk_nvmf_ctrlr_keep_alive_poll, ctrlr,
+		ctrlr->keep_alive_poller = SPDK_POLLER_REGISTER(spdk_nvmf_ctrlr_keep_alive_poll, ctrlr,
 					   ctrlr->feat.keep_alive_timer.bits.kato * 1000);
 	}
 
@@ -1228,6 +1235,17 @@ spdk_nvmf_ctrlr_async_event_request(struct spdk_nvmf_request *req)
 		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 	}
 
+	if (ctrlr->ana_change_pending) {
+		union spdk_nvme_async_event_completion event = {0};
+
+		event.bits.async_event_type = SPDK_NVME_ASYNC_EVENT_TYPE_NOTICE;
+		event.bits.async_event_info = SPDK_NVME_ASYNC_EVENT_ANA_CHANGE;
+		event.bits.log_page_identifier = SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS;
+		rsp->cdw0 = event.raw;
+		ctrlr->ana_change_pending = false;
+		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+	}
+
 	ctrlr->aer_req = req;
 	return SPDK_NVMF_REQUEST_EXEC_STATUS_ASYNCHRONOUS;
 }
@@ -1299,6 +1317,60 @@ spdk_nvmf_get_changed_ns_list_log_page(struct spdk_nvmf_ctrlr *ctrlr,
 	memset(&ctrlr->changed_ns_list, 0, sizeof(ctrlr->changed_ns_list));
 }
 
+static int
+spdk_nvmf_get_ana_log_page(struct spdk_nvmf_ctrlr *ctrlr, void *buffer,
+			   uint64_t offset, uint32_t length, bool rgo)
+{
+	struct spdk_nvmf_subsystem *subsystem = ctrlr->subsys;
+	struct spdk_nvmf_ns *ns;
+	struct spdk_nvme_ana_page *ana_hdr;
+	struct spdk_nvme_ana_group_descriptor *ana_desc;
+	uint32_t num_ns = 0;
+	size_t desc_size, log_size;
+	char *log;
+	size_t copy_len;
+
+	for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
+	     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
+		num_ns++;
+	}
+
+	/* Each namespace forms its own ANA group with ANAGRPID equal to its NSID. */
+	desc_size = sizeof(*ana_desc) + (rgo ? 0 : sizeof(uint32_t));
+	log_size = sizeof(*ana_hdr) + num_ns * desc_size;
+
+	log = calloc(1, log_size);
+	if (log == NULL) {
+		SPDK_ERRLOG("Unable to allocate ANA log page\n");
+		return -ENOMEM;
+	}
+
+	ana_hdr = (struct spdk_nvme_ana_page *)log;
+	ana_hdr->num_ana_group_desc = num_ns;
+	ana_hdr->change_count = ctrlr->listener ? ctrlr->listener->ana_change_count : 0;
+
+	ana_desc = (struct spdk_nvme_ana_group_descriptor *)(log + sizeof(*ana_hdr));
+	for (ns = spdk_nvmf_subsystem_get_first_ns(subsystem); ns != NULL;
+	     ns = spdk_nvmf_subsystem_get_next_ns(subsystem, ns)) {
+		ana_desc->ana_group_id = ns->opts.nsid;
+		ana_desc->change_count = ana_hdr->change_count;
+		ana_desc->ana_state = _spdk_nvmf_listener_get_ana_state(ctrlr->listener, ns->opts.nsid);
+		if (!rgo) {
+			ana_desc->num_of_nsid = 1;
+			ana_desc->nsid[0] = ns->opts.nsid;
+		}
+		ana_desc = (struct spdk_nvme_ana_group_descriptor *)((char *)ana_desc + desc_size);
+	}
+
+	if (offset < log_size) {
+		copy_len = spdk_min(log_size - offset, length);
+		memcpy(buffer, log + offset, copy_len);
+	}
+
+	free(log);
+	return 0;
+}
+
 /* The structure can be modified if we provide support for other commands in future */
 static const struct spdk_nvme_cmds_and_effect_log_page g_cmds_and_effect_log_page = {
 	.admin_cmds_supported = {
@@ -1415,6 +1487,16 @@ spdk_nvmf_ctrlr_get_log_page(struct spdk_nvmf_request *req)
 		case SPDK_NVME_LOG_CHANGED_NS_LIST:
 			spdk_nvmf_get_changed_ns_list_log_page(ctrlr, req->data, offset, len);
 			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+		case SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS:
+			if (!subsystem->ana_reporting) {
+				goto invalid_log_page;
+			}
+			if (spdk_nvmf_get_ana_log_page(ctrlr, req->data, offset, len,
+						       ((cmd->cdw10 >> 8) & 0xFu) & SPDK_NVME_ANA_LOG_RGO) != 0) {
+				response->status.sct = SPDK_NVME_SCT_GENERIC;
+				response->status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+			}
+			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 		default:
 			goto invalid_log_page;
 		}
@@ -1459,6 +1541,11 @@ spdk_nvmf_ctrlr_identify_ns(struct spdk_nvmf_ctrlr *ctrlr,
 
 	spdk_nvmf_bdev_ctrlr_identify_ns(ns, nsdata);
 
+	if (subsystem->ana_reporting) {
+		/* Each namespace is a member of its own ANA group. */
+		nsdata->anagrpid = cmd->nsid;
+	}
+
 	/* Due to bug in the Linux kernel NVMe driver we have to set noiob no larger than mdts */
 	max_num_blocks = ctrlr->admin_qpair->transport->opts.max_io_size /
 			 (1U << nsdata->lbaf[nsdata->flbas.format].lbads);
@@ -1527,6 +1614,23 @@ spdk_nvmf_ctrlr_identify_ctrlr(struct spdk_nvmf_ctrlr *ctrlr, struct spdk_nvme_c
 		cdata->nvmf_specific.ctrattr.ctrlr_model = SPDK_NVMF_CTRLR_MODEL_DYNAMIC;
 		cdata->nvmf_specific.msdbd = 1; /* target supports single SGL in capsule */
 
+		if (subsystem->ana_reporting) {
+			cdata->cmic.ana_reporting = 1;
+			cdata->oaes.ana_change_notices = 1;
+			cdata->anatt = ANA_TRANSITION_TIME_IN_SEC;
+			cdata->anacap.bits.ana_optimized_state = 1;
+			cdata->anacap.bits.ana_non_optimized_state = 1;
+			cdata->anacap.bits.ana_inaccessible_state = 1;
+			cdata->anacap.bits.ana_persistent_loss_state = 1;
+			cdata->anacap.bits.ana_change_state = 1;
+			cdata->anacap.bits.no_change_anagrpid = 1;
+			cdata->anacap.bits.non_zero_anagrpid = 1;
+			/* ANA group IDs are equal to NSIDs */
+			cdata->anagrpmax = subsystem->max_nsid;
+			cdata->nanagrpid = subsystem->max_nsid;
+			cdata->mnan = subsystem->max_nsid;
+		}
+
 		/* TODO: this should be set by the transport */
 		cdata->nvmf_specific.ioccsz += transport->opts.in_capsule_data_size / 16;
 
@@ -2049,6 +2153,41 @@ spdk_nvmf_ctrlr_async_event_ns_notice(struct spdk_nvmf_ctrlr *ctrlr)
 	return 0;
 }
 
+int
+spdk_nvmf_ctrlr_async_event_ana_change_notice(struct spdk_nvmf_ctrlr *ctrlr)
+{
+	struct spdk_nvmf_request *req;
+	struct spdk_nvme_cpl *rsp;
+	union spdk_nvme_async_event_completion event = {0};
+
+	/* Users may disable the event notification */
+	if (!ctrlr->feat.async_event_configuration.bits.ana_change_notice) {
+		return 0;
+	}
+
+	event.bits.async_event_type = SPDK_NVME_ASYNC_EVENT_TYPE_NOTICE;
+	event.bits.async_event_info = SPDK_NVME_ASYNC_EVENT_ANA_CHANGE;
+	event.bits.log_page_identifier = SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS;
+
+	/* If there is no outstanding AER request, remember the change so that
+	 * the next AER can be completed with it right away.
+	 */
+	if (!ctrlr->aer_req) {
+		ctrlr->ana_change_pending = true;
+		return 0;
+	}
+
+	req = ctrlr->aer_req;
+	rsp = &req->rsp->nvme_cpl;
+
+	rsp->cdw0 = event.raw;
+
+	spdk_nvmf_request_complete(req);
+	ctrlr->aer_req = NULL;
+
+	return 0;
+}
+
 void
 spdk_nvmf_qpair_free_aer(struct spdk_nvmf_qpair *qpair)
 {
@@ -2114,6 +2253,25 @@ spdk_nvmf_ctrlr_process_io_cmd(struct spdk_nvmf_request *req)
 		return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
 	}
 
+	if (spdk_unlikely(ctrlr->subsys->ana_reporting)) {
+		switch (_spdk_nvmf_listener_get_ana_state(ctrlr->listener, nsid)) {
+		case SPDK_NVME_ANA_INACCESSIBLE_STATE:
+			response->status.sct = SPDK_NVME_SCT_PATH;
+			response->status.sc = SPDK_NVME_SC_ASYMMETRIC_ACCESS_INACCESSIBLE;
+			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+		case SPDK_NVME_ANA_PERSISTENT_LOSS_STATE:
+			response->status.sct = SPDK_NVME_SCT_PATH;
+			response->status.sc = SPDK_NVME_SC_ASYMMETRIC_ACCESS_PERSISTENT_LOSS;
+			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+		case SPDK_NVME_ANA_CHANGE_STATE:
+			response->status.sct = SPDK_NVME_SCT_PATH;
+			response->status.sc = SPDK_NVME_SC_ASYMMETRIC_ACCESS_TRANSITION;
+			return SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE;
+		default:
+			break;
+		}
+	}
+
 	bdev = ns->bdev;
 	desc = ns->desc;
 	ch = group->sgroups[ctrlr->subsys->id].channels[nsid - 1];
@@ -140,7 +140,7 @@ spdk_nvmf_tgt_create_poll_group(void *io_device, void *ctx_buf)
 		}
 	}
 
-	group->poller = spdk_poller_register(spdk_nvmf_poll_group_poll, group, 0);
+	group->poller = SPDK_POLLER_REGISTER(spdk_nvmf_poll_group_poll, group, 0);
 	group->thread = spdk_get_thread();
 
 	return 0;
@@ -300,6 +300,92 @@ spdk_nvmf_tgt_destroy(struct spdk_nvmf_tgt *tgt,
 	spdk_io_device_unregister(tgt, spdk_nvmf_tgt_destroy_cb);
 }
 
+static const char *const g_nvmf_ana_state_names[] = {
+	[SPDK_NVME_ANA_OPTIMIZED_STATE]		= "optimized",
+	[SPDK_NVME_ANA_NON_OPTIMIZED_STATE]	= "non_optimized",
+	[SPDK_NVME_ANA_INACCESSIBLE_STATE]	= "inaccessible",
+	[SPDK_NVME_ANA_PERSISTENT_LOSS_STATE]	= "persistent_loss",
+	[SPDK_NVME_ANA_CHANGE_STATE]		= "change",
+};
+
+const char *
+spdk_nvmf_ana_state_str(enum spdk_nvme_ana_state ana_state)
+{
+	if ((size_t)ana_state >= SPDK_COUNTOF(g_nvmf_ana_state_names)) {
+		return NULL;
+	}
+
+	return g_nvmf_ana_state_names[ana_state];
+}
+
+int
+spdk_nvmf_ana_state_parse(enum spdk_nvme_ana_state *ana_state, const char *str)
+{
+	size_t i;
+
+	if (ana_state == NULL || str == NULL) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(g_nvmf_ana_state_names); i++) {
+		if (g_nvmf_ana_state_names[i] != NULL && strcmp(str, g_nvmf_ana_state_names[i]) == 0) {
+			*ana_state = (enum spdk_nvme_ana_state)i;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static void
+spdk_nvmf_write_listener_ana_state_config_json(struct spdk_json_write_ctx *w,
+		struct spdk_nvmf_subsystem *subsystem,
+		struct spdk_nvmf_listener *listener)
+{
+	const struct spdk_nvme_transport_id *trid;
+	const char *adrfam;
+	uint32_t i;
+
+	trid = spdk_nvmf_listener_get_trid(listener);
+	adrfam = spdk_nvme_transport_id_adrfam_str(trid->adrfam);
+
+	for (i = 0; i < listener->ana_state_count; i++) {
+		if (listener->ana_state[i] == SPDK_NVME_ANA_OPTIMIZED_STATE) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "nvmf_subsystem_listener_set_ana_state");
+
+		/*     "params" : { */
+		spdk_json_write_named_object_begin(w, "params");
+
+		spdk_json_write_named_string(w, "nqn", spdk_nvmf_subsystem_get_nqn(subsystem));
+
+		/*     "listen_address" : { */
+		spdk_json_write_named_object_begin(w, "listen_address");
+
+		spdk_json_write_named_string(w, "trtype", spdk_nvme_transport_id_trtype_str(trid->trtype));
+		if (adrfam) {
+			spdk_json_write_named_string(w, "adrfam", adrfam);
+		}
+
+		spdk_json_write_named_string(w, "traddr", trid->traddr);
+		spdk_json_write_named_string(w, "trsvcid", trid->trsvcid);
+		/*     } "listen_address" */
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_named_string(w, "ana_state", spdk_nvmf_ana_state_str(listener->ana_state[i]));
+		spdk_json_write_named_uint32(w, "anagrpid", i + 1);
+
+		/*     } "params" */
+		spdk_json_write_object_end(w);
+
+		/* } */
+		spdk_json_write_object_end(w);
+	}
+}
+
 static void
 spdk_nvmf_write_subsystem_config_json(struct spdk_json_write_ctx *w,
 				      struct spdk_nvmf_subsystem *subsystem)
@@ -327,6 +413,9 @@ spdk_nvmf_write_subsystem_config_json(struct spdk_json_write_ctx *w,
 	spdk_json_write_named_string(w, "nqn", spdk_nvmf_subsystem_get_nqn(subsystem));
 	spdk_json_write_named_bool(w, "allow_any_host", spdk_nvmf_subsystem_get_allow_any_host(subsystem));
 	spdk_json_write_named_string(w, "serial_number", spdk_nvmf_subsystem_get_sn(subsystem));
+	if (spdk_nvmf_subsystem_get_ana_reporting(subsystem)) {
+		spdk_json_write_named_bool(w, "ana_reporting", true);
+	}
 
 	max_namespaces = spdk_nvmf_subsystem_get_max_namespaces(subsystem);
 	if (max_namespaces != 0) {
@@ -436,6 +525,14 @@ spdk_nvmf_write_subsystem_config_json(struct spdk_json_write_ctx *w,
 		/* } */
 		spdk_json_write_object_end(w);
 	}
+
+	/* ANA group IDs are NSIDs, so ANA states can only be restored once namespaces exist. */
+	if (spdk_nvmf_subsystem_get_ana_reporting(subsystem)) {
+		for (listener = spdk_nvmf_subsystem_get_first_listener(subsystem); listener != NULL;
+		     listener = spdk_nvmf_subsystem_get_next_listener(subsystem, listener)) {
+			spdk_nvmf_write_listener_ana_state_config_json(w, subsystem, listener);
+		}
+	}
 }
 
 void
@@ -97,6 +97,14 @@ struct spdk_nvmf_host {
 struct spdk_nvmf_listener {
 	struct spdk_nvme_transport_id	trid;
 	struct spdk_nvmf_transport	*transport;
+
+	/* ANA state of each ANA group indexed by anagrpid - 1.
+	 * Groups beyond ana_state_count are optimized.
+	 */
+	enum spdk_nvme_ana_state	*ana_state;
+	uint32_t			ana_state_count;
+	uint64_t			ana_change_count;
+
 	TAILQ_ENTRY(spdk_nvmf_listener)	link;
 };
 
@@ -247,8 +255,12 @@ struct spdk_nvmf_ctrlr {
 	struct spdk_thread	*thread;
 	struct spdk_bit_array	*qpair_mask;
 
+	/* Listen address the admin queue connected through */
+	struct spdk_nvmf_listener *listener;
+
 	struct spdk_nvmf_request *aer_req;
 	union spdk_nvme_async_event_completion notice_event;
+	bool ana_change_pending;
 	struct spdk_uuid  hostid;
 
 	uint16_t changed_ns_list_count;
@@ -270,6 +282,7 @@ struct spdk_nvmf_subsystem {
 	enum spdk_nvmf_subtype subtype;
 	uint16_t next_cntlid;
 	bool allow_any_host;
+	bool ana_reporting;
 
 	struct spdk_nvmf_tgt			*tgt;
 
@@ -344,6 +357,9 @@ void spdk_nvmf_subsystem_remove_ctrlr(struct spdk_nvmf_subsystem *subsystem,
 struct spdk_nvmf_ctrlr *spdk_nvmf_subsystem_get_ctrlr(struct spdk_nvmf_subsystem *subsystem,
 		uint16_t cntlid);
 int spdk_nvmf_ctrlr_async_event_ns_notice(struct spdk_nvmf_ctrlr *ctrlr);
+int spdk_nvmf_ctrlr_async_event_ana_change_notice(struct spdk_nvmf_ctrlr *ctrlr);
+struct spdk_nvmf_listener *spdk_nvmf_subsystem_find_listener(struct spdk_nvmf_subsystem *subsystem,
+		const struct spdk_nvme_transport_id *trid);
 void spdk_nvmf_ns_reservation_request(void *ctx);
 
 /*
@@ -372,6 +388,16 @@ _spdk_nvmf_subsystem_get_ns(struct spdk_nvmf_subsystem *subsystem, uint32_t nsid
 	return subsystem->ns[nsid - 1];
 }
 
+static inline enum spdk_nvme_ana_state
+_spdk_nvmf_listener_get_ana_state(struct spdk_nvmf_listener *listener, uint32_t anagrpid)
+{
+	if (listener == NULL || anagrpid - 1 >= listener->ana_state_count) {
+		return SPDK_NVME_ANA_OPTIMIZED_STATE;
+	}
+
+	return listener->ana_state[anagrpid - 1];
+}
+
 static inline bool
 spdk_nvmf_qpair_is_admin_queue(struct spdk_nvmf_qpair *qpair)
 {
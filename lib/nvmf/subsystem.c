@@ -313,13 +313,21 @@ _nvmf_subsystem_remove_listener(struct spdk_nvmf_subsystem *subsystem,
 				struct spdk_nvmf_listener *listener)
 {
 	struct spdk_nvmf_transport *transport;
+	struct spdk_nvmf_ctrlr *ctrlr;
 
 	transport = spdk_nvmf_tgt_get_transport(subsystem->tgt, listener->trid.trtype);
 	if (transport != NULL) {
 		spdk_nvmf_transport_stop_listen(transport, &listener->trid);
 	}
 
+	TAILQ_FOREACH(ctrlr, &subsystem->ctrlrs, link) {
+		if (ctrlr->listener == listener) {
+			ctrlr->listener = NULL;
+		}
+	}
+
 	TAILQ_REMOVE(&subsystem->listeners, listener, link);
+	free(listener->ana_state);
 	free(listener);
 }
 
@@ -726,9 +734,9 @@ spdk_nvmf_host_get_nqn(struct spdk_nvmf_host *host)
 	return host->nqn;
 }
 
-static struct spdk_nvmf_listener *
-_spdk_nvmf_subsystem_find_listener(struct spdk_nvmf_subsystem *subsystem,
-				   const struct spdk_nvme_transport_id *trid)
+struct spdk_nvmf_listener *
+spdk_nvmf_subsystem_find_listener(struct spdk_nvmf_subsystem *subsystem,
+				  const struct spdk_nvme_transport_id *trid)
 {
 	struct spdk_nvmf_listener *listener;
 
@@ -753,7 +761,7 @@ spdk_nvmf_subsystem_add_listener(struct spdk_nvmf_subsystem *subsystem,
 		return -EAGAIN;
 	}
 
-	if (_spdk_nvmf_subsystem_find_listener(subsystem, trid)) {
+	if (spdk_nvmf_subsystem_find_listener(subsystem, trid)) {
 		/* Listener already exists in this subsystem */
 		return 0;
 	}
@@ -788,7 +796,7 @@ spdk_nvmf_subsystem_remove_listener(struct spdk_nvmf_subsystem *subsystem,
 		return -EAGAIN;
 	}
 
-	listener = _spdk_nvmf_subsystem_find_listener(subsystem, trid);
+	listener = spdk_nvmf_subsystem_find_listener(subsystem, trid);
 	if (listener == NULL) {
 		return -ENOENT;
 	}
@@ -836,6 +844,115 @@ spdk_nvmf_listener_get_trid(struct spdk_nvmf_listener *listener)
 	return &listener->trid;
 }
 
+int
+spdk_nvmf_subsystem_set_ana_reporting(struct spdk_nvmf_subsystem *subsystem, bool ana_reporting)
+{
+	if (subsystem->state != SPDK_NVMF_SUBSYSTEM_INACTIVE) {
+		return -EAGAIN;
+	}
+
+	subsystem->ana_reporting = ana_reporting;
+
+	return 0;
+}
+
+bool
+spdk_nvmf_subsystem_get_ana_reporting(const struct spdk_nvmf_subsystem *subsystem)
+{
+	return subsystem->ana_reporting;
+}
+
+enum spdk_nvme_ana_state
+spdk_nvmf_listener_get_ana_state(struct spdk_nvmf_listener *listener, uint32_t anagrpid)
+{
+	return _spdk_nvmf_listener_get_ana_state(listener, anagrpid);
+}
+
+static bool
+spdk_nvmf_ana_state_is_valid(enum spdk_nvme_ana_state ana_state)
+{
+	switch (ana_state) {
+	case SPDK_NVME_ANA_OPTIMIZED_STATE:
+	case SPDK_NVME_ANA_NON_OPTIMIZED_STATE:
+	case SPDK_NVME_ANA_INACCESSIBLE_STATE:
+	case SPDK_NVME_ANA_PERSISTENT_LOSS_STATE:
+	case SPDK_NVME_ANA_CHANGE_STATE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+int
+spdk_nvmf_subsystem_set_ana_state(struct spdk_nvmf_subsystem *subsystem,
+				  const struct spdk_nvme_transport_id *trid,
+				  enum spdk_nvme_ana_state ana_state,
+				  uint32_t anagrpid)
+{
+	struct spdk_nvmf_listener *listener;
+	struct spdk_nvmf_ctrlr *ctrlr;
+	enum spdk_nvme_ana_state *new_ana_state;
+	uint32_t count, i;
+
+	if (!(subsystem->state == SPDK_NVMF_SUBSYSTEM_INACTIVE ||
+	      subsystem->state == SPDK_NVMF_SUBSYSTEM_PAUSED)) {
+		return -EAGAIN;
+	}
+
+	if (!subsystem->ana_reporting) {
+		SPDK_ERRLOG("ANA reporting is disabled for subsystem %s\n", subsystem->subnqn);
+		return -EINVAL;
+	}
+
+	if (!spdk_nvmf_ana_state_is_valid(ana_state)) {
+		SPDK_ERRLOG("Invalid ANA state 0x%x\n", ana_state);
+		return -EINVAL;
+	}
+
+	if (anagrpid > subsystem->max_nsid) {
+		SPDK_ERRLOG("Invalid ANA group ID %u\n", anagrpid);
+		return -EINVAL;
+	}
+
+	listener = spdk_nvmf_subsystem_find_listener(subsystem, trid);
+	if (listener == NULL) {
+		return -ENOENT;
+	}
+
+	count = anagrpid == 0 ? subsystem->max_nsid : anagrpid;
+	if (count > listener->ana_state_count) {
+		new_ana_state = realloc(listener->ana_state, sizeof(*new_ana_state) * count);
+		if (new_ana_state == NULL) {
+			return -ENOMEM;
+		}
+
+		for (i = listener->ana_state_count; i < count; i++) {
+			new_ana_state[i] = SPDK_NVME_ANA_OPTIMIZED_STATE;
+		}
+
+		listener->ana_state = new_ana_state;
+		listener->ana_state_count = count;
+	}
+
+	if (anagrpid == 0) {
+		for (i = 0; i < listener->ana_state_count; i++) {
+			listener->ana_state[i] = ana_state;
+		}
+	} else {
+		listener->ana_state[anagrpid - 1] = ana_state;
+	}
+
+	listener->ana_change_count++;
+
+	TAILQ_FOREACH(ctrlr, &subsystem->ctrlrs, link) {
+		if (ctrlr->listener == listener) {
+			spdk_nvmf_ctrlr_async_event_ana_change_notice(ctrlr);
+		}
+	}
+
+	return 0;
+}
+
 struct subsystem_update_ns_ctx {
 	struct spdk_nvmf_subsystem *subsystem;
 
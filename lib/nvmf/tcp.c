@@ -38,6 +38,7 @@
 #include "spdk/thread.h"
 #include "spdk/nvmf.h"
 #include "spdk/nvmf_spec.h"
+#include "spdk/slab.h"
 #include "spdk/sock.h"
 #include "spdk/string.h"
 #include "spdk/trace.h"
@@ -55,6 +56,8 @@
 #define NVMF_TCP_PDU_MAX_C2H_DATA_SIZE	131072
 #define NVMF_TCP_QPAIR_MAX_C2H_PDU_NUM  64  /* Maximal c2h_data pdu number for ecah tqpair */
 
+#define NVMF_TCP_REQ_CACHE_SIZE		256
+
 /* This is used to support the Linux kernel NVMe-oF initiator */
 #define LINUX_KERNEL_SUPPORT_NOT_SENDING_RESP_FOR_C2H 0
 
@@ -231,13 +234,14 @@ struct spdk_nvmf_tcp_qpair {
 
 	uint8_t					cpda;
 
-	/* Array of size "max_queue_depth * InCapsuleDataSize" containing
-	 * buffers to be used for in capsule data.
+	/* Buffer for the in capsule data of the request used before the
+	 * queue depth is known. Requests of the full queue depth and their
+	 * in capsule data buffers are allocated from the transport's slabs.
 	 */
 	void					*buf;
-	void					*bufs;
 	struct spdk_nvmf_tcp_req		*req;
-	struct spdk_nvmf_tcp_req		*reqs;
+	struct spdk_nvmf_tcp_req		**reqs;
+	uint16_t				num_reqs;
 
 	bool					host_hdgst_enable;
 	bool					host_ddgst_enable;
@@ -276,6 +280,9 @@ struct spdk_nvmf_tcp_poll_group {
 	TAILQ_HEAD(, spdk_nvmf_tcp_req)		pending_data_buf_queue;
 
 	TAILQ_HEAD(, spdk_nvmf_tcp_qpair)	qpairs;
+
+	struct spdk_slab_cache			*req_cache;
+	struct spdk_slab_cache			*buf_cache;
 };
 
 struct spdk_nvmf_tcp_port {
@@ -290,6 +297,10 @@ struct spdk_nvmf_tcp_transport {
 
 	pthread_mutex_t				lock;
 
+	/* Requests and their in capsule data buffers, shared by all queue pairs. */
+	struct spdk_slab			*req_slab;
+	struct spdk_slab			*buf_slab;
+
 	TAILQ_HEAD(, spdk_nvmf_tcp_port)	ports;
 };
 
@@ -467,6 +478,36 @@ nvmf_tcp_dump_qpair_req_contents(struct spdk_nvmf_tcp_qpair *tqpair)
 	}
 }
 
+static void
+spdk_nvmf_tcp_qpair_free_reqs(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	struct spdk_nvmf_tcp_transport *ttransport;
+	struct spdk_nvmf_tcp_req *tcp_req;
+	uint16_t i;
+
+	if (!tqpair->reqs) {
+		return;
+	}
+
+	ttransport = SPDK_CONTAINEROF(tqpair->qpair.transport, struct spdk_nvmf_tcp_transport, transport);
+
+	/*
+	 * The queue pair may be destroyed outside of its poll group, so return the
+	 *  requests directly to the slabs instead of to the poll group's caches.
+	 */
+	for (i = 0; i < tqpair->num_reqs; i++) {
+		tcp_req = tqpair->reqs[i];
+		if (tcp_req->buf) {
+			spdk_slab_put(ttransport->buf_slab, NULL, tcp_req->buf);
+		}
+		spdk_slab_put(ttransport->req_slab, NULL, tcp_req);
+	}
+
+	free(tqpair->reqs);
+	tqpair->reqs = NULL;
+	tqpair->num_reqs = 0;
+}
+
 static void
 spdk_nvmf_tcp_qpair_destroy(struct spdk_nvmf_tcp_qpair *tqpair)
 {
@@ -501,12 +542,11 @@ spdk_nvmf_tcp_qpair_destroy(struct spdk_nvmf_tcp_qpair *tqpair)
 	if (err > 0) {
 		nvmf_tcp_dump_qpair_req_contents(tqpair);
 	}
+	spdk_nvmf_tcp_qpair_free_reqs(tqpair);
 	free(tqpair->pdu);
 	free(tqpair->pdu_pool);
 	free(tqpair->req);
-	free(tqpair->reqs);
 	spdk_dma_free(tqpair->buf);
-	spdk_dma_free(tqpair->bufs);
 	free(tqpair);
 	SPDK_DEBUGLOG(SPDK_LOG_NVMF_TCP, "Leave\n");
 }
@@ -519,6 +559,8 @@ spdk_nvmf_tcp_destroy(struct spdk_nvmf_transport *transport)
 	assert(transport != NULL);
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 
+	spdk_slab_free(ttransport->req_slab);
+	spdk_slab_free(ttransport->buf_slab);
 	pthread_mutex_destroy(&ttransport->lock);
 	free(ttransport);
 	return 0;
@@ -546,14 +588,15 @@ spdk_nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     "  Transport opts:  max_ioq_depth=%d, max_io_size=%d,\n"
 		     "  max_qpairs_per_ctrlr=%d, io_unit_size=%d,\n"
 		     "  in_capsule_data_size=%d, max_aq_depth=%d\n"
-		     "  num_shared_buffers=%d\n",
+		     "  num_shared_buffers=%d, max_reqs=%d\n",
 		     opts->max_queue_depth,
 		     opts->max_io_size,
 		     opts->max_qpairs_per_ctrlr,
 		     opts->io_unit_size,
 		     opts->in_capsule_data_size,
 		     opts->max_aq_depth,
-		     opts->num_shared_buffers);
+		     opts->num_shared_buffers,
+		     opts->max_reqs);
 
 	/* I/O unit size cannot be larger than max I/O size */
 	if (opts->io_unit_size > opts->max_io_size) {
@@ -577,6 +620,32 @@ spdk_nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		return NULL;
 	}
 
+	if (opts->max_reqs < opts->max_queue_depth) {
+		SPDK_ERRLOG("max_reqs (%" PRIu32 ") must be at least max_queue_depth (%" PRIu16 ")\n",
+			    opts->max_reqs, opts->max_queue_depth);
+		spdk_nvmf_tcp_destroy(&ttransport->transport);
+		return NULL;
+	}
+
+	ttransport->req_slab = spdk_slab_create("nvmf_tcp_req", sizeof(struct spdk_nvmf_tcp_req),
+						opts->max_reqs);
+	if (!ttransport->req_slab) {
+		SPDK_ERRLOG("Unable to allocate tcp_req slab\n");
+		free(ttransport);
+		return NULL;
+	}
+
+	if (opts->in_capsule_data_size) {
+		ttransport->buf_slab = spdk_slab_create("nvmf_tcp_icd", opts->in_capsule_data_size,
+							opts->max_reqs);
+		if (!ttransport->buf_slab) {
+			SPDK_ERRLOG("Unable to allocate in capsule data buffer slab\n");
+			spdk_slab_free(ttransport->req_slab);
+			free(ttransport);
+			return NULL;
+		}
+	}
+
 	pthread_mutex_init(&ttransport->lock, NULL);
 
 	return &ttransport->transport;
@@ -862,7 +931,7 @@ spdk_nvmf_tcp_qpair_flush_pdus(void *_tqpair)
 		if (rc == 0 && tqpair->flush_poller != NULL) {
 			spdk_poller_unregister(&tqpair->flush_poller);
 		} else if (rc == 1 && tqpair->flush_poller == NULL) {
-			tqpair->flush_poller = spdk_poller_register(spdk_nvmf_tcp_qpair_flush_pdus,
+			tqpair->flush_poller = SPDK_POLLER_REGISTER(spdk_nvmf_tcp_qpair_flush_pdus,
 					       tqpair, 50);
 		}
 	} else {
@@ -983,26 +1052,28 @@ spdk_nvmf_tcp_qpair_init_mem_resource(struct spdk_nvmf_tcp_qpair *tqpair, uint16
 			return -1;
 		}
 
-		if (transport->opts.in_capsule_data_size) {
-			tqpair->bufs = spdk_dma_zmalloc(size * transport->opts.in_capsule_data_size,
-							0x1000, NULL);
-			if (!tqpair->bufs) {
-				SPDK_ERRLOG("Unable to allocate bufs on tqpair=%p.\n", tqpair);
+		for (i = 0; i < size; i++) {
+			tcp_req = spdk_slab_get(ttransport->req_slab, tqpair->group->req_cache);
+			if (!tcp_req) {
+				SPDK_ERRLOG("Unable to allocate reqs on tqpair=%p\n", tqpair);
 				return -1;
 			}
-		}
 
-		for (i = 0; i < size; i++) {
-			struct spdk_nvmf_tcp_req *tcp_req = &tqpair->reqs[i];
-
-			tcp_req->ttag = i + 1;
-			tcp_req->req.qpair = &tqpair->qpair;
+			memset(tcp_req, 0, sizeof(*tcp_req));
+			tqpair->reqs[tqpair->num_reqs++] = tcp_req;
 
 			/* Set up memory to receive commands */
-			if (tqpair->bufs) {
-				tcp_req->buf = (void *)((uintptr_t)tqpair->bufs + (i * transport->opts.in_capsule_data_size));
+			if (ttransport->buf_slab) {
+				tcp_req->buf = spdk_slab_get(ttransport->buf_slab, tqpair->group->buf_cache);
+				if (!tcp_req->buf) {
+					SPDK_ERRLOG("Unable to allocate bufs on tqpair=%p.\n", tqpair);
+					return -1;
+				}
 			}
 
+			tcp_req->ttag = i + 1;
+			tcp_req->req.qpair = &tqpair->qpair;
+
 			/* Set the cmdn and rsp */
 			tcp_req->req.rsp = (union nvmf_c2h_msg *)&tcp_req->rsp;
 			tcp_req->req.cmd = (union nvmf_h2c_msg *)&tcp_req->cmd;
@@ -1167,7 +1238,11 @@ spdk_nvmf_tcp_discover(struct spdk_nvmf_transport *transport,
 static struct spdk_nvmf_transport_poll_group *
 spdk_nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport)
 {
+	struct spdk_nvmf_tcp_transport *ttransport;
 	struct spdk_nvmf_tcp_poll_group *tgroup;
+	int socket_id;
+
+	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 
 	tgroup = calloc(1, sizeof(*tgroup));
 	if (!tgroup) {
@@ -1179,12 +1254,30 @@ spdk_nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport)
 		goto cleanup;
 	}
 
+	/* Requests of the queue pairs of this poll group are allocated on its socket. */
+	socket_id = spdk_env_get_socket_id(spdk_env_get_current_core());
+	tgroup->req_cache = spdk_slab_cache_create(ttransport->req_slab, NVMF_TCP_REQ_CACHE_SIZE,
+			    socket_id);
+	if (!tgroup->req_cache) {
+		goto cleanup;
+	}
+
+	if (ttransport->buf_slab) {
+		tgroup->buf_cache = spdk_slab_cache_create(ttransport->buf_slab,
+				    NVMF_TCP_REQ_CACHE_SIZE, socket_id);
+		if (!tgroup->buf_cache) {
+			goto cleanup;
+		}
+	}
+
 	TAILQ_INIT(&tgroup->qpairs);
 	TAILQ_INIT(&tgroup->pending_data_buf_queue);
 
 	return &tgroup->group;
 
 cleanup:
+	spdk_slab_cache_free(tgroup->req_cache);
+	spdk_sock_group_close(&tgroup->sock_group);
 	free(tgroup);
 	return NULL;
 }
@@ -1201,6 +1294,8 @@ spdk_nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 		SPDK_ERRLOG("Pending I/O list wasn't empty on poll group destruction\n");
 	}
 
+	spdk_slab_cache_free(tgroup->req_cache);
+	spdk_slab_cache_free(tgroup->buf_cache);
 	free(tgroup);
 }
 
@@ -1256,7 +1351,7 @@ spdk_nvmf_tcp_send_c2h_term_req_complete(void *cb_arg)
 	struct spdk_nvmf_tcp_qpair *tqpair = (struct spdk_nvmf_tcp_qpair *)cb_arg;
 
 	if (!tqpair->timeout_poller) {
-		tqpair->timeout_poller = spdk_poller_register(spdk_nvmf_tcp_qpair_handle_timeout, tqpair,
+		tqpair->timeout_poller = SPDK_POLLER_REGISTER(spdk_nvmf_tcp_qpair_handle_timeout, tqpair,
 					 SPDK_NVME_TCP_QPAIR_EXIT_TIMEOUT * 1000000);
 	}
 }
@@ -2804,6 +2899,8 @@ spdk_nvmf_tcp_qpair_set_sq_size(struct spdk_nvmf_qpair *qpair)
 #define SPDK_NVMF_TCP_DEFAULT_IO_UNIT_SIZE 131072
 #define SPDK_NVMF_TCP_DEFAULT_NUM_SHARED_BUFFERS 512
 #define SPDK_NVMF_TCP_DEFAULT_BUFFER_CACHE_SIZE 32
+/* Upper bound of requests of all tqpairs - memory is only allocated as tqpairs connect */
+#define SPDK_NVMF_TCP_DEFAULT_MAX_REQS (256 * 1024)
 
 static void
 spdk_nvmf_tcp_opts_init(struct spdk_nvmf_transport_opts *opts)
@@ -2816,6 +2913,7 @@ spdk_nvmf_tcp_opts_init(struct spdk_nvmf_transport_opts *opts)
 	opts->max_aq_depth =		SPDK_NVMF_TCP_DEFAULT_AQ_DEPTH;
 	opts->num_shared_buffers =	SPDK_NVMF_TCP_DEFAULT_NUM_SHARED_BUFFERS;
 	opts->buf_cache_size =		SPDK_NVMF_TCP_DEFAULT_BUFFER_CACHE_SIZE;
+	opts->max_reqs =		SPDK_NVMF_TCP_DEFAULT_MAX_REQS;
 }
 
 const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
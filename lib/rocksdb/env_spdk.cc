@@ -32,9 +32,11 @@
  */
 
 #include "rocksdb/env.h"
+#include "rocksdb/version.h"
 #include <set>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 extern "C" {
 #include "spdk/env.h"
@@ -170,6 +172,10 @@ public:
 	virtual ~SpdkRandomAccessFile();
 
 	virtual Status Read(uint64_t offset, size_t n, Slice *result, char *scratch) const override;
+	virtual Status Prefetch(uint64_t offset, size_t n) override;
+#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+	virtual Status MultiRead(ReadRequest *reqs, size_t num_reqs) override;
+#endif
 	virtual Status InvalidateCache(size_t offset, size_t length) override;
 };
 
@@ -193,6 +199,47 @@ SpdkRandomAccessFile::Read(uint64_t offset, size_t n, Slice *result, char *scrat
 	}
 }
 
+Status
+SpdkRandomAccessFile::Prefetch(uint64_t offset, size_t n)
+{
+	int rc;
+
+	rc = spdk_file_prefetch(mFile, offset, n);
+	if (rc < 0) {
+		errno = -rc;
+		return Status::IOError(spdk_file_get_name(mFile), strerror(errno));
+	}
+	return Status::OK();
+}
+
+#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 4)
+Status
+SpdkRandomAccessFile::MultiRead(ReadRequest *reqs, size_t num_reqs)
+{
+	std::vector<struct spdk_file_read_req> file_reqs(num_reqs);
+	size_t i;
+
+	for (i = 0; i < num_reqs; i++) {
+		file_reqs[i].payload = reqs[i].scratch;
+		file_reqs[i].offset = reqs[i].offset;
+		file_reqs[i].length = reqs[i].len;
+	}
+
+	spdk_file_read_multi(mFile, g_sync_args.channel, file_reqs.data(), num_reqs);
+
+	for (i = 0; i < num_reqs; i++) {
+		if (file_reqs[i].rc >= 0) {
+			reqs[i].result = Slice(reqs[i].scratch, file_reqs[i].rc);
+			reqs[i].status = Status::OK();
+		} else {
+			reqs[i].status = Status::IOError(spdk_file_get_name(mFile),
+							 strerror(-file_reqs[i].rc));
+		}
+	}
+	return Status::OK();
+}
+#endif
+
 Status
 SpdkRandomAccessFile::InvalidateCache(__attribute__((unused)) size_t offset,
 				      __attribute__((unused)) size_t length)
@@ -586,7 +633,7 @@ void SpdkInitializeThread(void)
 	if (g_fs != NULL) {
 		thread = spdk_thread_create("spdk_rocksdb");
 		spdk_set_thread(thread);
-		g_sync_args.channel = spdk_fs_alloc_io_channel_sync(g_fs);
+		g_sync_args.channel = spdk_fs_alloc_io_channel_sync_polled(g_fs);
 	}
 }
 
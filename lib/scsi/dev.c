@@ -248,20 +248,28 @@ void
 spdk_scsi_dev_queue_mgmt_task(struct spdk_scsi_dev *dev,
 			      struct spdk_scsi_task *task)
 {
+	struct spdk_scsi_lun_channel *ch;
+
 	assert(task != NULL);
 
+	/* The task is completed right away if the LUN has no channel for it. */
+	ch = spdk_scsi_task_get_lun_channel(task);
 	spdk_scsi_lun_append_mgmt_task(task->lun, task);
-	spdk_scsi_lun_execute_mgmt_task(task->lun);
+	spdk_scsi_lun_execute_mgmt_task(ch);
 }
 
 void
 spdk_scsi_dev_queue_task(struct spdk_scsi_dev *dev,
 			 struct spdk_scsi_task *task)
 {
+	struct spdk_scsi_lun_channel *ch;
+
 	assert(task != NULL);
 
+	/* The task is completed right away if the LUN has no channel for it. */
+	ch = spdk_scsi_task_get_lun_channel(task);
 	spdk_scsi_lun_append_task(task->lun, task);
-	spdk_scsi_lun_execute_tasks(task->lun);
+	spdk_scsi_lun_execute_tasks(ch);
 }
 
 static struct spdk_scsi_port *
@@ -40,11 +40,129 @@
 #include "spdk/util.h"
 #include "spdk/likely.h"
 
+/* Get a channel of the LUN on the current thread. Called with lun->mutex held. */
+static struct spdk_scsi_lun_channel *
+_spdk_scsi_lun_get_channel(struct spdk_scsi_lun *lun)
+{
+	struct spdk_scsi_lun_channel *ch;
+	struct spdk_thread *thread = spdk_get_thread();
+
+	TAILQ_FOREACH(ch, &lun->channels, link) {
+		if (ch->thread == thread) {
+			return ch;
+		}
+	}
+
+	return NULL;
+}
+
+struct spdk_io_channel *
+spdk_scsi_lun_get_io_channel(struct spdk_scsi_lun *lun)
+{
+	struct spdk_scsi_lun_channel *ch;
+	struct spdk_io_channel *io_channel = NULL;
+
+	pthread_mutex_lock(&lun->mutex);
+	ch = _spdk_scsi_lun_get_channel(lun);
+	if (ch != NULL) {
+		io_channel = ch->io_channel;
+	}
+	pthread_mutex_unlock(&lun->mutex);
+
+	return io_channel;
+}
+
+struct spdk_scsi_lun_channel *
+spdk_scsi_task_get_lun_channel(struct spdk_scsi_task *task)
+{
+	/* Transports opening the LUN submit through their descriptor. */
+	if (task->desc != NULL) {
+		assert(task->desc->lun == task->lun);
+		return task->desc->ch;
+	}
+
+	return task->lun->dev_ch;
+}
+
+struct spdk_io_channel *
+spdk_scsi_task_get_io_channel(struct spdk_scsi_task *task)
+{
+	struct spdk_scsi_lun_channel *ch = spdk_scsi_task_get_lun_channel(task);
+
+	return ch != NULL ? ch->io_channel : NULL;
+}
+
+static void
+_spdk_scsi_lun_put_channel(struct spdk_scsi_lun_channel *ch)
+{
+	struct spdk_scsi_lun *lun = ch->lun;
+
+	pthread_mutex_lock(&lun->mutex);
+	assert(ch->ref > 0);
+	ch->ref--;
+	if (ch->ref > 0) {
+		pthread_mutex_unlock(&lun->mutex);
+		return;
+	}
+
+	assert(ch->num_tasks == 0);
+	assert(TAILQ_EMPTY(&ch->pending_tasks));
+	assert(TAILQ_EMPTY(&ch->pending_mgmt_tasks));
+	TAILQ_REMOVE(&lun->channels, ch, link);
+	pthread_mutex_unlock(&lun->mutex);
+
+	spdk_put_io_channel(ch->io_channel);
+	free(ch);
+}
+
+static void
+_spdk_scsi_lun_kick_channel(void *arg)
+{
+	struct spdk_scsi_lun_channel *ch = arg;
+	struct spdk_scsi_lun *lun = ch->lun;
+
+	pthread_mutex_lock(&lun->mutex);
+	ch->kicked = false;
+	pthread_mutex_unlock(&lun->mutex);
+
+	spdk_scsi_lun_execute_mgmt_task(ch);
+
+	_spdk_scsi_lun_put_channel(ch);
+}
+
+/*
+ * Tasks are executed on the channel they were received on. When a management
+ *  task completes, let the other channels run the tasks it held back.
+ */
+static void
+_spdk_scsi_lun_kick_channels(struct spdk_scsi_lun *lun, struct spdk_scsi_lun_channel *self)
+{
+	struct spdk_scsi_lun_channel *ch;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_FOREACH(ch, &lun->channels, link) {
+		if (ch == self || ch->kicked) {
+			continue;
+		}
+
+		/* The message holds a reference, so the channel outlives it. */
+		ch->kicked = true;
+		ch->ref++;
+		spdk_thread_send_msg(ch->thread, _spdk_scsi_lun_kick_channel, ch);
+	}
+	pthread_mutex_unlock(&lun->mutex);
+}
+
 void
 spdk_scsi_lun_complete_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task)
 {
+	struct spdk_scsi_lun_channel *ch;
+
 	if (lun) {
-		TAILQ_REMOVE(&lun->tasks, task, scsi_link);
+		ch = spdk_scsi_task_get_lun_channel(task);
+		assert(ch != NULL && ch->num_submitted_tasks > 0);
+		ch->num_submitted_tasks--;
+		ch->num_tasks--;
 		spdk_trace_record(TRACE_SCSI_TASK_DONE, lun->dev->id, 0, (uintptr_t)task, 0);
 	}
 	task->cpl_fn(task);
@@ -53,18 +171,37 @@ spdk_scsi_lun_complete_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *ta
 static void
 spdk_scsi_lun_complete_mgmt_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task)
 {
+	struct spdk_scsi_lun_channel *ch = spdk_scsi_task_get_lun_channel(task);
+
+	pthread_mutex_lock(&lun->mutex);
 	TAILQ_REMOVE(&lun->mgmt_tasks, task, scsi_link);
+	pthread_mutex_unlock(&lun->mutex);
+	__sync_fetch_and_sub(&lun->num_mgmt_tasks, 1);
 
 	task->cpl_fn(task);
 
+	_spdk_scsi_lun_kick_channels(lun, ch);
+
 	/* Try to execute the first pending mgmt task if it exists. */
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(ch);
 }
 
 static bool
 spdk_scsi_lun_has_outstanding_tasks(struct spdk_scsi_lun *lun)
 {
-	return !TAILQ_EMPTY(&lun->tasks);
+	struct spdk_scsi_lun_channel *ch;
+	bool has_tasks = false;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_FOREACH(ch, &lun->channels, link) {
+		if (ch->num_submitted_tasks != 0) {
+			has_tasks = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lun->mutex);
+
+	return has_tasks;
 }
 
 /* Reset task have to wait until all prior outstanding tasks complete. */
@@ -89,7 +226,7 @@ spdk_scsi_lun_complete_reset_task(struct spdk_scsi_lun *lun, struct spdk_scsi_ta
 	if (task->status == SPDK_SCSI_STATUS_GOOD) {
 		if (spdk_scsi_lun_has_outstanding_tasks(lun)) {
 			lun->reset_poller =
-				spdk_poller_register(spdk_scsi_lun_reset_check_outstanding_tasks,
+				SPDK_POLLER_REGISTER(spdk_scsi_lun_reset_check_outstanding_tasks,
 						     task, 10);
 			return;
 		}
@@ -102,8 +239,6 @@ static void
 _spdk_scsi_lun_execute_mgmt_task(struct spdk_scsi_lun *lun,
 				 struct spdk_scsi_task *task)
 {
-	TAILQ_INSERT_TAIL(&lun->mgmt_tasks, task, scsi_link);
-
 	switch (task->function) {
 	case SPDK_SCSI_TASK_FUNC_ABORT_TASK:
 		task->response = SPDK_SCSI_TASK_MGMT_RESP_REJECT_FUNC_NOT_SUPPORTED;
@@ -137,37 +272,59 @@ void
 spdk_scsi_lun_append_mgmt_task(struct spdk_scsi_lun *lun,
 			       struct spdk_scsi_task *task)
 {
-	TAILQ_INSERT_TAIL(&lun->pending_mgmt_tasks, task, scsi_link);
+	struct spdk_scsi_lun_channel *ch = spdk_scsi_task_get_lun_channel(task);
+
+	if (spdk_likely(ch != NULL)) {
+		__sync_fetch_and_add(&lun->num_mgmt_tasks, 1);
+		TAILQ_INSERT_TAIL(&ch->pending_mgmt_tasks, task, scsi_link);
+		return;
+	}
+
+	SPDK_ERRLOG("LUN %s has no I/O channel on this thread\n", spdk_bdev_get_name(lun->bdev));
+	task->response = SPDK_SCSI_TASK_MGMT_RESP_INVALID_LUN;
+	task->cpl_fn(task);
 }
 
 void
-spdk_scsi_lun_execute_mgmt_task(struct spdk_scsi_lun *lun)
+spdk_scsi_lun_execute_mgmt_task(struct spdk_scsi_lun_channel *ch)
 {
+	struct spdk_scsi_lun *lun;
 	struct spdk_scsi_task *task;
 
-	if (!TAILQ_EMPTY(&lun->mgmt_tasks)) {
+	if (ch == NULL) {
 		return;
 	}
 
-	task = TAILQ_FIRST(&lun->pending_mgmt_tasks);
+	lun = ch->lun;
+	task = TAILQ_FIRST(&ch->pending_mgmt_tasks);
 	if (spdk_likely(task == NULL)) {
 		/* Try to execute all pending tasks */
-		spdk_scsi_lun_execute_tasks(lun);
+		spdk_scsi_lun_execute_tasks(ch);
+		return;
+	}
+
+	/* Management tasks of all channels are executed one at a time. */
+	pthread_mutex_lock(&lun->mutex);
+	if (!TAILQ_EMPTY(&lun->mgmt_tasks)) {
+		pthread_mutex_unlock(&lun->mutex);
 		return;
 	}
-	TAILQ_REMOVE(&lun->pending_mgmt_tasks, task, scsi_link);
+	TAILQ_REMOVE(&ch->pending_mgmt_tasks, task, scsi_link);
+	TAILQ_INSERT_TAIL(&lun->mgmt_tasks, task, scsi_link);
+	pthread_mutex_unlock(&lun->mutex);
 
 	_spdk_scsi_lun_execute_mgmt_task(lun, task);
 }
 
 static void
-_spdk_scsi_lun_execute_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task)
+_spdk_scsi_lun_execute_task(struct spdk_scsi_lun_channel *ch, struct spdk_scsi_task *task)
 {
+	struct spdk_scsi_lun *lun = ch->lun;
 	int rc;
 
 	task->status = SPDK_SCSI_STATUS_GOOD;
 	spdk_trace_record(TRACE_SCSI_TASK_START, lun->dev->id, task->length, (uintptr_t)task, 0);
-	TAILQ_INSERT_TAIL(&lun->tasks, task, scsi_link);
+	ch->num_submitted_tasks++;
 	if (!lun->removed) {
 		rc = spdk_bdev_scsi_execute(task);
 	} else {
@@ -191,23 +348,39 @@ _spdk_scsi_lun_execute_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *ta
 void
 spdk_scsi_lun_append_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task)
 {
-	TAILQ_INSERT_TAIL(&lun->pending_tasks, task, scsi_link);
+	struct spdk_scsi_lun_channel *ch = spdk_scsi_task_get_lun_channel(task);
+
+	if (spdk_likely(ch != NULL)) {
+		ch->num_tasks++;
+		TAILQ_INSERT_TAIL(&ch->pending_tasks, task, scsi_link);
+		return;
+	}
+
+	SPDK_ERRLOG("LUN %s has no I/O channel on this thread\n", spdk_bdev_get_name(lun->bdev));
+	spdk_scsi_task_process_abort(task);
+	task->cpl_fn(task);
 }
 
 void
-spdk_scsi_lun_execute_tasks(struct spdk_scsi_lun *lun)
+spdk_scsi_lun_execute_tasks(struct spdk_scsi_lun_channel *ch)
 {
 	struct spdk_scsi_task *task, *task_tmp;
+	TAILQ_HEAD(, spdk_scsi_task) tasks = TAILQ_HEAD_INITIALIZER(tasks);
 
-	if (spdk_scsi_lun_has_pending_mgmt_tasks(lun)) {
+	if (ch == NULL) {
+		return;
+	}
+
+	if (spdk_scsi_lun_has_pending_mgmt_tasks(ch->lun)) {
 		/* Pending IO tasks will wait for completion of existing mgmt tasks.
 		 */
 		return;
 	}
 
-	TAILQ_FOREACH_SAFE(task, &lun->pending_tasks, scsi_link, task_tmp) {
-		TAILQ_REMOVE(&lun->pending_tasks, task, scsi_link);
-		_spdk_scsi_lun_execute_task(lun, task);
+	TAILQ_SWAP(&tasks, &ch->pending_tasks, spdk_scsi_task, scsi_link);
+	TAILQ_FOREACH_SAFE(task, &tasks, scsi_link, task_tmp) {
+		TAILQ_REMOVE(&tasks, task, scsi_link);
+		_spdk_scsi_lun_execute_task(ch, task);
 	}
 }
 
@@ -217,15 +390,29 @@ spdk_scsi_lun_remove(struct spdk_scsi_lun *lun)
 	spdk_bdev_close(lun->bdev_desc);
 
 	spdk_scsi_dev_delete_lun(lun->dev, lun);
+	spdk_bdev_scsi_caw_cleanup(lun);
+	pthread_mutex_destroy(&lun->mutex);
 	free(lun);
 }
 
+static bool
+spdk_scsi_lun_has_channels(struct spdk_scsi_lun *lun)
+{
+	bool has_channels;
+
+	pthread_mutex_lock(&lun->mutex);
+	has_channels = !TAILQ_EMPTY(&lun->channels);
+	pthread_mutex_unlock(&lun->mutex);
+
+	return has_channels;
+}
+
 static int
 spdk_scsi_lun_check_io_channel(void *arg)
 {
 	struct spdk_scsi_lun *lun = (struct spdk_scsi_lun *)arg;
 
-	if (lun->io_channel) {
+	if (spdk_scsi_lun_has_channels(lun)) {
 		return -1;
 	}
 	spdk_poller_unregister(&lun->hotremove_poller);
@@ -234,6 +421,15 @@ spdk_scsi_lun_check_io_channel(void *arg)
 	return -1;
 }
 
+static void
+_spdk_scsi_lun_close(struct spdk_scsi_desc *desc)
+{
+	struct spdk_scsi_lun *lun = desc->lun;
+
+	TAILQ_REMOVE(&lun->open_descs, desc, link);
+	free(desc);
+}
+
 static void
 spdk_scsi_lun_notify_hot_remove(struct spdk_scsi_lun *lun)
 {
@@ -243,16 +439,22 @@ spdk_scsi_lun_notify_hot_remove(struct spdk_scsi_lun *lun)
 		lun->hotremove_cb(lun, lun->hotremove_ctx);
 	}
 
+	/*
+	 * Descriptors may be closed by other threads, so the callbacks are
+	 *  called with the lock held and must not call back into the LUN.
+	 */
+	pthread_mutex_lock(&lun->mutex);
 	TAILQ_FOREACH_SAFE(desc, &lun->open_descs, link, tmp) {
 		if (desc->hotremove_cb) {
 			desc->hotremove_cb(lun, desc->hotremove_ctx);
 		} else {
-			spdk_scsi_lun_close(desc);
+			_spdk_scsi_lun_close(desc);
 		}
 	}
+	pthread_mutex_unlock(&lun->mutex);
 
-	if (lun->io_channel) {
-		lun->hotremove_poller = spdk_poller_register(spdk_scsi_lun_check_io_channel,
+	if (spdk_scsi_lun_has_channels(lun)) {
+		lun->hotremove_poller = SPDK_POLLER_REGISTER(spdk_scsi_lun_check_io_channel,
 					lun, 10);
 	} else {
 		spdk_scsi_lun_remove(lun);
@@ -281,7 +483,7 @@ _spdk_scsi_lun_hot_remove(void *arg1)
 
 	if (spdk_scsi_lun_has_pending_tasks(lun) ||
 	    spdk_scsi_lun_has_pending_mgmt_tasks(lun)) {
-		lun->hotremove_poller = spdk_poller_register(spdk_scsi_lun_check_pending_tasks,
+		lun->hotremove_poller = SPDK_POLLER_REGISTER(spdk_scsi_lun_check_pending_tasks,
 					lun, 10);
 	} else {
 		spdk_scsi_lun_notify_hot_remove(lun);
@@ -292,20 +494,24 @@ static void
 spdk_scsi_lun_hot_remove(void *remove_ctx)
 {
 	struct spdk_scsi_lun *lun = (struct spdk_scsi_lun *)remove_ctx;
-	struct spdk_thread *thread;
+	struct spdk_scsi_lun_channel *ch;
+	struct spdk_thread *thread = NULL;
 
 	if (lun->removed) {
 		return;
 	}
 
 	lun->removed = true;
-	if (lun->io_channel == NULL) {
-		_spdk_scsi_lun_hot_remove(lun);
-		return;
+
+	/* Finish the removal on a thread using the LUN, like before it had several. */
+	pthread_mutex_lock(&lun->mutex);
+	ch = TAILQ_FIRST(&lun->channels);
+	if (ch != NULL) {
+		thread = ch->thread;
 	}
+	pthread_mutex_unlock(&lun->mutex);
 
-	thread = spdk_io_channel_get_thread(lun->io_channel);
-	if (thread != spdk_get_thread()) {
+	if (thread != NULL && thread != spdk_get_thread()) {
 		spdk_thread_send_msg(thread, _spdk_scsi_lun_hot_remove, lun);
 	} else {
 		_spdk_scsi_lun_hot_remove(lun);
@@ -339,21 +545,28 @@ spdk_scsi_lun_construct(struct spdk_bdev *bdev,
 		return NULL;
 	}
 
+	if (pthread_mutex_init(&lun->mutex, NULL) != 0) {
+		SPDK_ERRLOG("could not initialize lun mutex\n");
+		free(lun);
+		return NULL;
+	}
+
 	rc = spdk_bdev_open(bdev, true, spdk_scsi_lun_hot_remove, lun, &lun->bdev_desc);
 
 	if (rc != 0) {
 		SPDK_ERRLOG("bdev %s cannot be opened, error=%d\n", spdk_bdev_get_name(bdev), rc);
+		pthread_mutex_destroy(&lun->mutex);
 		free(lun);
 		return NULL;
 	}
 
-	TAILQ_INIT(&lun->tasks);
-	TAILQ_INIT(&lun->pending_tasks);
+	TAILQ_INIT(&lun->channels);
 	TAILQ_INIT(&lun->mgmt_tasks);
-	TAILQ_INIT(&lun->pending_mgmt_tasks);
+	TAILQ_INIT(&lun->caw_locked);
+	TAILQ_INIT(&lun->caw_waiting);
+	TAILQ_INIT(&lun->caw_gathering);
 
 	lun->bdev = bdev;
-	lun->io_channel = NULL;
 	lun->hotremove_cb = hotremove_cb;
 	lun->hotremove_ctx = hotremove_ctx;
 	TAILQ_INIT(&lun->open_descs);
@@ -379,11 +592,14 @@ spdk_scsi_lun_open(struct spdk_scsi_lun *lun, spdk_scsi_remove_cb_t hotremove_cb
 		return -ENOMEM;
 	}
 
-	TAILQ_INSERT_TAIL(&lun->open_descs, desc, link);
-
 	desc->lun = lun;
 	desc->hotremove_cb = hotremove_cb;
 	desc->hotremove_ctx = hotremove_ctx;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_INSERT_TAIL(&lun->open_descs, desc, link);
+	pthread_mutex_unlock(&lun->mutex);
+
 	*_desc = desc;
 
 	return 0;
@@ -394,18 +610,46 @@ spdk_scsi_lun_close(struct spdk_scsi_desc *desc)
 {
 	struct spdk_scsi_lun *lun = desc->lun;
 
-	TAILQ_REMOVE(&lun->open_descs, desc, link);
-	free(desc);
+	pthread_mutex_lock(&lun->mutex);
+	_spdk_scsi_lun_close(desc);
+	pthread_mutex_unlock(&lun->mutex);
+}
+
+static struct spdk_scsi_lun_channel *
+_spdk_scsi_lun_alloc_channel(struct spdk_scsi_lun *lun)
+{
+	struct spdk_scsi_lun_channel *ch;
 
-	assert(!TAILQ_EMPTY(&lun->open_descs) || lun->io_channel == NULL);
+	ch = calloc(1, sizeof(*ch));
+	if (ch == NULL) {
+		return NULL;
+	}
+
+	ch->io_channel = spdk_bdev_get_io_channel(lun->bdev_desc);
+	if (ch->io_channel == NULL) {
+		free(ch);
+		return NULL;
+	}
+
+	ch->lun = lun;
+	ch->thread = spdk_get_thread();
+	ch->ref = 1;
+	TAILQ_INIT(&ch->pending_tasks);
+	TAILQ_INIT(&ch->pending_mgmt_tasks);
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_INSERT_TAIL(&lun->channels, ch, link);
+	pthread_mutex_unlock(&lun->mutex);
+
+	return ch;
 }
 
 int
 _spdk_scsi_lun_allocate_io_channel(struct spdk_scsi_lun *lun)
 {
-	if (lun->io_channel != NULL) {
-		if (spdk_get_thread() == spdk_io_channel_get_thread(lun->io_channel)) {
-			lun->ref++;
+	if (lun->dev_ch != NULL) {
+		if (spdk_get_thread() == lun->dev_ch->thread) {
+			lun->dev_ch_ref++;
 			return 0;
 		}
 		SPDK_ERRLOG("io_channel already allocated for lun %s\n",
@@ -413,47 +657,68 @@ _spdk_scsi_lun_allocate_io_channel(struct spdk_scsi_lun *lun)
 		return -1;
 	}
 
-	lun->io_channel = spdk_bdev_get_io_channel(lun->bdev_desc);
-	if (lun->io_channel == NULL) {
+	lun->dev_ch = _spdk_scsi_lun_alloc_channel(lun);
+	if (lun->dev_ch == NULL) {
 		return -1;
 	}
-	lun->ref = 1;
+	lun->dev_ch_ref = 1;
 	return 0;
 }
 
 void
 _spdk_scsi_lun_free_io_channel(struct spdk_scsi_lun *lun)
 {
-	if (lun->io_channel == NULL) {
+	struct spdk_scsi_lun_channel *ch = lun->dev_ch;
+
+	if (ch == NULL) {
 		return;
 	}
 
-	if (spdk_get_thread() != spdk_io_channel_get_thread(lun->io_channel)) {
+	if (spdk_get_thread() != ch->thread) {
 		SPDK_ERRLOG("io_channel was freed by different thread\n");
 		return;
 	}
 
-	lun->ref--;
-	if (lun->ref == 0) {
-		spdk_put_io_channel(lun->io_channel);
-		lun->io_channel = NULL;
+	lun->dev_ch_ref--;
+	if (lun->dev_ch_ref == 0) {
+		lun->dev_ch = NULL;
+		_spdk_scsi_lun_put_channel(ch);
 	}
 }
 
 int
 spdk_scsi_lun_allocate_io_channel(struct spdk_scsi_desc *desc)
 {
-	struct spdk_scsi_lun *lun = desc->lun;
+	if (desc->ch != NULL) {
+		SPDK_ERRLOG("io_channel already allocated for descriptor of lun %s\n",
+			    spdk_bdev_get_name(desc->lun->bdev));
+		return -1;
+	}
 
-	return _spdk_scsi_lun_allocate_io_channel(lun);
+	desc->ch = _spdk_scsi_lun_alloc_channel(desc->lun);
+	if (desc->ch == NULL) {
+		return -1;
+	}
+
+	return 0;
 }
 
 void
 spdk_scsi_lun_free_io_channel(struct spdk_scsi_desc *desc)
 {
-	struct spdk_scsi_lun *lun = desc->lun;
+	struct spdk_scsi_lun_channel *ch = desc->ch;
+
+	if (ch == NULL) {
+		return;
+	}
 
-	_spdk_scsi_lun_free_io_channel(lun);
+	if (spdk_get_thread() != ch->thread) {
+		SPDK_ERRLOG("io_channel was freed by different thread\n");
+		return;
+	}
+
+	desc->ch = NULL;
+	_spdk_scsi_lun_put_channel(ch);
 }
 
 int
@@ -475,18 +740,28 @@ spdk_scsi_lun_get_dev(const struct spdk_scsi_lun *lun)
 }
 
 bool
-spdk_scsi_lun_has_pending_mgmt_tasks(const struct spdk_scsi_lun *lun)
+spdk_scsi_lun_has_pending_mgmt_tasks(struct spdk_scsi_lun *lun)
 {
-	return !TAILQ_EMPTY(&lun->pending_mgmt_tasks) ||
-	       !TAILQ_EMPTY(&lun->mgmt_tasks);
+	return lun->num_mgmt_tasks != 0;
 }
 
-/* This check includes both pending and submitted (outstanding) tasks. */
+/* This check includes both pending and submitted (outstanding) tasks of all channels. */
 bool
-spdk_scsi_lun_has_pending_tasks(const struct spdk_scsi_lun *lun)
+spdk_scsi_lun_has_pending_tasks(struct spdk_scsi_lun *lun)
 {
-	return !TAILQ_EMPTY(&lun->pending_tasks) ||
-	       !TAILQ_EMPTY(&lun->tasks);
+	struct spdk_scsi_lun_channel *ch;
+	bool has_tasks = false;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_FOREACH(ch, &lun->channels, link) {
+		if (ch->num_tasks != 0) {
+			has_tasks = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lun->mutex);
+
+	return has_tasks;
 }
 
 bool
@@ -56,6 +56,16 @@
 #define DEFAULT_DISK_ROTATION_RATE	1	/* Non-rotating medium */
 #define DEFAULT_DISK_FORM_FACTOR	0x02	/* 3.5 inch */
 #define DEFAULT_MAX_UNMAP_BLOCK_DESCRIPTOR_COUNT	256
+#define DEFAULT_MAX_WRITE_SAME_LENGTH	512
+
+#define SPDK_WORK_XCOPY_BLOCK_SIZE	(1ULL * 1024ULL * 1024ULL)
+#define DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT	8
+#define DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT	64
+#define XCOPY_HEADER_SIZE			16
+#define XCOPY_TARGET_DESCRIPTOR_SIZE		32
+#define XCOPY_SEGMENT_DESCRIPTOR_SIZE		28
+#define XCOPY_ID_DESCRIPTOR_TYPE_CODE		0xe4	/* Identification descriptor target */
+#define XCOPY_BLOCK_TO_BLOCK_TYPE_CODE		0x02	/* Block device to block device segment */
 
 #define INQUIRY_OFFSET(field)		offsetof(struct spdk_scsi_cdb_inquiry_data, field) + \
 					sizeof(((struct spdk_scsi_cdb_inquiry_data *)0x0)->field)
@@ -548,8 +558,9 @@ spdk_bdev_scsi_inquiry(struct spdk_bdev *bdev, struct spdk_scsi_task *task,
 
 			hlen = 4;
 
-			/* WSNZ(0) */
-			/* support zero length in WRITE SAME */
+			/* WSNZ(1) */
+			/* zero length in WRITE SAME is not supported */
+			data[4] = 0x01;
 
 			/* MAXIMUM COMPARE AND WRITE LENGTH */
 			blocks = SPDK_WORK_ATS_BLOCK_SIZE / block_size;
@@ -613,7 +624,7 @@ spdk_bdev_scsi_inquiry(struct spdk_bdev *bdev, struct spdk_scsi_task *task,
 				 * that the device server allows to be unmapped
 				 * or written in a single WRITE SAME command.
 				 */
-				to_be64(&data[36], 512);
+				to_be64(&data[36], DEFAULT_MAX_WRITE_SAME_LENGTH);
 
 				/* Reserved */
 				/* not specified */
@@ -710,7 +721,8 @@ spdk_bdev_scsi_inquiry(struct spdk_bdev *bdev, struct spdk_scsi_task *task,
 
 		/* SCCS(7) ACC(6) TPGS(5-4) 3PC(3) PROTECT(0) */
 		/* Not support TPGS */
-		inqdata->flags = 0;
+		/* Support EXTENDED COPY */
+		inqdata->flags = 1 << 3;
 
 		/* MULTIP */
 		inqdata->flags2 = 0x10;
@@ -1298,11 +1310,24 @@ spdk_bdev_scsi_task_complete_reset(struct spdk_bdev_io *bdev_io, bool success,
 }
 
 static void
-spdk_bdev_scsi_queue_io(struct spdk_scsi_task *task, spdk_bdev_io_wait_cb cb_fn, void *cb_arg)
+spdk_bdev_scsi_task_set_io_status(struct spdk_scsi_task *task, struct spdk_bdev_io *bdev_io)
+{
+	int sc, sk, asc, ascq;
+
+	spdk_bdev_io_get_scsi_status(bdev_io, &sc, &sk, &asc, &ascq);
+	spdk_scsi_task_set_status(task, sc, sk, asc, ascq);
+}
+
+/*
+ * Wait for a bdev_io to become available on the given LUN. This is
+ *  normally the LUN of the task, except for EXTENDED COPY which may
+ *  submit I/O to other LUNs of the same device.
+ */
+static void
+spdk_bdev_scsi_queue_lun_io(struct spdk_scsi_task *task, struct spdk_scsi_lun *lun,
+			    struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn, void *cb_arg)
 {
-	struct spdk_scsi_lun *lun = task->lun;
 	struct spdk_bdev *bdev = lun->bdev;
-	struct spdk_io_channel *ch = lun->io_channel;
 	int rc;
 
 	task->bdev_io_wait.bdev = bdev;
@@ -1315,6 +1340,12 @@ spdk_bdev_scsi_queue_io(struct spdk_scsi_task *task, spdk_bdev_io_wait_cb cb_fn,
 	}
 }
 
+static void
+spdk_bdev_scsi_queue_io(struct spdk_scsi_task *task, spdk_bdev_io_wait_cb cb_fn, void *cb_arg)
+{
+	spdk_bdev_scsi_queue_lun_io(task, task->lun, spdk_scsi_task_get_io_channel(task), cb_fn, cb_arg);
+}
+
 static int
 spdk_bdev_scsi_sync(struct spdk_bdev *bdev, struct spdk_bdev_desc *bdev_desc,
 		    struct spdk_io_channel *bdev_ch, struct spdk_scsi_task *task,
@@ -1385,7 +1416,7 @@ spdk_bdev_scsi_readwrite(struct spdk_scsi_task *task,
 	struct spdk_scsi_lun *lun = task->lun;
 	struct spdk_bdev *bdev = lun->bdev;
 	struct spdk_bdev_desc *bdev_desc = lun->bdev_desc;
-	struct spdk_io_channel *bdev_ch = lun->io_channel;
+	struct spdk_io_channel *bdev_ch = spdk_scsi_task_get_io_channel(task);
 	uint64_t bdev_num_blocks, offset_blocks, num_blocks;
 	uint32_t max_xfer_len, block_size;
 	int rc;
@@ -1560,7 +1591,8 @@ spdk_bdev_scsi_unmap_resubmit(void *arg)
 	struct spdk_scsi_task *task = ctx->task;
 	struct spdk_scsi_lun *lun = task->lun;
 
-	spdk_bdev_scsi_unmap(lun->bdev, lun->bdev_desc, lun->io_channel, task, ctx);
+	spdk_bdev_scsi_unmap(lun->bdev, lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+			     task, ctx);
 }
 
 static int
@@ -1656,237 +1688,1384 @@ spdk_bdev_scsi_unmap(struct spdk_bdev *bdev, struct spdk_bdev_desc *bdev_desc,
 }
 
 static int
-spdk_bdev_scsi_process_block(struct spdk_scsi_task *task)
+spdk_bdev_scsi_check_lba_range(struct spdk_scsi_task *task, struct spdk_bdev *bdev,
+			       uint64_t lba, uint64_t num_blocks)
 {
-	struct spdk_scsi_lun *lun = task->lun;
-	struct spdk_bdev *bdev = lun->bdev;
-	uint64_t lba;
-	uint32_t xfer_len;
-	uint32_t len = 0;
-	uint8_t *cdb = task->cdb;
-
-	/* XXX: We need to support FUA bit for writes! */
-	switch (cdb[0]) {
-	case SPDK_SBC_READ_6:
-	case SPDK_SBC_WRITE_6:
-		lba = (uint64_t)cdb[1] << 16;
-		lba |= (uint64_t)cdb[2] << 8;
-		lba |= (uint64_t)cdb[3];
-		xfer_len = cdb[4];
-		if (xfer_len == 0) {
-			xfer_len = 256;
-		}
-		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
-						cdb[0] == SPDK_SBC_READ_6);
-
-	case SPDK_SBC_READ_10:
-	case SPDK_SBC_WRITE_10:
-		lba = from_be32(&cdb[2]);
-		xfer_len = from_be16(&cdb[7]);
-		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
-						cdb[0] == SPDK_SBC_READ_10);
-
-	case SPDK_SBC_READ_12:
-	case SPDK_SBC_WRITE_12:
-		lba = from_be32(&cdb[2]);
-		xfer_len = from_be32(&cdb[6]);
-		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
-						cdb[0] == SPDK_SBC_READ_12);
-	case SPDK_SBC_READ_16:
-	case SPDK_SBC_WRITE_16:
-		lba = from_be64(&cdb[2]);
-		xfer_len = from_be32(&cdb[10]);
-		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
-						cdb[0] == SPDK_SBC_READ_16);
-
-	case SPDK_SBC_READ_CAPACITY_10: {
-		uint64_t num_blocks = spdk_bdev_get_num_blocks(bdev);
-		uint8_t buffer[8];
-
-		if (num_blocks - 1 > 0xffffffffULL) {
-			memset(buffer, 0xff, 4);
-		} else {
-			to_be32(buffer, num_blocks - 1);
-		}
-		to_be32(&buffer[4], spdk_bdev_get_data_block_size(bdev));
-
-		len = spdk_min(task->length, sizeof(buffer));
-		if (spdk_scsi_task_scatter_data(task, buffer, len) < 0) {
-			break;
-		}
+	uint64_t bdev_num_blocks = spdk_bdev_get_num_blocks(bdev);
 
-		task->data_transferred = len;
-		task->status = SPDK_SCSI_STATUS_GOOD;
-		break;
+	if (spdk_unlikely(bdev_num_blocks <= lba || bdev_num_blocks - lba < num_blocks)) {
+		SPDK_DEBUGLOG(SPDK_LOG_SCSI, "end of media\n");
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+					  SPDK_SCSI_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return -1;
 	}
 
-	case SPDK_SPC_SERVICE_ACTION_IN_16:
-		switch (cdb[1] & 0x1f) { /* SERVICE ACTION */
-		case SPDK_SBC_SAI_READ_CAPACITY_16: {
-			uint8_t buffer[32] = {0};
-
-			to_be64(&buffer[0], spdk_bdev_get_num_blocks(bdev) - 1);
-			to_be32(&buffer[8], spdk_bdev_get_data_block_size(bdev));
-			/*
-			 * Set the TPE bit to 1 to indicate thin provisioning.
-			 * The position of TPE bit is the 7th bit in 14th byte
-			 * in READ CAPACITY (16) parameter data.
-			 */
-			if (spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_UNMAP)) {
-				buffer[14] |= 1 << 7;
-			}
-
-			len = spdk_min(from_be32(&cdb[10]), sizeof(buffer));
-			if (spdk_scsi_task_scatter_data(task, buffer, len) < 0) {
-				break;
-			}
+	return 0;
+}
 
-			task->data_transferred = len;
-			task->status = SPDK_SCSI_STATUS_GOOD;
-			break;
-		}
+struct spdk_bdev_scsi_write_same_ctx {
+	struct spdk_scsi_task	*task;
+	uint8_t			*buf;
+	uint32_t		buf_blocks;
+	uint64_t		offset_blocks;
+	uint64_t		remaining_blocks;
+};
 
-		default:
-			return SPDK_SCSI_TASK_UNKNOWN;
-		}
-		break;
+static void
+spdk_bdev_scsi_write_same_free(struct spdk_bdev_scsi_write_same_ctx *ctx)
+{
+	spdk_dma_free(ctx->buf);
+	free(ctx);
+}
 
-	case SPDK_SBC_SYNCHRONIZE_CACHE_10:
-	case SPDK_SBC_SYNCHRONIZE_CACHE_16:
-		if (cdb[0] == SPDK_SBC_SYNCHRONIZE_CACHE_10) {
-			lba = from_be32(&cdb[2]);
-			len = from_be16(&cdb[7]);
-		} else {
-			lba = from_be64(&cdb[2]);
-			len = from_be32(&cdb[10]);
-		}
+static int spdk_bdev_scsi_write_same_submit(struct spdk_bdev_scsi_write_same_ctx *ctx);
 
-		if (len == 0) {
-			len = spdk_bdev_get_num_blocks(bdev) - lba;
-		}
+static void
+spdk_bdev_scsi_write_same_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_scsi_write_same_ctx *ctx = cb_arg;
+	struct spdk_scsi_task *task = ctx->task;
+	uint64_t num_blocks = spdk_min(ctx->remaining_blocks, ctx->buf_blocks);
 
-		return spdk_bdev_scsi_sync(bdev, lun->bdev_desc, lun->io_channel, task, lba, len);
-		break;
+	spdk_bdev_scsi_task_set_io_status(task, bdev_io);
+	spdk_bdev_free_io(bdev_io);
 
-	case SPDK_SBC_UNMAP:
-		return spdk_bdev_scsi_unmap(bdev, lun->bdev_desc, lun->io_channel, task, NULL);
+	ctx->offset_blocks += num_blocks;
+	ctx->remaining_blocks -= num_blocks;
 
-	default:
-		return SPDK_SCSI_TASK_UNKNOWN;
+	if (!success || ctx->remaining_blocks == 0 ||
+	    spdk_bdev_scsi_write_same_submit(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_write_same_free(ctx);
+		spdk_scsi_lun_complete_task(task->lun, task);
 	}
-
-	return SPDK_SCSI_TASK_COMPLETE;
 }
 
 static void
-spdk_bdev_scsi_process_block_resubmit(void *arg)
+spdk_bdev_scsi_write_same_resubmit(void *arg)
 {
-	struct spdk_scsi_task *task = arg;
+	struct spdk_bdev_scsi_write_same_ctx *ctx = arg;
+	struct spdk_scsi_task *task = ctx->task;
 
-	spdk_bdev_scsi_process_block(task);
+	if (spdk_bdev_scsi_write_same_submit(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_write_same_free(ctx);
+		spdk_scsi_lun_complete_task(task->lun, task);
+	}
 }
 
+/*
+ * Write the next chunk of a non-zero WRITE SAME pattern. The buffer holds
+ *  up to buf_blocks copies of the logical block, so the range is written
+ *  with as few bdev I/Os as possible.
+ */
 static int
-spdk_bdev_scsi_check_len(struct spdk_scsi_task *task, int len, int min_len)
+spdk_bdev_scsi_write_same_submit(struct spdk_bdev_scsi_write_same_ctx *ctx)
 {
-	if (len >= min_len) {
-		return 0;
+	struct spdk_scsi_task *task = ctx->task;
+	struct spdk_scsi_lun *lun = task->lun;
+	uint64_t num_blocks = spdk_min(ctx->remaining_blocks, ctx->buf_blocks);
+	int rc;
+
+	rc = spdk_bdev_write_blocks(lun->bdev_desc, spdk_scsi_task_get_io_channel(task), ctx->buf,
+				    ctx->offset_blocks, num_blocks,
+				    spdk_bdev_scsi_write_same_complete, ctx);
+	if (rc) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_scsi_queue_io(task, spdk_bdev_scsi_write_same_resubmit, ctx);
+			return SPDK_SCSI_TASK_PENDING;
+		}
+		SPDK_ERRLOG("spdk_bdev_write_blocks() failed\n");
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
 	}
 
-	/* INVALID FIELD IN CDB */
-	spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
-				  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
-				  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
-				  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
-	return -1;
+	return SPDK_SCSI_TASK_PENDING;
 }
 
+/*
+ * WRITE SAME is mapped to a single write_zeroes I/O when the logical block
+ *  is all zeroes, which is the common case of a host zeroing a disk. The
+ *  UNMAP bit is treated the same way since we don't report LBPRZ and a
+ *  zeroed range is always a valid result. Any other pattern is replicated
+ *  in a work buffer and written in chunks.
+ */
 static int
-spdk_bdev_scsi_process_primary(struct spdk_scsi_task *task)
+spdk_bdev_scsi_write_same(struct spdk_scsi_task *task, uint64_t lba, uint64_t num_blocks,
+			  bool ndob)
 {
 	struct spdk_scsi_lun *lun = task->lun;
 	struct spdk_bdev *bdev = lun->bdev;
-	int alloc_len = -1;
-	int data_len = -1;
-	uint8_t *cdb = task->cdb;
-	uint8_t *data = NULL;
-	int rc = 0;
-	int pllen, md = 0;
-	int pf, sp;
-	int bdlen = 0, llba;
-	int dbd, pc, page, subpage;
-	int cmd_parsed = 0;
-
-
-	switch (cdb[0]) {
-	case SPDK_SPC_INQUIRY:
-		alloc_len = from_be16(&cdb[3]);
-		data_len = spdk_max(4096, alloc_len);
-		data = spdk_dma_zmalloc(data_len, 0, NULL);
-		assert(data != NULL);
-		rc = spdk_bdev_scsi_inquiry(bdev, task, cdb, data, data_len);
-		data_len = spdk_min(rc, data_len);
-		if (rc < 0) {
-			break;
-		}
+	struct spdk_bdev_scsi_write_same_ctx *ctx;
+	uint32_t block_size, i;
+	uint8_t *pattern = NULL;
+	int data_len = 0;
+	bool is_zero;
+	int rc;
 
-		SPDK_LOGDUMP(SPDK_LOG_SCSI, "INQUIRY", data, data_len);
-		break;
+	/* WSNZ is 1 and the Block Limits VPD page reports MAXIMUM WRITE SAME LENGTH */
+	if (num_blocks == 0 || num_blocks > DEFAULT_MAX_WRITE_SAME_LENGTH) {
+		SPDK_ERRLOG("WRITE SAME number of blocks %" PRIu64 " not in 1 - %d\n",
+			    num_blocks, DEFAULT_MAX_WRITE_SAME_LENGTH);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+					  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
 
-	case SPDK_SPC_REPORT_LUNS: {
-		int sel;
+	if (spdk_bdev_scsi_check_lba_range(task, bdev, lba, num_blocks) != 0) {
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
 
-		sel = cdb[2];
-		SPDK_DEBUGLOG(SPDK_LOG_SCSI, "sel=%x\n", sel);
+	block_size = spdk_bdev_get_data_block_size(bdev);
 
-		alloc_len = from_be32(&cdb[6]);
-		rc = spdk_bdev_scsi_check_len(task, alloc_len, 16);
-		if (rc < 0) {
-			break;
+	if (ndob) {
+		is_zero = true;
+	} else {
+		if (task->length < block_size) {
+			SPDK_ERRLOG("WRITE SAME data length %" PRIu32 " < block_size %" PRIu32 "\n",
+				    task->length, block_size);
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+						  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			return SPDK_SCSI_TASK_COMPLETE;
 		}
 
-		data_len = spdk_max(4096, alloc_len);
-		data = spdk_dma_zmalloc(data_len, 0, NULL);
-		assert(data != NULL);
-		rc = spdk_bdev_scsi_report_luns(task->lun, sel, data, data_len);
-		data_len = rc;
-		if (rc < 0) {
+		pattern = spdk_scsi_task_gather_data(task, &data_len);
+		if (pattern == NULL) {
 			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
 						  SPDK_SCSI_SENSE_NO_SENSE,
 						  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
 						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
-			break;
+			return SPDK_SCSI_TASK_COMPLETE;
 		}
 
-		SPDK_LOGDUMP(SPDK_LOG_SCSI, "REPORT LUNS", data, data_len);
-		break;
+		is_zero = spdk_mem_all_zero(pattern, block_size);
+		task->data_transferred = task->length;
 	}
 
-	case SPDK_SPC_MODE_SELECT_6:
-	case SPDK_SPC_MODE_SELECT_10:
-		if (cdb[0] == SPDK_SPC_MODE_SELECT_6) {
-			/* MODE_SELECT(6) must have at least a 4 byte header. */
-			md = 4;
-			pllen = cdb[4];
-		} else {
-			/* MODE_SELECT(10) must have at least an 8 byte header. */
-			md = 8;
-			pllen = from_be16(&cdb[7]);
-		}
-
-		if (pllen == 0) {
-			break;
-		}
+	SPDK_DEBUGLOG(SPDK_LOG_SCSI, "Write same: lba=%" PRIu64 ", len=%" PRIu64 ", zero=%d\n",
+		      lba, num_blocks, is_zero);
 
-		rc = spdk_bdev_scsi_check_len(task, pllen, md);
-		if (rc < 0) {
-			break;
-		}
+	if (is_zero) {
+		spdk_dma_free(pattern);
 
-		data = spdk_scsi_task_gather_data(task, &rc);
-		if (rc < 0) {
-			break;
-		}
+		rc = spdk_bdev_write_zeroes_blocks(lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+						   lba, num_blocks, spdk_bdev_scsi_task_complete_cmd, task);
+		if (rc) {
+			if (rc == -ENOMEM) {
+				spdk_bdev_scsi_queue_io(task, spdk_bdev_scsi_process_block_resubmit, task);
+				return SPDK_SCSI_TASK_PENDING;
+			}
+			SPDK_ERRLOG("spdk_bdev_write_zeroes_blocks() failed\n");
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_NO_SENSE,
+						  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			return SPDK_SCSI_TASK_COMPLETE;
+		}
+		return SPDK_SCSI_TASK_PENDING;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx != NULL) {
+		ctx->task = task;
+		ctx->offset_blocks = lba;
+		ctx->remaining_blocks = num_blocks;
+		ctx->buf_blocks = spdk_min(num_blocks, SPDK_WORK_BLOCK_SIZE / block_size);
+		ctx->buf = spdk_dma_malloc(ctx->buf_blocks * block_size, 0, NULL);
+	}
+
+	if (ctx == NULL || ctx->buf == NULL) {
+		free(ctx);
+		spdk_dma_free(pattern);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	for (i = 0; i < ctx->buf_blocks; i++) {
+		memcpy(ctx->buf + (uint64_t)i * block_size, pattern, block_size);
+	}
+	spdk_dma_free(pattern);
+
+	rc = spdk_bdev_scsi_write_same_submit(ctx);
+	if (rc == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_write_same_free(ctx);
+	}
+
+	return rc;
+}
+
+/*
+ * COMPARE AND WRITE has to be atomic with respect to other COMPARE AND
+ *  WRITE commands to the same blocks, since hosts use it as a lock
+ *  primitive (e.g. VMware ATS). The LUN keeps a list of locked LBA ranges
+ *  under its mutex; commands overlapping a locked range wait in arrival
+ *  order and are resumed on the thread they were received on.
+ *
+ * Transports may split the data of a command into several tasks, e.g. iSCSI
+ *  submits one task per Data-Out PDU. The tasks arrive in order of their
+ *  offset, their data is gathered in the context of the command, which is
+ *  kept on the LUN until the task with the last data runs the compare.
+ */
+struct spdk_bdev_scsi_caw_ctx {
+	struct spdk_scsi_task			*task;
+	struct spdk_thread			*thread;
+	uint64_t				lba;
+	uint32_t				num_blocks;
+
+	/* Identify the command while its data is gathered. */
+	struct spdk_scsi_port			*initiator_port;
+	uint8_t					*cdb;
+
+	/* Verify data followed by write data, as received from the initiator. */
+	uint8_t					*data;
+	uint32_t				data_len;
+	uint32_t				received;
+	uint8_t					*read_buf;
+
+	TAILQ_ENTRY(spdk_bdev_scsi_caw_ctx)	link;
+};
+
+static int spdk_bdev_scsi_caw_read(struct spdk_bdev_scsi_caw_ctx *ctx);
+
+/* Called with lun->mutex held. */
+static bool
+spdk_bdev_scsi_caw_range_busy(struct spdk_scsi_lun *lun, struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	struct spdk_bdev_scsi_caw_ctx *tmp;
+
+	TAILQ_FOREACH(tmp, &lun->caw_locked, link) {
+		if (ctx->lba < tmp->lba + tmp->num_blocks && tmp->lba < ctx->lba + ctx->num_blocks) {
+			return true;
+		}
+	}
+
+	/* Don't let a command overtake an earlier one waiting for the same blocks. */
+	TAILQ_FOREACH(tmp, &lun->caw_waiting, link) {
+		if (tmp == ctx) {
+			break;
+		}
+		if (ctx->lba < tmp->lba + tmp->num_blocks && tmp->lba < ctx->lba + ctx->num_blocks) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+spdk_bdev_scsi_caw_ctx_free(struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	spdk_dma_free(ctx->data);
+	spdk_dma_free(ctx->read_buf);
+	free(ctx);
+}
+
+static void
+spdk_bdev_scsi_caw_free(struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	struct spdk_scsi_lun *lun = ctx->task->lun;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_REMOVE(&lun->caw_locked, ctx, link);
+	pthread_mutex_unlock(&lun->mutex);
+	spdk_bdev_scsi_caw_ctx_free(ctx);
+}
+
+/* Free the data of commands which never received all of it. */
+void
+spdk_bdev_scsi_caw_cleanup(struct spdk_scsi_lun *lun)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx;
+
+	while ((ctx = TAILQ_FIRST(&lun->caw_gathering)) != NULL) {
+		TAILQ_REMOVE(&lun->caw_gathering, ctx, link);
+		spdk_bdev_scsi_caw_ctx_free(ctx);
+	}
+}
+
+static struct spdk_bdev_scsi_caw_ctx *
+spdk_bdev_scsi_caw_ctx_alloc(struct spdk_scsi_task *task, uint64_t lba, uint32_t num_blocks,
+			     uint32_t block_size)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	ctx->thread = spdk_get_thread();
+	ctx->lba = lba;
+	ctx->num_blocks = num_blocks;
+	ctx->initiator_port = task->initiator_port;
+	ctx->cdb = task->cdb;
+	ctx->data_len = 2 * num_blocks * block_size;
+	ctx->data = spdk_dma_malloc(ctx->data_len, 0, NULL);
+	ctx->read_buf = spdk_dma_malloc(num_blocks * block_size, 0, NULL);
+	if (ctx->data == NULL || ctx->read_buf == NULL) {
+		spdk_bdev_scsi_caw_ctx_free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+/* Take the context of the command of the task off the LUN, if its data is being gathered. */
+static struct spdk_bdev_scsi_caw_ctx *
+spdk_bdev_scsi_caw_get_gathering(struct spdk_scsi_task *task)
+{
+	struct spdk_scsi_lun *lun = task->lun;
+	struct spdk_bdev_scsi_caw_ctx *ctx;
+
+	pthread_mutex_lock(&lun->mutex);
+	TAILQ_FOREACH(ctx, &lun->caw_gathering, link) {
+		if (ctx->initiator_port == task->initiator_port && ctx->cdb == task->cdb) {
+			TAILQ_REMOVE(&lun->caw_gathering, ctx, link);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&lun->mutex);
+
+	return ctx;
+}
+
+static void
+spdk_bdev_scsi_caw_copy_data(struct spdk_bdev_scsi_caw_ctx *ctx, struct spdk_scsi_task *task)
+{
+	uint32_t len, remaining;
+	int i;
+
+	remaining = spdk_min(task->length, ctx->data_len - ctx->received);
+	for (i = 0; i < task->iovcnt && remaining > 0; i++) {
+		len = spdk_min(task->iovs[i].iov_len, remaining);
+		memcpy(ctx->data + ctx->received, task->iovs[i].iov_base, len);
+		ctx->received += len;
+		remaining -= len;
+	}
+}
+
+static void spdk_bdev_scsi_caw_finish(struct spdk_bdev_scsi_caw_ctx *ctx);
+
+static void
+spdk_bdev_scsi_caw_start(void *arg)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx = arg;
+
+	if (spdk_bdev_scsi_caw_read(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_caw_finish(ctx);
+	}
+}
+
+static void
+spdk_bdev_scsi_caw_finish(struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	struct spdk_scsi_task *task = ctx->task;
+	struct spdk_scsi_lun *lun = task->lun;
+	struct spdk_bdev_scsi_caw_ctx *waiter;
+
+	spdk_bdev_scsi_caw_free(ctx);
+	spdk_scsi_lun_complete_task(lun, task);
+
+	/* Restart the scan after each grant, since a failed read finishes another ctx. */
+	for (;;) {
+		pthread_mutex_lock(&lun->mutex);
+		TAILQ_FOREACH(waiter, &lun->caw_waiting, link) {
+			if (!spdk_bdev_scsi_caw_range_busy(lun, waiter)) {
+				break;
+			}
+		}
+
+		if (waiter == NULL) {
+			pthread_mutex_unlock(&lun->mutex);
+			break;
+		}
+
+		TAILQ_REMOVE(&lun->caw_waiting, waiter, link);
+		TAILQ_INSERT_TAIL(&lun->caw_locked, waiter, link);
+		pthread_mutex_unlock(&lun->mutex);
+
+		if (waiter->thread != spdk_get_thread()) {
+			/* The waiter's task still holds the LUN, so it can't go away meanwhile. */
+			spdk_thread_send_msg(waiter->thread, spdk_bdev_scsi_caw_start, waiter);
+		} else {
+			spdk_bdev_scsi_caw_start(waiter);
+		}
+	}
+}
+
+static void
+spdk_bdev_scsi_caw_write_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx = cb_arg;
+	struct spdk_scsi_task *task = ctx->task;
+
+	spdk_bdev_scsi_task_set_io_status(task, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+
+	if (success) {
+		task->data_transferred = task->length;
+	}
+
+	spdk_bdev_scsi_caw_finish(ctx);
+}
+
+static int spdk_bdev_scsi_caw_write(struct spdk_bdev_scsi_caw_ctx *ctx);
+
+static void
+spdk_bdev_scsi_caw_write_resubmit(void *arg)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx = arg;
+
+	if (spdk_bdev_scsi_caw_write(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_caw_finish(ctx);
+	}
+}
+
+static int
+spdk_bdev_scsi_caw_write(struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	struct spdk_scsi_task *task = ctx->task;
+	struct spdk_scsi_lun *lun = task->lun;
+	uint32_t block_size = spdk_bdev_get_data_block_size(lun->bdev);
+	int rc;
+
+	rc = spdk_bdev_write_blocks(lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+				    ctx->data + (uint64_t)ctx->num_blocks * block_size,
+				    ctx->lba, ctx->num_blocks,
+				    spdk_bdev_scsi_caw_write_complete, ctx);
+	if (rc) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_scsi_queue_io(task, spdk_bdev_scsi_caw_write_resubmit, ctx);
+			return SPDK_SCSI_TASK_PENDING;
+		}
+		SPDK_ERRLOG("spdk_bdev_write_blocks() failed\n");
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	return SPDK_SCSI_TASK_PENDING;
+}
+
+static void
+spdk_bdev_scsi_caw_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx = cb_arg;
+	struct spdk_scsi_task *task = ctx->task;
+	uint32_t block_size = spdk_bdev_get_data_block_size(task->lun->bdev);
+	uint32_t i, len = ctx->num_blocks * block_size;
+
+	if (!success) {
+		spdk_bdev_scsi_task_set_io_status(task, bdev_io);
+		spdk_bdev_free_io(bdev_io);
+		spdk_bdev_scsi_caw_finish(ctx);
+		return;
+	}
+	spdk_bdev_free_io(bdev_io);
+
+	if (memcmp(ctx->read_buf, ctx->data, len) != 0) {
+		for (i = 0; i < len; i++) {
+			if (ctx->read_buf[i] != ctx->data[i]) {
+				break;
+			}
+		}
+
+		SPDK_DEBUGLOG(SPDK_LOG_SCSI, "Compare and write: miscompare at offset %" PRIu32 "\n", i);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_MISCOMPARE,
+					  SPDK_SCSI_ASC_MISCOMPARE_DURING_VERIFY_OPERATION,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		/* INFORMATION: offset of the first miscompared byte */
+		to_be32(&task->sense_data[3], i);
+		spdk_bdev_scsi_caw_finish(ctx);
+		return;
+	}
+
+	if (spdk_bdev_scsi_caw_write(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_caw_finish(ctx);
+	}
+}
+
+static void
+spdk_bdev_scsi_caw_read_resubmit(void *arg)
+{
+	struct spdk_bdev_scsi_caw_ctx *ctx = arg;
+
+	if (spdk_bdev_scsi_caw_read(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_caw_finish(ctx);
+	}
+}
+
+static int
+spdk_bdev_scsi_caw_read(struct spdk_bdev_scsi_caw_ctx *ctx)
+{
+	struct spdk_scsi_task *task = ctx->task;
+	struct spdk_scsi_lun *lun = task->lun;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(lun->bdev_desc, spdk_scsi_task_get_io_channel(task), ctx->read_buf,
+				   ctx->lba, ctx->num_blocks,
+				   spdk_bdev_scsi_caw_read_complete, ctx);
+	if (rc) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_scsi_queue_io(task, spdk_bdev_scsi_caw_read_resubmit, ctx);
+			return SPDK_SCSI_TASK_PENDING;
+		}
+		SPDK_ERRLOG("spdk_bdev_read_blocks() failed\n");
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	return SPDK_SCSI_TASK_PENDING;
+}
+
+static int
+spdk_bdev_scsi_compare_and_write(struct spdk_scsi_task *task, uint64_t lba, uint32_t num_blocks)
+{
+	struct spdk_scsi_lun *lun = task->lun;
+	struct spdk_bdev *bdev = lun->bdev;
+	struct spdk_bdev_scsi_caw_ctx *ctx;
+	uint32_t block_size, max_blocks;
+	int rc;
+
+	if (spdk_unlikely(task->dxfer_dir != SPDK_SCSI_DIR_NONE &&
+			  task->dxfer_dir != SPDK_SCSI_DIR_TO_DEV)) {
+		SPDK_ERRLOG("Incorrect data direction\n");
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	if (spdk_bdev_scsi_check_lba_range(task, bdev, lba, num_blocks) != 0) {
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	if (num_blocks == 0) {
+		task->status = SPDK_SCSI_STATUS_GOOD;
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	block_size = spdk_bdev_get_data_block_size(bdev);
+
+	/* Limited to the Block Limits VPD page MAXIMUM COMPARE AND WRITE LENGTH */
+	max_blocks = spdk_min(SPDK_WORK_ATS_BLOCK_SIZE / block_size, 0xff);
+	if (num_blocks > max_blocks) {
+		SPDK_ERRLOG("num_blocks %" PRIu32 " > maximum compare and write length %" PRIu32 "\n",
+			    num_blocks, max_blocks);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+					  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	ctx = spdk_bdev_scsi_caw_get_gathering(task);
+	if (task->offset == 0) {
+		if (ctx != NULL) {
+			/* Left over from an earlier command which never received all data */
+			spdk_bdev_scsi_caw_ctx_free(ctx);
+		}
+
+		ctx = spdk_bdev_scsi_caw_ctx_alloc(task, lba, num_blocks, block_size);
+		if (ctx == NULL) {
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_NO_SENSE,
+						  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			return SPDK_SCSI_TASK_COMPLETE;
+		}
+	} else if (ctx == NULL || task->offset != ctx->received) {
+		SPDK_ERRLOG("compare and write data offset %" PRIu64 " does not follow received data\n",
+			    task->offset);
+		if (ctx != NULL) {
+			spdk_bdev_scsi_caw_ctx_free(ctx);
+		}
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	spdk_bdev_scsi_caw_copy_data(ctx, task);
+
+	if (ctx->received < ctx->data_len) {
+		/* Both the verify and the write data have to be transferred. */
+		if (task->offset + task->length >= task->transfer_len) {
+			SPDK_ERRLOG("compare and write data length %" PRIu32 " < 2 * %" PRIu32 " blocks\n",
+				    task->transfer_len, num_blocks);
+			spdk_bdev_scsi_caw_ctx_free(ctx);
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_NO_SENSE,
+						  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			return SPDK_SCSI_TASK_COMPLETE;
+		}
+
+		/* Complete this part, the task with the last data runs the command. */
+		pthread_mutex_lock(&lun->mutex);
+		TAILQ_INSERT_TAIL(&lun->caw_gathering, ctx, link);
+		pthread_mutex_unlock(&lun->mutex);
+		task->data_transferred = task->length;
+		task->status = SPDK_SCSI_STATUS_GOOD;
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	ctx->task = task;
+
+	SPDK_DEBUGLOG(SPDK_LOG_SCSI, "Compare and write: lba=%" PRIu64 ", len=%" PRIu32 "\n",
+		      lba, num_blocks);
+
+	pthread_mutex_lock(&lun->mutex);
+	if (spdk_bdev_scsi_caw_range_busy(lun, ctx)) {
+		TAILQ_INSERT_TAIL(&lun->caw_waiting, ctx, link);
+		pthread_mutex_unlock(&lun->mutex);
+		return SPDK_SCSI_TASK_PENDING;
+	}
+
+	TAILQ_INSERT_TAIL(&lun->caw_locked, ctx, link);
+	pthread_mutex_unlock(&lun->mutex);
+
+	rc = spdk_bdev_scsi_caw_read(ctx);
+	if (rc == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_caw_free(ctx);
+	}
+
+	return rc;
+}
+
+/*
+ * EXTENDED COPY (LID1) with identification descriptor targets and block to
+ *  block segments. Targets are resolved to LUNs of the same SCSI device by
+ *  the NAA designator reported in the Device Identification VPD page, and
+ *  the data is copied through a work buffer without leaving the target.
+ */
+struct spdk_bdev_scsi_xcopy_segment {
+	struct spdk_scsi_lun	*src;
+	struct spdk_scsi_lun	*dst;
+	struct spdk_io_channel	*src_ch;
+	struct spdk_io_channel	*dst_ch;
+	uint64_t		src_lba;
+	uint64_t		dst_lba;
+	uint32_t		num_blocks;
+};
+
+struct spdk_bdev_scsi_xcopy_ctx {
+	struct spdk_scsi_task			*task;
+	struct spdk_bdev_scsi_xcopy_segment	segs[DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT];
+	uint32_t				num_segs;
+
+	/* Current segment, blocks of it already copied and blocks in flight. */
+	uint32_t				seg_idx;
+	uint32_t				seg_offset;
+	uint32_t				io_blocks;
+
+	uint8_t					*buf;
+	uint32_t				buf_len;
+};
+
+static int spdk_bdev_scsi_xcopy_read(struct spdk_bdev_scsi_xcopy_ctx *ctx);
+static int spdk_bdev_scsi_xcopy_write(struct spdk_bdev_scsi_xcopy_ctx *ctx);
+
+static void
+spdk_bdev_scsi_xcopy_free(struct spdk_bdev_scsi_xcopy_ctx *ctx)
+{
+	spdk_dma_free(ctx->buf);
+	free(ctx);
+}
+
+static void
+spdk_bdev_scsi_xcopy_finish(struct spdk_bdev_scsi_xcopy_ctx *ctx)
+{
+	struct spdk_scsi_task *task = ctx->task;
+
+	spdk_bdev_scsi_xcopy_free(ctx);
+	spdk_scsi_lun_complete_task(task->lun, task);
+}
+
+static void
+spdk_bdev_scsi_xcopy_set_failure(struct spdk_scsi_task *task)
+{
+	spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+				  SPDK_SCSI_SENSE_COPY_ABORTED,
+				  SPDK_SCSI_ASC_COPY_TARGET_DEVICE_ERROR,
+				  SPDK_SCSI_ASCQ_THIRD_PARTY_DEVICE_FAILURE);
+}
+
+static void
+spdk_bdev_scsi_xcopy_write_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_scsi_xcopy_ctx *ctx = cb_arg;
+	struct spdk_bdev_scsi_xcopy_segment *seg = &ctx->segs[ctx->seg_idx];
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		spdk_bdev_scsi_xcopy_set_failure(ctx->task);
+		spdk_bdev_scsi_xcopy_finish(ctx);
+		return;
+	}
+
+	ctx->seg_offset += ctx->io_blocks;
+	if (ctx->seg_offset == seg->num_blocks) {
+		ctx->seg_idx++;
+		ctx->seg_offset = 0;
+	}
+
+	if (ctx->seg_idx == ctx->num_segs) {
+		ctx->task->status = SPDK_SCSI_STATUS_GOOD;
+		spdk_bdev_scsi_xcopy_finish(ctx);
+	} else if (spdk_bdev_scsi_xcopy_read(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_xcopy_finish(ctx);
+	}
+}
+
+static void
+spdk_bdev_scsi_xcopy_write_resubmit(void *arg)
+{
+	struct spdk_bdev_scsi_xcopy_ctx *ctx = arg;
+
+	if (spdk_bdev_scsi_xcopy_write(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_xcopy_finish(ctx);
+	}
+}
+
+static int
+spdk_bdev_scsi_xcopy_write(struct spdk_bdev_scsi_xcopy_ctx *ctx)
+{
+	struct spdk_bdev_scsi_xcopy_segment *seg = &ctx->segs[ctx->seg_idx];
+	int rc;
+
+	rc = spdk_bdev_write_blocks(seg->dst->bdev_desc, seg->dst_ch,
+				    ctx->buf, seg->dst_lba + ctx->seg_offset, ctx->io_blocks,
+				    spdk_bdev_scsi_xcopy_write_complete, ctx);
+	if (rc) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_scsi_queue_lun_io(ctx->task, seg->dst, seg->dst_ch,
+						    spdk_bdev_scsi_xcopy_write_resubmit, ctx);
+			return SPDK_SCSI_TASK_PENDING;
+		}
+		SPDK_ERRLOG("spdk_bdev_write_blocks() failed\n");
+		spdk_bdev_scsi_xcopy_set_failure(ctx->task);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	return SPDK_SCSI_TASK_PENDING;
+}
+
+static void
+spdk_bdev_scsi_xcopy_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_scsi_xcopy_ctx *ctx = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		spdk_bdev_scsi_xcopy_set_failure(ctx->task);
+		spdk_bdev_scsi_xcopy_finish(ctx);
+		return;
+	}
+
+	if (spdk_bdev_scsi_xcopy_write(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_xcopy_finish(ctx);
+	}
+}
+
+static void
+spdk_bdev_scsi_xcopy_read_resubmit(void *arg)
+{
+	struct spdk_bdev_scsi_xcopy_ctx *ctx = arg;
+
+	if (spdk_bdev_scsi_xcopy_read(ctx) == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_xcopy_finish(ctx);
+	}
+}
+
+static int
+spdk_bdev_scsi_xcopy_read(struct spdk_bdev_scsi_xcopy_ctx *ctx)
+{
+	struct spdk_bdev_scsi_xcopy_segment *seg = &ctx->segs[ctx->seg_idx];
+	uint32_t block_size = spdk_bdev_get_data_block_size(seg->src->bdev);
+	int rc;
+
+	ctx->io_blocks = spdk_min(seg->num_blocks - ctx->seg_offset, ctx->buf_len / block_size);
+
+	rc = spdk_bdev_read_blocks(seg->src->bdev_desc, seg->src_ch,
+				   ctx->buf, seg->src_lba + ctx->seg_offset, ctx->io_blocks,
+				   spdk_bdev_scsi_xcopy_read_complete, ctx);
+	if (rc) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_scsi_queue_lun_io(ctx->task, seg->src, seg->src_ch,
+						    spdk_bdev_scsi_xcopy_read_resubmit, ctx);
+			return SPDK_SCSI_TASK_PENDING;
+		}
+		SPDK_ERRLOG("spdk_bdev_read_blocks() failed\n");
+		spdk_bdev_scsi_xcopy_set_failure(ctx->task);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	return SPDK_SCSI_TASK_PENDING;
+}
+
+/*
+ * Find the LUN of a target descriptor and its I/O channel on this thread.
+ *  It may be another LUN of the device than the one of the task, so it is
+ *  looked up once here rather than for each I/O.
+ */
+static struct spdk_scsi_lun *
+spdk_bdev_scsi_xcopy_find_lun(struct spdk_scsi_task *task, const uint8_t *desc,
+			      struct spdk_io_channel **ch)
+{
+	struct spdk_scsi_dev *dev = task->lun->dev;
+	struct spdk_scsi_lun *lun;
+	uint8_t naa[8];
+	int i;
+
+	/* DESIGNATOR TYPE(3-0) and DESIGNATOR LENGTH of the identification descriptor */
+	if ((desc[5] & 0xf) != SPDK_SPC_VPD_IDENTIFIER_TYPE_NAA || desc[7] != sizeof(naa)) {
+		return NULL;
+	}
+
+	for (i = 0; i < SPDK_SCSI_DEV_MAX_LUN; i++) {
+		lun = dev->lun[i];
+		if (lun == NULL || lun->removed) {
+			continue;
+		}
+
+		memset(naa, 0, sizeof(naa));
+		spdk_bdev_scsi_set_naa_ieee_extended(spdk_bdev_get_name(lun->bdev), naa);
+		if (memcmp(naa, &desc[8], sizeof(naa)) != 0) {
+			continue;
+		}
+
+		if (lun == task->lun) {
+			*ch = spdk_scsi_task_get_io_channel(task);
+		} else {
+			*ch = spdk_scsi_lun_get_io_channel(lun);
+		}
+		if (*ch != NULL) {
+			return lun;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+spdk_bdev_scsi_xcopy_parse(struct spdk_scsi_task *task, struct spdk_bdev_scsi_xcopy_ctx *ctx,
+			   const uint8_t *data, uint32_t data_len)
+{
+	struct spdk_scsi_lun *targets[DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT];
+	struct spdk_io_channel *target_chs[DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT];
+	struct spdk_bdev_scsi_xcopy_segment *seg;
+	const uint8_t *desc;
+	uint32_t target_len, segment_len, inline_len;
+	uint32_t num_targets, desc_len, pos, end, i;
+	uint16_t src_idx, dst_idx;
+	int asc = SPDK_SCSI_ASC_INVALID_FIELD_IN_PARAMETER_LIST;
+	int ascq = SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE;
+
+	if (data_len < XCOPY_HEADER_SIZE) {
+		goto invalid;
+	}
+
+	target_len = from_be16(&data[2]);
+	segment_len = from_be32(&data[8]);
+	inline_len = from_be32(&data[12]);
+
+	if (target_len % XCOPY_TARGET_DESCRIPTOR_SIZE != 0 || inline_len != 0 ||
+	    (uint64_t)XCOPY_HEADER_SIZE + target_len + segment_len > data_len) {
+		goto invalid;
+	}
+
+	num_targets = target_len / XCOPY_TARGET_DESCRIPTOR_SIZE;
+	if (num_targets > DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT) {
+		goto invalid;
+	}
+
+	for (i = 0; i < num_targets; i++) {
+		desc = &data[XCOPY_HEADER_SIZE + i * XCOPY_TARGET_DESCRIPTOR_SIZE];
+		if (desc[0] != XCOPY_ID_DESCRIPTOR_TYPE_CODE) {
+			ascq = SPDK_SCSI_ASCQ_UNSUPPORTED_TARGET_DESCRIPTOR_TYPE_CODE;
+			goto invalid;
+		}
+
+		targets[i] = spdk_bdev_scsi_xcopy_find_lun(task, desc, &target_chs[i]);
+		if (targets[i] == NULL) {
+			SPDK_ERRLOG("EXTENDED COPY target descriptor %" PRIu32 " not found\n", i);
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_COPY_ABORTED,
+						  SPDK_SCSI_ASC_COPY_TARGET_DEVICE_ERROR,
+						  SPDK_SCSI_ASCQ_COPY_TARGET_DEVICE_NOT_REACHABLE);
+			return -1;
+		}
+	}
+
+	pos = XCOPY_HEADER_SIZE + target_len;
+	end = pos + segment_len;
+	while (pos < end) {
+		desc = &data[pos];
+		if (end - pos < 4) {
+			goto invalid;
+		}
+
+		if (desc[0] != XCOPY_BLOCK_TO_BLOCK_TYPE_CODE) {
+			ascq = SPDK_SCSI_ASCQ_UNSUPPORTED_SEGMENT_DESCRIPTOR_TYPE_CODE;
+			goto invalid;
+		}
+
+		desc_len = from_be16(&desc[2]) + 4;
+		if (desc_len != XCOPY_SEGMENT_DESCRIPTOR_SIZE || end - pos < desc_len) {
+			goto invalid;
+		}
+		pos += desc_len;
+
+		src_idx = from_be16(&desc[4]);
+		dst_idx = from_be16(&desc[6]);
+		if (src_idx >= num_targets || dst_idx >= num_targets) {
+			goto invalid;
+		}
+
+		if (from_be16(&desc[10]) == 0) {
+			continue;
+		}
+
+		if (ctx->num_segs == DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT) {
+			goto invalid;
+		}
+
+		seg = &ctx->segs[ctx->num_segs];
+		seg->src = targets[src_idx];
+		seg->dst = targets[dst_idx];
+		seg->src_ch = target_chs[src_idx];
+		seg->dst_ch = target_chs[dst_idx];
+		seg->num_blocks = from_be16(&desc[10]);
+		seg->src_lba = from_be64(&desc[12]);
+		seg->dst_lba = from_be64(&desc[20]);
+
+		/* Data is copied block for block, so the DC bit doesn't matter. */
+		if (spdk_bdev_get_data_block_size(seg->src->bdev) !=
+		    spdk_bdev_get_data_block_size(seg->dst->bdev)) {
+			goto invalid;
+		}
+
+		if (spdk_bdev_scsi_check_lba_range(task, seg->src->bdev, seg->src_lba, seg->num_blocks) != 0 ||
+		    spdk_bdev_scsi_check_lba_range(task, seg->dst->bdev, seg->dst_lba, seg->num_blocks) != 0) {
+			return -1;
+		}
+
+		ctx->num_segs++;
+	}
+
+	return 0;
+
+invalid:
+	spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+				  SPDK_SCSI_SENSE_ILLEGAL_REQUEST, asc, ascq);
+	return -1;
+}
+
+static int
+spdk_bdev_scsi_extended_copy(struct spdk_scsi_task *task)
+{
+	struct spdk_bdev_scsi_xcopy_ctx *ctx;
+	uint8_t *cdb = task->cdb;
+	uint8_t *data;
+	uint32_t param_len, i;
+	int data_len = 0;
+	int rc;
+
+	if ((cdb[1] & 0x1f) != SPDK_SPC_EC_EXTENDED_COPY_LID1) {
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+					  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	param_len = from_be32(&cdb[10]);
+	if (param_len == 0) {
+		task->status = SPDK_SCSI_STATUS_GOOD;
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	/* The whole parameter list has to be available in this task. */
+	if (task->offset != 0 || task->length < param_len) {
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+					  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	data = spdk_scsi_task_gather_data(task, &data_len);
+	if (ctx == NULL || data == NULL) {
+		free(ctx);
+		spdk_dma_free(data);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	ctx->task = task;
+	rc = spdk_bdev_scsi_xcopy_parse(task, ctx, data, spdk_min((uint32_t)data_len, param_len));
+	spdk_dma_free(data);
+	if (rc != 0) {
+		free(ctx);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	task->data_transferred = task->length;
+
+	if (ctx->num_segs == 0) {
+		free(ctx);
+		task->status = SPDK_SCSI_STATUS_GOOD;
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	/* Size the work buffer by the largest segment so small copies stay cheap. */
+	for (i = 0; i < ctx->num_segs; i++) {
+		ctx->buf_len = spdk_max(ctx->buf_len, ctx->segs[i].num_blocks *
+					spdk_bdev_get_data_block_size(ctx->segs[i].src->bdev));
+	}
+	ctx->buf_len = spdk_min(ctx->buf_len, SPDK_WORK_XCOPY_BLOCK_SIZE);
+	ctx->buf = spdk_dma_malloc(ctx->buf_len, 0, NULL);
+	if (ctx->buf == NULL) {
+		free(ctx);
+		spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+					  SPDK_SCSI_SENSE_NO_SENSE,
+					  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+					  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+		return SPDK_SCSI_TASK_COMPLETE;
+	}
+
+	SPDK_DEBUGLOG(SPDK_LOG_SCSI, "Extended copy: %" PRIu32 " segments\n", ctx->num_segs);
+
+	rc = spdk_bdev_scsi_xcopy_read(ctx);
+	if (rc == SPDK_SCSI_TASK_COMPLETE) {
+		spdk_bdev_scsi_xcopy_free(ctx);
+	}
+
+	return rc;
+}
+
+static int
+spdk_bdev_scsi_copy_operating_parameters(struct spdk_bdev *bdev, uint8_t *data)
+{
+	uint32_t max_desc_len;
+	int len = 46;
+
+	max_desc_len = DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT * XCOPY_TARGET_DESCRIPTOR_SIZE +
+		       DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT * XCOPY_SEGMENT_DESCRIPTOR_SIZE;
+
+	/* AVAILABLE DATA */
+	to_be32(&data[0], len - 4);
+	/* SNLID(0): the copy is completed before status is returned */
+	data[4] = 1;
+	/* MAXIMUM TARGET DESCRIPTOR COUNT */
+	to_be16(&data[8], DEFAULT_MAX_XCOPY_TARGET_DESCRIPTOR_COUNT);
+	/* MAXIMUM SEGMENT DESCRIPTOR COUNT */
+	to_be16(&data[10], DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT);
+	/* MAXIMUM DESCRIPTOR LIST LENGTH */
+	to_be32(&data[12], max_desc_len);
+	/* MAXIMUM SEGMENT LENGTH: the NUMBER OF BLOCKS field is 16 bits */
+	to_be32(&data[16], 0xffff * spdk_bdev_get_data_block_size(bdev));
+	/* MAXIMUM INLINE DATA LENGTH, HELD DATA LIMIT and MAXIMUM STREAM DEVICE TRANSFER SIZE are 0 */
+	/* TOTAL CONCURRENT COPIES */
+	to_be16(&data[34], 0xff);
+	/* MAXIMUM CONCURRENT COPIES */
+	data[36] = 0xff;
+	/* DATA SEGMENT GRANULARITY (log 2) */
+	data[37] = spdk_u32log2(spdk_bdev_get_data_block_size(bdev));
+	/* IMPLEMENTED DESCRIPTOR LIST LENGTH */
+	data[43] = 2;
+	data[44] = XCOPY_BLOCK_TO_BLOCK_TYPE_CODE;
+	data[45] = XCOPY_ID_DESCRIPTOR_TYPE_CODE;
+
+	return len;
+}
+
+static int
+spdk_bdev_scsi_process_block(struct spdk_scsi_task *task)
+{
+	struct spdk_scsi_lun *lun = task->lun;
+	struct spdk_bdev *bdev = lun->bdev;
+	uint64_t lba;
+	uint32_t xfer_len;
+	uint32_t len = 0;
+	uint8_t *cdb = task->cdb;
+
+	/* XXX: We need to support FUA bit for writes! */
+	switch (cdb[0]) {
+	case SPDK_SBC_READ_6:
+	case SPDK_SBC_WRITE_6:
+		lba = (uint64_t)cdb[1] << 16;
+		lba |= (uint64_t)cdb[2] << 8;
+		lba |= (uint64_t)cdb[3];
+		xfer_len = cdb[4];
+		if (xfer_len == 0) {
+			xfer_len = 256;
+		}
+		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
+						cdb[0] == SPDK_SBC_READ_6);
+
+	case SPDK_SBC_READ_10:
+	case SPDK_SBC_WRITE_10:
+		lba = from_be32(&cdb[2]);
+		xfer_len = from_be16(&cdb[7]);
+		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
+						cdb[0] == SPDK_SBC_READ_10);
+
+	case SPDK_SBC_READ_12:
+	case SPDK_SBC_WRITE_12:
+		lba = from_be32(&cdb[2]);
+		xfer_len = from_be32(&cdb[6]);
+		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
+						cdb[0] == SPDK_SBC_READ_12);
+	case SPDK_SBC_READ_16:
+	case SPDK_SBC_WRITE_16:
+		lba = from_be64(&cdb[2]);
+		xfer_len = from_be32(&cdb[10]);
+		return spdk_bdev_scsi_readwrite(task, lba, xfer_len,
+						cdb[0] == SPDK_SBC_READ_16);
+
+	case SPDK_SBC_READ_CAPACITY_10: {
+		uint64_t num_blocks = spdk_bdev_get_num_blocks(bdev);
+		uint8_t buffer[8];
+
+		if (num_blocks - 1 > 0xffffffffULL) {
+			memset(buffer, 0xff, 4);
+		} else {
+			to_be32(buffer, num_blocks - 1);
+		}
+		to_be32(&buffer[4], spdk_bdev_get_data_block_size(bdev));
+
+		len = spdk_min(task->length, sizeof(buffer));
+		if (spdk_scsi_task_scatter_data(task, buffer, len) < 0) {
+			break;
+		}
+
+		task->data_transferred = len;
+		task->status = SPDK_SCSI_STATUS_GOOD;
+		break;
+	}
+
+	case SPDK_SPC_SERVICE_ACTION_IN_16:
+		switch (cdb[1] & 0x1f) { /* SERVICE ACTION */
+		case SPDK_SBC_SAI_READ_CAPACITY_16: {
+			uint8_t buffer[32] = {0};
+
+			to_be64(&buffer[0], spdk_bdev_get_num_blocks(bdev) - 1);
+			to_be32(&buffer[8], spdk_bdev_get_data_block_size(bdev));
+			/*
+			 * Set the TPE bit to 1 to indicate thin provisioning.
+			 * The position of TPE bit is the 7th bit in 14th byte
+			 * in READ CAPACITY (16) parameter data.
+			 */
+			if (spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_UNMAP)) {
+				buffer[14] |= 1 << 7;
+			}
+
+			len = spdk_min(from_be32(&cdb[10]), sizeof(buffer));
+			if (spdk_scsi_task_scatter_data(task, buffer, len) < 0) {
+				break;
+			}
+
+			task->data_transferred = len;
+			task->status = SPDK_SCSI_STATUS_GOOD;
+			break;
+		}
+
+		default:
+			return SPDK_SCSI_TASK_UNKNOWN;
+		}
+		break;
+
+	case SPDK_SBC_SYNCHRONIZE_CACHE_10:
+	case SPDK_SBC_SYNCHRONIZE_CACHE_16:
+		if (cdb[0] == SPDK_SBC_SYNCHRONIZE_CACHE_10) {
+			lba = from_be32(&cdb[2]);
+			len = from_be16(&cdb[7]);
+		} else {
+			lba = from_be64(&cdb[2]);
+			len = from_be32(&cdb[10]);
+		}
+
+		if (len == 0) {
+			len = spdk_bdev_get_num_blocks(bdev) - lba;
+		}
+
+		return spdk_bdev_scsi_sync(bdev, lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+					   task, lba, len);
+		break;
+
+	case SPDK_SBC_UNMAP:
+		return spdk_bdev_scsi_unmap(bdev, lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+					    task, NULL);
+
+	case SPDK_SBC_WRITE_SAME_10:
+	case SPDK_SBC_WRITE_SAME_16:
+		/* LBDATA(1) and PBDATA(2) are obsolete */
+		if (cdb[1] & 0x06) {
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+						  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			break;
+		}
+
+		if (cdb[0] == SPDK_SBC_WRITE_SAME_10) {
+			lba = from_be32(&cdb[2]);
+			len = from_be16(&cdb[7]);
+			return spdk_bdev_scsi_write_same(task, lba, len, false);
+		}
+
+		lba = from_be64(&cdb[2]);
+		len = from_be32(&cdb[10]);
+		/* NDOB(0): no data-out buffer, write zeroes */
+		return spdk_bdev_scsi_write_same(task, lba, len, cdb[1] & 0x01);
+
+	case SPDK_SBC_COMPARE_AND_WRITE:
+		lba = from_be64(&cdb[2]);
+		xfer_len = cdb[13];
+		return spdk_bdev_scsi_compare_and_write(task, lba, xfer_len);
+
+	default:
+		return SPDK_SCSI_TASK_UNKNOWN;
+	}
+
+	return SPDK_SCSI_TASK_COMPLETE;
+}
+
+static void
+spdk_bdev_scsi_process_block_resubmit(void *arg)
+{
+	struct spdk_scsi_task *task = arg;
+
+	spdk_bdev_scsi_process_block(task);
+}
+
+static int
+spdk_bdev_scsi_check_len(struct spdk_scsi_task *task, int len, int min_len)
+{
+	if (len >= min_len) {
+		return 0;
+	}
+
+	/* INVALID FIELD IN CDB */
+	spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+				  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+				  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+				  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+	return -1;
+}
+
+static int
+spdk_bdev_scsi_process_primary(struct spdk_scsi_task *task)
+{
+	struct spdk_scsi_lun *lun = task->lun;
+	struct spdk_bdev *bdev = lun->bdev;
+	int alloc_len = -1;
+	int data_len = -1;
+	uint8_t *cdb = task->cdb;
+	uint8_t *data = NULL;
+	int rc = 0;
+	int pllen, md = 0;
+	int pf, sp;
+	int bdlen = 0, llba;
+	int dbd, pc, page, subpage;
+	int cmd_parsed = 0;
+
+
+	switch (cdb[0]) {
+	case SPDK_SPC_INQUIRY:
+		alloc_len = from_be16(&cdb[3]);
+		data_len = spdk_max(4096, alloc_len);
+		data = spdk_dma_zmalloc(data_len, 0, NULL);
+		assert(data != NULL);
+		rc = spdk_bdev_scsi_inquiry(bdev, task, cdb, data, data_len);
+		data_len = spdk_min(rc, data_len);
+		if (rc < 0) {
+			break;
+		}
+
+		SPDK_LOGDUMP(SPDK_LOG_SCSI, "INQUIRY", data, data_len);
+		break;
+
+	case SPDK_SPC_REPORT_LUNS: {
+		int sel;
+
+		sel = cdb[2];
+		SPDK_DEBUGLOG(SPDK_LOG_SCSI, "sel=%x\n", sel);
+
+		alloc_len = from_be32(&cdb[6]);
+		rc = spdk_bdev_scsi_check_len(task, alloc_len, 16);
+		if (rc < 0) {
+			break;
+		}
+
+		data_len = spdk_max(4096, alloc_len);
+		data = spdk_dma_zmalloc(data_len, 0, NULL);
+		assert(data != NULL);
+		rc = spdk_bdev_scsi_report_luns(task->lun, sel, data, data_len);
+		data_len = rc;
+		if (rc < 0) {
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_NO_SENSE,
+						  SPDK_SCSI_ASC_NO_ADDITIONAL_SENSE,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			break;
+		}
+
+		SPDK_LOGDUMP(SPDK_LOG_SCSI, "REPORT LUNS", data, data_len);
+		break;
+	}
+
+	case SPDK_SPC_MODE_SELECT_6:
+	case SPDK_SPC_MODE_SELECT_10:
+		if (cdb[0] == SPDK_SPC_MODE_SELECT_6) {
+			/* MODE_SELECT(6) must have at least a 4 byte header. */
+			md = 4;
+			pllen = cdb[4];
+		} else {
+			/* MODE_SELECT(10) must have at least an 8 byte header. */
+			md = 8;
+			pllen = from_be16(&cdb[7]);
+		}
+
+		if (pllen == 0) {
+			break;
+		}
+
+		rc = spdk_bdev_scsi_check_len(task, pllen, md);
+		if (rc < 0) {
+			break;
+		}
+
+		data = spdk_scsi_task_gather_data(task, &rc);
+		if (rc < 0) {
+			break;
+		}
 
 		data_len = rc;
 		if (cdb[0] == SPDK_SPC_MODE_SELECT_6) {
@@ -2002,6 +3181,26 @@ spdk_bdev_scsi_process_primary(struct spdk_scsi_task *task)
 		break;
 	}
 
+	case SPDK_SPC_EXTENDED_COPY:
+		return spdk_bdev_scsi_extended_copy(task);
+
+	case SPDK_SPC_RECEIVE_COPY_RESULTS:
+		if ((cdb[1] & 0x1f) != SPDK_SPC_RCR_OPERATING_PARAMETERS) {
+			/* Copies are not held after completion, so there are no results to report */
+			spdk_scsi_task_set_status(task, SPDK_SCSI_STATUS_CHECK_CONDITION,
+						  SPDK_SCSI_SENSE_ILLEGAL_REQUEST,
+						  SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB,
+						  SPDK_SCSI_ASCQ_CAUSE_NOT_REPORTABLE);
+			rc = -1;
+			break;
+		}
+
+		alloc_len = from_be32(&cdb[10]);
+		data = spdk_dma_zmalloc(64, 0, NULL);
+		assert(data != NULL);
+		data_len = spdk_bdev_scsi_copy_operating_parameters(bdev, data);
+		break;
+
 	case SPDK_SPC_LOG_SELECT:
 		SPDK_DEBUGLOG(SPDK_LOG_SCSI, "LOG_SELECT\n");
 		cmd_parsed = 1;
@@ -2087,8 +3286,8 @@ spdk_bdev_scsi_reset(struct spdk_scsi_task *task)
 	struct spdk_scsi_lun *lun = task->lun;
 	int rc;
 
-	rc = spdk_bdev_reset(lun->bdev_desc, lun->io_channel, spdk_bdev_scsi_task_complete_reset,
-			     task);
+	rc = spdk_bdev_reset(lun->bdev_desc, spdk_scsi_task_get_io_channel(task),
+			     spdk_bdev_scsi_task_complete_reset, task);
 	if (rc == -ENOMEM) {
 		spdk_bdev_scsi_queue_io(task, spdk_bdev_scsi_reset_resubmit, task);
 	}
@@ -77,11 +77,53 @@ struct spdk_scsi_dev {
 
 struct spdk_scsi_desc {
 	struct spdk_scsi_lun		*lun;
+	/** I/O channel of the descriptor, used by the tasks submitted through it. */
+	struct spdk_scsi_lun_channel	*ch;
 	spdk_scsi_remove_cb_t		hotremove_cb;
 	void				*hotremove_ctx;
 	TAILQ_ENTRY(spdk_scsi_desc)	link;
 };
 
+/*
+ * I/O channel of a LUN, used from the thread it was allocated on only.
+ *  Transports opening the LUN allocate one per descriptor, e.g. per iSCSI
+ *  connection, and tasks find it through task->desc without locking.
+ *  Tasks without a descriptor use the channel of
+ *  spdk_scsi_dev_allocate_io_channels().
+ */
+struct spdk_scsi_lun_channel {
+	/** The LUN this channel belongs to. */
+	struct spdk_scsi_lun *lun;
+
+	/** The thread this channel was allocated on. */
+	struct spdk_thread *thread;
+
+	/** I/O channel for the bdev associated with the LUN on this thread. */
+	struct spdk_io_channel *io_channel;
+
+	/** The allocation and the messages sent to the channel. Protected by lun->mutex. */
+	uint32_t ref;
+
+	/** A message to run the pending tasks is outstanding. Protected by lun->mutex. */
+	bool kicked;
+
+	/**
+	 * Tasks received on this channel and not completed yet, and the part
+	 *  of them that was executed. Only the thread of the channel updates
+	 *  them; other threads read them with lun->mutex held.
+	 */
+	uint32_t num_tasks;
+	uint32_t num_submitted_tasks;
+
+	/** tasks received on this channel, waiting for management tasks */
+	TAILQ_HEAD(, spdk_scsi_task) pending_tasks;
+
+	/** management tasks received on this channel, waiting to be executed */
+	TAILQ_HEAD(, spdk_scsi_task) pending_mgmt_tasks;
+
+	TAILQ_ENTRY(spdk_scsi_lun_channel) link;
+};
+
 struct spdk_scsi_lun {
 	/** LUN id for this logical unit. */
 	int id;
@@ -95,11 +137,22 @@ struct spdk_scsi_lun {
 	/** Descriptor for opened block device. */
 	struct spdk_bdev_desc *bdev_desc;
 
-	/** I/O channel for the bdev associated with this LUN. */
-	struct spdk_io_channel *io_channel;
+	/**
+	 * Protects the channel list, descriptors, submitted management tasks
+	 *  and COMPARE AND WRITE lists of this LUN, since it may be used from
+	 *  several threads. Regular tasks don't take it.
+	 */
+	pthread_mutex_t mutex;
 
-	/**  The reference number for this LUN, thus we can correctly free the io_channel */
-	uint32_t ref;
+	/** I/O channels of this LUN. */
+	TAILQ_HEAD(, spdk_scsi_lun_channel) channels;
+
+	/** Channel of spdk_scsi_dev_allocate_io_channels() and its allocation count. */
+	struct spdk_scsi_lun_channel *dev_ch;
+	uint32_t dev_ch_ref;
+
+	/** Management tasks of all channels not completed yet. */
+	uint32_t num_mgmt_tasks;
 
 	/** Poller to release the resource of the lun when it is hot removed */
 	struct spdk_poller *hotremove_poller;
@@ -116,20 +169,20 @@ struct spdk_scsi_lun {
 	/** List of open descriptors for this LUN. */
 	TAILQ_HEAD(, spdk_scsi_desc) open_descs;
 
-	/** submitted tasks */
-	TAILQ_HEAD(tasks, spdk_scsi_task) tasks;
-
-	/** pending tasks */
-	TAILQ_HEAD(pending_tasks, spdk_scsi_task) pending_tasks;
-
 	/** submitted management tasks */
 	TAILQ_HEAD(mgmt_tasks, spdk_scsi_task) mgmt_tasks;
 
-	/** pending management tasks */
-	TAILQ_HEAD(pending_mgmt_tasks, spdk_scsi_task) pending_mgmt_tasks;
-
 	/** poller to check completion of tasks prior to reset */
 	struct spdk_poller *reset_poller;
+
+	/** COMPARE AND WRITE commands holding a lock on their LBA range */
+	TAILQ_HEAD(, spdk_bdev_scsi_caw_ctx) caw_locked;
+
+	/** COMPARE AND WRITE commands waiting for an overlapping lock to be released */
+	TAILQ_HEAD(, spdk_bdev_scsi_caw_ctx) caw_waiting;
+
+	/** COMPARE AND WRITE commands waiting for the rest of their data */
+	TAILQ_HEAD(, spdk_bdev_scsi_caw_ctx) caw_gathering;
 };
 
 struct spdk_lun_db_entry {
@@ -150,15 +203,18 @@ _spdk_scsi_lun *spdk_scsi_lun_construct(struct spdk_bdev *bdev,
 void spdk_scsi_lun_destruct(struct spdk_scsi_lun *lun);
 
 void spdk_scsi_lun_append_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task);
-void spdk_scsi_lun_execute_tasks(struct spdk_scsi_lun *lun);
+void spdk_scsi_lun_execute_tasks(struct spdk_scsi_lun_channel *ch);
 void spdk_scsi_lun_append_mgmt_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task);
-void spdk_scsi_lun_execute_mgmt_task(struct spdk_scsi_lun *lun);
-bool spdk_scsi_lun_has_pending_mgmt_tasks(const struct spdk_scsi_lun *lun);
+void spdk_scsi_lun_execute_mgmt_task(struct spdk_scsi_lun_channel *ch);
+bool spdk_scsi_lun_has_pending_mgmt_tasks(struct spdk_scsi_lun *lun);
 void spdk_scsi_lun_complete_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task);
 void spdk_scsi_lun_complete_reset_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *task);
-bool spdk_scsi_lun_has_pending_tasks(const struct spdk_scsi_lun *lun);
+bool spdk_scsi_lun_has_pending_tasks(struct spdk_scsi_lun *lun);
 int _spdk_scsi_lun_allocate_io_channel(struct spdk_scsi_lun *lun);
 void _spdk_scsi_lun_free_io_channel(struct spdk_scsi_lun *lun);
+struct spdk_io_channel *spdk_scsi_lun_get_io_channel(struct spdk_scsi_lun *lun);
+struct spdk_scsi_lun_channel *spdk_scsi_task_get_lun_channel(struct spdk_scsi_task *task);
+struct spdk_io_channel *spdk_scsi_task_get_io_channel(struct spdk_scsi_task *task);
 
 struct spdk_scsi_dev *spdk_scsi_dev_get_list(void);
 
@@ -168,6 +224,7 @@ void spdk_scsi_port_destruct(struct spdk_scsi_port *port);
 
 int spdk_bdev_scsi_execute(struct spdk_scsi_task *task);
 void spdk_bdev_scsi_reset(struct spdk_scsi_task *task);
+void spdk_bdev_scsi_caw_cleanup(struct spdk_scsi_lun *lun);
 
 bool spdk_scsi_bdev_get_dif_ctx(struct spdk_bdev *bdev, uint8_t *cdb, uint32_t offset,
 				struct spdk_dif_ctx *dif_ctx);
@@ -52,6 +52,12 @@
 
 #define SPDK_MSG_BATCH_SIZE		8
 
+#define SPDK_TIMER_WHEEL_LEVELS		4
+#define SPDK_TIMER_WHEEL_SLOT_BITS	8
+#define SPDK_TIMER_WHEEL_SLOTS		(1u << SPDK_TIMER_WHEEL_SLOT_BITS)
+#define SPDK_TIMER_WHEEL_SLOT_MASK	(SPDK_TIMER_WHEEL_SLOTS - 1)
+#define SPDK_TIMER_WHEEL_RANGE		(1ull << (SPDK_TIMER_WHEEL_LEVELS * SPDK_TIMER_WHEEL_SLOT_BITS))
+
 static pthread_mutex_t g_devlist_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static spdk_new_thread_fn g_new_thread_fn = NULL;
@@ -106,6 +112,38 @@ struct spdk_poller {
 	uint64_t			next_run_tick;
 	spdk_poller_fn			fn;
 	void				*arg;
+
+	uint64_t			run_count;
+	uint64_t			busy_count;
+	uint64_t			run_tsc;
+
+	char				name[SPDK_MAX_POLLER_NAME_LEN + 1];
+};
+
+TAILQ_HEAD(timer_pollers_head, spdk_poller);
+
+/*
+ * Hierarchical timer wheel holding the timed pollers of a thread.
+ *
+ * Time is kept in wheel units of (1 << shift) ticks, which is roughly one
+ *  microsecond. A slot on level n spans SPDK_TIMER_WHEEL_SLOTS^n units. Pollers
+ *  are inserted into the level matching the distance to their expiration, are
+ *  moved one level down each time the wheel turns past their slot, and are run
+ *  from level 0. Both insert and expire are O(1).
+ */
+struct spdk_timer_wheel {
+	/* Wheel time of the next level 0 slot to be processed. */
+	uint64_t			current;
+
+	/* Wheel time at which the higher levels were last cascaded. */
+	uint64_t			last_cascade;
+
+	uint32_t			shift;
+
+	/* Bitmap of non-empty slots, per level. */
+	uint64_t			slot_mask[SPDK_TIMER_WHEEL_LEVELS][SPDK_TIMER_WHEEL_SLOTS / 64];
+
+	struct timer_pollers_head	slots[SPDK_TIMER_WHEEL_LEVELS][SPDK_TIMER_WHEEL_SLOTS];
 };
 
 struct spdk_thread {
@@ -127,7 +165,7 @@ struct spdk_thread {
 	/**
 	 * Contains pollers running on this thread with a periodic timer.
 	 */
-	TAILQ_HEAD(timer_pollers_head, spdk_poller)	timer_pollers;
+	struct spdk_timer_wheel		timer_wheel;
 
 	struct spdk_ring		*messages;
 
@@ -161,6 +199,131 @@ _set_thread_name(const char *thread_name)
 #endif
 }
 
+static void
+_spdk_timer_wheel_init(struct spdk_timer_wheel *wheel, uint64_t now)
+{
+	uint64_t ticks_per_us;
+	uint32_t level, slot;
+
+	/* Use the largest power of 2 number of ticks that does not exceed one microsecond. */
+	ticks_per_us = spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	wheel->shift = ticks_per_us > 1 ? spdk_u32log2((uint32_t)spdk_min(ticks_per_us, UINT32_MAX)) : 0;
+	wheel->current = now >> wheel->shift;
+	wheel->last_cascade = UINT64_MAX;
+
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < SPDK_TIMER_WHEEL_SLOTS; slot++) {
+			TAILQ_INIT(&wheel->slots[level][slot]);
+		}
+	}
+	memset(wheel->slot_mask, 0, sizeof(wheel->slot_mask));
+}
+
+static inline uint32_t
+_spdk_timer_wheel_slot(uint64_t time, uint32_t level)
+{
+	return (time >> (level * SPDK_TIMER_WHEEL_SLOT_BITS)) & SPDK_TIMER_WHEEL_SLOT_MASK;
+}
+
+static void
+_spdk_timer_wheel_add(struct spdk_timer_wheel *wheel, struct spdk_poller *poller)
+{
+	uint64_t expires, delta;
+	uint32_t level, slot;
+
+	expires = spdk_max(poller->next_run_tick >> wheel->shift, wheel->current);
+	delta = expires - wheel->current;
+	if (delta >= SPDK_TIMER_WHEEL_RANGE) {
+		/* Park it in the last slot; it is re-inserted when that slot is cascaded. */
+		delta = SPDK_TIMER_WHEEL_RANGE - 1;
+		expires = wheel->current + delta;
+	}
+
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < (1ull << ((level + 1) * SPDK_TIMER_WHEEL_SLOT_BITS))) {
+			break;
+		}
+	}
+
+	slot = _spdk_timer_wheel_slot(expires, level);
+	TAILQ_INSERT_TAIL(&wheel->slots[level][slot], poller, tailq);
+	wheel->slot_mask[level][slot / 64] |= 1ull << (slot % 64);
+}
+
+/* Move all pollers out of a slot into the given (initialized) list. */
+static void
+_spdk_timer_wheel_take_slot(struct spdk_timer_wheel *wheel, uint32_t level, uint32_t slot,
+			    struct timer_pollers_head *list)
+{
+	TAILQ_SWAP(list, &wheel->slots[level][slot], spdk_poller, tailq);
+	wheel->slot_mask[level][slot / 64] &= ~(1ull << (slot % 64));
+}
+
+static void
+_spdk_timer_wheel_cascade(struct spdk_timer_wheel *wheel, uint32_t level, uint32_t slot)
+{
+	struct timer_pollers_head list = TAILQ_HEAD_INITIALIZER(list);
+	struct spdk_poller *poller;
+
+	_spdk_timer_wheel_take_slot(wheel, level, slot, &list);
+	while ((poller = TAILQ_FIRST(&list)) != NULL) {
+		TAILQ_REMOVE(&list, poller, tailq);
+		_spdk_timer_wheel_add(wheel, poller);
+	}
+}
+
+/* Find the first non-empty slot at or after start, or SPDK_TIMER_WHEEL_SLOTS if none. */
+static uint32_t
+_spdk_timer_wheel_find_slot(const uint64_t *mask, uint32_t start)
+{
+	uint32_t i;
+	uint64_t word;
+
+	for (i = start / 64; i < SPDK_TIMER_WHEEL_SLOTS / 64; i++) {
+		word = mask[i];
+		if (i == start / 64) {
+			word &= ~0ull << (start % 64);
+		}
+		if (word != 0) {
+			return i * 64 + __builtin_ctzll(word);
+		}
+	}
+
+	return SPDK_TIMER_WHEEL_SLOTS;
+}
+
+/*
+ * Return the wheel time of the next slot that needs attention after wheel->current,
+ *  either a level 0 slot with pollers or a higher level slot to be cascaded.
+ */
+static uint64_t
+_spdk_timer_wheel_next_event(struct spdk_timer_wheel *wheel)
+{
+	uint64_t next = UINT64_MAX, base, candidate;
+	uint32_t level, cur, slot, bits;
+
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+		bits = level * SPDK_TIMER_WHEEL_SLOT_BITS;
+		cur = _spdk_timer_wheel_slot(wheel->current, level);
+		base = wheel->current & ~((1ull << (bits + SPDK_TIMER_WHEEL_SLOT_BITS)) - 1);
+
+		slot = _spdk_timer_wheel_find_slot(wheel->slot_mask[level], cur + 1);
+		if (slot < SPDK_TIMER_WHEEL_SLOTS) {
+			candidate = base + ((uint64_t)slot << bits);
+		} else {
+			slot = _spdk_timer_wheel_find_slot(wheel->slot_mask[level], 0);
+			if (slot == SPDK_TIMER_WHEEL_SLOTS) {
+				continue;
+			}
+			candidate = base + (1ull << (bits + SPDK_TIMER_WHEEL_SLOT_BITS)) + ((uint64_t)slot << bits);
+		}
+
+		next = spdk_min(next, candidate);
+	}
+
+	return next;
+}
+
 int
 spdk_thread_lib_init(spdk_new_thread_fn new_thread_fn, size_t ctx_sz)
 {
@@ -214,11 +377,11 @@ spdk_thread_create(const char *name)
 
 	TAILQ_INIT(&thread->io_channels);
 	TAILQ_INIT(&thread->active_pollers);
-	TAILQ_INIT(&thread->timer_pollers);
 	SLIST_INIT(&thread->msg_cache);
 	thread->msg_cache_count = 0;
 
 	thread->tsc_last = spdk_get_ticks();
+	_spdk_timer_wheel_init(&thread->timer_wheel, thread->tsc_last);
 
 	thread->messages = spdk_ring_create(SPDK_RING_TYPE_MP_SC, 65536, SPDK_ENV_SOCKET_ID_ANY);
 	if (!thread->messages) {
@@ -271,6 +434,7 @@ spdk_thread_exit(struct spdk_thread *thread)
 	struct spdk_io_channel *ch;
 	struct spdk_msg *msg;
 	struct spdk_poller *poller, *ptmp;
+	uint32_t level, slot;
 
 	SPDK_DEBUGLOG(SPDK_LOG_THREAD, "Freeing thread %s\n", thread->name);
 
@@ -294,14 +458,18 @@ spdk_thread_exit(struct spdk_thread *thread)
 	}
 
 
-	TAILQ_FOREACH_SAFE(poller, &thread->timer_pollers, tailq, ptmp) {
-		if (poller->state == SPDK_POLLER_STATE_WAITING) {
-			SPDK_WARNLOG("poller %p still registered at thread exit\n",
-				     poller);
-		}
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < SPDK_TIMER_WHEEL_SLOTS; slot++) {
+			TAILQ_FOREACH_SAFE(poller, &thread->timer_wheel.slots[level][slot], tailq, ptmp) {
+				if (poller->state == SPDK_POLLER_STATE_WAITING) {
+					SPDK_WARNLOG("poller %p still registered at thread exit\n",
+						     poller);
+				}
 
-		TAILQ_REMOVE(&thread->timer_pollers, poller, tailq);
-		free(poller);
+				TAILQ_REMOVE(&thread->timer_wheel.slots[level][slot], poller, tailq);
+				free(poller);
+			}
+		}
 	}
 
 	pthread_mutex_lock(&g_devlist_mutex);
@@ -355,6 +523,93 @@ spdk_thread_get_from_ctx(void *ctx)
 	return SPDK_CONTAINEROF(ctx, struct spdk_thread, ctx);
 }
 
+/*
+ * Get count messages for sending from the local thread's message cache. When the
+ * cache runs dry it is refilled from the global mempool with a single bulk get,
+ * so one-way message flows do not touch the mempool for every message.
+ */
+static int
+_spdk_msg_alloc_bulk(struct spdk_thread *local_thread, struct spdk_msg **msgs, uint32_t count)
+{
+	struct spdk_msg *refill[SPDK_THREAD_MSG_BATCH_MAX];
+	uint32_t i = 0, j, remaining, refill_count;
+	int rc;
+
+	assert(count <= SPDK_THREAD_MSG_BATCH_MAX);
+
+	if (local_thread != NULL) {
+		while (i < count && local_thread->msg_cache_count > 0) {
+			msgs[i] = SLIST_FIRST(&local_thread->msg_cache);
+			assert(msgs[i] != NULL);
+			SLIST_REMOVE_HEAD(&local_thread->msg_cache, link);
+			local_thread->msg_cache_count--;
+			i++;
+		}
+	}
+
+	remaining = count - i;
+	if (remaining == 0) {
+		return 0;
+	}
+
+	refill_count = remaining;
+	if (local_thread != NULL) {
+		refill_count = spdk_max(remaining, SPDK_MSG_BATCH_SIZE);
+	}
+
+	rc = spdk_mempool_get_bulk(g_spdk_msg_mempool, (void **)refill, refill_count);
+	if (rc != 0 && refill_count > remaining) {
+		refill_count = remaining;
+		rc = spdk_mempool_get_bulk(g_spdk_msg_mempool, (void **)refill, refill_count);
+	}
+
+	if (rc != 0) {
+		/* Give back whatever was taken from the cache. */
+		while (i > 0) {
+			i--;
+			SLIST_INSERT_HEAD(&local_thread->msg_cache, msgs[i], link);
+			local_thread->msg_cache_count++;
+		}
+		return -ENOMEM;
+	}
+
+	for (j = 0; j < remaining; j++) {
+		msgs[i++] = refill[j];
+	}
+
+	for (; j < refill_count; j++) {
+		SLIST_INSERT_HEAD(&local_thread->msg_cache, refill[j], link);
+		local_thread->msg_cache_count++;
+	}
+
+	return 0;
+}
+
+/*
+ * Return messages to the local thread's message cache. Messages that do not fit
+ * in the cache are returned to the global mempool with a single bulk put.
+ */
+static void
+_spdk_msg_free_bulk(struct spdk_thread *local_thread, struct spdk_msg **msgs, uint32_t count)
+{
+	uint32_t i, put_count = 0;
+
+	for (i = 0; i < count; i++) {
+		if (local_thread != NULL && local_thread->msg_cache_count < SPDK_MSG_MEMPOOL_CACHE_SIZE) {
+			/* Insert the messages at the head. We want to re-use the hot
+			 * ones. */
+			SLIST_INSERT_HEAD(&local_thread->msg_cache, msgs[i], link);
+			local_thread->msg_cache_count++;
+		} else {
+			msgs[put_count++] = msgs[i];
+		}
+	}
+
+	if (put_count > 0) {
+		spdk_mempool_put_bulk(g_spdk_msg_mempool, (void **)msgs, put_count);
+	}
+}
+
 static inline uint32_t
 _spdk_msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 {
@@ -386,40 +641,129 @@ _spdk_msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 
 		assert(msg != NULL);
 		msg->fn(msg->arg);
-
-		if (thread->msg_cache_count < SPDK_MSG_MEMPOOL_CACHE_SIZE) {
-			/* Insert the messages at the head. We want to re-use the hot
-			 * ones. */
-			SLIST_INSERT_HEAD(&thread->msg_cache, msg, link);
-			thread->msg_cache_count++;
-		} else {
-			spdk_mempool_put(g_spdk_msg_mempool, msg);
-		}
 	}
 
+	_spdk_msg_free_bulk(thread, (struct spdk_msg **)messages, count);
+
 	return count;
 }
 
+/*
+ * Run a poller and account the time since *tsc to it. *tsc is advanced to the
+ *  end of the run, so back-to-back runs need only one tick read each.
+ */
+static inline int
+_spdk_poller_run(struct spdk_thread *thread, struct spdk_poller *poller, uint64_t *tsc)
+{
+	uint64_t end;
+	int rc;
+
+	poller->state = SPDK_POLLER_STATE_RUNNING;
+	rc = poller->fn(poller->arg);
+
+	end = spdk_get_ticks();
+	poller->run_count++;
+	poller->run_tsc += end - *tsc;
+	if (rc > 0) {
+		poller->busy_count++;
+	}
+
+	thread->stats.poller_runs++;
+	thread->stats.poller_tsc += end - *tsc;
+	*tsc = end;
+
+	return rc;
+}
+
 static void
 _spdk_poller_insert_timer(struct spdk_thread *thread, struct spdk_poller *poller, uint64_t now)
 {
-	struct spdk_poller *iter;
+	struct spdk_timer_wheel *wheel = &thread->timer_wheel;
+
+	if (thread->stats.timed_pollers == 0) {
+		/* The wheel is empty, so it can simply be moved to the current time. */
+		wheel->current = now >> wheel->shift;
+		wheel->last_cascade = UINT64_MAX;
+	}
 
 	poller->next_run_tick = now + poller->period_ticks;
+	_spdk_timer_wheel_add(wheel, poller);
+}
 
-	/*
-	 * Insert poller in the thread's timer_pollers list in sorted order by next scheduled
-	 * run time.
-	 */
-	TAILQ_FOREACH_REVERSE(iter, &thread->timer_pollers, timer_pollers_head, tailq) {
-		if (iter->next_run_tick <= poller->next_run_tick) {
-			TAILQ_INSERT_AFTER(&thread->timer_pollers, iter, poller, tailq);
-			return;
+static int
+_spdk_thread_run_timed_pollers(struct spdk_thread *thread, uint64_t now, uint64_t *tsc)
+{
+	struct spdk_timer_wheel *wheel = &thread->timer_wheel;
+	struct timer_pollers_head expired = TAILQ_HEAD_INITIALIZER(expired);
+	struct spdk_poller *poller;
+	uint64_t now_unit = now >> wheel->shift;
+	uint32_t level, slot;
+	int rc = 0;
+
+	while (wheel->current <= now_unit) {
+		slot = _spdk_timer_wheel_slot(wheel->current, 0);
+
+		if (slot == 0 && wheel->last_cascade != wheel->current) {
+			/* Level 0 wrapped around - move pollers down from the higher levels. */
+			for (level = 1; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+				_spdk_timer_wheel_cascade(wheel, level, _spdk_timer_wheel_slot(wheel->current, level));
+				if (_spdk_timer_wheel_slot(wheel->current, level) != 0) {
+					break;
+				}
+			}
+			wheel->last_cascade = wheel->current;
 		}
+
+		_spdk_timer_wheel_take_slot(wheel, 0, slot, &expired);
+		while ((poller = TAILQ_FIRST(&expired)) != NULL) {
+			int timer_rc = 0;
+
+			TAILQ_REMOVE(&expired, poller, tailq);
+
+			if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
+				thread->stats.timed_pollers--;
+				free(poller);
+				continue;
+			}
+
+			if (now < poller->next_run_tick) {
+				/* Expires later within the current wheel unit. */
+				_spdk_timer_wheel_add(wheel, poller);
+				continue;
+			}
+
+			timer_rc = _spdk_poller_run(thread, poller, tsc);
+
+			if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
+				thread->stats.timed_pollers--;
+				free(poller);
+				continue;
+			}
+
+			poller->state = SPDK_POLLER_STATE_WAITING;
+			poller->next_run_tick = now + poller->period_ticks;
+			_spdk_timer_wheel_add(wheel, poller);
+
+#ifdef DEBUG
+			if (timer_rc == -1) {
+				SPDK_DEBUGLOG(SPDK_LOG_THREAD, "Timed poller %p returned -1\n", poller);
+			}
+#endif
+
+			if (timer_rc > rc) {
+				rc = timer_rc;
+			}
+		}
+
+		if (!TAILQ_EMPTY(&wheel->slots[0][slot])) {
+			/* Some pollers in the current unit have not expired yet. */
+			break;
+		}
+
+		wheel->current = spdk_min(_spdk_timer_wheel_next_event(wheel), now_unit + 1);
 	}
 
-	/* No earlier pollers were found, so this poller must be the new head */
-	TAILQ_INSERT_HEAD(&thread->timer_pollers, poller, tailq);
+	return rc;
 }
 
 int
@@ -428,7 +772,8 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 	uint32_t msg_count;
 	struct spdk_thread *orig_thread;
 	struct spdk_poller *poller, *tmp;
-	int rc = 0;
+	uint64_t tsc;
+	int rc = 0, timer_rc;
 
 	orig_thread = _get_thread();
 	tls_thread = thread;
@@ -442,21 +787,24 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		rc = 1;
 	}
 
+	tsc = msg_count ? spdk_get_ticks() : now;
+
 	TAILQ_FOREACH_REVERSE_SAFE(poller, &thread->active_pollers,
 				   active_pollers_head, tailq, tmp) {
 		int poller_rc;
 
 		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
 			TAILQ_REMOVE(&thread->active_pollers, poller, tailq);
+			thread->stats.active_pollers--;
 			free(poller);
 			continue;
 		}
 
-		poller->state = SPDK_POLLER_STATE_RUNNING;
-		poller_rc = poller->fn(poller->arg);
+		poller_rc = _spdk_poller_run(thread, poller, &tsc);
 
 		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
 			TAILQ_REMOVE(&thread->active_pollers, poller, tailq);
+			thread->stats.active_pollers--;
 			free(poller);
 			continue;
 		}
@@ -475,42 +823,9 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 
 	}
 
-	TAILQ_FOREACH_SAFE(poller, &thread->timer_pollers, tailq, tmp) {
-		int timer_rc = 0;
-
-		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
-			TAILQ_REMOVE(&thread->timer_pollers, poller, tailq);
-			free(poller);
-			continue;
-		}
-
-		if (now < poller->next_run_tick) {
-			break;
-		}
-
-		poller->state = SPDK_POLLER_STATE_RUNNING;
-		timer_rc = poller->fn(poller->arg);
-
-		if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
-			TAILQ_REMOVE(&thread->timer_pollers, poller, tailq);
-			free(poller);
-			continue;
-		}
-
-		poller->state = SPDK_POLLER_STATE_WAITING;
-		TAILQ_REMOVE(&thread->timer_pollers, poller, tailq);
-		_spdk_poller_insert_timer(thread, poller, now);
-
-#ifdef DEBUG
-		if (timer_rc == -1) {
-			SPDK_DEBUGLOG(SPDK_LOG_THREAD, "Timed poller %p returned -1\n", poller);
-		}
-#endif
-
-		if (timer_rc > rc) {
-			rc = timer_rc;
-
-		}
+	timer_rc = _spdk_thread_run_timed_pollers(thread, now, &tsc);
+	if (timer_rc > rc) {
+		rc = timer_rc;
 	}
 
 	if (rc == 0) {
@@ -530,17 +845,44 @@ spdk_thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 	return rc;
 }
 
+static uint64_t
+_spdk_timer_wheel_slot_min(struct spdk_timer_wheel *wheel, uint32_t level, uint32_t slot)
+{
+	struct spdk_poller *poller;
+	uint64_t next = UINT64_MAX;
+
+	TAILQ_FOREACH(poller, &wheel->slots[level][slot], tailq) {
+		next = spdk_min(next, poller->next_run_tick);
+	}
+
+	return next;
+}
+
 uint64_t
 spdk_thread_next_poller_expiration(struct spdk_thread *thread)
 {
-	struct spdk_poller *poller;
+	struct spdk_timer_wheel *wheel = &thread->timer_wheel;
+	uint64_t next = UINT64_MAX;
+	uint32_t level, cur, slot;
+
+	/*
+	 * The earliest poller of each level lives either in the current slot (pending
+	 *  expiration or cascade) or in the first non-empty slot after it.
+	 */
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+		cur = _spdk_timer_wheel_slot(wheel->current, level);
+		next = spdk_min(next, _spdk_timer_wheel_slot_min(wheel, level, cur));
 
-	poller = TAILQ_FIRST(&thread->timer_pollers);
-	if (poller) {
-		return poller->next_run_tick;
+		slot = _spdk_timer_wheel_find_slot(wheel->slot_mask[level], cur + 1);
+		if (slot == SPDK_TIMER_WHEEL_SLOTS) {
+			slot = _spdk_timer_wheel_find_slot(wheel->slot_mask[level], 0);
+		}
+		if (slot != SPDK_TIMER_WHEEL_SLOTS && slot != cur) {
+			next = spdk_min(next, _spdk_timer_wheel_slot_min(wheel, level, slot));
+		}
 	}
 
-	return 0;
+	return next == UINT64_MAX ? 0 : next;
 }
 
 int
@@ -553,7 +895,7 @@ bool
 spdk_thread_has_pollers(struct spdk_thread *thread)
 {
 	if (TAILQ_EMPTY(&thread->active_pollers) &&
-	    TAILQ_EMPTY(&thread->timer_pollers)) {
+	    thread->stats.timed_pollers == 0) {
 		return false;
 	}
 
@@ -621,6 +963,52 @@ spdk_thread_get_stats(struct spdk_thread_stats *stats)
 	return 0;
 }
 
+static void
+_spdk_poller_get_stats(struct spdk_poller *poller, spdk_poller_stats_fn fn, void *ctx)
+{
+	struct spdk_poller_stats stats;
+
+	if (poller->state == SPDK_POLLER_STATE_UNREGISTERED) {
+		return;
+	}
+
+	stats.name = poller->name;
+	stats.period_ticks = poller->period_ticks;
+	stats.run_count = poller->run_count;
+	stats.busy_count = poller->busy_count;
+	stats.run_tsc = poller->run_tsc;
+
+	fn(ctx, &stats);
+}
+
+int
+spdk_thread_get_poller_stats(spdk_poller_stats_fn fn, void *ctx)
+{
+	struct spdk_thread *thread;
+	struct spdk_poller *poller;
+	uint32_t level, slot;
+
+	thread = _get_thread();
+	if (!thread) {
+		SPDK_ERRLOG("No thread allocated\n");
+		return -EINVAL;
+	}
+
+	TAILQ_FOREACH(poller, &thread->active_pollers, tailq) {
+		_spdk_poller_get_stats(poller, fn, ctx);
+	}
+
+	for (level = 0; level < SPDK_TIMER_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < SPDK_TIMER_WHEEL_SLOTS; slot++) {
+			TAILQ_FOREACH(poller, &thread->timer_wheel.slots[level][slot], tailq) {
+				_spdk_poller_get_stats(poller, fn, ctx);
+			}
+		}
+	}
+
+	return 0;
+}
+
 void
 spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx)
 {
@@ -635,22 +1023,10 @@ spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx
 
 	local_thread = _get_thread();
 
-	msg = NULL;
-	if (local_thread != NULL) {
-		if (local_thread->msg_cache_count > 0) {
-			msg = SLIST_FIRST(&local_thread->msg_cache);
-			assert(msg != NULL);
-			SLIST_REMOVE_HEAD(&local_thread->msg_cache, link);
-			local_thread->msg_cache_count--;
-		}
-	}
-
-	if (msg == NULL) {
-		msg = spdk_mempool_get(g_spdk_msg_mempool);
-		if (!msg) {
-			assert(false);
-			return;
-		}
+	rc = _spdk_msg_alloc_bulk(local_thread, &msg, 1);
+	if (rc != 0) {
+		assert(false);
+		return;
 	}
 
 	msg->fn = fn;
@@ -659,15 +1035,57 @@ spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx
 	rc = spdk_ring_enqueue(thread->messages, (void **)&msg, 1);
 	if (rc != 1) {
 		assert(false);
-		spdk_mempool_put(g_spdk_msg_mempool, msg);
+		_spdk_msg_free_bulk(local_thread, &msg, 1);
 		return;
 	}
 }
 
+int
+spdk_thread_send_msg_batch(const struct spdk_thread *thread, spdk_msg_fn fn,
+			   void **ctx, uint32_t count)
+{
+	struct spdk_thread *local_thread;
+	struct spdk_msg *msgs[SPDK_THREAD_MSG_BATCH_MAX];
+	uint32_t i;
+	int rc;
+
+	if (!thread || count == 0 || count > SPDK_THREAD_MSG_BATCH_MAX) {
+		return -EINVAL;
+	}
+
+	local_thread = _get_thread();
+
+	rc = _spdk_msg_alloc_bulk(local_thread, msgs, count);
+	if (rc != 0) {
+		return rc;
+	}
+
+	for (i = 0; i < count; i++) {
+		msgs[i]->fn = fn;
+		msgs[i]->arg = ctx[i];
+	}
+
+	if (spdk_ring_enqueue(thread->messages, (void **)msgs, count) != count) {
+		_spdk_msg_free_bulk(local_thread, msgs, count);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 struct spdk_poller *
 spdk_poller_register(spdk_poller_fn fn,
 		     void *arg,
 		     uint64_t period_microseconds)
+{
+	return spdk_poller_register_named(fn, arg, period_microseconds, NULL);
+}
+
+struct spdk_poller *
+spdk_poller_register_named(spdk_poller_fn fn,
+			   void *arg,
+			   uint64_t period_microseconds,
+			   const char *name)
 {
 	struct spdk_thread *thread;
 	struct spdk_poller *poller;
@@ -689,6 +1107,12 @@ spdk_poller_register(spdk_poller_fn fn,
 	poller->fn = fn;
 	poller->arg = arg;
 
+	if (name) {
+		snprintf(poller->name, sizeof(poller->name), "%s", name);
+	} else {
+		snprintf(poller->name, sizeof(poller->name), "%p", fn);
+	}
+
 	if (period_microseconds) {
 		quotient = period_microseconds / SPDK_SEC_TO_USEC;
 		remainder = period_microseconds % SPDK_SEC_TO_USEC;
@@ -701,8 +1125,10 @@ spdk_poller_register(spdk_poller_fn fn,
 
 	if (poller->period_ticks) {
 		_spdk_poller_insert_timer(thread, poller, spdk_get_ticks());
+		thread->stats.timed_pollers++;
 	} else {
 		TAILQ_INSERT_TAIL(&thread->active_pollers, poller, tailq);
+		thread->stats.active_pollers++;
 	}
 
 	return poller;
@@ -0,0 +1,526 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk/slab.h"
+#include "spdk/env.h"
+#include "spdk/log.h"
+#include "spdk/queue.h"
+
+#include "spdk/likely.h"
+#include "spdk/util.h"
+
+#define SLAB_ELE_ALIGN		64
+#define SLAB_MIN_CHUNK_SIZE	(64 * 1024)
+#define SLAB_MIN_CHUNK_ELES	8
+#define SLAB_FILL_BATCH		64
+
+struct spdk_slab_depot;
+
+/*
+ * Chunks are aligned to their (power of two) size, so the chunk an object
+ *  belongs to can be found by masking the address of the object. Objects start
+ *  at the beginning of the chunk and the header is kept at its end, so objects
+ *  whose size is a multiple of a power of two are aligned to it as well.
+ */
+struct spdk_slab_chunk {
+	struct spdk_slab_depot			*depot;
+	TAILQ_ENTRY(spdk_slab_chunk)		link;
+};
+
+#define SLAB_CHUNK_HDR_SIZE \
+	((sizeof(struct spdk_slab_chunk) + SLAB_ELE_ALIGN - 1) & ~(SLAB_ELE_ALIGN - 1))
+
+/* Free objects and chunks of one socket. */
+struct spdk_slab_depot {
+	struct spdk_slab			*slab;
+	int					socket_id;
+	struct spdk_ring			*ring;
+	TAILQ_HEAD(, spdk_slab_chunk)		chunks;
+	uint32_t				chunk_count;
+	TAILQ_ENTRY(spdk_slab_depot)		link;
+};
+
+struct spdk_slab_cache {
+	struct spdk_slab			*slab;
+	struct spdk_slab_depot			*depot;
+	uint32_t				size;
+	uint32_t				count;
+
+	uint64_t				get_count;
+	uint64_t				get_fail_count;
+	uint64_t				put_count;
+	uint64_t				remote_put_count;
+
+	TAILQ_ENTRY(spdk_slab_cache)		link;
+	void					*eles[];
+};
+
+struct spdk_slab {
+	char					name[SPDK_SLAB_NAME_MAX];
+	size_t					ele_size;
+	size_t					stride;
+	size_t					chunk_size;
+	uint32_t				eles_per_chunk;
+	uint32_t				max_count;
+
+	/* Everything below is protected by lock, except the counters. */
+	pthread_mutex_t				lock;
+	uint32_t				total_count;
+	struct spdk_slab_depot			*default_depot;
+	TAILQ_HEAD(, spdk_slab_depot)		depots;
+	TAILQ_HEAD(, spdk_slab_cache)		caches;
+
+	/* Operations that did not go through a cache, and those of freed caches. */
+	uint64_t				get_count;
+	uint64_t				get_fail_count;
+	uint64_t				put_count;
+	uint64_t				remote_put_count;
+};
+
+static inline struct spdk_slab_chunk *
+_spdk_slab_chunk(const struct spdk_slab *slab, void *ele)
+{
+	uintptr_t base = (uintptr_t)ele & ~((uintptr_t)slab->chunk_size - 1);
+
+	return (struct spdk_slab_chunk *)(base + slab->chunk_size - SLAB_CHUNK_HDR_SIZE);
+}
+
+static struct spdk_slab_depot *
+_spdk_slab_depot_create(struct spdk_slab *slab, int socket_id)
+{
+	struct spdk_slab_depot *depot;
+
+	depot = calloc(1, sizeof(*depot));
+	if (!depot) {
+		return NULL;
+	}
+
+	/* The ring must be able to hold every object of the slab. */
+	depot->ring = spdk_ring_create(SPDK_RING_TYPE_MP_MC, spdk_align32pow2(slab->max_count + 1),
+				       socket_id);
+	if (!depot->ring) {
+		free(depot);
+		return NULL;
+	}
+
+	depot->slab = slab;
+	depot->socket_id = socket_id;
+	TAILQ_INIT(&depot->chunks);
+	TAILQ_INSERT_TAIL(&slab->depots, depot, link);
+
+	return depot;
+}
+
+static void
+_spdk_slab_depot_free(struct spdk_slab_depot *depot)
+{
+	struct spdk_slab_chunk *chunk, *tmp;
+
+	TAILQ_FOREACH_SAFE(chunk, &depot->chunks, link, tmp) {
+		TAILQ_REMOVE(&depot->chunks, chunk, link);
+		spdk_dma_free((void *)((uintptr_t)chunk + SLAB_CHUNK_HDR_SIZE - depot->slab->chunk_size));
+	}
+
+	TAILQ_REMOVE(&depot->slab->depots, depot, link);
+	spdk_ring_free(depot->ring);
+	free(depot);
+}
+
+/* Allocate a new chunk for the depot. Must be called with the slab lock held. */
+static int
+_spdk_slab_depot_grow(struct spdk_slab_depot *depot)
+{
+	struct spdk_slab *slab = depot->slab;
+	struct spdk_slab_chunk *chunk;
+	void *eles[SLAB_FILL_BATCH];
+	uint32_t count, i, n;
+	uintptr_t base, ele;
+
+	count = spdk_min(slab->eles_per_chunk, slab->max_count - slab->total_count);
+	if (count == 0) {
+		return -ENOMEM;
+	}
+
+	base = (uintptr_t)spdk_dma_malloc_socket(slab->chunk_size, slab->chunk_size, NULL,
+			depot->socket_id);
+	if (!base) {
+		SPDK_ERRLOG("Unable to allocate %zu byte chunk for slab %s\n", slab->chunk_size, slab->name);
+		return -ENOMEM;
+	}
+
+	chunk = (struct spdk_slab_chunk *)(base + slab->chunk_size - SLAB_CHUNK_HDR_SIZE);
+	chunk->depot = depot;
+	TAILQ_INSERT_TAIL(&depot->chunks, chunk, link);
+	depot->chunk_count++;
+	slab->total_count += count;
+
+	ele = base;
+	for (i = 0; i < count; i += n) {
+		for (n = 0; n < SLAB_FILL_BATCH && i + n < count; n++) {
+			eles[n] = (void *)ele;
+			ele += slab->stride;
+		}
+
+		n = spdk_ring_enqueue(depot->ring, eles, n);
+		assert(n > 0);
+	}
+
+	return 0;
+}
+
+/*
+ * Take up to count free objects for the depot's socket. If the depot is empty,
+ *  it is grown by one chunk, and once the slab is at its maximum size free
+ *  objects of the other sockets are used instead.
+ */
+static uint32_t
+_spdk_slab_depot_get(struct spdk_slab_depot *depot, void **eles, uint32_t count)
+{
+	struct spdk_slab *slab = depot->slab;
+	struct spdk_slab_depot *other;
+	uint32_t n;
+
+	n = spdk_ring_dequeue(depot->ring, eles, count);
+	if (spdk_likely(n > 0)) {
+		return n;
+	}
+
+	pthread_mutex_lock(&slab->lock);
+
+	n = spdk_ring_dequeue(depot->ring, eles, count);
+	if (n == 0 && _spdk_slab_depot_grow(depot) == 0) {
+		n = spdk_ring_dequeue(depot->ring, eles, count);
+	}
+
+	if (n == 0) {
+		TAILQ_FOREACH(other, &slab->depots, link) {
+			n = spdk_ring_dequeue(other->ring, eles, count);
+			if (n > 0) {
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&slab->lock);
+
+	return n;
+}
+
+static inline void
+_spdk_slab_depot_put(struct spdk_slab_depot *depot, void **eles, uint32_t count)
+{
+	size_t rc __attribute__((unused));
+
+	rc = spdk_ring_enqueue(depot->ring, eles, count);
+	assert(rc == count);
+}
+
+struct spdk_slab *
+spdk_slab_create(const char *name, size_t ele_size, uint32_t max_count)
+{
+	struct spdk_slab *slab;
+	size_t chunk_size;
+
+	if (ele_size == 0 || max_count == 0 || max_count == UINT32_MAX) {
+		return NULL;
+	}
+
+	slab = calloc(1, sizeof(*slab));
+	if (!slab) {
+		return NULL;
+	}
+
+	snprintf(slab->name, sizeof(slab->name), "%s", name);
+	slab->ele_size = ele_size;
+	slab->stride = (ele_size + SLAB_ELE_ALIGN - 1) & ~(SLAB_ELE_ALIGN - 1);
+	slab->max_count = max_count;
+
+	chunk_size = SLAB_CHUNK_HDR_SIZE + SLAB_MIN_CHUNK_ELES * slab->stride;
+	if (chunk_size > UINT32_MAX / 2) {
+		free(slab);
+		return NULL;
+	}
+
+	slab->chunk_size = spdk_max(SLAB_MIN_CHUNK_SIZE, spdk_align32pow2(chunk_size));
+	slab->eles_per_chunk = (slab->chunk_size - SLAB_CHUNK_HDR_SIZE) / slab->stride;
+
+	pthread_mutex_init(&slab->lock, NULL);
+	TAILQ_INIT(&slab->depots);
+	TAILQ_INIT(&slab->caches);
+
+	slab->default_depot = _spdk_slab_depot_create(slab, SPDK_ENV_SOCKET_ID_ANY);
+	if (!slab->default_depot) {
+		pthread_mutex_destroy(&slab->lock);
+		free(slab);
+		return NULL;
+	}
+
+	return slab;
+}
+
+void
+spdk_slab_free(struct spdk_slab *slab)
+{
+	struct spdk_slab_depot *depot, *tmp;
+
+	if (!slab) {
+		return;
+	}
+
+	assert(TAILQ_EMPTY(&slab->caches));
+
+	TAILQ_FOREACH_SAFE(depot, &slab->depots, link, tmp) {
+		_spdk_slab_depot_free(depot);
+	}
+
+	pthread_mutex_destroy(&slab->lock);
+	free(slab);
+}
+
+const char *
+spdk_slab_get_name(const struct spdk_slab *slab)
+{
+	return slab->name;
+}
+
+void
+spdk_slab_get_stats(struct spdk_slab *slab, struct spdk_slab_stats *stats)
+{
+	struct spdk_slab_depot *depot;
+	struct spdk_slab_cache *cache;
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&slab->lock);
+
+	TAILQ_FOREACH(depot, &slab->depots, link) {
+		stats->chunk_count += depot->chunk_count;
+		stats->free_count += spdk_ring_count(depot->ring);
+	}
+
+	TAILQ_FOREACH(cache, &slab->caches, link) {
+		stats->free_count += cache->count;
+		stats->get_count += cache->get_count;
+		stats->get_fail_count += cache->get_fail_count;
+		stats->put_count += cache->put_count;
+		stats->remote_put_count += cache->remote_put_count;
+	}
+
+	stats->chunk_bytes = stats->chunk_count * slab->chunk_size;
+	stats->total_count = slab->total_count;
+	stats->get_count += slab->get_count;
+	stats->get_fail_count += slab->get_fail_count;
+	stats->put_count += slab->put_count;
+	stats->remote_put_count += slab->remote_put_count;
+
+	pthread_mutex_unlock(&slab->lock);
+}
+
+struct spdk_slab_cache *
+spdk_slab_cache_create(struct spdk_slab *slab, uint32_t size, int socket_id)
+{
+	struct spdk_slab_cache *cache;
+	struct spdk_slab_depot *depot;
+
+	cache = calloc(1, sizeof(*cache) + size * sizeof(void *));
+	if (!cache) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&slab->lock);
+
+	TAILQ_FOREACH(depot, &slab->depots, link) {
+		if (depot->socket_id == socket_id) {
+			break;
+		}
+	}
+
+	if (!depot) {
+		depot = _spdk_slab_depot_create(slab, socket_id);
+		if (!depot) {
+			pthread_mutex_unlock(&slab->lock);
+			free(cache);
+			return NULL;
+		}
+	}
+
+	cache->slab = slab;
+	cache->depot = depot;
+	cache->size = size;
+	TAILQ_INSERT_TAIL(&slab->caches, cache, link);
+
+	pthread_mutex_unlock(&slab->lock);
+
+	return cache;
+}
+
+void
+spdk_slab_cache_free(struct spdk_slab_cache *cache)
+{
+	struct spdk_slab *slab;
+
+	if (!cache) {
+		return;
+	}
+
+	slab = cache->slab;
+	if (cache->count > 0) {
+		_spdk_slab_depot_put(cache->depot, cache->eles, cache->count);
+	}
+
+	pthread_mutex_lock(&slab->lock);
+	TAILQ_REMOVE(&slab->caches, cache, link);
+	slab->get_count += cache->get_count;
+	slab->get_fail_count += cache->get_fail_count;
+	slab->put_count += cache->put_count;
+	slab->remote_put_count += cache->remote_put_count;
+	pthread_mutex_unlock(&slab->lock);
+
+	free(cache);
+}
+
+uint32_t
+spdk_slab_cache_count(const struct spdk_slab_cache *cache)
+{
+	return cache->count;
+}
+
+uint32_t
+spdk_slab_cache_refill(struct spdk_slab_cache *cache)
+{
+	if (cache->count == 0 && cache->size > 0) {
+		/* Refill half of the cache, leaving room for objects freed on this thread. */
+		cache->count = _spdk_slab_depot_get(cache->depot, cache->eles,
+						    spdk_max(cache->size / 2, 1));
+	}
+
+	return cache->count;
+}
+
+uint32_t
+spdk_slab_cache_fill(struct spdk_slab_cache *cache)
+{
+	uint32_t n;
+
+	while (cache->count < cache->size) {
+		n = _spdk_slab_depot_get(cache->depot, &cache->eles[cache->count],
+					 cache->size - cache->count);
+		if (n == 0) {
+			break;
+		}
+
+		cache->count += n;
+	}
+
+	return cache->count;
+}
+
+void *
+spdk_slab_get(struct spdk_slab *slab, struct spdk_slab_cache *cache)
+{
+	void *ele;
+
+	if (cache == NULL) {
+		if (_spdk_slab_depot_get(slab->default_depot, &ele, 1) == 0) {
+			__sync_fetch_and_add(&slab->get_fail_count, 1);
+			return NULL;
+		}
+
+		__sync_fetch_and_add(&slab->get_count, 1);
+		return ele;
+	}
+
+	assert(cache->slab == slab);
+
+	if (spdk_unlikely(cache->count == 0)) {
+		if (cache->size == 0) {
+			cache->count = _spdk_slab_depot_get(cache->depot, &ele, 1);
+			if (cache->count == 0) {
+				cache->get_fail_count++;
+				return NULL;
+			}
+
+			cache->count = 0;
+			cache->get_count++;
+			return ele;
+		}
+
+		if (spdk_slab_cache_refill(cache) == 0) {
+			cache->get_fail_count++;
+			return NULL;
+		}
+	}
+
+	cache->get_count++;
+	return cache->eles[--cache->count];
+}
+
+void
+spdk_slab_put(struct spdk_slab *slab, struct spdk_slab_cache *cache, void *ele)
+{
+	struct spdk_slab_depot *depot = _spdk_slab_chunk(slab, ele)->depot;
+	uint32_t keep;
+
+	assert(depot->slab == slab);
+
+	if (cache == NULL) {
+		_spdk_slab_depot_put(depot, &ele, 1);
+		__sync_fetch_and_add(&slab->put_count, 1);
+		return;
+	}
+
+	assert(cache->slab == slab);
+	cache->put_count++;
+
+	/* Objects of another socket go straight back home instead of into the cache. */
+	if (spdk_unlikely(depot != cache->depot)) {
+		_spdk_slab_depot_put(depot, &ele, 1);
+		cache->remote_put_count++;
+		return;
+	}
+
+	if (spdk_unlikely(cache->count == cache->size)) {
+		if (cache->size == 0) {
+			_spdk_slab_depot_put(depot, &ele, 1);
+			return;
+		}
+
+		keep = cache->size / 2;
+		_spdk_slab_depot_put(depot, &cache->eles[keep], cache->count - keep);
+		cache->count = keep;
+	}
+
+	cache->eles[cache->count++] = ele;
+}
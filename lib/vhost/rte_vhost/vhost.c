@@ -420,7 +420,12 @@ rte_vhost_enable_guest_notification(int vid, uint16_t queue_id, int enable)
 		return -1;
 	}
 
-	dev->virtqueue[queue_id]->used->flags = VRING_USED_F_NO_NOTIFY;
+	if (vq_is_packed(dev)) {
+		/* Disable flag in the device event suppression structure */
+		((volatile uint16_t *)dev->virtqueue[queue_id]->used)[1] = 0x1;
+	} else {
+		dev->virtqueue[queue_id]->used->flags = VRING_USED_F_NO_NOTIFY;
+	}
 	return 0;
 }
 
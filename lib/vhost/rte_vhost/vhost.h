@@ -43,6 +43,7 @@
 #include <sys/socket.h>
 #include <linux/if.h>
 
+#include <rte_common.h>
 #include <rte_log.h>
 #include <rte_ether.h>
 
@@ -126,6 +127,10 @@ struct vhost_virtqueue {
  #define VIRTIO_NET_F_MQ		22
 #endif
 
+#ifndef VIRTIO_F_RING_PACKED
+ #define VIRTIO_F_RING_PACKED 34
+#endif
+
 #define VHOST_MAX_VRING			0x100
 #define VHOST_MAX_QUEUE_PAIRS		0x80
 
@@ -209,10 +214,44 @@ struct virtio_net {
 
 #define VHOST_LOG_PAGE	4096
 
+/*
+ * The log may be written by several vhost threads at once, so all
+ * bitmap updates are atomic.
+ */
 static inline void __attribute__((always_inline))
 vhost_log_page(uint8_t *log_base, uint64_t page)
 {
-	log_base[page / 8] |= 1 << (page % 8);
+	__sync_fetch_and_or(&log_base[page / 8], (uint8_t)(1 << (page % 8)));
+}
+
+/*
+ * Mark pages [page, page + count) dirty. With a 64-bit aligned log on a
+ * little endian CPU, bit N of the bitmap is bit N % 64 of word N / 64,
+ * so the pages are set one word at a time instead of one bit at a time.
+ */
+static inline void __attribute__((always_inline))
+vhost_log_pages(uint8_t *log_base, uint64_t page, uint64_t count)
+{
+	uint64_t *log_words = (uint64_t *)log_base;
+	uint64_t bit, n, mask;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (likely(((uintptr_t)log_base & (sizeof(uint64_t) - 1)) == 0)) {
+		while (count > 0) {
+			bit = page % 64;
+			n = RTE_MIN(64 - bit, count);
+			mask = n == 64 ? UINT64_MAX : ((1ULL << n) - 1) << bit;
+			__sync_fetch_and_or(&log_words[page / 64], mask);
+			page += n;
+			count -= n;
+		}
+		return;
+	}
+#endif
+
+	while (count-- > 0) {
+		vhost_log_page(log_base, page++);
+	}
 }
 
 static inline void __attribute__((always_inline))
@@ -231,10 +270,8 @@ vhost_log_write(struct virtio_net *dev, uint64_t addr, uint64_t len)
 	rte_smp_wmb();
 
 	page = addr / VHOST_LOG_PAGE;
-	while (page * VHOST_LOG_PAGE < addr + len) {
-		vhost_log_page((uint8_t *)(uintptr_t)dev->log_base, page);
-		page += 1;
-	}
+	vhost_log_pages((uint8_t *)(uintptr_t)dev->log_base, page,
+			(addr + len - 1) / VHOST_LOG_PAGE - page + 1);
 }
 
 static inline void __attribute__((always_inline))
@@ -302,6 +339,13 @@ gpa_to_hpa(struct virtio_net *dev, uint64_t gpa, uint64_t size)
 struct virtio_net *get_device(int vid);
 
 int vhost_new_device(uint64_t features);
+
+static inline int
+vq_is_packed(struct virtio_net *dev)
+{
+	return !!(dev->negotiated_features & (1ULL << VIRTIO_F_RING_PACKED));
+}
+
 void cleanup_device(struct virtio_net *dev, int destroy);
 void reset_device(struct virtio_net *dev);
 void vhost_destroy_device(int);
@@ -387,7 +387,10 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 	/* addr->index refers to the queue index. The txq 1, rxq is 0. */
 	vq = dev->virtqueue[msg->payload.addr.index];
 
-	/* The addresses are converted from QEMU virtual to Vhost virtual. */
+	/*
+	 * The addresses are converted from QEMU virtual to Vhost virtual.
+	 * Packed descriptors have the same size as split ones.
+	 */
 	len = sizeof(struct vring_desc) * vq->size;
 	vq->desc = (struct vring_desc *)(uintptr_t)qva_to_vva(dev,
 			msg->payload.addr.desc_user_addr, &len);
@@ -401,6 +404,36 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 	dev = numa_realloc(dev, msg->payload.addr.index);
 	vq = dev->virtqueue[msg->payload.addr.index];
 
+	if (vq_is_packed(dev)) {
+		/*
+		 * The avail and used addresses of a packed virtqueue point
+		 * to the driver and device event suppression structures,
+		 * which are just 4 bytes each.
+		 */
+		len = sizeof(uint16_t) * 2;
+		vq->avail = (struct vring_avail *)(uintptr_t)qva_to_vva(dev,
+				msg->payload.addr.avail_user_addr, &len);
+		if (vq->avail == 0 || len != sizeof(uint16_t) * 2) {
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%d) failed to find driver area address.\n",
+				dev->vid);
+			return -1;
+		}
+
+		len = sizeof(uint16_t) * 2;
+		vq->used = (struct vring_used *)(uintptr_t)qva_to_vva(dev,
+				msg->payload.addr.used_user_addr, &len);
+		if (vq->used == 0 || len != sizeof(uint16_t) * 2) {
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%d) failed to find device area address.\n",
+				dev->vid);
+			return -1;
+		}
+
+		vq->log_guest_addr = msg->payload.addr.log_guest_addr;
+		return 0;
+	}
+
 	len = sizeof(struct vring_avail) + sizeof(uint16_t) * vq->size;
 	vq->avail = (struct vring_avail *)(uintptr_t)qva_to_vva(dev,
 			msg->payload.addr.avail_user_addr, &len);
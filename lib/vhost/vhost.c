@@ -110,6 +110,90 @@ void *spdk_vhost_gpa_to_vva(struct spdk_vhost_session *vsession, uint64_t addr,
 
 }
 
+#define SPDK_VHOST_LOG_PAGE_SIZE 0x1000
+
+/*
+ * Record a write to guest memory given by its guest physical address.
+ * Writes are gathered in page ranges, and a write that is adjacent
+ * to or overlaps the previous one just extends its range.
+ */
+static void
+spdk_vhost_vq_log_write(struct spdk_vhost_session *vsession,
+			struct spdk_vhost_virtqueue *virtqueue,
+			uint64_t addr, uint64_t len)
+{
+	struct spdk_vhost_log_range *range;
+	uint64_t first_page, last_page;
+
+	if (spdk_unlikely(len == 0)) {
+		return;
+	}
+
+	first_page = addr / SPDK_VHOST_LOG_PAGE_SIZE;
+	last_page = (addr + len - 1) / SPDK_VHOST_LOG_PAGE_SIZE;
+
+	if (virtqueue->log.range_cnt > 0) {
+		range = &virtqueue->log.ranges[virtqueue->log.range_cnt - 1];
+		if (first_page <= range->last_page + 1 && last_page + 1 >= range->first_page) {
+			range->first_page = spdk_min(range->first_page, first_page);
+			range->last_page = spdk_max(range->last_page, last_page);
+			return;
+		}
+
+		if (virtqueue->log.range_cnt == SPDK_VHOST_LOG_RANGES_MAX) {
+			spdk_vhost_vq_log_flush(vsession, virtqueue);
+		}
+	}
+
+	range = &virtqueue->log.ranges[virtqueue->log.range_cnt++];
+	range->first_page = first_page;
+	range->last_page = last_page;
+}
+
+/*
+ * Record a write to the used ring. The whole span between the lowest and
+ * the highest offset written since the last flush is logged at once.
+ */
+static void
+spdk_vhost_vq_log_used(struct spdk_vhost_virtqueue *virtqueue, uint32_t offset, uint32_t len)
+{
+	if (virtqueue->log.used_end == 0) {
+		virtqueue->log.used_start = offset;
+		virtqueue->log.used_end = offset + len;
+		return;
+	}
+
+	virtqueue->log.used_start = spdk_min(virtqueue->log.used_start, offset);
+	virtqueue->log.used_end = spdk_max(virtqueue->log.used_end, offset + len);
+}
+
+void
+spdk_vhost_vq_log_flush(struct spdk_vhost_session *vsession,
+			struct spdk_vhost_virtqueue *virtqueue)
+{
+	struct spdk_vhost_log_range *range;
+	uint16_t i;
+
+	if (spdk_likely(virtqueue->log.range_cnt == 0 && virtqueue->log.used_end == 0)) {
+		return;
+	}
+
+	for (i = 0; i < virtqueue->log.range_cnt; i++) {
+		range = &virtqueue->log.ranges[i];
+		rte_vhost_log_write(vsession->vid, range->first_page * SPDK_VHOST_LOG_PAGE_SIZE,
+				    (range->last_page - range->first_page + 1) * SPDK_VHOST_LOG_PAGE_SIZE);
+	}
+	virtqueue->log.range_cnt = 0;
+
+	if (virtqueue->log.used_end != 0) {
+		rte_vhost_log_used_vring(vsession->vid, virtqueue - vsession->virtqueue,
+					 virtqueue->log.used_start,
+					 virtqueue->log.used_end - virtqueue->log.used_start);
+		virtqueue->log.used_start = 0;
+		virtqueue->log.used_end = 0;
+	}
+}
+
 static void
 spdk_vhost_log_req_desc(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *virtqueue,
 			uint16_t req_id)
@@ -134,7 +218,7 @@ spdk_vhost_log_req_desc(struct spdk_vhost_session *vsession, struct spdk_vhost_v
 			 * doing so would require tracking those changes in each backed.
 			 * Also backend most likely will touch all/most of those pages so
 			 * for lets assume we touched all pages passed to as writeable buffers. */
-			rte_vhost_log_write(vsession->vid, desc->addr, desc->len);
+			spdk_vhost_vq_log_write(vsession, virtqueue, desc->addr, desc->len);
 		}
 		spdk_vhost_vring_desc_get_next(&desc, desc_table, desc_table_size);
 	} while (desc);
@@ -145,36 +229,73 @@ spdk_vhost_log_used_vring_elem(struct spdk_vhost_session *vsession,
 			       struct spdk_vhost_virtqueue *virtqueue,
 			       uint16_t idx)
 {
-	uint64_t offset, len;
-	uint16_t vq_idx;
-
 	if (spdk_likely(!spdk_vhost_dev_has_feature(vsession, VHOST_F_LOG_ALL))) {
 		return;
 	}
 
-	offset = offsetof(struct vring_used, ring[idx]);
-	len = sizeof(virtqueue->vring.used->ring[idx]);
-	vq_idx = virtqueue - vsession->virtqueue;
+	spdk_vhost_vq_log_used(virtqueue, offsetof(struct vring_used, ring[idx]),
+			       sizeof(virtqueue->vring.used->ring[idx]));
+}
+
+/*
+ * Log a write to guest memory given by its vhost virtual address. Used
+ * where the guest physical address is no longer known, e.g. for packed
+ * virtqueues whose descriptors are overwritten by used elements.
+ */
+static void
+spdk_vhost_log_vva(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *virtqueue,
+		   uintptr_t vva, uint64_t len)
+{
+	struct rte_vhost_mem_region *region;
+	uint64_t region_len;
+	uint32_t i;
+
+	while (len > 0) {
+		for (i = 0; i < vsession->mem->nregions; i++) {
+			region = &vsession->mem->regions[i];
+			if (vva >= region->host_user_addr && vva < region->host_user_addr + region->size) {
+				break;
+			}
+		}
 
-	rte_vhost_log_used_vring(vsession->vid, vq_idx, offset, len);
+		if (spdk_unlikely(i == vsession->mem->nregions)) {
+			SPDK_ERRLOG("Can't log write to unmapped address %p\n", (void *)vva);
+			return;
+		}
+
+		region_len = spdk_min(len, region->host_user_addr + region->size - vva);
+		spdk_vhost_vq_log_write(vsession, virtqueue,
+					vva - region->host_user_addr + region->guest_phys_addr, region_len);
+		vva += region_len;
+		len -= region_len;
+	}
+}
+
+void
+spdk_vhost_log_iovs(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *virtqueue,
+		    const struct iovec *iovs, uint16_t iovcnt)
+{
+	uint16_t i;
+
+	if (spdk_likely(!spdk_vhost_dev_has_feature(vsession, VHOST_F_LOG_ALL))) {
+		return;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		spdk_vhost_log_vva(vsession, virtqueue, (uintptr_t)iovs[i].iov_base, iovs[i].iov_len);
+	}
 }
 
 static void
 spdk_vhost_log_used_vring_idx(struct spdk_vhost_session *vsession,
 			      struct spdk_vhost_virtqueue *virtqueue)
 {
-	uint64_t offset, len;
-	uint16_t vq_idx;
-
 	if (spdk_likely(!spdk_vhost_dev_has_feature(vsession, VHOST_F_LOG_ALL))) {
 		return;
 	}
 
-	offset = offsetof(struct vring_used, idx);
-	len = sizeof(virtqueue->vring.used->idx);
-	vq_idx = virtqueue - vsession->virtqueue;
-
-	rte_vhost_log_used_vring(vsession->vid, vq_idx, offset, len);
+	spdk_vhost_vq_log_used(virtqueue, offsetof(struct vring_used, idx),
+			       sizeof(virtqueue->vring.used->idx));
 }
 
 /*
@@ -255,12 +376,15 @@ int
 spdk_vhost_vq_used_signal(struct spdk_vhost_session *vsession,
 			  struct spdk_vhost_virtqueue *virtqueue)
 {
+	spdk_vhost_vq_log_flush(vsession, virtqueue);
+
 	if (virtqueue->used_req_cnt == 0) {
 		return 0;
 	}
 
 	virtqueue->req_cnt += virtqueue->used_req_cnt;
 	virtqueue->used_req_cnt = 0;
+	virtqueue->irq_cnt++;
 
 	SPDK_DEBUGLOG(SPDK_LOG_VHOST_RING,
 		      "Queue %td - USED RING: sending IRQ: last used %"PRIu16"\n",
@@ -271,8 +395,45 @@ spdk_vhost_vq_used_signal(struct spdk_vhost_session *vsession,
 }
 
 
+/*
+ * Number of descriptors the guest made available that were not returned
+ * in the used ring yet.
+ */
+static inline uint16_t
+spdk_vhost_vq_inflight_cnt(struct spdk_vhost_virtqueue *virtqueue)
+{
+	if (spdk_unlikely(virtqueue->packed.packed_ring)) {
+		if (virtqueue->packed.avail_phase == virtqueue->packed.used_phase) {
+			return virtqueue->last_avail_idx - virtqueue->last_used_idx;
+		}
+
+		return virtqueue->last_avail_idx + virtqueue->vring.size - virtqueue->last_used_idx;
+	}
+
+	return virtqueue->last_avail_idx - virtqueue->last_used_idx;
+}
+
+static uint32_t
+spdk_vhost_vq_adaptive_irq_delay(struct spdk_vhost_session *vsession, uint32_t req_cnt)
+{
+	uint64_t target_latency = vsession->coalescing_target_latency;
+	uint64_t interval = vsession->stats_check_interval;
+
+	/*
+	 * Don't delay events if fewer than two completions are expected
+	 * within the latency budget - there would be nothing to coalesce.
+	 */
+	if (req_cnt * target_latency < 2 * interval) {
+		return 0;
+	}
+
+	return spdk_min(target_latency,
+			interval * SPDK_VHOST_ADAPTIVE_COALESCING_MAX_BATCH / req_cnt);
+}
+
 static void
-check_session_io_stats(struct spdk_vhost_session *vsession, uint64_t now)
+check_session_io_stats(struct spdk_vhost_session *vsession, uint16_t first_q, uint16_t num_q,
+		       uint64_t *next_stats_check_time, uint64_t now)
 {
 	struct spdk_vhost_virtqueue *virtqueue;
 	uint32_t irq_delay_base = vsession->coalescing_delay_time_base;
@@ -281,15 +442,32 @@ check_session_io_stats(struct spdk_vhost_session *vsession, uint64_t now)
 	uint32_t req_cnt;
 	uint16_t q_idx;
 
-	if (now < vsession->next_stats_check_time) {
+	if (now < *next_stats_check_time) {
 		return;
 	}
 
-	vsession->next_stats_check_time = now + vsession->stats_check_interval;
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	*next_stats_check_time = now + vsession->stats_check_interval;
+	for (q_idx = first_q; q_idx < first_q + num_q; q_idx++) {
 		virtqueue = &vsession->virtqueue[q_idx];
 
 		req_cnt = virtqueue->req_cnt + virtqueue->used_req_cnt;
+		if (vsession->coalescing_target_latency != 0) {
+			virtqueue->irq_delay_time = spdk_vhost_vq_adaptive_irq_delay(vsession, req_cnt);
+			virtqueue->irq_delay_adaptive = true;
+			virtqueue->req_cnt = 0;
+			continue;
+		}
+
+		if (spdk_unlikely(virtqueue->irq_delay_adaptive)) {
+			/*
+			 * Adaptive coalescing was turned off. Its delay may be much longer
+			 * than the static one, so start over without any delay.
+			 */
+			virtqueue->irq_delay_adaptive = false;
+			virtqueue->irq_delay_time = 0;
+			virtqueue->next_event_time = now;
+		}
+
 		if (req_cnt <= io_threshold) {
 			continue;
 		}
@@ -302,19 +480,37 @@ check_session_io_stats(struct spdk_vhost_session *vsession, uint64_t now)
 	}
 }
 
+static inline bool
+spdk_vhost_vq_event_is_suppressed(struct spdk_vhost_virtqueue *virtqueue)
+{
+	struct vring_packed_desc_event *driver_event;
+
+	if (spdk_unlikely(virtqueue->packed.packed_ring)) {
+		driver_event = (struct vring_packed_desc_event *)virtqueue->vring.avail;
+		return driver_event->flags == VRING_PACKED_EVENT_FLAG_DISABLE;
+	}
+
+	return virtqueue->vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT;
+}
+
 void
-spdk_vhost_session_used_signal(struct spdk_vhost_session *vsession)
+spdk_vhost_session_used_signal_range(struct spdk_vhost_session *vsession, uint16_t first_q,
+				     uint16_t num_q, uint64_t *next_stats_check_time)
 {
 	struct spdk_vhost_virtqueue *virtqueue;
 	uint64_t now;
 	uint16_t q_idx;
 
-	if (vsession->coalescing_delay_time_base == 0) {
-		for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	assert(first_q + num_q <= vsession->max_queues);
+
+	if (vsession->coalescing_delay_time_base == 0 &&
+	    vsession->coalescing_target_latency == 0) {
+		for (q_idx = first_q; q_idx < first_q + num_q; q_idx++) {
 			virtqueue = &vsession->virtqueue[q_idx];
+			spdk_vhost_vq_log_flush(vsession, virtqueue);
 
 			if (virtqueue->vring.desc == NULL ||
-			    (virtqueue->vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT)) {
+			    spdk_vhost_vq_event_is_suppressed(virtqueue)) {
 				continue;
 			}
 
@@ -322,14 +518,24 @@ spdk_vhost_session_used_signal(struct spdk_vhost_session *vsession)
 		}
 	} else {
 		now = spdk_get_ticks();
-		check_session_io_stats(vsession, now);
+		check_session_io_stats(vsession, first_q, num_q, next_stats_check_time, now);
 
-		for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+		for (q_idx = first_q; q_idx < first_q + num_q; q_idx++) {
 			virtqueue = &vsession->virtqueue[q_idx];
+			spdk_vhost_vq_log_flush(vsession, virtqueue);
 
-			/* No need for event right now */
-			if (now < virtqueue->next_event_time ||
-			    (virtqueue->vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT)) {
+			if (spdk_vhost_vq_event_is_suppressed(virtqueue)) {
+				continue;
+			}
+
+			/*
+			 * No need for event right now. In adaptive mode, the guest is
+			 * notified immediately if it has no more requests in flight, as
+			 * it would have to wait for the event anyway.
+			 */
+			if (now < virtqueue->next_event_time &&
+			    (vsession->coalescing_target_latency == 0 ||
+			     spdk_vhost_vq_inflight_cnt(virtqueue) != 0)) {
 				continue;
 			}
 
@@ -344,6 +550,13 @@ spdk_vhost_session_used_signal(struct spdk_vhost_session *vsession)
 	}
 }
 
+void
+spdk_vhost_session_used_signal(struct spdk_vhost_session *vsession)
+{
+	spdk_vhost_session_used_signal_range(vsession, 0, vsession->max_queues,
+					     &vsession->next_stats_check_time);
+}
+
 static int
 spdk_vhost_session_set_coalescing(struct spdk_vhost_dev *vdev,
 				  struct spdk_vhost_session *vsession, void *ctx)
@@ -357,6 +570,8 @@ spdk_vhost_session_set_coalescing(struct spdk_vhost_dev *vdev,
 		vdev->coalescing_delay_us * spdk_get_ticks_hz() / 1000000ULL;
 	vsession->coalescing_io_rate_threshold =
 		vdev->coalescing_iops_threshold * SPDK_VHOST_STATS_CHECK_INTERVAL_MS / 1000U;
+	vsession->coalescing_target_latency =
+		vdev->coalescing_target_latency_us * spdk_get_ticks_hz() / 1000000ULL;
 	return 0;
 }
 
@@ -396,6 +611,28 @@ spdk_vhost_get_coalescing(struct spdk_vhost_dev *vdev, uint32_t *delay_base_us,
 	}
 }
 
+int
+spdk_vhost_set_adaptive_coalescing(struct spdk_vhost_dev *vdev, uint32_t target_latency_us)
+{
+	uint64_t target_latency = target_latency_us * spdk_get_ticks_hz() / 1000000ULL;
+
+	if (target_latency >= UINT32_MAX) {
+		SPDK_ERRLOG("Target latency of %"PRIu32" is too big\n", target_latency_us);
+		return -EINVAL;
+	}
+
+	vdev->coalescing_target_latency_us = target_latency_us;
+
+	spdk_vhost_dev_foreach_session(vdev, spdk_vhost_session_set_coalescing, NULL);
+	return 0;
+}
+
+uint32_t
+spdk_vhost_get_adaptive_coalescing(struct spdk_vhost_dev *vdev)
+{
+	return vdev->coalescing_target_latency_us;
+}
+
 /*
  * Enqueue id and len to used ring.
  */
@@ -463,14 +700,12 @@ spdk_vhost_vring_desc_is_wr(struct vring_desc *cur_desc)
 	return !!(cur_desc->flags & VRING_DESC_F_WRITE);
 }
 
-int
-spdk_vhost_vring_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
-			     uint16_t *iov_index, const struct vring_desc *desc)
+static int
+spdk_vhost_vring_desc_payload_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
+				     uint16_t *iov_index, uintptr_t payload, uint32_t remaining)
 {
-	uint32_t remaining = desc->len;
 	uint32_t to_boundary;
 	uint32_t len;
-	uintptr_t payload = desc->addr;
 	uintptr_t vva;
 
 	do {
@@ -513,6 +748,187 @@ spdk_vhost_vring_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *
 	return 0;
 }
 
+int
+spdk_vhost_vring_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
+			     uint16_t *iov_index, const struct vring_desc *desc)
+{
+	return spdk_vhost_vring_desc_payload_to_iov(vsession, iov, iov_index,
+			desc->addr, desc->len);
+}
+
+static inline struct vring_packed_desc *
+spdk_vhost_vq_packed_desc(struct spdk_vhost_virtqueue *virtqueue, uint16_t idx)
+{
+	return &((struct vring_packed_desc *)virtqueue->vring.desc)[idx];
+}
+
+bool
+spdk_vhost_vq_packed_ring_is_avail(struct spdk_vhost_virtqueue *virtqueue)
+{
+	uint16_t flags;
+	bool avail, used;
+
+	flags = *(volatile uint16_t *)&spdk_vhost_vq_packed_desc(virtqueue,
+			virtqueue->last_avail_idx)->flags;
+	avail = !!(flags & SPDK_VRING_DESC_F_AVAIL);
+	used = !!(flags & SPDK_VRING_DESC_F_USED);
+
+	/*
+	 * The driver makes a descriptor available by setting its AVAIL flag
+	 * to the driver wrap counter and its USED flag to the inverse of it.
+	 */
+	if (avail != virtqueue->packed.avail_phase || used == virtqueue->packed.avail_phase) {
+		return false;
+	}
+
+	/* Don't read the rest of the descriptor before its flags. */
+	spdk_smp_rmb();
+	return true;
+}
+
+uint16_t
+spdk_vhost_vring_packed_desc_get_buffer_id(struct spdk_vhost_virtqueue *virtqueue,
+		uint16_t req_idx, uint16_t *num_descs)
+{
+	struct vring_packed_desc *desc;
+
+	*num_descs = 1;
+	desc = spdk_vhost_vq_packed_desc(virtqueue, req_idx);
+
+	/* Requests with an indirect table always take a single ring descriptor. */
+	while ((desc->flags & VRING_DESC_F_NEXT) && *num_descs < virtqueue->vring.size) {
+		req_idx = (req_idx + 1) % virtqueue->vring.size;
+		desc = spdk_vhost_vq_packed_desc(virtqueue, req_idx);
+		(*num_descs)++;
+	}
+
+	return desc->id;
+}
+
+void
+spdk_vhost_vq_packed_ring_consume(struct spdk_vhost_virtqueue *virtqueue, uint16_t num_descs)
+{
+	virtqueue->last_avail_idx += num_descs;
+	if (virtqueue->last_avail_idx >= virtqueue->vring.size) {
+		virtqueue->last_avail_idx -= virtqueue->vring.size;
+		virtqueue->packed.avail_phase = !virtqueue->packed.avail_phase;
+	}
+}
+
+int
+spdk_vhost_vq_get_desc_packed(struct spdk_vhost_session *vsession,
+			      struct spdk_vhost_virtqueue *virtqueue, uint16_t req_idx,
+			      struct vring_packed_desc **desc,
+			      struct vring_packed_desc **desc_table, uint32_t *desc_table_size)
+{
+	if (spdk_unlikely(req_idx >= virtqueue->vring.size)) {
+		return -1;
+	}
+
+	*desc = spdk_vhost_vq_packed_desc(virtqueue, req_idx);
+
+	if ((*desc)->flags & VRING_DESC_F_INDIRECT) {
+		assert(spdk_vhost_dev_has_feature(vsession, VIRTIO_RING_F_INDIRECT_DESC));
+		*desc_table_size = (*desc)->len / sizeof(**desc);
+		*desc_table = spdk_vhost_gpa_to_vva(vsession, (*desc)->addr,
+						    sizeof(**desc) * *desc_table_size);
+		*desc = *desc_table;
+		if (*desc == NULL || *desc_table_size == 0) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+	*desc_table = NULL;
+	*desc_table_size = 0;
+	return 0;
+}
+
+int
+spdk_vhost_vring_packed_desc_get_next(struct vring_packed_desc **desc, uint16_t *req_idx,
+				      struct spdk_vhost_virtqueue *virtqueue,
+				      struct vring_packed_desc *desc_table,
+				      uint32_t desc_table_size)
+{
+	uint32_t next_idx;
+
+	if (desc_table != NULL) {
+		/* Descriptors of an indirect table are consecutive and don't use the NEXT flag. */
+		next_idx = *desc - desc_table + 1;
+		*desc = next_idx < desc_table_size ? &desc_table[next_idx] : NULL;
+		return 0;
+	}
+
+	if (((*desc)->flags & VRING_DESC_F_NEXT) == 0) {
+		*desc = NULL;
+		return 0;
+	}
+
+	*req_idx = (*req_idx + 1) % virtqueue->vring.size;
+	*desc = spdk_vhost_vq_packed_desc(virtqueue, *req_idx);
+	return 0;
+}
+
+bool
+spdk_vhost_vring_packed_desc_is_wr(struct vring_packed_desc *cur_desc)
+{
+	return !!(cur_desc->flags & VRING_DESC_F_WRITE);
+}
+
+int
+spdk_vhost_vring_packed_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
+				    uint16_t *iov_index, const struct vring_packed_desc *desc)
+{
+	return spdk_vhost_vring_desc_payload_to_iov(vsession, iov, iov_index,
+			desc->addr, desc->len);
+}
+
+void
+spdk_vhost_vq_packed_ring_enqueue(struct spdk_vhost_session *vsession,
+				  struct spdk_vhost_virtqueue *virtqueue, uint16_t num_descs,
+				  uint16_t buffer_id, uint32_t length)
+{
+	struct vring_packed_desc *desc;
+	uint16_t flags;
+
+	SPDK_DEBUGLOG(SPDK_LOG_VHOST_RING,
+		      "Queue %td - PACKED RING: last_used_idx=%"PRIu16" buffer id=%"PRIu16" len=%"PRIu32"\n",
+		      virtqueue - vsession->virtqueue, virtqueue->last_used_idx, buffer_id, length);
+
+	desc = spdk_vhost_vq_packed_desc(virtqueue, virtqueue->last_used_idx);
+	desc->id = buffer_id;
+	desc->len = length;
+
+	/*
+	 * The device marks a descriptor as used by setting both its AVAIL and
+	 * USED flags to the device wrap counter. This must not be visible
+	 * before the buffer ID and length.
+	 */
+	flags = length ? VRING_DESC_F_WRITE : 0;
+	if (virtqueue->packed.used_phase) {
+		flags |= SPDK_VRING_DESC_F_AVAIL_USED;
+	}
+
+	spdk_smp_wmb();
+	*(volatile uint16_t *)&desc->flags = flags;
+
+	if (spdk_unlikely(spdk_vhost_dev_has_feature(vsession, VHOST_F_LOG_ALL))) {
+		spdk_vhost_log_vva(vsession, virtqueue, (uintptr_t)desc, sizeof(*desc));
+	}
+
+	virtqueue->last_used_idx += num_descs;
+	if (virtqueue->last_used_idx >= virtqueue->vring.size) {
+		virtqueue->last_used_idx -= virtqueue->vring.size;
+		virtqueue->packed.used_phase = !virtqueue->packed.used_phase;
+	}
+
+	/* Ensure the used descriptor is visible to the guest at the time of interrupt. */
+	spdk_wmb();
+
+	virtqueue->used_req_cnt++;
+}
+
 static struct spdk_vhost_session *
 spdk_vhost_session_find_by_id(struct spdk_vhost_dev *vdev, unsigned id)
 {
@@ -1032,10 +1448,19 @@ stop_device(int vid)
 
 	for (i = 0; i < vsession->max_queues; i++) {
 		q = &vsession->virtqueue[i];
+		/* The pollers are stopped, so nothing else will flush the dirty log. */
+		spdk_vhost_vq_log_flush(vsession, q);
 		if (q->vring.desc == NULL) {
 			continue;
 		}
-		rte_vhost_set_vring_base(vsession->vid, i, q->last_avail_idx, q->last_used_idx);
+		if (q->packed.packed_ring) {
+			/* Bit 15 of packed virtqueue indexes carries the wrap counter. */
+			rte_vhost_set_vring_base(vsession->vid, i,
+						 q->last_avail_idx | ((uint16_t)q->packed.avail_phase << 15),
+						 q->last_used_idx | ((uint16_t)q->packed.used_phase << 15));
+		} else {
+			rte_vhost_set_vring_base(vsession->vid, i, q->last_avail_idx, q->last_used_idx);
+		}
 	}
 
 	spdk_vhost_session_mem_unregister(vsession);
@@ -1069,6 +1494,11 @@ start_device(int vid)
 		goto out;
 	}
 
+	if (rte_vhost_get_negotiated_features(vid, &vsession->negotiated_features) != 0) {
+		SPDK_ERRLOG("vhost device %d: Failed to get negotiated driver features\n", vid);
+		goto out;
+	}
+
 	vsession->max_queues = 0;
 	memset(vsession->virtqueue, 0, sizeof(vsession->virtqueue));
 	for (i = 0; i < SPDK_VHOST_MAX_VQUEUES; i++) {
@@ -1087,6 +1517,15 @@ start_device(int vid)
 			continue;
 		}
 
+		if (spdk_vhost_dev_has_feature(vsession, VIRTIO_F_RING_PACKED)) {
+			/* Packed virtqueues have at most 2^15 entries, bit 15 is the wrap counter. */
+			q->packed.packed_ring = true;
+			q->packed.avail_phase = !!(q->last_avail_idx & 0x8000);
+			q->packed.used_phase = !!(q->last_used_idx & 0x8000);
+			q->last_avail_idx &= 0x7FFF;
+			q->last_used_idx &= 0x7FFF;
+		}
+
 		/* Disable notifications. */
 		if (rte_vhost_enable_guest_notification(vid, i, 0) != 0) {
 			SPDK_ERRLOG("vhost device %d: Failed to disable guest notification on queue %"PRIu16"\n", vid, i);
@@ -1096,11 +1535,6 @@ start_device(int vid)
 		vsession->max_queues = i + 1;
 	}
 
-	if (rte_vhost_get_negotiated_features(vid, &vsession->negotiated_features) != 0) {
-		SPDK_ERRLOG("vhost device %d: Failed to get negotiated driver features\n", vid);
-		goto out;
-	}
-
 	if (rte_vhost_get_mem_table(vid, &vsession->mem) != 0) {
 		SPDK_ERRLOG("vhost device %d: Failed to get guest memory table\n", vid);
 		goto out;
@@ -1244,6 +1678,44 @@ spdk_vhost_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ct
 	vdev->backend->dump_info_json(vdev, w);
 }
 
+void
+spdk_vhost_dump_queue_stats_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w)
+{
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_virtqueue *virtqueue;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint16_t q_idx;
+
+	spdk_json_write_array_begin(w);
+	TAILQ_FOREACH(vsession, &vdev->vsessions, tailq) {
+		if (vsession->lcore == -1) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint32(w, "session_id", vsession->id);
+
+		spdk_json_write_named_array_begin(w, "queues");
+		for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+			virtqueue = &vsession->virtqueue[q_idx];
+			if (virtqueue->vring.desc == NULL) {
+				continue;
+			}
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_uint32(w, "id", q_idx);
+			spdk_json_write_named_uint64(w, "irq_count", virtqueue->irq_cnt);
+			spdk_json_write_named_uint64(w, "irq_delay_us",
+						     virtqueue->irq_delay_time * 1000000ULL / ticks_hz);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
 int
 spdk_vhost_dev_remove(struct spdk_vhost_dev *vdev)
 {
@@ -1483,6 +1955,7 @@ spdk_vhost_config_json(struct spdk_json_write_ctx *w, struct spdk_event *done_ev
 	struct spdk_vhost_dev *vdev;
 	uint32_t delay_base_us;
 	uint32_t iops_threshold;
+	uint32_t target_latency_us;
 
 	spdk_json_write_array_begin(w);
 
@@ -1504,6 +1977,19 @@ spdk_vhost_config_json(struct spdk_json_write_ctx *w, struct spdk_event *done_ev
 
 			spdk_json_write_object_end(w);
 		}
+
+		target_latency_us = spdk_vhost_get_adaptive_coalescing(vdev);
+		if (target_latency_us) {
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "method", "set_vhost_controller_adaptive_coalescing");
+
+			spdk_json_write_named_object_begin(w, "params");
+			spdk_json_write_named_string(w, "ctrlr", vdev->name);
+			spdk_json_write_named_uint32(w, "target_latency_us", target_latency_us);
+			spdk_json_write_object_end(w);
+
+			spdk_json_write_object_end(w);
+		}
 		vdev = spdk_vhost_dev_next(vdev);
 	}
 	spdk_vhost_unlock();
@@ -47,12 +47,21 @@
 struct spdk_vhost_blk_task {
 	struct spdk_bdev_io *bdev_io;
 	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_blk_queue_group *group;
 	struct spdk_vhost_virtqueue *vq;
 
 	volatile uint8_t *status;
 
+	/* Descriptor index. For packed virtqueues, ring position of the first descriptor. */
 	uint16_t req_idx;
 
+	/* Buffer ID and number of ring descriptors of a packed virtqueue request. */
+	uint16_t buffer_id;
+	uint16_t num_descs;
+
+	/* If set, the device writes to the data buffers of the request. */
+	bool data_in;
+
 	/* for io wait */
 	struct spdk_bdev_io_wait_entry bdev_io_wait;
 
@@ -61,6 +70,7 @@ struct spdk_vhost_blk_task {
 
 	/** Number of bytes that were written. */
 	uint32_t used_len;
+	uint32_t payload_len;
 	uint16_t iovcnt;
 	struct iovec iovs[SPDK_VHOST_IOVS_MAX];
 };
@@ -70,15 +80,43 @@ struct spdk_vhost_blk_dev {
 	struct spdk_bdev *bdev;
 	struct spdk_bdev_desc *bdev_desc;
 	bool readonly;
+	bool distribute_queues;
 };
 
+/*
+ * Contiguous range of session virtqueues polled by a single reactor.
+ * Each group has its own bdev io_channel.
+ */
+struct spdk_vhost_blk_queue_group {
+	struct spdk_vhost_blk_session *bvsession;
+	uint32_t lcore;
+	uint16_t first_q;
+	uint16_t num_q;
+
+	struct spdk_poller *requestq_poller;
+	struct spdk_poller *stop_poller;
+	struct spdk_io_channel *io_channel;
+
+	/* Number of tasks of this group currently being processed */
+	int task_cnt;
+
+	/* Next time when stats for event coalescing will be checked. */
+	uint64_t next_stats_check_time;
+} __attribute((aligned(SPDK_CACHE_LINE_SIZE)));
+
 struct spdk_vhost_blk_session {
 	/* The parent session must be the very first field in this struct */
 	struct spdk_vhost_session vsession;
 	struct spdk_vhost_blk_dev *bvdev;
-	struct spdk_poller *requestq_poller;
-	struct spdk_io_channel *io_channel;
-	struct spdk_vhost_dev_destroy_ctx destroy_ctx;
+
+	struct spdk_vhost_blk_queue_group *groups;
+	uint16_t num_groups;
+
+	/* Number of groups that still have to process the current start/stop event */
+	uint32_t pending_groups;
+	bool stopping;
+	int event_rc;
+	void *event_ctx;
 };
 
 /* forward declaration */
@@ -89,11 +127,52 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 		    struct spdk_vhost_blk_session *bvsession,
 		    struct spdk_vhost_virtqueue *vq);
 
+static int
+submit_blk_request(struct spdk_vhost_blk_task *task, struct spdk_vhost_blk_session *bvsession);
+
+static void
+blk_task_init(struct spdk_vhost_blk_task *task)
+{
+	task->group->task_cnt++;
+
+	task->used = true;
+	task->iovcnt = SPDK_COUNTOF(task->iovs);
+	task->status = NULL;
+	task->used_len = 0;
+	task->data_in = false;
+}
+
+static void
+blk_task_enqueue(struct spdk_vhost_blk_task *task)
+{
+	struct spdk_vhost_session *vsession = &task->bvsession->vsession;
+
+	if (!task->vq->packed.packed_ring) {
+		spdk_vhost_vq_used_ring_enqueue(vsession, task->vq, task->req_idx, task->used_len);
+		return;
+	}
+
+	/*
+	 * The ring descriptors of a packed virtqueue request might already be
+	 * overwritten by used elements of other requests, so log the buffers
+	 * written by the device using the task iovecs.
+	 */
+	if (task->status != NULL) {
+		if (task->data_in) {
+			spdk_vhost_log_iovs(vsession, task->vq, &task->iovs[1], task->iovcnt);
+		}
+		spdk_vhost_log_iovs(vsession, task->vq, &task->iovs[task->iovcnt + 1], 1);
+	}
+
+	spdk_vhost_vq_packed_ring_enqueue(vsession, task->vq, task->num_descs, task->buffer_id,
+					  task->used_len);
+}
+
 static void
 blk_task_finish(struct spdk_vhost_blk_task *task)
 {
-	assert(task->bvsession->vsession.task_cnt > 0);
-	task->bvsession->vsession.task_cnt--;
+	assert(task->group->task_cnt > 0);
+	task->group->task_cnt--;
 	task->used = false;
 }
 
@@ -104,8 +183,7 @@ invalid_blk_request(struct spdk_vhost_blk_task *task, uint8_t status)
 		*task->status = status;
 	}
 
-	spdk_vhost_vq_used_ring_enqueue(&task->bvsession->vsession, task->vq, task->req_idx,
-					task->used_len);
+	blk_task_enqueue(task);
 	blk_task_finish(task);
 	SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK_DATA, "Invalid request (status=%" PRIu8")\n", status);
 }
@@ -118,8 +196,8 @@ invalid_blk_request(struct spdk_vhost_blk_task *task, uint8_t status)
  *   FIXME: Make this function return to rd_cnt and wr_cnt
  */
 static int
-blk_iovs_setup(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue *vq,
-	       uint16_t req_idx, struct iovec *iovs, uint16_t *iovs_cnt, uint32_t *length)
+blk_iovs_split_setup(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue *vq,
+		     uint16_t req_idx, struct iovec *iovs, uint16_t *iovs_cnt, uint32_t *length)
 {
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	struct spdk_vhost_dev *vdev = vsession->vdev;
@@ -189,12 +267,86 @@ blk_iovs_setup(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtq
 	return 0;
 }
 
+static int
+blk_iovs_packed_setup(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue *vq,
+		      uint16_t req_idx, struct iovec *iovs, uint16_t *iovs_cnt, uint32_t *length)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	struct spdk_vhost_dev *vdev = vsession->vdev;
+	struct vring_packed_desc *desc, *desc_table;
+	uint16_t out_cnt = 0, cnt = 0;
+	uint32_t desc_table_size, len = 0;
+	uint32_t desc_handled_cnt;
+	int rc;
+
+	rc = spdk_vhost_vq_get_desc_packed(vsession, vq, req_idx, &desc, &desc_table, &desc_table_size);
+	if (rc != 0) {
+		SPDK_ERRLOG("%s: Invalid descriptor at index %"PRIu16".\n", vdev->name, req_idx);
+		return -1;
+	}
+
+	desc_handled_cnt = 0;
+	while (1) {
+		if (spdk_unlikely(cnt == *iovs_cnt)) {
+			SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "Max IOVs in request reached (req_idx = %"PRIu16").\n",
+				      req_idx);
+			return -1;
+		}
+
+		if (spdk_unlikely(spdk_vhost_vring_packed_desc_to_iov(vsession, iovs, &cnt, desc))) {
+			SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "Invalid descriptor %" PRIu16" (req_idx = %"PRIu16").\n",
+				      req_idx, cnt);
+			return -1;
+		}
+
+		len += desc->len;
+
+		out_cnt += spdk_vhost_vring_packed_desc_is_wr(desc);
+
+		rc = spdk_vhost_vring_packed_desc_get_next(&desc, &req_idx, vq, desc_table, desc_table_size);
+		if (rc != 0) {
+			SPDK_ERRLOG("%s: Descriptor chain at index %"PRIu16" terminated unexpectedly.\n",
+				    vdev->name, req_idx);
+			return -1;
+		} else if (desc == NULL) {
+			break;
+		}
+
+		desc_handled_cnt++;
+		if (spdk_unlikely(desc_handled_cnt > vq->vring.size)) {
+			/* Break a cycle and report an error, if any. */
+			SPDK_ERRLOG("%s: found a cycle in the descriptor chain: vring_size = %d, desc_handled_cnt = %d.\n",
+				    vdev->name, vq->vring.size, desc_handled_cnt);
+			return -1;
+		}
+	}
+
+	/* The same layout rules apply as for split virtqueues. */
+	if (spdk_unlikely(out_cnt == 0 || cnt < 2)) {
+		return -1;
+	}
+
+	*length = len;
+	*iovs_cnt = cnt;
+	return 0;
+}
+
+static int
+blk_iovs_setup(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue *vq,
+	       uint16_t req_idx, struct iovec *iovs, uint16_t *iovs_cnt, uint32_t *length)
+{
+	if (vq->packed.packed_ring) {
+		return blk_iovs_packed_setup(bvsession, vq, req_idx, iovs, iovs_cnt, length);
+	}
+
+	return blk_iovs_split_setup(bvsession, vq, req_idx, iovs, iovs_cnt, length);
+}
+
 static void
 blk_request_finish(bool success, struct spdk_vhost_blk_task *task)
 {
 	*task->status = success ? VIRTIO_BLK_S_OK : VIRTIO_BLK_S_IOERR;
-	spdk_vhost_vq_used_ring_enqueue(&task->bvsession->vsession, task->vq, task->req_idx,
-					task->used_len);
+	blk_task_enqueue(task);
 	SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "Finished task (%p) req_idx=%d\n status: %s\n", task,
 		      task->req_idx, success ? "OK" : "FAIL");
 	blk_task_finish(task);
@@ -215,7 +367,11 @@ blk_request_resubmit(void *arg)
 	struct spdk_vhost_blk_task *task = (struct spdk_vhost_blk_task *)arg;
 	int rc = 0;
 
-	rc = process_blk_request(task, task->bvsession, task->vq);
+	/*
+	 * The request has already been parsed. Its descriptors must not be read
+	 * again, as the ring slots of a packed virtqueue might have been reused.
+	 */
+	rc = submit_blk_request(task, task->bvsession);
 	if (rc == 0) {
 		SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "====== Task %p resubmitted ======\n", task);
 	} else {
@@ -234,7 +390,7 @@ blk_request_queue_io(struct spdk_vhost_blk_task *task)
 	task->bdev_io_wait.cb_fn = blk_request_resubmit;
 	task->bdev_io_wait.cb_arg = task;
 
-	rc = spdk_bdev_queue_io_wait(bdev, bvsession->io_channel, &task->bdev_io_wait);
+	rc = spdk_bdev_queue_io_wait(bdev, task->group->io_channel, &task->bdev_io_wait);
 	if (rc != 0) {
 		SPDK_ERRLOG("Queue io failed in vhost_blk, rc=%d\n", rc);
 		invalid_blk_request(task, VIRTIO_BLK_S_IOERR);
@@ -246,14 +402,9 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 		    struct spdk_vhost_blk_session *bvsession,
 		    struct spdk_vhost_virtqueue *vq)
 {
-	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
 	const struct virtio_blk_outhdr *req;
-	struct virtio_blk_discard_write_zeroes *desc;
 	struct iovec *iov;
-	uint32_t type;
 	uint32_t payload_len;
-	uint64_t flush_bytes;
-	int rc;
 
 	if (blk_iovs_setup(bvsession, vq, task->req_idx, task->iovs, &task->iovcnt, &payload_len)) {
 		SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "Invalid request (req_idx = %"PRIu16").\n", task->req_idx);
@@ -271,8 +422,6 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 		return -1;
 	}
 
-	req = iov->iov_base;
-
 	iov = &task->iovs[task->iovcnt - 1];
 	if (spdk_unlikely(iov->iov_len != 1)) {
 		SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK,
@@ -283,9 +432,28 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 	}
 
 	task->status = iov->iov_base;
-	payload_len -= sizeof(*req) + sizeof(*task->status);
+	task->payload_len = payload_len - sizeof(*req) - sizeof(*task->status);
 	task->iovcnt -= 2;
 
+	return submit_blk_request(task, bvsession);
+}
+
+/*
+ * Submit a parsed request to the bdev layer. Only the task fields set up by
+ * process_blk_request() and the request buffers are accessed here.
+ */
+static int
+submit_blk_request(struct spdk_vhost_blk_task *task, struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+	struct spdk_io_channel *ch = task->group->io_channel;
+	const struct virtio_blk_outhdr *req = task->iovs[0].iov_base;
+	struct virtio_blk_discard_write_zeroes *desc;
+	uint32_t payload_len = task->payload_len;
+	uint32_t type;
+	uint64_t flush_bytes;
+	int rc;
+
 	type = req->type;
 #ifdef VIRTIO_BLK_T_BARRIER
 	/* Don't care about barier for now (as QEMU's virtio-blk do). */
@@ -304,12 +472,13 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 
 		if (type == VIRTIO_BLK_T_IN) {
 			task->used_len = payload_len + sizeof(*task->status);
-			rc = spdk_bdev_readv(bvdev->bdev_desc, bvsession->io_channel,
+			task->data_in = true;
+			rc = spdk_bdev_readv(bvdev->bdev_desc, ch,
 					     &task->iovs[1], task->iovcnt, req->sector * 512,
 					     payload_len, blk_request_complete_cb, task);
 		} else if (!bvdev->readonly) {
 			task->used_len = sizeof(*task->status);
-			rc = spdk_bdev_writev(bvdev->bdev_desc, bvsession->io_channel,
+			rc = spdk_bdev_writev(bvdev->bdev_desc, ch,
 					      &task->iovs[1], task->iovcnt, req->sector * 512,
 					      payload_len, blk_request_complete_cb, task);
 		} else {
@@ -335,7 +504,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			return -1;
 		}
 
-		rc = spdk_bdev_unmap(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_unmap(bvdev->bdev_desc, ch,
 				     desc->sector * 512, desc->num_sectors * 512,
 				     blk_request_complete_cb, task);
 		if (rc) {
@@ -363,7 +532,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			return -1;
 		}
 
-		rc = spdk_bdev_write_zeroes(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_write_zeroes(bvdev->bdev_desc, ch,
 					    desc->sector * 512, desc->num_sectors * 512,
 					    blk_request_complete_cb, task);
 		if (rc) {
@@ -383,7 +552,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			invalid_blk_request(task, VIRTIO_BLK_S_IOERR);
 			return -1;
 		}
-		rc = spdk_bdev_flush(bvdev->bdev_desc, bvsession->io_channel,
+		rc = spdk_bdev_flush(bvdev->bdev_desc, ch,
 				     0, flush_bytes,
 				     blk_request_complete_cb, task);
 		if (rc) {
@@ -402,6 +571,7 @@ process_blk_request(struct spdk_vhost_blk_task *task,
 			return -1;
 		}
 		task->used_len = spdk_min((size_t)VIRTIO_BLK_ID_BYTES, task->iovs[1].iov_len);
+		task->data_in = true;
 		spdk_strcpy_pad(task->iovs[1].iov_base, spdk_bdev_get_product_name(bvdev->bdev),
 				task->used_len, ' ');
 		blk_request_finish(true, task);
@@ -449,12 +619,7 @@ process_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue
 			continue;
 		}
 
-		vsession->task_cnt++;
-
-		task->used = true;
-		task->iovcnt = SPDK_COUNTOF(task->iovs);
-		task->status = NULL;
-		task->used_len = 0;
+		blk_task_init(task);
 
 		rc = process_blk_request(task, bvsession, vq);
 		if (rc == 0) {
@@ -466,19 +631,73 @@ process_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue
 	}
 }
 
+static void
+process_packed_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_virtqueue *vq)
+{
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+	struct spdk_vhost_blk_task *task;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint16_t req_idx, buffer_id, num_descs, i;
+	int rc;
+
+	for (i = 0; i < 32 && spdk_vhost_vq_packed_ring_is_avail(vq); i++) {
+		req_idx = vq->last_avail_idx;
+		buffer_id = spdk_vhost_vring_packed_desc_get_buffer_id(vq, req_idx, &num_descs);
+		spdk_vhost_vq_packed_ring_consume(vq, num_descs);
+
+		SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "====== Starting processing request idx %"PRIu16
+			      " buffer id %"PRIu16"======\n", req_idx, buffer_id);
+
+		if (spdk_unlikely(buffer_id >= vq->vring.size)) {
+			SPDK_ERRLOG("%s: request buffer id '%"PRIu16"' exceeds virtqueue size (%"PRIu16").\n",
+				    bvdev->vdev.name, buffer_id, vq->vring.size);
+			spdk_vhost_vq_packed_ring_enqueue(vsession, vq, num_descs, buffer_id, 0);
+			continue;
+		}
+
+		task = &((struct spdk_vhost_blk_task *)vq->tasks)[buffer_id];
+		if (spdk_unlikely(task->used)) {
+			SPDK_ERRLOG("%s: request with buffer id '%"PRIu16"' is already pending.\n",
+				    bvdev->vdev.name, buffer_id);
+			spdk_vhost_vq_packed_ring_enqueue(vsession, vq, num_descs, buffer_id, 0);
+			continue;
+		}
+
+		task->req_idx = req_idx;
+		task->buffer_id = buffer_id;
+		task->num_descs = num_descs;
+		blk_task_init(task);
+
+		rc = process_blk_request(task, bvsession, vq);
+		if (rc == 0) {
+			SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "====== Task %p buffer id %d submitted ======\n", task,
+				      buffer_id);
+		} else {
+			SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK, "====== Task %p buffer id %d failed ======\n", task,
+				      buffer_id);
+		}
+	}
+}
+
 static int
 vdev_worker(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct spdk_vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 
 	uint16_t q_idx;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
-		process_vq(bvsession, &vsession->virtqueue[q_idx]);
+	for (q_idx = group->first_q; q_idx < group->first_q + group->num_q; q_idx++) {
+		if (vsession->virtqueue[q_idx].packed.packed_ring) {
+			process_packed_vq(bvsession, &vsession->virtqueue[q_idx]);
+		} else {
+			process_vq(bvsession, &vsession->virtqueue[q_idx]);
+		}
 	}
 
-	spdk_vhost_session_used_signal(vsession);
+	spdk_vhost_session_used_signal_range(vsession, group->first_q, group->num_q,
+					     &group->next_stats_check_time);
 
 	return -1;
 }
@@ -489,9 +708,17 @@ no_bdev_process_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_v
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	struct iovec iovs[SPDK_VHOST_IOVS_MAX];
 	uint32_t length;
-	uint16_t iovcnt, req_idx;
+	uint16_t iovcnt, req_idx, buffer_id, num_descs;
+
+	if (vq->packed.packed_ring) {
+		if (!spdk_vhost_vq_packed_ring_is_avail(vq)) {
+			return;
+		}
 
-	if (spdk_vhost_vq_avail_ring_get(vq, &req_idx, 1) != 1) {
+		req_idx = vq->last_avail_idx;
+		buffer_id = spdk_vhost_vring_packed_desc_get_buffer_id(vq, req_idx, &num_descs);
+		spdk_vhost_vq_packed_ring_consume(vq, num_descs);
+	} else if (spdk_vhost_vq_avail_ring_get(vq, &req_idx, 1) != 1) {
 		return;
 	}
 
@@ -499,27 +726,36 @@ no_bdev_process_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_vhost_v
 	if (blk_iovs_setup(bvsession, vq, req_idx, iovs, &iovcnt, &length) == 0) {
 		*(volatile uint8_t *)iovs[iovcnt - 1].iov_base = VIRTIO_BLK_S_IOERR;
 		SPDK_DEBUGLOG(SPDK_LOG_VHOST_BLK_DATA, "Aborting request %" PRIu16"\n", req_idx);
+		if (vq->packed.packed_ring) {
+			spdk_vhost_log_iovs(vsession, vq, &iovs[iovcnt - 1], 1);
+		}
 	}
 
-	spdk_vhost_vq_used_ring_enqueue(vsession, vq, req_idx, 0);
+	if (vq->packed.packed_ring) {
+		spdk_vhost_vq_packed_ring_enqueue(vsession, vq, num_descs, buffer_id, 0);
+	} else {
+		spdk_vhost_vq_used_ring_enqueue(vsession, vq, req_idx, 0);
+	}
 }
 
 static int
 no_bdev_vdev_worker(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct spdk_vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	uint16_t q_idx;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	for (q_idx = group->first_q; q_idx < group->first_q + group->num_q; q_idx++) {
 		no_bdev_process_vq(bvsession, &vsession->virtqueue[q_idx]);
 	}
 
-	spdk_vhost_session_used_signal(vsession);
+	spdk_vhost_session_used_signal_range(vsession, group->first_q, group->num_q,
+					     &group->next_stats_check_time);
 
-	if (vsession->task_cnt == 0 && bvsession->io_channel) {
-		spdk_put_io_channel(bvsession->io_channel);
-		bvsession->io_channel = NULL;
+	if (group->task_cnt == 0 && group->io_channel) {
+		spdk_put_io_channel(group->io_channel);
+		group->io_channel = NULL;
 	}
 
 	return -1;
@@ -564,11 +800,24 @@ spdk_vhost_blk_get_dev(struct spdk_vhost_dev *vdev)
 	return bvdev->bdev;
 }
 
+static void
+_spdk_vhost_blk_group_bdev_remove(void *arg1, void *arg2)
+{
+	struct spdk_vhost_blk_queue_group *group = arg1;
+
+	if (group->requestq_poller) {
+		spdk_poller_unregister(&group->requestq_poller);
+		group->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, group, 0);
+	}
+}
+
 static int
 _spdk_vhost_session_bdev_remove_cb(struct spdk_vhost_dev *vdev, struct spdk_vhost_session *vsession,
 				   void *ctx)
 {
 	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_event *event;
+	uint16_t i;
 
 	if (vdev == NULL) {
 		/* Nothing to do */
@@ -588,9 +837,15 @@ _spdk_vhost_session_bdev_remove_cb(struct spdk_vhost_dev *vdev, struct spdk_vhos
 	}
 
 	bvsession = (struct spdk_vhost_blk_session *)vsession;
-	if (bvsession->requestq_poller) {
-		spdk_poller_unregister(&bvsession->requestq_poller);
-		bvsession->requestq_poller = spdk_poller_register(no_bdev_vdev_worker, bvsession, 0);
+	if (bvsession->groups == NULL) {
+		return 0;
+	}
+
+	/* Each group has to swap its poller on its own reactor */
+	for (i = 0; i < bvsession->num_groups; i++) {
+		event = spdk_event_allocate(bvsession->groups[i].lcore, _spdk_vhost_blk_group_bdev_remove,
+					    &bvsession->groups[i], NULL);
+		spdk_event_call(event);
 	}
 
 	return 0;
@@ -633,6 +888,7 @@ alloc_task_pool(struct spdk_vhost_blk_session *bvsession)
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
 	struct spdk_vhost_virtqueue *vq;
+	struct spdk_vhost_blk_queue_group *group;
 	struct spdk_vhost_blk_task *task;
 	uint32_t task_cnt;
 	uint16_t i;
@@ -661,9 +917,15 @@ alloc_task_pool(struct spdk_vhost_blk_session *bvsession)
 			return -1;
 		}
 
+		group = bvsession->groups;
+		while (i >= group->first_q + group->num_q) {
+			group++;
+		}
+
 		for (j = 0; j < task_cnt; j++) {
 			task = &((struct spdk_vhost_blk_task *)vq->tasks)[j];
 			task->bvsession = bvsession;
+			task->group = group;
 			task->req_idx = j;
 			task->vq = vq;
 		}
@@ -672,11 +934,150 @@ alloc_task_pool(struct spdk_vhost_blk_session *bvsession)
 	return 0;
 }
 
+static void
+free_queue_groups(struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint16_t i;
+
+	for (i = 0; i < bvsession->num_groups; i++) {
+		spdk_vhost_free_reactor(bvsession->groups[i].lcore);
+	}
+
+	spdk_dma_free(bvsession->groups);
+	bvsession->groups = NULL;
+	bvsession->num_groups = 0;
+	vsession->lcore = -1;
+}
+
+/*
+ * Split the session virtqueues into groups of contiguous queues and pick
+ * a reactor for each of them. Unless the controller distributes its queues,
+ * there is just a single group. Otherwise each core of the controller
+ * cpumask polls at most one group. The first group always runs on the
+ * session lcore.
+ */
+static int
+alloc_queue_groups(struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	struct spdk_vhost_dev *vdev = vsession->vdev;
+	struct spdk_vhost_blk_queue_group *group;
+	struct spdk_cpuset *free_cores;
+	uint16_t num_groups, first_q, i;
+
+	num_groups = 1;
+	if (bvsession->bvdev->distribute_queues) {
+		num_groups = spdk_min(spdk_cpuset_count(vdev->cpumask), vsession->max_queues);
+		num_groups = spdk_max(num_groups, 1);
+	}
+
+	free_cores = spdk_cpuset_alloc();
+	if (free_cores == NULL) {
+		return -ENOMEM;
+	}
+
+	bvsession->groups = spdk_dma_zmalloc(num_groups * sizeof(*bvsession->groups),
+					     SPDK_CACHE_LINE_SIZE, NULL);
+	if (bvsession->groups == NULL) {
+		spdk_cpuset_free(free_cores);
+		return -ENOMEM;
+	}
+
+	spdk_cpuset_copy(free_cores, vdev->cpumask);
+	first_q = 0;
+	for (i = 0; i < num_groups; i++) {
+		group = &bvsession->groups[i];
+		group->bvsession = bvsession;
+		group->lcore = spdk_vhost_allocate_reactor(free_cores);
+		spdk_cpuset_set_cpu(free_cores, group->lcore, false);
+
+		group->first_q = first_q;
+		group->num_q = vsession->max_queues / num_groups;
+		if (i < vsession->max_queues % num_groups) {
+			group->num_q++;
+		}
+		first_q += group->num_q;
+	}
+
+	bvsession->num_groups = num_groups;
+	vsession->lcore = bvsession->groups[0].lcore;
+	spdk_cpuset_free(free_cores);
+	return 0;
+}
+
+static void blk_group_stop(void *arg1, void *arg2);
+
+static void
+blk_session_send_group_events(struct spdk_vhost_blk_session *bvsession, spdk_event_fn fn)
+{
+	struct spdk_event *event;
+	uint16_t i;
+
+	bvsession->pending_groups = bvsession->num_groups;
+	for (i = 0; i < bvsession->num_groups; i++) {
+		event = spdk_event_allocate(bvsession->groups[i].lcore, fn, &bvsession->groups[i], NULL);
+		spdk_event_call(event);
+	}
+}
+
+/*
+ * Called by each group once it has processed the current start/stop
+ * event. The last group to finish completes the session event.
+ */
+static void
+blk_session_group_event_done(struct spdk_vhost_blk_session *bvsession)
+{
+	if (__sync_sub_and_fetch(&bvsession->pending_groups, 1) != 0) {
+		return;
+	}
+
+	if (!bvsession->stopping && bvsession->event_rc != 0) {
+		/* Some of the groups failed to start - stop the others. */
+		bvsession->stopping = true;
+		blk_session_send_group_events(bvsession, blk_group_stop);
+		return;
+	}
+
+	if (bvsession->stopping) {
+		free_task_pool(bvsession);
+	}
+
+	spdk_vhost_session_event_done(bvsession->event_ctx, bvsession->event_rc);
+}
+
+static void
+blk_group_start(void *arg1, void *arg2)
+{
+	struct spdk_vhost_blk_queue_group *group = arg1;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+
+	if (bvdev->bdev) {
+		group->io_channel = spdk_bdev_get_io_channel(bvdev->bdev_desc);
+		if (!group->io_channel) {
+			SPDK_ERRLOG("Controller %s: IO channel allocation failed on lcore %"PRIu32"\n",
+				    bvdev->vdev.name, group->lcore);
+			bvsession->event_rc = -1;
+			blk_session_group_event_done(bvsession);
+			return;
+		}
+
+		group->requestq_poller = SPDK_POLLER_REGISTER(vdev_worker, group, 0);
+	} else {
+		group->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, group, 0);
+	}
+
+	SPDK_INFOLOG(SPDK_LOG_VHOST, "Started poller for vhost controller %s queues %"PRIu16"-%"PRIu16
+		     " on lcore %"PRIu32"\n", bvdev->vdev.name, group->first_q,
+		     group->first_q + group->num_q - 1, group->lcore);
+	blk_session_group_event_done(bvsession);
+}
+
 static int
 spdk_vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
 			struct spdk_vhost_session *vsession, void *event_ctx)
 {
-	struct spdk_vhost_blk_dev *bvdev;
 	struct spdk_vhost_blk_session *bvsession;
 	int i, rc = 0;
 
@@ -684,43 +1085,31 @@ spdk_vhost_blk_start_cb(struct spdk_vhost_dev *vdev,
 	if (bvsession == NULL) {
 		SPDK_ERRLOG("Trying to start non-blk controller as a blk one.\n");
 		rc = -1;
-		goto out;
+		goto err;
 	}
 
-	bvdev = to_blk_dev(vdev);
-	assert(bvdev != NULL);
-	bvsession->bvdev = bvdev;
-
 	/* validate all I/O queues are in a contiguous index range */
 	for (i = 0; i < vsession->max_queues; i++) {
 		if (vsession->virtqueue[i].vring.desc == NULL) {
 			SPDK_ERRLOG("%s: queue %"PRIu32" is empty\n", vdev->name, i);
 			rc = -1;
-			goto out;
+			goto err;
 		}
 	}
 
 	rc = alloc_task_pool(bvsession);
 	if (rc != 0) {
-		SPDK_ERRLOG("%s: failed to alloc task pool.\n", bvdev->vdev.name);
-		goto out;
+		SPDK_ERRLOG("%s: failed to alloc task pool.\n", vdev->name);
+		goto err;
 	}
 
-	if (bvdev->bdev) {
-		bvsession->io_channel = spdk_bdev_get_io_channel(bvdev->bdev_desc);
-		if (!bvsession->io_channel) {
-			free_task_pool(bvsession);
-			SPDK_ERRLOG("Controller %s: IO channel allocation failed\n", vdev->name);
-			rc = -1;
-			goto out;
-		}
-	}
+	bvsession->event_ctx = event_ctx;
+	bvsession->event_rc = 0;
+	bvsession->stopping = false;
+	blk_session_send_group_events(bvsession, blk_group_start);
+	return 0;
 
-	bvsession->requestq_poller = spdk_poller_register(bvdev->bdev ? vdev_worker : no_bdev_vdev_worker,
-				     bvsession, 0);
-	SPDK_INFOLOG(SPDK_LOG_VHOST, "Started poller for vhost controller %s on lcore %d\n",
-		     vdev->name, vsession->lcore);
-out:
+err:
 	spdk_vhost_session_event_done(event_ctx, rc);
 	return rc;
 }
@@ -728,50 +1117,74 @@ out:
 static int
 spdk_vhost_blk_start(struct spdk_vhost_session *vsession)
 {
+	struct spdk_vhost_blk_session *bvsession;
 	int rc;
 
-	vsession->lcore = spdk_vhost_allocate_reactor(vsession->vdev->cpumask);
+	bvsession = to_blk_session(vsession);
+	if (bvsession == NULL) {
+		SPDK_ERRLOG("Trying to start non-blk controller as a blk one.\n");
+		return -1;
+	}
+
+	bvsession->bvdev = to_blk_dev(vsession->vdev);
+	assert(bvsession->bvdev != NULL);
+
+	rc = alloc_queue_groups(bvsession);
+	if (rc != 0) {
+		SPDK_ERRLOG("%s: failed to alloc queue groups.\n", vsession->vdev->name);
+		return rc;
+	}
+
 	rc = spdk_vhost_session_send_event(vsession, spdk_vhost_blk_start_cb,
 					   3, "start session");
 
 	if (rc != 0) {
-		spdk_vhost_free_reactor(vsession->lcore);
-		vsession->lcore = -1;
+		free_queue_groups(bvsession);
 	}
 
 	return rc;
 }
 
 static int
-destroy_session_poller_cb(void *arg)
+destroy_group_poller_cb(void *arg)
 {
-	struct spdk_vhost_blk_session *bvsession = arg;
+	struct spdk_vhost_blk_queue_group *group = arg;
+	struct spdk_vhost_blk_session *bvsession = group->bvsession;
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
-	int i;
+	uint16_t i;
 
-	if (vsession->task_cnt > 0) {
+	if (group->task_cnt > 0) {
 		return -1;
 	}
 
-	for (i = 0; i < vsession->max_queues; i++) {
+	for (i = group->first_q; i < group->first_q + group->num_q; i++) {
 		vsession->virtqueue[i].next_event_time = 0;
 		spdk_vhost_vq_used_signal(vsession, &vsession->virtqueue[i]);
 	}
 
-	SPDK_INFOLOG(SPDK_LOG_VHOST, "Stopping poller for vhost controller %s\n", vsession->vdev->name);
+	SPDK_INFOLOG(SPDK_LOG_VHOST, "Stopping poller for vhost controller %s on lcore %"PRIu32"\n",
+		     vsession->vdev->name, group->lcore);
 
-	if (bvsession->io_channel) {
-		spdk_put_io_channel(bvsession->io_channel);
-		bvsession->io_channel = NULL;
+	if (group->io_channel) {
+		spdk_put_io_channel(group->io_channel);
+		group->io_channel = NULL;
 	}
 
-	free_task_pool(bvsession);
-	spdk_poller_unregister(&bvsession->destroy_ctx.poller);
-	spdk_vhost_session_event_done(bvsession->destroy_ctx.event_ctx, 0);
+	spdk_poller_unregister(&group->stop_poller);
+	blk_session_group_event_done(bvsession);
 
 	return -1;
 }
 
+static void
+blk_group_stop(void *arg1, void *arg2)
+{
+	struct spdk_vhost_blk_queue_group *group = arg1;
+
+	spdk_poller_unregister(&group->requestq_poller);
+	group->stop_poller = SPDK_POLLER_REGISTER(destroy_group_poller_cb, group, 1000);
+}
+
 static int
 spdk_vhost_blk_stop_cb(struct spdk_vhost_dev *vdev,
 		       struct spdk_vhost_session *vsession, void *event_ctx)
@@ -784,10 +1197,10 @@ spdk_vhost_blk_stop_cb(struct spdk_vhost_dev *vdev,
 		goto err;
 	}
 
-	bvsession->destroy_ctx.event_ctx = event_ctx;
-	spdk_poller_unregister(&bvsession->requestq_poller);
-	bvsession->destroy_ctx.poller = spdk_poller_register(destroy_session_poller_cb,
-					bvsession, 1000);
+	bvsession->event_ctx = event_ctx;
+	bvsession->event_rc = 0;
+	bvsession->stopping = true;
+	blk_session_send_group_events(bvsession, blk_group_stop);
 	return 0;
 
 err:
@@ -806,8 +1219,7 @@ spdk_vhost_blk_stop(struct spdk_vhost_session *vsession)
 		return rc;
 	}
 
-	spdk_vhost_free_reactor(vsession->lcore);
-	vsession->lcore = -1;
+	free_queue_groups((struct spdk_vhost_blk_session *)vsession);
 	return 0;
 }
 
@@ -826,6 +1238,7 @@ spdk_vhost_blk_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_writ
 	spdk_json_write_named_object_begin(w, "block");
 
 	spdk_json_write_named_bool(w, "readonly", bvdev->readonly);
+	spdk_json_write_named_bool(w, "distribute_queues", bvdev->distribute_queues);
 
 	spdk_json_write_name(w, "bdev");
 	if (bdev) {
@@ -859,6 +1272,7 @@ spdk_vhost_blk_write_config_json(struct spdk_vhost_dev *vdev, struct spdk_json_w
 	spdk_json_write_named_string(w, "dev_name", spdk_bdev_get_name(bvdev->bdev));
 	spdk_json_write_named_string(w, "cpumask", spdk_cpuset_fmt(vdev->cpumask));
 	spdk_json_write_named_bool(w, "readonly", bvdev->readonly);
+	spdk_json_write_named_bool(w, "distribute_queues", bvdev->distribute_queues);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -938,7 +1352,7 @@ static const struct spdk_vhost_dev_backend vhost_blk_device_backend = {
 	(1ULL << VIRTIO_BLK_F_BARRIER)  | (1ULL << VIRTIO_BLK_F_SCSI) |
 	(1ULL << VIRTIO_BLK_F_FLUSH)    | (1ULL << VIRTIO_BLK_F_CONFIG_WCE) |
 	(1ULL << VIRTIO_BLK_F_MQ)       | (1ULL << VIRTIO_BLK_F_DISCARD) |
-	(1ULL << VIRTIO_BLK_F_WRITE_ZEROES),
+	(1ULL << VIRTIO_BLK_F_WRITE_ZEROES) | (1ULL << VIRTIO_F_RING_PACKED),
 	.disabled_features = SPDK_VHOST_DISABLED_FEATURES | (1ULL << VIRTIO_BLK_F_GEOMETRY) |
 	(1ULL << VIRTIO_BLK_F_RO) | (1ULL << VIRTIO_BLK_F_FLUSH) | (1ULL << VIRTIO_BLK_F_CONFIG_WCE) |
 	(1ULL << VIRTIO_BLK_F_BARRIER) | (1ULL << VIRTIO_BLK_F_SCSI) | (1ULL << VIRTIO_BLK_F_DISCARD) |
@@ -961,6 +1375,7 @@ spdk_vhost_blk_controller_construct(void)
 	char *cpumask;
 	char *name;
 	bool readonly;
+	bool distribute_queues;
 
 	for (sp = spdk_conf_first_section(NULL); sp != NULL; sp = spdk_conf_next_section(sp)) {
 		if (!spdk_conf_section_match_prefix(sp, "VhostBlk")) {
@@ -981,13 +1396,14 @@ spdk_vhost_blk_controller_construct(void)
 
 		cpumask = spdk_conf_section_get_val(sp, "Cpumask");
 		readonly = spdk_conf_section_get_boolval(sp, "ReadOnly", false);
+		distribute_queues = spdk_conf_section_get_boolval(sp, "DistributeQueues", false);
 
 		bdev_name = spdk_conf_section_get_val(sp, "Dev");
 		if (bdev_name == NULL) {
 			continue;
 		}
 
-		if (spdk_vhost_blk_construct(name, cpumask, bdev_name, readonly) < 0) {
+		if (spdk_vhost_blk_construct(name, cpumask, bdev_name, readonly, distribute_queues) < 0) {
 			return -1;
 		}
 	}
@@ -996,7 +1412,8 @@ spdk_vhost_blk_controller_construct(void)
 }
 
 int
-spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_name, bool readonly)
+spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_name,
+			 bool readonly, bool distribute_queues)
 {
 	struct spdk_vhost_blk_dev *bvdev = NULL;
 	struct spdk_bdev *bdev;
@@ -1027,6 +1444,7 @@ spdk_vhost_blk_construct(const char *name, const char *cpumask, const char *dev_
 
 	bvdev->bdev = bdev;
 	bvdev->readonly = readonly;
+	bvdev->distribute_queues = distribute_queues;
 	ret = spdk_vhost_dev_register(&bvdev->vdev, name, cpumask, &vhost_blk_device_backend);
 	if (ret != 0) {
 		spdk_bdev_close(bvdev->bdev_desc);
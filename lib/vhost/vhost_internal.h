@@ -53,6 +53,36 @@
 #define VIRTIO_F_VERSION_1 32
 #endif
 
+#ifndef VIRTIO_F_RING_PACKED
+#define VIRTIO_F_RING_PACKED 34
+#endif
+
+#ifndef VRING_PACKED_DESC_F_AVAIL
+/* Packed virtqueue layout from the virtio 1.1 specification. */
+#define VRING_PACKED_DESC_F_AVAIL	7
+#define VRING_PACKED_DESC_F_USED	15
+
+#define VRING_PACKED_EVENT_FLAG_ENABLE	0x0
+#define VRING_PACKED_EVENT_FLAG_DISABLE	0x1
+#define VRING_PACKED_EVENT_FLAG_DESC	0x2
+
+struct vring_packed_desc_event {
+	uint16_t off_wrap;
+	uint16_t flags;
+};
+
+struct vring_packed_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t id;
+	uint16_t flags;
+};
+#endif
+
+#define SPDK_VRING_DESC_F_AVAIL		(1 << VRING_PACKED_DESC_F_AVAIL)
+#define SPDK_VRING_DESC_F_USED		(1 << VRING_PACKED_DESC_F_USED)
+#define SPDK_VRING_DESC_F_AVAIL_USED	(SPDK_VRING_DESC_F_AVAIL | SPDK_VRING_DESC_F_USED)
+
 #ifndef VIRTIO_BLK_F_MQ
 #define VIRTIO_BLK_F_MQ		12	/* support more than one vq */
 #endif
@@ -83,6 +113,19 @@
  */
 #define SPDK_VHOST_COALESCING_DELAY_BASE_US 0
 
+/*
+ * In adaptive coalescing mode, the interrupt delay of a virtqueue is long
+ * enough to gather up to this many completions at the observed completion
+ * rate, but never longer than the configured target latency.
+ */
+#define SPDK_VHOST_ADAPTIVE_COALESCING_MAX_BATCH 32
+
+
+/*
+ * Maximum number of dirty guest memory ranges a virtqueue gathers during a
+ * completion burst before they are written to the live migration log.
+ */
+#define SPDK_VHOST_LOG_RANGES_MAX 16
 
 #define SPDK_VHOST_FEATURES ((1ULL << VHOST_F_LOG_ALL) | \
 	(1ULL << VHOST_USER_F_PROTOCOL_FEATURES) | \
@@ -94,11 +137,30 @@
 #define SPDK_VHOST_DISABLED_FEATURES ((1ULL << VIRTIO_RING_F_EVENT_IDX) | \
 	(1ULL << VIRTIO_F_NOTIFY_ON_EMPTY))
 
+/* Range of dirty guest pages, both ends inclusive. */
+struct spdk_vhost_log_range {
+	uint64_t first_page;
+	uint64_t last_page;
+};
+
 struct spdk_vhost_virtqueue {
 	struct rte_vhost_vring vring;
 	uint16_t last_avail_idx;
 	uint16_t last_used_idx;
 
+	/*
+	 * Set if VIRTIO_F_RING_PACKED was negotiated. In that case
+	 * vring.desc points to the packed descriptor ring, vring.avail
+	 * to the driver event suppression area and vring.used to the
+	 * device one. last_avail_idx and last_used_idx are then ring
+	 * positions, and the phases are the matching wrap counters.
+	 */
+	struct {
+		bool packed_ring;
+		bool avail_phase;
+		bool used_phase;
+	} packed;
+
 	void *tasks;
 
 	/* Request count from last stats check */
@@ -110,9 +172,28 @@ struct spdk_vhost_virtqueue {
 	/* How long interrupt is delayed */
 	uint32_t irq_delay_time;
 
+	/* Set if irq_delay_time was computed in adaptive coalescing mode */
+	bool irq_delay_adaptive;
+
 	/* Next time when we need to send event */
 	uint64_t next_event_time;
 
+	/* Number of events sent to the guest */
+	uint64_t irq_cnt;
+
+	/*
+	 * Guest memory written since the last flush of the live migration
+	 * log. Only used if VHOST_F_LOG_ALL was negotiated.
+	 */
+	struct {
+		struct spdk_vhost_log_range ranges[SPDK_VHOST_LOG_RANGES_MAX];
+		uint16_t range_cnt;
+
+		/* Dirty part of the used ring, as byte offsets [used_start, used_end) */
+		uint32_t used_start;
+		uint32_t used_end;
+	} log;
+
 } __attribute((aligned(SPDK_CACHE_LINE_SIZE)));
 
 struct spdk_vhost_session {
@@ -139,6 +220,7 @@ struct spdk_vhost_session {
 	/* Local copy of device coalescing settings. */
 	uint32_t coalescing_delay_time_base;
 	uint32_t coalescing_io_rate_threshold;
+	uint32_t coalescing_target_latency;
 
 	/* Next time when stats for event coalescing will be checked. */
 	uint64_t next_stats_check_time;
@@ -165,6 +247,7 @@ struct spdk_vhost_dev {
 	 */
 	uint32_t coalescing_delay_us;
 	uint32_t coalescing_iops_threshold;
+	uint32_t coalescing_target_latency_us;
 
 	/* Current connections to the device */
 	TAILQ_HEAD(, spdk_vhost_session) vsessions;
@@ -253,6 +336,84 @@ int spdk_vhost_vq_get_desc(struct spdk_vhost_session *vsession, struct spdk_vhos
 			   uint16_t req_idx, struct vring_desc **desc, struct vring_desc **desc_table,
 			   uint32_t *desc_table_size);
 
+/**
+ * Check if the next descriptor in a packed virtqueue was made available
+ * by the driver.
+ * \param vq packed virtqueue
+ * \return true if there is a new request at \c vq->last_avail_idx
+ */
+bool spdk_vhost_vq_packed_ring_is_avail(struct spdk_vhost_virtqueue *vq);
+
+/**
+ * Get the buffer ID of the request starting at given position of a packed
+ * virtqueue. The ID is stored in the last descriptor of the chain.
+ * \param vq packed virtqueue
+ * \param req_idx ring position of the first descriptor of the request
+ * \param num_descs will be set to the number of ring descriptors used by
+ * the request
+ * \return buffer ID of the request
+ */
+uint16_t spdk_vhost_vring_packed_desc_get_buffer_id(struct spdk_vhost_virtqueue *vq,
+		uint16_t req_idx, uint16_t *num_descs);
+
+/**
+ * Consume \c num_descs descriptors from the packed virtqueue avail ring.
+ * \param vq packed virtqueue
+ * \param num_descs number of descriptors to consume
+ */
+void spdk_vhost_vq_packed_ring_consume(struct spdk_vhost_virtqueue *vq, uint16_t num_descs);
+
+/**
+ * Get a packed virtqueue descriptor at given ring position.
+ * Subsequent descriptors are accessible via
+ * \c spdk_vhost_vring_packed_desc_get_next.
+ * \param vsession vhost session
+ * \param vq packed virtqueue
+ * \param req_idx ring position of the first descriptor of the request
+ * \param desc pointer to be set to the descriptor
+ * \param desc_table will be set to the indirect descriptor table
+ * if the request uses one, NULL otherwise
+ * \param desc_table_size size of the *desc_table*
+ * \return 0 on success, -1 if given index is invalid.
+ */
+int spdk_vhost_vq_get_desc_packed(struct spdk_vhost_session *vsession,
+				  struct spdk_vhost_virtqueue *vq, uint16_t req_idx,
+				  struct vring_packed_desc **desc,
+				  struct vring_packed_desc **desc_table, uint32_t *desc_table_size);
+
+/**
+ * Get subsequent descriptor of a packed virtqueue request.
+ * \param desc current descriptor, will be set to the next descriptor
+ * (NULL in case this is the last descriptor in the chain)
+ * \param req_idx position of the current descriptor in the ring or the
+ * indirect table, will be set to the position of the next one
+ * \param vq packed virtqueue
+ * \param desc_table indirect descriptor table or NULL
+ * \param desc_table_size size of the *desc_table*
+ * \return 0 on success, -1 if the chain is invalid
+ */
+int spdk_vhost_vring_packed_desc_get_next(struct vring_packed_desc **desc, uint16_t *req_idx,
+		struct spdk_vhost_virtqueue *vq,
+		struct vring_packed_desc *desc_table,
+		uint32_t desc_table_size);
+
+bool spdk_vhost_vring_packed_desc_is_wr(struct vring_packed_desc *cur_desc);
+
+int spdk_vhost_vring_packed_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
+					uint16_t *iov_index, const struct vring_packed_desc *desc);
+
+/**
+ * Mark a request of a packed virtqueue as used.
+ * \param vsession vhost session
+ * \param vq packed virtqueue
+ * \param num_descs number of ring descriptors used by the request
+ * \param buffer_id buffer ID of the request
+ * \param length number of bytes written to the request buffers
+ */
+void spdk_vhost_vq_packed_ring_enqueue(struct spdk_vhost_session *vsession,
+				       struct spdk_vhost_virtqueue *vq, uint16_t num_descs,
+				       uint16_t buffer_id, uint32_t length);
+
 /**
  * Send IRQ/call client (if pending) for \c vq.
  * \param vsession vhost session
@@ -271,6 +432,20 @@ int spdk_vhost_vq_used_signal(struct spdk_vhost_session *vsession, struct spdk_v
  */
 void spdk_vhost_session_used_signal(struct spdk_vhost_session *vsession);
 
+/**
+ * Send IRQs for the queues in range [first_q, first_q + num_q) that need to
+ * be signaled. Used by backends that poll disjoint sets of a session's queues
+ * from different threads.
+ *
+ * \param vsession vhost session
+ * \param first_q index of the first queue in the range
+ * \param num_q number of queues in the range
+ * \param next_stats_check_time next time the event coalescing stats of
+ * this range will be checked. Must be owned by the calling thread.
+ */
+void spdk_vhost_session_used_signal_range(struct spdk_vhost_session *vsession, uint16_t first_q,
+		uint16_t num_q, uint64_t *next_stats_check_time);
+
 void spdk_vhost_vq_used_ring_enqueue(struct spdk_vhost_session *vsession,
 				     struct spdk_vhost_virtqueue *vq,
 				     uint16_t id, uint32_t len);
@@ -293,6 +468,31 @@ bool spdk_vhost_vring_desc_is_wr(struct vring_desc *cur_desc);
 int spdk_vhost_vring_desc_to_iov(struct spdk_vhost_session *vsession, struct iovec *iov,
 				 uint16_t *iov_index, const struct vring_desc *desc);
 
+/**
+ * Log guest memory writes to the given buffers if dirty page logging
+ * is enabled for the session. The writes are gathered in the virtqueue
+ * and written to the log on the next spdk_vhost_vq_log_flush().
+ * \param vsession vhost session
+ * \param virtqueue virtqueue the buffers came from
+ * \param iovs buffers mapped from guest memory
+ * \param iovcnt number of buffers
+ */
+void spdk_vhost_log_iovs(struct spdk_vhost_session *vsession,
+			 struct spdk_vhost_virtqueue *virtqueue,
+			 const struct iovec *iovs, uint16_t iovcnt);
+
+/**
+ * Write guest memory writes gathered in the virtqueue to the live
+ * migration log. This is done by spdk_vhost_vq_used_signal() and
+ * spdk_vhost_session_used_signal_range() for each virtqueue they
+ * check, so backends only need to call it directly if they complete
+ * requests without signalling the virtqueue.
+ * \param vsession vhost session
+ * \param virtqueue virtqueue to flush
+ */
+void spdk_vhost_vq_log_flush(struct spdk_vhost_session *vsession,
+			     struct spdk_vhost_virtqueue *virtqueue);
+
 static inline bool __attribute__((always_inline))
 spdk_vhost_dev_has_feature(struct spdk_vhost_session *vsession, unsigned feature_id)
 {
@@ -307,6 +507,14 @@ int spdk_vhost_scsi_controller_construct(void);
 int spdk_vhost_blk_controller_construct(void);
 void spdk_vhost_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w);
 
+/*
+ * Write the interrupt statistics of each virtqueue of each session of
+ * the given device as a JSON array. Must be called with the global vhost
+ * lock held. The counters are read without synchronization with the
+ * session pollers, so they are only approximate.
+ */
+void spdk_vhost_dump_queue_stats_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w);
+
 /*
  * Call function for each active session on the provided
  * vhost device. The function will be called one-by-one
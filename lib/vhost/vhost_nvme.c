@@ -1103,7 +1103,7 @@ spdk_vhost_nvme_start_cb(struct spdk_vhost_dev *vdev,
 
 	nvme->vsession = vsession;
 	/* Start the NVMe Poller */
-	nvme->requestq_poller = spdk_poller_register(nvme_worker, nvme, 0);
+	nvme->requestq_poller = SPDK_POLLER_REGISTER(nvme_worker, nvme, 0);
 
 	spdk_vhost_session_event_done(event_ctx, 0);
 	return 0;
@@ -1204,7 +1204,7 @@ spdk_vhost_nvme_stop_cb(struct spdk_vhost_dev *vdev,
 
 	nvme->destroy_ctx.event_ctx = event_ctx;
 	spdk_poller_unregister(&nvme->requestq_poller);
-	nvme->destroy_ctx.poller = spdk_poller_register(destroy_device_poller_cb, nvme, 1000);
+	nvme->destroy_ctx.poller = SPDK_POLLER_REGISTER(destroy_device_poller_cb, nvme, 1000);
 
 	return 0;
 }
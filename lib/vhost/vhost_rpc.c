@@ -249,6 +249,7 @@ struct rpc_vhost_blk_ctrlr {
 	char *dev_name;
 	char *cpumask;
 	bool readonly;
+	bool distribute_queues;
 };
 
 static const struct spdk_json_object_decoder rpc_construct_vhost_blk_ctrlr[] = {
@@ -256,6 +257,7 @@ static const struct spdk_json_object_decoder rpc_construct_vhost_blk_ctrlr[] = {
 	{"dev_name", offsetof(struct rpc_vhost_blk_ctrlr, dev_name), spdk_json_decode_string },
 	{"cpumask", offsetof(struct rpc_vhost_blk_ctrlr, cpumask), spdk_json_decode_string, true},
 	{"readonly", offsetof(struct rpc_vhost_blk_ctrlr, readonly), spdk_json_decode_bool, true},
+	{"distribute_queues", offsetof(struct rpc_vhost_blk_ctrlr, distribute_queues), spdk_json_decode_bool, true},
 };
 
 static void
@@ -282,7 +284,8 @@ spdk_rpc_construct_vhost_blk_controller(struct spdk_jsonrpc_request *request,
 		goto invalid;
 	}
 
-	rc = spdk_vhost_blk_construct(req.ctrlr, req.cpumask, req.dev_name, req.readonly);
+	rc = spdk_vhost_blk_construct(req.ctrlr, req.cpumask, req.dev_name, req.readonly,
+				      req.distribute_queues);
 	if (rc < 0) {
 		goto invalid;
 	}
@@ -388,8 +391,12 @@ _spdk_rpc_get_vhost_controller(struct spdk_json_write_ctx *w, struct spdk_vhost_
 	spdk_json_write_named_string_fmt(w, "cpumask", "0x%s", spdk_cpuset_fmt(vdev->cpumask));
 	spdk_json_write_named_uint32(w, "delay_base_us", delay_base_us);
 	spdk_json_write_named_uint32(w, "iops_threshold", iops_threshold);
+	spdk_json_write_named_uint32(w, "target_latency_us", spdk_vhost_get_adaptive_coalescing(vdev));
 	spdk_json_write_named_string(w, "socket", vdev->path);
 
+	spdk_json_write_name(w, "sessions");
+	spdk_vhost_dump_queue_stats_json(vdev, w);
+
 	spdk_json_write_named_object_begin(w, "backend_specific");
 	spdk_vhost_dump_info_json(vdev, w);
 	spdk_json_write_object_end(w);
@@ -544,6 +551,70 @@ invalid:
 SPDK_RPC_REGISTER("set_vhost_controller_coalescing", spdk_rpc_set_vhost_controller_coalescing,
 		  SPDK_RPC_RUNTIME)
 
+struct rpc_vhost_ctrlr_adaptive_coalescing {
+	char *ctrlr;
+	uint32_t target_latency_us;
+};
+
+static const struct spdk_json_object_decoder rpc_set_vhost_ctrlr_adaptive_coalescing[] = {
+	{"ctrlr", offsetof(struct rpc_vhost_ctrlr_adaptive_coalescing, ctrlr), spdk_json_decode_string },
+	{"target_latency_us", offsetof(struct rpc_vhost_ctrlr_adaptive_coalescing, target_latency_us), spdk_json_decode_uint32},
+};
+
+static void
+free_rpc_set_vhost_controller_adaptive_coalescing(struct rpc_vhost_ctrlr_adaptive_coalescing *req)
+{
+	free(req->ctrlr);
+}
+
+static void
+spdk_rpc_set_vhost_controller_adaptive_coalescing(struct spdk_jsonrpc_request *request,
+		const struct spdk_json_val *params)
+{
+	struct rpc_vhost_ctrlr_adaptive_coalescing req = {0};
+	struct spdk_json_write_ctx *w;
+	struct spdk_vhost_dev *vdev;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_set_vhost_ctrlr_adaptive_coalescing,
+				    SPDK_COUNTOF(rpc_set_vhost_ctrlr_adaptive_coalescing), &req)) {
+		SPDK_DEBUGLOG(SPDK_LOG_VHOST_RPC, "spdk_json_decode_object failed\n");
+		rc = -EINVAL;
+		goto invalid;
+	}
+
+	spdk_vhost_lock();
+	vdev = spdk_vhost_dev_find(req.ctrlr);
+	if (vdev == NULL) {
+		spdk_vhost_unlock();
+		rc = -ENODEV;
+		goto invalid;
+	}
+
+	rc = spdk_vhost_set_adaptive_coalescing(vdev, req.target_latency_us);
+	spdk_vhost_unlock();
+	if (rc) {
+		goto invalid;
+	}
+
+	free_rpc_set_vhost_controller_adaptive_coalescing(&req);
+
+	w = spdk_jsonrpc_begin_result(request);
+	if (w != NULL) {
+		spdk_json_write_bool(w, true);
+		spdk_jsonrpc_end_result(request, w);
+	}
+
+	return;
+
+invalid:
+	free_rpc_set_vhost_controller_adaptive_coalescing(&req);
+	spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+					 spdk_strerror(-rc));
+}
+SPDK_RPC_REGISTER("set_vhost_controller_adaptive_coalescing",
+		  spdk_rpc_set_vhost_controller_adaptive_coalescing, SPDK_RPC_RUNTIME)
+
 #ifdef SPDK_CONFIG_VHOST_INTERNAL_LIB
 
 struct rpc_vhost_nvme_ctrlr {
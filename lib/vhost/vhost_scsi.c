@@ -1283,10 +1283,10 @@ spdk_vhost_scsi_start_cb(struct spdk_vhost_dev *vdev,
 	SPDK_INFOLOG(SPDK_LOG_VHOST, "Started poller for vhost controller %s on lcore %d\n",
 		     vdev->name, vsession->lcore);
 
-	svsession->requestq_poller = spdk_poller_register(vdev_worker, svsession, 0);
+	svsession->requestq_poller = SPDK_POLLER_REGISTER(vdev_worker, svsession, 0);
 	if (vsession->virtqueue[VIRTIO_SCSI_CONTROLQ].vring.desc &&
 	    vsession->virtqueue[VIRTIO_SCSI_EVENTQ].vring.desc) {
-		svsession->mgmt_poller = spdk_poller_register(vdev_mgmt_worker, svsession,
+		svsession->mgmt_poller = SPDK_POLLER_REGISTER(vdev_mgmt_worker, svsession,
 					 MGMT_POLL_PERIOD_US);
 	}
 out:
@@ -1376,7 +1376,7 @@ spdk_vhost_scsi_stop_cb(struct spdk_vhost_dev *vdev,
 	svsession->destroy_ctx.event_ctx = event_ctx;
 	spdk_poller_unregister(&svsession->requestq_poller);
 	spdk_poller_unregister(&svsession->mgmt_poller);
-	svsession->destroy_ctx.poller = spdk_poller_register(destroy_session_poller_cb,
+	svsession->destroy_ctx.poller = SPDK_POLLER_REGISTER(destroy_session_poller_cb,
 					svsession, 1000);
 
 	return 0;
@@ -111,15 +111,38 @@ if __name__ == "__main__":
     p.add_argument('-d', '--disable', action='store_true', help='Disable context switch monitoring')
     p.set_defaults(func=context_switch_monitor)
 
+    def thread_get_stats(args):
+        print_dict(rpc.app.thread_get_stats(args.client))
+
+    p = subparsers.add_parser('thread_get_stats', help='Display current statistics of all the threads')
+    p.set_defaults(func=thread_get_stats)
+
+    def thread_get_pollers(args):
+        print_dict(rpc.app.thread_get_pollers(args.client,
+                                              name=args.name))
+
+    p = subparsers.add_parser('thread_get_pollers', help='Display current pollers and their statistics')
+    p.add_argument('-n', '--name', help='Only display the pollers of the thread with this name')
+    p.set_defaults(func=thread_get_pollers)
+
     # bdev
     def set_bdev_options(args):
+        buf_class_counts = None
+        if args.buf_class_counts:
+            buf_class_counts = [int(count) for count in args.buf_class_counts.strip().split(",")]
         rpc.bdev.set_bdev_options(args.client,
                                   bdev_io_pool_size=args.bdev_io_pool_size,
-                                  bdev_io_cache_size=args.bdev_io_cache_size)
+                                  bdev_io_cache_size=args.bdev_io_cache_size,
+                                  buf_class_counts=buf_class_counts,
+                                  buf_cache_size=args.buf_cache_size)
 
     p = subparsers.add_parser('set_bdev_options', help="""Set options of bdev subsystem""")
     p.add_argument('-p', '--bdev-io-pool-size', help='Number of bdev_io structures in shared buffer pool', type=int)
     p.add_argument('-c', '--bdev-io-cache-size', help='Maximum number of bdev_io structures cached per thread', type=int)
+    p.add_argument('-b', '--buf-class-counts', help="""Comma separated number of data buffers of each size
+    class: 4KiB, 8KiB, 16KiB, 32KiB, 64KiB, 128KiB and 1MiB. 0 disables a class. Example: 4096,2048,1024,512,512,128,16""")
+    p.add_argument('-s', '--buf-cache-size', help='Maximum number of data buffers of each size class cached per thread',
+                   type=int)
     p.set_defaults(func=set_bdev_options)
 
     def construct_crypto_bdev(args):
@@ -542,6 +565,13 @@ if __name__ == "__main__":
     p.add_argument('bdev_name', help='name of the NVMe device')
     p.set_defaults(func=apply_firmware)
 
+    # blobfs
+    def get_blobfs_cache_stats(args):
+        print_dict(rpc.blobfs.get_blobfs_cache_stats(args.client))
+
+    p = subparsers.add_parser('get_blobfs_cache_stats', help='Display blobfs cache statistics')
+    p.set_defaults(func=get_blobfs_cache_stats)
+
     # iSCSI
     def set_iscsi_options(args):
         rpc.iscsi.set_iscsi_options(
@@ -563,7 +593,9 @@ if __name__ == "__main__":
             immediate_data=args.immediate_data,
             error_recovery_level=args.error_recovery_level,
             allow_duplicated_isid=args.allow_duplicated_isid,
-            min_connections_per_core=args.min_connections_per_core)
+            min_connections_per_core=args.min_connections_per_core,
+            max_direct_writes_per_connection=args.max_direct_writes_per_connection,
+            direct_write_buffer_count=args.direct_write_buffer_count)
 
     p = subparsers.add_parser('set_iscsi_options', help="""Set options of iSCSI subsystem""")
     p.add_argument('-f', '--auth-file', help='Path to CHAP shared secret file')
@@ -587,6 +619,10 @@ if __name__ == "__main__":
     p.add_argument('-l', '--error-recovery-level', help='Negotiated parameter, ErrorRecoveryLevel', type=int)
     p.add_argument('-p', '--allow-duplicated-isid', help='Allow duplicated initiator session ID.', action='store_true')
     p.add_argument('-u', '--min-connections-per-core', help='Allocation unit of connections per core', type=int)
+    p.add_argument('--max-direct-writes-per-connection', help="""Maximum number of contiguous write buffers
+    used by a connection at a time. 0 disables them.""", type=int)
+    p.add_argument('--direct-write-buffer-count', help="""Number of contiguous write buffers shared by
+    all connections. 0 disables them.""", type=int)
     p.set_defaults(func=set_iscsi_options)
 
     def set_iscsi_discovery_auth(args):
@@ -1256,12 +1292,21 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
 
     # ftl
     def construct_ftl_bdev(args):
+        l2p_cache_size = None
+        if args.l2p_cache_size:
+            l2p_cache_size = args.l2p_cache_size * 1024 * 1024
+        cold_write_size = None
+        if args.cold_write_size:
+            cold_write_size = args.cold_write_size * 1024
         print_dict(rpc.bdev.construct_ftl_bdev(args.client,
                                                name=args.name,
                                                trtype=args.trtype,
                                                traddr=args.traddr,
+                                               base_bdev=args.base_bdev,
                                                punits=args.punits,
-                                               uuid=args.uuid))
+                                               uuid=args.uuid,
+                                               l2p_cache_size=l2p_cache_size,
+                                               cold_write_size=cold_write_size))
 
     p = subparsers.add_parser('construct_ftl_bdev',
                               help='Add FTL bdev')
@@ -1269,11 +1314,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-t', '--trtype',
                    help='NVMe target trtype: e.g., pcie', default='pcie')
     p.add_argument('-a', '--traddr',
-                   help='NVMe target address: e.g., an ip address or BDF', required=True)
+                   help='NVMe target address: e.g., an ip address or BDF')
+    p.add_argument('-d', '--base_bdev', help='Name of the bdev to emulate Open-Channel device on '
+                   '(used instead of traddr): e.g. Malloc0')
     p.add_argument('-l', '--punits', help='Parallel unit range in the form of start-end: e.g. 4-8',
                    required=True)
     p.add_argument('-u', '--uuid', help='UUID of restored bdev (not applicable when creating new '
                    'instance): e.g. b286d19a-0059-4709-abcd-9f7732b1567d (optional)')
+    p.add_argument('-c', '--l2p_cache_size', help='Memory limit for the L2P table in MiB, the rest of '
+                   'it is paged in from the base bdev (base_bdev only, optional)', type=int)
+    p.add_argument('-s', '--cold_write_size', help='Enable per-stream data placement and write '
+                   'requests of at least this many KiB to the cold stream (optional)', type=int)
     p.set_defaults(func=construct_ftl_bdev)
 
     def delete_ftl_bdev(args):
@@ -1287,11 +1338,14 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     def start_nbd_disk(args):
         print(rpc.nbd.start_nbd_disk(args.client,
                                      bdev_name=args.bdev_name,
-                                     nbd_device=args.nbd_device))
+                                     nbd_device=args.nbd_device,
+                                     num_connections=args.num_connections))
 
     p = subparsers.add_parser('start_nbd_disk', help='Export a bdev as a nbd disk')
     p.add_argument('bdev_name', help='Blockdev name to be exported. Example: Malloc0.')
     p.add_argument('nbd_device', help='Nbd device name to be assigned. Example: /dev/nbd0.')
+    p.add_argument('-c', '--num-connections', help='Number of sockets the nbd disk is served over. Default: 1.',
+                   type=int)
     p.set_defaults(func=start_nbd_disk)
 
     def stop_nbd_disk(args):
@@ -1366,7 +1420,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                        io_unit_size=args.io_unit_size,
                                        max_aq_depth=args.max_aq_depth,
                                        num_shared_buffers=args.num_shared_buffers,
-                                       buf_cache_size=args.buf_cache_size)
+                                       buf_cache_size=args.buf_cache_size,
+                                       max_reqs=args.max_reqs)
 
     p = subparsers.add_parser('nvmf_create_transport', help='Create NVMf transport')
     p.add_argument('-t', '--trtype', help='Transport type (ex. RDMA)', type=str, required=True)
@@ -1378,6 +1433,7 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-a', '--max-aq-depth', help='Max number of admin cmds per AQ', type=int)
     p.add_argument('-n', '--num-shared-buffers', help='The number of pooled data buffers available to the transport', type=int)
     p.add_argument('-b', '--buf-cache-size', help='The number of shared buffers to reserve for each poll group', type=int)
+    p.add_argument('-r', '--max-reqs', help='Max number of requests of all queue pairs, TCP only', type=int)
     p.set_defaults(func=nvmf_create_transport)
 
     def get_nvmf_transports(args):
@@ -1399,7 +1455,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                        nqn=args.nqn,
                                        serial_number=args.serial_number,
                                        allow_any_host=args.allow_any_host,
-                                       max_namespaces=args.max_namespaces)
+                                       max_namespaces=args.max_namespaces,
+                                       ana_reporting=args.ana_reporting)
 
     p = subparsers.add_parser('nvmf_subsystem_create', help='Create an NVMe-oF subsystem')
     p.add_argument('nqn', help='Subsystem NQN (ASCII)')
@@ -1409,6 +1466,7 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument("-a", "--allow-any-host", action='store_true', help="Allow any host to connect (don't enforce host NQN whitelist)")
     p.add_argument("-m", "--max-namespaces", help="Maximum number of namespaces allowed",
                    type=int, default=0)
+    p.add_argument("-r", "--ana-reporting", action='store_true', help="Enable ANA reporting feature")
     p.set_defaults(func=nvmf_subsystem_create)
 
     def delete_nvmf_subsystem(args):
@@ -1453,6 +1511,28 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-s', '--trsvcid', help='NVMe-oF transport service id: e.g., a port number')
     p.set_defaults(func=nvmf_subsystem_remove_listener)
 
+    def nvmf_subsystem_listener_set_ana_state(args):
+        rpc.nvmf.nvmf_subsystem_listener_set_ana_state(args.client,
+                                                       nqn=args.nqn,
+                                                       ana_state=args.ana_state,
+                                                       trtype=args.trtype,
+                                                       traddr=args.traddr,
+                                                       adrfam=args.adrfam,
+                                                       trsvcid=args.trsvcid,
+                                                       anagrpid=args.anagrpid)
+
+    p = subparsers.add_parser('nvmf_subsystem_listener_set_ana_state',
+                              help='Set ANA state of a listener of an NVMe-oF subsystem')
+    p.add_argument('nqn', help='NVMe-oF subsystem NQN')
+    p.add_argument('-n', '--ana-state', help='ANA state to set: optimized, non_optimized, inaccessible, '
+                   'persistent_loss or change', required=True)
+    p.add_argument('-t', '--trtype', help='NVMe-oF transport type: e.g., rdma', required=True)
+    p.add_argument('-a', '--traddr', help='NVMe-oF transport address: e.g., an ip address', required=True)
+    p.add_argument('-f', '--adrfam', help='NVMe-oF transport adrfam: e.g., ipv4, ipv6, ib, fc, intra_host')
+    p.add_argument('-s', '--trsvcid', help='NVMe-oF transport service id: e.g., a port number')
+    p.add_argument('-g', '--anagrpid', help='ANA group ID (equal to the NSID); all groups if omitted', type=int)
+    p.set_defaults(func=nvmf_subsystem_listener_set_ana_state)
+
     def nvmf_subsystem_add_ns(args):
         rpc.nvmf.nvmf_subsystem_add_ns(args.client,
                                        nqn=args.nqn,
@@ -1570,6 +1650,18 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('iops_threshold', help='IOPS threshold when coalescing is enabled', type=int)
     p.set_defaults(func=set_vhost_controller_coalescing)
 
+    def set_vhost_controller_adaptive_coalescing(args):
+        rpc.vhost.set_vhost_controller_adaptive_coalescing(args.client,
+                                                           ctrlr=args.ctrlr,
+                                                           target_latency_us=args.target_latency_us)
+
+    p = subparsers.add_parser('set_vhost_controller_adaptive_coalescing',
+                              help='Set vhost controller adaptive coalescing')
+    p.add_argument('ctrlr', help='controller name')
+    p.add_argument('target_latency_us', help='Maximum event delay in microseconds. 0 disables adaptive coalescing',
+                   type=int)
+    p.set_defaults(func=set_vhost_controller_adaptive_coalescing)
+
     def construct_vhost_scsi_controller(args):
         rpc.vhost.construct_vhost_scsi_controller(args.client,
                                                   ctrlr=args.ctrlr,
@@ -1609,13 +1701,16 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                                  ctrlr=args.ctrlr,
                                                  dev_name=args.dev_name,
                                                  cpumask=args.cpumask,
-                                                 readonly=args.readonly)
+                                                 readonly=args.readonly,
+                                                 distribute_queues=args.distribute_queues)
 
     p = subparsers.add_parser('construct_vhost_blk_controller', help='Add a new vhost block controller')
     p.add_argument('ctrlr', help='controller name')
     p.add_argument('dev_name', help='device name')
     p.add_argument('--cpumask', help='cpu mask for this controller')
     p.add_argument("-r", "--readonly", action='store_true', help='Set controller as read-only')
+    p.add_argument("-q", "--distribute-queues", action='store_true',
+                   help='Poll virtqueues of each connection on all cores of the cpu mask')
     p.set_defaults(func=construct_vhost_blk_controller)
 
     def construct_vhost_nvme_controller(args):
@@ -1662,7 +1757,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                                    traddr=args.traddr,
                                                    dev_type=args.dev_type,
                                                    vq_count=args.vq_count,
-                                                   vq_size=args.vq_size))
+                                                   vq_size=args.vq_size,
+                                                   poll_group=args.poll_group))
 
     p = subparsers.add_parser('construct_virtio_dev', help="""Construct new virtio device using provided
     transport type and device type. In case of SCSI device type this implies scan and add bdevs offered by
@@ -1676,6 +1772,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                    help='Device type: blk or scsi', required=True)
     p.add_argument('--vq-count', help='Number of virtual queues to be used.', type=int)
     p.add_argument('--vq-size', help='Size of each queue', type=int)
+    p.add_argument('--poll-group', help="""Reap completions of all queues used by a thread with a
+    single poller. Valid only for virtio-user blk devices.""", action='store_true')
     p.set_defaults(func=construct_virtio_dev)
 
     def get_virtio_scsi_devs(args):
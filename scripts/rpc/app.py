@@ -21,3 +21,27 @@ def context_switch_monitor(client, enabled=None):
     if enabled is not None:
         params['enabled'] = enabled
     return client.call('context_switch_monitor', params)
+
+
+def thread_get_stats(client):
+    """Query threads statistics.
+
+    Returns:
+        Current threads statistics.
+    """
+    return client.call('thread_get_stats')
+
+
+def thread_get_pollers(client, name=None):
+    """Query current pollers.
+
+    Args:
+        name: only report the pollers of the thread with this name (optional)
+
+    Returns:
+        Current pollers.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('thread_get_pollers', params)
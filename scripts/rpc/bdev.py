@@ -1,9 +1,12 @@
-def set_bdev_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None):
+def set_bdev_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None, buf_class_counts=None,
+                     buf_cache_size=None):
     """Set parameters for the bdev subsystem.
 
     Args:
         bdev_io_pool_size: number of bdev_io structures in shared buffer pool (optional)
         bdev_io_cache_size: maximum number of bdev_io structures cached per thread (optional)
+        buf_class_counts: list of the number of data buffers of each size class, from 4KiB up to 1MiB (optional)
+        buf_cache_size: maximum number of data buffers of each size class cached per thread (optional)
     """
     params = {}
 
@@ -11,6 +14,10 @@ def set_bdev_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None):
         params['bdev_io_pool_size'] = bdev_io_pool_size
     if bdev_io_cache_size:
         params['bdev_io_cache_size'] = bdev_io_cache_size
+    if buf_class_counts:
+        params['buf_class_counts'] = buf_class_counts
+    if buf_cache_size is not None:
+        params['buf_cache_size'] = buf_cache_size
 
     return client.call('set_bdev_options', params)
 
@@ -516,22 +523,35 @@ def destruct_split_vbdev(client, base_bdev):
     return client.call('destruct_split_vbdev', params)
 
 
-def construct_ftl_bdev(client, name, trtype, traddr, punits, uuid=None):
+def construct_ftl_bdev(client, name, punits, trtype=None, traddr=None, base_bdev=None, uuid=None,
+                       l2p_cache_size=None, cold_write_size=None):
     """Construct FTL bdev
 
     Args:
         name: name of the bdev
+        punits: parallel unit range
         trtype: transport type
         traddr: transport address
-        punit: parallel unit range
+        base_bdev: name of the bdev to emulate Open-Channel device on (instead of traddr)
         uuid: UUID of the device
+        l2p_cache_size: memory limit for the L2P table in bytes (base_bdev only)
+        cold_write_size: writes of at least this many bytes are placed in the cold stream
+            (enables per-stream data placement)
     """
     params = {'name': name,
-              'trtype': trtype,
-              'traddr': traddr,
               'punits': punits}
+    if trtype:
+        params['trtype'] = trtype
+    if traddr:
+        params['traddr'] = traddr
+    if base_bdev:
+        params['base_bdev'] = base_bdev
     if uuid:
         params['uuid'] = uuid
+    if l2p_cache_size:
+        params['l2p_cache_size'] = l2p_cache_size
+    if cold_write_size:
+        params['cold_write_size'] = cold_write_size
     return client.call('construct_ftl_bdev', params)
 
 
@@ -0,0 +1,3 @@
+def get_blobfs_cache_stats(client):
+    """Get statistics of the blobfs cache shared by all filesystems."""
+    return client.call('get_blobfs_cache_stats')
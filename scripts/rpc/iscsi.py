@@ -19,7 +19,9 @@ def set_iscsi_options(
         immediate_data=None,
         error_recovery_level=None,
         allow_duplicated_isid=None,
-        min_connections_per_core=None):
+        min_connections_per_core=None,
+        max_direct_writes_per_connection=None,
+        direct_write_buffer_count=None):
     """Set iSCSI target options.
 
     Args:
@@ -41,6 +43,8 @@ def set_iscsi_options(
         error_recovery_level: Negotiated parameter, ErrorRecoveryLevel
         allow_duplicated_isid: Allow duplicated initiator session ID
         min_connections_per_core: Allocation unit of connections per core
+        max_direct_writes_per_connection: Maximum number of write buffers used by a connection
+        direct_write_buffer_count: Number of write buffers shared by all connections
 
     Returns:
         True or False
@@ -83,6 +87,10 @@ def set_iscsi_options(
         params['allow_duplicated_isid'] = allow_duplicated_isid
     if min_connections_per_core:
         params['min_connections_per_core'] = min_connections_per_core
+    if max_direct_writes_per_connection is not None:
+        params['max_direct_writes_per_connection'] = max_direct_writes_per_connection
+    if direct_write_buffer_count is not None:
+        params['direct_write_buffer_count'] = direct_write_buffer_count
 
     return client.call('set_iscsi_options', params)
 
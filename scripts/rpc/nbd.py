@@ -1,8 +1,10 @@
-def start_nbd_disk(client, bdev_name, nbd_device):
+def start_nbd_disk(client, bdev_name, nbd_device, num_connections=None):
     params = {
         'bdev_name': bdev_name,
         'nbd_device': nbd_device
     }
+    if num_connections:
+        params['num_connections'] = num_connections
     return client.call('start_nbd_disk', params)
 
 
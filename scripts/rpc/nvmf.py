@@ -44,7 +44,8 @@ def nvmf_create_transport(client,
                           io_unit_size=None,
                           max_aq_depth=None,
                           num_shared_buffers=None,
-                          buf_cache_size=None):
+                          buf_cache_size=None,
+                          max_reqs=None):
     """NVMf Transport Create options.
 
     Args:
@@ -57,6 +58,7 @@ def nvmf_create_transport(client,
         max_aq_depth: Max size admin quque per controller (optional)
         num_shared_buffers: The number of pooled data buffers available to the transport (optional)
         buf_cache_size: The number of shared buffers to reserve for each poll group(optional)
+        max_reqs: Max number of requests of all queue pairs, TCP only (optional)
 
     Returns:
         True or False
@@ -80,6 +82,8 @@ def nvmf_create_transport(client,
         params['num_shared_buffers'] = num_shared_buffers
     if buf_cache_size:
         params['buf_cache_size'] = buf_cache_size
+    if max_reqs:
+        params['max_reqs'] = max_reqs
     return client.call('nvmf_create_transport', params)
 
 
@@ -105,7 +109,8 @@ def nvmf_subsystem_create(client,
                           nqn,
                           serial_number,
                           allow_any_host=False,
-                          max_namespaces=0):
+                          max_namespaces=0,
+                          ana_reporting=False):
     """Construct an NVMe over Fabrics target subsystem.
 
     Args:
@@ -113,6 +118,7 @@ def nvmf_subsystem_create(client,
         serial_number: Serial number of virtual controller.
         allow_any_host: Allow any host (True) or enforce allowed host whitelist (False). Default: False.
         max_namespaces: Maximum number of namespaces that can be attached to the subsystem (optional). Default: 0 (Unlimited).
+        ana_reporting: Enable Asymmetric Namespace Access reporting (optional). Default: False.
 
     Returns:
         True or False
@@ -130,6 +136,9 @@ def nvmf_subsystem_create(client,
     if max_namespaces:
         params['max_namespaces'] = max_namespaces
 
+    if ana_reporting:
+        params['ana_reporting'] = True
+
     return client.call('nvmf_subsystem_create', params)
 
 
@@ -191,6 +200,46 @@ def nvmf_subsystem_remove_listener(
     return client.call('nvmf_subsystem_remove_listener', params)
 
 
+def nvmf_subsystem_listener_set_ana_state(
+        client,
+        nqn,
+        ana_state,
+        trtype,
+        traddr,
+        trsvcid,
+        adrfam,
+        anagrpid=None):
+    """Set ANA state of a listener of an NVMe-oF subsystem.
+
+    Args:
+        nqn: Subsystem NQN.
+        ana_state: ANA state to set ("optimized", "non_optimized", "inaccessible", "persistent_loss" or "change").
+        trtype: Transport type ("RDMA").
+        traddr: Transport address.
+        trsvcid: Transport service ID.
+        adrfam: Address family ("IPv4", "IPv6", "IB", or "FC").
+        anagrpid: ANA group ID, equal to the NSID (optional). Default: all ANA groups.
+
+    Returns:
+            True or False
+    """
+    listen_address = {'trtype': trtype,
+                      'traddr': traddr,
+                      'trsvcid': trsvcid}
+
+    if adrfam:
+        listen_address['adrfam'] = adrfam
+
+    params = {'nqn': nqn,
+              'listen_address': listen_address,
+              'ana_state': ana_state}
+
+    if anagrpid:
+        params['anagrpid'] = anagrpid
+
+    return client.call('nvmf_subsystem_listener_set_ana_state', params)
+
+
 def nvmf_subsystem_add_ns(client, nqn, bdev_name, nsid=None, nguid=None, eui64=None, uuid=None):
     """Add a namespace to a subsystem.
 
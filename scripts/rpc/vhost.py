@@ -13,6 +13,19 @@ def set_vhost_controller_coalescing(client, ctrlr, delay_base_us, iops_threshold
     return client.call('set_vhost_controller_coalescing', params)
 
 
+def set_vhost_controller_adaptive_coalescing(client, ctrlr, target_latency_us):
+    """Set adaptive coalescing for vhost controller.
+    Args:
+        ctrlr: controller name
+        target_latency_us: maximum event delay; 0 disables adaptive coalescing
+    """
+    params = {
+        'ctrlr': ctrlr,
+        'target_latency_us': target_latency_us,
+    }
+    return client.call('set_vhost_controller_adaptive_coalescing', params)
+
+
 def construct_vhost_scsi_controller(client, ctrlr, cpumask=None):
     """Construct a vhost scsi controller.
     Args:
@@ -87,13 +100,15 @@ def add_vhost_nvme_ns(client, ctrlr, bdev_name):
     return client.call('add_vhost_nvme_ns', params)
 
 
-def construct_vhost_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=None):
+def construct_vhost_blk_controller(client, ctrlr, dev_name, cpumask=None, readonly=None,
+                                   distribute_queues=None):
     """Construct vhost BLK controller.
     Args:
         ctrlr: controller name
         dev_name: device name to add to controller
         cpumask: cpu mask for this controller
         readonly: set controller as read-only
+        distribute_queues: poll virtqueues on all cores of the cpu mask
     """
     params = {
         'ctrlr': ctrlr,
@@ -103,6 +118,8 @@ def construct_vhost_blk_controller(client, ctrlr, dev_name, cpumask=None, readon
         params['cpumask'] = cpumask
     if readonly:
         params['readonly'] = readonly
+    if distribute_queues:
+        params['distribute_queues'] = distribute_queues
     return client.call('construct_vhost_blk_controller', params)
 
 
@@ -130,7 +147,8 @@ def remove_vhost_controller(client, ctrlr):
     return client.call('remove_vhost_controller', params)
 
 
-def construct_virtio_dev(client, name, trtype, traddr, dev_type, vq_count=None, vq_size=None):
+def construct_virtio_dev(client, name, trtype, traddr, dev_type, vq_count=None, vq_size=None,
+                         poll_group=None):
     """Construct new virtio device using provided
     transport type and device type.
     Args:
@@ -141,6 +159,7 @@ def construct_virtio_dev(client, name, trtype, traddr, dev_type, vq_count=None,
         dev_type: device type: blk or scsi
         vq_count: number of virtual queues to be used
         vq_size: size of each queue
+        poll_group: poll all queues of a thread with one poller (virtio-user blk only)
     """
     params = {
         'name': name,
@@ -152,6 +171,8 @@ def construct_virtio_dev(client, name, trtype, traddr, dev_type, vq_count=None,
         params['vq_count'] = vq_count
     if vq_size:
         params['vq_size'] = vq_size
+    if poll_group:
+        params['poll_group'] = poll_group
     return client.call('construct_virtio_dev', params)
 
 
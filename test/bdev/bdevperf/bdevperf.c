@@ -1143,9 +1143,9 @@ main(int argc, char **argv)
 		g_is_random = 1;
 	}
 
-	if (g_io_size > SPDK_BDEV_LARGE_BUF_MAX_SIZE) {
+	if (g_io_size > SPDK_BDEV_BUF_MAX_SIZE) {
 		printf("I/O size of %d is greater than zero copy threshold (%d).\n",
-		       g_io_size, SPDK_BDEV_LARGE_BUF_MAX_SIZE);
+		       g_io_size, SPDK_BDEV_BUF_MAX_SIZE);
 		printf("Zero copy mechanism will not be used.\n");
 		g_zcopy = false;
 	}
@@ -42,6 +42,17 @@ static int g_time_in_sec;
 static int g_queue_depth;
 static struct spdk_poller *test_end_poller;
 static uint64_t g_call_count = 0;
+static uint32_t g_msg_batch_size = 0;
+
+struct msg_core_ctx {
+	struct spdk_thread	*thread;
+	struct msg_core_ctx	*peer;
+	uint64_t		count;
+	uint32_t		received;
+};
+
+static struct msg_core_ctx *g_msg_ctx;
+static uint32_t g_msg_ctx_count;
 
 static int
 __test_end(void *arg)
@@ -63,6 +74,71 @@ __submit_next(void *arg1, void *arg2)
 	spdk_event_call(event);
 }
 
+static void __msg_recv(void *arg);
+
+static void
+__msg_send(struct msg_core_ctx *ctx)
+{
+	void *msgs[SPDK_THREAD_MSG_BATCH_MAX];
+	uint32_t i;
+	int rc;
+
+	if (g_msg_batch_size == 1) {
+		spdk_thread_send_msg(ctx->peer->thread, __msg_recv, ctx->peer);
+		return;
+	}
+
+	for (i = 0; i < g_msg_batch_size; i++) {
+		msgs[i] = ctx->peer;
+	}
+
+	rc = spdk_thread_send_msg_batch(ctx->peer->thread, __msg_recv, msgs, g_msg_batch_size);
+	if (rc != 0) {
+		fprintf(stderr, "Failed to send message batch: %s\n", spdk_strerror(-rc));
+	}
+}
+
+static void
+__msg_recv(void *arg)
+{
+	struct msg_core_ctx *ctx = arg;
+
+	ctx->count++;
+
+	/* Reply to the peer once a whole batch has arrived. */
+	if (++ctx->received == g_msg_batch_size) {
+		ctx->received = 0;
+		__msg_send(ctx);
+	}
+}
+
+static void
+__msg_get_thread(void *arg)
+{
+	g_msg_ctx[spdk_env_get_current_core()].thread = spdk_get_thread();
+}
+
+static void
+__msg_start(void *arg)
+{
+	uint32_t core, peer;
+	int i;
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		peer = spdk_env_get_next_core(core);
+		if (peer == UINT32_MAX) {
+			peer = spdk_env_get_first_core();
+		}
+		g_msg_ctx[core].peer = &g_msg_ctx[peer];
+	}
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		for (i = 0; i < g_queue_depth; i++) {
+			__msg_send(&g_msg_ctx[core]);
+		}
+	}
+}
+
 static void
 test_start(void *arg1, void *arg2)
 {
@@ -74,6 +150,20 @@ test_start(void *arg1, void *arg2)
 	test_end_poller = spdk_poller_register(__test_end, NULL,
 					       g_time_in_sec * 1000000ULL);
 
+	if (g_msg_batch_size > 0) {
+		g_msg_ctx_count = spdk_env_get_last_core() + 1;
+		g_msg_ctx = calloc(g_msg_ctx_count, sizeof(*g_msg_ctx));
+		if (g_msg_ctx == NULL) {
+			fprintf(stderr, "Unable to allocate message context\n");
+			spdk_app_stop(-1);
+			return;
+		}
+
+		/* Each core sends messages to the next core, in a ring. */
+		spdk_for_each_thread(__msg_get_thread, NULL, __msg_start);
+		return;
+	}
+
 	for (i = 0; i < g_queue_depth; i++) {
 		__submit_next(NULL, NULL);
 	}
@@ -94,6 +184,8 @@ usage(const char *program_name)
 	printf("%s options\n", program_name);
 	printf("\t[-q Queue depth (default: 1)]\n");
 	printf("\t[-t time in seconds]\n");
+	printf("\t[-b message batch size, enables thread message mode (max %d)]\n",
+	       SPDK_THREAD_MSG_BATCH_MAX);
 }
 
 int
@@ -110,7 +202,7 @@ main(int argc, char **argv)
 	g_time_in_sec = 0;
 	g_queue_depth = 1;
 
-	while ((op = getopt(argc, argv, "q:t:")) != -1) {
+	while ((op = getopt(argc, argv, "b:q:t:")) != -1) {
 		if (op == '?') {
 			usage(argv[0]);
 			exit(1);
@@ -121,6 +213,9 @@ main(int argc, char **argv)
 			exit(1);
 		}
 		switch (op) {
+		case 'b':
+			g_msg_batch_size = val;
+			break;
 		case 'q':
 			g_queue_depth = val;
 			break;
@@ -138,13 +233,34 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (g_msg_batch_size > SPDK_THREAD_MSG_BATCH_MAX) {
+		usage(argv[0]);
+		exit(1);
+	}
+
 	opts.shutdown_cb = test_cleanup;
 
 	rc = spdk_app_start(&opts, test_start, NULL);
 
 	spdk_app_fini();
 
-	printf("Performance: %8ju events per second\n", g_call_count / g_time_in_sec);
+	if (g_msg_batch_size > 0) {
+		uint32_t core;
+
+		for (core = 0; core < g_msg_ctx_count; core++) {
+			struct msg_core_ctx *ctx = &g_msg_ctx[core];
+
+			if (ctx->peer == NULL) {
+				continue;
+			}
+
+			printf("core %2u -> core %2u: %8ju messages per second\n", core,
+			       (uint32_t)(ctx->peer - g_msg_ctx), ctx->peer->count / g_time_in_sec);
+		}
+		free(g_msg_ctx);
+	} else {
+		printf("Performance: %8ju events per second\n", g_call_count / g_time_in_sec);
+	}
 
 	return rc;
 }
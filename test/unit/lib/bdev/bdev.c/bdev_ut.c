@@ -47,6 +47,23 @@ DEFINE_STUB(spdk_conf_find_section, struct spdk_conf_section *, (struct spdk_con
 DEFINE_STUB(spdk_conf_section_get_nmval, char *,
 	    (struct spdk_conf_section *sp, const char *key, int idx1, int idx2), NULL);
 DEFINE_STUB(spdk_conf_section_get_intval, int, (struct spdk_conf_section *sp, const char *key), -1);
+DEFINE_STUB(spdk_env_get_current_core, uint32_t, (void), 0);
+DEFINE_STUB(spdk_env_get_first_core, uint32_t, (void), 0);
+
+static uint32_t g_ut_num_cores = 1;
+
+uint32_t
+spdk_env_get_next_core(uint32_t prev_core)
+{
+	return prev_core + 1 < g_ut_num_cores ? prev_core + 1 : UINT32_MAX;
+}
+
+/* Cores alternate between two NUMA nodes */
+uint32_t
+spdk_env_get_socket_id(uint32_t core)
+{
+	return core % 2;
+}
 
 struct spdk_trace_histories *g_trace_histories;
 DEFINE_STUB_V(spdk_trace_add_register_fn, (struct spdk_trace_register_fn *reg_fn));
@@ -765,14 +782,14 @@ bdev_io_wait_test(void)
 	struct spdk_bdev *bdev;
 	struct spdk_bdev_desc *desc = NULL;
 	struct spdk_io_channel *io_ch;
-	struct spdk_bdev_opts bdev_opts = {
-		.bdev_io_pool_size = 4,
-		.bdev_io_cache_size = 2,
-	};
+	struct spdk_bdev_opts bdev_opts;
 	struct bdev_ut_io_wait_entry io_wait_entry;
 	struct bdev_ut_io_wait_entry io_wait_entry2;
 	int rc;
 
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 4;
+	bdev_opts.bdev_io_cache_size = 2;
 	rc = spdk_bdev_set_opts(&bdev_opts);
 	CU_ASSERT(rc == 0);
 	spdk_bdev_initialize(bdev_init_cb, NULL);
@@ -837,6 +854,141 @@ bdev_io_wait_test(void)
 	poll_threads();
 }
 
+static void
+bdev_io_wait_remote_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_opts bdev_opts;
+	struct spdk_slab_cache *remote_cache;
+	struct bdev_ut_io_wait_entry io_wait_entry;
+	void *eles[4];
+	int rc, i;
+
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 4;
+	bdev_opts.bdev_io_cache_size = 2;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	poll_threads();
+
+	/*
+	 * Allocate all bdev_ios on socket 1, so that this thread (on socket 0) only
+	 *  gets bdev_ios which go back to socket 1 when they are freed.
+	 */
+	remote_cache = spdk_slab_cache_create(g_bdev_mgr.bdev_io_slab, 0, 1);
+	SPDK_CU_ASSERT_FATAL(remote_cache != NULL);
+	for (i = 0; i < 4; i++) {
+		eles[i] = spdk_slab_get(g_bdev_mgr.bdev_io_slab, remote_cache);
+		SPDK_CU_ASSERT_FATAL(eles[i] != NULL);
+	}
+	for (i = 0; i < 4; i++) {
+		spdk_slab_put(g_bdev_mgr.bdev_io_slab, remote_cache, eles[i]);
+	}
+	spdk_slab_cache_free(remote_cache);
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open(bdev, true, NULL, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	for (i = 0; i < 4; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 4);
+
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	io_wait_entry.entry.bdev = bdev;
+	io_wait_entry.entry.cb_fn = io_wait_cb;
+	io_wait_entry.entry.cb_arg = &io_wait_entry;
+	io_wait_entry.io_ch = io_ch;
+	io_wait_entry.desc = desc;
+	io_wait_entry.submitted = false;
+	rc = spdk_bdev_queue_io_wait(bdev, io_ch, &io_wait_entry.entry);
+	CU_ASSERT(rc == 0);
+
+	/* The completed bdev_io is not cached on this thread, but the waiter still gets it. */
+	stub_complete_io(1);
+	CU_ASSERT(io_wait_entry.submitted == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 4);
+
+	stub_complete_io(4);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+}
+
+static void
+bdev_io_cache_reserve_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_opts bdev_opts;
+	void *eles[4];
+	int rc, i, count;
+
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 4;
+	bdev_opts.bdev_io_cache_size = 2;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+	poll_threads();
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open(bdev, true, NULL, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	/* Other threads take every bdev_io which isn't cached by this thread. */
+	for (count = 0; count < 4; count++) {
+		eles[count] = spdk_slab_get(g_bdev_mgr.bdev_io_slab, NULL);
+		if (eles[count] == NULL) {
+			break;
+		}
+	}
+	CU_ASSERT(count == 2);
+
+	/* This thread has no I/O in flight, but can still submit from its cache. */
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	stub_complete_io(2);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+
+	for (i = 0; i < count; i++) {
+		spdk_slab_put(g_bdev_mgr.bdev_io_slab, NULL, eles[i]);
+	}
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+}
+
 static void
 bdev_io_spans_boundary_test(void)
 {
@@ -876,15 +1028,15 @@ bdev_io_split(void)
 	struct spdk_bdev *bdev;
 	struct spdk_bdev_desc *desc = NULL;
 	struct spdk_io_channel *io_ch;
-	struct spdk_bdev_opts bdev_opts = {
-		.bdev_io_pool_size = 512,
-		.bdev_io_cache_size = 64,
-	};
+	struct spdk_bdev_opts bdev_opts;
 	struct iovec iov[BDEV_IO_NUM_CHILD_IOV * 2];
 	struct ut_expected_io *expected_io;
 	uint64_t i;
 	int rc;
 
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 512;
+	bdev_opts.bdev_io_cache_size = 64;
 	rc = spdk_bdev_set_opts(&bdev_opts);
 	CU_ASSERT(rc == 0);
 	spdk_bdev_initialize(bdev_init_cb, NULL);
@@ -1095,14 +1247,14 @@ bdev_io_split_with_io_wait(void)
 	struct spdk_io_channel *io_ch;
 	struct spdk_bdev_channel *channel;
 	struct spdk_bdev_mgmt_channel *mgmt_ch;
-	struct spdk_bdev_opts bdev_opts = {
-		.bdev_io_pool_size = 2,
-		.bdev_io_cache_size = 1,
-	};
+	struct spdk_bdev_opts bdev_opts;
 	struct iovec iov[3];
 	struct ut_expected_io *expected_io;
 	int rc;
 
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 2;
+	bdev_opts.bdev_io_cache_size = 1;
 	rc = spdk_bdev_set_opts(&bdev_opts);
 	CU_ASSERT(rc == 0);
 	spdk_bdev_initialize(bdev_init_cb, NULL);
@@ -1228,16 +1380,16 @@ bdev_io_alignment(void)
 	struct spdk_bdev *bdev;
 	struct spdk_bdev_desc *desc;
 	struct spdk_io_channel *io_ch;
-	struct spdk_bdev_opts bdev_opts = {
-		.bdev_io_pool_size = 20,
-		.bdev_io_cache_size = 2,
-	};
+	struct spdk_bdev_opts bdev_opts;
 	int rc;
 	void *buf;
 	struct iovec iovs[2];
 	int iovcnt;
 	uint64_t alignment;
 
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 20;
+	bdev_opts.bdev_io_cache_size = 2;
 	rc = spdk_bdev_set_opts(&bdev_opts);
 	CU_ASSERT(rc == 0);
 	spdk_bdev_initialize(bdev_init_cb, NULL);
@@ -1440,6 +1592,208 @@ bdev_io_alignment(void)
 	free(buf);
 }
 
+static void
+bdev_io_numa_buf(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_io_stat stat;
+	struct spdk_mempool *local_pool;
+	struct spdk_bdev_opts bdev_opts;
+	struct iovec iov;
+	int rc;
+
+	/* Two cores on two nodes, with the test thread running on the second one */
+	g_ut_num_cores = 2;
+	MOCK_SET(spdk_env_get_current_core, 1);
+
+	spdk_bdev_get_opts(&bdev_opts);
+	bdev_opts.bdev_io_pool_size = 20;
+	bdev_opts.bdev_io_cache_size = 2;
+	/* Freed buffers go straight back to their pools */
+	bdev_opts.buf_cache_size = 0;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+
+	SPDK_CU_ASSERT_FATAL(g_bdev_mgr.buf_pool[0][0] != NULL);
+	SPDK_CU_ASSERT_FATAL(g_bdev_mgr.buf_pool[0][1] != NULL);
+	CU_ASSERT(g_bdev_mgr.buf_pool[0][2] == NULL);
+	CU_ASSERT(g_bdev_mgr.buf_pool_size[0] == bdev_opts.buf_class_count[0] / 2);
+	CU_ASSERT(g_bdev_mgr.buf_pool_size[6] == bdev_opts.buf_class_count[6] / 2);
+
+	fn_table.submit_request = stub_submit_request_aligned_buffer;
+	bdev = allocate_bdev("bdev0");
+	CU_ASSERT(spdk_bdev_get_numa_id(bdev) == SPDK_ENV_SOCKET_ID_ANY);
+
+	bdev->numa.enabled = true;
+	bdev->numa.id = 0;
+	CU_ASSERT(spdk_bdev_get_numa_id(bdev) == 0);
+
+	rc = spdk_bdev_open(bdev, true, NULL, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	/* The buffer comes from the thread's node, which is remote to the bdev */
+	iov.iov_base = NULL;
+	iov.iov_len = 0;
+	rc = spdk_bdev_readv(desc, io_ch, &iov, 1, 0, 512, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.buf != NULL);
+	CU_ASSERT(g_bdev_io->internal.buf_numa_id == 1);
+	stub_complete_io(1);
+
+	spdk_bdev_get_io_stat(bdev, io_ch, &stat);
+	CU_ASSERT(stat.num_remote_thread_bufs == 0);
+	CU_ASSERT(stat.num_remote_bdev_bufs == 1);
+
+	/* With the local node exhausted, fall back to the other node */
+	local_pool = g_bdev_mgr.buf_pool[0][1];
+	g_bdev_mgr.buf_pool[0][1] = spdk_mempool_create("ut_empty_pool", 0, 1, 0,
+				    SPDK_ENV_SOCKET_ID_ANY);
+	SPDK_CU_ASSERT_FATAL(g_bdev_mgr.buf_pool[0][1] != NULL);
+
+	iov.iov_base = NULL;
+	iov.iov_len = 0;
+	rc = spdk_bdev_readv(desc, io_ch, &iov, 1, 0, 512, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.buf != NULL);
+	CU_ASSERT(g_bdev_io->internal.buf_numa_id == 0);
+	stub_complete_io(1);
+
+	spdk_bdev_get_io_stat(bdev, io_ch, &stat);
+	CU_ASSERT(stat.num_remote_thread_bufs == 1);
+	CU_ASSERT(stat.num_remote_bdev_bufs == 1);
+
+	spdk_mempool_free(g_bdev_mgr.buf_pool[0][1]);
+	g_bdev_mgr.buf_pool[0][1] = local_pool;
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+
+	MOCK_CLEAR(spdk_env_get_current_core);
+	g_ut_num_cores = 1;
+}
+
+static void
+bdev_io_buf_classes(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct spdk_bdev_mgmt_channel *mgmt_ch;
+	struct spdk_bdev_io_stat stat;
+	struct spdk_mempool *pool;
+	struct spdk_bdev_opts bdev_opts, orig_opts;
+	struct iovec iov[2];
+	int rc;
+
+	spdk_bdev_get_opts(&orig_opts);
+	bdev_opts = orig_opts;
+	bdev_opts.bdev_io_pool_size = 20;
+	bdev_opts.bdev_io_cache_size = 2;
+
+	/* At least one class has to be enabled */
+	memset(bdev_opts.buf_class_count, 0, sizeof(bdev_opts.buf_class_count));
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc != 0);
+
+	/* No 4k class, a single 8k buffer and the default number of 128k buffers */
+	bdev_opts.buf_class_count[1] = 1;
+	bdev_opts.buf_class_count[5] = orig_opts.buf_class_count[5];
+	bdev_opts.buf_cache_size = 4;
+	rc = spdk_bdev_set_opts(&bdev_opts);
+	CU_ASSERT(rc == 0);
+	spdk_bdev_initialize(bdev_init_cb, NULL);
+
+	CU_ASSERT(spdk_bdev_get_buf_class_size(0) == 4096);
+	CU_ASSERT(spdk_bdev_get_buf_class_size(SPDK_BDEV_BUF_NUM_CLASSES - 1) == SPDK_BDEV_BUF_MAX_SIZE);
+	CU_ASSERT(spdk_bdev_get_buf_class_size(SPDK_BDEV_BUF_NUM_CLASSES) == 0);
+	CU_ASSERT(_bdev_buf_max_size() == 128 * 1024);
+	/* A thread may not cache more than half of the buffers of a class */
+	CU_ASSERT(g_bdev_mgr.buf_cache_size[1] == 0);
+	CU_ASSERT(g_bdev_mgr.buf_cache_size[5] == 4);
+
+	fn_table.submit_request = stub_submit_request_aligned_buffer;
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open(bdev, true, NULL, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+	mgmt_ch = bdev_ch->shared_resource->mgmt_ch;
+
+	/* A 4k read is served by the 8k class, as the 4k one is disabled */
+	iov[0].iov_base = NULL;
+	iov[0].iov_len = 0;
+	rc = spdk_bdev_readv_blocks(desc, io_ch, &iov[0], 1, 0, 8, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.buf_class == 1);
+
+	/* With the 8k class and all larger ones empty, the next 4k read has to wait */
+	pool = g_bdev_mgr.buf_pool[5][0];
+	g_bdev_mgr.buf_pool[5][0] = spdk_mempool_create("ut_empty_pool", 0, 1, 0,
+				    SPDK_ENV_SOCKET_ID_ANY);
+	SPDK_CU_ASSERT_FATAL(g_bdev_mgr.buf_pool[5][0] != NULL);
+
+	iov[1].iov_base = NULL;
+	iov[1].iov_len = 0;
+	rc = spdk_bdev_readv_blocks(desc, io_ch, &iov[1], 1, 8, 8, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(!STAILQ_EMPTY(&mgmt_ch->need_buf[1]));
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+
+	/* Completing the first read hands its buffer over to the waiting one */
+	stub_complete_io(1);
+	CU_ASSERT(STAILQ_EMPTY(&mgmt_ch->need_buf[1]));
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	CU_ASSERT(g_bdev_io->internal.buf_class == 1);
+	stub_complete_io(1);
+
+	spdk_bdev_get_io_stat(bdev, io_ch, &stat);
+	CU_ASSERT(stat.num_buf_waits == 1);
+
+	spdk_mempool_free(g_bdev_mgr.buf_pool[5][0]);
+	g_bdev_mgr.buf_pool[5][0] = pool;
+
+	/* A 72k read fits in the 128k class and its buffer is kept in the thread's cache */
+	iov[0].iov_base = NULL;
+	iov[0].iov_len = 0;
+	rc = spdk_bdev_readv_blocks(desc, io_ch, &iov[0], 1, 0, 144, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.buf_class == 5);
+	CU_ASSERT(mgmt_ch->buf_cache_count[5] == 0);
+	stub_complete_io(1);
+	CU_ASSERT(mgmt_ch->buf_cache_count[5] == 1);
+
+	/* The next one is served from the cache */
+	iov[0].iov_base = NULL;
+	iov[0].iov_len = 0;
+	rc = spdk_bdev_readv_blocks(desc, io_ch, &iov[0], 1, 0, 144, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.buf_class == 5);
+	CU_ASSERT(mgmt_ch->buf_cache_count[5] == 0);
+	stub_complete_io(1);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	spdk_bdev_finish(bdev_fini_cb, NULL);
+	poll_threads();
+
+	rc = spdk_bdev_set_opts(&orig_opts);
+	CU_ASSERT(rc == 0);
+}
+
 static void
 histogram_status_cb(void *cb_arg, int status)
 {
@@ -1572,10 +1926,14 @@ main(int argc, char **argv)
 		CU_add_test(suite, "alias_add_del", alias_add_del_test) == NULL ||
 		CU_add_test(suite, "get_device_stat", get_device_stat_test) == NULL ||
 		CU_add_test(suite, "bdev_io_wait", bdev_io_wait_test) == NULL ||
+		CU_add_test(suite, "bdev_io_wait_remote", bdev_io_wait_remote_test) == NULL ||
+		CU_add_test(suite, "bdev_io_cache_reserve", bdev_io_cache_reserve_test) == NULL ||
 		CU_add_test(suite, "bdev_io_spans_boundary", bdev_io_spans_boundary_test) == NULL ||
 		CU_add_test(suite, "bdev_io_split", bdev_io_split) == NULL ||
 		CU_add_test(suite, "bdev_io_split_with_io_wait", bdev_io_split_with_io_wait) == NULL ||
 		CU_add_test(suite, "bdev_io_alignment", bdev_io_alignment) == NULL ||
+		CU_add_test(suite, "bdev_io_numa_buf", bdev_io_numa_buf) == NULL ||
+		CU_add_test(suite, "bdev_io_buf_classes", bdev_io_buf_classes) == NULL ||
 		CU_add_test(suite, "bdev_histograms", bdev_histograms) == NULL
 	) {
 		CU_cleanup_registry();
@@ -375,6 +375,75 @@ fs_rename(void)
 	CU_ASSERT(g_fserrno == 0);
 }
 
+static void
+fs_many_files(void)
+{
+	struct spdk_filesystem *fs;
+	struct spdk_bs_dev *dev;
+	struct spdk_blobfs_opts opts;
+	char name[32], new_name[32];
+	uint32_t i, num_files = FILE_HASH_MIN_BUCKETS * 4;
+
+	dev = init_dev();
+
+	/* Small clusters so that all files fit on the test device */
+	spdk_fs_opts_init(&opts);
+	opts.cluster_sz = 16 * 1024;
+	spdk_fs_init(dev, &opts, NULL, fs_op_with_handle_complete, NULL);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_fs != NULL);
+	CU_ASSERT(g_fserrno == 0);
+	fs = g_fs;
+
+	/* Enough files to grow the name hash a few times */
+	for (i = 0; i < num_files; i++) {
+		snprintf(name, sizeof(name), "file%u", i);
+		g_fserrno = 1;
+		spdk_fs_create_file_async(fs, name, create_cb, NULL);
+		poll_threads();
+		CU_ASSERT(g_fserrno == 0);
+	}
+
+	CU_ASSERT(fs->file_hash.count == num_files);
+	CU_ASSERT(fs->file_hash.num_buckets > FILE_HASH_MIN_BUCKETS);
+
+	for (i = 0; i < num_files; i++) {
+		snprintf(name, sizeof(name), "file%u", i);
+		SPDK_CU_ASSERT_FATAL(fs_find_file(fs, name) != NULL);
+		CU_ASSERT(!strcmp(fs_find_file(fs, name)->name, name));
+	}
+	CU_ASSERT(fs_find_file(fs, "file") == NULL);
+
+	/* Rename every other file and make sure only the new name can be found */
+	for (i = 0; i < num_files; i += 2) {
+		snprintf(name, sizeof(name), "file%u", i);
+		snprintf(new_name, sizeof(new_name), "renamed%u", i);
+		g_fserrno = 1;
+		spdk_fs_rename_file_async(fs, name, new_name, fs_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_fserrno == 0);
+		CU_ASSERT(fs_find_file(fs, name) == NULL);
+		CU_ASSERT(fs_find_file(fs, new_name) != NULL);
+	}
+
+	for (i = 0; i < num_files; i++) {
+		snprintf(name, sizeof(name), i % 2 ? "file%u" : "renamed%u", i);
+		g_fserrno = 1;
+		spdk_fs_delete_file_async(fs, name, delete_cb, NULL);
+		poll_threads();
+		CU_ASSERT(g_fserrno == 0);
+		CU_ASSERT(fs_find_file(fs, name) == NULL);
+	}
+
+	CU_ASSERT(fs->file_hash.count == 0);
+	CU_ASSERT(TAILQ_EMPTY(&fs->files));
+
+	g_fserrno = 1;
+	spdk_fs_unload(fs, fs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+}
+
 static void
 tree_find_buffer_ut(void)
 {
@@ -529,6 +598,7 @@ int main(int argc, char **argv)
 		CU_add_test(suite, "fs_create", fs_create) == NULL ||
 		CU_add_test(suite, "fs_truncate", fs_truncate) == NULL ||
 		CU_add_test(suite, "fs_rename", fs_rename) == NULL ||
+		CU_add_test(suite, "fs_many_files", fs_many_files) == NULL ||
 		CU_add_test(suite, "tree_find_buffer", tree_find_buffer_ut) == NULL ||
 		CU_add_test(suite, "channel_ops", channel_ops) == NULL ||
 		CU_add_test(suite, "channel_ops_sync", channel_ops_sync) == NULL
@@ -68,27 +68,20 @@ struct ut_request {
 	fs_request_fn fn;
 	void *arg;
 	volatile int done;
-	int from_ut;
 };
 
 static struct ut_request *g_req = NULL;
 static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct spdk_thread *g_dispatch_thread;
+static bool g_dispatch_exit = false;
+static uint32_t g_send_request_count;
 
 static void
 send_request(fs_request_fn fn, void *arg)
 {
-	struct ut_request *req;
-
-	req = calloc(1, sizeof(*req));
-	assert(req != NULL);
-	req->fn = fn;
-	req->arg = arg;
-	req->done = 0;
-	req->from_ut = 0;
-
-	pthread_mutex_lock(&g_mutex);
-	g_req = req;
-	pthread_mutex_unlock(&g_mutex);
+	__sync_fetch_and_add(&g_send_request_count, 1);
+	/* Queue on the dispatch thread, so concurrent requests are not lost. */
+	spdk_thread_send_msg(g_dispatch_thread, fn, arg);
 }
 
 static void
@@ -100,7 +93,6 @@ ut_send_request(fs_request_fn fn, void *arg)
 	req.fn = fn;
 	req.arg = arg;
 	req.done = 0;
-	req.from_ut = 1;
 
 	pthread_mutex_lock(&g_mutex);
 	g_req = &req;
@@ -349,11 +341,347 @@ fs_delete_file_without_close(void)
 
 }
 
+static void
+cache_read_polled(void)
+{
+	int rc;
+	uint8_t w_buf[4096], r_buf[4096];
+	struct spdk_io_channel *channel;
+	struct spdk_thread *thread;
+	uint32_t send_request_count;
+
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_io_channel_sync_polled(g_fs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	CU_ASSERT(((struct spdk_fs_channel *)spdk_io_channel_get_ctx(channel))->thread ==
+		  spdk_get_thread());
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	memset(w_buf, 0x5a, sizeof(w_buf));
+	rc = spdk_file_write(g_file, channel, w_buf, 0, sizeof(w_buf));
+	CU_ASSERT(rc == 0);
+	rc = spdk_file_sync(g_file, channel);
+	CU_ASSERT(rc == 0);
+
+	/* Drop the cache so the read is served from the blob on this thread's own channel */
+	cache_free_buffers(g_file);
+
+	send_request_count = g_send_request_count;
+	memset(r_buf, 0, sizeof(r_buf));
+	CU_ASSERT(spdk_file_read(g_file, channel, r_buf, 0, sizeof(r_buf)) == sizeof(r_buf));
+	CU_ASSERT(memcmp(w_buf, r_buf, sizeof(r_buf)) == 0);
+	CU_ASSERT(g_send_request_count == send_request_count);
+
+	/* Append data which is not synced yet, so reads must be forwarded */
+	memset(w_buf, 0xa5, sizeof(w_buf));
+	rc = spdk_file_write(g_file, channel, w_buf, sizeof(w_buf), sizeof(w_buf));
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_file->append_pos > g_file->length_flushed);
+	cache_free_buffers(g_file);
+
+	send_request_count = g_send_request_count;
+	memset(r_buf, 0, sizeof(r_buf));
+	CU_ASSERT(spdk_file_read(g_file, channel, r_buf, sizeof(r_buf), sizeof(r_buf)) == sizeof(r_buf));
+	CU_ASSERT(memcmp(w_buf, r_buf, sizeof(r_buf)) == 0);
+	CU_ASSERT(g_send_request_count != send_request_count);
+
+	/* Once synced, the same read goes through this thread's channel again */
+	rc = spdk_file_sync(g_file, channel);
+	CU_ASSERT(rc == 0);
+	cache_free_buffers(g_file);
+
+	send_request_count = g_send_request_count;
+	memset(r_buf, 0, sizeof(r_buf));
+	CU_ASSERT(spdk_file_read(g_file, channel, r_buf, sizeof(r_buf), sizeof(r_buf)) == sizeof(r_buf));
+	CU_ASSERT(memcmp(w_buf, r_buf, sizeof(r_buf)) == 0);
+	CU_ASSERT(g_send_request_count == send_request_count);
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_io_channel(channel);
+
+	thread = spdk_get_thread();
+	while (spdk_thread_poll(thread, 0, 0) > 0) {}
+
+	ut_send_request(_fs_unload, NULL);
+}
+
+static bool
+file_buffers_filled(struct spdk_file *file, uint64_t length)
+{
+	uint64_t offset;
+	bool filled = true;
+
+	pthread_spin_lock(&file->lock);
+	for (offset = 0; offset < length; offset += CACHE_BUFFER_SIZE) {
+		if (spdk_tree_find_filled_buffer(file->tree, offset) == NULL) {
+			filled = false;
+			break;
+		}
+	}
+	pthread_spin_unlock(&file->lock);
+
+	return filled;
+}
+
+static void
+cache_read_multi(void)
+{
+	int rc;
+	uint8_t *w_buf, *r_buf;
+	uint64_t length = 4 * CACHE_BUFFER_SIZE, offset;
+	struct spdk_file_read_req reqs[3];
+	struct spdk_io_channel *channel;
+	struct spdk_thread *thread;
+
+	w_buf = malloc(length);
+	r_buf = calloc(1, length);
+	SPDK_CU_ASSERT_FATAL(w_buf != NULL && r_buf != NULL);
+	for (offset = 0; offset < length; offset++) {
+		w_buf[offset] = offset % 251;
+	}
+
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_io_channel_sync(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	rc = spdk_file_write(g_file, channel, w_buf, 0, length);
+	CU_ASSERT(rc == 0);
+	rc = spdk_file_sync(g_file, channel);
+	CU_ASSERT(rc == 0);
+	cache_free_buffers(g_file);
+
+	/* Ranges within one buffer, across a buffer boundary and past the end of the file */
+	reqs[0].payload = r_buf + 100;
+	reqs[0].offset = 100;
+	reqs[0].length = 4096;
+	reqs[1].payload = r_buf + CACHE_BUFFER_SIZE - 512;
+	reqs[1].offset = CACHE_BUFFER_SIZE - 512;
+	reqs[1].length = 1024;
+	reqs[2].payload = r_buf + length - 2048;
+	reqs[2].offset = length - 2048;
+	reqs[2].length = 4096;
+	rc = spdk_file_read_multi(g_file, channel, reqs, 3);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(reqs[0].rc == 4096);
+	CU_ASSERT(reqs[1].rc == 1024);
+	CU_ASSERT(reqs[2].rc == 2048);
+	CU_ASSERT(memcmp(r_buf + 100, w_buf + 100, 4096) == 0);
+	CU_ASSERT(memcmp(r_buf + CACHE_BUFFER_SIZE - 512, w_buf + CACHE_BUFFER_SIZE - 512, 1024) == 0);
+	CU_ASSERT(memcmp(r_buf + length - 2048, w_buf + length - 2048, 2048) == 0);
+	/* Point reads do not start a readahead stream */
+	CU_ASSERT(g_file->readahead_buffers == CACHE_READAHEAD_MIN_BUFFERS);
+
+	/* Prefetch the whole file, then read it back from the cache */
+	rc = spdk_file_prefetch(g_file, 0, length);
+	CU_ASSERT(rc == 0);
+	while (!file_buffers_filled(g_file, length)) {
+		usleep(1000);
+	}
+	memset(r_buf, 0, length);
+	CU_ASSERT(spdk_file_read(g_file, channel, r_buf, 0, length) == (int64_t)length);
+	CU_ASSERT(memcmp(r_buf, w_buf, length) == 0);
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_io_channel(channel);
+
+	thread = spdk_get_thread();
+	while (spdk_thread_poll(thread, 0, 0) > 0) {}
+
+	ut_send_request(_fs_unload, NULL);
+
+	free(w_buf);
+	free(r_buf);
+}
+
+static void
+cache_readahead_window(void)
+{
+	struct spdk_file file = {};
+	uint64_t offset;
+
+	/* No buffers are cached and file length is 0, so readahead only moves the window */
+	file.tree = calloc(1, sizeof(*file.tree));
+	SPDK_CU_ASSERT_FATAL(file.tree != NULL);
+	file.readahead_buffers = CACHE_READAHEAD_MIN_BUFFERS;
+
+	for (offset = 0; offset < CACHE_READAHEAD_THRESHOLD; offset += 4096) {
+		check_readahead(&file, offset, 4096);
+	}
+	CU_ASSERT(file.readahead_buffers == CACHE_READAHEAD_MIN_BUFFERS);
+
+	/* The window doubles each time the stream consumes it, up to the maximum */
+	for (; offset < 64 * CACHE_BUFFER_SIZE; offset += 4096) {
+		check_readahead(&file, offset, 4096);
+	}
+	CU_ASSERT(file.readahead_buffers == CACHE_READAHEAD_MAX_BUFFERS);
+
+	/* A random read restarts the stream with the smallest window */
+	check_readahead(&file, 0, 4096);
+	CU_ASSERT(file.readahead_buffers == CACHE_READAHEAD_MIN_BUFFERS);
+	CU_ASSERT(file.seq_byte_count == 4096);
+
+	free(file.tree);
+}
+
+static void
+cache_lru_eviction(void)
+{
+	int rc;
+	uint8_t *buf;
+	uint64_t length = 2 * CACHE_BUFFER_SIZE;
+	struct spdk_file *hot, *cold, *new;
+	struct spdk_file_cache_stat file_stat;
+	struct spdk_fs_cache_stat cache_stat;
+	struct spdk_io_channel *channel;
+	struct spdk_thread *thread;
+
+	buf = calloc(1, length);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	/* Room for 8 buffers. Each file below uses 2 full buffers and an empty last one. */
+	spdk_fs_set_cache_size(8 * CACHE_BUFFER_SIZE / (1024 * 1024));
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_io_channel_sync(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "hot", SPDK_BLOBFS_OPEN_CREATE, &hot);
+	CU_ASSERT(rc == 0);
+	spdk_file_set_priority(hot, SPDK_FILE_PRIORITY_HIGH);
+	CU_ASSERT(spdk_file_write(hot, channel, buf, 0, length) == 0);
+	CU_ASSERT(spdk_file_sync(hot, channel) == 0);
+
+	rc = spdk_fs_open_file(g_fs, channel, "cold", SPDK_BLOBFS_OPEN_CREATE, &cold);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(spdk_file_write(cold, channel, buf, 0, length) == 0);
+	CU_ASSERT(spdk_file_sync(cold, channel) == 0);
+
+	spdk_fs_get_cache_stat(&cache_stat);
+	CU_ASSERT(cache_stat.total_buffers == 8);
+	CU_ASSERT(cache_stat.free_buffers == 2);
+	CU_ASSERT(cache_stat.class_buffers[SPDK_FILE_PRIORITY_HIGH] == 3);
+	CU_ASSERT(cache_stat.class_buffers[SPDK_FILE_PRIORITY_LOW] == 3);
+	CU_ASSERT(cache_stat.evictions == 0);
+
+	/* Reading the hot file hits the cache and keeps its buffers */
+	CU_ASSERT(spdk_file_read(hot, channel, buf, 0, length) == (int64_t)length);
+	spdk_file_get_cache_stat(hot, &file_stat);
+	CU_ASSERT(file_stat.cached_buffers == 3);
+	CU_ASSERT(file_stat.hits == 2);
+	CU_ASSERT(file_stat.misses == 0);
+
+	/* A third file needs one more buffer than is free, taken from the cold file */
+	rc = spdk_fs_open_file(g_fs, channel, "new", SPDK_BLOBFS_OPEN_CREATE, &new);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(spdk_file_write(new, channel, buf, 0, length) == 0);
+	CU_ASSERT(spdk_file_sync(new, channel) == 0);
+
+	spdk_file_get_cache_stat(hot, &file_stat);
+	CU_ASSERT(file_stat.cached_buffers == 3);
+	spdk_file_get_cache_stat(cold, &file_stat);
+	CU_ASSERT(file_stat.cached_buffers == 2);
+	spdk_fs_get_cache_stat(&cache_stat);
+	CU_ASSERT(cache_stat.free_buffers == 0);
+	CU_ASSERT(cache_stat.evictions == 1);
+
+	/* Reading the cold file drops each buffer once it has been read completely */
+	CU_ASSERT(spdk_file_read(cold, channel, buf, 0, length) == (int64_t)length);
+	spdk_file_get_cache_stat(cold, &file_stat);
+	CU_ASSERT(file_stat.hits + file_stat.misses == 2);
+	CU_ASSERT(file_stat.cached_buffers < 2);
+
+	spdk_file_close(hot, channel);
+	spdk_file_close(cold, channel);
+	spdk_file_close(new, channel);
+	CU_ASSERT(spdk_fs_delete_file(g_fs, channel, "hot") == 0);
+	CU_ASSERT(spdk_fs_delete_file(g_fs, channel, "cold") == 0);
+	CU_ASSERT(spdk_fs_delete_file(g_fs, channel, "new") == 0);
+
+	spdk_fs_free_io_channel(channel);
+
+	thread = spdk_get_thread();
+	while (spdk_thread_poll(thread, 0, 0) > 0) {}
+
+	ut_send_request(_fs_unload, NULL);
+	spdk_fs_set_cache_size(BLOBFS_DEFAULT_CACHE_SIZE / (1024 * 1024));
+
+	free(buf);
+}
+
+static void
+cache_prefetch_limit(void)
+{
+	int rc;
+	uint8_t *buf;
+	uint64_t length = 4 * CACHE_BUFFER_SIZE;
+	struct spdk_io_channel *channel;
+	struct spdk_thread *thread;
+
+	buf = calloc(1, length);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	/* Room for 8 buffers, so a prefetch fills at most 2 of them. */
+	spdk_fs_set_cache_size(8 * CACHE_BUFFER_SIZE / (1024 * 1024));
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_io_channel_sync(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	rc = spdk_file_write(g_file, channel, buf, 0, length);
+	CU_ASSERT(rc == 0);
+	rc = spdk_file_sync(g_file, channel);
+	CU_ASSERT(rc == 0);
+	cache_free_buffers(g_file);
+
+	rc = spdk_file_prefetch(g_file, 0, UINT64_MAX);
+	CU_ASSERT(rc == 0);
+	while (!file_buffers_filled(g_file, 2 * CACHE_BUFFER_SIZE)) {
+		usleep(1000);
+	}
+	pthread_spin_lock(&g_file->lock);
+	CU_ASSERT(spdk_tree_find_buffer(g_file->tree, 2 * CACHE_BUFFER_SIZE) == NULL);
+	CU_ASSERT(spdk_tree_find_buffer(g_file->tree, 3 * CACHE_BUFFER_SIZE) == NULL);
+	pthread_spin_unlock(&g_file->lock);
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_io_channel(channel);
+
+	thread = spdk_get_thread();
+	while (spdk_thread_poll(thread, 0, 0) > 0) {}
+
+	ut_send_request(_fs_unload, NULL);
+	spdk_fs_set_cache_size(BLOBFS_DEFAULT_CACHE_SIZE / (1024 * 1024));
+
+	free(buf);
+}
+
 static void
 terminate_spdk_thread(void *arg)
 {
-	spdk_thread_exit(spdk_get_thread());
-	pthread_exit(NULL);
+	/*
+	 * Only end the dispatch loop here - exiting the pthread from within the
+	 * message would keep the message from being returned to its pool.
+	 */
+	g_dispatch_exit = true;
 }
 
 static void *
@@ -364,16 +692,14 @@ spdk_thread(void *arg)
 
 	thread = spdk_thread_create("thread1");
 	spdk_set_thread(thread);
+	g_dispatch_thread = thread;
 
-	while (1) {
+	while (!g_dispatch_exit) {
 		pthread_mutex_lock(&g_mutex);
 		if (g_req != NULL) {
 			req = g_req;
 			req->fn(req->arg);
 			req->done = 1;
-			if (!req->from_ut) {
-				free(req);
-			}
 			g_req = NULL;
 		}
 		pthread_mutex_unlock(&g_mutex);
@@ -381,6 +707,7 @@ spdk_thread(void *arg)
 		spdk_thread_poll(thread, 0, 0);
 	}
 
+	spdk_thread_exit(thread);
 	return NULL;
 }
 
@@ -406,7 +733,12 @@ int main(int argc, char **argv)
 		CU_add_test(suite, "write_null_buffer", cache_write_null_buffer) == NULL ||
 		CU_add_test(suite, "create_sync", fs_create_sync) == NULL ||
 		CU_add_test(suite, "append_no_cache", cache_append_no_cache) == NULL ||
-		CU_add_test(suite, "delete_file_without_close", fs_delete_file_without_close) == NULL
+		CU_add_test(suite, "delete_file_without_close", fs_delete_file_without_close) == NULL ||
+		CU_add_test(suite, "read_polled", cache_read_polled) == NULL ||
+		CU_add_test(suite, "read_multi", cache_read_multi) == NULL ||
+		CU_add_test(suite, "readahead_window", cache_readahead_window) == NULL ||
+		CU_add_test(suite, "lru_eviction", cache_lru_eviction) == NULL ||
+		CU_add_test(suite, "prefetch_limit", cache_prefetch_limit) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -0,0 +1,431 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+#include "spdk_internal/thread.h"
+
+#include "ftl/ftl_emu.c"
+
+#define TEST_NUM_PUNITS		4
+#define TEST_NUM_BLOCKS		(TEST_NUM_PUNITS * FTL_EMU_NUM_CHUNKS * 128 + 17)
+
+static int g_bdev;
+static struct spdk_thread *g_thread;
+
+/* Last request submitted to the base bdev */
+static struct {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	enum ftl_emu_req_type		type;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	int				count;
+} g_bdev_io;
+
+/* Last completion reported by the emulator */
+static struct {
+	struct spdk_nvme_cpl		cpl;
+	int				count;
+} g_cmpl;
+
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc),
+	    (struct spdk_bdev *)&g_bdev);
+DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), FTL_BLOCK_SIZE);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), TEST_NUM_BLOCKS);
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "base");
+DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc),
+	    NULL);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+
+static int
+submit_bdev_io(enum ftl_emu_req_type type, uint64_t offset_blocks, uint64_t num_blocks,
+	       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	g_bdev_io.type = type;
+	g_bdev_io.offset_blocks = offset_blocks;
+	g_bdev_io.num_blocks = num_blocks;
+	g_bdev_io.cb = cb;
+	g_bdev_io.cb_arg = cb_arg;
+	g_bdev_io.count++;
+
+	return 0;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return submit_bdev_io(FTL_EMU_REQ_READ, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return submit_bdev_io(FTL_EMU_REQ_WRITE, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return submit_bdev_io(FTL_EMU_REQ_RESET, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+static void
+complete_bdev_io(bool success)
+{
+	CU_ASSERT_FATAL(g_bdev_io.cb != NULL);
+	g_bdev_io.cb(NULL, success, g_bdev_io.cb_arg);
+	g_bdev_io.cb = NULL;
+}
+
+static void
+cmpl_cb(void *ctx, const struct spdk_nvme_cpl *cpl)
+{
+	g_cmpl.cpl = *cpl;
+	g_cmpl.count++;
+}
+
+static uint64_t
+test_addr(const struct ftl_emu *emu, uint64_t pu, uint64_t chk, uint64_t lbk)
+{
+	const struct spdk_ocssd_dev_lba_fmt *lbaf = &emu->geo.lbaf;
+
+	return (pu << (lbaf->lbk_len + lbaf->chk_len)) | (chk << lbaf->lbk_len) | lbk;
+}
+
+static struct ftl_emu *
+setup_emu(bool create)
+{
+	struct ftl_emu *emu;
+
+	memset(&g_bdev_io, 0, sizeof(g_bdev_io));
+	memset(&g_cmpl, 0, sizeof(g_cmpl));
+
+	emu = ftl_emu_init((struct spdk_bdev_desc *)&g_bdev, TEST_NUM_PUNITS, 0, create);
+	SPDK_CU_ASSERT_FATAL(emu != NULL);
+
+	return emu;
+}
+
+static void
+test_geometry(void)
+{
+	struct spdk_ocssd_geometry_data geo;
+	struct spdk_ocssd_chunk_information_entry info[2];
+	struct ftl_emu *emu;
+
+	emu = setup_emu(true);
+	ftl_emu_get_geometry(emu, &geo);
+
+	CU_ASSERT_EQUAL(geo.num_grp, 1);
+	CU_ASSERT_EQUAL(geo.num_pu, TEST_NUM_PUNITS);
+	CU_ASSERT_EQUAL(geo.clba, 128);
+	CU_ASSERT_EQUAL(geo.num_chk, FTL_EMU_NUM_CHUNKS);
+	CU_ASSERT_EQUAL(geo.ws_opt % geo.ws_min, 0);
+	CU_ASSERT_EQUAL(geo.clba % geo.ws_opt, 0);
+	CU_ASSERT_EQUAL(geo.lbaf.pu_len, 2);
+	CU_ASSERT_EQUAL(geo.lbaf.chk_len, 7);
+	CU_ASSERT_EQUAL(geo.lbaf.lbk_len, 7);
+	CU_ASSERT(geo.num_pu * geo.num_chk * geo.clba <= TEST_NUM_BLOCKS);
+
+	/* Newly created device has all of its chunks free */
+	CU_ASSERT_EQUAL(ftl_emu_get_chunk_info(emu, geo.num_chk - 1, info, 2), 0);
+	CU_ASSERT_TRUE(info[0].cs.free);
+	CU_ASSERT_EQUAL(info[0].wp, 0);
+	CU_ASSERT_EQUAL(info[0].slba, test_addr(emu, 0, geo.num_chk - 1, 0));
+	CU_ASSERT_TRUE(info[1].cs.free);
+	CU_ASSERT_EQUAL(info[1].slba, test_addr(emu, 1, 0, 0));
+	CU_ASSERT_NOT_EQUAL(ftl_emu_get_chunk_info(emu, geo.num_pu * geo.num_chk - 1, info, 2), 0);
+	ftl_emu_free(emu);
+
+	/* Restored device reports all of its chunks as closed */
+	emu = setup_emu(false);
+	CU_ASSERT_EQUAL(ftl_emu_get_chunk_info(emu, 0, info, 1), 0);
+	CU_ASSERT_TRUE(info[0].cs.closed);
+	CU_ASSERT_EQUAL(info[0].wp, info[0].cnlb);
+	ftl_emu_free(emu);
+
+	/* Too small bdev */
+	MOCK_SET(spdk_bdev_get_num_blocks, TEST_NUM_PUNITS * FTL_EMU_NUM_CHUNKS);
+	CU_ASSERT_PTR_NULL(ftl_emu_init((struct spdk_bdev_desc *)&g_bdev, TEST_NUM_PUNITS, 0, true));
+	MOCK_SET(spdk_bdev_get_num_blocks, TEST_NUM_BLOCKS);
+
+	/* Unsupported block size */
+	MOCK_SET(spdk_bdev_get_block_size, 512);
+	CU_ASSERT_PTR_NULL(ftl_emu_init((struct spdk_bdev_desc *)&g_bdev, TEST_NUM_PUNITS, 0, true));
+	MOCK_SET(spdk_bdev_get_block_size, FTL_BLOCK_SIZE);
+
+	/* Metadata region larger than the bdev */
+	CU_ASSERT_PTR_NULL(ftl_emu_init((struct spdk_bdev_desc *)&g_bdev, TEST_NUM_PUNITS,
+					TEST_NUM_BLOCKS, true));
+}
+
+static void
+test_read(void)
+{
+	struct ftl_emu *emu;
+	uint64_t clba;
+
+	emu = setup_emu(true);
+	clba = emu->geo.clba;
+
+	/* Bands are laid out contiguously on the base bdev */
+	CU_ASSERT_EQUAL(ftl_emu_read(emu, NULL, NULL, test_addr(emu, 2, 3, 16), 16,
+				     cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.type, FTL_EMU_REQ_READ);
+	CU_ASSERT_EQUAL(g_bdev_io.offset_blocks, (3 * TEST_NUM_PUNITS + 2) * clba + 16);
+	CU_ASSERT_EQUAL(g_bdev_io.num_blocks, 16);
+	CU_ASSERT_EQUAL(g_cmpl.count, 0);
+
+	complete_bdev_io(true);
+	CU_ASSERT_EQUAL(g_cmpl.count, 1);
+	CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+
+	CU_ASSERT_EQUAL(ftl_emu_read(emu, NULL, NULL, test_addr(emu, 0, 0, 0), 1,
+				     cmpl_cb, NULL), 0);
+	complete_bdev_io(false);
+	CU_ASSERT_EQUAL(g_cmpl.count, 2);
+	CU_ASSERT_TRUE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+
+	/* Crossing the chunk's boundary / invalid parallel unit */
+	CU_ASSERT_EQUAL(ftl_emu_read(emu, NULL, NULL, test_addr(emu, 0, 0, clba - 1), 2,
+				     cmpl_cb, NULL), -EINVAL);
+	CU_ASSERT_EQUAL(ftl_emu_read(emu, NULL, NULL, test_addr(emu, TEST_NUM_PUNITS, 0, 0), 1,
+				     cmpl_cb, NULL), -EINVAL);
+	CU_ASSERT_EQUAL(g_bdev_io.count, 2);
+
+	ftl_emu_free(emu);
+}
+
+static void
+test_md_region(void)
+{
+	struct ftl_emu *emu;
+	struct spdk_ocssd_geometry_data geo;
+	uint64_t md_lbks = 64;
+
+	memset(&g_bdev_io, 0, sizeof(g_bdev_io));
+	memset(&g_cmpl, 0, sizeof(g_cmpl));
+
+	emu = ftl_emu_init((struct spdk_bdev_desc *)&g_bdev, TEST_NUM_PUNITS, md_lbks, true);
+	SPDK_CU_ASSERT_FATAL(emu != NULL);
+	CU_ASSERT_EQUAL(ftl_emu_get_md_lbks(emu), md_lbks);
+
+	/* The region is excluded from the emulated geometry */
+	ftl_emu_get_geometry(emu, &geo);
+	CU_ASSERT(geo.num_pu * geo.num_chk * geo.clba <= TEST_NUM_BLOCKS - md_lbks);
+
+	/* Metadata accesses are placed at the end of the base bdev and aren't */
+	/* subject to the write pointer rules */
+	CU_ASSERT_EQUAL(ftl_emu_md_write(emu, NULL, NULL, 3, 1, cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.type, FTL_EMU_REQ_WRITE);
+	CU_ASSERT_EQUAL(g_bdev_io.offset_blocks, TEST_NUM_BLOCKS - md_lbks + 3);
+	complete_bdev_io(true);
+	CU_ASSERT_EQUAL(ftl_emu_md_write(emu, NULL, NULL, 3, 1, cmpl_cb, NULL), 0);
+	complete_bdev_io(true);
+	CU_ASSERT_EQUAL(g_cmpl.count, 2);
+	CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+
+	CU_ASSERT_EQUAL(ftl_emu_md_read(emu, NULL, NULL, md_lbks - 2, 2, cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.type, FTL_EMU_REQ_READ);
+	CU_ASSERT_EQUAL(g_bdev_io.offset_blocks, TEST_NUM_BLOCKS - 2);
+	CU_ASSERT_EQUAL(g_bdev_io.num_blocks, 2);
+	complete_bdev_io(true);
+	CU_ASSERT_EQUAL(g_cmpl.count, 3);
+
+	/* Out of the region's bounds */
+	CU_ASSERT_EQUAL(ftl_emu_md_read(emu, NULL, NULL, md_lbks - 1, 2, cmpl_cb, NULL), -EINVAL);
+	CU_ASSERT_EQUAL(ftl_emu_md_write(emu, NULL, NULL, md_lbks, 1, cmpl_cb, NULL), -EINVAL);
+	CU_ASSERT_EQUAL(g_bdev_io.count, 3);
+
+	ftl_emu_free(emu);
+}
+
+static void
+test_write_pointer(void)
+{
+	struct spdk_ocssd_chunk_information_entry info;
+	struct ftl_emu *emu;
+	uint64_t lbk, clba, ws_opt;
+
+	emu = setup_emu(true);
+	clba = emu->geo.clba;
+	ws_opt = emu->geo.ws_opt;
+
+	/* Write skipping the write pointer */
+	CU_ASSERT_EQUAL(ftl_emu_write(emu, NULL, NULL, test_addr(emu, 1, 5, ws_opt), ws_opt,
+				      cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.count, 0);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(g_cmpl.count, 1);
+	CU_ASSERT_EQUAL(g_cmpl.cpl.status.sct, SPDK_NVME_SCT_MEDIA_ERROR);
+	CU_ASSERT_EQUAL(g_cmpl.cpl.status.sc, SPDK_OCSSD_SC_OUT_OF_ORDER_WRITE);
+
+	/* Write smaller than the minimal write size */
+	CU_ASSERT_EQUAL(ftl_emu_write(emu, NULL, NULL, test_addr(emu, 1, 5, 0), 1,
+				      cmpl_cb, NULL), 0);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(g_cmpl.count, 2);
+	CU_ASSERT_EQUAL(g_cmpl.cpl.status.sc, SPDK_OCSSD_SC_OUT_OF_ORDER_WRITE);
+
+	/* Fill the whole chunk sequentially */
+	for (lbk = 0; lbk < clba; lbk += ws_opt) {
+		CU_ASSERT_EQUAL(ftl_emu_write(emu, NULL, NULL, test_addr(emu, 1, 5, lbk), ws_opt,
+					      cmpl_cb, NULL), 0);
+		CU_ASSERT_EQUAL(g_bdev_io.type, FTL_EMU_REQ_WRITE);
+		CU_ASSERT_EQUAL(g_bdev_io.offset_blocks, (5 * TEST_NUM_PUNITS + 1) * clba + lbk);
+
+		ftl_emu_get_chunk_info(emu, emu->geo.num_chk + 5, &info, 1);
+		CU_ASSERT_EQUAL(info.wp, lbk + ws_opt);
+		CU_ASSERT_EQUAL(info.cs.open, lbk + ws_opt < clba);
+		CU_ASSERT_EQUAL(info.cs.closed, lbk + ws_opt == clba);
+		CU_ASSERT_FALSE(info.cs.free);
+
+		complete_bdev_io(true);
+		CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+	}
+
+	/* Writes to a closed chunk are rejected */
+	CU_ASSERT_EQUAL(ftl_emu_write(emu, NULL, NULL, test_addr(emu, 1, 5, 0), ws_opt,
+				      cmpl_cb, NULL), 0);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(g_cmpl.cpl.status.sc, SPDK_OCSSD_SC_OUT_OF_ORDER_WRITE);
+
+	ftl_emu_free(emu);
+}
+
+static void
+test_reset(void)
+{
+	struct spdk_ocssd_chunk_information_entry info;
+	struct ftl_emu *emu;
+	uint64_t addr;
+
+	emu = setup_emu(false);
+	addr = test_addr(emu, 3, 7, 0);
+
+	/* Reset is only allowed at the beginning of a chunk */
+	addr |= 1;
+	CU_ASSERT_EQUAL(ftl_emu_vector_reset(emu, NULL, &addr, 1, cmpl_cb, NULL), -EINVAL);
+	addr &= ~1ULL;
+
+	CU_ASSERT_EQUAL(ftl_emu_vector_reset(emu, NULL, &addr, 1, cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.type, FTL_EMU_REQ_RESET);
+	CU_ASSERT_EQUAL(g_bdev_io.offset_blocks, (7 * TEST_NUM_PUNITS + 3) * emu->geo.clba);
+	CU_ASSERT_EQUAL(g_bdev_io.num_blocks, emu->geo.clba);
+	CU_ASSERT_EQUAL(g_cmpl.count, 0);
+
+	ftl_emu_get_chunk_info(emu, 3 * emu->geo.num_chk + 7, &info, 1);
+	CU_ASSERT_TRUE(info.cs.free);
+	CU_ASSERT_EQUAL(info.wp, 0);
+
+	/* Failing to deallocate the blocks doesn't fail the reset */
+	complete_bdev_io(false);
+	CU_ASSERT_EQUAL(g_cmpl.count, 1);
+	CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+
+	/* The chunk can be written again */
+	CU_ASSERT_EQUAL(ftl_emu_write(emu, NULL, NULL, addr, emu->geo.ws_opt, cmpl_cb, NULL), 0);
+	complete_bdev_io(true);
+	CU_ASSERT_EQUAL(g_cmpl.count, 2);
+	CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+
+	/* Base bdevs without unmap support complete the reset right away */
+	MOCK_SET(spdk_bdev_io_type_supported, false);
+	addr = test_addr(emu, 0, 1, 0);
+	CU_ASSERT_EQUAL(ftl_emu_vector_reset(emu, NULL, &addr, 1, cmpl_cb, NULL), 0);
+	CU_ASSERT_EQUAL(g_bdev_io.count, 2);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(g_cmpl.count, 3);
+	CU_ASSERT_FALSE(spdk_nvme_cpl_is_error(&g_cmpl.cpl));
+	MOCK_SET(spdk_bdev_io_type_supported, true);
+
+	ftl_emu_free(emu);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	if (CU_initialize_registry() != CUE_SUCCESS) {
+		return CU_get_error();
+	}
+
+	suite = CU_add_suite("ftl_emu_suite", NULL, NULL);
+	if (!suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (
+		CU_add_test(suite, "test_geometry",
+			    test_geometry) == NULL
+		|| CU_add_test(suite, "test_read",
+			       test_read) == NULL
+		|| CU_add_test(suite, "test_md_region",
+			       test_md_region) == NULL
+		|| CU_add_test(suite, "test_write_pointer",
+			       test_write_pointer) == NULL
+		|| CU_add_test(suite, "test_reset",
+			       test_reset) == NULL
+	) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	g_thread = spdk_thread_create("ftl_emu_ut");
+	spdk_set_thread(g_thread);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	spdk_thread_exit(g_thread);
+
+	return num_failures;
+}
@@ -0,0 +1,442 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+#include "spdk_internal/thread.h"
+
+#include "ftl/ftl_l2p_cache.c"
+
+#define TEST_CACHED_PAGES	4
+#define TEST_NUM_PAGES		16
+#define TEST_ENTRIES_PER_PAGE	(FTL_BLOCK_SIZE / sizeof(uint64_t))
+#define TEST_NUM_LBAS		(TEST_NUM_PAGES * TEST_ENTRIES_PER_PAGE)
+
+static struct spdk_thread *g_thread;
+
+/* Metadata region of the device */
+static char g_region[TEST_NUM_PAGES][FTL_BLOCK_SIZE];
+
+/* Outstanding page transfer */
+static struct {
+	bool				write;
+	void				*buf;
+	uint64_t			lbk;
+	spdk_nvme_cmd_cb		cb;
+	void				*cb_arg;
+	int				count;
+} g_md_io;
+
+static int
+submit_md_io(bool write, void *payload, uint64_t lbk, uint32_t lbk_count,
+	     spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	CU_ASSERT_EQUAL(lbk_count, 1);
+	CU_ASSERT(lbk < TEST_NUM_PAGES);
+	CU_ASSERT_PTR_NULL(g_md_io.cb);
+
+	g_md_io.write = write;
+	g_md_io.buf = payload;
+	g_md_io.lbk = lbk;
+	g_md_io.cb = cb_fn;
+	g_md_io.cb_arg = cb_arg;
+	g_md_io.count++;
+
+	return 0;
+}
+
+int
+ftl_emu_md_read(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+		uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return submit_md_io(false, payload, lbk, lbk_count, cb_fn, cb_arg);
+}
+
+int
+ftl_emu_md_write(struct ftl_emu *emu, struct spdk_io_channel *ch, void *payload,
+		 uint64_t lbk, uint32_t lbk_count, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return submit_md_io(true, payload, lbk, lbk_count, cb_fn, cb_arg);
+}
+
+static void
+complete_md_io(bool success)
+{
+	struct spdk_nvme_cpl cpl = {};
+	spdk_nvme_cmd_cb cb = g_md_io.cb;
+
+	SPDK_CU_ASSERT_FATAL(cb != NULL);
+	g_md_io.cb = NULL;
+
+	if (success) {
+		if (g_md_io.write) {
+			memcpy(g_region[g_md_io.lbk], g_md_io.buf, FTL_BLOCK_SIZE);
+		} else {
+			memcpy(g_md_io.buf, g_region[g_md_io.lbk], FTL_BLOCK_SIZE);
+		}
+	} else {
+		cpl.status.sct = SPDK_NVME_SCT_GENERIC;
+		cpl.status.sc = SPDK_NVME_SC_INTERNAL_DEVICE_ERROR;
+	}
+
+	cb(g_md_io.cb_arg, &cpl);
+}
+
+static uint64_t
+test_lba(uint64_t page, uint64_t offset)
+{
+	return page * TEST_ENTRIES_PER_PAGE + offset;
+}
+
+static struct spdk_ftl_dev *
+setup_cache(void)
+{
+	struct spdk_ftl_dev *dev;
+
+	memset(&g_md_io, 0, sizeof(g_md_io));
+
+	dev = calloc(1, sizeof(*dev));
+	SPDK_CU_ASSERT_FATAL(dev != NULL);
+
+	/* Use the unpacked (64-bit) entries */
+	dev->ppa_len = 40;
+	dev->num_lbas = TEST_NUM_LBAS;
+	dev->core_thread.thread = g_thread;
+
+	dev->l2p_cache = ftl_l2p_cache_init(dev, TEST_CACHED_PAGES * FTL_BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(dev->l2p_cache != NULL);
+
+	return dev;
+}
+
+static void
+cleanup_cache(struct spdk_ftl_dev *dev)
+{
+	CU_ASSERT_EQUAL(dev->num_inflight, 0);
+	ftl_l2p_cache_free(dev->l2p_cache);
+	free(dev);
+}
+
+/* Pins, sets and unpins the entry, leaving its page dirty on the LRU list */
+static void
+test_set_entry(struct spdk_ftl_dev *dev, uint64_t lba, uint64_t ppa)
+{
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, lba, NULL), 0);
+	ftl_l2p_set(dev, lba, ftl_to_ppa(ppa));
+	ftl_l2p_unpin(dev, lba);
+}
+
+static void
+test_pin_resident(void)
+{
+	struct spdk_ftl_dev *dev = setup_cache();
+	struct ftl_l2p_cache_stats stats;
+
+	/* Pages that were never stored are filled with invalid addresses */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(3, 5), NULL), 0);
+	CU_ASSERT_TRUE(ftl_ppa_invalid(ftl_l2p_get(dev, test_lba(3, 5))));
+	CU_ASSERT_TRUE(ftl_ppa_invalid(ftl_l2p_get(dev, test_lba(3, 0))));
+
+	ftl_l2p_set(dev, test_lba(3, 5), ftl_to_ppa(0x1234));
+	CU_ASSERT_EQUAL(ftl_l2p_get(dev, test_lba(3, 5)).ppa, 0x1234);
+
+	/* The same page can be pinned multiple times */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(3, 6), NULL), 0);
+	ftl_l2p_unpin(dev, test_lba(3, 6));
+	ftl_l2p_unpin(dev, test_lba(3, 5));
+
+	CU_ASSERT_EQUAL(g_md_io.count, 0);
+
+	ftl_l2p_cache_get_stats(dev->l2p_cache, &stats);
+	CU_ASSERT_EQUAL(stats.misses, 1);
+	CU_ASSERT_EQUAL(stats.hits, 1);
+	CU_ASSERT_EQUAL(stats.page_ins, 0);
+
+	cleanup_cache(dev);
+}
+
+static void
+test_page_out_in(void)
+{
+	struct spdk_ftl_dev *dev = setup_cache();
+	struct ftl_l2p_cache_stats stats;
+	struct ftl_ppa ppa;
+	uint64_t i;
+
+	/* Fill the whole cache with dirty pages */
+	for (i = 0; i < TEST_CACHED_PAGES; ++i) {
+		test_set_entry(dev, test_lba(i, i), 0x100 + i);
+	}
+
+	/* Another page requires the least recently used one to be written back */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), NULL), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 1);
+	CU_ASSERT_TRUE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+	CU_ASSERT_EQUAL(dev->num_inflight, 1);
+
+	/* The page is still accessible while it's being written */
+	CU_ASSERT_TRUE(ftl_l2p_cache_peek(dev->l2p_cache, test_lba(0, 0), &ppa));
+	CU_ASSERT_EQUAL(ppa.ppa, 0x100);
+	complete_md_io(true);
+	CU_ASSERT_FALSE(ftl_l2p_cache_peek(dev->l2p_cache, test_lba(0, 0), &ppa));
+
+	/* Now there's a free page to use */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), NULL), 0);
+	ftl_l2p_unpin(dev, test_lba(TEST_CACHED_PAGES, 0));
+
+	/* Bring the first page back, evicting the second one */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), NULL), -EAGAIN);
+	CU_ASSERT_TRUE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 1);
+	complete_md_io(true);
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), NULL), -EAGAIN);
+	CU_ASSERT_FALSE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+
+	/* Page-in is in progress, don't issue another one */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), NULL), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 3);
+	complete_md_io(true);
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), NULL), 0);
+	CU_ASSERT_EQUAL(ftl_l2p_get(dev, test_lba(0, 0)).ppa, 0x100);
+	CU_ASSERT_TRUE(ftl_ppa_invalid(ftl_l2p_get(dev, test_lba(0, 1))));
+	ftl_l2p_unpin(dev, test_lba(0, 1));
+
+	ftl_l2p_cache_get_stats(dev->l2p_cache, &stats);
+	CU_ASSERT_EQUAL(stats.page_ins, 1);
+	CU_ASSERT_EQUAL(stats.writebacks, 2);
+	CU_ASSERT_EQUAL(stats.evictions, 2);
+	CU_ASSERT_EQUAL(stats.misses, TEST_CACHED_PAGES + 2);
+
+	cleanup_cache(dev);
+}
+
+static void
+test_pinned_pages(void)
+{
+	struct spdk_ftl_dev *dev = setup_cache();
+	uint64_t i;
+
+	for (i = 0; i < TEST_CACHED_PAGES; ++i) {
+		CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(i, 0), NULL), 0);
+	}
+
+	/* Pinned pages can't be evicted */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), NULL), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 0);
+
+	/* Clean pages are reused without any writes */
+	ftl_l2p_unpin(dev, test_lba(2, 0));
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), NULL), 0);
+	CU_ASSERT_EQUAL(g_md_io.count, 0);
+
+	/* Page modified during its write back stays resident */
+	ftl_l2p_set(dev, test_lba(0, 0), ftl_to_ppa(0x200));
+	ftl_l2p_unpin(dev, test_lba(0, 0));
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES + 1, 0), NULL), -EAGAIN);
+	CU_ASSERT_TRUE(g_md_io.write);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), NULL), 0);
+	ftl_l2p_set(dev, test_lba(0, 1), ftl_to_ppa(0x201));
+	ftl_l2p_unpin(dev, test_lba(0, 1));
+	complete_md_io(true);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES + 1, 0), NULL), -EAGAIN);
+	CU_ASSERT_TRUE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+
+	/* Failed write keeps the page dirty */
+	complete_md_io(false);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES + 1, 0), NULL), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+	complete_md_io(true);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES + 1, 0), NULL), 0);
+	ftl_l2p_unpin(dev, test_lba(TEST_CACHED_PAGES + 1, 0));
+
+	/* Failed read doesn't leave the page resident */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), NULL), -EAGAIN);
+	CU_ASSERT_FALSE(g_md_io.write);
+	complete_md_io(false);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), NULL), -EAGAIN);
+	complete_md_io(true);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), NULL), 0);
+	CU_ASSERT_EQUAL(ftl_l2p_get(dev, test_lba(0, 1)).ppa, 0x201);
+	ftl_l2p_unpin(dev, test_lba(0, 0));
+
+	ftl_l2p_unpin(dev, test_lba(1, 0));
+	ftl_l2p_unpin(dev, test_lba(3, 0));
+	ftl_l2p_unpin(dev, test_lba(TEST_CACHED_PAGES, 0));
+
+	cleanup_cache(dev);
+}
+
+static void
+waiter_cb(void *ctx)
+{
+	int *count = ctx;
+
+	(*count)++;
+}
+
+static void
+test_pin_waiters(void)
+{
+	struct spdk_ftl_dev *dev = setup_cache();
+	struct ftl_l2p_waiter waiter[3];
+	int count[3] = {};
+	uint64_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(waiter); ++i) {
+		waiter[i].cb_fn = waiter_cb;
+		waiter[i].cb_arg = &count[i];
+	}
+
+	/* Store the first page, so that it has to be read back */
+	for (i = 0; i < TEST_CACHED_PAGES; ++i) {
+		test_set_entry(dev, test_lba(i, 0), 0x300 + i);
+	}
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), &waiter[0]), -EAGAIN);
+	CU_ASSERT_TRUE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+
+	/* Waiters are notified once the page is freed by the write back */
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 0);
+	complete_md_io(true);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 1);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES, 0), &waiter[0]), 0);
+	ftl_l2p_unpin(dev, test_lba(TEST_CACHED_PAGES, 0));
+
+	/* Pin all the pages, so that there's nothing to evict */
+	for (i = 1; i <= TEST_CACHED_PAGES; ++i) {
+		CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(i, 0), NULL), 0);
+	}
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), &waiter[0]), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 1);
+
+	/* Unpinning a page wakes up the waiters */
+	ftl_l2p_unpin(dev, test_lba(TEST_CACHED_PAGES, 0));
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 2);
+
+	/* All pins of a page that's being loaded wait for the same read */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), &waiter[0]), -EAGAIN);
+	CU_ASSERT_FALSE(g_md_io.write);
+	CU_ASSERT_EQUAL(g_md_io.lbk, 0);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), &waiter[1]), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 2);
+
+	/* Waiters on another page aren't woken up by the page-in */
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(TEST_CACHED_PAGES + 1, 0), &waiter[2]), -EAGAIN);
+	CU_ASSERT_EQUAL(g_md_io.count, 2);
+
+	/* Failed read still notifies the waiters, so that they can retry it */
+	complete_md_io(false);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 3);
+	CU_ASSERT_EQUAL(count[1], 1);
+	CU_ASSERT_EQUAL(count[2], 1);
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), &waiter[0]), -EAGAIN);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), &waiter[1]), -EAGAIN);
+	complete_md_io(true);
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 4);
+	CU_ASSERT_EQUAL(count[1], 2);
+
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 0), &waiter[0]), 0);
+	CU_ASSERT_EQUAL(ftl_l2p_get(dev, test_lba(0, 0)).ppa, 0x300);
+	CU_ASSERT_EQUAL(ftl_l2p_pin(dev, test_lba(0, 1), &waiter[1]), 0);
+	ftl_l2p_unpin(dev, test_lba(0, 1));
+	ftl_l2p_unpin(dev, test_lba(0, 0));
+
+	for (i = 1; i < TEST_CACHED_PAGES; ++i) {
+		ftl_l2p_unpin(dev, test_lba(i, 0));
+	}
+
+	spdk_thread_poll(g_thread, 0, 0);
+	CU_ASSERT_EQUAL(count[0], 4);
+	CU_ASSERT_EQUAL(count[1], 2);
+	CU_ASSERT_EQUAL(count[2], 1);
+
+	cleanup_cache(dev);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	if (CU_initialize_registry() != CUE_SUCCESS) {
+		return CU_get_error();
+	}
+
+	suite = CU_add_suite("ftl_l2p_cache_suite", NULL, NULL);
+	if (!suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (
+		CU_add_test(suite, "test_pin_resident",
+			    test_pin_resident) == NULL
+		|| CU_add_test(suite, "test_page_out_in",
+			       test_page_out_in) == NULL
+		|| CU_add_test(suite, "test_pinned_pages",
+			       test_pinned_pages) == NULL
+		|| CU_add_test(suite, "test_pin_waiters",
+			       test_pin_waiters) == NULL
+	) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	g_thread = spdk_thread_create("ftl_l2p_cache_ut");
+	spdk_set_thread(g_thread);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	spdk_thread_exit(g_thread);
+
+	return num_failures;
+}
@@ -42,6 +42,9 @@
 
 static struct spdk_ftl_dev *g_dev;
 
+DEFINE_STUB(ftl_l2p_cache_get, struct ftl_ppa, (struct ftl_l2p_cache *cache, uint64_t lba), {});
+DEFINE_STUB_V(ftl_l2p_cache_set, (struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa ppa));
+
 static struct spdk_ftl_dev *
 test_alloc_dev(size_t size)
 {
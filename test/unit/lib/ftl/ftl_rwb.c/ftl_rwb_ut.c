@@ -70,12 +70,12 @@ test_rwb_acquire(void)
 	setup_rwb();
 	/* Verify that it's possible to acquire all of the entries */
 	for (i = 0; i < RWB_ENTRY_COUNT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		ftl_rwb_push(entry);
 	}
 
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 	cleanup_rwb();
 }
@@ -90,7 +90,7 @@ test_rwb_pop(void)
 	setup_rwb();
 	/* Acquire all entries */
 	for (i = 0; i < RWB_ENTRY_COUNT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		entry->lba = i;
 		ftl_rwb_push(entry);
@@ -98,7 +98,7 @@ test_rwb_pop(void)
 
 	/* Pop all batches and free them */
 	for (i = 0; i < RWB_ENTRY_COUNT / XFER_SIZE; ++i) {
-		batch = ftl_rwb_pop(g_rwb);
+		batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(batch);
 		entry_count = 0;
 
@@ -113,23 +113,23 @@ test_rwb_pop(void)
 
 	/* Acquire all entries once more */
 	for (i = 0; i < RWB_ENTRY_COUNT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		ftl_rwb_push(entry);
 	}
 
 	/* Pop one batch and check we can acquire XFER_SIZE entries */
-	batch = ftl_rwb_pop(g_rwb);
+	batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 	SPDK_CU_ASSERT_FATAL(batch);
 	ftl_rwb_batch_release(batch);
 
 	for (i = 0; i < XFER_SIZE; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		ftl_rwb_push(entry);
 	}
 
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 	cleanup_rwb();
 }
@@ -143,20 +143,20 @@ test_rwb_batch_revert(void)
 
 	setup_rwb();
 	for (i = 0; i < RWB_ENTRY_COUNT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		ftl_rwb_push(entry);
 	}
 
 	/* Pop one batch and revert it */
-	batch = ftl_rwb_pop(g_rwb);
+	batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 	SPDK_CU_ASSERT_FATAL(batch);
 
 	ftl_rwb_batch_revert(batch);
 
 	/* Verify all of the batches */
 	for (i = 0; i < RWB_ENTRY_COUNT / XFER_SIZE; ++i) {
-		batch = ftl_rwb_pop(g_rwb);
+		batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 		CU_ASSERT_PTR_NOT_NULL_FATAL(batch);
 	}
 	cleanup_rwb();
@@ -189,7 +189,7 @@ test_rwb_worker(void *ctx)
 
 	for (i = 0; i < ENTRIES_PER_WORKER; ++i) {
 		while (1) {
-			entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+			entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 			if (entry) {
 				entry->flags = 0;
 				ftl_rwb_push(entry);
@@ -224,7 +224,7 @@ test_rwb_parallel(void)
 	}
 
 	while (1) {
-		batch = ftl_rwb_pop(g_rwb);
+		batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 		if (batch) {
 			ftl_rwb_foreach(entry, batch) {
 				num_entries++;
@@ -267,10 +267,10 @@ test_rwb_limits_base(void)
 	CU_ASSERT_TRUE(limits[FTL_RWB_TYPE_USER] == ftl_rwb_entry_cnt(g_rwb));
 
 	/* Verify it's possible to acquire both type of entries */
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
 
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
 	cleanup_rwb();
 }
@@ -315,13 +315,13 @@ test_rwb_limits_applied(void)
 	ftl_rwb_get_limits(g_rwb, limits);
 	limits[FTL_RWB_TYPE_USER] = 0;
 	ftl_rwb_set_limits(g_rwb, limits);
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 
 	limits[FTL_RWB_TYPE_USER] = ftl_rwb_entry_cnt(g_rwb);
 	limits[FTL_RWB_TYPE_INTERNAL] = 0;
 	ftl_rwb_set_limits(g_rwb, limits);
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 
 	/* Check positive limits */
@@ -330,22 +330,22 @@ test_rwb_limits_applied(void)
 	limits[FTL_RWB_TYPE_INTERNAL] = TEST_LIMIT;
 	ftl_rwb_set_limits(g_rwb, limits);
 	for (i = 0; i < TEST_LIMIT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		entry->flags = FTL_IO_INTERNAL;
 		ftl_rwb_push(entry);
 	}
 
 	/* Now we expect null, since we've reached threshold */
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 
 	/* Complete the entries and check we can retrieve the entries once again */
-	batch = ftl_rwb_pop(g_rwb);
+	batch = ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_USER_HOT);
 	SPDK_CU_ASSERT_FATAL(batch);
 	ftl_rwb_batch_release(batch);
 
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
 	entry->flags = FTL_IO_INTERNAL;
 
@@ -354,24 +354,64 @@ test_rwb_limits_applied(void)
 	limits[FTL_RWB_TYPE_INTERNAL] = ftl_rwb_entry_cnt(g_rwb);
 	ftl_rwb_set_limits(g_rwb, limits);
 	for (i = 0; i < TEST_LIMIT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 		ftl_rwb_push(entry);
 	}
 
 	/* Now we expect null, since we've reached threshold */
-	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER);
+	entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, SPDK_FTL_STREAM_USER_HOT);
 	CU_ASSERT_PTR_NULL(entry);
 
 	/* Check that we're still able to acquire a number of internal entries */
 	/* while the user entires are being throttled */
 	for (i = 0; i < TEST_LIMIT; ++i) {
-		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL);
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_INTERNAL, SPDK_FTL_STREAM_USER_HOT);
 		SPDK_CU_ASSERT_FATAL(entry);
 	}
 	cleanup_rwb();
 }
 
+static void
+test_rwb_streams(void)
+{
+	struct ftl_rwb_entry *entry;
+	struct ftl_rwb_batch *batch;
+	enum spdk_ftl_stream stream;
+	size_t i;
+
+	setup_rwb();
+	/* Interleave the entries of two streams and verify they're not mixed */
+	/* within the batches */
+	for (i = 0; i < XFER_SIZE * 2; ++i) {
+		stream = (i % 2) ? SPDK_FTL_STREAM_USER_COLD : SPDK_FTL_STREAM_USER_HOT;
+		entry = ftl_rwb_acquire(g_rwb, FTL_RWB_TYPE_USER, stream);
+		SPDK_CU_ASSERT_FATAL(entry);
+		entry->lba = i;
+		ftl_rwb_push(entry);
+	}
+
+	CU_ASSERT_EQUAL(ftl_rwb_num_pending(g_rwb, SPDK_FTL_STREAM_USER_HOT), XFER_SIZE);
+	CU_ASSERT_EQUAL(ftl_rwb_num_pending(g_rwb, SPDK_FTL_STREAM_USER_COLD), XFER_SIZE);
+	CU_ASSERT_EQUAL(ftl_rwb_num_pending(g_rwb, SPDK_FTL_STREAM_GC), 0);
+	CU_ASSERT_PTR_NULL(ftl_rwb_pop(g_rwb, SPDK_FTL_STREAM_GC));
+
+	for (stream = SPDK_FTL_STREAM_USER_HOT; stream <= SPDK_FTL_STREAM_USER_COLD; ++stream) {
+		batch = ftl_rwb_pop(g_rwb, stream);
+		SPDK_CU_ASSERT_FATAL(batch);
+		CU_ASSERT_EQUAL(ftl_rwb_batch_get_stream(batch), stream);
+
+		ftl_rwb_foreach(entry, batch) {
+			CU_ASSERT_EQUAL(entry->lba % 2, stream == SPDK_FTL_STREAM_USER_COLD);
+		}
+
+		CU_ASSERT_PTR_NULL(ftl_rwb_pop(g_rwb, stream));
+		ftl_rwb_batch_release(batch);
+		CU_ASSERT_EQUAL(ftl_rwb_num_pending(g_rwb, stream), 0);
+	}
+	cleanup_rwb();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -405,6 +445,8 @@ main(int argc, char **argv)
 			       test_rwb_limits_set) == NULL
 		|| CU_add_test(suite, "test_rwb_limits_applied",
 			       test_rwb_limits_applied) == NULL
+		|| CU_add_test(suite, "test_rwb_streams",
+			       test_rwb_streams) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -75,6 +75,39 @@ DEFINE_STUB(spdk_nvme_ocssd_ns_cmd_vector_reset, int, (struct spdk_nvme_ns *ns,
 		struct spdk_nvme_qpair *qpair, uint64_t *lba_list, uint32_t num_lbas,
 		struct spdk_ocssd_chunk_information_entry *chunk_info,
 		spdk_nvme_cmd_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(ftl_emu_vector_reset, int, (struct ftl_emu *emu, struct spdk_io_channel *ch,
+					uint64_t *lba_list, uint32_t num_lbas,
+					spdk_nvme_cmd_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(ftl_l2p_cache_get, struct ftl_ppa, (struct ftl_l2p_cache *cache, uint64_t lba), {});
+DEFINE_STUB_V(ftl_l2p_cache_set, (struct ftl_l2p_cache *cache, uint64_t lba, struct ftl_ppa ppa));
+DEFINE_STUB_V(ftl_l2p_cache_unpin, (struct ftl_l2p_cache *cache, uint64_t lba));
+
+static size_t g_num_pending[SPDK_FTL_STREAM_MAX];
+static size_t g_num_padded[SPDK_FTL_STREAM_MAX];
+static char g_entry_data[FTL_BLOCK_SIZE];
+static struct ftl_rwb_entry g_entry = {
+	.data = g_entry_data,
+};
+
+size_t
+ftl_rwb_num_pending(struct ftl_rwb *rwb, enum spdk_ftl_stream stream)
+{
+	return g_num_pending[stream];
+}
+
+struct ftl_rwb_entry *
+ftl_rwb_acquire(struct ftl_rwb *rwb, enum ftl_rwb_entry_type type, enum spdk_ftl_stream stream)
+{
+	g_num_pending[stream]++;
+	g_entry.lba = FTL_LBA_INVALID;
+	return &g_entry;
+}
+
+void
+ftl_rwb_push(struct ftl_rwb_entry *entry)
+{
+	g_num_padded[entry->stream]++;
+}
 
 struct ftl_io *
 ftl_io_erase_init(struct ftl_band *band, size_t lbk_cnt, spdk_ftl_fn cb)
@@ -143,7 +176,7 @@ test_wptr(void)
 	setup_wptr_test(&dev, &g_geo, &g_range);
 
 	xfer_size = dev->xfer_size;
-	ftl_add_wptr(dev);
+	ftl_add_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
 	for (i = 0; i < ftl_dev_num_bands(dev); ++i) {
 		wptr = LIST_FIRST(&dev->wptr_list);
 		band = wptr->band;
@@ -171,7 +204,7 @@ test_wptr(void)
 		CU_ASSERT_EQUAL(band->state, FTL_BAND_STATE_CLOSED);
 		CU_ASSERT_TRUE(LIST_EMPTY(&dev->wptr_list));
 
-		rc = ftl_add_wptr(dev);
+		rc = ftl_add_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
 
 		/* There are no free bands during the last iteration, so */
 		/* there'll be no new wptr allocation */
@@ -185,6 +218,97 @@ test_wptr(void)
 	cleanup_wptr_test(dev);
 }
 
+static void
+test_wptr_streams(void)
+{
+	struct spdk_ftl_dev *dev;
+	struct ftl_wptr *hot, *gc;
+	int rc;
+
+	setup_wptr_test(&dev, &g_geo, &g_range);
+
+	rc = ftl_add_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = ftl_add_wptr(dev, SPDK_FTL_STREAM_GC);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	/* Verify each stream is given its own band */
+	hot = ftl_stream_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
+	gc = ftl_stream_wptr(dev, SPDK_FTL_STREAM_GC);
+	SPDK_CU_ASSERT_FATAL(hot != NULL && gc != NULL);
+	CU_ASSERT_PTR_NULL(ftl_stream_wptr(dev, SPDK_FTL_STREAM_USER_COLD));
+	CU_ASSERT_NOT_EQUAL(hot->band, gc->band);
+	CU_ASSERT_EQUAL(hot->band->stream, SPDK_FTL_STREAM_USER_HOT);
+	CU_ASSERT_EQUAL(gc->band->stream, SPDK_FTL_STREAM_GC);
+
+	/* Bands holding relocated data are preferred by defrag over equally */
+	/* invalidated hot bands */
+	dev->seq = 10;
+	hot->band->md.seq = gc->band->md.seq = 1;
+	hot->band->md.num_vld = gc->band->md.num_vld = ftl_band_num_usable_lbks(hot->band) / 2;
+	CU_ASSERT(ftl_band_calc_merit(gc->band, NULL) > ftl_band_calc_merit(hot->band, NULL));
+
+	ftl_remove_wptr(hot);
+	ftl_remove_wptr(gc);
+	cleanup_wptr_test(dev);
+}
+
+static void
+test_wptr_shutdown(void)
+{
+	struct spdk_ftl_dev *dev;
+	struct ftl_wptr *hot, *gc;
+	size_t xfer_size;
+	int rc;
+
+	setup_wptr_test(&dev, &g_geo, &g_range);
+	pthread_spin_init(&g_entry.lock, PTHREAD_PROCESS_PRIVATE);
+	memset(g_num_pending, 0, sizeof(g_num_pending));
+	memset(g_num_padded, 0, sizeof(g_num_padded));
+	xfer_size = dev->xfer_size;
+
+	rc = ftl_add_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = ftl_add_wptr(dev, SPDK_FTL_STREAM_GC);
+	CU_ASSERT_EQUAL(rc, 0);
+	hot = ftl_stream_wptr(dev, SPDK_FTL_STREAM_USER_HOT);
+	gc = ftl_stream_wptr(dev, SPDK_FTL_STREAM_GC);
+	SPDK_CU_ASSERT_FATAL(hot != NULL && gc != NULL);
+
+	/* The cold stream has a partial batch, but no wptr of its own */
+	g_num_pending[SPDK_FTL_STREAM_USER_COLD] = 1;
+	g_num_pending[SPDK_FTL_STREAM_GC] = 1;
+	dev->halt = 1;
+
+	/* The hot wptr pads the cold batch first, so that it picks it up */
+	/* before it starts padding its own band */
+	ftl_process_shutdown(hot);
+	CU_ASSERT_TRUE(LIST_EMPTY(&dev->free_bands));
+	CU_ASSERT_EQUAL(g_num_pending[SPDK_FTL_STREAM_USER_COLD], xfer_size);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_USER_COLD], xfer_size - 1);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_USER_HOT], 0);
+
+	/* Nothing more is padded until the cold batch is written by either wptr */
+	ftl_process_shutdown(hot);
+	ftl_process_shutdown(gc);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_USER_COLD], xfer_size - 1);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_USER_HOT], 0);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_GC], 0);
+
+	/* Once it's written, each wptr pads its own stream */
+	g_num_pending[SPDK_FTL_STREAM_USER_COLD] = 0;
+	ftl_process_shutdown(hot);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_USER_HOT], xfer_size);
+	ftl_process_shutdown(gc);
+	CU_ASSERT_EQUAL(g_num_padded[SPDK_FTL_STREAM_GC], xfer_size - 1);
+
+	dev->halt = 0;
+	pthread_spin_destroy(&g_entry.lock);
+	ftl_remove_wptr(hot);
+	ftl_remove_wptr(gc);
+	cleanup_wptr_test(dev);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -204,6 +328,10 @@ main(int argc, char **argv)
 	if (
 		CU_add_test(suite, "test_wptr",
 			    test_wptr) == NULL
+		|| CU_add_test(suite, "test_wptr_streams",
+			       test_wptr_streams) == NULL
+		|| CU_add_test(suite, "test_wptr_shutdown",
+			       test_wptr_shutdown) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -16,6 +16,7 @@
 SPDK_LOG_REGISTER_COMPONENT("iscsi", SPDK_LOG_ISCSI)
 
 TAILQ_HEAD(, spdk_iscsi_pdu) g_write_pdu_list;
+struct spdk_iscsi_conn *g_held_pdu_conn;
 
 struct spdk_iscsi_task *
 spdk_iscsi_task_get(struct spdk_iscsi_conn *conn,
@@ -77,10 +78,19 @@ spdk_get_pdu(void)
 
 DEFINE_STUB_V(spdk_scsi_task_process_null_lun, (struct spdk_scsi_task *task));
 
+DEFINE_STUB(spdk_scsi_lun_get_dif_ctx, bool,
+	    (struct spdk_scsi_lun *lun, uint8_t *cdb, uint32_t offset,
+	     struct spdk_dif_ctx *dif_ctx), false);
+
 DEFINE_STUB_V(spdk_scsi_task_process_abort, (struct spdk_scsi_task *task));
 
-DEFINE_STUB_V(spdk_scsi_dev_queue_task,
-	      (struct spdk_scsi_dev *dev, struct spdk_scsi_task *task));
+struct spdk_scsi_task *g_queued_scsi_task;
+
+void
+spdk_scsi_dev_queue_task(struct spdk_scsi_dev *dev, struct spdk_scsi_task *task)
+{
+	g_queued_scsi_task = task;
+}
 
 DEFINE_STUB(spdk_scsi_dev_find_port_by_id, struct spdk_scsi_port *,
 	    (struct spdk_scsi_dev *dev, uint64_t id), NULL);
@@ -202,6 +212,12 @@ spdk_iscsi_conn_write_pdu(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 
 DEFINE_STUB_V(spdk_iscsi_conn_logout, (struct spdk_iscsi_conn *conn));
 
+void
+spdk_iscsi_conn_execute_held_pdu(struct spdk_iscsi_conn *conn)
+{
+	g_held_pdu_conn = conn;
+}
+
 DEFINE_STUB_V(spdk_scsi_task_set_status,
 	      (struct spdk_scsi_task *task, int sc, int sk, int asc, int ascq));
 
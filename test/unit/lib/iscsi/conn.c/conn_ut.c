@@ -55,7 +55,13 @@ DEFINE_STUB(spdk_env_get_first_core, uint32_t, (void), 0);
 
 DEFINE_STUB(spdk_env_get_last_core, uint32_t, (void), 0);
 
-DEFINE_STUB(spdk_env_get_next_core, uint32_t, (uint32_t prev_core), 0);
+#define UT_NUM_CORES	4
+
+uint32_t
+spdk_env_get_next_core(uint32_t prev_core)
+{
+	return prev_core + 1 < UT_NUM_CORES ? prev_core + 1 : UINT32_MAX;
+}
 
 DEFINE_STUB(spdk_event_allocate, struct spdk_event *,
 	    (uint32_t lcore, spdk_event_fn fn, void *arg1, void *arg2),
@@ -78,8 +84,34 @@ spdk_sock_close(struct spdk_sock **sock)
 DEFINE_STUB(spdk_sock_recv, ssize_t,
 	    (struct spdk_sock *sock, void *buf, size_t len), 0);
 
-DEFINE_STUB(spdk_sock_readv, ssize_t,
-	    (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
+static uint8_t g_sock_data[SPDK_ISCSI_CONN_RECV_BUF_SIZE * 2];
+static size_t g_sock_data_len;
+static size_t g_sock_data_offset;
+static int g_sock_readv_cnt;
+
+ssize_t
+spdk_sock_readv(struct spdk_sock *sock, struct iovec *iov, int iovcnt)
+{
+	size_t len;
+	ssize_t total = 0;
+	int i;
+
+	g_sock_readv_cnt++;
+
+	if (g_sock_data_offset == g_sock_data_len) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	for (i = 0; i < iovcnt && g_sock_data_offset < g_sock_data_len; i++) {
+		len = spdk_min(iov[i].iov_len, g_sock_data_len - g_sock_data_offset);
+		memcpy(iov[i].iov_base, g_sock_data + g_sock_data_offset, len);
+		g_sock_data_offset += len;
+		total += len;
+	}
+
+	return total;
+}
 
 DEFINE_STUB(spdk_sock_writev, ssize_t,
 	    (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
@@ -334,6 +366,172 @@ propagate_scsi_error_status_for_split_read_tasks(void)
 	CU_ASSERT(TAILQ_EMPTY(&primary.subtask_list));
 }
 
+static void
+read_data_through_recv_buf(void)
+{
+	struct spdk_iscsi_conn conn = {};
+	uint8_t buf[SPDK_ISCSI_CONN_RECV_DIRECT_THRESHOLD * 2];
+	struct iovec iov[2];
+	size_t i;
+	int rc;
+
+	conn.recv_buf = malloc(SPDK_ISCSI_CONN_RECV_BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(conn.recv_buf != NULL);
+
+	for (i = 0; i < sizeof(g_sock_data); i++) {
+		g_sock_data[i] = (uint8_t)i;
+	}
+	g_sock_data_len = 48 + 512 + 48 + sizeof(buf) + 48;
+	g_sock_data_offset = 0;
+	g_sock_readv_cnt = 0;
+
+	/* A small read fills the receive buffer with everything available. */
+	rc = spdk_iscsi_conn_read_data(&conn, 48, buf);
+	CU_ASSERT(rc == 48);
+	CU_ASSERT(memcmp(buf, g_sock_data, 48) == 0);
+	CU_ASSERT(g_sock_readv_cnt == 1);
+	CU_ASSERT(conn.recv_buf_len == g_sock_data_len);
+	CU_ASSERT(conn.recv_buf_offset == 48);
+
+	/* Following reads are served from the receive buffer, even across iovecs. */
+	iov[0].iov_base = buf;
+	iov[0].iov_len = 256;
+	iov[1].iov_base = buf + 256;
+	iov[1].iov_len = 256;
+	rc = spdk_iscsi_conn_readv_data(&conn, iov, 2);
+	CU_ASSERT(rc == 512);
+	CU_ASSERT(memcmp(buf, g_sock_data + 48, 512) == 0);
+
+	rc = spdk_iscsi_conn_read_data(&conn, 48, buf);
+	CU_ASSERT(rc == 48);
+	CU_ASSERT(memcmp(buf, g_sock_data + 560, 48) == 0);
+
+	/* A large read returns what is buffered, and the caller reads the rest. */
+	rc = spdk_iscsi_conn_read_data(&conn, sizeof(buf), buf);
+	CU_ASSERT(rc == (int)sizeof(buf));
+	CU_ASSERT(memcmp(buf, g_sock_data + 608, sizeof(buf)) == 0);
+
+	rc = spdk_iscsi_conn_read_data(&conn, 48, buf);
+	CU_ASSERT(rc == 48);
+	CU_ASSERT(memcmp(buf, g_sock_data + 608 + sizeof(buf), 48) == 0);
+	CU_ASSERT(conn.recv_buf_offset == 0);
+	CU_ASSERT(conn.recv_buf_len == 0);
+	CU_ASSERT(g_sock_readv_cnt == 1);
+
+	/* Nothing is available on the socket. */
+	rc = spdk_iscsi_conn_read_data(&conn, 48, buf);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_sock_readv_cnt == 2);
+
+	/*
+	 * A large read with an empty receive buffer goes directly to the destination,
+	 *  and the bytes following it are stored in the receive buffer.
+	 */
+	g_sock_data_len = sizeof(buf) + 48;
+	g_sock_data_offset = 0;
+	rc = spdk_iscsi_conn_read_data(&conn, sizeof(buf), buf);
+	CU_ASSERT(rc == (int)sizeof(buf));
+	CU_ASSERT(memcmp(buf, g_sock_data, sizeof(buf)) == 0);
+	CU_ASSERT(conn.recv_buf_offset == 0);
+	CU_ASSERT(conn.recv_buf_len == 48);
+	CU_ASSERT(memcmp(conn.recv_buf, g_sock_data + sizeof(buf), 48) == 0);
+	CU_ASSERT(g_sock_readv_cnt == 3);
+	CU_ASSERT(conn.recv_cnt == 3);
+
+	free(conn.recv_buf);
+}
+
+static void
+sess_conns_on_different_cores(void)
+{
+	struct spdk_iscsi_portal portal = {};
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn[4] = {};
+	struct spdk_iscsi_conn *conns[3] = {};
+	uint32_t num_connections[UT_NUM_CORES] = { 2, 1, 3, 1 };
+	uint32_t i, lcore;
+	int rc;
+
+	portal.cpumask = spdk_cpuset_alloc();
+	SPDK_CU_ASSERT_FATAL(portal.cpumask != NULL);
+	for (i = 0; i < UT_NUM_CORES; i++) {
+		spdk_cpuset_set_cpu(portal.cpumask, i, true);
+	}
+	g_num_connections = num_connections;
+
+	sess.conns = conns;
+	sess.MaxConnections = 3;
+	sess.conns[0] = &conn[0];
+	sess.connections = 1;
+	for (i = 0; i < 4; i++) {
+		conn[i].portal = &portal;
+	}
+	conn[0].sess = &sess;
+	conn[0].full_feature = 1;
+	conn[0].lcore = 1;
+
+	/* The least loaded core not used by the session is selected. */
+	rc = spdk_iscsi_conn_join_sess(&conn[1], &sess);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[1].sess == &sess);
+	CU_ASSERT(sess.connections == 2);
+	lcore = spdk_iscsi_conn_allocate_sess_reactor(&conn[1]);
+	CU_ASSERT(lcore == 3);
+	conn[1].full_feature = 1;
+	conn[1].lcore = lcore;
+	num_connections[lcore]++;
+
+	rc = spdk_iscsi_conn_join_sess(&conn[2], &sess);
+	CU_ASSERT(rc == 0);
+	lcore = spdk_iscsi_conn_allocate_sess_reactor(&conn[2]);
+	CU_ASSERT(lcore == 0);
+
+	/* No more connections than MaxConnections. */
+	rc = spdk_iscsi_conn_join_sess(&conn[3], &sess);
+	CU_ASSERT(rc == -EMLINK);
+	CU_ASSERT(conn[3].sess == NULL);
+	CU_ASSERT(sess.connections == 3);
+
+	/* All cores of the portal are used by the session. */
+	spdk_cpuset_zero(portal.cpumask);
+	spdk_cpuset_set_cpu(portal.cpumask, 1, true);
+	lcore = spdk_iscsi_conn_allocate_sess_reactor(&conn[2]);
+	CU_ASSERT(lcore == 1);
+
+	/* A session without connections has been freed. */
+	sess.connections = 0;
+	rc = spdk_iscsi_conn_join_sess(&conn[3], &sess);
+	CU_ASSERT(rc == -ENOENT);
+
+	g_num_connections = NULL;
+	spdk_cpuset_free(portal.cpumask);
+}
+
+static void
+held_pdu_dropped_at_teardown(void)
+{
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn = {};
+	struct spdk_iscsi_pdu pdu = {};
+
+	pthread_mutex_init(&sess.mutex, NULL);
+	conn.sess = &sess;
+	conn.state = ISCSI_CONN_STATE_EXITED;
+	conn.held_pdu = &pdu;
+
+	/* The held command is released when the connection exits. */
+	spdk_iscsi_conn_drop_held_pdu(&conn);
+	CU_ASSERT(conn.held_pdu == NULL);
+
+	/* An event scheduled before only drops its reference. */
+	conn.held_pdu_events = 1;
+	_spdk_iscsi_conn_execute_held_pdu(&conn, NULL);
+	CU_ASSERT(conn.held_pdu_events == 0);
+	CU_ASSERT(conn.held_pdu == NULL);
+
+	pthread_mutex_destroy(&sess.mutex);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -353,7 +551,10 @@ main(int argc, char **argv)
 	if (
 		CU_add_test(suite, "read task split in order", read_task_split_in_order_case) == NULL ||
 		CU_add_test(suite, "propagate_scsi_error_status_for_split_read_tasks",
-			    propagate_scsi_error_status_for_split_read_tasks) == NULL
+			    propagate_scsi_error_status_for_split_read_tasks) == NULL ||
+		CU_add_test(suite, "read_data_through_recv_buf", read_data_through_recv_buf) == NULL ||
+		CU_add_test(suite, "sess_conns_on_different_cores", sess_conns_on_different_cores) == NULL ||
+		CU_add_test(suite, "held_pdu_dropped_at_teardown", held_pdu_dropped_at_teardown) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -85,6 +85,9 @@ DEFINE_STUB_V(spdk_iscsi_portal_grp_close_all, (void));
 
 DEFINE_STUB_V(spdk_iscsi_conn_migration, (struct spdk_iscsi_conn *conn));
 
+DEFINE_STUB(spdk_iscsi_conn_join_sess, int,
+	    (struct spdk_iscsi_conn *conn, struct spdk_iscsi_sess *sess), 0);
+
 DEFINE_STUB_V(spdk_iscsi_conn_free_pdu,
 	      (struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu));
 
@@ -1339,6 +1342,327 @@ build_iovs_test(void)
 	free(data);
 }
 
+static void
+direct_write_test(void)
+{
+	struct spdk_iscsi_sess sess;
+	struct spdk_iscsi_conn conn;
+	struct spdk_scsi_dev dev;
+	struct spdk_scsi_lun lun;
+	struct spdk_iscsi_pdu *req_pdu, *data_out_pdu, *r2t_pdu;
+	struct spdk_iscsi_pdu *limited_pdu, *limited_r2t_pdu, limited_data_out_pdu;
+	struct iscsi_bhs_scsi_req *req;
+	struct iscsi_bhs_r2t *r2t;
+	struct iscsi_bhs_data_out *data_out;
+	struct spdk_iscsi_task *task, *subtask, *limited_task;
+	struct spdk_mobj *mobj;
+	uint8_t *write_buf, imm_data[512];
+	int rc;
+
+	memset(&sess, 0, sizeof(sess));
+	memset(&conn, 0, sizeof(conn));
+	memset(&dev, 0, sizeof(dev));
+	memset(&lun, 0, sizeof(lun));
+
+	sess.ExpCmdSN = 0;
+	sess.MaxCmdSN = 64;
+	sess.connections = 1;
+	sess.session_type = SESSION_TYPE_NORMAL;
+	sess.MaxBurstLength = SPDK_ISCSI_MAX_BURST_LENGTH;
+	sess.MaxOutstandingR2T = 1;
+	sess.ImmediateData = true;
+	sess.FirstBurstLength = sizeof(imm_data);
+
+	lun.id = 0;
+	dev.lun[0] = &lun;
+
+	conn.full_feature = 1;
+	conn.sess = &sess;
+	conn.dev = &dev;
+	conn.state = ISCSI_CONN_STATE_RUNNING;
+	TAILQ_INIT(&conn.write_pdu_list);
+	TAILQ_INIT(&conn.active_r2t_tasks);
+	TAILQ_INIT(&conn.queued_r2t_tasks);
+
+	TAILQ_INIT(&g_write_pdu_list);
+	g_queued_scsi_task = NULL;
+	g_spdk_iscsi.max_direct_writes_per_connection = 1;
+
+	mobj = calloc(1, sizeof(*mobj));
+	SPDK_CU_ASSERT_FATAL(mobj != NULL);
+	write_buf = calloc(1, 8192);
+	SPDK_CU_ASSERT_FATAL(write_buf != NULL);
+	mobj->buf = write_buf;
+
+	/* A write of 8K with 512 bytes of immediate data gets a write buffer. */
+	req_pdu = spdk_get_pdu();
+	SPDK_CU_ASSERT_FATAL(req_pdu != NULL);
+	memset(imm_data, 0xa5, sizeof(imm_data));
+	req_pdu->bhs.opcode = ISCSI_OP_SCSI;
+	req_pdu->data = imm_data;
+	req_pdu->data_from_mempool = true;
+	req_pdu->data_segment_len = sizeof(imm_data);
+
+	req = (struct iscsi_bhs_scsi_req *)&req_pdu->bhs;
+	to_be32(&req->cmd_sn, 0);
+	to_be32(&req->expected_data_xfer_len, 8192);
+	to_be32(&req->itt, 0x1234);
+	req->write_bit = 1;
+	req->final_bit = 1;
+
+	MOCK_SET(spdk_mempool_get, mobj);
+	rc = spdk_iscsi_execute(&conn, req_pdu);
+	MOCK_CLEAR(spdk_mempool_get);
+	CU_ASSERT(rc == 0);
+
+	/* Nothing is submitted until all data has been received. */
+	CU_ASSERT(g_queued_scsi_task == NULL);
+	SPDK_CU_ASSERT_FATAL(conn.pending_r2t == 1);
+	task = conn.outstanding_r2t_tasks[0];
+	CU_ASSERT(task->mobj == mobj);
+	CU_ASSERT(conn.direct_write_cnt == 1);
+	CU_ASSERT(memcmp(write_buf, imm_data, sizeof(imm_data)) == 0);
+
+	r2t_pdu = TAILQ_FIRST(&g_write_pdu_list);
+	SPDK_CU_ASSERT_FATAL(r2t_pdu != NULL);
+	TAILQ_REMOVE(&g_write_pdu_list, r2t_pdu, tailq);
+	CU_ASSERT(r2t_pdu->bhs.opcode == ISCSI_OP_R2T);
+	r2t = (struct iscsi_bhs_r2t *)&r2t_pdu->bhs;
+	CU_ASSERT(from_be32(&r2t->buffer_offset) == 512);
+	CU_ASSERT(from_be32(&r2t->desired_xfer_len) == 7680);
+
+	/*
+	 * Once the connection has used its share of write buffers, writes use data
+	 *  out buffers, even if the pool has more.
+	 */
+	limited_pdu = spdk_get_pdu();
+	SPDK_CU_ASSERT_FATAL(limited_pdu != NULL);
+	limited_pdu->bhs.opcode = ISCSI_OP_SCSI;
+	limited_pdu->data = imm_data;
+	limited_pdu->data_from_mempool = true;
+	limited_pdu->data_segment_len = sizeof(imm_data);
+
+	req = (struct iscsi_bhs_scsi_req *)&limited_pdu->bhs;
+	to_be32(&req->cmd_sn, 1);
+	to_be32(&req->expected_data_xfer_len, 8192);
+	to_be32(&req->itt, 0x1235);
+	req->write_bit = 1;
+	req->final_bit = 1;
+
+	MOCK_SET(spdk_mempool_get, mobj);
+	rc = spdk_iscsi_execute(&conn, limited_pdu);
+	MOCK_CLEAR(spdk_mempool_get);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn.direct_write_cnt == 1);
+	SPDK_CU_ASSERT_FATAL(conn.pending_r2t == 2);
+	limited_task = conn.outstanding_r2t_tasks[1];
+	CU_ASSERT(limited_task->mobj == NULL);
+
+	/* Its immediate data is submitted right away. */
+	CU_ASSERT(g_queued_scsi_task == &limited_task->scsi);
+	CU_ASSERT(limited_task->scsi.length == sizeof(imm_data));
+	g_queued_scsi_task = NULL;
+
+	/* Its Data-Out PDUs are not received into a write buffer. */
+	limited_r2t_pdu = TAILQ_FIRST(&g_write_pdu_list);
+	SPDK_CU_ASSERT_FATAL(limited_r2t_pdu != NULL);
+	TAILQ_REMOVE(&g_write_pdu_list, limited_r2t_pdu, tailq);
+	memset(&limited_data_out_pdu, 0, sizeof(limited_data_out_pdu));
+	limited_data_out_pdu.bhs.opcode = ISCSI_OP_SCSI_DATAOUT;
+	data_out = (struct iscsi_bhs_data_out *)&limited_data_out_pdu.bhs;
+	data_out->ttt = ((struct iscsi_bhs_r2t *)&limited_r2t_pdu->bhs)->ttt;
+	to_be32(&data_out->buffer_offset, 512);
+	spdk_iscsi_pdu_set_write_buf(&conn, &limited_data_out_pdu, 7680);
+	CU_ASSERT(limited_data_out_pdu.write_task == NULL);
+	CU_ASSERT(limited_data_out_pdu.data_buf == NULL);
+
+	/* The Data-Out PDU is received directly into the write buffer. */
+	data_out_pdu = spdk_get_pdu();
+	SPDK_CU_ASSERT_FATAL(data_out_pdu != NULL);
+	data_out_pdu->bhs.opcode = ISCSI_OP_SCSI_DATAOUT;
+	data_out_pdu->bhs.flags = ISCSI_FLAG_FINAL;
+	data_out_pdu->data_segment_len = 7680;
+	data_out = (struct iscsi_bhs_data_out *)&data_out_pdu->bhs;
+	data_out->itt = r2t->itt;
+	data_out->ttt = r2t->ttt;
+	to_be32(&data_out->buffer_offset, 512);
+	DSET24(data_out->data_segment_len, 7680);
+
+	spdk_iscsi_pdu_set_write_buf(&conn, data_out_pdu, 7680);
+	CU_ASSERT(data_out_pdu->write_task == task);
+	CU_ASSERT(data_out_pdu->data_buf == write_buf + 512);
+	memset(data_out_pdu->data_buf, 0x5a, 7680);
+	data_out_pdu->data = data_out_pdu->data_buf;
+	data_out_pdu->data_from_mempool = true;
+
+	/* The whole write is submitted as a single task. */
+	rc = spdk_iscsi_execute(&conn, data_out_pdu);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_queued_scsi_task != NULL);
+	subtask = spdk_iscsi_task_from_scsi_task(g_queued_scsi_task);
+	CU_ASSERT(subtask->scsi.offset == 0);
+	CU_ASSERT(subtask->scsi.length == 8192);
+	CU_ASSERT(subtask->scsi.iovs[0].iov_base == write_buf);
+	CU_ASSERT(subtask->scsi.iovs[0].iov_len == 8192);
+	CU_ASSERT(write_buf[511] == 0xa5);
+	CU_ASSERT(write_buf[512] == 0x5a);
+
+	spdk_iscsi_task_disassociate_pdu(subtask);
+	spdk_iscsi_task_put(subtask);
+	TAILQ_REMOVE(&conn.active_r2t_tasks, task, link);
+	spdk_iscsi_task_disassociate_pdu(task);
+	spdk_iscsi_task_put(task);
+	TAILQ_REMOVE(&conn.active_r2t_tasks, limited_task, link);
+	spdk_iscsi_task_disassociate_pdu(limited_task);
+	spdk_iscsi_task_put(limited_task);
+	spdk_put_pdu(r2t_pdu);
+	spdk_put_pdu(limited_r2t_pdu);
+	spdk_put_pdu(data_out_pdu);
+	spdk_put_pdu(req_pdu);
+	spdk_put_pdu(limited_pdu);
+	free(mobj);
+	free(write_buf);
+	g_queued_scsi_task = NULL;
+	g_spdk_iscsi.max_direct_writes_per_connection = 0;
+}
+
+static struct spdk_iscsi_pdu *
+ut_nopout_pdu(uint32_t cmd_sn)
+{
+	struct spdk_iscsi_pdu *pdu;
+	struct iscsi_bhs_nop_out *reqh;
+
+	pdu = spdk_get_pdu();
+	SPDK_CU_ASSERT_FATAL(pdu != NULL);
+
+	pdu->bhs.opcode = ISCSI_OP_NOPOUT;
+	reqh = (struct iscsi_bhs_nop_out *)&pdu->bhs;
+	to_be32(&reqh->itt, cmd_sn);
+	to_be32(&reqh->ttt, 0xffffffff);
+	to_be32(&reqh->cmd_sn, cmd_sn);
+
+	return pdu;
+}
+
+static void
+cmdsn_window_test(void)
+{
+	struct spdk_iscsi_sess sess;
+	struct spdk_iscsi_conn conn[3];
+	struct spdk_iscsi_conn *conns[3] = { &conn[0], &conn[1], &conn[2] };
+	struct spdk_iscsi_pdu *pdu1, *pdu2, *pdu3, *rsp_pdu;
+	int i, rc;
+
+	memset(&sess, 0, sizeof(sess));
+	pthread_mutex_init(&sess.mutex, NULL);
+	sess.session_type = SESSION_TYPE_NORMAL;
+	sess.ErrorRecoveryLevel = 0;
+	sess.ExpCmdSN = 10;
+	sess.MaxCmdSN = 73;
+	sess.conns = conns;
+	sess.connections = 3;
+
+	for (i = 0; i < 3; i++) {
+		memset(&conn[i], 0, sizeof(conn[i]));
+		conn[i].full_feature = 1;
+		conn[i].sess = &sess;
+		conn[i].state = ISCSI_CONN_STATE_RUNNING;
+	}
+
+	TAILQ_INIT(&g_write_pdu_list);
+	g_held_pdu_conn = NULL;
+
+	/* CmdSN 12 and 11 arrive first, on other connections. Both are held. */
+	pdu3 = ut_nopout_pdu(12);
+	rc = spdk_iscsi_execute(&conn[2], pdu3);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[2].held_pdu == pdu3);
+	spdk_put_pdu(pdu3);
+
+	pdu2 = ut_nopout_pdu(11);
+	rc = spdk_iscsi_execute(&conn[1], pdu2);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[1].held_pdu == pdu2);
+	spdk_put_pdu(pdu2);
+
+	CU_ASSERT(sess.ExpCmdSN == 10);
+	CU_ASSERT(TAILQ_EMPTY(&g_write_pdu_list));
+	CU_ASSERT(g_held_pdu_conn == NULL);
+
+	/* CmdSN 10 is executed and the connection holding CmdSN 11 is scheduled. */
+	pdu1 = ut_nopout_pdu(10);
+	rc = spdk_iscsi_execute(&conn[0], pdu1);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[0].held_pdu == NULL);
+	CU_ASSERT(sess.ExpCmdSN == 11);
+	CU_ASSERT(g_held_pdu_conn == &conn[1]);
+	CU_ASSERT(conn[1].held_pdu_events == 1);
+	spdk_put_pdu(pdu1);
+
+	/* The held commands run in CmdSN order, each scheduling the next one. */
+	g_held_pdu_conn = NULL;
+	conn[1].held_pdu = NULL;
+	conn[1].held_pdu_events = 0;
+	rc = spdk_iscsi_execute(&conn[1], pdu2);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(sess.ExpCmdSN == 12);
+	CU_ASSERT(g_held_pdu_conn == &conn[2]);
+	CU_ASSERT(conn[2].held_pdu_events == 1);
+	spdk_put_pdu(pdu2);
+
+	g_held_pdu_conn = NULL;
+	conn[2].held_pdu = NULL;
+	conn[2].held_pdu_events = 0;
+	rc = spdk_iscsi_execute(&conn[2], pdu3);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(sess.ExpCmdSN == 13);
+	CU_ASSERT(g_held_pdu_conn == NULL);
+	spdk_put_pdu(pdu3);
+
+	/* A CmdSN before the window is still fatal at ERL 0. */
+	pdu1 = ut_nopout_pdu(12);
+	rc = spdk_iscsi_execute(&conn[0], pdu1);
+	CU_ASSERT(rc == SPDK_PDU_FATAL);
+	CU_ASSERT(sess.ExpCmdSN == 13);
+	spdk_put_pdu(pdu1);
+
+	/* With a single connection, commands are executed as they arrive. */
+	sess.connections = 1;
+	pdu1 = ut_nopout_pdu(13);
+	rc = spdk_iscsi_execute(&conn[0], pdu1);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[0].held_pdu == NULL);
+	CU_ASSERT(sess.ExpCmdSN == 14);
+	spdk_put_pdu(pdu1);
+
+	/* A CmdSN gap can't be filled by another connection, so it is rejected. */
+	pdu1 = ut_nopout_pdu(16);
+	rc = spdk_iscsi_execute(&conn[0], pdu1);
+	CU_ASSERT(rc == SPDK_ISCSI_CONNECTION_FATAL);
+	CU_ASSERT(conn[0].held_pdu == NULL);
+	CU_ASSERT(sess.ExpCmdSN == 14);
+
+	/* At ERL 1, the command is executed anyway. */
+	sess.ErrorRecoveryLevel = 1;
+	rc = spdk_iscsi_execute(&conn[0], pdu1);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(conn[0].held_pdu == NULL);
+	CU_ASSERT(sess.ExpCmdSN == 15);
+	spdk_put_pdu(pdu1);
+
+	/* One NOP-In was sent for each NOP-Out executed. */
+	for (i = 0; i < 5; i++) {
+		rsp_pdu = TAILQ_FIRST(&g_write_pdu_list);
+		SPDK_CU_ASSERT_FATAL(rsp_pdu != NULL);
+		CU_ASSERT(rsp_pdu->bhs.opcode == ISCSI_OP_NOPIN);
+		TAILQ_REMOVE(&g_write_pdu_list, rsp_pdu, tailq);
+		spdk_put_pdu(rsp_pdu);
+	}
+	CU_ASSERT(TAILQ_EMPTY(&g_write_pdu_list));
+
+	pthread_mutex_destroy(&sess.mutex);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1349,7 +1673,11 @@ main(int argc, char **argv)
 		return CU_get_error();
 	}
 
-	suite = CU_add_suite("iscsi_suite", NULL, NULL);
+	/* Writes use data out buffers, unless a test provides a write buffer. */
+	g_spdk_iscsi.write_data_pool = spdk_mempool_create("write_data", 0, 0, 0,
+				       SPDK_ENV_SOCKET_ID_ANY);
+
+		suite = CU_add_suite("iscsi_suite", NULL, NULL);
 	if (suite == NULL) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -1376,6 +1704,8 @@ main(int argc, char **argv)
 		|| CU_add_test(suite, "abort_queued_datain_tasks_test",
 			       abort_queued_datain_tasks_test) == NULL
 		|| CU_add_test(suite, "build_iovs_test", build_iovs_test) == NULL
+		|| CU_add_test(suite, "direct_write_test", direct_write_test) == NULL
+		|| CU_add_test(suite, "cmdsn_window_test", cmdsn_window_test) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
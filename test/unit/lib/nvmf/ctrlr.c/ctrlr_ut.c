@@ -105,6 +105,11 @@ DEFINE_STUB(spdk_nvmf_qpair_get_listen_trid,
 	    (struct spdk_nvmf_qpair *qpair, struct spdk_nvme_transport_id *trid),
 	    0);
 
+DEFINE_STUB(spdk_nvmf_subsystem_find_listener,
+	    struct spdk_nvmf_listener *,
+	    (struct spdk_nvmf_subsystem *subsystem, const struct spdk_nvme_transport_id *trid),
+	    NULL);
+
 DEFINE_STUB(spdk_nvmf_subsystem_listener_allowed,
 	    bool,
 	    (struct spdk_nvmf_subsystem *subsystem, struct spdk_nvme_transport_id *trid),
@@ -819,6 +824,110 @@ test_identify_ns(void)
 	CU_ASSERT(spdk_mem_all_zero(&nsdata, sizeof(nsdata)));
 }
 
+static void
+test_ana(void)
+{
+	struct spdk_nvmf_subsystem subsystem = {};
+	struct spdk_nvmf_transport transport = {};
+	struct spdk_nvmf_qpair admin_qpair = { .transport = &transport};
+	struct spdk_nvmf_listener listener = {};
+	struct spdk_nvmf_ctrlr ctrlr = { .subsys = &subsystem, .admin_qpair = &admin_qpair };
+	struct spdk_nvmf_request req = {};
+	union nvmf_h2c_msg cmd = {};
+	union nvmf_c2h_msg rsp = {};
+	struct spdk_nvme_ctrlr_data cdata = {};
+	struct spdk_nvme_ns_data nsdata = {};
+	struct spdk_bdev bdev = { .blockcnt = 1234 };
+	struct spdk_nvmf_ns ns = { .bdev = &bdev, .opts.nsid = 1 };
+	struct spdk_nvmf_ns *ns_arr[1] = { &ns };
+	enum spdk_nvme_ana_state ana_state[1] = { SPDK_NVME_ANA_INACCESSIBLE_STATE };
+	struct spdk_nvme_ana_page *ana_hdr;
+	struct spdk_nvme_ana_group_descriptor *ana_desc;
+	uint64_t data[512] = {};
+
+	transport.opts.max_io_size = 4096;
+	subsystem.subtype = SPDK_NVMF_SUBTYPE_NVME;
+	subsystem.ns = ns_arr;
+	subsystem.max_nsid = SPDK_COUNTOF(ns_arr);
+	subsystem.ana_reporting = true;
+	listener.ana_state = ana_state;
+	listener.ana_state_count = SPDK_COUNTOF(ana_state);
+	listener.ana_change_count = 3;
+	ctrlr.listener = &listener;
+	ctrlr.feat.async_event_configuration.bits.ana_change_notice = 1;
+
+	/* Identify Controller reports ANA capabilities */
+	MOCK_SET(spdk_nvmf_subsystem_get_sn, "SN");
+	spdk_nvmf_ctrlr_identify_ctrlr(&ctrlr, &cdata);
+	MOCK_CLEAR(spdk_nvmf_subsystem_get_sn);
+	CU_ASSERT(cdata.cmic.ana_reporting == 1);
+	CU_ASSERT(cdata.oaes.ana_change_notices == 1);
+	CU_ASSERT(cdata.anagrpmax == 1);
+	CU_ASSERT(cdata.nanagrpid == 1);
+
+	/* Identify Namespace reports ANA group ID equal to NSID */
+	cmd.nvme_cmd.nsid = 1;
+	spdk_nvmf_ctrlr_identify_ns(&ctrlr, &cmd.nvme_cmd, &rsp.nvme_cpl, &nsdata);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_SUCCESS);
+	CU_ASSERT(nsdata.anagrpid == 1);
+
+	/* ANA log page */
+	admin_qpair.ctrlr = &ctrlr;
+	req.qpair = &admin_qpair;
+	req.cmd = &cmd;
+	req.rsp = &rsp;
+	req.data = data;
+	req.length = sizeof(data);
+
+	MOCK_SET(spdk_nvmf_subsystem_get_first_ns, &ns);
+	memset(&cmd, 0, sizeof(cmd));
+	memset(&rsp, 0, sizeof(rsp));
+	cmd.nvme_cmd.opc = SPDK_NVME_OPC_GET_LOG_PAGE;
+	cmd.nvme_cmd.cdw10 = SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS | (req.length / 4 - 1) << 16;
+	CU_ASSERT(spdk_nvmf_ctrlr_get_log_page(&req) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_SUCCESS);
+	ana_hdr = (struct spdk_nvme_ana_page *)data;
+	CU_ASSERT(ana_hdr->change_count == 3);
+	CU_ASSERT(ana_hdr->num_ana_group_desc == 1);
+	ana_desc = (struct spdk_nvme_ana_group_descriptor *)(ana_hdr + 1);
+	CU_ASSERT(ana_desc->ana_group_id == 1);
+	CU_ASSERT(ana_desc->num_of_nsid == 1);
+	CU_ASSERT(ana_desc->ana_state == SPDK_NVME_ANA_INACCESSIBLE_STATE);
+	CU_ASSERT(ana_desc->nsid[0] == 1);
+
+	/* Failure to allocate the log page is reported */
+	memset(&rsp, 0, sizeof(rsp));
+	MOCK_SET(calloc, NULL);
+	CU_ASSERT(spdk_nvmf_ctrlr_get_log_page(&req) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	MOCK_CLEAR(calloc);
+	CU_ASSERT(rsp.nvme_cpl.status.sct == SPDK_NVME_SCT_GENERIC);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_INTERNAL_DEVICE_ERROR);
+	MOCK_SET(spdk_nvmf_subsystem_get_first_ns, NULL);
+
+	/* I/O to an inaccessible namespace fails with a path error */
+	memset(&cmd, 0, sizeof(cmd));
+	memset(&rsp, 0, sizeof(rsp));
+	ctrlr.vcprop.cc.bits.en = 1;
+	cmd.nvme_cmd.opc = SPDK_NVME_OPC_READ;
+	cmd.nvme_cmd.nsid = 1;
+	CU_ASSERT(spdk_nvmf_ctrlr_process_io_cmd(&req) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(rsp.nvme_cpl.status.sct == SPDK_NVME_SCT_PATH);
+	CU_ASSERT(rsp.nvme_cpl.status.sc == SPDK_NVME_SC_ASYMMETRIC_ACCESS_INACCESSIBLE);
+
+	/* ANA change without an outstanding AER is delivered with the next AER */
+	CU_ASSERT(spdk_nvmf_ctrlr_async_event_ana_change_notice(&ctrlr) == 0);
+	CU_ASSERT(ctrlr.ana_change_pending == true);
+	memset(&cmd, 0, sizeof(cmd));
+	memset(&rsp, 0, sizeof(rsp));
+	cmd.nvme_cmd.opc = SPDK_NVME_OPC_ASYNC_EVENT_REQUEST;
+	CU_ASSERT(spdk_nvmf_ctrlr_async_event_request(&req) == SPDK_NVMF_REQUEST_EXEC_STATUS_COMPLETE);
+	CU_ASSERT(ctrlr.ana_change_pending == false);
+	CU_ASSERT(ctrlr.aer_req == NULL);
+	CU_ASSERT((rsp.nvme_cpl.cdw0 & 0x7) == SPDK_NVME_ASYNC_EVENT_TYPE_NOTICE);
+	CU_ASSERT(((rsp.nvme_cpl.cdw0 >> 8) & 0xFF) == SPDK_NVME_ASYNC_EVENT_ANA_CHANGE);
+	CU_ASSERT(((rsp.nvme_cpl.cdw0 >> 16) & 0xFF) == SPDK_NVME_LOG_ASYMMETRIC_NAMESPACE_ACCESS);
+}
+
 int main(int argc, char **argv)
 {
 	CU_pSuite	suite = NULL;
@@ -839,7 +948,8 @@ int main(int argc, char **argv)
 		CU_add_test(suite, "process_fabrics_cmd", test_process_fabrics_cmd) == NULL ||
 		CU_add_test(suite, "connect", test_connect) == NULL ||
 		CU_add_test(suite, "get_ns_id_desc_list", test_get_ns_id_desc_list) == NULL ||
-		CU_add_test(suite, "identify_ns", test_identify_ns) == NULL
+		CU_add_test(suite, "identify_ns", test_identify_ns) == NULL ||
+		CU_add_test(suite, "ana", test_ana) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -52,6 +52,7 @@
 #define UT_MAX_AQ_DEPTH 64
 #define UT_SQ_HEAD_MAX 128
 #define UT_NUM_SHARED_BUFFERS 128
+#define UT_MAX_REQS 1024
 
 SPDK_LOG_REGISTER_COMPONENT("nvmf", SPDK_LOG_NVMF)
 SPDK_LOG_REGISTER_COMPONENT("nvme", SPDK_LOG_NVME)
@@ -76,6 +77,11 @@ DEFINE_STUB(spdk_nvmf_tgt_find_subsystem,
 	    (struct spdk_nvmf_tgt *tgt, const char *subnqn),
 	    NULL);
 
+DEFINE_STUB(spdk_nvmf_subsystem_find_listener,
+	    struct spdk_nvmf_listener *,
+	    (struct spdk_nvmf_subsystem *subsystem, const struct spdk_nvme_transport_id *trid),
+	    NULL);
+
 DEFINE_STUB(spdk_nvmf_subsystem_listener_allowed,
 	    bool,
 	    (struct spdk_nvmf_subsystem *subsystem, struct spdk_nvme_transport_id *trid),
@@ -160,6 +166,10 @@ DEFINE_STUB(spdk_nvmf_transport_req_complete,
 
 DEFINE_STUB_V(spdk_nvmf_ns_reservation_request, (void *ctx));
 
+DEFINE_STUB(spdk_env_get_current_core, uint32_t, (void), 0);
+
+DEFINE_STUB(spdk_env_get_socket_id, uint32_t, (uint32_t core), 0);
+
 struct spdk_trace_histories *g_trace_histories;
 
 struct spdk_bdev {
@@ -246,6 +256,7 @@ test_nvmf_tcp_create(void)
 	opts.io_unit_size = UT_IO_UNIT_SIZE;
 	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
 	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.max_reqs = UT_MAX_REQS;
 	/* expect success */
 	transport = spdk_nvmf_tcp_create(&opts);
 	CU_ASSERT_PTR_NOT_NULL(transport);
@@ -258,7 +269,7 @@ test_nvmf_tcp_create(void)
 	CU_ASSERT(transport->opts.io_unit_size == UT_IO_UNIT_SIZE);
 	/* destroy transport */
 	spdk_mempool_free(ttransport->transport.data_buf_pool);
-	free(ttransport);
+	spdk_nvmf_tcp_destroy(transport);
 
 	/* case 2 */
 	memset(&opts, 0, sizeof(opts));
@@ -269,6 +280,7 @@ test_nvmf_tcp_create(void)
 	opts.io_unit_size = UT_MAX_IO_SIZE + 1;
 	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
 	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.max_reqs = UT_MAX_REQS;
 	/* expect success */
 	transport = spdk_nvmf_tcp_create(&opts);
 	CU_ASSERT_PTR_NOT_NULL(transport);
@@ -281,7 +293,7 @@ test_nvmf_tcp_create(void)
 	CU_ASSERT(transport->opts.io_unit_size == UT_MAX_IO_SIZE);
 	/* destroy transport */
 	spdk_mempool_free(ttransport->transport.data_buf_pool);
-	free(ttransport);
+	spdk_nvmf_tcp_destroy(transport);
 
 	/* case 3 */
 	memset(&opts, 0, sizeof(opts));
@@ -295,6 +307,20 @@ test_nvmf_tcp_create(void)
 	transport = spdk_nvmf_tcp_create(&opts);
 	CU_ASSERT_PTR_NULL(transport);
 
+	/* case 4: fewer requests than a single queue needs */
+	memset(&opts, 0, sizeof(opts));
+	opts.max_queue_depth = UT_MAX_QUEUE_DEPTH;
+	opts.max_qpairs_per_ctrlr = UT_MAX_QPAIRS_PER_CTRLR;
+	opts.in_capsule_data_size = UT_IN_CAPSULE_DATA_SIZE;
+	opts.max_io_size = UT_MAX_IO_SIZE;
+	opts.io_unit_size = UT_IO_UNIT_SIZE;
+	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
+	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.max_reqs = UT_MAX_QUEUE_DEPTH - 1;
+	/* expect fail */
+	transport = spdk_nvmf_tcp_create(&opts);
+	CU_ASSERT_PTR_NULL(transport);
+
 	spdk_thread_exit(thread);
 }
 
@@ -318,6 +344,7 @@ test_nvmf_tcp_destroy(void)
 	opts.io_unit_size = UT_IO_UNIT_SIZE;
 	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
 	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.max_reqs = UT_MAX_REQS;
 	transport = spdk_nvmf_tcp_create(&opts);
 	CU_ASSERT_PTR_NOT_NULL(transport);
 	transport->opts = opts;
@@ -347,6 +374,7 @@ test_nvmf_tcp_poll_group_create(void)
 	opts.io_unit_size = UT_IO_UNIT_SIZE;
 	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
 	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.max_reqs = UT_MAX_REQS;
 	transport = spdk_nvmf_tcp_create(&opts);
 	CU_ASSERT_PTR_NOT_NULL(transport);
 	transport->opts = opts;
@@ -116,15 +116,18 @@ spdk_bdev_get_by_name(const char *bdev_name)
 DEFINE_STUB_V(spdk_scsi_lun_append_mgmt_task,
 	      (struct spdk_scsi_lun *lun, struct spdk_scsi_task *task));
 
-DEFINE_STUB_V(spdk_scsi_lun_execute_mgmt_task, (struct spdk_scsi_lun *lun));
+DEFINE_STUB_V(spdk_scsi_lun_execute_mgmt_task, (struct spdk_scsi_lun_channel *ch));
 
 DEFINE_STUB(spdk_scsi_lun_has_pending_mgmt_tasks, bool,
-	    (const struct spdk_scsi_lun *lun), false);
+	    (struct spdk_scsi_lun *lun), false);
 
 DEFINE_STUB_V(spdk_scsi_lun_append_task,
 	      (struct spdk_scsi_lun *lun, struct spdk_scsi_task *task));
 
-DEFINE_STUB_V(spdk_scsi_lun_execute_tasks, (struct spdk_scsi_lun *lun));
+DEFINE_STUB_V(spdk_scsi_lun_execute_tasks, (struct spdk_scsi_lun_channel *ch));
+
+DEFINE_STUB(spdk_scsi_task_get_lun_channel, struct spdk_scsi_lun_channel *,
+	    (struct spdk_scsi_task *task), NULL);
 
 DEFINE_STUB(_spdk_scsi_lun_allocate_io_channel, int,
 	    (struct spdk_scsi_lun *lun), 0);
@@ -132,7 +135,7 @@ DEFINE_STUB(_spdk_scsi_lun_allocate_io_channel, int,
 DEFINE_STUB_V(_spdk_scsi_lun_free_io_channel, (struct spdk_scsi_lun *lun));
 
 DEFINE_STUB(spdk_scsi_lun_has_pending_tasks, bool,
-	    (const struct spdk_scsi_lun *lun), false);
+	    (struct spdk_scsi_lun *lun), false);
 
 static void
 dev_destruct_null_dev(void)
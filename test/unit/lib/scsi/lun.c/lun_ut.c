@@ -39,8 +39,8 @@
 #include "scsi/lun.c"
 
 #include "spdk_internal/mock.h"
-/* These unit tests aren't multithreads, but we need to allocate threads since
- * the lun.c code will register pollers.
+/* Threads are needed since the lun.c code registers pollers and allocates
+ * an I/O channel per thread.
  */
 #include "common/lib/ut_multithread.c"
 
@@ -111,6 +111,8 @@ DEFINE_STUB_V(spdk_scsi_dev_queue_mgmt_task,
 DEFINE_STUB_V(spdk_scsi_dev_delete_lun,
 	      (struct spdk_scsi_dev *dev, struct spdk_scsi_lun *lun));
 
+DEFINE_STUB_V(spdk_bdev_scsi_caw_cleanup, (struct spdk_scsi_lun *lun));
+
 void
 spdk_bdev_scsi_reset(struct spdk_scsi_task *task)
 {
@@ -138,18 +140,39 @@ spdk_bdev_scsi_execute(struct spdk_scsi_task *task)
 	}
 }
 
-DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *,
-	    (struct spdk_bdev_desc *desc), NULL);
+static int g_ut_bdev_io_device;
+
+static int
+ut_bdev_channel_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_bdev_channel_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(&g_ut_bdev_io_device);
+}
 
 static _spdk_scsi_lun *
 lun_construct(void)
 {
 	struct spdk_scsi_lun		*lun;
 	struct spdk_bdev		bdev;
+	int				rc;
 
 	lun = spdk_scsi_lun_construct(&bdev, NULL, NULL);
 
 	SPDK_CU_ASSERT_FATAL(lun != NULL);
+
+	rc = _spdk_scsi_lun_allocate_io_channel(lun);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
 	return lun;
 }
 
@@ -157,9 +180,14 @@ static void
 lun_destruct(struct spdk_scsi_lun *lun)
 {
 	/* LUN will defer its removal if there are any unfinished tasks */
-	SPDK_CU_ASSERT_FATAL(TAILQ_EMPTY(&lun->tasks));
+	SPDK_CU_ASSERT_FATAL(!spdk_scsi_lun_has_pending_tasks(lun));
+
+	_spdk_scsi_lun_free_io_channel(lun);
+	SPDK_CU_ASSERT_FATAL(TAILQ_EMPTY(&lun->channels));
 
 	spdk_scsi_lun_destruct(lun);
+
+	poll_threads();
 }
 
 static void
@@ -180,19 +208,19 @@ lun_task_mgmt_execute_abort_task_not_supported(void)
 	mgmt_task.initiator_port = &initiator_port;
 	mgmt_task.function = SPDK_SCSI_TASK_FUNC_ABORT_TASK;
 
-	/* Params to add regular task to the lun->tasks */
+	/* Params to add regular task to the LUN */
 	ut_init_task(&task);
 	task.lun = lun;
 	task.cdb = cdb;
 
 	spdk_scsi_lun_append_task(lun, &task);
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
 	/* task should now be on the tasks list */
-	CU_ASSERT(!TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks != 0);
 
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	/* task abort is not supported */
 	CU_ASSERT(mgmt_task.response == SPDK_SCSI_TASK_MGMT_RESP_REJECT_FUNC_NOT_SUPPORTED);
@@ -224,20 +252,20 @@ lun_task_mgmt_execute_abort_task_all_not_supported(void)
 	mgmt_task.initiator_port = &initiator_port;
 	mgmt_task.function = SPDK_SCSI_TASK_FUNC_ABORT_TASK_SET;
 
-	/* Params to add regular task to the lun->tasks */
+	/* Params to add regular task to the LUN */
 	ut_init_task(&task);
 	task.initiator_port = &initiator_port;
 	task.lun = lun;
 	task.cdb = cdb;
 
 	spdk_scsi_lun_append_task(lun, &task);
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
 	/* task should now be on the tasks list */
-	CU_ASSERT(!TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks != 0);
 
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	/* task abort is not supported */
 	CU_ASSERT(mgmt_task.response == SPDK_SCSI_TASK_MGMT_RESP_REJECT_FUNC_NOT_SUPPORTED);
@@ -267,7 +295,7 @@ lun_task_mgmt_execute_lun_reset(void)
 	mgmt_task.function = SPDK_SCSI_TASK_FUNC_LUN_RESET;
 
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	/* Returns success */
 	CU_ASSERT_EQUAL(mgmt_task.status, SPDK_SCSI_STATUS_GOOD);
@@ -289,11 +317,12 @@ lun_task_mgmt_execute_invalid_case(void)
 	lun->dev = &dev;
 
 	ut_init_task(&mgmt_task);
+	mgmt_task.lun = lun;
 	mgmt_task.function = 5;
 
 	/* Pass an invalid value to the switch statement */
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	/* function code is invalid */
 	CU_ASSERT_EQUAL(mgmt_task.response, SPDK_SCSI_TASK_MGMT_RESP_REJECT_FUNC_NOT_SUPPORTED);
@@ -393,13 +422,13 @@ lun_execute_scsi_task_pending(void)
 	/* the tasks list should still be empty since it has not been
 	   executed yet
 	 */
-	CU_ASSERT(TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks == 0);
 
 	spdk_scsi_lun_append_task(lun, &task);
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
 	/* Assert the task has been successfully added to the tasks queue */
-	CU_ASSERT(!TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks != 0);
 
 	/* task is still on the tasks list */
 	CU_ASSERT_EQUAL(g_task_count, 1);
@@ -431,13 +460,13 @@ lun_execute_scsi_task_complete(void)
 	/* the tasks list should still be empty since it has not been
 	   executed yet
 	 */
-	CU_ASSERT(TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks == 0);
 
 	spdk_scsi_lun_append_task(lun, &task);
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
 	/* Assert the task has not been added to the tasks queue */
-	CU_ASSERT(TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks == 0);
 
 	lun_destruct(lun);
 
@@ -451,7 +480,9 @@ lun_destruct_success(void)
 
 	lun = lun_construct();
 
+	_spdk_scsi_lun_free_io_channel(lun);
 	spdk_scsi_lun_destruct(lun);
+	poll_threads();
 
 	CU_ASSERT_EQUAL(g_task_count, 0);
 }
@@ -485,6 +516,7 @@ lun_reset_task_wait_scsi_task_complete(void)
 	struct spdk_scsi_task task = { 0 };
 	struct spdk_scsi_task mgmt_task = { 0 };
 	struct spdk_scsi_dev dev = { 0 };
+	struct spdk_scsi_lun_channel *ch;
 
 	lun = lun_construct();
 	lun->dev = &dev;
@@ -499,24 +531,27 @@ lun_reset_task_wait_scsi_task_complete(void)
 	mgmt_task.lun = lun;
 	mgmt_task.function = SPDK_SCSI_TASK_FUNC_LUN_RESET;
 
+	ch = TAILQ_FIRST(&lun->channels);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
 	/* Append a task to the pending task list. */
 	spdk_scsi_lun_append_task(lun, &task);
 
-	CU_ASSERT(!TAILQ_EMPTY(&lun->pending_tasks));
+	CU_ASSERT(!TAILQ_EMPTY(&ch->pending_tasks));
 
 	/* Execute the task but it is still in the task list. */
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
-	CU_ASSERT(TAILQ_EMPTY(&lun->pending_tasks));
-	CU_ASSERT(!TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(TAILQ_EMPTY(&ch->pending_tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks != 0);
 
 	/* Append a reset task to the pending mgmt task list. */
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
 
-	CU_ASSERT(!TAILQ_EMPTY(&lun->pending_mgmt_tasks));
+	CU_ASSERT(!TAILQ_EMPTY(&ch->pending_mgmt_tasks));
 
 	/* Execute the reset task */
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	/* The reset task should be still on the submitted mgmt task list and
 	 * a poller is created because the task prior to the reset task is pending.
@@ -533,7 +568,7 @@ lun_reset_task_wait_scsi_task_complete(void)
 	/* Complete the task. */
 	spdk_scsi_lun_complete_task(lun, &task);
 
-	CU_ASSERT(TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks == 0);
 
 	/* Execute the poller to check if the task prior to the reset task complete. */
 	spdk_scsi_lun_reset_check_outstanding_tasks(&mgmt_task);
@@ -555,6 +590,7 @@ lun_reset_task_suspend_scsi_task(void)
 	struct spdk_scsi_task task = { 0 };
 	struct spdk_scsi_task mgmt_task = { 0 };
 	struct spdk_scsi_dev dev = { 0 };
+	struct spdk_scsi_lun_channel *ch;
 
 	lun = lun_construct();
 	lun->dev = &dev;
@@ -569,31 +605,137 @@ lun_reset_task_suspend_scsi_task(void)
 	mgmt_task.lun = lun;
 	mgmt_task.function = SPDK_SCSI_TASK_FUNC_LUN_RESET;
 
+	ch = TAILQ_FIRST(&lun->channels);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
 	/* Append a reset task to the pending mgmt task list. */
 	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
 
-	CU_ASSERT(!TAILQ_EMPTY(&lun->pending_mgmt_tasks));
+	CU_ASSERT(!TAILQ_EMPTY(&ch->pending_mgmt_tasks));
 
 	/* Append a task to the pending task list. */
 	spdk_scsi_lun_append_task(lun, &task);
 
-	CU_ASSERT(!TAILQ_EMPTY(&lun->pending_tasks));
+	CU_ASSERT(!TAILQ_EMPTY(&ch->pending_tasks));
 
 	/* Execute the task but it is still on the pending task list. */
-	spdk_scsi_lun_execute_tasks(lun);
+	spdk_scsi_lun_execute_tasks(lun->dev_ch);
 
-	CU_ASSERT(!TAILQ_EMPTY(&lun->pending_tasks));
+	CU_ASSERT(!TAILQ_EMPTY(&ch->pending_tasks));
 
 	/* Execute the reset task. The task will be executed then. */
-	spdk_scsi_lun_execute_mgmt_task(lun);
+	spdk_scsi_lun_execute_mgmt_task(lun->dev_ch);
 
 	CU_ASSERT(TAILQ_EMPTY(&lun->mgmt_tasks));
 	CU_ASSERT(lun->reset_poller == NULL);
 	CU_ASSERT_EQUAL(mgmt_task.status, SPDK_SCSI_STATUS_GOOD);
 	CU_ASSERT_EQUAL(mgmt_task.response, SPDK_SCSI_TASK_MGMT_RESP_SUCCESS);
 
-	CU_ASSERT(TAILQ_EMPTY(&lun->pending_tasks));
-	CU_ASSERT(TAILQ_EMPTY(&lun->tasks));
+	CU_ASSERT(TAILQ_EMPTY(&ch->pending_tasks));
+	CU_ASSERT(lun->dev_ch->num_submitted_tasks == 0);
+
+	lun_destruct(lun);
+
+	CU_ASSERT_EQUAL(g_task_count, 0);
+}
+
+static void
+lun_open_second_thread(void)
+{
+	struct spdk_scsi_lun *lun;
+	struct spdk_scsi_desc *desc;
+	struct spdk_scsi_task task1 = { 0 };
+	struct spdk_scsi_task task2 = { 0 };
+	struct spdk_scsi_task mgmt_task = { 0 };
+	struct spdk_scsi_dev dev = { 0 };
+	struct spdk_scsi_lun_channel *ch0, *ch1;
+	struct spdk_io_channel *io_ch0;
+	int rc;
+
+	/* The LUN is constructed on thread 0 and gets a channel there. */
+	lun = lun_construct();
+	lun->dev = &dev;
+	io_ch0 = spdk_scsi_lun_get_io_channel(lun);
+	CU_ASSERT(io_ch0 != NULL);
+
+	/* Another connection of the session opens the LUN on thread 1. */
+	set_thread(1);
+	CU_ASSERT(spdk_scsi_lun_get_io_channel(lun) == NULL);
+
+	rc = spdk_scsi_lun_open(lun, NULL, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	rc = spdk_scsi_lun_allocate_io_channel(desc);
+	CU_ASSERT(rc == 0);
+
+	CU_ASSERT(spdk_scsi_lun_get_io_channel(lun) != NULL);
+	CU_ASSERT(spdk_scsi_lun_get_io_channel(lun) != io_ch0);
+
+	/* The device level channel can't be used from a second thread. */
+	CU_ASSERT(_spdk_scsi_lun_allocate_io_channel(lun) != 0);
+
+	ch0 = lun->dev_ch;
+	SPDK_CU_ASSERT_FATAL(ch0 != NULL);
+	ch1 = desc->ch;
+	SPDK_CU_ASSERT_FATAL(ch1 != NULL);
+	CU_ASSERT(TAILQ_FIRST(&lun->channels) == ch0);
+	CU_ASSERT(TAILQ_NEXT(ch0, link) == ch1);
+	CU_ASSERT(ch1->thread == spdk_get_thread());
+
+	g_lun_execute_fail = false;
+	g_lun_execute_status = SPDK_SCSI_TASK_PENDING;
+
+	/* Thread 0 submits a task, then a LUN reset which waits for it. */
+	set_thread(0);
+	ut_init_task(&task1);
+	task1.lun = lun;
+	spdk_scsi_lun_append_task(lun, &task1);
+	spdk_scsi_lun_execute_tasks(ch0);
+	CU_ASSERT(ch0->num_submitted_tasks == 1);
+
+	ut_init_task(&mgmt_task);
+	mgmt_task.lun = lun;
+	mgmt_task.function = SPDK_SCSI_TASK_FUNC_LUN_RESET;
+	spdk_scsi_lun_append_mgmt_task(lun, &mgmt_task);
+	spdk_scsi_lun_execute_mgmt_task(ch0);
+	CU_ASSERT(lun->reset_poller != NULL);
+
+	/* A task received on thread 1 is held back by the reset. */
+	set_thread(1);
+	ut_init_task(&task2);
+	task2.lun = lun;
+	task2.desc = desc;
+	spdk_scsi_lun_append_task(lun, &task2);
+	spdk_scsi_lun_execute_tasks(ch1);
+	CU_ASSERT(!TAILQ_EMPTY(&ch1->pending_tasks));
+	CU_ASSERT(spdk_scsi_lun_has_pending_tasks(lun));
+
+	/* Completing the reset lets thread 1 run its task. */
+	g_lun_execute_status = SPDK_SCSI_TASK_COMPLETE;
+	set_thread(0);
+	spdk_scsi_lun_complete_task(lun, &task1);
+	spdk_scsi_lun_reset_check_outstanding_tasks(&mgmt_task);
+	CU_ASSERT(lun->reset_poller == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lun->mgmt_tasks));
+
+	/* The task runs on thread 1 only, so it waits for the message. */
+	CU_ASSERT(!TAILQ_EMPTY(&ch1->pending_tasks));
+	CU_ASSERT_EQUAL(g_task_count, 1);
+
+	poll_threads();
+
+	CU_ASSERT(TAILQ_EMPTY(&ch1->pending_tasks));
+	CU_ASSERT(ch1->num_tasks == 0);
+	CU_ASSERT(!spdk_scsi_lun_has_pending_tasks(lun));
+	CU_ASSERT_EQUAL(g_task_count, 0);
+
+	set_thread(1);
+	spdk_scsi_lun_free_io_channel(desc);
+	CU_ASSERT(desc->ch == NULL);
+	spdk_scsi_lun_close(desc);
+
+	set_thread(0);
+	CU_ASSERT(TAILQ_FIRST(&lun->channels) == ch0);
+	CU_ASSERT(TAILQ_NEXT(ch0, link) == NULL);
 
 	lun_destruct(lun);
 
@@ -642,15 +784,21 @@ main(int argc, char **argv)
 			       lun_reset_task_wait_scsi_task_complete) == NULL
 		|| CU_add_test(suite, "reset task suspend subsequent scsi task",
 			       lun_reset_task_suspend_scsi_task) == NULL
+		|| CU_add_test(suite, "open and use lun from a second thread",
+			       lun_open_second_thread) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
-	allocate_threads(1);
+	allocate_threads(2);
 	set_thread(0);
+	spdk_io_device_register(&g_ut_bdev_io_device, ut_bdev_channel_create,
+				ut_bdev_channel_destroy, 0, NULL);
 	CU_basic_run_tests();
+	spdk_io_device_unregister(&g_ut_bdev_io_device, NULL);
+	poll_threads();
 	free_threads();
 	num_failures = CU_get_number_of_failures();
 	CU_cleanup_registry();
@@ -53,6 +53,13 @@ int g_scsi_cb_called = 0;
 TAILQ_HEAD(, spdk_bdev_io_wait_entry) g_io_wait_queue;
 bool g_bdev_io_pool_full = false;
 
+/* Byte pattern returned by reads, and writes submitted so far. */
+uint8_t g_test_read_pattern = 0;
+int g_test_write_count = 0;
+int g_test_write_zeroes_count = 0;
+uint64_t g_test_write_blocks = 0;
+uint8_t g_test_write_pattern = 0;
+
 bool
 spdk_bdev_io_type_supported(struct spdk_bdev *bdev, enum spdk_bdev_io_type io_type)
 {
@@ -63,7 +70,7 @@ spdk_bdev_io_type_supported(struct spdk_bdev *bdev, enum spdk_bdev_io_type io_ty
 void
 spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 {
-	CU_ASSERT(0);
+	/* bdev_ios are freed by ut_bdev_io_flush() after their completion callback */
 }
 
 DEFINE_STUB(spdk_bdev_get_name, const char *,
@@ -111,6 +118,12 @@ spdk_scsi_lun_complete_task(struct spdk_scsi_lun *lun, struct spdk_scsi_task *ta
 DEFINE_STUB_V(spdk_scsi_lun_complete_reset_task,
 	      (struct spdk_scsi_lun *lun, struct spdk_scsi_task *task));
 
+DEFINE_STUB(spdk_scsi_lun_get_io_channel, struct spdk_io_channel *,
+	    (struct spdk_scsi_lun *lun), NULL);
+
+DEFINE_STUB(spdk_scsi_task_get_io_channel, struct spdk_io_channel *,
+	    (struct spdk_scsi_task *task), NULL);
+
 static void
 ut_put_task(struct spdk_scsi_task *task)
 {
@@ -229,6 +242,51 @@ spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 	return _spdk_bdev_io_op(cb, cb_arg);
 }
 
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	int rc;
+
+	rc = _spdk_bdev_io_op(cb, cb_arg);
+	if (rc == 0) {
+		memset(buf, g_test_read_pattern, num_blocks * 512);
+	}
+	return rc;
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	int rc;
+
+	rc = _spdk_bdev_io_op(cb, cb_arg);
+	if (rc == 0) {
+		g_test_write_count++;
+		g_test_write_blocks += num_blocks;
+		g_test_write_pattern = *(uint8_t *)buf;
+	}
+	return rc;
+}
+
+int
+spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			      uint64_t offset_blocks, uint64_t num_blocks,
+			      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	int rc;
+
+	rc = _spdk_bdev_io_op(cb, cb_arg);
+	if (rc == 0) {
+		g_test_write_zeroes_count++;
+		g_test_write_blocks += num_blocks;
+	}
+	return rc;
+}
+
 int
 spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 		       uint64_t offset_blocks, uint64_t num_blocks,
@@ -630,8 +688,6 @@ task_complete_test(void)
 
 	ut_init_task(&task);
 
-	TAILQ_INIT(&lun.tasks);
-	TAILQ_INSERT_TAIL(&lun.tasks, &task, scsi_link);
 	task.lun = &lun;
 
 	bdev_io.internal.status = SPDK_BDEV_IO_STATUS_SUCCESS;
@@ -679,7 +735,6 @@ lba_range_test(void)
 	ut_init_task(&task);
 	task.lun = &lun;
 	task.lun->bdev_desc = NULL;
-	task.lun->io_channel = NULL;
 	task.cdb = cdb;
 
 	memset(cdb, 0, sizeof(cdb));
@@ -760,7 +815,6 @@ xfer_len_test(void)
 	ut_init_task(&task);
 	task.lun = &lun;
 	task.lun->bdev_desc = NULL;
-	task.lun->io_channel = NULL;
 	task.cdb = cdb;
 
 	memset(cdb, 0, sizeof(cdb));
@@ -859,7 +913,6 @@ _xfer_test(bool bdev_io_pool_full)
 	ut_init_task(&task);
 	task.lun = &lun;
 	task.lun->bdev_desc = NULL;
-	task.lun->io_channel = NULL;
 	task.cdb = cdb;
 	memset(cdb, 0, sizeof(cdb));
 	cdb[0] = 0x88; /* READ (16) */
@@ -990,6 +1043,440 @@ get_dif_ctx_test(void)
 	CU_ASSERT(dif_ctx.init_ref_tag == 0x12345678);
 }
 
+static void
+ut_reset_write_stats(void)
+{
+	g_test_write_count = 0;
+	g_test_write_zeroes_count = 0;
+	g_test_write_blocks = 0;
+	g_test_write_pattern = 0;
+}
+
+static void
+write_same_test(void)
+{
+	struct spdk_bdev bdev = { .blocklen = 512 };
+	struct spdk_scsi_lun lun;
+	struct spdk_scsi_task task;
+	uint8_t cdb[16];
+	uint8_t data[512];
+	int rc;
+
+	lun.bdev = &bdev;
+	lun.bdev_desc = NULL;
+
+	/* Test block device size of 64 MiB */
+	g_test_bdev_num_blocks = 128 * 1024;
+
+	/* A zeroed block is mapped to a single write zeroes */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	memset(data, 0, sizeof(data));
+	cdb[0] = 0x41; /* WRITE SAME (10) */
+	to_be32(&cdb[2], 16); /* LBA */
+	to_be16(&cdb[7], 512); /* number of blocks */
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = 512;
+	task.offset = 0;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_zeroes_count == 1);
+	CU_ASSERT(g_test_write_count == 0);
+	CU_ASSERT(g_test_write_blocks == 512);
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* Other patterns are written from a replicated buffer */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	memset(data, 0xA5, sizeof(data));
+	cdb[0] = 0x93; /* WRITE SAME (16) */
+	to_be64(&cdb[2], 0); /* LBA */
+	to_be32(&cdb[10], 511); /* number of blocks */
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = 512;
+	task.offset = 0;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_zeroes_count == 0);
+	CU_ASSERT(g_test_write_count == 1);
+	CU_ASSERT(g_test_write_blocks == 511);
+	CU_ASSERT(g_test_write_pattern == 0xA5);
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* NDOB writes zeroes without a data-out buffer */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x93; /* WRITE SAME (16) */
+	cdb[1] = 0x01; /* NDOB */
+	to_be64(&cdb[2], 1024); /* LBA */
+	to_be32(&cdb[10], 8); /* number of blocks */
+	task.transfer_len = 0;
+	task.offset = 0;
+	task.length = 0;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_test_write_zeroes_count == 1);
+	CU_ASSERT(g_test_write_blocks == 8);
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* Zero length is rejected, since WSNZ is set */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x93; /* WRITE SAME (16) */
+	cdb[1] = 0x01; /* NDOB */
+	to_be64(&cdb[2], 1024); /* LBA */
+	to_be32(&cdb[10], 0); /* number of blocks */
+	task.transfer_len = 0;
+	task.offset = 0;
+	task.length = 0;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT((task.sense_data[2] & 0xf) == SPDK_SCSI_SENSE_ILLEGAL_REQUEST);
+	CU_ASSERT(task.sense_data[12] == SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB);
+	CU_ASSERT(g_test_write_count == 0 && g_test_write_zeroes_count == 0);
+	ut_put_task(&task);
+
+	/* More than MAXIMUM WRITE SAME LENGTH */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	memset(data, 0, sizeof(data));
+	cdb[0] = 0x41; /* WRITE SAME (10) */
+	to_be32(&cdb[2], 0); /* LBA */
+	to_be16(&cdb[7], 513); /* number of blocks */
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = 512;
+	task.offset = 0;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT((task.sense_data[2] & 0xf) == SPDK_SCSI_SENSE_ILLEGAL_REQUEST);
+	CU_ASSERT(task.sense_data[12] == SPDK_SCSI_ASC_INVALID_FIELD_IN_CDB);
+	CU_ASSERT(g_test_write_count == 0 && g_test_write_zeroes_count == 0);
+	ut_put_task(&task);
+
+	/* Out of range */
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x41; /* WRITE SAME (10) */
+	to_be32(&cdb[2], 128 * 1024 - 1); /* LBA */
+	to_be16(&cdb[7], 2); /* number of blocks */
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = 512;
+	task.offset = 0;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT(task.sense_data[12] == SPDK_SCSI_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
+	CU_ASSERT(g_test_write_count == 0 && g_test_write_zeroes_count == 0);
+	ut_put_task(&task);
+}
+
+static void
+ut_init_caw_task(struct spdk_scsi_task *task, struct spdk_scsi_lun *lun, uint8_t *cdb,
+		 uint8_t *data, uint64_t lba, uint8_t verify, uint8_t write)
+{
+	ut_init_task(task);
+	task->lun = lun;
+	task->cdb = cdb;
+	memset(cdb, 0, 16);
+	cdb[0] = 0x89; /* COMPARE AND WRITE */
+	to_be64(&cdb[2], lba); /* LBA */
+	cdb[13] = 1; /* number of blocks */
+	memset(data, verify, 512);
+	memset(data + 512, write, 512);
+	spdk_scsi_task_set_data(task, data, 1024);
+	task->transfer_len = 1024;
+	task->offset = 0;
+	task->length = 1024;
+}
+
+static void
+compare_and_write_test(void)
+{
+	struct spdk_bdev bdev = { .blocklen = 512 };
+	struct spdk_scsi_lun lun;
+	struct spdk_scsi_task task, task2;
+	uint8_t cdb[16], cdb2[16];
+	uint8_t data[1024], data2[1024];
+	int rc;
+
+	lun.bdev = &bdev;
+	lun.bdev_desc = NULL;
+	pthread_mutex_init(&lun.mutex, NULL);
+	TAILQ_INIT(&lun.caw_locked);
+	TAILQ_INIT(&lun.caw_waiting);
+	TAILQ_INIT(&lun.caw_gathering);
+
+	g_test_bdev_num_blocks = 1024;
+
+	/* Matching data is written */
+	ut_reset_write_stats();
+	g_test_read_pattern = 0x11;
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	CU_ASSERT(!TAILQ_EMPTY(&lun.caw_locked));
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_count == 1);
+	CU_ASSERT(g_test_write_pattern == 0x22);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_locked));
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* Miscompare reports the offset and doesn't write */
+	ut_reset_write_stats();
+	g_test_read_pattern = 0x33;
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT((task.sense_data[2] & 0xf) == SPDK_SCSI_SENSE_MISCOMPARE);
+	CU_ASSERT(task.sense_data[12] == SPDK_SCSI_ASC_MISCOMPARE_DURING_VERIFY_OPERATION);
+	CU_ASSERT(from_be32(&task.sense_data[3]) == 0);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_count == 0);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_locked));
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* A second command to the same LBA waits until the first one completes */
+	ut_reset_write_stats();
+	g_test_read_pattern = 0x11;
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	ut_init_caw_task(&task2, &lun, cdb2, data2, 8, 0x11, 0x44);
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	rc = spdk_bdev_scsi_execute(&task2);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	CU_ASSERT(!TAILQ_EMPTY(&lun.caw_waiting));
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(task2.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 2);
+	CU_ASSERT(g_test_write_count == 2);
+	/* The second write was submitted last */
+	CU_ASSERT(g_test_write_pattern == 0x44);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_locked));
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_waiting));
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+	ut_put_task(&task2);
+
+	/* Data split across two tasks is gathered, the second one runs the command */
+	ut_reset_write_stats();
+	g_test_read_pattern = 0x11;
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	spdk_scsi_task_set_data(&task, data, 512);
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(!TAILQ_EMPTY(&lun.caw_gathering));
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_locked));
+	ut_init_task(&task2);
+	task2.lun = &lun;
+	task2.cdb = cdb;
+	spdk_scsi_task_set_data(&task2, data + 512, 512);
+	task2.transfer_len = 1024;
+	task2.offset = 512;
+	task2.length = 512;
+	rc = spdk_bdev_scsi_execute(&task2);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_gathering));
+	ut_bdev_io_flush();
+	CU_ASSERT(task2.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_count == 1);
+	CU_ASSERT(g_test_write_pattern == 0x22);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_locked));
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+	ut_put_task(&task2);
+
+	/* Data which doesn't follow the data received so far */
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	spdk_scsi_task_set_data(&task, data + 512, 512);
+	task.offset = 512;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_gathering));
+	ut_put_task(&task);
+
+	/* Data length shorter than verify + write data */
+	ut_init_caw_task(&task, &lun, cdb, data, 8, 0x11, 0x22);
+	spdk_scsi_task_set_data(&task, data, 512);
+	task.transfer_len = 512;
+	task.length = 512;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT(TAILQ_EMPTY(&lun.caw_gathering));
+	CU_ASSERT(g_test_write_count == 1);
+	ut_put_task(&task);
+
+	pthread_mutex_destroy(&lun.mutex);
+}
+
+static void
+extended_copy_test(void)
+{
+	struct spdk_bdev bdev = { .blocklen = 512 };
+	struct spdk_scsi_dev dev;
+	struct spdk_scsi_lun lun;
+	struct spdk_scsi_task task;
+	uint8_t cdb[16];
+	uint8_t data[16 + 32 + 28];
+	uint8_t *desc;
+	int rc;
+
+	memset(&dev, 0, sizeof(dev));
+	lun.bdev = &bdev;
+	lun.bdev_desc = NULL;
+	MOCK_SET(spdk_scsi_lun_get_io_channel, (struct spdk_io_channel *)0x1);
+	MOCK_SET(spdk_scsi_task_get_io_channel, (struct spdk_io_channel *)0x1);
+	lun.removed = false;
+	lun.dev = &dev;
+	dev.lun[0] = &lun;
+
+	g_test_bdev_num_blocks = 128 * 1024;
+
+	/* Copy 2048 + 1 blocks within the LUN: 2 chunks of the 1 MiB work buffer */
+	memset(data, 0, sizeof(data));
+	to_be16(&data[2], 32); /* target descriptor list length */
+	to_be32(&data[8], 28); /* segment descriptor list length */
+	desc = &data[16];
+	desc[0] = 0xe4; /* identification descriptor */
+	desc[4] = SPDK_SPC_VPD_CODE_SET_BINARY;
+	desc[5] = SPDK_SPC_VPD_IDENTIFIER_TYPE_NAA;
+	desc[7] = 8;
+	spdk_bdev_scsi_set_naa_ieee_extended("test", &desc[8]);
+	desc = &data[48];
+	desc[0] = 0x02; /* block to block */
+	to_be16(&desc[2], 24);
+	to_be16(&desc[4], 0); /* source */
+	to_be16(&desc[6], 0); /* destination */
+	to_be16(&desc[10], 2049); /* number of blocks */
+	to_be64(&desc[12], 0); /* source LBA */
+	to_be64(&desc[20], 4096); /* destination LBA */
+
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x83; /* EXTENDED COPY */
+	to_be32(&cdb[10], sizeof(data)); /* parameter list length */
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = sizeof(data);
+	task.offset = 0;
+	task.length = sizeof(data);
+	g_test_read_pattern = 0x5A;
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_PENDING);
+	ut_bdev_io_flush();
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(g_scsi_cb_called == 1);
+	CU_ASSERT(g_test_write_count == 2);
+	CU_ASSERT(g_test_write_blocks == 2049);
+	CU_ASSERT(g_test_write_pattern == 0x5A);
+	g_scsi_cb_called = 0;
+	ut_put_task(&task);
+
+	/* Unknown target */
+	data[16 + 8] ^= 0xff;
+	ut_init_task(&task);
+	ut_reset_write_stats();
+	task.lun = &lun;
+	task.cdb = cdb;
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = sizeof(data);
+	task.offset = 0;
+	task.length = sizeof(data);
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT((task.sense_data[2] & 0xf) == SPDK_SCSI_SENSE_COPY_ABORTED);
+	CU_ASSERT(task.sense_data[13] == SPDK_SCSI_ASCQ_COPY_TARGET_DEVICE_NOT_REACHABLE);
+	CU_ASSERT(g_test_write_count == 0);
+	data[16 + 8] ^= 0xff;
+	ut_put_task(&task);
+
+	/* Unsupported segment descriptor type */
+	data[48] = 0x0a;
+	ut_init_task(&task);
+	task.lun = &lun;
+	task.cdb = cdb;
+	spdk_scsi_task_set_data(&task, data, sizeof(data));
+	task.transfer_len = sizeof(data);
+	task.offset = 0;
+	task.length = sizeof(data);
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_CHECK_CONDITION);
+	CU_ASSERT(task.sense_data[12] == SPDK_SCSI_ASC_INVALID_FIELD_IN_PARAMETER_LIST);
+	CU_ASSERT(task.sense_data[13] == SPDK_SCSI_ASCQ_UNSUPPORTED_SEGMENT_DESCRIPTOR_TYPE_CODE);
+	ut_put_task(&task);
+
+	/* RECEIVE COPY RESULTS - OPERATING PARAMETERS */
+	ut_init_task(&task);
+	task.lun = &lun;
+	task.cdb = cdb;
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x84; /* RECEIVE COPY RESULTS */
+	cdb[1] = 0x03; /* OPERATING PARAMETERS */
+	to_be32(&cdb[10], 64); /* allocation length */
+	rc = spdk_bdev_scsi_execute(&task);
+	CU_ASSERT(rc == SPDK_SCSI_TASK_COMPLETE);
+	CU_ASSERT(task.status == SPDK_SCSI_STATUS_GOOD);
+	CU_ASSERT(task.data_transferred == 46);
+	SPDK_CU_ASSERT_FATAL(task.iov.iov_base != NULL);
+	CU_ASSERT(from_be16((uint8_t *)task.iov.iov_base + 10) == DEFAULT_MAX_XCOPY_SEGMENT_DESCRIPTOR_COUNT);
+	CU_ASSERT(((uint8_t *)task.iov.iov_base)[43] == 2);
+	ut_put_task(&task);
+
+	MOCK_CLEAR(spdk_scsi_lun_get_io_channel);
+	MOCK_CLEAR(spdk_scsi_task_get_io_channel);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1023,6 +1510,9 @@ main(int argc, char **argv)
 		|| CU_add_test(suite, "transfer test", xfer_test) == NULL
 		|| CU_add_test(suite, "scsi name padding test", scsi_name_padding_test) == NULL
 		|| CU_add_test(suite, "get dif context test", get_dif_ctx_test) == NULL
+		|| CU_add_test(suite, "write same test", write_same_test) == NULL
+		|| CU_add_test(suite, "compare and write test", compare_and_write_test) == NULL
+		|| CU_add_test(suite, "extended copy test", extended_copy_test) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
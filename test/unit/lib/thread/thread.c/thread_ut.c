@@ -102,6 +102,53 @@ poller_run_done(void *ctx)
 	return -1;
 }
 
+static void
+send_msg_batch_cb(void *ctx)
+{
+	int *count = ctx;
+
+	(*count)++;
+}
+
+static void
+thread_send_msg_batch(void)
+{
+	struct spdk_thread *thread0;
+	int counts[SPDK_THREAD_MSG_BATCH_MAX] = {};
+	void *ctx[SPDK_THREAD_MSG_BATCH_MAX + 1];
+	int i;
+
+	allocate_threads(2);
+	set_thread(0);
+	thread0 = spdk_get_thread();
+
+	for (i = 0; i < SPDK_THREAD_MSG_BATCH_MAX; i++) {
+		ctx[i] = &counts[i];
+	}
+
+	set_thread(1);
+	/* Batch size out of range is rejected. */
+	CU_ASSERT(spdk_thread_send_msg_batch(thread0, send_msg_batch_cb, ctx, 0) == -EINVAL);
+	CU_ASSERT(spdk_thread_send_msg_batch(thread0, send_msg_batch_cb, ctx,
+					     SPDK_THREAD_MSG_BATCH_MAX + 1) == -EINVAL);
+
+	/* Send a full batch from thread 1 to thread 0. */
+	CU_ASSERT(spdk_thread_send_msg_batch(thread0, send_msg_batch_cb, ctx,
+					     SPDK_THREAD_MSG_BATCH_MAX) == 0);
+	poll_thread(1);
+	for (i = 0; i < SPDK_THREAD_MSG_BATCH_MAX; i++) {
+		CU_ASSERT(counts[i] == 0);
+	}
+
+	/* Polling thread 0 runs every message exactly once. */
+	poll_threads();
+	for (i = 0; i < SPDK_THREAD_MSG_BATCH_MAX; i++) {
+		CU_ASSERT(counts[i] == 1);
+	}
+
+	free_threads();
+}
+
 static void
 thread_poller(void)
 {
@@ -156,6 +203,185 @@ for_each_cb(void *ctx)
 	(*count)++;
 }
 
+struct timer_wheel_poller {
+	struct spdk_poller	*poller;
+	uint64_t		period_us;
+	uint64_t		period_ticks;
+	uint64_t		next_run_tick;
+	uint64_t		expected_runs;
+	uint64_t		runs;
+};
+
+static int
+timer_wheel_poller_run(void *ctx)
+{
+	struct timer_wheel_poller *p = ctx;
+
+	p->runs++;
+
+	return 0;
+}
+
+static void
+_thread_timer_wheel(uint64_t ticks_hz)
+{
+	struct timer_wheel_poller pollers[] = {
+		{ .period_us = 1 },
+		{ .period_us = 3 },
+		{ .period_us = 255 },
+		{ .period_us = 300 },
+		{ .period_us = 1000 },
+		{ .period_us = 70000 },
+		{ .period_us = 20000000 },
+		{ .period_us = 5000000000ULL },
+	};
+	struct spdk_thread *thread;
+	uint64_t now = 0, next, step, seed = 1;
+	uint32_t step_bits;
+	size_t i;
+	int iter;
+
+	MOCK_SET(spdk_get_ticks_hz, ticks_hz);
+	MOCK_SET(spdk_get_ticks, 0);
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+		pollers[i].period_ticks = ticks_hz * (pollers[i].period_us / SPDK_SEC_TO_USEC) +
+					  ticks_hz * (pollers[i].period_us % SPDK_SEC_TO_USEC) / SPDK_SEC_TO_USEC;
+		pollers[i].next_run_tick = pollers[i].period_ticks;
+		pollers[i].poller = spdk_poller_register(timer_wheel_poller_run, &pollers[i],
+				    pollers[i].period_us);
+		SPDK_CU_ASSERT_FATAL(pollers[i].poller != NULL);
+	}
+
+	/*
+	 * Advance time in steps of random magnitude and check that every poller runs
+	 *  exactly when it is due - never early and never late.
+	 */
+	step_bits = 34 + spdk_u32log2(ticks_hz / SPDK_SEC_TO_USEC);
+	for (iter = 0; iter < 20000; iter++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		step = (seed >> 20) & ((1ULL << ((seed >> 12) % step_bits)) - 1);
+		now += step;
+		MOCK_SET(spdk_get_ticks, now);
+
+		spdk_thread_poll(thread, 0, now);
+
+		next = UINT64_MAX;
+		for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+			if (now >= pollers[i].next_run_tick) {
+				pollers[i].expected_runs++;
+				pollers[i].next_run_tick = now + pollers[i].period_ticks;
+			}
+			CU_ASSERT(pollers[i].runs == pollers[i].expected_runs);
+			next = spdk_min(next, pollers[i].next_run_tick);
+		}
+		CU_ASSERT(spdk_thread_next_poller_expiration(thread) == next);
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(pollers); i++) {
+		CU_ASSERT(pollers[i].runs > 0);
+		spdk_poller_unregister(&pollers[i].poller);
+	}
+
+	free_threads();
+	MOCK_CLEAR(spdk_get_ticks_hz);
+	MOCK_SET(spdk_get_ticks, 0);
+}
+
+static void
+thread_timer_wheel(void)
+{
+	/* One tick per wheel unit. */
+	_thread_timer_wheel(1000000);
+	/* Several ticks per wheel unit. */
+	_thread_timer_wheel(2400000000ULL);
+}
+
+static int
+poller_busy(void *ctx)
+{
+	spdk_delay_us(10);
+
+	return 1;
+}
+
+static int
+poller_idle(void *ctx)
+{
+	return 0;
+}
+
+struct poller_stats_ctx {
+	struct spdk_poller_stats	stats[2];
+	char				names[2][SPDK_MAX_POLLER_NAME_LEN + 1];
+	int				count;
+};
+
+static void
+poller_stats_cb(void *_ctx, const struct spdk_poller_stats *stats)
+{
+	struct poller_stats_ctx *ctx = _ctx;
+
+	SPDK_CU_ASSERT_FATAL(ctx->count < 2);
+	ctx->stats[ctx->count] = *stats;
+	snprintf(ctx->names[ctx->count], sizeof(ctx->names[0]), "%s", stats->name);
+	ctx->count++;
+}
+
+static void
+thread_poller_stats(void)
+{
+	struct spdk_poller *busy, *idle;
+	struct spdk_thread_stats thread_stats;
+	struct poller_stats_ctx ctx = {};
+
+	allocate_threads(1);
+	set_thread(0);
+	MOCK_SET(spdk_get_ticks, 0);
+
+	busy = SPDK_POLLER_REGISTER(poller_busy, NULL, 0);
+	SPDK_CU_ASSERT_FATAL(busy != NULL);
+	idle = spdk_poller_register_named(poller_idle, NULL, 1000, "idle_timer");
+	SPDK_CU_ASSERT_FATAL(idle != NULL);
+
+	/* Run the active poller alone, then both pollers together. */
+	spdk_thread_poll(spdk_get_thread(), 0, 0);
+	spdk_delay_us(1000);
+	spdk_thread_poll(spdk_get_thread(), 0, 0);
+
+	CU_ASSERT(spdk_thread_get_poller_stats(poller_stats_cb, &ctx) == 0);
+	CU_ASSERT(ctx.count == 2);
+	CU_ASSERT(strcmp(ctx.names[0], "poller_busy") == 0);
+	CU_ASSERT(ctx.stats[0].period_ticks == 0);
+	CU_ASSERT(ctx.stats[0].run_count == 2);
+	CU_ASSERT(ctx.stats[0].busy_count == 2);
+	CU_ASSERT(ctx.stats[0].run_tsc == 20);
+	CU_ASSERT(strcmp(ctx.names[1], "idle_timer") == 0);
+	CU_ASSERT(ctx.stats[1].period_ticks == 1000);
+	CU_ASSERT(ctx.stats[1].run_count == 1);
+	CU_ASSERT(ctx.stats[1].busy_count == 0);
+	CU_ASSERT(ctx.stats[1].run_tsc == 0);
+
+	CU_ASSERT(spdk_thread_get_stats(&thread_stats) == 0);
+	CU_ASSERT(thread_stats.active_pollers == 1);
+	CU_ASSERT(thread_stats.timed_pollers == 1);
+	CU_ASSERT(thread_stats.poller_runs == 3);
+	CU_ASSERT(thread_stats.poller_tsc == 20);
+
+	/* Unregistered pollers are no longer reported. */
+	spdk_poller_unregister(&busy);
+	memset(&ctx, 0, sizeof(ctx));
+	CU_ASSERT(spdk_thread_get_poller_stats(poller_stats_cb, &ctx) == 0);
+	CU_ASSERT(ctx.count == 1);
+	CU_ASSERT(strcmp(ctx.names[0], "idle_timer") == 0);
+
+	spdk_poller_unregister(&idle);
+	free_threads();
+}
+
 static void
 thread_for_each(void)
 {
@@ -541,7 +767,10 @@ main(int argc, char **argv)
 	if (
 		CU_add_test(suite, "thread_alloc", thread_alloc) == NULL ||
 		CU_add_test(suite, "thread_send_msg", thread_send_msg) == NULL ||
+		CU_add_test(suite, "thread_send_msg_batch", thread_send_msg_batch) == NULL ||
 		CU_add_test(suite, "thread_poller", thread_poller) == NULL ||
+		CU_add_test(suite, "thread_timer_wheel", thread_timer_wheel) == NULL ||
+		CU_add_test(suite, "thread_poller_stats", thread_poller_stats) == NULL ||
 		CU_add_test(suite, "thread_for_each", thread_for_each) == NULL ||
 		CU_add_test(suite, "for_each_channel_remove", for_each_channel_remove) == NULL ||
 		CU_add_test(suite, "for_each_channel_unreg", for_each_channel_unreg) == NULL ||
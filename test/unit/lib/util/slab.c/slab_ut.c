@@ -0,0 +1,320 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) Intel Corporation.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+
+#include "util/slab.c"
+#include "common/lib/test_env.c"
+
+static void
+test_create(void)
+{
+	struct spdk_slab *slab;
+	struct spdk_slab_stats stats;
+	void *ele;
+
+	CU_ASSERT(spdk_slab_create("test", 0, 16) == NULL);
+	CU_ASSERT(spdk_slab_create("test", 16, 0) == NULL);
+
+	slab = spdk_slab_create("test", 100, 16);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	CU_ASSERT(strcmp(spdk_slab_get_name(slab), "test") == 0);
+	CU_ASSERT(slab->stride == 128);
+	CU_ASSERT(slab->chunk_size == SLAB_MIN_CHUNK_SIZE);
+	CU_ASSERT(slab->eles_per_chunk == (SLAB_MIN_CHUNK_SIZE - SLAB_CHUNK_HDR_SIZE) / 128);
+
+	/* No memory is allocated until the first object is requested. */
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.chunk_count == 0);
+	CU_ASSERT(stats.total_count == 0);
+	spdk_slab_free(slab);
+
+	/* Large objects still fit several per chunk. */
+	slab = spdk_slab_create("test", 20000, 16);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	CU_ASSERT(slab->chunk_size == 256 * 1024);
+	CU_ASSERT(slab->eles_per_chunk >= SLAB_MIN_CHUNK_ELES);
+	spdk_slab_free(slab);
+
+	/* Objects that are a multiple of 4 KiB are aligned to 4 KiB. */
+	slab = spdk_slab_create("test", 8192, 16);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	ele = spdk_slab_get(slab, NULL);
+	SPDK_CU_ASSERT_FATAL(ele != NULL);
+	CU_ASSERT(((uintptr_t)ele & 0xFFF) == 0);
+	CU_ASSERT(spdk_slab_get(slab, NULL) == (void *)((uintptr_t)ele + 8192));
+	spdk_slab_free(slab);
+}
+
+static void
+test_get_put(void)
+{
+	struct spdk_slab *slab;
+	struct spdk_slab_cache *cache;
+	struct spdk_slab_depot *depot;
+	struct spdk_slab_stats stats;
+	void *eles[8];
+	int i;
+
+	slab = spdk_slab_create("test", 64, 1000);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	cache = spdk_slab_cache_create(slab, 8, 0);
+	SPDK_CU_ASSERT_FATAL(cache != NULL);
+	CU_ASSERT(spdk_slab_cache_count(cache) == 0);
+
+	/*
+	 * The first allocation grows the slab by one chunk and refills half of the cache. The
+	 *  chunk could hold more objects than the slab allows, so only 1000 are carved out.
+	 */
+	eles[0] = spdk_slab_get(slab, cache);
+	SPDK_CU_ASSERT_FATAL(eles[0] != NULL);
+	CU_ASSERT(((uintptr_t)eles[0] & (SLAB_ELE_ALIGN - 1)) == 0);
+	CU_ASSERT(spdk_slab_cache_count(cache) == 3);
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.chunk_count == 1);
+	CU_ASSERT(stats.chunk_bytes == SLAB_MIN_CHUNK_SIZE);
+	CU_ASSERT(stats.total_count == 1000);
+	CU_ASSERT(stats.free_count == 999);
+	CU_ASSERT(stats.get_count == 1);
+
+	for (i = 1; i < 8; i++) {
+		eles[i] = spdk_slab_get(slab, cache);
+		SPDK_CU_ASSERT_FATAL(eles[i] != NULL);
+		memset(eles[i], 0xA5, 64);
+	}
+
+	/* Freeing more objects than fit in the cache returns half of it to the slab. */
+	CU_ASSERT(spdk_slab_cache_count(cache) == 0);
+	for (i = 0; i < 8; i++) {
+		spdk_slab_put(slab, cache, eles[i]);
+	}
+	CU_ASSERT(spdk_slab_cache_count(cache) == 8);
+	/* The slab cannot grow, so an uncached allocation takes an object of socket 0. */
+	spdk_slab_put(slab, cache, spdk_slab_get(slab, NULL));
+	CU_ASSERT(spdk_slab_cache_count(cache) == 5);
+
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.total_count == stats.free_count);
+	CU_ASSERT(stats.get_count == 9);
+	CU_ASSERT(stats.put_count == 9);
+	CU_ASSERT(stats.remote_put_count == 0);
+
+	/* Freeing the cache keeps its counters and returns its objects. */
+	depot = cache->depot;
+	spdk_slab_cache_free(cache);
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.total_count == stats.free_count);
+	CU_ASSERT(stats.get_count == 9);
+	CU_ASSERT(spdk_ring_count(slab->default_depot->ring) == 0);
+	CU_ASSERT(spdk_ring_count(depot->ring) == 1000);
+
+	spdk_slab_free(slab);
+}
+
+static void
+test_exhaustion(void)
+{
+	struct spdk_slab *slab;
+	struct spdk_slab_cache *cache;
+	struct spdk_slab_stats stats;
+	void *eles[10];
+	int i;
+
+	slab = spdk_slab_create("test", 64, 10);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	cache = spdk_slab_cache_create(slab, 4, 0);
+	SPDK_CU_ASSERT_FATAL(cache != NULL);
+
+	for (i = 0; i < 10; i++) {
+		eles[i] = spdk_slab_get(slab, cache);
+		SPDK_CU_ASSERT_FATAL(eles[i] != NULL);
+	}
+
+	CU_ASSERT(spdk_slab_get(slab, cache) == NULL);
+	CU_ASSERT(spdk_slab_get(slab, NULL) == NULL);
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.total_count == 10);
+	CU_ASSERT(stats.free_count == 0);
+	CU_ASSERT(stats.get_fail_count == 2);
+
+	spdk_slab_put(slab, cache, eles[9]);
+	CU_ASSERT(spdk_slab_get(slab, cache) == eles[9]);
+
+	for (i = 0; i < 10; i++) {
+		spdk_slab_put(slab, cache, eles[i]);
+	}
+
+	spdk_slab_cache_free(cache);
+	spdk_slab_free(slab);
+}
+
+static void
+test_sockets(void)
+{
+	struct spdk_slab *slab;
+	struct spdk_slab_cache *cache0, *cache1;
+	struct spdk_slab_stats stats;
+	void *ele0, *ele1;
+	void *eles[4];
+	int i;
+
+	slab = spdk_slab_create("test", 64, 4);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	cache0 = spdk_slab_cache_create(slab, 2, 0);
+	SPDK_CU_ASSERT_FATAL(cache0 != NULL);
+	cache1 = spdk_slab_cache_create(slab, 2, 1);
+	SPDK_CU_ASSERT_FATAL(cache1 != NULL);
+	CU_ASSERT(cache0->depot != cache1->depot);
+
+	ele0 = spdk_slab_get(slab, cache0);
+	SPDK_CU_ASSERT_FATAL(ele0 != NULL);
+	CU_ASSERT(_spdk_slab_chunk(slab, ele0)->depot == cache0->depot);
+
+	/* The slab is at its maximum size now, so socket 1 takes free objects of socket 0. */
+	ele1 = spdk_slab_get(slab, cache1);
+	SPDK_CU_ASSERT_FATAL(ele1 != NULL);
+	CU_ASSERT(_spdk_slab_chunk(slab, ele1)->depot == cache0->depot);
+
+	/* An object freed on the other socket goes back to its own socket. */
+	spdk_slab_put(slab, cache1, ele1);
+	CU_ASSERT(spdk_slab_cache_count(cache1) == 0);
+	spdk_slab_put(slab, cache1, ele0);
+	CU_ASSERT(spdk_slab_cache_count(cache1) == 0);
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.remote_put_count == 2);
+	CU_ASSERT(stats.free_count == 4);
+
+	/* Refilling the cache takes the objects of socket 0 without allocating one. */
+	CU_ASSERT(spdk_slab_cache_refill(cache1) == 1);
+	CU_ASSERT(spdk_slab_cache_refill(cache1) == 1);
+	spdk_slab_put(slab, NULL, spdk_slab_get(slab, cache1));
+	CU_ASSERT(spdk_slab_cache_count(cache1) == 0);
+
+	/* Filling the cache reserves objects until the slab runs out. */
+	CU_ASSERT(spdk_slab_cache_fill(cache1) == 2);
+	CU_ASSERT(spdk_slab_cache_fill(cache1) == 2);
+	spdk_slab_put(slab, NULL, spdk_slab_get(slab, cache1));
+	spdk_slab_put(slab, NULL, spdk_slab_get(slab, cache1));
+	CU_ASSERT(spdk_slab_cache_count(cache1) == 0);
+
+	for (i = 0; i < 4; i++) {
+		eles[i] = spdk_slab_get(slab, cache0);
+		SPDK_CU_ASSERT_FATAL(eles[i] != NULL);
+	}
+	CU_ASSERT(spdk_slab_get(slab, cache0) == NULL);
+
+	for (i = 0; i < 4; i++) {
+		spdk_slab_put(slab, NULL, eles[i]);
+	}
+
+	spdk_slab_get_stats(slab, &stats);
+	CU_ASSERT(stats.chunk_count == 1);
+	CU_ASSERT(stats.free_count == 4);
+	CU_ASSERT(stats.put_count == 9);
+
+	spdk_slab_cache_free(cache0);
+	spdk_slab_cache_free(cache1);
+	spdk_slab_free(slab);
+}
+
+static void
+test_nocache(void)
+{
+	struct spdk_slab *slab;
+	struct spdk_slab_cache *cache;
+	void *ele;
+
+	slab = spdk_slab_create("test", 64, 16);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	cache = spdk_slab_cache_create(slab, 0, 0);
+	SPDK_CU_ASSERT_FATAL(cache != NULL);
+
+	ele = spdk_slab_get(slab, cache);
+	SPDK_CU_ASSERT_FATAL(ele != NULL);
+	CU_ASSERT(spdk_slab_cache_count(cache) == 0);
+	spdk_slab_put(slab, cache, ele);
+	CU_ASSERT(spdk_slab_cache_count(cache) == 0);
+	CU_ASSERT(spdk_ring_count(cache->depot->ring) == 16);
+
+	/* Failing chunk allocations are reported as exhaustion. */
+	spdk_slab_cache_free(cache);
+	spdk_slab_free(slab);
+
+	slab = spdk_slab_create("test", 64, 16);
+	SPDK_CU_ASSERT_FATAL(slab != NULL);
+	MOCK_SET(spdk_dma_malloc_socket, NULL);
+	CU_ASSERT(spdk_slab_get(slab, NULL) == NULL);
+	MOCK_CLEAR(spdk_dma_malloc_socket);
+	ele = spdk_slab_get(slab, NULL);
+	CU_ASSERT(ele != NULL);
+	spdk_slab_put(slab, NULL, ele);
+	spdk_slab_free(slab);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	if (CU_initialize_registry() != CUE_SUCCESS) {
+		return CU_get_error();
+	}
+
+	suite = CU_add_suite("slab", NULL, NULL);
+	if (suite == NULL) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (
+		CU_add_test(suite, "test_create", test_create) == NULL ||
+		CU_add_test(suite, "test_get_put", test_get_put) == NULL ||
+		CU_add_test(suite, "test_exhaustion", test_exhaustion) == NULL ||
+		CU_add_test(suite, "test_sockets", test_sockets) == NULL ||
+		CU_add_test(suite, "test_nocache", test_nocache) == NULL) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+
+	CU_basic_run_tests();
+
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
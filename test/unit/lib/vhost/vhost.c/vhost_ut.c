@@ -109,6 +109,33 @@ spdk_call_unaffinitized(void *cb(void *arg), void *arg)
 	return cb(arg);
 }
 
+struct ut_log_write {
+	uint64_t addr;
+	uint64_t len;
+};
+
+static struct ut_log_write g_log_writes[SPDK_VHOST_LOG_RANGES_MAX + 1];
+static int g_log_write_cnt;
+static struct ut_log_write g_log_used;
+static int g_log_used_cnt;
+
+void
+rte_vhost_log_write(int vid, uint64_t addr, uint64_t len)
+{
+	SPDK_CU_ASSERT_FATAL(g_log_write_cnt < (int)SPDK_COUNTOF(g_log_writes));
+	g_log_writes[g_log_write_cnt].addr = addr;
+	g_log_writes[g_log_write_cnt].len = len;
+	g_log_write_cnt++;
+}
+
+void
+rte_vhost_log_used_vring(int vid, uint16_t vring_idx, uint64_t offset, uint64_t len)
+{
+	g_log_used.addr = offset;
+	g_log_used.len = len;
+	g_log_used_cnt++;
+}
+
 static struct spdk_vhost_dev_backend g_vdev_backend;
 
 static int
@@ -346,6 +373,240 @@ remove_controller_test(void)
 	cleanup_vdev(vdev);
 }
 
+static void
+packed_ring_test(void)
+{
+	struct spdk_vhost_session vsession = {};
+	struct spdk_vhost_virtqueue vq = {};
+	struct vring_packed_desc descs[4] = {};
+	struct vring_packed_desc *desc;
+	uint16_t buffer_id, num_descs, req_idx;
+
+	vq.vring.desc = (struct vring_desc *)descs;
+	vq.vring.size = SPDK_COUNTOF(descs);
+	vq.packed.packed_ring = true;
+	vq.packed.avail_phase = true;
+	vq.packed.used_phase = true;
+
+	/* Nothing made available yet */
+	CU_ASSERT(!spdk_vhost_vq_packed_ring_is_avail(&vq));
+
+	/* Two-descriptor chain at positions 0 and 1 */
+	descs[0].flags = VRING_DESC_F_NEXT | SPDK_VRING_DESC_F_AVAIL;
+	descs[1].flags = VRING_DESC_F_WRITE | SPDK_VRING_DESC_F_AVAIL;
+	descs[1].id = 5;
+	CU_ASSERT(spdk_vhost_vq_packed_ring_is_avail(&vq));
+	buffer_id = spdk_vhost_vring_packed_desc_get_buffer_id(&vq, vq.last_avail_idx, &num_descs);
+	CU_ASSERT(buffer_id == 5);
+	CU_ASSERT(num_descs == 2);
+
+	req_idx = vq.last_avail_idx;
+	desc = &descs[0];
+	CU_ASSERT(spdk_vhost_vring_packed_desc_get_next(&desc, &req_idx, &vq, NULL, 0) == 0);
+	CU_ASSERT(desc == &descs[1] && req_idx == 1);
+	CU_ASSERT(spdk_vhost_vring_packed_desc_is_wr(desc));
+	CU_ASSERT(spdk_vhost_vring_packed_desc_get_next(&desc, &req_idx, &vq, NULL, 0) == 0);
+	CU_ASSERT(desc == NULL);
+
+	spdk_vhost_vq_packed_ring_consume(&vq, num_descs);
+	CU_ASSERT(vq.last_avail_idx == 2);
+	CU_ASSERT(vq.packed.avail_phase == true);
+
+	/* Three-descriptor chain wrapping around the ring end */
+	descs[2].flags = VRING_DESC_F_NEXT | SPDK_VRING_DESC_F_AVAIL;
+	descs[3].flags = VRING_DESC_F_NEXT | SPDK_VRING_DESC_F_AVAIL;
+	CU_ASSERT(spdk_vhost_vq_packed_ring_is_avail(&vq));
+	/* Position 0 is still flagged available for the previous phase */
+	descs[0].flags = SPDK_VRING_DESC_F_USED;
+	descs[0].id = 6;
+	buffer_id = spdk_vhost_vring_packed_desc_get_buffer_id(&vq, vq.last_avail_idx, &num_descs);
+	CU_ASSERT(buffer_id == 6);
+	CU_ASSERT(num_descs == 3);
+
+	spdk_vhost_vq_packed_ring_consume(&vq, num_descs);
+	CU_ASSERT(vq.last_avail_idx == 1);
+	CU_ASSERT(vq.packed.avail_phase == false);
+	/* Position 1 still carries the first phase flags */
+	CU_ASSERT(!spdk_vhost_vq_packed_ring_is_avail(&vq));
+
+	/* Complete the first request - used flags match the device wrap counter */
+	spdk_vhost_vq_packed_ring_enqueue(&vsession, &vq, 2, 5, 512);
+	CU_ASSERT(descs[0].id == 5);
+	CU_ASSERT(descs[0].len == 512);
+	CU_ASSERT(descs[0].flags == (VRING_DESC_F_WRITE | SPDK_VRING_DESC_F_AVAIL_USED));
+	CU_ASSERT(vq.last_used_idx == 2);
+	CU_ASSERT(vq.packed.used_phase == true);
+	CU_ASSERT(vq.used_req_cnt == 1);
+
+	/* Complete the second one, wrapping the used index */
+	spdk_vhost_vq_packed_ring_enqueue(&vsession, &vq, 3, 6, 0);
+	CU_ASSERT(descs[2].id == 6);
+	CU_ASSERT(descs[2].flags == SPDK_VRING_DESC_F_AVAIL_USED);
+	CU_ASSERT(vq.last_used_idx == 1);
+	CU_ASSERT(vq.packed.used_phase == false);
+
+	/* After the wrap, used descriptors have both flags cleared */
+	spdk_vhost_vq_packed_ring_enqueue(&vsession, &vq, 1, 7, 0);
+	CU_ASSERT(descs[1].id == 7);
+	CU_ASSERT(descs[1].flags == 0);
+	CU_ASSERT(vq.last_used_idx == 2);
+}
+
+static void
+adaptive_coalescing_test(void)
+{
+	struct spdk_vhost_session vsession = {};
+	struct spdk_vhost_virtqueue *vq = &vsession.virtqueue[0];
+	struct vring_desc desc = {};
+	struct vring_avail avail = {};
+	uint64_t next_stats_check_time = 0;
+
+	/* spdk_get_ticks_hz() is 1000000 in unit tests - a tick is 1us */
+	vsession.max_queues = 1;
+	vsession.stats_check_interval = 10000;
+	vsession.coalescing_target_latency = 50;
+	vq->vring.desc = &desc;
+	vq->vring.avail = &avail;
+	vq->vring.size = 256;
+	vq->vring.callfd = -1;
+
+	/* Fewer than 2 completions expected within the target latency - no delay */
+	ut_spdk_get_ticks = 10000;
+	vq->req_cnt = 100;
+	check_session_io_stats(&vsession, 0, 1, &next_stats_check_time, ut_spdk_get_ticks);
+	CU_ASSERT(vq->irq_delay_time == 0);
+	CU_ASSERT(vq->req_cnt == 0);
+	CU_ASSERT(next_stats_check_time == 20000);
+
+	/* Stats are not checked again before the interval passes */
+	vq->req_cnt = 5000;
+	check_session_io_stats(&vsession, 0, 1, &next_stats_check_time, 15000);
+	CU_ASSERT(vq->irq_delay_time == 0);
+
+	/* Batch of completions would take longer than the target latency */
+	ut_spdk_get_ticks = 20000;
+	check_session_io_stats(&vsession, 0, 1, &next_stats_check_time, ut_spdk_get_ticks);
+	CU_ASSERT(vq->irq_delay_time == 50);
+
+	/* Batch of completions fits within the target latency */
+	ut_spdk_get_ticks = 30000;
+	vq->req_cnt = 20000;
+	check_session_io_stats(&vsession, 0, 1, &next_stats_check_time, ut_spdk_get_ticks);
+	CU_ASSERT(vq->irq_delay_time == 10000 * SPDK_VHOST_ADAPTIVE_COALESCING_MAX_BATCH / 20000);
+
+	/* Event is delayed while the guest has requests in flight */
+	next_stats_check_time = UINT64_MAX;
+	vq->next_event_time = ut_spdk_get_ticks + 10;
+	vq->last_avail_idx = 3;
+	vq->last_used_idx = 1;
+	vq->used_req_cnt = 1;
+	spdk_vhost_session_used_signal_range(&vsession, 0, 1, &next_stats_check_time);
+	CU_ASSERT(vq->irq_cnt == 0);
+	CU_ASSERT(vq->used_req_cnt == 1);
+
+	/* ...but sent immediately once nothing is in flight */
+	vq->last_used_idx = 3;
+	spdk_vhost_session_used_signal_range(&vsession, 0, 1, &next_stats_check_time);
+	CU_ASSERT(vq->irq_cnt == 1);
+	CU_ASSERT(vq->used_req_cnt == 0);
+	CU_ASSERT(vq->next_event_time == ut_spdk_get_ticks + vq->irq_delay_time);
+
+	/* Events suppressed by the guest are never sent */
+	ut_spdk_get_ticks = 40000;
+	avail.flags = VRING_AVAIL_F_NO_INTERRUPT;
+	vq->used_req_cnt = 1;
+	spdk_vhost_session_used_signal_range(&vsession, 0, 1, &next_stats_check_time);
+	CU_ASSERT(vq->irq_cnt == 1);
+
+	/* Turning adaptive mode off drops its delay even below the static IOPS threshold */
+	vsession.coalescing_target_latency = 0;
+	vsession.coalescing_delay_time_base = 10;
+	vsession.coalescing_io_rate_threshold = 1000;
+	next_stats_check_time = 0;
+	vq->next_event_time = ut_spdk_get_ticks + 1000;
+	vq->req_cnt = 10;
+	check_session_io_stats(&vsession, 0, 1, &next_stats_check_time, ut_spdk_get_ticks);
+	CU_ASSERT(vq->irq_delay_time == 0);
+	CU_ASSERT(vq->next_event_time == ut_spdk_get_ticks);
+
+	ut_spdk_get_ticks = 0;
+}
+
+static void
+dirty_log_test(void)
+{
+	struct spdk_vhost_session vsession = {};
+	struct spdk_vhost_virtqueue *vq = &vsession.virtqueue[0];
+	struct vring_desc descs[4] = {};
+	struct vring_used *used;
+	int i;
+
+	used = calloc(1, sizeof(*used) + 4 * sizeof(used->ring[0]));
+	SPDK_CU_ASSERT_FATAL(used != NULL);
+	vq->vring.desc = descs;
+	vq->vring.used = used;
+	vq->vring.size = 4;
+	vq->vring.callfd = -1;
+	vsession.max_queues = 1;
+
+	/* Buffers 0-2 are adjacent, buffer 3 is not */
+	for (i = 0; i < 4; i++) {
+		descs[i].flags = VRING_DESC_F_WRITE;
+		descs[i].len = 0x1000;
+		descs[i].addr = 0x10000 + i * 0x1000;
+	}
+	descs[3].addr = 0x80000;
+	descs[3].len = 0x2000;
+
+	/* Nothing is logged without VHOST_F_LOG_ALL */
+	g_log_write_cnt = g_log_used_cnt = 0;
+	spdk_vhost_vq_used_ring_enqueue(&vsession, vq, 0, 0x1000);
+	CU_ASSERT(spdk_vhost_vq_used_signal(&vsession, vq) == 1);
+	CU_ASSERT(g_log_write_cnt == 0);
+	CU_ASSERT(g_log_used_cnt == 0);
+
+	/* A burst of completions is logged at once, with adjacent buffers merged */
+	vsession.negotiated_features = 1ULL << VHOST_F_LOG_ALL;
+	for (i = 0; i < 4; i++) {
+		spdk_vhost_vq_used_ring_enqueue(&vsession, vq, i, descs[i].len);
+	}
+	CU_ASSERT(g_log_write_cnt == 0);
+	CU_ASSERT(g_log_used_cnt == 0);
+
+	spdk_vhost_vq_used_signal(&vsession, vq);
+	CU_ASSERT(g_log_write_cnt == 2);
+	CU_ASSERT(g_log_writes[0].addr == 0x10000);
+	CU_ASSERT(g_log_writes[0].len == 0x3000);
+	CU_ASSERT(g_log_writes[1].addr == 0x80000);
+	CU_ASSERT(g_log_writes[1].len == 0x2000);
+
+	/* The used ring is logged as a single span covering idx and all elements */
+	CU_ASSERT(g_log_used_cnt == 1);
+	CU_ASSERT(g_log_used.addr == offsetof(struct vring_used, idx));
+	CU_ASSERT(g_log_used.len == offsetof(struct vring_used, ring[4]) -
+		  offsetof(struct vring_used, idx));
+
+	/* Nothing left to flush */
+	g_log_write_cnt = g_log_used_cnt = 0;
+	spdk_vhost_vq_log_flush(&vsession, vq);
+	CU_ASSERT(g_log_write_cnt == 0);
+	CU_ASSERT(g_log_used_cnt == 0);
+
+	/* Ranges are flushed early once the virtqueue runs out of them */
+	for (i = 0; i <= SPDK_VHOST_LOG_RANGES_MAX; i++) {
+		spdk_vhost_vq_log_write(&vsession, vq, (uint64_t)i * 0x10000, 1);
+	}
+	CU_ASSERT(g_log_write_cnt == SPDK_VHOST_LOG_RANGES_MAX);
+	CU_ASSERT(vq->log.range_cnt == 1);
+	spdk_vhost_vq_log_flush(&vsession, vq);
+	CU_ASSERT(g_log_write_cnt == SPDK_VHOST_LOG_RANGES_MAX + 1);
+	CU_ASSERT(g_log_writes[SPDK_VHOST_LOG_RANGES_MAX].addr ==
+		  (uint64_t)SPDK_VHOST_LOG_RANGES_MAX * 0x10000);
+	CU_ASSERT(g_log_writes[SPDK_VHOST_LOG_RANGES_MAX].len == 0x1000);
+
+	free(used);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -366,7 +627,10 @@ main(int argc, char **argv)
 		CU_add_test(suite, "desc_to_iov", desc_to_iov_test) == NULL ||
 		CU_add_test(suite, "create_controller", create_controller_test) == NULL ||
 		CU_add_test(suite, "session_find_by_vid", session_find_by_vid_test) == NULL ||
-		CU_add_test(suite, "remove_controller", remove_controller_test) == NULL
+		CU_add_test(suite, "remove_controller", remove_controller_test) == NULL ||
+		CU_add_test(suite, "packed_ring", packed_ring_test) == NULL ||
+		CU_add_test(suite, "adaptive_coalescing", adaptive_coalescing_test) == NULL ||
+		CU_add_test(suite, "dirty_log", dirty_log_test) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -142,6 +142,7 @@ $valgrind $testdir/lib/util/cpuset.c/cpuset_ut
 $valgrind $testdir/lib/util/crc16.c/crc16_ut
 $valgrind $testdir/lib/util/crc32_ieee.c/crc32_ieee_ut
 $valgrind $testdir/lib/util/crc32c.c/crc32c_ut
+$valgrind $testdir/lib/util/slab.c/slab_ut
 $valgrind $testdir/lib/util/string.c/string_ut
 $valgrind $testdir/lib/util/dif.c/dif_ut
 
@@ -155,6 +156,8 @@ $valgrind $testdir/lib/ftl/ftl_ppa/ftl_ppa_ut
 $valgrind $testdir/lib/ftl/ftl_band.c/ftl_band_ut
 $valgrind $testdir/lib/ftl/ftl_reloc.c/ftl_reloc_ut
 $valgrind $testdir/lib/ftl/ftl_wptr/ftl_wptr_ut
+$valgrind $testdir/lib/ftl/ftl_emu/ftl_emu_ut
+$valgrind $testdir/lib/ftl/ftl_l2p_cache/ftl_l2p_cache_ut
 fi
 
 # local unit test coverage
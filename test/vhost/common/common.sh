@@ -524,6 +524,7 @@ function vm_setup()
 	local force_vm=""
 	local guest_memory=1024
 	local queue_number=""
+	local packed_ring=false
 	local vhost_dir="$(get_vhost_dir)"
 	while getopts ':-:' optchar; do
 		case "$optchar" in
@@ -539,6 +540,7 @@ function vm_setup()
 				force=*) local force_vm=${OPTARG#*=} ;;
 				memory=*) local guest_memory=${OPTARG#*=} ;;
 				queue_num=*) local queue_number=${OPTARG#*=} ;;
+				packed=*) local packed_ring=${OPTARG#*=} ;;
 				incoming=*) local vm_incoming="${OPTARG#*=}" ;;
 				migrate-to=*) local vm_migrate_to="${OPTARG#*=}" ;;
 				vhost-num=*) local vhost_dir="$(get_vhost_dir ${OPTARG#*=})" ;;
@@ -744,6 +746,9 @@ function vm_setup()
 				notice "using socket $vhost_dir/naa.$disk.$vm_num"
 				cmd+="-chardev socket,id=char_$disk,path=$vhost_dir/naa.$disk.$vm_num ${eol}"
 				cmd+="-device vhost-user-blk-pci,num-queues=$queue_number,chardev=char_$disk"
+				if [[ $packed_ring == true ]]; then
+					cmd+=",packed=on"
+				fi
 				if [[ "$disk" == "$boot_from" ]]; then
 					cmd+=",bootindex=0"
 					boot_disk_present=true
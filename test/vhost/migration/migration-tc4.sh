@@ -0,0 +1,137 @@
+function migration_tc4_clean_vhost_config()
+{
+	# Restore trap
+	trap 'error_exit "${FUNCNAME}" "${LINENO}"' INT ERR EXIT
+
+	notice "Removing vhost devices & controllers via RPC ..."
+	$rpc remove_vhost_controller $incoming_vm_ctrlr
+	$rpc remove_vhost_controller $target_vm_ctrlr
+	$rpc delete_malloc_bdev Malloc0
+
+	unset -v incoming_vm target_vm incoming_vm_ctrlr target_vm_ctrlr rpc
+}
+
+function migration_tc4_configure_vhost()
+{
+	# Those are global intentionally - they will be unset in cleanup handler
+	incoming_vm=0
+	target_vm=1
+	incoming_vm_ctrlr=naa.Malloc0.$incoming_vm
+	target_vm_ctrlr=naa.Malloc0.$target_vm
+	rpc="$SPDK_BUILD_DIR/scripts/rpc.py -s $(get_vhost_dir)/rpc.sock"
+
+	trap 'migration_tc4_error_handler; error_exit "${FUNCNAME}" "${LINENO}"' INT ERR EXIT
+
+	# Construct shared Malloc Bdev and two block controllers - one for each VM.
+	$rpc construct_malloc_bdev -b Malloc0 128 4096
+	$rpc construct_vhost_blk_controller $incoming_vm_ctrlr Malloc0
+	$rpc construct_vhost_blk_controller $target_vm_ctrlr Malloc0
+}
+
+function migration_tc4_error_handler()
+{
+	trap - SIGINT ERR EXIT
+	warning "Migration TC4 ERROR HANDLER"
+	print_backtrace
+	set -x
+
+	vm_kill_all
+	migration_tc4_clean_vhost_config
+
+	warning "Migration TC4 FAILED"
+}
+
+# Sum read and write IOPS of the fio JSON results in directory $1
+function migration_tc4_get_iops()
+{
+	python3 - "$1" <<PYEOF
+import glob, json, os, sys
+iops = 0.0
+for path in glob.glob(os.path.join(sys.argv[1], "*.log")):
+    with open(path) as f:
+        data = json.load(f)
+    for job in data.get("jobs", []) + data.get("client_stats", []):
+        if job.get("jobname") == "All clients":
+            continue
+        iops += job["read"]["iops"] + job["write"]["iops"]
+print(int(iops))
+PYEOF
+}
+
+function migration_tc4()
+{
+	# Measure vhost-blk IOPS of a VM with dirty page logging disabled, and
+	# then with logging enabled by a throttled migration that can't finish
+	# while fio is running. The migration is cancelled afterwards.
+	local job_file="$MIGRATION_DIR/migration-tc4.job"
+	local results_dir="$TEST_DIR/migration-tc4"
+	local vm_dir
+	local target_vm_dir
+	local iops_off iops_on
+
+	spdk_vhost_run
+	migration_tc4_configure_vhost
+
+	vm_dir="$VM_BASE_DIR/$incoming_vm"
+	rm -rf $results_dir
+
+	notice "Setting up VMs"
+	vm_setup --os="$os_image" --force=$incoming_vm --disk-type=spdk_vhost_blk --disks=Malloc0 --migrate-to=$target_vm
+	vm_setup --force=$target_vm --disk-type=spdk_vhost_blk --disks=Malloc0 --incoming=$incoming_vm
+	target_vm_dir="$VM_BASE_DIR/$target_vm"
+
+	vm_run $incoming_vm $target_vm
+	vm_wait_for_boot 600 $incoming_vm
+	vm_check_blk_location $incoming_vm
+	vm_start_fio_server $fio_bin $incoming_vm
+
+	notice "Running FIO with dirty page logging disabled"
+	run_fio $fio_bin --job-file="$job_file" --out="$results_dir/logging_off" --json \
+		--vm="${incoming_vm}$(printf ':/dev/%s' $SCSI_DISK)"
+
+	notice "Starting throttled migration to enable dirty page logging"
+	echo -e \
+		"migrate_set_speed 1m\n" \
+		"migrate -d tcp:127.0.0.1:$(cat $target_vm_dir/migration_port)\n" \
+		"info migrate\n" \
+		"quit" | vm_monitor_send $incoming_vm "$vm_dir/migration_result"
+	if ! grep "Migration status: active" $vm_dir/migration_result -q; then
+		cat $vm_dir/migration_result
+		fail "Migration is not active"
+	fi
+
+	notice "Running FIO with dirty page logging enabled"
+	run_fio $fio_bin --job-file="$job_file" --out="$results_dir/logging_on" --json \
+		--vm="${incoming_vm}$(printf ':/dev/%s' $SCSI_DISK)"
+
+	echo -e \
+		"info migrate\n" \
+		"migrate_cancel\n" \
+		"quit" | vm_monitor_send $incoming_vm "$vm_dir/migration_result"
+	if ! grep "Migration status: active" $vm_dir/migration_result -q; then
+		cat $vm_dir/migration_result
+		fail "Migration finished or failed while FIO was running - results are not valid"
+	fi
+
+	iops_off=$(migration_tc4_get_iops $results_dir/logging_off)
+	iops_on=$(migration_tc4_get_iops $results_dir/logging_on)
+	notice "IOPS with dirty page logging disabled: $iops_off"
+	notice "IOPS with dirty page logging enabled: $iops_on"
+	if [[ $iops_off -gt 0 ]]; then
+		notice "IOPS with logging enabled: $((iops_on * 100 / iops_off))% of IOPS without logging"
+	fi
+
+	notice "Shutting down all VMs"
+	# Target VM still waits for the cancelled migration and can't be shut down gracefully
+	vm_kill $target_vm
+	vm_shutdown_all
+
+	migration_tc4_clean_vhost_config
+
+	notice "killing vhost app"
+	spdk_vhost_kill
+
+	notice "Migration TC4 SUCCESS"
+}
+
+migration_tc4
@@ -24,7 +24,7 @@ function usage()
 	echo "    --work-dir=WORK_DIR   Where to find build file. Must exist. [default: $TEST_DIR]"
 	echo "    --os ARGS             VM configuration. This parameter might be used more than once:"
 	echo "    --fio-bin=FIO         Use specific fio binary (will be uploaded to VM)"
-	echo "    --test-cases=TESTS    Coma-separated list of tests to run. Implemented test cases are: 1"
+	echo "    --test-cases=TESTS    Coma-separated list of tests to run. Implemented test cases are: 1, 2, 4"
 	echo "                          See test/vhost/test_plan.md for more info."
 	echo "    --mgmt-tgt-ip=IP      IP address of target."
 	echo "    --mgmt-init-ip=IP     IP address of initiator."
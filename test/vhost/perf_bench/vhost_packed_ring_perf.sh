@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+set -e
+
+# Compare per-core IOPS of the SPDK vhost-blk target for VMs using split
+# and packed virtqueues. All options are passed through to vhost_perf.sh.
+
+PERF_DIR=$(readlink -f $(dirname $0))
+. $PERF_DIR/../common/common.sh
+
+if [[ -n "$1" && ( "$1" == "-h" || "$1" == "--help" ) ]]; then
+	echo "Run vhost_perf.sh with spdk_vhost_blk controllers twice - once with split"
+	echo "and once with packed virtqueues - and print IOPS per vhost reactor core."
+	echo "Usage: $(basename $0) [vhost_perf.sh OPTIONS]"
+	echo "See vhost_perf.sh --help for the list of options."
+	exit 0
+fi
+
+for arg in "$@"; do
+	if [[ "$arg" == --custom-cpu-cfg=* ]]; then
+		source ${arg#*=}
+	fi
+done
+
+# vhost_0_reactor_mask is given as a list of cores, e.g. "[0-3,8]"
+function count_reactor_cores()
+{
+	local mask=${vhost_0_reactor_mask#"["}
+	local cores=0
+	local range
+
+	mask=${mask%"]"}
+	for range in ${mask//,/ }; do
+		if [[ "$range" == *-* ]]; then
+			cores=$((cores + ${range#*-} - ${range%-*} + 1))
+		else
+			cores=$((cores + 1))
+		fi
+	done
+	echo $cores
+}
+
+# Sum read and write IOPS of all fio JSON results in a directory
+function get_total_iops()
+{
+	python3 - "$1" <<PYEOF
+import glob, json, os, sys
+iops = 0.0
+for path in glob.glob(os.path.join(sys.argv[1], "*.log")):
+    with open(path) as f:
+        data = json.load(f)
+    # fio run in client mode reports per-client stats plus an "All clients" summary
+    jobs = data.get("jobs", []) + data.get("client_stats", [])
+    for job in jobs:
+        if job.get("jobname") == "All clients":
+            continue
+        iops += job["read"]["iops"] + job["write"]["iops"]
+print(int(iops))
+PYEOF
+}
+
+cores=$(count_reactor_cores)
+results_dir=$TEST_DIR/packed_ring_results
+rm -rf $results_dir
+mkdir -p $results_dir
+
+for ring in split packed; do
+	notice "Running vhost-blk performance test with $ring virtqueues"
+	rm -rf $TEST_DIR/fio_results
+	if [[ "$ring" == "packed" ]]; then
+		$PERF_DIR/vhost_perf.sh --ctrl-type=spdk_vhost_blk --packed-ring "$@"
+	else
+		$PERF_DIR/vhost_perf.sh --ctrl-type=spdk_vhost_blk "$@"
+	fi
+	mv $TEST_DIR/fio_results $results_dir/$ring
+done
+
+notice "vhost-blk IOPS per reactor core ($cores cores):"
+for ring in split packed; do
+	iops=$(get_total_iops $results_dir/$ring)
+	notice "  $ring: total $iops, per core $((iops / cores))"
+done
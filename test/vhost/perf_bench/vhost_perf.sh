@@ -12,6 +12,7 @@ vm_throttle=""
 max_disks=""
 ctrl_type="spdk_vhost_scsi"
 use_split=false
+packed_ring=false
 kernel_cpus=""
 lvol_precondition=false
 lvol_stores=()
@@ -54,6 +55,7 @@ function usage()
 	echo "                            kernel_vhost - use kernel vhost scsi"
 	echo "                            Default: spdk_vhost_scsi"
 	echo "    --use-split             Use split vbdevs instead of Logical Volumes"
+	echo "    --packed-ring           Make VMs use packed virtqueues. Only for spdk_vhost_blk."
 	echo "    --limit-kernel-vhost=INT  Limit kernel vhost to run only on a number of CPU cores."
 	echo "    --lvol-precondition     Precondition lvols after creating. Default: true."
 	echo "    --precond-fio-bin       FIO binary used for SPDK fio plugin precondition. Default: /usr/src/fio/fio."
@@ -119,6 +121,7 @@ while getopts 'xh-:' optchar; do
 			max-disks=*) max_disks="${OPTARG#*=}" ;;
 			ctrl-type=*) ctrl_type="${OPTARG#*=}" ;;
 			use-split) use_split=true ;;
+			packed-ring) packed_ring=true ;;
 			lvol-precondition) lvol_precondition=true ;;
 			precond-fio-bin=*) precond_fio_bin="${OPTARG#*=}" ;;
 			limit-kernel-vhost=*) kernel_cpus="${OPTARG#*=}" ;;
@@ -286,7 +289,7 @@ for (( i=0; i<$vm_count; i++)); do
 		setup_cmd+=" --disks=0"
 	elif [[ "$ctrl_type" == "spdk_vhost_blk" ]]; then
 		$rpc_py construct_vhost_blk_controller naa.$i.$i ${bdevs[$i]}
-		setup_cmd+=" --disks=$i"
+		setup_cmd+=" --disks=$i --packed=$packed_ring"
 	elif [[ "$ctrl_type" == "kernel_vhost" ]]; then
 		x=$(printf %03d $i)
 		setup_cmd+=" --disks=${wwpn_prefix}${x}"